@@ -365,6 +365,11 @@ tstring encoder_help() {
         _T("   --disable-nvml <int>        disable NVML GPU monitoring (default 0, 0-2)\n");
         _T("   --disable-dx11              disable DX11 initilization.\n");
         _T("   --disable-vulkan            disable Vulkan initilization.\n");
+    str += strsprintf(_T("")
+        _T("   --nvrtc-cache <string>       save kernels compiled by NVRTC to the directory,\n")
+        _T("                                 and reuse them on the next run.\n")
+        _T("   --nvrtc-cache-size <int>     max size of --nvrtc-cache in MB (default: %d).\n"),
+        RGY_NVRTC_CACHE_SIZE_MB_DEFAULT);
     str += gen_cmd_help_ctrl();
     return str;
 }
@@ -1479,6 +1484,25 @@ int parse_one_option(const TCHAR *option_name, const TCHAR* strInput[], int& i,
         pParams->disableDX11 = true;
         return 0;
     }
+    if (IS_OPTION("nvrtc-cache")) {
+        i++;
+        pParams->nvrtcCacheDir = strInput[i];
+        return 0;
+    }
+    if (IS_OPTION("nvrtc-cache-size")) {
+        i++;
+        int value = 0;
+        if (1 != _stscanf_s(strInput[i], _T("%d"), &value)) {
+            print_cmd_error_invalid_value(option_name, strInput[i]);
+            return 1;
+        }
+        if (value <= 0) {
+            print_cmd_error_invalid_value(option_name, strInput[i], _T("nvrtc-cache-size should be specified in positive value."));
+            return 1;
+        }
+        pParams->nvrtcCacheSizeMB = value;
+        return 0;
+    }
 
     auto ret = parse_one_input_option(option_name, strInput, i, nArgNum, &pParams->input, &pParams->inprm, argData);
     if (ret >= 0) return ret;
@@ -1847,6 +1871,8 @@ tstring gen_cmd(const InEncodeVideoParam *pParams, const NV_ENC_CODEC_CONFIG cod
     OPT_NUM(_T("--session-retry"), sessionRetry);
     OPT_NUM(_T("--disable-nvml"), disableNVML);
     OPT_BOOL(_T("--disable-dx11"), _T(""), disableDX11);
+    OPT_STR_PATH(_T("--nvrtc-cache"), nvrtcCacheDir);
+    OPT_NUM(_T("--nvrtc-cache-size"), nvrtcCacheSizeMB);
 
     cmd << gen_cmd(&pParams->ctrl, &encPrmDefault.ctrl, save_disabled_prm);
 
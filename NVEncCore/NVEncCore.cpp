@@ -67,6 +67,8 @@
 #include "rgy_level_hevc.h"
 #include "rgy_device_info_cache.h"
 #include "rgy_parallel_enc.h"
+#include "rgy_metrics.h"
+#include "rgy_nvrtc_cache.h"
 #include "NVEncPipeline.h"
 #include "NVEncCore.h"
 #include "NVEncFilterDelogo.h"
@@ -324,12 +326,14 @@ NVEncCore::NVEncCore() :
     m_rgbAsYUV444(),
     m_nProcSpeedLimit(0),
     m_taskPerfMonitor(false),
+    m_trace(),
     m_nAVSyncMode(RGY_AVSYNC_AUTO),
     m_timestampPassThrough(false),
     m_inputFps(),
     m_outputTimebase(),
     m_encFps(),
     m_pipelineTasks(),
+    m_pipelineExecutor(),
     m_encodeBufferCount(16),
     m_EncodeBufferQueue(),
     m_stEOSOutputBfr(),
@@ -400,7 +404,7 @@ RGY_CSP NVEncCore::GetRawOutCSP(const InEncodeVideoParam *inputParam) const {
 //ログを初期化
 RGY_ERR NVEncCore::InitLog(const InEncodeVideoParam *inputParam) {
     //ログの初期化
-    m_pLog.reset(new RGYLog(inputParam->ctrl.logfile.c_str(), inputParam->ctrl.loglevel, inputParam->ctrl.logOpt.addTime, inputParam->ctrl.logOpt.addLogLevel, inputParam->ctrl.logOpt.disableColor));
+    m_pLog.reset(new RGYLog(inputParam->ctrl.logfile.c_str(), inputParam->ctrl.loglevel, inputParam->ctrl.logOpt.addTime, inputParam->ctrl.logOpt.addLogLevel, inputParam->ctrl.logOpt.disableColor, inputParam->ctrl.logOpt.async));
     if ((inputParam->ctrl.logfile.length() > 0 || inputParam->common.outputFilename.length() > 0) && inputParam->input.type != RGY_INPUT_FMT_SM) {
         m_pLog->writeFileHeader(inputParam->common.outputFilename.c_str());
     }
@@ -533,7 +537,7 @@ RGY_ERR NVEncCore::InitInput(InEncodeVideoParam *inputParam, DeviceCodecCsp& HWD
     if (auto sts =initReaders(m_pFileReader, m_AudioReaders, &inputParam->input, &inputParam->inprm, inputCspOfRawReader,
         m_pStatus, &inputParam->common, &inputParam->ctrl, HWDecCodecCsp, subburnTrackId,
         inputParam->vpp.rff.enable, inputParam->vpp.afs.enable, inputParam->vpp.libplacebo_tonemapping.enable,
-        m_poolPkt.get(), m_poolFrame.get(), m_qpTable.get(), m_pPerfMonitor.get(), m_pLog); sts != RGY_ERR_NONE) {
+        m_poolPkt.get(), m_poolFrame.get(), m_qpTable.get(), m_pPerfMonitor.get(), m_trace.get(), m_pLog); sts != RGY_ERR_NONE) {
         PrintMes(RGY_LOG_ERROR, _T("failed to initialize file reader(s).\n"));
         return sts;
     }
@@ -730,6 +734,7 @@ RGY_ERR NVEncCore::InitPowerThrottoling(InEncodeVideoParam *inputParam) {
 
 RGY_ERR NVEncCore::InitPerfMonitor(const InEncodeVideoParam *inputParam) {
     const bool bLogOutput = inputParam->ctrl.perfMonitorSelect || inputParam->ctrl.perfMonitorSelectMatplot;
+    const bool bMetrics = inputParam->ctrl.metrics.length() > 0 || inputParam->ctrl.metricsPort > 0;
     tstring perfMonLog;
     if (bLogOutput) {
         perfMonLog = inputParam->common.outputFilename + _T("_perf.csv");
@@ -738,7 +743,15 @@ RGY_ERR NVEncCore::InitPerfMonitor(const InEncodeVideoParam *inputParam) {
 #if ENABLE_NVML
     perfMonitorPrm.pciBusId = m_dev->pciBusId();
 #endif
-    if (m_pPerfMonitor->init(perfMonLog.c_str(), _T(""), (bLogOutput) ? inputParam->ctrl.perfMonitorInterval : 1000,
+    if (bMetrics) {
+        auto metrics = std::make_shared<RGYMetrics>();
+        if (metrics->init(inputParam->ctrl.metrics, inputParam->ctrl.metricsPort, m_pLog) != RGY_ERR_NONE) {
+            PrintMes(RGY_LOG_WARN, _T("Failed to initialize metrics output, disabled.\n"));
+        } else {
+            perfMonitorPrm.metrics = metrics;
+        }
+    }
+    if (m_pPerfMonitor->init(perfMonLog.c_str(), _T(""), (bLogOutput || perfMonitorPrm.metrics) ? inputParam->ctrl.perfMonitorInterval : 1000,
         (int)inputParam->ctrl.perfMonitorSelect, (int)inputParam->ctrl.perfMonitorSelectMatplot,
 #if defined(_WIN32) || defined(_WIN64)
         std::unique_ptr<void, handle_deleter>(OpenThread(SYNCHRONIZE | THREAD_QUERY_INFORMATION, false, GetCurrentThreadId()), handle_deleter()),
@@ -750,6 +763,9 @@ RGY_ERR NVEncCore::InitPerfMonitor(const InEncodeVideoParam *inputParam) {
         PrintMes(RGY_LOG_WARN, _T("Failed to initialize performance monitor, disabled.\n"));
         m_pPerfMonitor.reset();
     }
+    if (m_pPerfMonitor && m_poolPkt) {
+        m_poolPkt->setQueueInfo(m_pPerfMonitor->GetQueueInfoPtr());
+    }
     return RGY_ERR_NONE;
 }
 
@@ -849,7 +865,7 @@ RGY_ERR NVEncCore::InitOutput(InEncodeVideoParam *inputParams, NV_ENC_BUFFER_FOR
         &inputParams->common, &inputParams->input, &inputParams->ctrl, outputVideoInfo,
         m_trimParam, m_outputTimebase, m_Chapters, m_hdrseiOut.get(), m_hdr10plus.get(), m_dovirpu.get(), m_encTimestamp.get(),
         false, false, rgy_csp_has_alpha(inputParams->outputCsp), inputParams->alphaChannelMode,
-        m_poolPkt.get(), m_poolFrame.get(), m_pStatus, m_pPerfMonitor, m_pLog); sts != RGY_ERR_NONE) {
+        m_poolPkt.get(), m_poolFrame.get(), m_pStatus, m_pPerfMonitor, m_trace.get(), m_pLog); sts != RGY_ERR_NONE) {
         PrintMes(RGY_LOG_ERROR, _T("failed to initialize file reader(s): %s.\n"), get_err_mes(sts));
         return sts;
     }
@@ -1254,6 +1270,7 @@ NVENCSTATUS NVEncCore::FlushEncoder() {
 }
 
 RGY_ERR NVEncCore::Deinitialize() {
+    m_pipelineExecutor.reset();
     m_pipelineTasks.clear();
     m_videoQualityMetric.reset();
     m_dovirpu.reset();
@@ -1293,8 +1310,14 @@ RGY_ERR NVEncCore::Deinitialize() {
     m_deviceUsage.reset();
     m_pStatus.reset();
     m_parallelEnc.reset();
+    m_trace.reset();
     PrintMes(RGY_LOG_DEBUG, _T("Closed EncodeStatus.\n"));
 
+    if (m_poolPkt) {
+        //perf monitorの終了前に、poolの統計を反映しておく
+        m_poolPkt->updatePerfInfo();
+        m_poolPkt->setQueueInfo(nullptr);
+    }
     PrintMes(RGY_LOG_DEBUG, _T("Closing perf monitor...\n"));
     m_pPerfMonitor.reset();
 
@@ -4061,6 +4084,14 @@ RGY_ERR NVEncCore::Init(InEncodeVideoParam *inputParam) {
     }
     m_nDeviceId = inputParam->deviceID;
     m_cudaSchedule = (CUctx_flags)(inputParam->cudaSchedule & CU_CTX_SCHED_MASK);
+    if (inputParam->nvrtcCacheDir.length() > 0) {
+        if ((sts = initNVRTCCacheGlobal(inputParam->nvrtcCacheDir, (int64_t)inputParam->nvrtcCacheSizeMB * 1024 * 1024)) != RGY_ERR_NONE) {
+            PrintMes(RGY_LOG_WARN, _T("Failed to initialize nvrtc cache \"%s\": %s, nvrtc cache disabled.\n"), inputParam->nvrtcCacheDir.c_str(), get_err_mes(sts));
+            sts = RGY_ERR_NONE;
+        } else {
+            PrintMes(RGY_LOG_DEBUG, _T("nvrtc cache: %s (max %d MB).\n"), inputParam->nvrtcCacheDir.c_str(), inputParam->nvrtcCacheSizeMB);
+        }
+    }
 
     if ((sts = InitCuda()) != RGY_ERR_NONE) {
         PrintMes(RGY_LOG_ERROR, FOR_AUO ? _T("Cudaの初期化に失敗しました。\n") : _T("Failed to initialize CUDA.\n"));
@@ -4091,6 +4122,11 @@ RGY_ERR NVEncCore::Init(InEncodeVideoParam *inputParam) {
     m_nAVSyncMode = inputParam->common.AVSyncMode;
     m_nProcSpeedLimit = inputParam->ctrl.procSpeedLimit;
     m_taskPerfMonitor = inputParam->ctrl.taskPerfMonitor;
+    if (inputParam->ctrl.taskTrace.length() > 0) {
+        m_trace = std::make_unique<RGYTrace>();
+        m_trace->init(inputParam->ctrl.taskTrace);
+        PrintMes(RGY_LOG_DEBUG, _T("Enabled task trace: %s.\n"), inputParam->ctrl.taskTrace.c_str());
+    }
     m_videoIgnoreTimestampError = inputParam->common.videoIgnoreTimestampError;
     if (inputParam->ctrl.lowLatency) {
         m_pipelineDepth = 1;
@@ -4396,6 +4432,10 @@ RGY_ERR NVEncCore::Init(InEncodeVideoParam *inputParam) {
         return sts;
     }
 
+    if (RGY_ERR_NONE != (sts = initPipelineExecutor(inputParam))) {
+        return sts;
+    }
+
     {
         const auto& threadParam = inputParam->ctrl.threadParams.get(RGYThreadType::MAIN);
         threadParam.apply(GetCurrentThread());
@@ -4614,6 +4654,66 @@ RGY_ERR NVEncCore::allocatePiplelineFrames(const InEncodeVideoParam *prm) {
     return RGY_ERR_NONE;
 }
 
+RGY_ERR NVEncCore::initPipelineExecutor(const InEncodeVideoParam *prm) {
+    m_pipelineExecutor.reset();
+    if (prm->ctrl.threadPipeline <= 0) {
+        return RGY_ERR_NONE;
+    }
+    // passthroughでないtaskごとに段を分け、passthroughのtaskは直前の段で実行する
+    std::vector<RGYPipelineExecutor<PipelineTask, PipelineTaskOutput>::StageParam> stages = { { 0, 0 } };
+    PipelineTask *t0 = m_pipelineTasks[0].get(); // 前の段の最後のpassthroughでないtask
+    for (size_t itask = 1; itask < m_pipelineTasks.size(); itask++) {
+        PipelineTask *t1 = m_pipelineTasks[itask].get();
+        if (t1->isPassThrough()) {
+            continue;
+        }
+        // エンコーダの出力スレッドがない場合、前のtaskがエンコーダの出力処理を直接呼ぶので同じ段で実行する
+        if (auto taskEnc = dynamic_cast<PipelineTaskNVEncode *>(t1); taskEnc != nullptr && !taskEnc->useOutputThread()) {
+            t0 = t1;
+            continue;
+        }
+        // 段の間のキューのサイズは、前の段が確保したフレームから前後のtaskが保持する分を除いたものとする
+        // これを超えて前の段が先行しても、フレームの空きを待つことになるだけなので、キューで待機させる
+        const auto t0Alloc = t0->requiredSurfOut();
+        const auto t1Alloc = t1->requiredSurfIn();
+        const int t0RequestNumFrame = (t0Alloc.has_value()) ? t0Alloc.value().second : 0;
+        const int t1RequestNumFrame = (t1Alloc.has_value()) ? t1Alloc.value().second : 0;
+        const int surfReserved = t0RequestNumFrame + t1RequestNumFrame + 2 /*前後のtaskで処理中のフレーム*/
+            + ((t1->taskType() == PipelineTaskType::NVENC) ? m_encodeBufferCount : 0);
+        const int queueSize = std::max(1, (int)t0->workSurfacesCount() - surfReserved);
+        stages.push_back({ itask, (size_t)queueSize });
+        t0 = t1;
+    }
+    if (stages.size() <= 1) {
+        PrintMes(RGY_LOG_WARN, _T("--thread-pipeline is disabled as the pipeline cannot be split into stages.\n"));
+        return RGY_ERR_NONE;
+    }
+    std::vector<PipelineTask *> tasks;
+    std::vector<bool> lockWriter;
+    for (auto& task : m_pipelineTasks) {
+        tasks.push_back(task.get());
+        // 音声等を出力するtaskは、映像の出力と排他して実行する
+        lockWriter.push_back(task->taskType() == PipelineTaskType::AUDIO || task->taskType() == PipelineTaskType::PECOLLECT);
+    }
+    const size_t outputQueueSize = (m_pipelineTasks.back()->taskType() == PipelineTaskType::NVENC) ? m_encodeBufferCount : 1;
+    m_pipelineExecutor = std::make_unique<RGYPipelineExecutor<PipelineTask, PipelineTaskOutput>>(m_pLog);
+    auto err = m_pipelineExecutor->init(tasks, stages, lockWriter, outputQueueSize);
+    if (err != RGY_ERR_NONE) {
+        PrintMes(RGY_LOG_ERROR, _T("Failed to init pipeline executor: %s.\n"), get_err_mes(err));
+        m_pipelineExecutor.reset();
+        return err;
+    }
+    PrintMes(RGY_LOG_DEBUG, _T("Pipeline executor: %d stages.\n"), (int)m_pipelineExecutor->stageCount());
+    for (size_t istage = 0; istage < m_pipelineExecutor->stageCount(); istage++) {
+        tstring str;
+        for (size_t itask = m_pipelineExecutor->stageTaskStart(istage); itask < m_pipelineExecutor->stageTaskEnd(istage); itask++) {
+            str += ((str.length() > 0) ? _T(", ") : _T("")) + m_pipelineTasks[itask]->print();
+        }
+        PrintMes(RGY_LOG_DEBUG, _T("  stage #%d: %s (queue %d)\n"), (int)istage, str.c_str(), (int)m_pipelineExecutor->stageQueueSize(istage));
+    }
+    return RGY_ERR_NONE;
+}
+
 RGY_ERR NVEncCore::Encode() {
     PrintMes(RGY_LOG_DEBUG, _T("Encode Thread: RunEncode2...\n"));
     if (m_pipelineTasks.size() == 0) {
@@ -4644,6 +4744,14 @@ RGY_ERR NVEncCore::Encode() {
             std::vector<tstring>{_T("")}
         );
     }
+    int traceOutput = -1;
+    if (m_trace) {
+        for (size_t itask = 0; itask < m_pipelineTasks.size(); itask++) {
+            m_pipelineTasks[itask]->setTrace(m_trace.get(), strsprintf(_T("%s#%d"), getPipelineTaskTypeName(m_pipelineTasks[itask]->taskType()), (int)itask));
+        }
+        traceOutput = m_trace->registerEvent(_T("OUTPUT"), _T("write"));
+        m_trace->setThreadName(_T("pipeline"));
+    }
 
     auto requireSync = [this]([[maybe_unused]] const size_t itask) {
 #if ENCODER_NVENC
@@ -4682,7 +4790,32 @@ RGY_ERR NVEncCore::Encode() {
         PipelineTaskData(size_t t, std::unique_ptr<PipelineTaskOutput>& d) : task(t), data(std::move(d)) {};
     };
     std::deque<PipelineTaskData> dataqueue;
-    {
+    if (m_pipelineExecutor) {
+        // 各段を別スレッドで実行する (flushも各段で行われる)
+        RGYPipelineExecutor<PipelineTask, PipelineTaskOutput>::Callbacks callbacks;
+        callbacks.requireSync = requireSync;
+        callbacks.waitInput = [this, &speedCtrl]() { speedCtrl.wait(m_pipelineTasks.front()->outputFrames()); };
+        callbacks.threadInit = [this](size_t istage) {
+            m_pipelineTasks[m_pipelineExecutor->stageTaskStart(istage)]->threadParam().apply(GetCurrentThread());
+            RGYSetCurrentThreadName(RGY_THREAD_NAME_PIPELINE);
+            if (m_trace) {
+                m_trace->setThreadName(strsprintf(_T("pipeline stage#%d"), (int)istage));
+            }
+        };
+        callbacks.checkAbort = [&checkAbort](bool flushing) { return checkAbort() || (!flushing && stdInAbort()); };
+        callbacks.write = [this, &stopwatchOutput, traceOutput](std::unique_ptr<PipelineTaskOutput>& data) {
+            RGYTraceScope traceScope(m_trace.get(), traceOutput, PipelineTask::traceFrameId(data.get()));
+            if (stopwatchOutput) stopwatchOutput->set(0);
+            auto sts = data->write(m_pFileWriter.get(), m_videoQualityMetric.get());
+            if (sts != RGY_ERR_NONE) {
+                PrintMes(RGY_LOG_ERROR, _T("failed to write output: %s.\n"), get_err_mes(sts));
+                return sts;
+            }
+            if (stopwatchOutput) stopwatchOutput->add(0, 0);
+            return RGY_ERR_NONE;
+        };
+        err = m_pipelineExecutor->run(callbacks);
+    } else {
         auto checkContinue = [&checkAbort](RGY_ERR& err) {
             if (checkAbort() || stdInAbort()) { err = RGY_ERR_ABORTED; return false; }
             return err >= RGY_ERR_NONE || err == RGY_ERR_MORE_DATA || err == RGY_ERR_MORE_SURFACE;
@@ -4698,13 +4831,13 @@ RGY_ERR NVEncCore::Encode() {
                 if (d.task < m_pipelineTasks.size()) {
                     err = RGY_ERR_NONE;
                     auto& task = m_pipelineTasks[d.task];
-                    err = task->sendFrame(d.data);
+                    err = task->sendFrameTrace(d.data);
                     if (!checkContinue(err)) {
                         PrintMes(setloglevel(err), _T("Break in task %s: %s.\n"), task->print().c_str(), get_err_mes(err));
                         break;
                     }
                     if (err == RGY_ERR_NONE) {
-                        auto output = task->getOutput(requireSync(d.task));
+                        auto output = task->getOutputTrace(requireSync(d.task));
                         if (output.size() == 0) break;
                         //出てきたものは先頭に追加していく
                         std::for_each(output.rbegin(), output.rend(), [itask = d.task, &dataqueue](auto&& o) {
@@ -4712,6 +4845,7 @@ RGY_ERR NVEncCore::Encode() {
                             });
                     }
                 } else { // pipelineの最終的なデータを出力
+                    RGYTraceScope traceScope(m_trace.get(), traceOutput, PipelineTask::traceFrameId(d.data.get()));
                     if (stopwatchOutput) stopwatchOutput->set(0);
                     if ((err = d.data->write(m_pFileWriter.get(), m_videoQualityMetric.get())) != RGY_ERR_NONE) {
                         PrintMes(RGY_LOG_ERROR, _T("failed to write output: %s.\n"), get_err_mes(err));
@@ -4724,7 +4858,7 @@ RGY_ERR NVEncCore::Encode() {
                 // taskを前方からひとつづつ出力が残っていないかチェック(主にcheckptsの処理のため)
                 for (size_t itask = 0; itask < m_pipelineTasks.size(); itask++) {
                     auto& task = m_pipelineTasks[itask];
-                    auto output = task->getOutput(requireSync(itask));
+                    auto output = task->getOutputTrace(requireSync(itask));
                     if (output.size() > 0) {
                         //出てきたものは先頭に追加していく
                         std::for_each(output.rbegin(), output.rend(), [itask, &dataqueue](auto&& o) {
@@ -4759,12 +4893,12 @@ RGY_ERR NVEncCore::Encode() {
                 if (d.task < m_pipelineTasks.size()) {
                     err = RGY_ERR_NONE;
                     auto& task = m_pipelineTasks[d.task];
-                    err = task->sendFrame(d.data);
+                    err = task->sendFrameTrace(d.data);
                     if (!checkContinue(err)) {
                         if (d.task == flushedTaskSend) flushedTaskSend++;
                         break;
                     }
-                    auto output = task->getOutput(requireSync(d.task));
+                    auto output = task->getOutputTrace(requireSync(d.task));
                     if (output.size() == 0) break;
                     //出てきたものは先頭に追加していく
                     std::for_each(output.rbegin(), output.rend(), [itask = d.task, &dataqueue](auto&& o) {
@@ -4772,6 +4906,7 @@ RGY_ERR NVEncCore::Encode() {
                         });
                     if (err == RGY_ERR_MORE_DATA) err = RGY_ERR_NONE; //VPPなどでsendFrameがRGY_ERR_MORE_DATAだったが、フレームが出てくる場合がある
                 } else { // pipelineの最終的なデータを出力
+                    RGYTraceScope traceScope(m_trace.get(), traceOutput, PipelineTask::traceFrameId(d.data.get()));
                     if (stopwatchOutput) stopwatchOutput->set(0);
                     if ((err = d.data->write(m_pFileWriter.get(), m_videoQualityMetric.get())) != RGY_ERR_NONE) {
                         PrintMes(RGY_LOG_ERROR, _T("failed to write output: %s.\n"), get_err_mes(err));
@@ -4784,7 +4919,7 @@ RGY_ERR NVEncCore::Encode() {
                 // taskを前方からひとつづつ出力が残っていないかチェック(主にcheckptsの処理のため)
                 for (size_t itask = flushedTaskGet; itask < m_pipelineTasks.size(); itask++) {
                     auto& task = m_pipelineTasks[itask];
-                    auto output = task->getOutput(requireSync(itask));
+                    auto output = task->getOutputTrace(requireSync(itask));
                     if (output.size() > 0) {
                         //出てきたものは先頭に追加していく
                         std::for_each(output.rbegin(), output.rend(), [itask, &dataqueue](auto&& o) {
@@ -4854,6 +4989,7 @@ RGY_ERR NVEncCore::Encode() {
 
     //この中でフレームの解放がなされる
     PrintMes(RGY_LOG_DEBUG, _T("Clear pipeline tasks and allocated frames...\n"));
+    m_pipelineExecutor.reset();
     // 依存関係があるため、m_pipelineTasksを後ろから解放する
     for (auto it = m_pipelineTasks.rbegin(); it != m_pipelineTasks.rend(); ++it) {
         it->reset();
@@ -4863,6 +4999,21 @@ RGY_ERR NVEncCore::Encode() {
     m_pFileWriter->WaitFin();
     PrintMes(RGY_LOG_DEBUG, _T("Close reader...\n"));
     m_pFileReader->Close();
+    if (m_trace) {
+        // 入出力のスレッドも終了したので、記録した内容を出力する
+        PrintMes(RGY_LOG_INFO, _T("\n"));
+        const auto strlines = split(m_trace->summary(), _T("\n"));
+        for (auto& str : strlines) {
+            if (str.length() > 0) {
+                PrintMes(RGY_LOG_INFO, _T("%s\n"), str.c_str());
+            }
+        }
+        if (auto sts = m_trace->write(); sts != RGY_ERR_NONE) {
+            PrintMes(RGY_LOG_WARN, _T("Failed to write task trace to %s: %s.\n"), m_trace->filename().c_str(), get_err_mes(sts));
+        } else {
+            PrintMes(RGY_LOG_DEBUG, _T("Wrote task trace to %s.\n"), m_trace->filename().c_str());
+        }
+    }
     PrintMes(RGY_LOG_DEBUG, _T("Write results...\n"));
     m_pStatus->WriteResults();
     if (m_videoQualityMetric) {
@@ -5139,8 +5290,6 @@ NVENCSTATUS NVEncCore::Encode() {
     if (m_pPerfMonitor) {
         HANDLE thOutput = NULL;
         HANDLE thInput = NULL;
-        HANDLE thAudProc = NULL;
-        HANDLE thAudEnc = NULL;
         auto pAVCodecReader = std::dynamic_pointer_cast<RGYInputAvcodec>(m_pFileReader);
         if (pAVCodecReader != nullptr) {
             thInput = pAVCodecReader->getThreadHandleInput();
@@ -5148,10 +5297,8 @@ NVENCSTATUS NVEncCore::Encode() {
         auto pAVCodecWriter = std::dynamic_pointer_cast<RGYOutputAvcodec>(m_pFileWriter);
         if (pAVCodecWriter != nullptr) {
             thOutput = pAVCodecWriter->getThreadHandleOutput();
-            thAudProc = pAVCodecWriter->getThreadHandleAudProcess();
-            thAudEnc = pAVCodecWriter->getThreadHandleAudEncode();
         }
-        m_pPerfMonitor->SetThreadHandles((HANDLE)(th_input.native_handle()), thInput, thOutput, thAudProc, thAudEnc);
+        m_pPerfMonitor->SetThreadHandles((HANDLE)(th_input.native_handle()), thInput, thOutput);
     }
     int64_t nOutFirstPts = AV_NOPTS_VALUE; //入力のptsに対する補正 (スケール: m_outputTimebase)
 #endif //#if ENABLE_AVSW_READER
@@ -29,6 +29,7 @@
 #pragma once
 
 #include "NVEncPipeline.h"
+#include "rgy_pipeline_executor.h"
 #include "NVEncFilterSsim.h"
 #include "rgy_device_usage.h"
 
@@ -146,6 +147,9 @@ protected:
 
     RGY_ERR allocatePiplelineFrames(const InEncodeVideoParam *prm);
 
+    //パイプラインの各段を別スレッドで実行する準備
+    RGY_ERR initPipelineExecutor(const InEncodeVideoParam *prm);
+
     //入出力用バッファを確保
     RGY_ERR AllocateBufferInputHost(const VideoInfo *pInputInfo);
     RGY_ERR AllocateBufferEncoder(const uint32_t uInputWidth, const uint32_t uInputHeight, const NV_ENC_BUFFER_FORMAT inputFormat, const bool alphaChannel);
@@ -233,6 +237,7 @@ protected:
 
     int                          m_nProcSpeedLimit;       //処理速度制限 (0で制限なし)
     bool                         m_taskPerfMonitor;       //タスクパフォーマンスモニタリングを有効にする
+    std::unique_ptr<RGYTrace>    m_trace;                 //タスク・入出力スレッドの処理区間を記録する (--task-trace)
     RGYAVSync                    m_nAVSyncMode;           //映像音声同期設定
     bool                         m_timestampPassThrough;  //timestampをそのまま転送する
     rgy_rational<int>            m_inputFps;              //入力フレームレート
@@ -240,6 +245,7 @@ protected:
     rgy_rational<int>            m_encFps;                //エンコードのフレームレート
 
     std::vector<std::unique_ptr<PipelineTask>> m_pipelineTasks;
+    std::unique_ptr<RGYPipelineExecutor<PipelineTask, PipelineTaskOutput>> m_pipelineExecutor; //パイプラインの各段を別スレッドで実行する (--thread-pipeline)
 
     int                          m_encodeBufferCount;                 //入力バッファ数 (16以上、MAX_ENCODE_QUEUE以下)
     CNvQueue<EncodeBuffer>       m_EncodeBufferQueue;                 //エンコーダへのフレーム投入キュー
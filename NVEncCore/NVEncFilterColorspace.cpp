@@ -314,6 +314,9 @@ public:
     virtual ~ColorspaceOpNone() {};
     virtual std::string print() { return ""; }
     virtual bool add(const ColorspaceOp* op) { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override {
+        UNREFERENCED_PARAMETER(blk); UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    }
 protected:
 };
 
@@ -327,6 +330,7 @@ public:
     }
     virtual std::string print();
     virtual bool add(const ColorspaceOp *op);
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     mat3x3 m;
 };
@@ -338,6 +342,7 @@ public:
     virtual ~ColorspaceOpGammaFunc() {};
     virtual std::string print();
     virtual bool add(const ColorspaceOp *op) { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     TransferFunc func;
 };
@@ -349,6 +354,7 @@ public:
     virtual ~ColorspaceOpInvGammaFunc() {};
     virtual std::string print();
     virtual bool add(const ColorspaceOp *op) { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     TransferFunc func;
 };
@@ -360,6 +366,7 @@ public:
     virtual ~ColorspaceOpAribB67() {};
     virtual std::string print();
     virtual bool add(const ColorspaceOp *op) { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     double m_kr, m_kg, m_kb, m_scale;
 };
@@ -371,6 +378,7 @@ public:
     virtual ~ColorspaceOpInvAribB67() {};
     virtual std::string print();
     virtual bool add(const ColorspaceOp *op) { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     double m_kr, m_kg, m_kb, m_scale;
 };
@@ -388,6 +396,7 @@ public:
     virtual ~ColorspaceOpCL2RGB() {};
     virtual std::string print();
     virtual bool add(const ColorspaceOp *op) { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     double m_kr, m_kg, m_kb, m_scale;
     float m_nb, m_pb, m_nr, m_pr;
@@ -407,6 +416,7 @@ public:
     virtual ~ColorspaceOpCL2YUV() {};
     virtual std::string print();
     virtual bool add(const ColorspaceOp *op) { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     double m_kr, m_kg, m_kb, m_scale;
     float m_nb, m_pb, m_nr, m_pr;
@@ -432,6 +442,8 @@ public:
     virtual ~ColorspaceOpHDR2SDR() {};
     virtual std::string printDesat(double desat_scale);
     virtual std::string printDesatInfo();
+    // printDesatと同じ処理
+    float3 desat(float3 x, float3 y, float desat_scale) const;
     virtual bool add(const ColorspaceOp *op) override { UNREFERENCED_PARAMETER(op); return false; }
     double source_peak() const { return m_source_peak; }
     double ldr_nits() const { return m_ldr_nits; }
@@ -464,6 +476,7 @@ public:
     virtual std::string print() override;
     virtual std::string printInfo() override;
     virtual bool add(const ColorspaceOp *op) override { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     double m_A, m_B, m_C, m_D, m_E, m_F;
 };
@@ -484,6 +497,7 @@ public:
     virtual std::string print() override;
     virtual std::string printInfo() override;
     virtual bool add(const ColorspaceOp *op) override { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     double m_transition, m_peak;
 };
@@ -504,6 +518,7 @@ public:
     virtual std::string print() override;
     virtual std::string printInfo() override;
     virtual bool add(const ColorspaceOp *op) override { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     double m_contrast, m_peak;
 };
@@ -520,6 +535,7 @@ public:
     virtual std::string print() override;
     virtual std::string printInfo() override;
     virtual bool add(const ColorspaceOp *op) override { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
 };
 
@@ -557,6 +573,7 @@ public:
     virtual ~ColorspaceOpRange() {};
     virtual std::string print();
     virtual bool add(const ColorspaceOp *op) { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
 protected:
     double m_scale_y, m_offset_y;
     double m_scale_uv, m_offset_uv;
@@ -584,6 +601,7 @@ public:
     virtual std::string print() override;
     virtual std::string printInfo() override;
     virtual bool add(const ColorspaceOp *op) { UNREFERENCED_PARAMETER(op); return false; }
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) override;
     virtual RGY_ERR init(std::vector<uint8_t>& devParams);
 protected:
     void setAdditionalParams(std::vector<uint8_t>& additionalParams, const std::vector<LUTVEC>& luttable);
@@ -634,7 +652,7 @@ std::string ColorspaceOpLUT3D::print() {
         x = lut3d_interp_%s(x, getDevParamsLut(params), lutSize0, lutSize01);
     })",
         m_tableSize0, m_tableSize01,
-        scale_to_table((int)LUT3DIDX::r), scale_to_table((int)LUT3DIDX::b), scale_to_table((int)LUT3DIDX::b),
+        scale_to_table((int)LUT3DIDX::r), scale_to_table((int)LUT3DIDX::g), scale_to_table((int)LUT3DIDX::b),
         tchar_to_string(get_cx_desc(list_vpp_colorspace_lut3d_interp, (int)m_interp)).c_str());
     return str;
 }
@@ -1032,6 +1050,229 @@ std::string ColorspaceOpRange::print() {
         m_scale_uv, m_offset_uv);
 }
 
+// 以下、print()で生成するGPUのコードと同じ処理をCPUで行うもの
+// 定数はGPUのコードと同じくfloatに変換してから使用する
+
+// 各画素をfloat3として処理する
+template<typename Func>
+static void colorspace_cpu_for_each(ColorspaceCPUBlock *blk, Func func) {
+    for (int i = 0; i < blk->n; i++) {
+        const float3 x = func(make_float3(blk->x[i], blk->y[i], blk->z[i]));
+        blk->x[i] = x.x;
+        blk->y[i] = x.y;
+        blk->z[i] = x.z;
+    }
+}
+
+// 各成分に同じ関数を適用する
+static void colorspace_cpu_for_each_value(ColorspaceCPUBlock *blk, gamma_func func, const float pre_scaler, const float post_scaler) {
+    for (int i = 0; i < blk->n; i++) {
+        blk->x[i] = post_scaler * func(blk->x[i] * pre_scaler);
+        blk->y[i] = post_scaler * func(blk->y[i] * pre_scaler);
+        blk->z[i] = post_scaler * func(blk->z[i] * pre_scaler);
+    }
+}
+
+void ColorspaceOpMatrix::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(params);
+    float mf[3][3];
+    for (int j = 0; j < 3; j++) {
+        for (int i = 0; i < 3; i++) {
+            mf[j][i] = (float)m(j, i);
+        }
+    }
+    funcs->matrix(blk, mf);
+}
+
+void ColorspaceOpGammaFunc::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    colorspace_cpu_for_each_value(blk, func.to_gamma, (float)func.to_gamma_scale, 1.0f);
+}
+
+void ColorspaceOpInvGammaFunc::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    colorspace_cpu_for_each_value(blk, func.to_linear, 1.0f, (float)func.to_linear_scale);
+}
+
+void ColorspaceOpAribB67::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    const float kr = (float)m_kr, kg = (float)m_kg, kb = (float)m_kb, scale = (float)m_scale;
+    colorspace_cpu_for_each(blk, [=](float3 x) { return aribB67Ops(x, kr, kg, kb, scale); });
+}
+
+void ColorspaceOpInvAribB67::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    const float kr = (float)m_kr, kg = (float)m_kg, kb = (float)m_kb, scale = (float)m_scale;
+    colorspace_cpu_for_each(blk, [=](float3 x) { return aribB67InvOps(x, kr, kg, kb, scale); });
+}
+
+void ColorspaceOpCL2RGB::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    const float nb = m_nb, pb = m_pb, nr = m_nr, pr = m_pr;
+    const float kr = (float)m_kr, kb = (float)m_kb, kg = (float)m_kg;
+    const float scale = (float)m_scale;
+    const gamma_func to_linear = m_func.to_linear;
+    colorspace_cpu_for_each(blk, [=](float3 x) {
+        float y = x.x;
+        const float u = x.y;
+        const float v = x.z;
+
+        const float b_minus_y = u * 2.0f * ((u < 0) ? nb : pb);
+        const float r_minus_y = v * 2.0f * ((v < 0) ? nr : pr);
+
+        const float b = to_linear(b_minus_y + y);
+        const float r = to_linear(r_minus_y + y);
+
+        y = to_linear(y);
+        const float g = (y - kr * r - kb * b) / kg;
+        return make_float3(r * scale, g * scale, b * scale);
+    });
+}
+
+void ColorspaceOpCL2YUV::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    const float nb = m_nb, pb = m_pb, nr = m_nr, pr = m_pr;
+    const float kr = (float)m_kr, kb = (float)m_kb, kg = (float)m_kg;
+    const float scale = (float)m_scale;
+    const gamma_func to_gamma = m_func.to_gamma;
+    colorspace_cpu_for_each(blk, [=](float3 x) {
+        float r = x.x * scale;
+        const float g = x.y * scale;
+        float b = x.z * scale;
+
+        const float y = to_gamma(kr * r + kg * g + kb * b);
+        b = to_gamma(b);
+        r = to_gamma(r);
+
+        const float u = (b - y) / (2.0f * ((b - y < 0.0f) ? nb : pb));
+        const float v = (r - y) / (2.0f * ((r - y < 0.0f) ? nr : pr));
+        return make_float3(y, u, v);
+    });
+}
+
+float3 ColorspaceOpHDR2SDR::desat(float3 x, float3 y, float desat_scale) const {
+    const float in_max  = fmaxf( fmaxf(x.x, x.y), fmaxf(x.z, 1e-6f) );
+    const float out_max = fmaxf( fmaxf(y.x, y.y), fmaxf(y.z, 1e-6f) );
+    const float mul = out_max / in_max;
+
+    const float desat_base = (float)m_desat_base;
+    const float desat_strength = (float)m_desat_strength;
+    const float desat_exp = (float)m_desat_exp;
+    const float coeff = fmaxf(out_max * desat_scale - desat_base, 1e-6f) / fmaxf(out_max * desat_scale, 1.0f);
+    const float mixcoeff = desat_strength * powf(coeff, desat_exp);
+    x.x = mix(x.x * mul, y.x, mixcoeff);
+    x.y = mix(x.y * mul, y.y, mixcoeff);
+    x.z = mix(x.z * mul, y.z, mixcoeff);
+    return x;
+}
+
+void ColorspaceOpHDR2SDRHable::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    const float source_peak = (float)m_source_peak, ldr_nits = (float)m_ldr_nits;
+    const float A = (float)m_A, B = (float)m_B, C = (float)m_C, D = (float)m_D, E = (float)m_E, F = (float)m_F;
+    colorspace_cpu_for_each(blk, [&](float3 x) {
+        float3 y;
+        y.x = hdr2sdr_hable( x.x, source_peak, ldr_nits, A, B, C, D, E, F );
+        y.y = hdr2sdr_hable( x.y, source_peak, ldr_nits, A, B, C, D, E, F );
+        y.z = hdr2sdr_hable( x.z, source_peak, ldr_nits, A, B, C, D, E, F );
+        return desat(x, y, 1.0f);
+    });
+}
+
+void ColorspaceOpHDR2SDRMobius::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    const float source_peak = (float)m_source_peak, ldr_nits = (float)m_ldr_nits;
+    const float transition = (float)m_transition, peak = (float)m_peak;
+    colorspace_cpu_for_each(blk, [&](float3 x) {
+        float3 y;
+        y.x = hdr2sdr_mobius( x.x, source_peak, ldr_nits, transition, peak );
+        y.y = hdr2sdr_mobius( x.y, source_peak, ldr_nits, transition, peak );
+        y.z = hdr2sdr_mobius( x.z, source_peak, ldr_nits, transition, peak );
+        return desat(x, y, 1.0f);
+    });
+}
+
+void ColorspaceOpHDR2SDRReinhard::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    const float source_peak = (float)m_source_peak, ldr_nits = (float)m_ldr_nits;
+    const float contrast = (float)m_contrast, peak = (float)m_peak;
+    const float offset = (1.0f - contrast) / contrast;
+    colorspace_cpu_for_each(blk, [&](float3 x) {
+        float3 y;
+        y.x = hdr2sdr_reinhard( x.x, source_peak, ldr_nits, offset, peak );
+        y.y = hdr2sdr_reinhard( x.y, source_peak, ldr_nits, offset, peak );
+        y.z = hdr2sdr_reinhard( x.z, source_peak, ldr_nits, offset, peak );
+        return desat(x, y, 1.0f);
+    });
+}
+
+void ColorspaceOpHDR2SDRBT2390::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs); UNREFERENCED_PARAMETER(params);
+    const float sig_peak = (float)m_source_peak;
+    const float dst_peak = (float)m_ldr_nits;
+    const float inv_dst_peak = 1.0f / dst_peak;
+    const float sig_peak_pq = linear_to_pq_space(sig_peak);
+    const float scale = (float)(1.0 / sig_peak_pq);
+    const float maxLum = linear_to_pq_space(dst_peak) * scale;
+    const float desat_scale = (float)(1.0 / m_ldr_nits);
+    colorspace_cpu_for_each(blk, [&](float3 x) {
+        // use non-normalized value
+        x.x *= dst_peak;
+        x.y *= dst_peak;
+        x.z *= dst_peak;
+
+        float3 y;
+        y.x = pq_space_to_linear(apply_bt2390(linear_to_pq_space(x.x) * scale, maxLum) * sig_peak_pq);
+        y.y = pq_space_to_linear(apply_bt2390(linear_to_pq_space(x.y) * scale, maxLum) * sig_peak_pq);
+        y.z = pq_space_to_linear(apply_bt2390(linear_to_pq_space(x.z) * scale, maxLum) * sig_peak_pq);
+        x = desat(x, y, desat_scale);
+
+        // back to normalized value
+        x.x *= inv_dst_peak;
+        x.y *= inv_dst_peak;
+        x.z *= inv_dst_peak;
+        return x;
+    });
+}
+
+void ColorspaceOpRange::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(params);
+    const float scale[3]  = { (float)m_scale_y,  (float)m_scale_uv,  (float)m_scale_uv };
+    const float offset[3] = { (float)m_offset_y, (float)m_offset_uv, (float)m_offset_uv };
+    funcs->affine(blk, scale, offset);
+}
+
+void ColorspaceOpLUT3D::run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) {
+    UNREFERENCED_PARAMETER(funcs);
+    const vec3f scale_to_table = m_rgbscale * (float)(m_tableSize0 - 1);
+    const float prelutmin[3]   = { m_preLUT.min(0),   m_preLUT.min(1),   m_preLUT.min(2) };
+    const float prelutscale[3] = { m_preLUT.scale(0), m_preLUT.scale(1), m_preLUT.scale(2) };
+    const float scale[3] = { scale_to_table((int)LUT3DIDX::r), scale_to_table((int)LUT3DIDX::g), scale_to_table((int)LUT3DIDX::b) };
+    const int lutSize0  = m_tableSize0;
+    const int lutSize01 = m_tableSize01;
+    const float lut_max_idx = (float)(lutSize0 - 1) + 1e-6f;
+    const float *prelut = (m_preLUT.size > 0) ? getDevParamsPrelut(params) : nullptr;
+    const LUTVEC *lut = getDevParamsLut(params);
+    decltype(lut3d_interp_nearest) *interp = nullptr;
+    switch (m_interp) {
+    case LUT3DInterp::Trilinear:   interp = lut3d_interp_trilinear; break;
+    case LUT3DInterp::Tetrahedral: interp = lut3d_interp_tetrahedral; break;
+    case LUT3DInterp::Pyramid:     interp = lut3d_interp_pyramid; break;
+    case LUT3DInterp::Prism:       interp = lut3d_interp_prism; break;
+    case LUT3DInterp::Nearest:
+    default:                       interp = lut3d_interp_nearest; break;
+    }
+    colorspace_cpu_for_each(blk, [&](float3 x) {
+        if (prelut) {
+            x = lut3d_prelut(x, m_preLUT.size, prelutmin, prelutscale, prelut);
+        }
+        x.x = clamp(x.x * scale[0], 0.0f, lut_max_idx);
+        x.y = clamp(x.y * scale[1], 0.0f, lut_max_idx);
+        x.z = clamp(x.z * scale[2], 0.0f, lut_max_idx);
+        return interp(x, lut, lutSize0, lutSize01);
+    });
+}
+
 void ColorspaceOpCtrl::addOperation(ColorspaceOpInfo& op) {
     if (operations.size() == 0
         || !operations.back().ops->add(op.ops.get())) {
@@ -1049,6 +1290,58 @@ std::string ColorspaceOpCtrl::printOpAll() const {
     return str;
 }
 
+RGY_ERR ColorspaceOpCtrl::runCPU(RGYFrameInfo *pOutputFrame, const RGYFrameInfo *pInputFrame, const std::vector<uint8_t>& additionalParams, RGY_SIMD simd) const {
+    if (pOutputFrame->mem_type != RGY_MEM_TYPE_CPU || pInputFrame->mem_type != RGY_MEM_TYPE_CPU) {
+        return RGY_ERR_UNSUPPORTED;
+    }
+    for (const RGYFrameInfo *frame : { (const RGYFrameInfo *)pOutputFrame, pInputFrame }) {
+        if (RGY_CSP_PLANES[frame->csp] != 3
+            || (RGY_CSP_CHROMA_FORMAT[frame->csp] != RGY_CHROMAFMT_YUV444 && RGY_CSP_CHROMA_FORMAT[frame->csp] != RGY_CHROMAFMT_RGB)) {
+            return RGY_ERR_UNSUPPORTED;
+        }
+        const auto type = RGY_CSP_DATA_TYPE[frame->csp];
+        if (type != RGY_DATA_TYPE_U8 && type != RGY_DATA_TYPE_U16 && type != RGY_DATA_TYPE_FP32) {
+            return RGY_ERR_UNSUPPORTED;
+        }
+    }
+    if (pOutputFrame->width != pInputFrame->width || pOutputFrame->height != pInputFrame->height) {
+        return RGY_ERR_INVALID_PARAM;
+    }
+    const auto funcs = get_colorspace_cpu_funcs(simd);
+    const void *params = (additionalParams.size() > 0) ? additionalParams.data() : nullptr;
+    const auto typeIn  = RGY_CSP_DATA_TYPE[pInputFrame->csp];
+    const auto typeOut = RGY_CSP_DATA_TYPE[pOutputFrame->csp];
+    const int pixSizeIn  = bytesPerPix(pInputFrame->csp);
+    const int pixSizeOut = bytesPerPix(pOutputFrame->csp);
+    const RGYFrameInfo planeInX  = getPlane(pInputFrame,  RGY_PLANE_Y);
+    const RGYFrameInfo planeInY  = getPlane(pInputFrame,  RGY_PLANE_U);
+    const RGYFrameInfo planeInZ  = getPlane(pInputFrame,  RGY_PLANE_V);
+    const RGYFrameInfo planeOutX = getPlane(pOutputFrame, RGY_PLANE_Y);
+    const RGYFrameInfo planeOutY = getPlane(pOutputFrame, RGY_PLANE_U);
+    const RGYFrameInfo planeOutZ = getPlane(pOutputFrame, RGY_PLANE_V);
+
+    auto blk = make_unique<ColorspaceCPUBlock>();
+    for (int iy = 0; iy < pInputFrame->height; iy++) {
+        for (int ix = 0; ix < pInputFrame->width; ix += COLORSPACE_CPU_BLOCK_SIZE) {
+            const int n = std::min(COLORSPACE_CPU_BLOCK_SIZE, pInputFrame->width - ix);
+            funcs->load(blk.get(),
+                planeInX.ptr[0] + iy * planeInX.pitch[0] + ix * pixSizeIn,
+                planeInY.ptr[0] + iy * planeInY.pitch[0] + ix * pixSizeIn,
+                planeInZ.ptr[0] + iy * planeInZ.pitch[0] + ix * pixSizeIn,
+                typeIn, n);
+            for (const auto &op : operations) {
+                op.ops->run(blk.get(), funcs, params);
+            }
+            funcs->store(
+                planeOutX.ptr[0] + iy * planeOutX.pitch[0] + ix * pixSizeOut,
+                planeOutY.ptr[0] + iy * planeOutY.pitch[0] + ix * pixSizeOut,
+                planeOutZ.ptr[0] + iy * planeOutZ.pitch[0] + ix * pixSizeOut,
+                typeOut, blk.get());
+        }
+    }
+    return RGY_ERR_NONE;
+}
+
 tstring ColorspaceOpCtrl::printInfoAll() const {
     tstring str;
     for (const auto &op : operations) {
@@ -1645,7 +1938,10 @@ __global__ void kernel_filter(
 };
 )";
 
-NVEncFilterColorspace::NVEncFilterColorspace() : crop(), opCtrl(), custom(), additionalParams(), additionalParamsDev() {
+static const int COLORSPACE_CPU_CHECK_FRAMES = 3;
+
+NVEncFilterColorspace::NVEncFilterColorspace() : crop(), opCtrl(), custom(), additionalParams(), additionalParamsDev(),
+    m_cpuCheckIn(), m_cpuCheckOutGPU(), m_cpuCheckOutCPU(), m_cpuCheckFrames(0) {
     m_name = _T("colorspace");
 }
 
@@ -1890,6 +2186,7 @@ RGY_ERR NVEncFilterColorspace::init(shared_ptr<NVEncFilterParam> pParam, shared_
     }
     filterInfo += opCtrl->printInfoAll();
     setFilterInfo(filterInfo);
+    m_cpuCheckFrames = (m_pLog && m_pLog->getLogLevel(RGY_LOGT_VPP) <= RGY_LOG_DEBUG) ? COLORSPACE_CPU_CHECK_FRAMES : 0;
     m_param = pParam;
     return sts;
 #endif
@@ -1939,6 +2236,12 @@ RGY_ERR NVEncFilterColorspace::run_filter(const RGYFrameInfo *pInputFrame, RGYFr
         AddMessage(RGY_LOG_ERROR, _T("Error while running filter \"%s\".\n"), custom->name().c_str());
         return sts_filter;
     }
+    if (m_cpuCheckFrames > 0) {
+        m_cpuCheckFrames--;
+        if ((sts = checkCPU(&filterInput, ppOutputFrames[0], stream)) != RGY_ERR_NONE) {
+            return sts;
+        }
+    }
     for (int i = 0; i < RGY_CSP_PLANES[ppOutputFrames[0]->csp]; i++) {
         if (ppOutputFrames[0]->pitch[0] % 4 != 0) { // あとからでもチェックしておく
             AddMessage(RGY_LOG_ERROR, _T("Invalid pitch!\n"));
@@ -1951,7 +2254,78 @@ RGY_ERR NVEncFilterColorspace::run_filter(const RGYFrameInfo *pInputFrame, RGYFr
 #endif
 }
 
+template<typename T>
+static void colorspace_cpu_check_plane(double& maxDiff, int64_t& diffCount, const RGYFrameInfo *planeA, const RGYFrameInfo *planeB) {
+    for (int y = 0; y < planeA->height; y++) {
+        const T *ptrA = (const T *)(planeA->ptr[0] + y * planeA->pitch[0]);
+        const T *ptrB = (const T *)(planeB->ptr[0] + y * planeB->pitch[0]);
+        for (int x = 0; x < planeA->width; x++) {
+            if (ptrA[x] != ptrB[x]) {
+                maxDiff = std::max(maxDiff, std::abs((double)ptrA[x] - (double)ptrB[x]));
+                diffCount++;
+            }
+        }
+    }
+}
+
+RGY_ERR NVEncFilterColorspace::checkCPU(const RGYFrameInfo *pInputFrame, const RGYFrameInfo *pOutputFrame, cudaStream_t stream) {
+    auto allocHostFrame = [](std::unique_ptr<CUFrameBuf>& buf, const RGYFrameInfo *ref) {
+        if (!buf || cmpFrameInfoCspResolution(&buf->frame, ref)) {
+            buf = std::make_unique<CUFrameBuf>(ref->width, ref->height, ref->csp);
+            return buf->allocHost();
+        }
+        return RGY_ERR_NONE;
+    };
+    RGY_ERR sts = RGY_ERR_NONE;
+    if ((sts = allocHostFrame(m_cpuCheckIn, pInputFrame)) != RGY_ERR_NONE
+        || (sts = allocHostFrame(m_cpuCheckOutGPU, pOutputFrame)) != RGY_ERR_NONE
+        || (sts = allocHostFrame(m_cpuCheckOutCPU, pOutputFrame)) != RGY_ERR_NONE) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to allocate host buffer for cpu check: %s.\n"), get_err_mes(sts));
+        return sts;
+    }
+    if ((sts = copyFrameAsync(&m_cpuCheckIn->frame, pInputFrame, stream)) != RGY_ERR_NONE
+        || (sts = copyFrameAsync(&m_cpuCheckOutGPU->frame, pOutputFrame, stream)) != RGY_ERR_NONE
+        || (sts = err_to_rgy(cudaStreamSynchronize(stream))) != RGY_ERR_NONE) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to copy frame for cpu check: %s.\n"), get_err_mes(sts));
+        return sts;
+    }
+    sts = opCtrl->runCPU(&m_cpuCheckOutCPU->frame, &m_cpuCheckIn->frame, additionalParams, get_availableSIMD());
+    if (sts == RGY_ERR_UNSUPPORTED) {
+        AddMessage(RGY_LOG_DEBUG, _T("cpu check skipped: unsupported csp %s -> %s.\n"),
+            RGY_CSP_NAMES[pInputFrame->csp], RGY_CSP_NAMES[pOutputFrame->csp]);
+        m_cpuCheckFrames = 0;
+        return RGY_ERR_NONE;
+    } else if (sts != RGY_ERR_NONE) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to run cpu check: %s.\n"), get_err_mes(sts));
+        return sts;
+    }
+    double maxDiff = 0.0;
+    int64_t diffCount = 0;
+    for (const auto plane : { RGY_PLANE_Y, RGY_PLANE_U, RGY_PLANE_V }) {
+        const auto planeGPU = getPlane(&m_cpuCheckOutGPU->frame, plane);
+        const auto planeCPU = getPlane(&m_cpuCheckOutCPU->frame, plane);
+        switch (RGY_CSP_DATA_TYPE[pOutputFrame->csp]) {
+        case RGY_DATA_TYPE_U8:   colorspace_cpu_check_plane<uint8_t>(maxDiff, diffCount, &planeGPU, &planeCPU); break;
+        case RGY_DATA_TYPE_U16:  colorspace_cpu_check_plane<uint16_t>(maxDiff, diffCount, &planeGPU, &planeCPU); break;
+        case RGY_DATA_TYPE_FP32: colorspace_cpu_check_plane<float>(maxDiff, diffCount, &planeGPU, &planeCPU); break;
+        default: break;
+        }
+    }
+    if (diffCount == 0) {
+        AddMessage(RGY_LOG_DEBUG, _T("cpu check: bit-exact with cuda output.\n"));
+    } else {
+        // GPU側は--use_fast_mathでビルドしているので、整数出力で1以下の差は許容する
+        const bool isInt = RGY_CSP_DATA_TYPE[pOutputFrame->csp] != RGY_DATA_TYPE_FP32;
+        AddMessage((isInt && maxDiff > 1.0) ? RGY_LOG_WARN : RGY_LOG_DEBUG,
+            _T("cpu check: %lld pixels differ from cuda output, max diff %.6f.\n"), (long long)diffCount, maxDiff);
+    }
+    return RGY_ERR_NONE;
+}
+
 void NVEncFilterColorspace::close() {
+    m_cpuCheckIn.reset();
+    m_cpuCheckOutGPU.reset();
+    m_cpuCheckOutCPU.reset();
     custom.reset();
     opCtrl.reset();
     crop.reset();
@@ -31,6 +31,7 @@
 #include <array>
 #include "NVEncFilter.h"
 #include "NVEncFilterCustom.h"
+#include "NVEncFilterColorspaceCPU.h"
 #include "rgy_prm.h"
 
 enum ColorspaceOpType {
@@ -52,6 +53,8 @@ public:
     virtual std::string print() = 0;
     virtual std::string printInfo() { return ""; }
     virtual bool add(const ColorspaceOp *op) = 0;
+    // print()で生成するGPUのコードと同じ処理をCPUで行う (paramsはRGYColorspaceDevParams)
+    virtual void run(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs, const void *params) = 0;
 protected:
     ColorspaceOpType m_type;
 };
@@ -79,6 +82,9 @@ public:
     RGY_ERR setPath(const VideoVUIInfo &in, const VideoVUIInfo &out, double source_peak, bool approx_gamma, bool scene_ref, int height);
     RGY_ERR setOperation(RGY_CSP csp_in, RGY_CSP csp_out);
     std::string printOpAll() const;
+    // 設定した処理をCPUで行う (ホストメモリ上のYUV444/RGBのフレームのみ)
+    // additionalParamsにはsetLUT3Dに渡したものを渡す
+    RGY_ERR runCPU(RGYFrameInfo *pOutputFrame, const RGYFrameInfo *pInputFrame, const std::vector<uint8_t>& additionalParams, RGY_SIMD simd) const;
     tstring printInfoAll() const;
     VideoVUIInfo VuiOut() const;
 private:
@@ -150,10 +156,16 @@ protected:
     virtual RGY_ERR run_filter(const RGYFrameInfo *pInputFrame, RGYFrameInfo **ppOutputFrames, int *pOutputFrameNum, cudaStream_t stream) override;
     virtual void close() override;
     RGY_ERR check_param(shared_ptr<NVEncFilterParamColorspace> prm);
+    // CUDAの出力をColorspaceOpCtrl::runCPU()の結果と比較する (デバッグログ時のみ)
+    RGY_ERR checkCPU(const RGYFrameInfo *pInputFrame, const RGYFrameInfo *pOutputFrame, cudaStream_t stream);
 
     unique_ptr<NVEncFilterCspCrop> crop;
     unique_ptr<ColorspaceOpCtrl> opCtrl;
     unique_ptr<NVEncFilterCustom> custom;
     std::vector<uint8_t> additionalParams;
     std::unique_ptr<CUMemBuf> additionalParamsDev;
+    std::unique_ptr<CUFrameBuf> m_cpuCheckIn;
+    std::unique_ptr<CUFrameBuf> m_cpuCheckOutGPU;
+    std::unique_ptr<CUFrameBuf> m_cpuCheckOutCPU;
+    int m_cpuCheckFrames; // 残りの比較フレーム数
 };
@@ -0,0 +1,148 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#include <cstring>
+#include "rgy_util.h"
+#include "NVEncFilterColorspaceCPU.h"
+
+// GCCは-march等でFMAが使用可能だと乗算と加算をFMAにまとめ、SIMD版と結果が変わるので抑止する
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+template<typename T>
+static void colorspace_cpu_load_plane_c(float *dst, const void *src, int n) {
+    const T *ptr = (const T *)src;
+    for (int i = 0; i < n; i++) {
+        dst[i] = (float)ptr[i];
+    }
+}
+
+template<typename T>
+static void colorspace_cpu_store_plane_c(void *dst, const float *src, int n) {
+    T *ptr = (T *)dst;
+    const float high = (float)(1 << (sizeof(T) * 8)) - 0.5f;
+    for (int i = 0; i < n; i++) {
+        const float v = src[i] + 0.5f;
+        ptr[i] = (T)((v <= high) ? ((v >= 0.0f) ? v : 0.0f) : high); // NaNはhighになる (GPUのclampと同じ)
+    }
+}
+
+template<>
+void colorspace_cpu_store_plane_c<float>(void *dst, const float *src, int n) {
+    memcpy(dst, src, sizeof(float) * n);
+}
+
+void colorspace_cpu_load_c(ColorspaceCPUBlock *blk, const void *srcX, const void *srcY, const void *srcZ, RGY_DATA_TYPE type, int n) {
+    blk->n = n;
+    switch (type) {
+    case RGY_DATA_TYPE_U8:
+        colorspace_cpu_load_plane_c<uint8_t>(blk->x, srcX, n);
+        colorspace_cpu_load_plane_c<uint8_t>(blk->y, srcY, n);
+        colorspace_cpu_load_plane_c<uint8_t>(blk->z, srcZ, n);
+        break;
+    case RGY_DATA_TYPE_U16:
+        colorspace_cpu_load_plane_c<uint16_t>(blk->x, srcX, n);
+        colorspace_cpu_load_plane_c<uint16_t>(blk->y, srcY, n);
+        colorspace_cpu_load_plane_c<uint16_t>(blk->z, srcZ, n);
+        break;
+    case RGY_DATA_TYPE_FP32:
+        colorspace_cpu_load_plane_c<float>(blk->x, srcX, n);
+        colorspace_cpu_load_plane_c<float>(blk->y, srcY, n);
+        colorspace_cpu_load_plane_c<float>(blk->z, srcZ, n);
+        break;
+    default:
+        memset(blk->x, 0, sizeof(blk->x));
+        memset(blk->y, 0, sizeof(blk->y));
+        memset(blk->z, 0, sizeof(blk->z));
+        break;
+    }
+}
+
+void colorspace_cpu_store_c(void *dstX, void *dstY, void *dstZ, RGY_DATA_TYPE type, const ColorspaceCPUBlock *blk) {
+    switch (type) {
+    case RGY_DATA_TYPE_U8:
+        colorspace_cpu_store_plane_c<uint8_t>(dstX, blk->x, blk->n);
+        colorspace_cpu_store_plane_c<uint8_t>(dstY, blk->y, blk->n);
+        colorspace_cpu_store_plane_c<uint8_t>(dstZ, blk->z, blk->n);
+        break;
+    case RGY_DATA_TYPE_U16:
+        colorspace_cpu_store_plane_c<uint16_t>(dstX, blk->x, blk->n);
+        colorspace_cpu_store_plane_c<uint16_t>(dstY, blk->y, blk->n);
+        colorspace_cpu_store_plane_c<uint16_t>(dstZ, blk->z, blk->n);
+        break;
+    case RGY_DATA_TYPE_FP32:
+        colorspace_cpu_store_plane_c<float>(dstX, blk->x, blk->n);
+        colorspace_cpu_store_plane_c<float>(dstY, blk->y, blk->n);
+        colorspace_cpu_store_plane_c<float>(dstZ, blk->z, blk->n);
+        break;
+    default:
+        break;
+    }
+}
+
+void colorspace_cpu_affine_c(ColorspaceCPUBlock *blk, const float scale[3], const float offset[3]) {
+    for (int i = 0; i < blk->n; i++) {
+        blk->x[i] = blk->x[i] * scale[0] + offset[0];
+        blk->y[i] = blk->y[i] * scale[1] + offset[1];
+        blk->z[i] = blk->z[i] * scale[2] + offset[2];
+    }
+}
+
+void colorspace_cpu_matrix_c(ColorspaceCPUBlock *blk, const float m[3][3]) {
+    for (int i = 0; i < blk->n; i++) {
+        const float x = blk->x[i];
+        const float y = blk->y[i];
+        const float z = blk->z[i];
+        blk->x[i] = m[0][0] * x + m[0][1] * y + m[0][2] * z;
+        blk->y[i] = m[1][0] * x + m[1][1] * y + m[1][2] * z;
+        blk->z[i] = m[2][0] * x + m[2][1] * y + m[2][2] * z;
+    }
+}
+
+const ColorspaceCPUFuncs *get_colorspace_cpu_funcs(RGY_SIMD simd) {
+    static const ColorspaceCPUFuncs funcs_c = {
+        colorspace_cpu_load_c, colorspace_cpu_store_c, colorspace_cpu_affine_c, colorspace_cpu_matrix_c
+    };
+#if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
+    static const ColorspaceCPUFuncs funcs_avx2 = {
+        colorspace_cpu_load_avx2, colorspace_cpu_store_avx2, colorspace_cpu_affine_avx2, colorspace_cpu_matrix_avx2
+    };
+    simd = simd & get_availableSIMD();
+#if defined(_M_X64) || defined(__x86_64)
+    static const ColorspaceCPUFuncs funcs_avx512bw = {
+        colorspace_cpu_load_avx512bw, colorspace_cpu_store_avx512bw, colorspace_cpu_affine_avx512bw, colorspace_cpu_matrix_avx512bw
+    };
+    if ((simd & RGY_SIMD::AVX512BW) == RGY_SIMD::AVX512BW) return &funcs_avx512bw;
+#endif
+    if ((simd & RGY_SIMD::AVX2) == RGY_SIMD::AVX2) return &funcs_avx2;
+#else
+    UNREFERENCED_PARAMETER(simd);
+#endif
+    return &funcs_c;
+}
@@ -0,0 +1,80 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#pragma once
+#ifndef __NVENC_FILTER_COLORSPACE_CPU_H__
+#define __NVENC_FILTER_COLORSPACE_CPU_H__
+
+#include <cstdint>
+#include "rgy_simd.h"
+#include "convert_csp.h"
+
+static const int COLORSPACE_CPU_BLOCK_SIZE = 256; // CPUでまとめて処理する画素数
+
+// CPUで色空間変換を行う際の画素の集まり
+// SIMDで処理しやすいよう、各画素の3成分をそれぞれ別の配列に格納する
+struct ColorspaceCPUBlock {
+    alignas(64) float x[COLORSPACE_CPU_BLOCK_SIZE]; // Y or R
+    alignas(64) float y[COLORSPACE_CPU_BLOCK_SIZE]; // U or G
+    alignas(64) float z[COLORSPACE_CPU_BLOCK_SIZE]; // V or B
+    int n; // 有効な画素数
+};
+
+// ColorspaceOpのうち、単純な演算をSIMDごとに実装したもの
+// 伝達関数やトーンマップなどはGPUと同じNVEncFilterColorspaceFunc.hの関数を画素ごとに呼ぶ
+// 乗算と加算をFMAにまとめないので、出力はfloatも含めてどの実装でも一致する
+struct ColorspaceCPUFuncs {
+    // 各プレーンからn画素を読み込んでfloatにする
+    void (*load)(ColorspaceCPUBlock *blk, const void *srcX, const void *srcY, const void *srcZ, RGY_DATA_TYPE type, int n);
+    // GPUのtoPix<T>と同じく、四捨五入して範囲内に収めて書き込む
+    void (*store)(void *dstX, void *dstY, void *dstZ, RGY_DATA_TYPE type, const ColorspaceCPUBlock *blk);
+    // x = x * scale + offset
+    void (*affine)(ColorspaceCPUBlock *blk, const float scale[3], const float offset[3]);
+    // x = m * x
+    void (*matrix)(ColorspaceCPUBlock *blk, const float m[3][3]);
+};
+
+void colorspace_cpu_load_c(ColorspaceCPUBlock *blk, const void *srcX, const void *srcY, const void *srcZ, RGY_DATA_TYPE type, int n);
+void colorspace_cpu_store_c(void *dstX, void *dstY, void *dstZ, RGY_DATA_TYPE type, const ColorspaceCPUBlock *blk);
+void colorspace_cpu_affine_c(ColorspaceCPUBlock *blk, const float scale[3], const float offset[3]);
+void colorspace_cpu_matrix_c(ColorspaceCPUBlock *blk, const float m[3][3]);
+
+void colorspace_cpu_load_avx2(ColorspaceCPUBlock *blk, const void *srcX, const void *srcY, const void *srcZ, RGY_DATA_TYPE type, int n);
+void colorspace_cpu_store_avx2(void *dstX, void *dstY, void *dstZ, RGY_DATA_TYPE type, const ColorspaceCPUBlock *blk);
+void colorspace_cpu_affine_avx2(ColorspaceCPUBlock *blk, const float scale[3], const float offset[3]);
+void colorspace_cpu_matrix_avx2(ColorspaceCPUBlock *blk, const float m[3][3]);
+
+void colorspace_cpu_load_avx512bw(ColorspaceCPUBlock *blk, const void *srcX, const void *srcY, const void *srcZ, RGY_DATA_TYPE type, int n);
+void colorspace_cpu_store_avx512bw(void *dstX, void *dstY, void *dstZ, RGY_DATA_TYPE type, const ColorspaceCPUBlock *blk);
+void colorspace_cpu_affine_avx512bw(ColorspaceCPUBlock *blk, const float scale[3], const float offset[3]);
+void colorspace_cpu_matrix_avx512bw(ColorspaceCPUBlock *blk, const float m[3][3]);
+
+// 使用可能なSIMDのうち、simdの範囲で最も速いものを返す
+const ColorspaceCPUFuncs *get_colorspace_cpu_funcs(RGY_SIMD simd);
+
+#endif //__NVENC_FILTER_COLORSPACE_CPU_H__
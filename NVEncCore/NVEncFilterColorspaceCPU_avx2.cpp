@@ -0,0 +1,188 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#include <cstring>
+#include "NVEncFilterColorspaceCPU.h"
+
+// GCCは-mfma等でFMAが使用可能だと乗算と加算をFMAにまとめ、C版と結果が変わるので抑止する
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
+#include <immintrin.h>
+
+#if _MSC_VER >= 1800 && !defined(__AVX__) && !defined(_DEBUG)
+static_assert(false, "do not forget to set /arch:AVX or /arch:AVX2 for this file.");
+#endif
+
+template<typename T>
+static void colorspace_cpu_load_plane_avx2(float *dst, const void *src, int n);
+
+template<>
+void colorspace_cpu_load_plane_avx2<uint8_t>(float *dst, const void *src, int n) {
+    const uint8_t *ptr = (const uint8_t *)src;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i y0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(ptr + i)));
+        _mm256_store_ps(dst + i, _mm256_cvtepi32_ps(y0));
+    }
+    for (; i < n; i++) {
+        dst[i] = (float)ptr[i];
+    }
+}
+
+template<>
+void colorspace_cpu_load_plane_avx2<uint16_t>(float *dst, const void *src, int n) {
+    const uint16_t *ptr = (const uint16_t *)src;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i y0 = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(ptr + i)));
+        _mm256_store_ps(dst + i, _mm256_cvtepi32_ps(y0));
+    }
+    for (; i < n; i++) {
+        dst[i] = (float)ptr[i];
+    }
+}
+
+template<>
+void colorspace_cpu_load_plane_avx2<float>(float *dst, const void *src, int n) {
+    memcpy(dst, src, sizeof(float) * n);
+}
+
+// GPUのtoPix<T>と同じく、(T)clamp(x + 0.5f, 0.0f, high)
+// max(low, v)はvがNaNのときNaNを返し、min(NaN, high)はhighを返すので、NaNの扱いもclampと一致する
+static RGY_FORCEINLINE __m256i colorspace_cpu_to_pix_avx2(const float *src, const __m256 yHigh) {
+    const __m256 y0 = _mm256_add_ps(_mm256_load_ps(src), _mm256_set1_ps(0.5f));
+    return _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_setzero_ps(), y0), yHigh));
+}
+
+template<typename T>
+static void colorspace_cpu_store_plane_avx2(void *dst, const float *src, int n) {
+    T *ptr = (T *)dst;
+    const float high = (float)(1 << (sizeof(T) * 8)) - 0.5f;
+    const __m256 yHigh = _mm256_set1_ps(high);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i y0 = colorspace_cpu_to_pix_avx2(src + i, yHigh);
+        y0 = _mm256_packus_epi32(y0, y0);
+        if (sizeof(T) == 1) {
+            y0 = _mm256_packus_epi16(y0, y0);
+            y0 = _mm256_permutevar8x32_epi32(y0, _mm256_set_epi32(7, 7, 7, 7, 7, 7, 4, 0));
+            _mm_storel_epi64((__m128i *)(ptr + i), _mm256_castsi256_si128(y0));
+        } else {
+            y0 = _mm256_permute4x64_epi64(y0, _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storeu_si128((__m128i *)(ptr + i), _mm256_castsi256_si128(y0));
+        }
+    }
+    for (; i < n; i++) {
+        const float v = src[i] + 0.5f;
+        ptr[i] = (T)((v <= high) ? ((v >= 0.0f) ? v : 0.0f) : high);
+    }
+}
+
+template<>
+void colorspace_cpu_store_plane_avx2<float>(void *dst, const float *src, int n) {
+    memcpy(dst, src, sizeof(float) * n);
+}
+
+void colorspace_cpu_load_avx2(ColorspaceCPUBlock *blk, const void *srcX, const void *srcY, const void *srcZ, RGY_DATA_TYPE type, int n) {
+    blk->n = n;
+    switch (type) {
+    case RGY_DATA_TYPE_U8:
+        colorspace_cpu_load_plane_avx2<uint8_t>(blk->x, srcX, n);
+        colorspace_cpu_load_plane_avx2<uint8_t>(blk->y, srcY, n);
+        colorspace_cpu_load_plane_avx2<uint8_t>(blk->z, srcZ, n);
+        break;
+    case RGY_DATA_TYPE_U16:
+        colorspace_cpu_load_plane_avx2<uint16_t>(blk->x, srcX, n);
+        colorspace_cpu_load_plane_avx2<uint16_t>(blk->y, srcY, n);
+        colorspace_cpu_load_plane_avx2<uint16_t>(blk->z, srcZ, n);
+        break;
+    case RGY_DATA_TYPE_FP32:
+        colorspace_cpu_load_plane_avx2<float>(blk->x, srcX, n);
+        colorspace_cpu_load_plane_avx2<float>(blk->y, srcY, n);
+        colorspace_cpu_load_plane_avx2<float>(blk->z, srcZ, n);
+        break;
+    default:
+        memset(blk->x, 0, sizeof(blk->x));
+        memset(blk->y, 0, sizeof(blk->y));
+        memset(blk->z, 0, sizeof(blk->z));
+        break;
+    }
+}
+
+void colorspace_cpu_store_avx2(void *dstX, void *dstY, void *dstZ, RGY_DATA_TYPE type, const ColorspaceCPUBlock *blk) {
+    switch (type) {
+    case RGY_DATA_TYPE_U8:
+        colorspace_cpu_store_plane_avx2<uint8_t>(dstX, blk->x, blk->n);
+        colorspace_cpu_store_plane_avx2<uint8_t>(dstY, blk->y, blk->n);
+        colorspace_cpu_store_plane_avx2<uint8_t>(dstZ, blk->z, blk->n);
+        break;
+    case RGY_DATA_TYPE_U16:
+        colorspace_cpu_store_plane_avx2<uint16_t>(dstX, blk->x, blk->n);
+        colorspace_cpu_store_plane_avx2<uint16_t>(dstY, blk->y, blk->n);
+        colorspace_cpu_store_plane_avx2<uint16_t>(dstZ, blk->z, blk->n);
+        break;
+    case RGY_DATA_TYPE_FP32:
+        colorspace_cpu_store_plane_avx2<float>(dstX, blk->x, blk->n);
+        colorspace_cpu_store_plane_avx2<float>(dstY, blk->y, blk->n);
+        colorspace_cpu_store_plane_avx2<float>(dstZ, blk->z, blk->n);
+        break;
+    default:
+        break;
+    }
+}
+
+// 配列はCOLORSPACE_CPU_BLOCK_SIZEまで確保されているので、端数も含めて8画素単位で処理する
+void colorspace_cpu_affine_avx2(ColorspaceCPUBlock *blk, const float scale[3], const float offset[3]) {
+    const __m256 yScaleX = _mm256_set1_ps(scale[0]), yOffsetX = _mm256_set1_ps(offset[0]);
+    const __m256 yScaleY = _mm256_set1_ps(scale[1]), yOffsetY = _mm256_set1_ps(offset[1]);
+    const __m256 yScaleZ = _mm256_set1_ps(scale[2]), yOffsetZ = _mm256_set1_ps(offset[2]);
+    for (int i = 0; i < blk->n; i += 8) {
+        _mm256_store_ps(blk->x + i, _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(blk->x + i), yScaleX), yOffsetX));
+        _mm256_store_ps(blk->y + i, _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(blk->y + i), yScaleY), yOffsetY));
+        _mm256_store_ps(blk->z + i, _mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(blk->z + i), yScaleZ), yOffsetZ));
+    }
+}
+
+void colorspace_cpu_matrix_avx2(ColorspaceCPUBlock *blk, const float m[3][3]) {
+    const __m256 yM00 = _mm256_set1_ps(m[0][0]), yM01 = _mm256_set1_ps(m[0][1]), yM02 = _mm256_set1_ps(m[0][2]);
+    const __m256 yM10 = _mm256_set1_ps(m[1][0]), yM11 = _mm256_set1_ps(m[1][1]), yM12 = _mm256_set1_ps(m[1][2]);
+    const __m256 yM20 = _mm256_set1_ps(m[2][0]), yM21 = _mm256_set1_ps(m[2][1]), yM22 = _mm256_set1_ps(m[2][2]);
+    for (int i = 0; i < blk->n; i += 8) {
+        const __m256 yX = _mm256_load_ps(blk->x + i);
+        const __m256 yY = _mm256_load_ps(blk->y + i);
+        const __m256 yZ = _mm256_load_ps(blk->z + i);
+        _mm256_store_ps(blk->x + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(yM00, yX), _mm256_mul_ps(yM01, yY)), _mm256_mul_ps(yM02, yZ)));
+        _mm256_store_ps(blk->y + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(yM10, yX), _mm256_mul_ps(yM11, yY)), _mm256_mul_ps(yM12, yZ)));
+        _mm256_store_ps(blk->z + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(yM20, yX), _mm256_mul_ps(yM21, yY)), _mm256_mul_ps(yM22, yZ)));
+    }
+}
+
+#endif //#if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
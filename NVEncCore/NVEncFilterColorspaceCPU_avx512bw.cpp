@@ -0,0 +1,187 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#include <cstring>
+#include "NVEncFilterColorspaceCPU.h"
+
+// GCCは-mavx512fでFMAが使用可能になると乗算と加算をFMAにまとめ、C版と結果が変わるので抑止する
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#if defined(_M_X64) || defined(__x86_64)
+#include <immintrin.h>
+
+#if _MSC_VER >= 1800 && !defined(__AVX__) && !defined(_DEBUG)
+static_assert(false, "do not forget to set /arch:AVX512 for this file.");
+#endif
+
+#if defined(_MSC_VER) || defined(__AVX512BW__)
+#include "convert_csp_avx512.h"
+
+template<typename T>
+static void colorspace_cpu_load_plane_avx512bw(float *dst, const void *src, int n);
+
+template<>
+void colorspace_cpu_load_plane_avx512bw<uint8_t>(float *dst, const void *src, int n) {
+    const uint8_t *ptr = (const uint8_t *)src;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512i z0 = avx512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(ptr + i)));
+        _mm512_store_ps(dst + i, avx512_cvtepi32_ps(z0));
+    }
+    for (; i < n; i++) {
+        dst[i] = (float)ptr[i];
+    }
+}
+
+template<>
+void colorspace_cpu_load_plane_avx512bw<uint16_t>(float *dst, const void *src, int n) {
+    const uint16_t *ptr = (const uint16_t *)src;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512i z0 = avx512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)(ptr + i)));
+        _mm512_store_ps(dst + i, avx512_cvtepi32_ps(z0));
+    }
+    for (; i < n; i++) {
+        dst[i] = (float)ptr[i];
+    }
+}
+
+template<>
+void colorspace_cpu_load_plane_avx512bw<float>(float *dst, const void *src, int n) {
+    memcpy(dst, src, sizeof(float) * n);
+}
+
+// GPUのtoPix<T>と同じく、(T)clamp(x + 0.5f, 0.0f, high) (NaNの扱いはavx2版を参照)
+static RGY_FORCEINLINE __m512i colorspace_cpu_to_pix_avx512bw(const float *src, const __m512 zHigh) {
+    const __m512 z0 = _mm512_add_ps(_mm512_load_ps(src), _mm512_set1_ps(0.5f));
+    return avx512_cvttps_epi32(avx512_min_ps(avx512_max_ps(_mm512_setzero_ps(), z0), zHigh));
+}
+
+template<typename T>
+static void colorspace_cpu_store_plane_avx512bw(void *dst, const float *src, int n) {
+    T *ptr = (T *)dst;
+    const float high = (float)(1 << (sizeof(T) * 8)) - 0.5f;
+    const __m512 zHigh = _mm512_set1_ps(high);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512i z0 = colorspace_cpu_to_pix_avx512bw(src + i, zHigh);
+        if (sizeof(T) == 1) {
+            _mm_storeu_si128((__m128i *)(ptr + i), avx512_cvtusepi32_epi8(z0));
+        } else {
+            _mm256_storeu_si256((__m256i *)(ptr + i), avx512_cvtusepi32_epi16(z0));
+        }
+    }
+    for (; i < n; i++) {
+        const float v = src[i] + 0.5f;
+        ptr[i] = (T)((v <= high) ? ((v >= 0.0f) ? v : 0.0f) : high);
+    }
+}
+
+template<>
+void colorspace_cpu_store_plane_avx512bw<float>(void *dst, const float *src, int n) {
+    memcpy(dst, src, sizeof(float) * n);
+}
+
+void colorspace_cpu_load_avx512bw(ColorspaceCPUBlock *blk, const void *srcX, const void *srcY, const void *srcZ, RGY_DATA_TYPE type, int n) {
+    blk->n = n;
+    switch (type) {
+    case RGY_DATA_TYPE_U8:
+        colorspace_cpu_load_plane_avx512bw<uint8_t>(blk->x, srcX, n);
+        colorspace_cpu_load_plane_avx512bw<uint8_t>(blk->y, srcY, n);
+        colorspace_cpu_load_plane_avx512bw<uint8_t>(blk->z, srcZ, n);
+        break;
+    case RGY_DATA_TYPE_U16:
+        colorspace_cpu_load_plane_avx512bw<uint16_t>(blk->x, srcX, n);
+        colorspace_cpu_load_plane_avx512bw<uint16_t>(blk->y, srcY, n);
+        colorspace_cpu_load_plane_avx512bw<uint16_t>(blk->z, srcZ, n);
+        break;
+    case RGY_DATA_TYPE_FP32:
+        colorspace_cpu_load_plane_avx512bw<float>(blk->x, srcX, n);
+        colorspace_cpu_load_plane_avx512bw<float>(blk->y, srcY, n);
+        colorspace_cpu_load_plane_avx512bw<float>(blk->z, srcZ, n);
+        break;
+    default:
+        memset(blk->x, 0, sizeof(blk->x));
+        memset(blk->y, 0, sizeof(blk->y));
+        memset(blk->z, 0, sizeof(blk->z));
+        break;
+    }
+}
+
+void colorspace_cpu_store_avx512bw(void *dstX, void *dstY, void *dstZ, RGY_DATA_TYPE type, const ColorspaceCPUBlock *blk) {
+    switch (type) {
+    case RGY_DATA_TYPE_U8:
+        colorspace_cpu_store_plane_avx512bw<uint8_t>(dstX, blk->x, blk->n);
+        colorspace_cpu_store_plane_avx512bw<uint8_t>(dstY, blk->y, blk->n);
+        colorspace_cpu_store_plane_avx512bw<uint8_t>(dstZ, blk->z, blk->n);
+        break;
+    case RGY_DATA_TYPE_U16:
+        colorspace_cpu_store_plane_avx512bw<uint16_t>(dstX, blk->x, blk->n);
+        colorspace_cpu_store_plane_avx512bw<uint16_t>(dstY, blk->y, blk->n);
+        colorspace_cpu_store_plane_avx512bw<uint16_t>(dstZ, blk->z, blk->n);
+        break;
+    case RGY_DATA_TYPE_FP32:
+        colorspace_cpu_store_plane_avx512bw<float>(dstX, blk->x, blk->n);
+        colorspace_cpu_store_plane_avx512bw<float>(dstY, blk->y, blk->n);
+        colorspace_cpu_store_plane_avx512bw<float>(dstZ, blk->z, blk->n);
+        break;
+    default:
+        break;
+    }
+}
+
+// 配列はCOLORSPACE_CPU_BLOCK_SIZEまで確保されているので、端数も含めて16画素単位で処理する
+void colorspace_cpu_affine_avx512bw(ColorspaceCPUBlock *blk, const float scale[3], const float offset[3]) {
+    const __m512 zScaleX = _mm512_set1_ps(scale[0]), zOffsetX = _mm512_set1_ps(offset[0]);
+    const __m512 zScaleY = _mm512_set1_ps(scale[1]), zOffsetY = _mm512_set1_ps(offset[1]);
+    const __m512 zScaleZ = _mm512_set1_ps(scale[2]), zOffsetZ = _mm512_set1_ps(offset[2]);
+    for (int i = 0; i < blk->n; i += 16) {
+        _mm512_store_ps(blk->x + i, _mm512_add_ps(_mm512_mul_ps(_mm512_load_ps(blk->x + i), zScaleX), zOffsetX));
+        _mm512_store_ps(blk->y + i, _mm512_add_ps(_mm512_mul_ps(_mm512_load_ps(blk->y + i), zScaleY), zOffsetY));
+        _mm512_store_ps(blk->z + i, _mm512_add_ps(_mm512_mul_ps(_mm512_load_ps(blk->z + i), zScaleZ), zOffsetZ));
+    }
+}
+
+void colorspace_cpu_matrix_avx512bw(ColorspaceCPUBlock *blk, const float m[3][3]) {
+    const __m512 zM00 = _mm512_set1_ps(m[0][0]), zM01 = _mm512_set1_ps(m[0][1]), zM02 = _mm512_set1_ps(m[0][2]);
+    const __m512 zM10 = _mm512_set1_ps(m[1][0]), zM11 = _mm512_set1_ps(m[1][1]), zM12 = _mm512_set1_ps(m[1][2]);
+    const __m512 zM20 = _mm512_set1_ps(m[2][0]), zM21 = _mm512_set1_ps(m[2][1]), zM22 = _mm512_set1_ps(m[2][2]);
+    for (int i = 0; i < blk->n; i += 16) {
+        const __m512 zX = _mm512_load_ps(blk->x + i);
+        const __m512 zY = _mm512_load_ps(blk->y + i);
+        const __m512 zZ = _mm512_load_ps(blk->z + i);
+        _mm512_store_ps(blk->x + i, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(zM00, zX), _mm512_mul_ps(zM01, zY)), _mm512_mul_ps(zM02, zZ)));
+        _mm512_store_ps(blk->y + i, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(zM10, zX), _mm512_mul_ps(zM11, zY)), _mm512_mul_ps(zM12, zZ)));
+        _mm512_store_ps(blk->z + i, _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(zM20, zX), _mm512_mul_ps(zM21, zY)), _mm512_mul_ps(zM22, zZ)));
+    }
+}
+
+#endif //#if defined(_MSC_VER) || defined(__AVX512BW__)
+#endif //#if defined(_M_X64) || defined(__x86_64)
@@ -104,7 +104,7 @@ static jitify::KernelInstantiation jitify_instantiate(jitify::Program *program,
 
 NVEncFilterCustom::NVEncFilterCustom()
 #if ENABLE_NVRTC
-    : m_kernel_cache(), m_program()
+    : m_persistent_cache(), m_kernel_cache(), m_program()
 #endif //#if ENABLE_NVRTC
 {
     m_name = _T("custom");
@@ -203,6 +203,12 @@ RGY_ERR NVEncFilterCustom::init(shared_ptr<NVEncFilterParam> pParam, shared_ptr<
         program_source = tchar_to_string(prm->custom.kernel_path);
         AddMessage(RGY_LOG_DEBUG, _T("program source will be read from \"%s\".\n"), prm->custom.kernel_path.c_str());
     }
+    auto nvrtcCache = getNVRTCCacheGlobal();
+    if (nvrtcCache && !m_persistent_cache) {
+        m_persistent_cache = std::make_unique<NVEncFilterCustomKernelCache>(nvrtcCache);
+        m_kernel_cache.set_persistent_cache(m_persistent_cache.get());
+        AddMessage(RGY_LOG_DEBUG, _T("nvrtc cache: %s.\n"), nvrtcCache->dir().c_str());
+    }
     try {
         m_program.reset(new jitify::Program(m_kernel_cache, program_source, 0, split(prm->custom.compile_options, " ", true)));
     } catch (const std::exception& e) {
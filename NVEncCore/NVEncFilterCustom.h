@@ -58,6 +58,30 @@
 #undef _CRT_SECURE_NO_WARNINGS
 #endif
 #pragma warning (pop)
+#include "rgy_nvrtc_cache.h"
+
+// jitifyのコンパイル結果を--nvrtc-cacheで指定されたディレクトリに保存する
+class NVEncFilterCustomKernelCache : public jitify::PersistentCache {
+public:
+    NVEncFilterCustomKernelCache(RGYNVRTCCache *cache) : m_cache(cache) {};
+    virtual ~NVEncFilterCustomKernelCache() {};
+    virtual bool load(std::string const& key, std::string *ptx, std::string *mangled_instantiation) override {
+        return m_cache->load(key, *ptx, *mangled_instantiation) == RGY_ERR_NONE;
+    }
+    virtual void store(std::string const& key, std::string const& ptx, std::string const& mangled_instantiation) override {
+        m_cache->store(key, ptx, mangled_instantiation); //保存できなくても動作には影響しない
+    }
+    virtual std::string program_key(std::vector<std::string> const& options, std::vector<std::string> const& include_paths,
+                                    std::map<std::string, std::string> const& sources) override {
+        return RGYNVRTCCache::programKey(options, include_paths, sources);
+    }
+    virtual std::string kernel_key(int nvrtc_major, int nvrtc_minor, std::string const& instantiation,
+                                   std::vector<std::string> const& options, std::string const& program_key) override {
+        return RGYNVRTCCache::kernelKey(nvrtc_major, nvrtc_minor, instantiation, options, program_key);
+    }
+protected:
+    RGYNVRTCCache *m_cache;
+};
 #endif //#if ENABLE_NVRTC
 
 
@@ -87,6 +111,7 @@ protected:
     virtual RGY_ERR run_planes(RGYFrameInfo *ppOutputFrames, const RGYFrameInfo *pInputFrame, cudaStream_t stream);
 
 #if ENABLE_NVRTC
+    unique_ptr<NVEncFilterCustomKernelCache> m_persistent_cache; // m_kernel_cacheより後に破棄する
     jitify::JitCache m_kernel_cache;
     unique_ptr<jitify::Program> m_program;
 #endif //#if ENABLE_NVRTC
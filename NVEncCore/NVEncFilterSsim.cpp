@@ -77,7 +77,9 @@ tstring NVEncFilterParamSsim::print() const {
 NVEncFilterSsim::NVEncFilterSsim() :
     m_decodeStarted(false),
     m_deviceId(0),
-    m_thread(),
+    m_compare(),
+    m_compareFin(false),
+    m_heCompareFin(unique_event(nullptr, nullptr)),
     m_mtx(),
     m_abort(false),
     m_vidctxlock(),
@@ -294,17 +296,20 @@ RGY_ERR NVEncFilterSsim::initDecode(const RGYBitstream *bitstream) {
     }
     av_packet_unref(&pkt);
 
-    //比較用のスレッドの開始
-    m_thread = std::thread(&NVEncFilterSsim::thread_func_ssim_psnr, this, prm->threadParamCompare);
-    AddMessage(RGY_LOG_DEBUG, _T("Started ssim/psnr calculation thread.\n"));
-
-    //デコードの開始を待つ必要がある
-    while (m_thread.joinable() && !m_decodeStarted) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto sts = init_cuda_resources();
+    if (sts != RGY_ERR_NONE) {
+        return sts;
     }
+    m_decodeStarted = true;
+
+    //比較処理はプロセス内で共有するスレッドプール上で実行する
+    //addBitstreamでデコーダにデータを渡すたびに実行させ、デコードされたフレームを順に比較する
+    m_heCompareFin = CreateEventUnique(nullptr, TRUE, FALSE);
+    m_compare = std::make_unique<RGYThreadPoolSerial>(RGYThreadPool::shared(0, prm->threadParamCompare), [this]() { compare_task(); });
+    AddMessage(RGY_LOG_DEBUG, _T("Set ssim/psnr calculation thread param: %s.\n"), prm->threadParamCompare.desc().c_str());
 
     AddMessage(RGY_LOG_DEBUG, _T("initDecode(): fin.\n"));
-    return (m_decodeStarted) ? RGY_ERR_NONE : RGY_ERR_UNKNOWN;
+    return RGY_ERR_NONE;
 }
 
 RGY_ERR NVEncFilterSsim::init_cuda_resources() {
@@ -334,7 +339,7 @@ RGY_ERR NVEncFilterSsim::init_cuda_resources() {
         AddMessage(RGY_LOG_ERROR, _T("failed to init decoder.\n"));
         return RGY_ERR_INVALID_PARAM;
     }
-    //SSIM用のスレッドで使用するリソースもすべてSSIM用のスレッド内で作成する
+    //比較処理で使用するリソースもここで作成する (使用時はm_vidctxlockで排他する)
     {
         CCtxAutoLock ctxLock(m_vidctxlock);
         if (prm->ssim) {
@@ -462,6 +467,10 @@ RGY_ERR NVEncFilterSsim::addBitstream(const RGYBitstream *bitstream) {
             return RGY_ERR_UNKNOWN;
         }
     }
+    //デコードされたフレームを比較させる
+    if (m_compare) {
+        m_compare->kick();
+    }
     return RGY_ERR_NONE;
 }
 
@@ -518,9 +527,15 @@ void NVEncFilterSsim::showResult() {
         AddMessage(RGY_LOG_ERROR, _T("Invalid parameter type.\n"));
         return;
     }
-    if (m_thread.joinable()) {
-        AddMessage(RGY_LOG_DEBUG, _T("Waiting for ssim/psnr/vmaf calculation thread to finish.\n"));
-        m_thread.join();
+    if (m_compare) {
+        AddMessage(RGY_LOG_DEBUG, _T("Waiting for ssim/psnr/vmaf calculation to finish.\n"));
+        //デコードの終了までの比較がすべて終わるまで待つ
+        //デコードはaddBitstream内で行われ、その後に必ずkick()されるので、
+        //addBitstream(nullptr)の後の実行で比較が終了し、m_heCompareFinがセットされる
+        m_compare->kick();
+        WaitForSingleObject(m_heCompareFin.get(), INFINITE);
+        m_compare->wait();
+        m_compare.reset();
     }
     if (prm->ssim) {
         auto str = strsprintf(_T("\nSSIM YUV:"));
@@ -807,21 +822,24 @@ RGY_ERR NVEncFilterSsim::thread_func_vmaf(RGYParamThread threadParam) {
 }
 #endif //#if ENABLE_VMAF
 
-RGY_ERR NVEncFilterSsim::thread_func_ssim_psnr(RGYParamThread threadParam) {
-    threadParam.apply(GetCurrentThread());
-    AddMessage(RGY_LOG_DEBUG, _T("Set ssim/psnr calculation thread param: %s.\n"), threadParam.desc().c_str());
-    auto sts = init_cuda_resources();
-    if (sts != RGY_ERR_NONE) {
-        return sts;
+//比較処理のstrandから呼ばれる
+//デコード済みのフレームをすべて比較したら返り、次にデコーダにデータが渡されたときに再び呼ばれる
+void NVEncFilterSsim::compare_task() {
+    if (m_compareFin) {
+        return;
     }
-    m_decodeStarted = true;
-    auto ret = compare_frames(true);
-    AddMessage(RGY_LOG_DEBUG, _T("Finishing ssim/psnr calculation thread: %s.\n"), get_err_mes(ret));
+    auto ret = compare_frames(false);
+    const bool fin = ret != RGY_ERR_NONE || m_abort
+        || (m_decoder->frameQueue()->isEndOfDecode() && m_decoder->frameQueue()->isEmpty());
+    if (fin) {
+        AddMessage(RGY_LOG_DEBUG, _T("Finishing ssim/psnr calculation: %s.\n"), get_err_mes(ret));
 #if ENABLE_VMAF
-    m_vmaf.thread_fin();
+        m_vmaf.thread_fin();
 #endif //#if ENABLE_VMAF
-    close_cuda_resources();
-    return ret;
+        close_cuda_resources();
+        m_compareFin = true;
+        SetEvent(m_heCompareFin.get());
+    }
 }
 
 RGY_ERR NVEncFilterSsim::compare_frames(bool flush) {
@@ -992,10 +1010,12 @@ RGY_ERR NVEncFilterSsim::compare_frames(bool flush) {
 }
 
 void NVEncFilterSsim::close() {
-    if (m_thread.joinable()) {
-        AddMessage(RGY_LOG_DEBUG, _T("Forcing ssim/psnr calculation thread to finish.\n"));
+    if (m_compare) {
+        AddMessage(RGY_LOG_DEBUG, _T("Forcing ssim/psnr calculation to finish.\n"));
         m_abort = true;
-        m_thread.join();
+        m_compare->kick();
+        m_compare->wait();
+        m_compare.reset();
     }
     close_cuda_resources();
     AddMessage(RGY_LOG_DEBUG, _T("closed ssim/psnr filter.\n"));
@@ -35,6 +35,7 @@
 #include <mutex>
 #include "rgy_osdep.h"
 #include "rgy_event.h"
+#include "rgy_thread_pool.h"
 #include "NVEncFilter.h"
 #include "NVEncParam.h"
 #include "NVEncUtil.h"
@@ -84,7 +85,7 @@ public:
     virtual RGY_ERR init(shared_ptr<NVEncFilterParam> pParam, shared_ptr<RGYLog> pPrintMes) override;
     RGY_ERR initDecode(const RGYBitstream *bitstream);
     bool decodeStarted() { return m_decodeStarted; }
-    RGY_ERR thread_func_ssim_psnr(RGYParamThread threadParam);
+    void compare_task();
     RGY_ERR thread_func_vmaf(RGYParamThread threadParam);
     RGY_ERR compare_frames(bool flush);
 
@@ -108,10 +109,13 @@ protected:
     bool m_decodeStarted; //デコードが開始したか
     int m_deviceId;       //SSIM計算で使用するCUDA device ID
 
-    //スレッド関連
-    std::thread m_thread; //スレッド本体
+    //比較処理関連
+    //比較処理は専用のスレッドを持たず、スレッドプール上で順に実行する
+    std::unique_ptr<RGYThreadPoolSerial> m_compare; //比較処理 (デコーダにデータを渡すたびに実行する)
+    std::atomic<bool> m_compareFin; //比較処理が終了したか
+    unique_event m_heCompareFin;    //比較処理の終了を通知する
     std::mutex m_mtx;     //m_input, m_unused操作用のロック
-    bool m_abort;         //スレッド中断用
+    std::atomic<bool> m_abort; //比較処理中断用
 
     CUvideoctxlock m_vidctxlock; //cuvid用のlock
     std::deque<std::unique_ptr<CUFrameBuf>> m_input;  //使用中のフレームバッファ(オリジナルフレーム格納用)
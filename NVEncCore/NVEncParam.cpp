@@ -235,6 +235,8 @@ InEncodeVideoParam::InEncodeVideoParam() :
     sessionRetry(0),
     disableNVML(0),
     disableDX11(false),
+    nvrtcCacheDir(),
+    nvrtcCacheSizeMB(RGY_NVRTC_CACHE_SIZE_MB_DEFAULT),
     input(),
     preset(0),
     nHWDecType(0),
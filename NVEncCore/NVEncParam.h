@@ -45,6 +45,7 @@
 #include "rgy_util.h"
 #include "rgy_simd.h"
 #include "rgy_prm.h"
+#include "rgy_nvrtc_cache.h"
 #include "convert_csp.h"
 
 static const TCHAR *NVENCC_ABORT_EVENT = _T("NVEncC_abort_%u");
@@ -804,6 +805,8 @@ struct InEncodeVideoParam {
     int sessionRetry;
     int disableNVML;
     bool disableDX11;
+    tstring nvrtcCacheDir;        //NVRTCのコンパイル結果を保存するディレクトリ
+    int nvrtcCacheSizeMB;         //NVRTCのコンパイル結果の保存に使用する最大サイズ
 
     VideoInfo input;              //入力する動画の情報
     int preset;                   //出力プリセット
@@ -53,6 +53,7 @@
 #include "rgy_thread.h"
 #include "rgy_thread_affinity.h"
 #include "rgy_timecode.h"
+#include "rgy_trace.h"
 #include "rgy_parallel_enc.h"
 
 #include "NVEncParam.h"
@@ -870,11 +871,17 @@ protected:
     std::shared_ptr<RGYLog> m_log;
     RGYLogType m_logType;
     std::unique_ptr<PipelineTaskStopWatch> m_stopwatch;
+    enum { TRACE_SEND, TRACE_GET, TRACE_FRAME, TRACE_QUEUE, TRACE_COUNT };
+    static const size_t TRACE_FRAME_IN_MAX = 1024;
+    RGYTrace *m_trace; // --task-trace
+    std::array<int, TRACE_COUNT> m_traceId;
+    std::deque<std::pair<int64_t, int64_t>> m_traceFrameIn; // 入力されたフレームの(フレーム番号, 時刻)
 public:
-    PipelineTask() : m_type(PipelineTaskType::UNKNOWN), m_dev(nullptr), m_outQeueue(), m_workSurfs(), m_inFrames(0), m_outFrames(0), m_outMaxQueueSize(0), m_log() {};
+    PipelineTask() : m_type(PipelineTaskType::UNKNOWN), m_dev(nullptr), m_outQeueue(), m_workSurfs(), m_inFrames(0), m_outFrames(0), m_outMaxQueueSize(0), m_log(), m_trace(nullptr), m_traceId(), m_traceFrameIn() {};
     PipelineTask(PipelineTaskType type, NVGPUInfo *dev, int outMaxQueueSize, bool useOutQueueMtx, RGYParamThread threadParam, std::shared_ptr<RGYLog> log) :
         m_type(type), m_dev(dev), m_outQeueue(), m_workSurfs(), m_inFrames(0), m_outFrames(0), m_outMaxQueueSize(outMaxQueueSize),
-        m_outQeueueMtx(useOutQueueMtx ? std::make_unique<std::mutex>() : nullptr), m_threadParam(threadParam), m_log(log), m_logType(RGY_LOGT_CORE) {
+        m_outQeueueMtx(useOutQueueMtx ? std::make_unique<std::mutex>() : nullptr), m_threadParam(threadParam), m_log(log), m_logType(RGY_LOGT_CORE),
+        m_trace(nullptr), m_traceId(), m_traceFrameIn() {
     };
     virtual ~PipelineTask() {
         m_workSurfs.clear();
@@ -890,6 +897,15 @@ public:
             }
         }
     }
+    void setTrace(RGYTrace *trace, const tstring& name) {
+        m_trace = trace;
+        if (m_trace) {
+            m_traceId[TRACE_SEND]  = m_trace->registerEvent(name, _T("send"));
+            m_traceId[TRACE_GET]   = m_trace->registerEvent(name, _T("get"));
+            m_traceId[TRACE_FRAME] = m_trace->registerEvent(name, _T("frame"));
+            m_traceId[TRACE_QUEUE] = m_trace->registerEvent(name, _T("queue"));
+        }
+    }
     virtual int64_t getStopWatchTotal() const {
         return (m_stopwatch) ? m_stopwatch->totalTicks() : 0ll;
     }
@@ -947,6 +963,54 @@ public:
         if (m_stopwatch) m_stopwatch->add(1, 0);
         return output;
     }
+    // sendFrame/getOutputを実行し、--task-traceが有効なら処理区間・フレームがタスク内にとどまった時間・出力キューの長さを記録する
+    RGY_ERR sendFrameTrace(std::unique_ptr<PipelineTaskOutput>& frame) {
+        if (!m_trace) {
+            return sendFrame(frame);
+        }
+        const bool hasFrame = frame != nullptr;
+        const int64_t frameId = traceFrameId(frame.get());
+        const int64_t start = m_trace->now();
+        auto err = sendFrame(frame);
+        m_trace->add(m_traceId[TRACE_SEND], start, frameId);
+        if (hasFrame) {
+            if (m_traceFrameIn.size() >= TRACE_FRAME_IN_MAX) {
+                m_traceFrameIn.pop_front();
+            }
+            m_traceFrameIn.push_back({ frameId, start });
+        }
+        m_trace->counter(m_traceId[TRACE_QUEUE], getOutQueueFrames());
+        return err;
+    }
+    std::vector<std::unique_ptr<PipelineTaskOutput>> getOutputTrace(const bool sync) {
+        if (!m_trace) {
+            return getOutput(sync);
+        }
+        const int64_t start = m_trace->now();
+        auto output = getOutput(sync);
+        if (output.size() > 0) { // 出力がない場合は頻繁に呼ばれるので記録しない
+            m_trace->add(m_traceId[TRACE_GET], start, traceFrameId(output.front().get()));
+            for (auto& out : output) {
+                // フレーム番号がわからない場合 (ビットストリーム) は入力順に対応させる
+                const int64_t frameId = traceFrameId(out.get());
+                auto it = (frameId >= 0)
+                    ? std::find_if(m_traceFrameIn.begin(), m_traceFrameIn.end(), [frameId](const std::pair<int64_t, int64_t>& f) { return f.first == frameId; })
+                    : m_traceFrameIn.begin();
+                if (it != m_traceFrameIn.end()) {
+                    m_trace->add(m_traceId[TRACE_FRAME], it->second, it->first);
+                    m_traceFrameIn.erase(m_traceFrameIn.begin(), it + 1); // それより前のフレームは間引かれたものとして扱う
+                }
+            }
+            m_trace->counter(m_traceId[TRACE_QUEUE], getOutQueueFrames());
+        }
+        return output;
+    }
+    static int64_t traceFrameId(PipelineTaskOutput *out) {
+        if (auto surf = dynamic_cast<PipelineTaskOutputSurf *>(out); surf != nullptr && surf->surf().frame() != nullptr) {
+            return surf->surf().frame()->inputFrameId();
+        }
+        return -1;
+    }
     bool isNVTask() const { return isNVTask(m_type); }
     bool isNVTask(const PipelineTaskType task) const {
         return task == PipelineTaskType::NVENC
@@ -1068,6 +1132,7 @@ public:
     void setOutputMaxQueueSize(int size) { m_outMaxQueueSize = size; }
 
     PipelineTaskType taskType() const { return m_type; }
+    const RGYParamThread& threadParam() const { return m_threadParam; }
     int inputFrames() const { return m_inFrames; }
     int outputFrames() const { return m_outFrames; }
     int outputMaxQueueSize() const { return m_outMaxQueueSize; }
@@ -1300,6 +1365,7 @@ public:
             CUresult curesult = CUDA_SUCCESS;
             RGYBitstream bitstream = RGYBitstreamInit();
             m_threadParam.apply(GetCurrentThread());
+            RGYSetCurrentThreadName(RGY_THREAD_NAME_DEC);
             RGY_ERR sts = RGY_ERR_NONE;
             for (int i = 0; sts == RGY_ERR_NONE && m_state == RGY_STATE_RUNNING && !m_dec->GetError(); i++) {
                 if ((  (sts = m_input->LoadNextFrame(nullptr)) != RGY_ERR_NONE //進捗表示のため
@@ -1740,6 +1806,28 @@ protected:
         return RGY_ERR_NONE;
     }
 
+    RGY_ERR openTmpFile() {
+        // 戻り値を確認
+        auto procsts = checkEncodeResult();
+        if (procsts != RGY_ERR_NONE) {
+            PrintMes(RGY_LOG_ERROR, _T("Error in parallel enc %d: %s\n"), m_currentChunk, get_err_mes(procsts));
+            return procsts;
+        }
+        // ファイルを開く
+        auto tmpPath = m_parallelEnc->tmpPath(m_currentChunk);
+        if (tmpPath.empty()) {
+            PrintMes(RGY_LOG_ERROR, _T("Failed to get tmp path for parallel enc %d.\n"), m_currentChunk);
+            return RGY_ERR_UNKNOWN;
+        }
+        FILE *fp = nullptr;
+        if (_tfopen_s(&fp, tmpPath.c_str(), _T("rb")) != 0 || fp == nullptr) {
+            PrintMes(RGY_LOG_ERROR, _T("Failed to open file: %s\n"), tmpPath.c_str());
+            return RGY_ERR_FILE_OPEN;
+        }
+        m_fReader = std::unique_ptr<FILE, fp_deleter>(fp, fp_deleter());
+        return RGY_ERR_NONE;
+    }
+
     RGY_ERR openNextFile() {
         if (m_currentChunk >= 0 && m_parallelEnc->cacheMode(m_currentChunk) == RGYParamParallelEncCache::Mem) {
             // メモリモードの場合は、まだそのエンコーダの戻り値をチェックしていないので、ここでチェック
@@ -1751,31 +1839,18 @@ protected:
         }
 
         m_currentChunk++;
-        if (m_currentChunk >= (int)m_parallelEnc->parallelCount()) {
+        m_fReader.reset();
+        if (m_currentChunk >= (int)m_parallelEnc->chunks()) {
             return RGY_ERR_MORE_BITSTREAM;
         }
         
         if (m_parallelEnc->cacheMode(m_currentChunk) == RGYParamParallelEncCache::File) {
-            // 戻り値を確認
-            auto procsts = checkEncodeResult();
-            if (procsts != RGY_ERR_NONE) {
-                PrintMes(RGY_LOG_ERROR, _T("Error in parallel enc %d: %s\n"), m_currentChunk, get_err_mes(procsts));
-                return procsts;
-            }
-            // ファイルを開く
-            auto tmpPath = m_parallelEnc->tmpPath(m_currentChunk);
-            if (tmpPath.empty()) {
-                PrintMes(RGY_LOG_ERROR, _T("Failed to get tmp path for parallel enc %d.\n"), m_currentChunk);
-                return RGY_ERR_UNKNOWN;
-            }
-            {
-                FILE *fp = nullptr;
-                if (_tfopen_s(&fp, tmpPath.c_str(), _T("rb")) != 0 || fp == nullptr) {
-                    PrintMes(RGY_LOG_ERROR, _T("Failed to open file: %s\n"), tmpPath.c_str());
-                    return RGY_ERR_FILE_OPEN;
-                }
-                m_fReader = std::unique_ptr<FILE, fp_deleter>(fp, fp_deleter());
+            if (auto err = openTmpFile(); err != RGY_ERR_NONE) {
+                return err;
             }
+        } else {
+            // 読み出し中のチャンクは、一時ファイルに切り替えずにキューが空くのを待つようにする
+            m_parallelEnc->setReaderActive(m_currentChunk);
         }
         //最初のファイルに対するptsの差を取り、それをtimebaseを変換して適用する
         const auto inputFrameInfo = m_input->GetInputFrameInfo();
@@ -1888,9 +1963,19 @@ protected:
     }
 
     RGY_ERR getBitstreamOneFrame(RGYBitstream *bsOut, RGYOutputRawPEExtHeader& header) {
-        return (m_parallelEnc->cacheMode(m_currentChunk) == RGYParamParallelEncCache::File)
-            ? getBitstreamOneFrameFromFile(m_fReader.get(), bsOut, header)
-            : getBitstreamOneFrameFromQueue(bsOut, header);
+        if (m_fReader) {
+            return getBitstreamOneFrameFromFile(m_fReader.get(), bsOut, header);
+        }
+        auto err = getBitstreamOneFrameFromQueue(bsOut, header);
+        if (err == RGY_ERR_MORE_BITSTREAM && m_parallelEnc->spilled(m_currentChunk)) {
+            // メモリの上限を超えたため一時ファイルに出力された、残りのデータを読み込む
+            PrintMes(RGY_LOG_DEBUG, _T("Switch to tmp file for parallel enc %d.\n"), m_currentChunk);
+            if ((err = openTmpFile()) != RGY_ERR_NONE) {
+                return err;
+            }
+            err = getBitstreamOneFrameFromFile(m_fReader.get(), bsOut, header);
+        }
+        return err;
     }
 
     virtual RGY_ERR getBitstream(RGYBitstream *bsOut, RGYOutputRawPEExtHeader& header) {
@@ -1898,7 +1983,7 @@ protected:
             if (auto err = openNextFile(); err != RGY_ERR_NONE) {
                 return err;
             }
-        } else if (m_currentChunk >= (int)m_parallelEnc->parallelCount()) {
+        } else if (m_currentChunk >= (int)m_parallelEnc->chunks()) {
             return RGY_ERR_MORE_BITSTREAM;
         }
         auto err = getBitstreamOneFrame(bsOut, header);
@@ -1959,7 +2044,7 @@ public:
         if (ret == RGY_ERR_NONE && bsOut->size() > 0) {
             std::vector<std::shared_ptr<RGYFrameData>> metadatalist;
             const auto duration = (ENCODER_QSV) ? header.duration : bsOut->duration(); // QSVの場合、Bitstreamにdurationの値がないため、durationはheaderから取得する
-            m_encTimestamp->add(bsOut->pts(), header.inputFrameIdx, header.encodeFrameIdx, duration, metadatalist);
+            m_encTimestamp->add(bsOut->pts(), header.inputFrameIdx, header.encodeFrameIdx, duration, std::move(metadatalist));
             if (m_firstPts < 0) m_firstPts = bsOut->pts();
             m_maxPts = std::max(m_maxPts, bsOut->pts());
             m_maxEncFrameIdx = std::max(m_maxEncFrameIdx, header.encodeFrameIdx);
@@ -2705,6 +2790,7 @@ protected:
     std::promise<RGY_ERR> m_threadOutputPromise;
     std::future<RGY_ERR> m_threadOutputFuture;
     std::optional<RGY_ERR> m_threadOutputResult;
+    std::mutex m_threadOutputResultMtx; // --thread-pipeline時はvppのスレッドからも参照される
     bool m_threadOutputAbort;
     // Linux (ENABLE_ASYNC=0)の場合にデータの取り出しをマルチスレッドで行うと、
     // NvEncLockBitstreamがInvalid(8)を返して異常終了してしまう
@@ -2723,7 +2809,7 @@ public:
         m_stEncConfig(stEncConfig), m_stCreateEncodeParams(stCreateEncodeParams),
         m_timecode(timecode), m_encTimestamp(encTimestamp), m_outputTimebase(outputTimebase),
         m_bitStreamOut(), m_hdr10plus(hdr10plus), m_doviRpu(doviRpu), m_dynamicRC(dynamicRC), m_appliedDynamicRC(-1), m_keyFile(keyFile), m_keyOnChapter(keyOnChapter), m_Chapters(chapters),
-        m_threadOutput(), m_threadOutputPromise(), m_threadOutputFuture(), m_threadOutputResult(), m_threadOutputAbort(false) {
+        m_threadOutput(), m_threadOutputPromise(), m_threadOutputFuture(), m_threadOutputResult(), m_threadOutputResultMtx(), m_threadOutputAbort(false) {
         runThreadOutput();
     };
     virtual ~PipelineTaskNVEncode() {
@@ -2755,7 +2841,9 @@ public:
     virtual std::optional<std::pair<RGYFrameInfo, int>> requiredSurfOut() override { return std::nullopt; };
 
     std::optional<RGY_ERR> getOutputThreadResult(int timeout) {
-        if (!m_bEnableOutputThread || m_threadOutputResult.has_value()) return m_threadOutputResult;
+        if (!m_bEnableOutputThread) return m_threadOutputResult;
+        std::lock_guard<std::mutex> lock(m_threadOutputResultMtx);
+        if (m_threadOutputResult.has_value()) return m_threadOutputResult;
         const auto status = m_threadOutputFuture.wait_for(std::chrono::milliseconds(timeout));
         if (status == std::future_status::ready) {
             m_threadOutputResult = m_threadOutputFuture.get();
@@ -2865,6 +2953,7 @@ protected:
         m_threadOutput = std::thread([this]() {
             auto err = RGY_ERR_NONE;
             m_threadParam.apply(GetCurrentThread());
+            RGYSetCurrentThreadName(RGY_THREAD_NAME_ENC);
             try {
                 err = outputThreadFunc(false);
             } catch (const std::exception &e) {
@@ -3052,7 +3141,7 @@ protected:
             PrintMes(RGY_LOG_ERROR, _T("Invalid input frame ID %d sent to encoder.\n"), inputFrameId);
             return RGY_ERR_INVALID_CALL;
         }
-        m_encTimestamp->add(timestamp, inputFrameId, (encPicParams.frameIdx = id), duration, metadatalist);
+        m_encTimestamp->add(timestamp, inputFrameId, (encPicParams.frameIdx = id), duration, std::move(metadatalist));
 
         NVENCSTATUS nvStatus = m_dev->encoder()->NvEncEncodePicture(&encPicParams);
         if (nvStatus != NV_ENC_SUCCESS && nvStatus != NV_ENC_ERR_NEED_MORE_INPUT) {
@@ -216,6 +216,90 @@ void convert_yuv444_10_to_yuv444_sse2(void **dst, const void **src, int width, i
 void convert_yuv444_09_to_yuv444_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
 void convert_yuv444_09_to_yuv444_sse2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
 
+void convert_yuy2_to_nv12_avx512vbmi(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_to_nv12_avx512vbmi(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_uv_yv12_to_nv12_avx512vbmi(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_to_p010_avx512vbmi(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv422_to_nv16_avx512vbmi(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
+void convert_yuy2_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
+void convert_yv12_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_uv_yv12_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
+void convert_yv12_16_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_14_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_12_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_10_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_09_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
+void convert_yv12_16_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_14_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_12_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_10_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_09_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
+void convert_yuv422_to_nv16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv422_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv422_16_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv422_14_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv422_12_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv422_10_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv422_09_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
+void copy_yuv444_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void copy_yuv444_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void copy_yuv444_16_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void copy_yuv444_14_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void copy_yuv444_12_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void copy_yuv444_10_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void copy_yuv444_09_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
+void convert_yuv444_16_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_14_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_12_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_10_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_09_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_16_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_14_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_12_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_10_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_09_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
+void convert_yuv444_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
+void convert_yuv444_16_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_14_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_12_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_10_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_09_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
+void convert_yuy2_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_uv_yv12_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_16_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_14_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_12_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_10_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_09_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_16_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_14_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_12_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_10_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yv12_09_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_16_to_yuv444_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_14_to_yuv444_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_12_to_yuv444_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_10_to_yuv444_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_09_to_yuv444_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_14_to_yuv444_16_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_12_to_yuv444_16_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_10_to_yuv444_16_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+void convert_yuv444_09_to_yuv444_16_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop);
+
 void convert_yuv444_to_y410_avx2(void** dst, const void** src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int* crop);
 void convert_yuv444_to_y410_sse2(void** dst, const void** src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int* crop);
 void convert_yuv444_10_to_y410_avx2(void** dst, const void** src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int* crop);
@@ -368,7 +452,7 @@ void copy_nv12p010_to_nv12p010_c_internal(void **dst, const void **src, int widt
     const int crop_bottom = crop[3];
     for (int i = 0; i < 2; i++) {
         const auto y_range = thread_y_range(crop_up >> i, (height - crop_bottom) >> i, thread_id, thread_n);
-        const uint8_t *srcYLine = ((const uint8_t *)src[i] + src_y_pitch_byte * y_range.start_src + crop_left * sizeof(uint16_t));
+        const uint8_t *srcYLine = ((const uint8_t *)src[i] + src_y_pitch_byte * y_range.start_src + crop_left * sizeof(Tin));
         uint8_t *dstLine = (uint8_t *)dst[i] + dst_y_pitch_byte * y_range.start_dst;
         for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
             const int x_fin = width - crop_right - crop_left;
@@ -382,11 +466,11 @@ void copy_nv12p010_to_nv12p010_c_internal(void **dst, const void **src, int widt
 }
 
 void copy_p010_to_nv12_c(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
-    return copy_nv12p010_to_nv12p010_c_internal<uint8_t, 8, uint16_t, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+    return copy_nv12p010_to_nv12p010_c_internal<uint16_t, 16, uint8_t, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
 }
 
 void copy_nv12_to_p010_c(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
-    return copy_nv12p010_to_nv12p010_c_internal<uint16_t, 16, uint8_t, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+    return copy_nv12p010_to_nv12p010_c_internal<uint8_t, 8, uint16_t, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
 }
 
 template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth, bool uv_only>
@@ -401,7 +485,7 @@ static void RGY_FORCEINLINE convert_nv12_to_yv12_c_base(void **dst, const void *
     // Y plane
     if (!uv_only) {
         const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
-        const char *srcYLine = (const char *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+        const char *srcYLine = (const char *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left * sizeof(Tin);
         char *dstLine = (char *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
         for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
             if (in_bit_depth == out_bit_depth && sizeof(Tin) == sizeof(Tout)) {
@@ -418,7 +502,7 @@ static void RGY_FORCEINLINE convert_nv12_to_yv12_c_base(void **dst, const void *
 
     // UV planes
     const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
-    const char *srcUVLine = (const char *)src[1] + src_uv_pitch_byte * uv_range.start_src + crop_left;
+    const char *srcUVLine = (const char *)src[1] + src_uv_pitch_byte * uv_range.start_src + crop_left * sizeof(Tin);
     char *dstUline = (char *)dst[1] + dst_uv_pitch_byte * uv_range.start_dst;
     char *dstVline = (char *)dst[2] + dst_uv_pitch_byte * uv_range.start_dst;
     for (int y = 0; y < uv_range.len; y++, srcUVLine += src_uv_pitch_byte, dstUline += dst_uv_pitch_byte, dstVline += dst_uv_pitch_byte) {
@@ -484,7 +568,7 @@ static void RGY_FORCEINLINE convert_yv12_to_yv12_c_base(void **dst, const void *
     // Y plane
     if (!uv_only) {
         const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
-        const char *srcYLine = (const char *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+        const char *srcYLine = (const char *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left * sizeof(Tin);
         char *dstLine = (char *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
         for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
             if (in_bit_depth == out_bit_depth && sizeof(Tin) == sizeof(Tout)) {
@@ -502,7 +586,7 @@ static void RGY_FORCEINLINE convert_yv12_to_yv12_c_base(void **dst, const void *
     // UV planes
     const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
     for (int i = 1; i <= 2; i++) {
-        const char *srcCLine = (const char *)src[i] + src_uv_pitch_byte * uv_range.start_src + (crop_left >> 1);
+        const char *srcCLine = (const char *)src[i] + src_uv_pitch_byte * uv_range.start_src + (crop_left >> 1) * sizeof(Tin);
         char *dstCline = (char *)dst[i] + dst_uv_pitch_byte * uv_range.start_dst;
         for (int y = 0; y < uv_range.len; y++, srcCLine += src_uv_pitch_byte, dstCline += dst_uv_pitch_byte) {
             if (in_bit_depth == out_bit_depth && sizeof(Tin) == sizeof(Tout)) {
@@ -689,8 +773,8 @@ void convert_yuy2_uyvy_to_nv12_i(void **dst_array, const void **src_array, int w
             dstY[3*dst_y_pitch_byte   + 1] = srcP[3*src_y_pitch_byte + y1_idx];
             dstC[0*dst_y_pitch_byte/2 + 0] =(srcP[0*src_y_pitch_byte + u_idx] * 3 + srcP[2*src_y_pitch_byte + u_idx] * 1 + 2)>>2;
             dstC[0*dst_y_pitch_byte/2 + 1] =(srcP[0*src_y_pitch_byte + v_idx] * 3 + srcP[2*src_y_pitch_byte + v_idx] * 1 + 2)>>2;
-            dstC[1*dst_y_pitch_byte/2 + 0] =(srcP[1*src_y_pitch_byte + u_idx] * 1 + srcP[3*src_y_pitch_byte + u_idx] * 3 + 2)>>2;
-            dstC[1*dst_y_pitch_byte/2 + 1] =(srcP[1*src_y_pitch_byte + v_idx] * 1 + srcP[3*src_y_pitch_byte + v_idx] * 3 + 2)>>2;
+            dstC[1*dst_y_pitch_byte   + 0] =(srcP[1*src_y_pitch_byte + u_idx] * 1 + srcP[3*src_y_pitch_byte + u_idx] * 3 + 2)>>2;
+            dstC[1*dst_y_pitch_byte   + 1] =(srcP[1*src_y_pitch_byte + v_idx] * 1 + srcP[3*src_y_pitch_byte + v_idx] * 3 + 2)>>2;
         }
     }
 }
@@ -1648,7 +1732,7 @@ static void RGY_FORCEINLINE convert_yuv444_to_yuv44_c_base(void **dst, const voi
             } else {
                 const Tin *src_ptr = srcYLine;
                 Tout *dst_ptr = dstLine;
-                for (int x = 0; x < y_width; x += 16, dst_ptr += 16, src_ptr += 16) {
+                for (int x = 0; x < y_width; x++) {
                     dst_ptr[x] = (Tout)conv_bit_depth_<out_bit_depth, in_bit_depth, 0>(src_ptr[x]);
                 }
             }
@@ -1931,7 +2015,8 @@ static void RGY_FORCEINLINE convert_yv12_p_to_yuv444_c(void **dst, const void **
             Tout *dstC = dstLine;
             Tin *srcP = srcCLine;
             const int x_fin = width - crop_right - crop_left;
-            if (y == 0) {
+            //上下端の判定は短冊内の位置ではなく、画面内の位置で行う
+            if (y_range.start_dst + y == 0) {
                 for (int x = 0; x < x_fin; x += 2, dstC += 2, srcP++) {
                     int cxplus = (x + 2 < x_fin);
                     int cy0x0 = srcP[ 0*src_uv_pitch + 0];
@@ -2036,11 +2121,13 @@ static void RGY_FORCEINLINE convert_yv12_i_to_yuv444_c(void **dst, const void **
             Tin *srcP = srcCLine;
             const int x_fin = width - crop_right - crop_left;
 
-            int y_m2 = (y >= 4) ? -2 : 0;
-            int y_m1 = (y >= 2) ? -1 : 1;
-            int y_p1 = (y < uv_fin - 2) ? 1 : -1;
-            int y_p2 = (y < uv_fin - 4) ? 2 :  0;
-            int y_p3 = (y < uv_fin - 6) ? 3 : ((y < uv_fin - 2) ? 1 : -1);
+            //上下端の判定は短冊内の位置ではなく、画面内の位置で行う
+            const int y_abs = y_range.start_dst + y;
+            int y_m2 = (y_abs >= 4) ? -2 : 0;
+            int y_m1 = (y_abs >= 2) ? -1 : 1;
+            int y_p1 = (y_abs < uv_fin - 2) ? 1 : -1;
+            int y_p2 = (y_abs < uv_fin - 4) ? 2 :  0;
+            int y_p3 = (y_abs < uv_fin - 6) ? 3 : ((y_abs < uv_fin - 2) ? 1 : -1);
 
             int sy0x0 = srcP[y_m2*src_uv_pitch + 0];
             int sy1x0 = srcP[y_m1*src_uv_pitch + 0];
@@ -2417,6 +2504,11 @@ void convert_rgb_to_gbr32_c(void **dst, const void **src, int width, int src_y_p
 
 #pragma warning (pop)
 
+#if defined(_M_X64) || defined(__x86_64)
+#define FUNC_AVX512(from, to, uv_only, funcp, funci, simd) { from, to, uv_only, { funcp, funci }, simd },
+#else
+#define FUNC_AVX512(from, to, uv_only, funcp, funci, simd)
+#endif
 #if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
 #define FUNC_AVX2(from, to, uv_only, funcp, funci, simd) { from, to, uv_only, { funcp, funci }, simd },
 #define FUNC_AVX(from, to, uv_only, funcp, funci, simd) { from, to, uv_only, { funcp, funci }, simd },
@@ -2426,15 +2518,23 @@ void convert_rgb_to_gbr32_c(void **dst, const void **src, int width, int src_y_p
 #define FUNC_AVX(from, to, uv_only, funcp, funci, simd)
 #define FUNC_SSE(from, to, uv_only, funcp, funci, simd)
 #endif
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define FUNC_NEON(from, to, uv_only, funcp, funci, simd) { from, to, uv_only, { funcp, funci }, simd },
+#else
+#define FUNC_NEON(from, to, uv_only, funcp, funci, simd)
+#endif
 #define FUNC__C_(from, to, uv_only, funcp, funci, simd) { from, to, uv_only, { funcp, funci }, simd },
 
 // テーブル作成の簡略化のため
+#define AVX512VBMI (RGY_SIMD::AVX512VBMI)
+#define AVX512BW (RGY_SIMD::AVX512BW)
 #define AVX2  (RGY_SIMD::AVX2)
 #define AVX   (RGY_SIMD::AVX)
 #define SSE42 (RGY_SIMD::SSE42)
 #define SSE41 (RGY_SIMD::SSE41)
 #define SSSE3 (RGY_SIMD::SSSE3)
 #define SSE2  (RGY_SIMD::SSE2)
+#define NEON  (RGY_SIMD::NEON)
 #define NONE  (RGY_SIMD::NONE)
 
 static const ConvertCSP funcList[] = {
@@ -2451,10 +2551,13 @@ static const ConvertCSP funcList[] = {
     FUNC__C_(  RGY_CSP_P010,      RGY_CSP_NV12,      false,  copy_p010_to_nv12_c,                 copy_p010_to_nv12_c,                 NONE)
 #endif
 #if !CLFILTERS_AUF
+    FUNC_AVX512(RGY_CSP_YUY2,      RGY_CSP_NV12,      false,  convert_yuy2_to_nv12_avx512vbmi,     convert_yuy2_to_nv12_i_avx2,         AVX512VBMI|AVX512BW|AVX2|AVX)
+    FUNC_AVX512(RGY_CSP_YUY2,      RGY_CSP_NV12,      false,  convert_yuy2_to_nv12_avx512bw,       convert_yuy2_to_nv12_i_avx2,         AVX512BW|AVX2|AVX)
     FUNC_AVX2( RGY_CSP_YUY2,      RGY_CSP_NV12,      false,  convert_yuy2_to_nv12_avx2,           convert_yuy2_to_nv12_i_avx2,         AVX2|AVX)
     FUNC_AVX(  RGY_CSP_YUY2,      RGY_CSP_NV12,      false,  convert_yuy2_to_nv12_avx,            convert_yuy2_to_nv12_i_avx,          AVX )
     FUNC_SSE(  RGY_CSP_YUY2,      RGY_CSP_NV12,      false,  convert_yuy2_to_nv12_sse2,           convert_yuy2_to_nv12_i_ssse3,        SSSE3|SSE2 )
     FUNC_SSE(  RGY_CSP_YUY2,      RGY_CSP_NV12,      false,  convert_yuy2_to_nv12_sse2,           convert_yuy2_to_nv12_i_sse2,         SSE2 )
+    FUNC_NEON( RGY_CSP_YUY2,      RGY_CSP_NV12,      false,  convert_yuy2_to_nv12_neon,           convert_yuy2_to_nv12_i,              NEON )
     FUNC__C_(  RGY_CSP_YUY2,      RGY_CSP_NV12,      false,  convert_yuy2_to_nv12,                convert_yuy2_to_nv12_i,              NONE )
     FUNC__C_(  RGY_CSP_YUY2,      RGY_CSP_YUV444,    false,  convert_yuy2_to_yuv444,              convert_yuy2_to_yuv444,              NONE )
     FUNC__C_(  RGY_CSP_UYVY,      RGY_CSP_NV12,      false,  convert_uyvy_to_nv12,                convert_uyvy_to_nv12_i,              NONE )
@@ -2484,14 +2587,20 @@ static const ConvertCSP funcList[] = {
     FUNC_SSE( RGY_CSP_YUV444_16,  RGY_CSP_YC48,      false,  convert_yuv444_16bit_to_yc48_sse2,   convert_yuv444_16bit_to_yc48_sse2,   SSE2 )
 #endif
 #if ENABLE_AVSW_READER || ENABLE_AVI_READER || ENABLE_AVISYNTH_READER || ENABLE_VAPOURSYNTH_READER || ENABLE_AVI_READER || ENABLE_RAW_READER
+    FUNC_AVX512(RGY_CSP_YV12, RGY_CSP_NV12, false, convert_yv12_to_nv12_avx512vbmi, convert_yv12_to_nv12_avx512vbmi, AVX512VBMI|AVX512BW|AVX2|AVX)
+    FUNC_AVX512(RGY_CSP_YV12, RGY_CSP_NV12, false, convert_yv12_to_nv12_avx512bw, convert_yv12_to_nv12_avx512bw, AVX512BW|AVX2|AVX)
     FUNC_AVX2( RGY_CSP_YV12, RGY_CSP_NV12, false, convert_yv12_to_nv12_avx2,     convert_yv12_to_nv12_avx2,     AVX2|AVX)
     FUNC_AVX(  RGY_CSP_YV12, RGY_CSP_NV12, false, convert_yv12_to_nv12_avx,      convert_yv12_to_nv12_avx,      AVX )
     FUNC_SSE(  RGY_CSP_YV12, RGY_CSP_NV12, false, convert_yv12_to_nv12_sse2,     convert_yv12_to_nv12_sse2,     SSE2 )
+    FUNC_NEON( RGY_CSP_YV12, RGY_CSP_NV12, false, convert_yv12_to_nv12_neon,     convert_yv12_to_nv12_neon,     NEON )
     FUNC__C_(  RGY_CSP_YV12, RGY_CSP_NV12, false, convert_yv12_to_nv12_c,        convert_yv12_to_nv12_c,        NONE )
     FUNC__C_(  RGY_CSP_YV12, RGY_CSP_YUV444, false, convert_yv12_p_to_yuv444,    convert_yv12_i_to_yuv444,      NONE )
+    FUNC_AVX512(RGY_CSP_YV12, RGY_CSP_NV12, true,  convert_uv_yv12_to_nv12_avx512vbmi, convert_uv_yv12_to_nv12_avx512vbmi, AVX512VBMI|AVX512BW|AVX2|AVX )
+    FUNC_AVX512(RGY_CSP_YV12, RGY_CSP_NV12, true,  convert_uv_yv12_to_nv12_avx512bw, convert_uv_yv12_to_nv12_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12, RGY_CSP_NV12, true,  convert_uv_yv12_to_nv12_avx2,  convert_uv_yv12_to_nv12_avx2,  AVX2|AVX )
     FUNC_AVX(  RGY_CSP_YV12, RGY_CSP_NV12, true,  convert_uv_yv12_to_nv12_avx,   convert_uv_yv12_to_nv12_avx,   AVX )
     FUNC_SSE(  RGY_CSP_YV12, RGY_CSP_NV12, true,  convert_uv_yv12_to_nv12_sse2,  convert_uv_yv12_to_nv12_sse2,  SSE2 )
+    FUNC_NEON( RGY_CSP_YV12, RGY_CSP_NV12, true,  convert_uv_yv12_to_nv12_neon,  convert_uv_yv12_to_nv12_neon,  NEON )
 
     FUNC__C_(  RGY_CSP_BGR24,  RGY_CSP_BGR24, false, convert_rgb24_packed_copy_c,      convert_rgb24_packed_copy_c,    NONE )
     FUNC__C_(  RGY_CSP_BGR32,  RGY_CSP_BGR32, false, convert_rgb32_packed_copy_c,      convert_rgb32_packed_copy_c,    NONE )
@@ -2581,40 +2690,63 @@ static const ConvertCSP funcList[] = {
     FUNC_AVX2( RGY_CSP_BGR24R, RGY_CSP_BGR24, false, convert_bgr24r_to_bgr24_avx2,     convert_bgr24r_to_bgr24_avx2,     AVX2|AVX)
     FUNC_SSE(  RGY_CSP_BGR24R, RGY_CSP_BGR24, false, convert_bgr24r_to_bgr24_sse2,     convert_bgr24r_to_bgr24_sse2,     SSE2 )
 
+    FUNC_AVX512(RGY_CSP_YV12,      RGY_CSP_P010,      false, convert_yv12_to_p010_avx512vbmi,     convert_yv12_to_p010_avx512vbmi, AVX512VBMI|AVX512BW|AVX2|AVX )
+    FUNC_AVX512(RGY_CSP_YV12,      RGY_CSP_P010,      false, convert_yv12_to_p010_avx512bw,       convert_yv12_to_p010_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12,      RGY_CSP_P010,      false, convert_yv12_to_p010_avx2,           convert_yv12_to_p010_avx2,    AVX2|AVX )
     FUNC_AVX(  RGY_CSP_YV12,      RGY_CSP_P010,      false, convert_yv12_to_p010_avx,            convert_yv12_to_p010_avx,     AVX )
     FUNC_SSE(  RGY_CSP_YV12,      RGY_CSP_P010,      false, convert_yv12_to_p010_sse2,           convert_yv12_to_p010_sse2,    SSE2 )
+    FUNC_NEON( RGY_CSP_YV12,      RGY_CSP_P010,      false, convert_yv12_to_p010_neon,           convert_yv12_to_p010_neon,    NEON )
     FUNC__C_(  RGY_CSP_YV12,      RGY_CSP_P010,      false, convert_yv12_to_p010,                convert_yv12_to_p010,         NONE )
     FUNC__C_(  RGY_CSP_YV12,      RGY_CSP_YUV444_16, false, convert_yv12_p_to_yuv444_16bit,      convert_yv12_i_to_yuv444_16bit, NONE )
+    FUNC_AVX512(RGY_CSP_YV12_16,   RGY_CSP_NV12,      false, convert_yv12_16_to_nv12_avx512bw,    convert_yv12_16_to_nv12_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12_16,   RGY_CSP_NV12,      false, convert_yv12_16_to_nv12_avx2,        convert_yv12_16_to_nv12_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YV12_16,   RGY_CSP_NV12,      false, convert_yv12_16_to_nv12_sse2,        convert_yv12_16_to_nv12_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YV12_16,   RGY_CSP_NV12,      false, convert_yv12_16_to_nv12_neon,        convert_yv12_16_to_nv12_neon, NEON )
     FUNC__C_(  RGY_CSP_YV12_16,   RGY_CSP_NV12,      false, convert_yv12_16_to_nv12_c,           convert_yv12_16_to_nv12_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YV12_14,   RGY_CSP_NV12,      false, convert_yv12_14_to_nv12_avx512bw,    convert_yv12_14_to_nv12_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12_14,   RGY_CSP_NV12,      false, convert_yv12_14_to_nv12_avx2,        convert_yv12_14_to_nv12_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YV12_14,   RGY_CSP_NV12,      false, convert_yv12_14_to_nv12_sse2,        convert_yv12_14_to_nv12_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YV12_14,   RGY_CSP_NV12,      false, convert_yv12_14_to_nv12_neon,        convert_yv12_14_to_nv12_neon, NEON )
     FUNC__C_(  RGY_CSP_YV12_14,   RGY_CSP_NV12,      false, convert_yv12_14_to_nv12_c,           convert_yv12_14_to_nv12_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YV12_12,   RGY_CSP_NV12,      false, convert_yv12_12_to_nv12_avx512bw,    convert_yv12_12_to_nv12_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12_12,   RGY_CSP_NV12,      false, convert_yv12_12_to_nv12_avx2,        convert_yv12_12_to_nv12_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YV12_12,   RGY_CSP_NV12,      false, convert_yv12_12_to_nv12_sse2,        convert_yv12_12_to_nv12_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YV12_12,   RGY_CSP_NV12,      false, convert_yv12_12_to_nv12_neon,        convert_yv12_12_to_nv12_neon, NEON )
     FUNC__C_(  RGY_CSP_YV12_12,   RGY_CSP_NV12,      false, convert_yv12_12_to_nv12_c,           convert_yv12_12_to_nv12_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YV12_10,   RGY_CSP_NV12,      false, convert_yv12_10_to_nv12_avx512bw,    convert_yv12_10_to_nv12_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12_10,   RGY_CSP_NV12,      false, convert_yv12_10_to_nv12_avx2,        convert_yv12_10_to_nv12_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YV12_10,   RGY_CSP_NV12,      false, convert_yv12_10_to_nv12_sse2,        convert_yv12_10_to_nv12_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YV12_10,   RGY_CSP_NV12,      false, convert_yv12_10_to_nv12_neon,        convert_yv12_10_to_nv12_neon, NEON )
     FUNC__C_(  RGY_CSP_YV12_10,   RGY_CSP_NV12,      false, convert_yv12_10_to_nv12_c,           convert_yv12_10_to_nv12_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YV12_09,   RGY_CSP_NV12,      false, convert_yv12_09_to_nv12_avx512bw,    convert_yv12_09_to_nv12_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12_09,   RGY_CSP_NV12,      false, convert_yv12_09_to_nv12_avx2,        convert_yv12_09_to_nv12_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YV12_09,   RGY_CSP_NV12,      false, convert_yv12_09_to_nv12_sse2,        convert_yv12_09_to_nv12_sse2, SSE2 )
-    FUNC__C_(  RGY_CSP_YV12_10,   RGY_CSP_NV12,      false, convert_yv12_09_to_nv12_c,           convert_yv12_09_to_nv12_c,    NONE )
+    FUNC_NEON( RGY_CSP_YV12_09,   RGY_CSP_NV12,      false, convert_yv12_09_to_nv12_neon,        convert_yv12_09_to_nv12_neon, NEON )
+    FUNC__C_(  RGY_CSP_YV12_09,   RGY_CSP_NV12,      false, convert_yv12_09_to_nv12_c,           convert_yv12_09_to_nv12_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YV12_16,   RGY_CSP_P010,      false, convert_yv12_16_to_p010_avx512bw,    convert_yv12_16_to_p010_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12_16,   RGY_CSP_P010,      false, convert_yv12_16_to_p010_avx2,        convert_yv12_16_to_p010_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YV12_16,   RGY_CSP_P010,      false, convert_yv12_16_to_p010_sse2,        convert_yv12_16_to_p010_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YV12_16,   RGY_CSP_P010,      false, convert_yv12_16_to_p010_neon,        convert_yv12_16_to_p010_neon, NEON )
     FUNC__C_(  RGY_CSP_YV12_16,   RGY_CSP_P010,      false, convert_yv12_16_to_p010_c,           convert_yv12_16_to_p010_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YV12_14,   RGY_CSP_P010,      false, convert_yv12_14_to_p010_avx512bw,    convert_yv12_14_to_p010_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12_14,   RGY_CSP_P010,      false, convert_yv12_14_to_p010_avx2,        convert_yv12_14_to_p010_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YV12_14,   RGY_CSP_P010,      false, convert_yv12_14_to_p010_sse2,        convert_yv12_14_to_p010_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YV12_14,   RGY_CSP_P010,      false, convert_yv12_14_to_p010_neon,        convert_yv12_14_to_p010_neon, NEON )
     FUNC__C_(  RGY_CSP_YV12_14,   RGY_CSP_P010,      false, convert_yv12_14_to_p010_c,           convert_yv12_14_to_p010_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YV12_12,   RGY_CSP_P010,      false, convert_yv12_12_to_p010_avx512bw,    convert_yv12_12_to_p010_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12_12,   RGY_CSP_P010,      false, convert_yv12_12_to_p010_avx2,        convert_yv12_12_to_p010_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YV12_12,   RGY_CSP_P010,      false, convert_yv12_12_to_p010_sse2,        convert_yv12_12_to_p010_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YV12_12,   RGY_CSP_P010,      false, convert_yv12_12_to_p010_neon,        convert_yv12_12_to_p010_neon, NEON )
     FUNC__C_(  RGY_CSP_YV12_12,   RGY_CSP_P010,      false, convert_yv12_12_to_p010_c,           convert_yv12_12_to_p010_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YV12_10,   RGY_CSP_P010,      false, convert_yv12_10_to_p010_avx512bw,    convert_yv12_10_to_p010_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12_10,   RGY_CSP_P010,      false, convert_yv12_10_to_p010_avx2,        convert_yv12_10_to_p010_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YV12_10,   RGY_CSP_P010,      false, convert_yv12_10_to_p010_sse2,        convert_yv12_10_to_p010_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YV12_10,   RGY_CSP_P010,      false, convert_yv12_10_to_p010_neon,        convert_yv12_10_to_p010_neon, NEON )
     FUNC__C_(  RGY_CSP_YV12_10,   RGY_CSP_P010,      false, convert_yv12_10_to_p010_c,           convert_yv12_10_to_p010_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YV12_09,   RGY_CSP_P010,      false, convert_yv12_09_to_p010_avx512bw,    convert_yv12_09_to_p010_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YV12_09,   RGY_CSP_P010,      false, convert_yv12_09_to_p010_avx2,        convert_yv12_09_to_p010_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YV12_09,   RGY_CSP_P010,      false, convert_yv12_09_to_p010_sse2,        convert_yv12_09_to_p010_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YV12_09,   RGY_CSP_P010,      false, convert_yv12_09_to_p010_neon,        convert_yv12_09_to_p010_neon, NEON )
     FUNC__C_(  RGY_CSP_YV12_09,   RGY_CSP_P010,      false, convert_yv12_09_to_p010_c,           convert_yv12_09_to_p010_c,    NONE )
 
     FUNC_AVX2( RGY_CSP_NV12,      RGY_CSP_YV12,      false, convert_nv12_to_yv12_avx2,      convert_nv12_to_yv12_avx2,      AVX2|AVX )
@@ -2694,33 +2826,48 @@ static const ConvertCSP funcList[] = {
     FUNC__C_(  RGY_CSP_YUV422_12, RGY_CSP_YUV444_16, false, convert_yuv422_12_to_yuv444_16,      convert_yuv422_12_to_yuv444_16, NONE )
     FUNC__C_(  RGY_CSP_YUV422_10, RGY_CSP_YUV444,    false, convert_yuv422_10_to_yuv444,         convert_yuv422_10_to_yuv444,    NONE )
     FUNC__C_(  RGY_CSP_YUV422_10, RGY_CSP_YUV444_16, false, convert_yuv422_10_to_yuv444_16,      convert_yuv422_10_to_yuv444_16, NONE )
+    FUNC_AVX512(RGY_CSP_YUV422,    RGY_CSP_NV16,      false, convert_yuv422_to_nv16_avx512vbmi,   convert_yuv422_to_nv16_avx512vbmi, AVX512VBMI|AVX512BW|AVX2|AVX)
+    FUNC_AVX512(RGY_CSP_YUV422,    RGY_CSP_NV16,      false, convert_yuv422_to_nv16_avx512bw,     convert_yuv422_to_nv16_avx512bw, AVX512BW|AVX2|AVX)
     FUNC_SSE(  RGY_CSP_YUV422,    RGY_CSP_NV16,      false, convert_yuv422_to_nv16_sse2,         convert_yuv422_to_nv16_sse2,    SSE2)
     FUNC__C_(  RGY_CSP_YUV422,    RGY_CSP_NV16,      false, convert_yuv422_to_nv16_c,            convert_yuv422_to_nv16_c,       NONE)
+    FUNC_AVX512(RGY_CSP_YUV422,    RGY_CSP_P210,      false, convert_yuv422_to_p210_avx512bw,     convert_yuv422_to_p210_avx512bw, AVX512BW|AVX2|AVX)
     FUNC_SSE(  RGY_CSP_YUV422,    RGY_CSP_P210,      false, convert_yuv422_to_p210_sse2,         convert_yuv422_to_p210_sse2,    SSE2)
     FUNC__C_(  RGY_CSP_YUV422,    RGY_CSP_P210,      false, convert_yuv422_to_p210_c,            convert_yuv422_to_p210_c,       NONE)
+    FUNC_AVX512(RGY_CSP_YUV422_16, RGY_CSP_P210,      false, convert_yuv422_16_to_p210_avx512bw,  convert_yuv422_16_to_p210_avx512bw, AVX512BW|AVX2|AVX)
     FUNC_SSE(  RGY_CSP_YUV422_16, RGY_CSP_P210,      false, convert_yuv422_16_to_p210_sse2,      convert_yuv422_16_to_p210_sse2, SSE2)
     FUNC__C_(  RGY_CSP_YUV422_16, RGY_CSP_P210,      false, convert_yuv422_16_to_p210_c,         convert_yuv422_16_to_p210_c,    NONE)
+    FUNC_AVX512(RGY_CSP_YUV422_14, RGY_CSP_P210,      false, convert_yuv422_14_to_p210_avx512bw,  convert_yuv422_14_to_p210_avx512bw, AVX512BW|AVX2|AVX)
     FUNC_SSE(  RGY_CSP_YUV422_14, RGY_CSP_P210,      false, convert_yuv422_14_to_p210_sse2,      convert_yuv422_14_to_p210_sse2, SSE2)
     FUNC__C_(  RGY_CSP_YUV422_14, RGY_CSP_P210,      false, convert_yuv422_14_to_p210_c,         convert_yuv422_14_to_p210_c,    NONE)
+    FUNC_AVX512(RGY_CSP_YUV422_12, RGY_CSP_P210,      false, convert_yuv422_12_to_p210_avx512bw,  convert_yuv422_12_to_p210_avx512bw, AVX512BW|AVX2|AVX)
     FUNC_SSE(  RGY_CSP_YUV422_12, RGY_CSP_P210,      false, convert_yuv422_12_to_p210_sse2,      convert_yuv422_12_to_p210_sse2, SSE2)
     FUNC__C_(  RGY_CSP_YUV422_12, RGY_CSP_P210,      false, convert_yuv422_12_to_p210_c,         convert_yuv422_12_to_p210_c,    NONE)
+    FUNC_AVX512(RGY_CSP_YUV422_10, RGY_CSP_P210,      false, convert_yuv422_10_to_p210_avx512bw,  convert_yuv422_10_to_p210_avx512bw, AVX512BW|AVX2|AVX)
     FUNC_SSE(  RGY_CSP_YUV422_10, RGY_CSP_P210,      false, convert_yuv422_10_to_p210_sse2,      convert_yuv422_10_to_p210_sse2, SSE2)
     FUNC__C_(  RGY_CSP_YUV422_10, RGY_CSP_P210,      false, convert_yuv422_10_to_p210_c,         convert_yuv422_10_to_p210_c,    NONE)
+    FUNC_AVX512(RGY_CSP_YUV422_09, RGY_CSP_P210,      false, convert_yuv422_09_to_p210_avx512bw,  convert_yuv422_09_to_p210_avx512bw, AVX512BW|AVX2|AVX)
     FUNC_SSE(  RGY_CSP_YUV422_09, RGY_CSP_P210,      false, convert_yuv422_09_to_p210_sse2,      convert_yuv422_09_to_p210_sse2, SSE2)
     FUNC__C_(  RGY_CSP_YUV422_09, RGY_CSP_P210,      false, convert_yuv422_09_to_p210_c,         convert_yuv422_09_to_p210_c,    NONE)
+    FUNC_AVX512(RGY_CSP_YUV444,    RGY_CSP_YUV444,    false, copy_yuv444_to_yuv444_avx512bw,      copy_yuv444_to_yuv444_avx512bw,  AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444,    RGY_CSP_YUV444,    false, copy_yuv444_to_yuv444_avx2,          copy_yuv444_to_yuv444_avx2,      AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444,    RGY_CSP_YUV444,    false, copy_yuv444_to_yuv444_sse2,          copy_yuv444_to_yuv444_sse2,      SSE2 )
     FUNC__C_(  RGY_CSP_YUV444,    RGY_CSP_YUV444,    false, copy_yuv444_to_yuv444_c,             copy_yuv444_to_yuv444_c,         NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_16, RGY_CSP_VUYA,      false, copy_yuv444_16_to_ayuv444_avx512bw,  copy_yuv444_16_to_ayuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_16, RGY_CSP_VUYA,      false, copy_yuv444_16_to_ayuv444_avx2,      copy_yuv444_16_to_ayuv444_avx2,  AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_16, RGY_CSP_VUYA,      false, copy_yuv444_16_to_ayuv444_sse2,      copy_yuv444_16_to_ayuv444_sse2,  SSE2 )
+    FUNC_AVX512(RGY_CSP_YUV444_14, RGY_CSP_VUYA,      false, copy_yuv444_14_to_ayuv444_avx512bw,  copy_yuv444_14_to_ayuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_14, RGY_CSP_VUYA,      false, copy_yuv444_14_to_ayuv444_avx2,      copy_yuv444_14_to_ayuv444_avx2,  AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_14, RGY_CSP_VUYA,      false, copy_yuv444_14_to_ayuv444_sse2,      copy_yuv444_14_to_ayuv444_sse2,  SSE2 )
+    FUNC_AVX512(RGY_CSP_YUV444_12, RGY_CSP_VUYA,      false, copy_yuv444_12_to_ayuv444_avx512bw,  copy_yuv444_12_to_ayuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_12, RGY_CSP_VUYA,      false, copy_yuv444_12_to_ayuv444_avx2,      copy_yuv444_12_to_ayuv444_avx2,  AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_12, RGY_CSP_VUYA,      false, copy_yuv444_12_to_ayuv444_sse2,      copy_yuv444_12_to_ayuv444_sse2,  SSE2 )
+    FUNC_AVX512(RGY_CSP_YUV444_10, RGY_CSP_VUYA,      false, copy_yuv444_10_to_ayuv444_avx512bw,  copy_yuv444_10_to_ayuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_10, RGY_CSP_VUYA,      false, copy_yuv444_10_to_ayuv444_avx2,      copy_yuv444_10_to_ayuv444_avx2,  AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_10, RGY_CSP_VUYA,      false, copy_yuv444_10_to_ayuv444_sse2,      copy_yuv444_10_to_ayuv444_sse2,  SSE2 )
+    FUNC_AVX512(RGY_CSP_YUV444_09, RGY_CSP_VUYA,      false, copy_yuv444_09_to_ayuv444_avx512bw,  copy_yuv444_09_to_ayuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_09, RGY_CSP_VUYA,      false, copy_yuv444_09_to_ayuv444_avx2,      copy_yuv444_09_to_ayuv444_avx2,  AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_09, RGY_CSP_VUYA,      false, copy_yuv444_09_to_ayuv444_sse2,      copy_yuv444_09_to_ayuv444_sse2,  SSE2 )
+    FUNC_AVX512(RGY_CSP_YUV444,    RGY_CSP_VUYA,      false, copy_yuv444_to_ayuv444_avx512bw,     copy_yuv444_to_ayuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444,    RGY_CSP_VUYA,      false, copy_yuv444_to_ayuv444_avx2,         copy_yuv444_to_ayuv444_avx2,     AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444,    RGY_CSP_VUYA,      false, copy_yuv444_to_ayuv444_sse2,         copy_yuv444_to_ayuv444_sse2,     SSE2 )
     FUNC_AVX2( RGY_CSP_YUV444_16, RGY_CSP_Y410,      false, convert_yuv444_16_to_y410_avx2,      convert_yuv444_16_to_y410_avx2,  AVX2|AVX)
@@ -2774,21 +2921,31 @@ static const ConvertCSP funcList[] = {
     FUNC__C_(  RGY_CSP_YUV444_10, RGY_CSP_P010,      false, convert_yuv444_10_to_p010_p,         convert_yuv444_10_to_p010_i, NONE )
     FUNC_AVX2( RGY_CSP_YUV444_09, RGY_CSP_P010,      false, convert_yuv444_09_to_p010_p_avx2,    convert_yuv444_09_to_p010_i, AVX2|AVX )
     FUNC__C_(  RGY_CSP_YUV444_09, RGY_CSP_P010,      false, convert_yuv444_09_to_p010_p,         convert_yuv444_09_to_p010_i, NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_16, RGY_CSP_YUV444_16, false, convert_yuv444_16_to_yuv444_16_avx512bw, convert_yuv444_16_to_yuv444_16_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_16, RGY_CSP_YUV444_16, false, convert_yuv444_16_to_yuv444_16_avx2, convert_yuv444_16_to_yuv444_16_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_16, RGY_CSP_YUV444_16, false, convert_yuv444_16_to_yuv444_16_sse2, convert_yuv444_16_to_yuv444_16_sse2, SSE2 )
     FUNC__C_(  RGY_CSP_YUV444_16, RGY_CSP_YUV444_16, false, convert_yuv444_16_to_yuv444_16_c,    convert_yuv444_16_to_yuv444_16_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_14, RGY_CSP_YUV444_16, false, convert_yuv444_14_to_yuv444_16_avx512bw, convert_yuv444_14_to_yuv444_16_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_14, RGY_CSP_YUV444_16, false, convert_yuv444_14_to_yuv444_16_avx2, convert_yuv444_14_to_yuv444_16_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_14, RGY_CSP_YUV444_16, false, convert_yuv444_14_to_yuv444_16_sse2, convert_yuv444_14_to_yuv444_16_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YUV444_14, RGY_CSP_YUV444_16, false, convert_yuv444_14_to_yuv444_16_neon, convert_yuv444_14_to_yuv444_16_neon, NEON )
     FUNC__C_(  RGY_CSP_YUV444_14, RGY_CSP_YUV444_16, false, convert_yuv444_14_to_yuv444_16_c,    convert_yuv444_14_to_yuv444_16_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_12, RGY_CSP_YUV444_16, false, convert_yuv444_12_to_yuv444_16_avx512bw, convert_yuv444_12_to_yuv444_16_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_12, RGY_CSP_YUV444_16, false, convert_yuv444_12_to_yuv444_16_avx2, convert_yuv444_12_to_yuv444_16_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_12, RGY_CSP_YUV444_16, false, convert_yuv444_12_to_yuv444_16_sse2, convert_yuv444_12_to_yuv444_16_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YUV444_12, RGY_CSP_YUV444_16, false, convert_yuv444_12_to_yuv444_16_neon, convert_yuv444_12_to_yuv444_16_neon, NEON )
     FUNC__C_(  RGY_CSP_YUV444_12, RGY_CSP_YUV444_16, false, convert_yuv444_12_to_yuv444_16_c,    convert_yuv444_12_to_yuv444_16_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_10, RGY_CSP_YUV444_16, false, convert_yuv444_10_to_yuv444_16_avx512bw, convert_yuv444_10_to_yuv444_16_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_10, RGY_CSP_YUV444_16, false, convert_yuv444_10_to_yuv444_16_avx2, convert_yuv444_10_to_yuv444_16_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_10, RGY_CSP_YUV444_16, false, convert_yuv444_10_to_yuv444_16_sse2, convert_yuv444_10_to_yuv444_16_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YUV444_10, RGY_CSP_YUV444_16, false, convert_yuv444_10_to_yuv444_16_neon, convert_yuv444_10_to_yuv444_16_neon, NEON )
     FUNC__C_(  RGY_CSP_YUV444_10, RGY_CSP_YUV444_16, false, convert_yuv444_10_to_yuv444_16_c,    convert_yuv444_10_to_yuv444_16_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_09, RGY_CSP_YUV444_16, false, convert_yuv444_09_to_yuv444_16_avx512bw, convert_yuv444_09_to_yuv444_16_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_09, RGY_CSP_YUV444_16, false, convert_yuv444_09_to_yuv444_16_avx2, convert_yuv444_09_to_yuv444_16_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_09, RGY_CSP_YUV444_16, false, convert_yuv444_09_to_yuv444_16_sse2, convert_yuv444_09_to_yuv444_16_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YUV444_09, RGY_CSP_YUV444_16, false, convert_yuv444_09_to_yuv444_16_neon, convert_yuv444_09_to_yuv444_16_neon, NEON )
     FUNC__C_(  RGY_CSP_YUV444_09, RGY_CSP_YUV444_16, false, convert_yuv444_09_to_yuv444_16_c,    convert_yuv444_09_to_yuv444_16_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444,    RGY_CSP_YUV444_16, false, convert_yuv444_to_yuv444_16_avx512bw, convert_yuv444_to_yuv444_16_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444,    RGY_CSP_YUV444_16, false, convert_yuv444_to_yuv444_16_avx2,    convert_yuv444_to_yuv444_16_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444,    RGY_CSP_YUV444_16, false, convert_yuv444_to_yuv444_16_sse2,    convert_yuv444_to_yuv444_16_sse2, SSE2 )
     FUNC__C_(  RGY_CSP_YUV444,    RGY_CSP_YUV444_16, false, convert_yuv444_to_yuv444_16_c,       convert_yuv444_to_yuv444_16_c,    NONE )
@@ -2816,43 +2973,63 @@ static const ConvertCSP funcList[] = {
     FUNC__C_(  RGY_CSP_YUV444_09, RGY_CSP_YUV444_12, false, convert_yuv444_09_to_yuv444_12_c,    convert_yuv444_09_to_yuv444_12_c,    NONE )
     FUNC_AVX2( RGY_CSP_YUV444,    RGY_CSP_YUV444_12, false, convert_yuv444_to_yuv444_12_avx2,    convert_yuv444_to_yuv444_12_avx2, AVX2|AVX )
     FUNC__C_(  RGY_CSP_YUV444,    RGY_CSP_YUV444_12, false, convert_yuv444_to_yuv444_12_c,       convert_yuv444_to_yuv444_12_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_16, RGY_CSP_YUV444_10, false, convert_yuv444_16_to_yuv444_10_avx512bw, convert_yuv444_16_to_yuv444_10_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_16, RGY_CSP_YUV444_10, false, convert_yuv444_16_to_yuv444_10_avx2, convert_yuv444_16_to_yuv444_10_avx2, AVX2|AVX )
     FUNC__C_(  RGY_CSP_YUV444_16, RGY_CSP_YUV444_10, false, convert_yuv444_16_to_yuv444_10_c,    convert_yuv444_16_to_yuv444_10_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_14, RGY_CSP_YUV444_10, false, convert_yuv444_14_to_yuv444_10_avx512bw, convert_yuv444_14_to_yuv444_10_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_14, RGY_CSP_YUV444_10, false, convert_yuv444_14_to_yuv444_10_avx2, convert_yuv444_14_to_yuv444_10_avx2, AVX2|AVX )
     FUNC__C_(  RGY_CSP_YUV444_14, RGY_CSP_YUV444_10, false, convert_yuv444_14_to_yuv444_10_c,    convert_yuv444_14_to_yuv444_10_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_12, RGY_CSP_YUV444_10, false, convert_yuv444_12_to_yuv444_10_avx512bw, convert_yuv444_12_to_yuv444_10_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_12, RGY_CSP_YUV444_10, false, convert_yuv444_12_to_yuv444_10_avx2, convert_yuv444_12_to_yuv444_10_avx2, AVX2|AVX )
     FUNC__C_(  RGY_CSP_YUV444_12, RGY_CSP_YUV444_10, false, convert_yuv444_12_to_yuv444_10_c,    convert_yuv444_12_to_yuv444_10_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_10, RGY_CSP_YUV444_10, false, convert_yuv444_10_to_yuv444_10_avx512bw, convert_yuv444_10_to_yuv444_10_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_10, RGY_CSP_YUV444_10, false, convert_yuv444_10_to_yuv444_10_avx2, convert_yuv444_10_to_yuv444_10_avx2, AVX2|AVX )
     FUNC__C_(  RGY_CSP_YUV444_10, RGY_CSP_YUV444_10, false, convert_yuv444_10_to_yuv444_10_c,    convert_yuv444_10_to_yuv444_10_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_09, RGY_CSP_YUV444_10, false, convert_yuv444_09_to_yuv444_10_avx512bw, convert_yuv444_09_to_yuv444_10_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_09, RGY_CSP_YUV444_10, false, convert_yuv444_09_to_yuv444_10_avx2, convert_yuv444_09_to_yuv444_10_avx2, AVX2|AVX )
     FUNC__C_(  RGY_CSP_YUV444_09, RGY_CSP_YUV444_10, false, convert_yuv444_09_to_yuv444_10_c,    convert_yuv444_09_to_yuv444_10_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444,    RGY_CSP_YUV444_10, false, convert_yuv444_to_yuv444_10_avx512bw, convert_yuv444_to_yuv444_10_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444,    RGY_CSP_YUV444_10, false, convert_yuv444_to_yuv444_10_avx2,    convert_yuv444_to_yuv444_10_avx2, AVX2|AVX )
     FUNC__C_(  RGY_CSP_YUV444,    RGY_CSP_YUV444_10, false, convert_yuv444_to_yuv444_10_c,       convert_yuv444_to_yuv444_10_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_16, RGY_CSP_YUV444,    false, convert_yuv444_16_to_yuv444_avx512bw, convert_yuv444_16_to_yuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_16, RGY_CSP_YUV444,    false, convert_yuv444_16_to_yuv444_avx2,    convert_yuv444_16_to_yuv444_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_16, RGY_CSP_YUV444,    false, convert_yuv444_16_to_yuv444_sse2,    convert_yuv444_16_to_yuv444_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YUV444_16, RGY_CSP_YUV444,    false, convert_yuv444_16_to_yuv444_neon,    convert_yuv444_16_to_yuv444_neon, NEON )
     FUNC__C_(  RGY_CSP_YUV444_16, RGY_CSP_YUV444,    false, convert_yuv444_16_to_yuv444_c,       convert_yuv444_16_to_yuv444_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_14, RGY_CSP_YUV444,    false, convert_yuv444_14_to_yuv444_avx512bw, convert_yuv444_14_to_yuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_14, RGY_CSP_YUV444,    false, convert_yuv444_14_to_yuv444_avx2,    convert_yuv444_14_to_yuv444_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_14, RGY_CSP_YUV444,    false, convert_yuv444_14_to_yuv444_sse2,    convert_yuv444_14_to_yuv444_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YUV444_14, RGY_CSP_YUV444,    false, convert_yuv444_14_to_yuv444_neon,    convert_yuv444_14_to_yuv444_neon, NEON )
     FUNC__C_(  RGY_CSP_YUV444_14, RGY_CSP_YUV444,    false, convert_yuv444_14_to_yuv444_c,       convert_yuv444_14_to_yuv444_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_12, RGY_CSP_YUV444,    false, convert_yuv444_12_to_yuv444_avx512bw, convert_yuv444_12_to_yuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_12, RGY_CSP_YUV444,    false, convert_yuv444_12_to_yuv444_avx2,    convert_yuv444_12_to_yuv444_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_12, RGY_CSP_YUV444,    false, convert_yuv444_12_to_yuv444_sse2,    convert_yuv444_12_to_yuv444_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YUV444_12, RGY_CSP_YUV444,    false, convert_yuv444_12_to_yuv444_neon,    convert_yuv444_12_to_yuv444_neon, NEON )
     FUNC__C_(  RGY_CSP_YUV444_12, RGY_CSP_YUV444,    false, convert_yuv444_12_to_yuv444_c,       convert_yuv444_12_to_yuv444_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_10, RGY_CSP_YUV444,    false, convert_yuv444_10_to_yuv444_avx512bw, convert_yuv444_10_to_yuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_10, RGY_CSP_YUV444,    false, convert_yuv444_10_to_yuv444_avx2,    convert_yuv444_10_to_yuv444_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_10, RGY_CSP_YUV444,    false, convert_yuv444_10_to_yuv444_sse2,    convert_yuv444_10_to_yuv444_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YUV444_10, RGY_CSP_YUV444,    false, convert_yuv444_10_to_yuv444_neon,    convert_yuv444_10_to_yuv444_neon, NEON )
     FUNC__C_(  RGY_CSP_YUV444_10, RGY_CSP_YUV444,    false, convert_yuv444_10_to_yuv444_c,       convert_yuv444_10_to_yuv444_c,    NONE )
+    FUNC_AVX512(RGY_CSP_YUV444_09, RGY_CSP_YUV444,    false, convert_yuv444_09_to_yuv444_avx512bw, convert_yuv444_09_to_yuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_YUV444_09, RGY_CSP_YUV444,    false, convert_yuv444_09_to_yuv444_avx2,    convert_yuv444_09_to_yuv444_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_YUV444_09, RGY_CSP_YUV444,    false, convert_yuv444_09_to_yuv444_sse2,    convert_yuv444_09_to_yuv444_sse2, SSE2 )
+    FUNC_NEON( RGY_CSP_YUV444_09, RGY_CSP_YUV444,    false, convert_yuv444_09_to_yuv444_neon,    convert_yuv444_09_to_yuv444_neon, NEON )
     FUNC__C_(  RGY_CSP_YUV444_09, RGY_CSP_YUV444,    false, convert_yuv444_09_to_yuv444_c,       convert_yuv444_09_to_yuv444_c,    NONE )
  
+    FUNC_AVX512(RGY_CSP_GBR,    RGY_CSP_GBR,    false, copy_yuv444_to_yuv444_avx512bw,      copy_yuv444_to_yuv444_avx512bw,  AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_GBR,    RGY_CSP_GBR,    false, copy_yuv444_to_yuv444_avx2,          copy_yuv444_to_yuv444_avx2,      AVX2|AVX )
     FUNC_SSE(  RGY_CSP_GBR,    RGY_CSP_GBR,    false, copy_yuv444_to_yuv444_sse2,          copy_yuv444_to_yuv444_sse2,      SSE2 )
     FUNC__C_(  RGY_CSP_GBR,    RGY_CSP_GBR,    false, copy_yuv444_to_yuv444_c,             copy_yuv444_to_yuv444_c,         NONE )
+    FUNC_AVX512(RGY_CSP_GBR_16, RGY_CSP_GBR_16, false, convert_yuv444_16_to_yuv444_16_avx512bw, convert_yuv444_16_to_yuv444_16_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_GBR_16, RGY_CSP_GBR_16, false, convert_yuv444_16_to_yuv444_16_avx2, convert_yuv444_16_to_yuv444_16_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_GBR_16, RGY_CSP_GBR_16, false, convert_yuv444_16_to_yuv444_16_sse2, convert_yuv444_16_to_yuv444_16_sse2, SSE2 )
     FUNC__C_(  RGY_CSP_GBR_16, RGY_CSP_GBR_16, false, convert_yuv444_16_to_yuv444_16_c,    convert_yuv444_16_to_yuv444_16_c,    NONE )
+    FUNC_AVX512(RGY_CSP_GBR,    RGY_CSP_GBR_16, false, convert_yuv444_to_yuv444_16_avx512bw, convert_yuv444_to_yuv444_16_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_GBR,    RGY_CSP_GBR_16, false, convert_yuv444_to_yuv444_16_avx2,    convert_yuv444_to_yuv444_16_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_GBR,    RGY_CSP_GBR_16, false, convert_yuv444_to_yuv444_16_sse2,    convert_yuv444_to_yuv444_16_sse2, SSE2 )
     FUNC__C_(  RGY_CSP_GBR,    RGY_CSP_GBR_16, false, convert_yuv444_to_yuv444_16_c,       convert_yuv444_to_yuv444_16_c,    NONE )
+    FUNC_AVX512(RGY_CSP_GBR_16, RGY_CSP_GBR,    false, convert_yuv444_16_to_yuv444_avx512bw, convert_yuv444_16_to_yuv444_avx512bw, AVX512BW|AVX2|AVX )
     FUNC_AVX2( RGY_CSP_GBR_16, RGY_CSP_GBR,    false, convert_yuv444_16_to_yuv444_avx2,    convert_yuv444_16_to_yuv444_avx2, AVX2|AVX )
     FUNC_SSE(  RGY_CSP_GBR_16, RGY_CSP_GBR,    false, convert_yuv444_16_to_yuv444_sse2,    convert_yuv444_16_to_yuv444_sse2, SSE2 )
     FUNC__C_(  RGY_CSP_GBR_16, RGY_CSP_GBR,    false, convert_yuv444_16_to_yuv444_c,       convert_yuv444_16_to_yuv444_c,    NONE )
@@ -2885,6 +3062,11 @@ const TCHAR *get_memtype_str(RGY_MEM_TYPE type) {
     }
 }
 
+const ConvertCSP *get_convert_csp_func_list(size_t *count) {
+    *count = _countof(funcList);
+    return funcList;
+}
+
 const ConvertCSP *get_convert_csp_func(RGY_CSP csp_from, RGY_CSP csp_to, bool uv_only, RGY_SIMD simd) {
     if (rgy_csp_has_alpha(csp_from) && rgy_csp_has_alpha(csp_to)) {
         return get_convert_csp_func(rgy_csp_alpha_base(csp_from), rgy_csp_alpha_base(csp_to), uv_only, simd);
@@ -2965,6 +3147,8 @@ funcConvertCSP get_copy_alpha_func(RGY_CSP csp_from, RGY_CSP csp_to) {
 
 const TCHAR *get_simd_str(RGY_SIMD simd) {
     static std::vector<std::pair<RGY_SIMD, const TCHAR*>> simd_str_list = {
+        { AVX512VBMI, _T("AVX512VBMI") },
+        { AVX512BW,   _T("AVX512BW")   },
         { AVX2,  _T("AVX2")   },
         { AVX,   _T("AVX")    },
         { SSE42, _T("SSE4.2") },
@@ -200,7 +200,7 @@ void copy_p010_to_nv12_avx2(void **dst, const void **src, int width, int src_y_p
     const __m256i yrsftAdd = _mm256_set1_epi16((short)conv_bit_depth_rsft_add_<8, in_bit_depth, 0>());
     for (int i = 0; i < 2; i++) {
         const auto y_range = thread_y_range(crop_up >> i, (height - crop_bottom) >> i, thread_id, thread_n);
-        const uint8_t *srcYLine = (const uint8_t *)src[i] + src_y_pitch_byte * y_range.start_src + crop_left;
+        const uint8_t *srcYLine = (const uint8_t *)src[i] + src_y_pitch_byte * y_range.start_src + crop_left * sizeof(uint16_t);
         uint8_t *dstLine = (uint8_t *)dst[i] + dst_y_pitch_byte * y_range.start_dst;
         const int y_width = width - crop_right - crop_left;
         for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
@@ -209,8 +209,8 @@ void copy_p010_to_nv12_avx2(void **dst, const void **src, int width, int src_y_p
             for (int x = 0; x < y_width; x += 32, dst_ptr += 32, src_ptr += 32) {
                 __m256i y0 = _mm256_loadu2_m128i((const __m128i *)(src_ptr + 16), (const __m128i *)(src_ptr + 0));
                 __m256i y1 = _mm256_loadu2_m128i((const __m128i *)(src_ptr + 24), (const __m128i *)(src_ptr + 8));
-                y0 = _mm256_adds_epi16(y0, yrsftAdd);
-                y1 = _mm256_adds_epi16(y1, yrsftAdd);
+                y0 = _mm256_adds_epu16(y0, yrsftAdd);
+                y1 = _mm256_adds_epu16(y1, yrsftAdd);
                 y0 = _mm256_srli_epi16(y0, in_bit_depth - 8);
                 y1 = _mm256_srli_epi16(y1, in_bit_depth - 8);
                 y0 = _mm256_packus_epi16(y0, y1);
@@ -639,8 +639,8 @@ static void convert_yv12_high_to_nv12_avx2_base(void **dst, const void **src, in
                 y0 = _mm256_set_m128i(_mm_loadu_si128((__m128i*)(src_ptr + 16)), _mm_loadu_si128((__m128i*)(src_ptr +  0)));
                 y1 = _mm256_set_m128i(_mm_loadu_si128((__m128i*)(src_ptr + 24)), _mm_loadu_si128((__m128i*)(src_ptr +  8)));
 
-                y0 = _mm256_adds_epi16(y0, yrsftAdd);
-                y1 = _mm256_adds_epi16(y1, yrsftAdd);
+                y0 = _mm256_adds_epu16(y0, yrsftAdd);
+                y1 = _mm256_adds_epu16(y1, yrsftAdd);
 
                 y0 = _mm256_srli_epi16(y0, in_bit_depth - 8);
                 y1 = _mm256_srli_epi16(y1, in_bit_depth - 8);
@@ -658,7 +658,7 @@ static void convert_yv12_high_to_nv12_avx2_base(void **dst, const void **src, in
     uint16_t *srcVLine = (uint16_t *)src[2] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
     uint8_t *dstLine  = (uint8_t *)dst[1] + dst_y_pitch_byte * uv_range.start_dst;
     for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch_byte) {
-        const int x_fin = width - crop_right;
+        const int x_fin = width - crop_right - crop_left;
         uint16_t *src_u_ptr = srcULine;
         uint16_t *src_v_ptr = srcVLine;
         uint8_t *dst_ptr = dstLine;
@@ -668,13 +668,14 @@ static void convert_yv12_high_to_nv12_avx2_base(void **dst, const void **src, in
             y0 = _mm256_loadu_si256((const __m256i *)src_u_ptr);
             y1 = _mm256_loadu_si256((const __m256i *)src_v_ptr);
 
-            y0 = _mm256_adds_epi16(y0, yrsftAdd);
-            y1 = _mm256_adds_epi16(y1, yrsftAdd);
+            y0 = _mm256_adds_epu16(y0, yrsftAdd);
+            y1 = _mm256_adds_epu16(y1, yrsftAdd);
 
             y0 = _mm256_srli_epi16(y0, in_bit_depth - 8);
-            y1 = _mm256_slli_epi16(y1, 16 - in_bit_depth);
-            const __m256i xMaskHighByte = _mm256_slli_epi16(_mm256_cmpeq_epi8(_mm256_setzero_si256(), _mm256_setzero_si256()), 8);
-            y1 = _mm256_and_si256(y1, xMaskHighByte);
+            y1 = _mm256_srli_epi16(y1, in_bit_depth - 8);
+            y0 = _mm256_min_epu16(y0, _mm256_set1_epi16(0x00ff));
+            y1 = _mm256_min_epu16(y1, _mm256_set1_epi16(0x00ff));
+            y1 = _mm256_slli_epi16(y1, 8);
 
             y0 = _mm256_or_si256(y0, y1);
 
@@ -727,8 +728,8 @@ void RGY_FORCEINLINE copy_y_plane(void *dst, int dst_y_pitch_byte, const void*sr
                 y0 = _mm256_set_m128i(_mm_loadu_si128((__m128i*)(src_ptr + 16)), _mm_loadu_si128((__m128i*)(src_ptr + 0)));
                 y1 = _mm256_set_m128i(_mm_loadu_si128((__m128i*)(src_ptr + 24)), _mm_loadu_si128((__m128i*)(src_ptr + 8)));
 
-                y0 = _mm256_adds_epi16(y0, yrsftAdd);
-                y1 = _mm256_adds_epi16(y1, yrsftAdd);
+                y0 = _mm256_adds_epu16(y0, yrsftAdd);
+                y1 = _mm256_adds_epu16(y1, yrsftAdd);
 
                 y0 = _mm256_srli_epi16(y0, conv_bit_depth_rsft_<out_bit_depth, in_bit_depth, 0>());
                 y1 = _mm256_srli_epi16(y1, conv_bit_depth_rsft_<out_bit_depth, in_bit_depth, 0>());
@@ -762,10 +763,12 @@ void RGY_FORCEINLINE copy_y_plane(void *dst, int dst_y_pitch_byte, const void*sr
                     y1 = _mm256_slli_epi16(y1, conv_bit_depth_lsft_<out_bit_depth, in_bit_depth, 0>());
                 } else if (out_bit_depth < in_bit_depth) {
                     const __m256i rsftAdd = _mm256_set1_epi16((short)conv_bit_depth_rsft_add_<out_bit_depth, in_bit_depth, 0>());
-                    y0 = _mm256_add_epi16(y0, rsftAdd);
-                    y1 = _mm256_add_epi16(y1, rsftAdd);
+                    y0 = _mm256_adds_epu16(y0, rsftAdd);
+                    y1 = _mm256_adds_epu16(y1, rsftAdd);
                     y0 = _mm256_srli_epi16(y0, conv_bit_depth_rsft_<out_bit_depth, in_bit_depth, 0>());
                     y1 = _mm256_srli_epi16(y1, conv_bit_depth_rsft_<out_bit_depth, in_bit_depth, 0>());
+                    y0 = _mm256_min_epu16(y0, _mm256_set1_epi16((short)((1 << out_bit_depth) - 1)));
+                    y1 = _mm256_min_epu16(y1, _mm256_set1_epi16((short)((1 << out_bit_depth) - 1)));
                 }
                 _mm256_storeu_si256((__m256i*)(dst_ptr +  0), y0);
                 _mm256_storeu_si256((__m256i*)(dst_ptr + 16), y1);
@@ -840,29 +843,24 @@ void convert_p010_to_yv12_avx2(void **dst, const void **src, int width, int src_
         const uint16_t *srcUV = srcUVline;
         uint8_t *dstU = dstUline;
         uint8_t *dstV = dstVline;
-        for (int x = 0; x < uv_width; x += 32, dstU += 32, dstV += 32, srcUV += 64) {
-            __m256i uv0 = _mm256_loadu_si256((const __m256i *)(srcUV +  0));  // | 128 |   0 |
-            __m256i uv1 = _mm256_loadu_si256((const __m256i *)(srcUV + 16));  // | 384 | 256 |
-            __m256i uv2 = _mm256_loadu_si256((const __m256i *)(srcUV + 32));  // | 640 | 512 |
-            __m256i uv3 = _mm256_loadu_si256((const __m256i *)(srcUV + 48));  // | 896 | 768 |
-            uv0 = _mm256_srli_epi16(_mm256_adds_epi16(uv0, yrsftAdd), 8);
-            uv1 = _mm256_srli_epi16(_mm256_adds_epi16(uv1, yrsftAdd), 8);
-            uv2 = _mm256_srli_epi16(_mm256_adds_epi16(uv2, yrsftAdd), 8);
-            uv3 = _mm256_srli_epi16(_mm256_adds_epi16(uv3, yrsftAdd), 8);
-            __m256i uv01 = _mm256_packus_epi16(uv0, uv1);  // | 384 | 128 | 256 |   0 |
-            __m256i uv23 = _mm256_packus_epi16(uv2, uv3);  // | 896 | 640 | 768 | 512 |
-
-            __m256i u0 = _mm256_packus_epi16( // | 896 | 384 | 640 | 128 | 768 | 256 | 512 |   0 |
-                _mm256_and_si256(uv0, _mm256_set1_epi16(0x00FF)),  // | 384 | 128 | 256 |   0 |
-                _mm256_and_si256(uv1, _mm256_set1_epi16(0x00FF))); // | 896 | 640 | 768 | 512 |
-            __m256i v0 = _mm256_packus_epi16(_mm256_srli_epi16(uv0, 8), _mm256_srli_epi16(uv1, 8));
-
-            alignas(32) int perm[8] = {0, 4, 2, 6, 1, 5, 3, 7};
-            u0 = _mm256_permutevar8x32_epi32(u0, _mm256_load_si256((const __m256i *)perm));
-            v0 = _mm256_permutevar8x32_epi32(v0, _mm256_load_si256((const __m256i *)perm));
-
-            _mm256_storeu_si256((__m256i *)dstU, u0);
-            _mm256_storeu_si256((__m256i *)dstV, v0);
+        for (int x = 0; x < uv_width; x += 16, dstU += 16, dstV += 16, srcUV += 32) {
+            __m256i uv0 = _mm256_loadu_si256((const __m256i *)(srcUV +  0)); // UVUV... 7 - 0
+            __m256i uv1 = _mm256_loadu_si256((const __m256i *)(srcUV + 16)); // UVUV... 15 - 8
+            uv0 = _mm256_srli_epi16(_mm256_adds_epu16(uv0, yrsftAdd), 8);
+            uv1 = _mm256_srli_epi16(_mm256_adds_epu16(uv1, yrsftAdd), 8);
+
+            // UとVを分離 (各128bitレーン内で | 11 - 8 | 3 - 0 | , | 15 - 12 | 7 - 4 | の順になる)
+            __m256i u0 = _mm256_packus_epi32(_mm256_and_si256(uv0, _mm256_set1_epi32(0x0000ffff)), _mm256_and_si256(uv1, _mm256_set1_epi32(0x0000ffff)));
+            __m256i v0 = _mm256_packus_epi32(_mm256_srli_epi32(uv0, 16), _mm256_srli_epi32(uv1, 16));
+            u0 = _mm256_permute4x64_epi64(u0, _MM_SHUFFLE(3, 1, 2, 0)); // 15 - 0
+            v0 = _mm256_permute4x64_epi64(v0, _MM_SHUFFLE(3, 1, 2, 0)); // 15 - 0
+
+            // 8bitへ (256は255に飽和させる)
+            __m256i uv8 = _mm256_packus_epi16(u0, v0); // | V 15 - 8 | U 15 - 8 | V 7 - 0 | U 7 - 0 |
+            uv8 = _mm256_permute4x64_epi64(uv8, _MM_SHUFFLE(3, 1, 2, 0)); // | V 15 - 0 | U 15 - 0 |
+
+            _mm_storeu_si128((__m128i *)dstU, _mm256_castsi256_si128(uv8));
+            _mm_storeu_si128((__m128i *)dstV, _mm256_extracti128_si256(uv8, 1));
         }
     }
 }
@@ -943,8 +941,8 @@ void convert_p010_to_yuv420_high_avx2(void **dst, const void **src, int width, i
             __m256i uv0 = _mm256_loadu_si256((const __m256i *)(srcUV +  0));
             __m256i uv1 = _mm256_loadu_si256((const __m256i *)(srcUV + 16));
             if (out_bit_depth < 16) {
-                uv0 = _mm256_adds_epi16(uv0, yrsftAdd);
-                uv1 = _mm256_adds_epi16(uv1, yrsftAdd);
+                uv0 = _mm256_adds_epu16(uv0, yrsftAdd);
+                uv1 = _mm256_adds_epu16(uv1, yrsftAdd);
                 uv0 = _mm256_srli_epi16(uv0, 16 - out_bit_depth);
                 uv1 = _mm256_srli_epi16(uv1, 16 - out_bit_depth);
             }
@@ -1042,6 +1040,8 @@ void RGY_FORCEINLINE convert_yuv444_to_nv12_p_avx2_base(void** dst, const void**
                     v00 = _mm256_packus_epi32(v00, v01); // 30 - 24 | 14 -  8 | 22 - 16 | 6 - 0
                     u0 = _mm256_permute4x64_epi64(u00, _MM_SHUFFLE(3, 1, 2, 0));
                     v0 = _mm256_permute4x64_epi64(v00, _MM_SHUFFLE(3, 1, 2, 0));
+                    u0 = _mm256_min_epu16(u0, _mm256_set1_epi16(0xff));
+                    v0 = _mm256_min_epu16(v0, _mm256_set1_epi16(0xff));
                     v0 = _mm256_slli_epi16(v0, 8);
                 }
                 __m256i c0 = _mm256_or_si256(u0, v0);
@@ -1055,7 +1055,7 @@ void RGY_FORCEINLINE convert_yuv444_to_nv12_p_avx2_base(void** dst, const void**
                     v0 = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(srcV + 0)), mask00ff);
                     u1 = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(srcU + src_uv_pitch + 0)), mask00ff);
                     v1 = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(srcV + src_uv_pitch + 0)), mask00ff);
-#if 0
+                    //C版と同じく (u0 + u1) << (out - in - 1) で計算する
                     const int shift_offset = 1;
                     if (out_bit_depth > in_bit_depth + shift_offset) {
                         u0 = _mm256_slli_epi16(u0, conv_bit_depth_lsft_<out_bit_depth, in_bit_depth, shift_offset>());
@@ -1065,12 +1065,6 @@ void RGY_FORCEINLINE convert_yuv444_to_nv12_p_avx2_base(void** dst, const void**
                     }
                     u0 = _mm256_adds_epu16(u0, u1); // 30 - 0
                     v0 = _mm256_adds_epu16(v0, v1); // 30 - 0
-#else
-                    u0 = _mm256_avg_epu8(u0, u1); // 30 - 0
-                    v0 = _mm256_avg_epu8(v0, v1); // 30 - 0
-                    u0 = _mm256_slli_epi16(u0, conv_bit_depth_lsft_<out_bit_depth, in_bit_depth, 0>());
-                    v0 = _mm256_slli_epi16(v0, conv_bit_depth_lsft_<out_bit_depth, in_bit_depth, 0>());
-#endif
                 } else {
                     const auto mask0000ffff = _mm256_set1_epi32(0x0000ffff);
                     __m256i u00 = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(srcU +  0)), mask0000ffff); // 14 -  0
@@ -1304,15 +1298,15 @@ static void RGY_FORCEINLINE copy_yuv444_high_to_ayuv444_avx2(void **dst, const v
             __m256i pixY0 = _mm256_loadu_si256((const __m256i *)(src_y_ptr + 0)); // 15 -  0
             __m256i pixU0 = _mm256_loadu_si256((const __m256i *)(src_u_ptr + 0)); // 15 -  0
             __m256i pixV0 = _mm256_loadu_si256((const __m256i *)(src_v_ptr + 0)); // 15 -  0
-            __m256i pixY1 = _mm256_loadu_si256((const __m256i *)(src_y_ptr + 8)); // 31 - 16
-            __m256i pixU1 = _mm256_loadu_si256((const __m256i *)(src_u_ptr + 8)); // 31 - 16
-            __m256i pixV1 = _mm256_loadu_si256((const __m256i *)(src_v_ptr + 8)); // 31 - 16
-            pixY0 = _mm256_adds_epi16(pixY0, xrsftAdd);
-            pixU0 = _mm256_adds_epi16(pixU0, xrsftAdd);
-            pixV0 = _mm256_adds_epi16(pixV0, xrsftAdd);
-            pixY1 = _mm256_adds_epi16(pixY1, xrsftAdd);
-            pixU1 = _mm256_adds_epi16(pixU1, xrsftAdd);
-            pixV1 = _mm256_adds_epi16(pixV1, xrsftAdd);
+            __m256i pixY1 = _mm256_loadu_si256((const __m256i *)(src_y_ptr + 16)); // 31 - 16
+            __m256i pixU1 = _mm256_loadu_si256((const __m256i *)(src_u_ptr + 16)); // 31 - 16
+            __m256i pixV1 = _mm256_loadu_si256((const __m256i *)(src_v_ptr + 16)); // 31 - 16
+            pixY0 = _mm256_adds_epu16(pixY0, xrsftAdd);
+            pixU0 = _mm256_adds_epu16(pixU0, xrsftAdd);
+            pixV0 = _mm256_adds_epu16(pixV0, xrsftAdd);
+            pixY1 = _mm256_adds_epu16(pixY1, xrsftAdd);
+            pixU1 = _mm256_adds_epu16(pixU1, xrsftAdd);
+            pixV1 = _mm256_adds_epu16(pixV1, xrsftAdd);
             pixY0 = _mm256_srli_epi16(pixY0, in_bit_depth - 8);
             pixU0 = _mm256_srli_epi16(pixU0, in_bit_depth - 8);
             pixV0 = _mm256_srli_epi16(pixV0, in_bit_depth - 8);
@@ -1383,7 +1377,7 @@ void convert_yuv444_to_y410_avx2(void** dst, const void** src, int width, int sr
         uint8_t* src_u_ptr = srcULine;
         uint8_t* src_v_ptr = srcVLine;
         uint32_t* dst_ptr = dstLine;
-        for (int x = 0; x < y_width; x++, src_y_ptr += 32, src_u_ptr += 32, src_v_ptr += 32, dst_ptr += 32) {
+        for (int x = 0; x < y_width; x += 32, src_y_ptr += 32, src_u_ptr += 32, src_v_ptr += 32, dst_ptr += 32) {
             __m256i pixY = _mm256_loadu_si256((const __m256i*)(src_y_ptr + 0));
             __m256i pixU = _mm256_loadu_si256((const __m256i*)(src_u_ptr + 0));
             __m256i pixV = _mm256_loadu_si256((const __m256i*)(src_v_ptr + 0));
@@ -1439,21 +1433,21 @@ void convert_yuv444_high_to_y410_avx2(void** dst, const void** src, int width, i
         uint16_t* src_u_ptr = srcULine;
         uint16_t* src_v_ptr = srcVLine;
         uint32_t* dst_ptr = dstLine;
-        for (int x = 0; x < y_width; x++, src_y_ptr += 32, src_u_ptr += 32, src_v_ptr += 32, dst_ptr += 32) {
+        for (int x = 0; x < y_width; x += 32, src_y_ptr += 32, src_u_ptr += 32, src_v_ptr += 32, dst_ptr += 32) {
             __m256i pixY0 = _mm256_loadu_si256((const __m256i*)(src_y_ptr + 0)); // 15 -  0
-            __m256i pixY1 = _mm256_loadu_si256((const __m256i*)(src_y_ptr + 8)); // 31 - 16
+            __m256i pixY1 = _mm256_loadu_si256((const __m256i*)(src_y_ptr + 16)); // 31 - 16
             __m256i pixU0 = _mm256_loadu_si256((const __m256i*)(src_u_ptr + 0)); // 15 -  0
-            __m256i pixU1 = _mm256_loadu_si256((const __m256i*)(src_u_ptr + 8)); // 31 - 16
+            __m256i pixU1 = _mm256_loadu_si256((const __m256i*)(src_u_ptr + 16)); // 31 - 16
             __m256i pixV0 = _mm256_loadu_si256((const __m256i*)(src_v_ptr + 0)); // 15 -  0
-            __m256i pixV1 = _mm256_loadu_si256((const __m256i*)(src_v_ptr + 8)); // 31 - 16
+            __m256i pixV1 = _mm256_loadu_si256((const __m256i*)(src_v_ptr + 16)); // 31 - 16
 
             if (in_bit_depth > out_bit_depth) {
-                pixY0 = _mm256_srli_epi16(_mm256_add_epi16(pixY0, xrsftAdd), in_bit_depth - out_bit_depth);
-                pixY1 = _mm256_srli_epi16(_mm256_add_epi16(pixY1, xrsftAdd), in_bit_depth - out_bit_depth);
-                pixU0 = _mm256_srli_epi16(_mm256_add_epi16(pixU0, xrsftAdd), in_bit_depth - out_bit_depth);
-                pixU1 = _mm256_srli_epi16(_mm256_add_epi16(pixU1, xrsftAdd), in_bit_depth - out_bit_depth);
-                pixV0 = _mm256_srli_epi16(_mm256_add_epi16(pixV0, xrsftAdd), in_bit_depth - out_bit_depth);
-                pixV1 = _mm256_srli_epi16(_mm256_add_epi16(pixV1, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixY0 = _mm256_srli_epi16(_mm256_adds_epu16(pixY0, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixY1 = _mm256_srli_epi16(_mm256_adds_epu16(pixY1, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixU0 = _mm256_srli_epi16(_mm256_adds_epu16(pixU0, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixU1 = _mm256_srli_epi16(_mm256_adds_epu16(pixU1, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixV0 = _mm256_srli_epi16(_mm256_adds_epu16(pixV0, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixV1 = _mm256_srli_epi16(_mm256_adds_epu16(pixV1, xrsftAdd), in_bit_depth - out_bit_depth);
             }
             pixY0 = _mm256_min_epu16(pixY0, _mm256_set1_epi16((1<<out_bit_depth)-1));
             pixY1 = _mm256_min_epu16(pixY1, _mm256_set1_epi16((1<<out_bit_depth)-1));
@@ -1550,6 +1544,17 @@ static void RGY_FORCEINLINE convert_yuv444_high_to_yuv444_high_avx2_base(void **
                     }
                     _mm256_storeu_si256((__m256i *)dst_ptr, x0);
                 }
+            } else {
+                //(x + (1 << (rsft-1))) >> rsft を16bitのまま桁あふれせずに計算し、上限でクリップする
+                const __m256i xmax = _mm256_set1_epi16((short)((1 << out_bit_depth) - 1));
+                const uint16_t *src_ptr = srcYLine;
+                uint16_t *dst_ptr = dstLine;
+                for (int x = 0; x < y_width; x += 16, dst_ptr += 16, src_ptr += 16) {
+                    __m256i x0 = _mm256_loadu_si256((const __m256i *)src_ptr);
+                    x0 = _mm256_avg_epu16(_mm256_srli_epi16(x0, std::max(in_bit_depth - out_bit_depth - 1, 0)), _mm256_setzero_si256());
+                    x0 = _mm256_min_epu16(x0, xmax);
+                    _mm256_storeu_si256((__m256i *)dst_ptr, x0);
+                }
             }
         }
     }
@@ -1708,8 +1713,8 @@ static void RGY_FORCEINLINE convert_yuv444_high_to_yuv444_avx2_base(void **dst,
             for (int x = 0; x < y_width; x += 32, dst_ptr += 32, src_ptr += 32) {
                 __m256i y0 = _mm256_loadu2_m128i((const __m128i *)(src_ptr + 16), (const __m128i *)(src_ptr +  0));
                 __m256i y1 = _mm256_loadu2_m128i((const __m128i *)(src_ptr + 24), (const __m128i *)(src_ptr +  8));
-                y0 = _mm256_adds_epi16(y0, yrsftAdd);
-                y1 = _mm256_adds_epi16(y1, yrsftAdd);
+                y0 = _mm256_adds_epu16(y0, yrsftAdd);
+                y1 = _mm256_adds_epu16(y1, yrsftAdd);
                 y0 = _mm256_srli_epi16(y0, in_bit_depth - 8);
                 y1 = _mm256_srli_epi16(y1, in_bit_depth - 8);
                 y0 = _mm256_packus_epi16(y0, y1);
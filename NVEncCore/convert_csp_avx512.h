@@ -0,0 +1,129 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2011-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+#ifndef _CONVERT_CSP_AVX512_H_
+#define _CONVERT_CSP_AVX512_H_
+
+#include <immintrin.h>
+#include "rgy_simd.h"
+#include <stdint.h>
+#include "convert_csp.h"
+
+// 行末の端数はマスク付きload/storeで処理するので、
+// AVX2版と異なりpitchの余白への書き込み(はみ出し)を前提としない
+static RGY_FORCEINLINE __mmask64 avx512_mask64(int n) {
+    return (n >= 64) ? (__mmask64)-1 : ((n <= 0) ? (__mmask64)0 : (((__mmask64)1 << n) - 1));
+}
+static RGY_FORCEINLINE __mmask32 avx512_mask32(int n) {
+    return (n >= 32) ? (__mmask32)0xffffffffu : ((n <= 0) ? (__mmask32)0 : (__mmask32)((1u << n) - 1));
+}
+static RGY_FORCEINLINE __mmask16 avx512_mask16(int n) {
+    return (n >= 16) ? (__mmask16)0xffffu : ((n <= 0) ? (__mmask16)0 : (__mmask16)((1u << n) - 1));
+}
+
+// gcc12では _mm512_permutexvar_epi64 / _mm512_shuffle_i64x2 / _mm512_extracti64x4_epi64 / _mm512_castsi512_si256 が
+// 内部で _mm512_undefined_*() を自己代入で初期化しており、インライン展開先で -Wmaybe-uninitialized が大量に出る
+// 全ビット立てたマスクのmaskz版は同じ命令 (vpermq/vshufi64x2/vextracti64x4) になるので、こちらを使う
+static RGY_FORCEINLINE __m512i avx512_permutexvar_epi64(__m512i idx, __m512i z) {
+    return _mm512_maskz_permutexvar_epi64((__mmask8)0xff, idx, z);
+}
+template<int imm>
+static RGY_FORCEINLINE __m512i avx512_shuffle_i64x2(__m512i a, __m512i b) {
+    return _mm512_maskz_shuffle_i64x2((__mmask8)0xff, a, b, imm);
+}
+static RGY_FORCEINLINE __m256i avx512_lower256(__m512i z) {
+    return _mm512_maskz_extracti64x4_epi64((__mmask8)0xff, z, 0);
+}
+static RGY_FORCEINLINE __m256i avx512_upper256(__m512i z) {
+    return _mm512_maskz_extracti64x4_epi64((__mmask8)0xff, z, 1);
+}
+// float <-> int32 の変換系 (vpmovzx*/vpmovus*/vcvt*) と vmaxps/vminps も同様
+static RGY_FORCEINLINE __m512i avx512_cvtepu8_epi32(__m128i x) {
+    return _mm512_maskz_cvtepu8_epi32((__mmask16)0xffff, x);
+}
+static RGY_FORCEINLINE __m512i avx512_cvtepu16_epi32(__m256i y) {
+    return _mm512_maskz_cvtepu16_epi32((__mmask16)0xffff, y);
+}
+static RGY_FORCEINLINE __m512 avx512_cvtepi32_ps(__m512i z) {
+    return _mm512_maskz_cvtepi32_ps((__mmask16)0xffff, z);
+}
+static RGY_FORCEINLINE __m512i avx512_cvttps_epi32(__m512 z) {
+    return _mm512_maskz_cvttps_epi32((__mmask16)0xffff, z);
+}
+static RGY_FORCEINLINE __m128i avx512_cvtusepi32_epi8(__m512i z) {
+    return _mm512_maskz_cvtusepi32_epi8((__mmask16)0xffff, z);
+}
+static RGY_FORCEINLINE __m256i avx512_cvtusepi32_epi16(__m512i z) {
+    return _mm512_maskz_cvtusepi32_epi16((__mmask16)0xffff, z);
+}
+static RGY_FORCEINLINE __m512 avx512_max_ps(__m512 a, __m512 b) {
+    return _mm512_maskz_max_ps((__mmask16)0xffff, a, b);
+}
+static RGY_FORCEINLINE __m512 avx512_min_ps(__m512 a, __m512 b) {
+    return _mm512_maskz_min_ps((__mmask16)0xffff, a, b);
+}
+
+static RGY_FORCEINLINE void avx512_memcpy(uint8_t *dst, const uint8_t *src, int size) {
+    for (int x = 0; x < size; x += 256, dst += 256, src += 256) {
+        const int remain = size - x;
+        const __m512i z0 = _mm512_maskz_loadu_epi8(avx512_mask64(remain -   0), src +   0);
+        const __m512i z1 = _mm512_maskz_loadu_epi8(avx512_mask64(remain -  64), src +  64);
+        const __m512i z2 = _mm512_maskz_loadu_epi8(avx512_mask64(remain - 128), src + 128);
+        const __m512i z3 = _mm512_maskz_loadu_epi8(avx512_mask64(remain - 192), src + 192);
+        _mm512_mask_storeu_epi8(dst +   0, avx512_mask64(remain -   0), z0);
+        _mm512_mask_storeu_epi8(dst +  64, avx512_mask64(remain -  64), z1);
+        _mm512_mask_storeu_epi8(dst + 128, avx512_mask64(remain - 128), z2);
+        _mm512_mask_storeu_epi8(dst + 192, avx512_mask64(remain - 192), z3);
+    }
+}
+
+// 128bitレーン単位のunpacklo/unpackhiで連続した出力となるよう、
+// qwordを 0,4,1,5,2,6,3,7 の順に並べ替える
+static RGY_FORCEINLINE __m512i avx512_perm_for_unpack(__m512i z) {
+    return avx512_permutexvar_epi64(_mm512_set_epi64(7, 3, 6, 2, 5, 1, 4, 0), z);
+}
+
+// 128bitレーン単位のpackusの結果を連続した並びに戻す
+static RGY_FORCEINLINE __m512i avx512_perm_after_pack(__m512i z) {
+    return avx512_permutexvar_epi64(_mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0), z);
+}
+
+struct avx512_x2 {
+    __m512i lo, hi;
+};
+
+// 8bit 64画素 -> 16bit 32画素 x2 (左シフト)
+template<int lshift>
+static RGY_FORCEINLINE avx512_x2 avx512_expand_8bit_to_16bit(__m512i z) {
+    const __m512i z0 = _mm512_cvtepu8_epi16(avx512_lower256(z));
+    const __m512i z1 = _mm512_cvtepu8_epi16(avx512_upper256(z));
+    if (lshift > 0) {
+        return { _mm512_slli_epi16(z0, lshift), _mm512_slli_epi16(z1, lshift) };
+    }
+    return { z0, z1 };
+}
+
+#endif //_CONVERT_CSP_AVX512_H_
@@ -0,0 +1,721 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2011-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#if defined(_M_X64) || defined(__x86_64)
+#define USE_SSE2  1
+#define USE_SSSE3 1
+#define USE_SSE41 1
+#define USE_AVX   1
+#define USE_AVX2  1
+#define USE_AVX512 1
+#include <immintrin.h>
+#include "rgy_simd.h"
+#include <stdint.h>
+#include <string.h>
+#include "convert_csp.h"
+
+#if _MSC_VER >= 1800 && !defined(__AVX512BW__) && !defined(_DEBUG)
+static_assert(false, "do not forget to set /arch:AVX512 for this file.");
+#endif
+
+#if defined(_MSC_VER) || defined(__AVX512BW__)
+#include "convert_csp_avx512.h"
+
+// 16bit -> 8bit (丸め付き右シフト + 飽和)
+template<int in_bit_depth>
+static RGY_FORCEINLINE __m512i avx512_pack_high_to_8bit(__m512i z0, __m512i z1) {
+    const __m512i zrsftAdd = _mm512_set1_epi16((short)conv_bit_depth_rsft_add_<8, in_bit_depth, 0>());
+    z0 = _mm512_srli_epi16(_mm512_adds_epu16(z0, zrsftAdd), in_bit_depth - 8);
+    z1 = _mm512_srli_epi16(_mm512_adds_epu16(z1, zrsftAdd), in_bit_depth - 8);
+    return avx512_perm_after_pack(_mm512_packus_epi16(z0, z1));
+}
+
+#pragma warning (push)
+#pragma warning (disable: 4100)
+#pragma warning (disable: 4127)
+void convert_yuy2_to_nv12_avx512bw(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const void *src = src_array[0];
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *dstYLine = (uint8_t *)dst_array[0] + dst_y_pitch_byte * y_range.start_dst;
+    uint8_t *dstCLine = (uint8_t *)dst_array[1] + dst_y_pitch_byte * (y_range.start_dst >> 1);
+    const __m512i zMaskLowByte = _mm512_set1_epi16(0x00ff);
+    for (int y = 0; y < y_range.len; y += 2) {
+        uint8_t *p = srcLine;
+        uint8_t *pw = p + src_y_pitch_byte;
+        const int x_fin = width - crop_right - crop_left;
+        for (int x = 0; x < x_fin; x += 64, p += 128, pw += 128) {
+            const int remain = x_fin - x;
+            const __mmask64 mask0 = avx512_mask64(remain * 2);
+            const __mmask64 mask1 = avx512_mask64(remain * 2 - 64);
+            const __mmask64 maskDst = avx512_mask64(remain);
+            //-----------1行目---------------
+            __m512i z0 = _mm512_maskz_loadu_epi8(mask0, p +  0);
+            __m512i z1 = _mm512_maskz_loadu_epi8(mask1, p + 64);
+            __m512i zY = avx512_perm_after_pack(_mm512_packus_epi16(_mm512_and_si512(z0, zMaskLowByte), _mm512_and_si512(z1, zMaskLowByte)));
+            __m512i zC0 = avx512_perm_after_pack(_mm512_packus_epi16(_mm512_srli_epi16(z0, 8), _mm512_srli_epi16(z1, 8)));
+            _mm512_mask_storeu_epi8(dstYLine + x, maskDst, zY);
+            //-----------1行目終了---------------
+
+            //-----------2行目---------------
+            z0 = _mm512_maskz_loadu_epi8(mask0, pw +  0);
+            z1 = _mm512_maskz_loadu_epi8(mask1, pw + 64);
+            zY = avx512_perm_after_pack(_mm512_packus_epi16(_mm512_and_si512(z0, zMaskLowByte), _mm512_and_si512(z1, zMaskLowByte)));
+            __m512i zC1 = avx512_perm_after_pack(_mm512_packus_epi16(_mm512_srli_epi16(z0, 8), _mm512_srli_epi16(z1, 8)));
+            _mm512_mask_storeu_epi8(dstYLine + dst_y_pitch_byte + x, maskDst, zY);
+            //-----------2行目終了---------------
+
+            zC0 = _mm512_avg_epu8(zC0, zC1); //UVUVUVUV
+            _mm512_mask_storeu_epi8(dstCLine + x, maskDst, zC0);
+        }
+        srcLine  += src_y_pitch_byte << 1;
+        dstYLine += dst_y_pitch_byte << 1;
+        dstCLine += dst_y_pitch_byte;
+    }
+}
+
+//8bit UV -> NV12/NV16形式のUV (uv_width: 出力のバイト数)
+static RGY_FORCEINLINE void interleave_uv_8bit_avx512bw(uint8_t *dst_ptr, const uint8_t *src_u_ptr, const uint8_t *src_v_ptr, const int uv_width) {
+    for (int x = 0; x < uv_width; x += 128, src_u_ptr += 64, src_v_ptr += 64, dst_ptr += 128) {
+        const int remain = uv_width - x;
+        const __mmask64 maskSrc = avx512_mask64((remain + 1) >> 1);
+        __m512i z0 = _mm512_maskz_loadu_epi8(maskSrc, src_u_ptr);
+        __m512i z1 = _mm512_maskz_loadu_epi8(maskSrc, src_v_ptr);
+        z0 = avx512_perm_for_unpack(z0);
+        z1 = avx512_perm_for_unpack(z1);
+        _mm512_mask_storeu_epi8(dst_ptr +  0, avx512_mask64(remain),      _mm512_unpacklo_epi8(z0, z1));
+        _mm512_mask_storeu_epi8(dst_ptr + 64, avx512_mask64(remain - 64), _mm512_unpackhi_epi8(z0, z1));
+    }
+}
+
+//8bit UV -> P010/P210形式のUV (uv_width: 出力の画素数)
+template<int offset>
+static RGY_FORCEINLINE void interleave_uv_8bit_to_16bit_avx512bw(uint16_t *dst_ptr, const uint8_t *src_u_ptr, const uint8_t *src_v_ptr, const int uv_width) {
+    const __m512i zOffset = _mm512_set1_epi16(offset);
+    for (int x = 0; x < uv_width; x += 128, src_u_ptr += 64, src_v_ptr += 64, dst_ptr += 128) {
+        const int remain = uv_width - x;
+        const __mmask64 maskSrc = avx512_mask64((remain + 1) >> 1);
+        __m512i z0 = _mm512_maskz_loadu_epi8(maskSrc, src_u_ptr);
+        __m512i z1 = _mm512_maskz_loadu_epi8(maskSrc, src_v_ptr);
+        z0 = avx512_perm_for_unpack(z0);
+        z1 = avx512_perm_for_unpack(z1);
+        const avx512_x2 zLo = avx512_expand_8bit_to_16bit<8>(_mm512_unpacklo_epi8(z0, z1));
+        const avx512_x2 zHi = avx512_expand_8bit_to_16bit<8>(_mm512_unpackhi_epi8(z0, z1));
+        __m512i z2 = zLo.lo, z3 = zLo.hi, z4 = zHi.lo, z5 = zHi.hi;
+        if (offset) {
+            z2 = _mm512_add_epi16(z2, zOffset);
+            z3 = _mm512_add_epi16(z3, zOffset);
+            z4 = _mm512_add_epi16(z4, zOffset);
+            z5 = _mm512_add_epi16(z5, zOffset);
+        }
+        _mm512_mask_storeu_epi16(dst_ptr +  0, avx512_mask32(remain -  0), z2);
+        _mm512_mask_storeu_epi16(dst_ptr + 32, avx512_mask32(remain - 32), z3);
+        _mm512_mask_storeu_epi16(dst_ptr + 64, avx512_mask32(remain - 64), z4);
+        _mm512_mask_storeu_epi16(dst_ptr + 96, avx512_mask32(remain - 96), z5);
+    }
+}
+
+//16bit UV -> P010/P210形式のUV (uv_width: 出力の画素数)
+template<int in_bit_depth>
+static RGY_FORCEINLINE void interleave_uv_high_to_16bit_avx512bw(uint16_t *dst_ptr, const uint16_t *src_u_ptr, const uint16_t *src_v_ptr, const int uv_width) {
+    for (int x = 0; x < uv_width; x += 64, src_u_ptr += 32, src_v_ptr += 32, dst_ptr += 64) {
+        const int remain = uv_width - x;
+        const __mmask32 maskSrc = avx512_mask32((remain + 1) >> 1);
+        __m512i z0 = _mm512_maskz_loadu_epi16(maskSrc, src_u_ptr);
+        __m512i z1 = _mm512_maskz_loadu_epi16(maskSrc, src_v_ptr);
+        if (in_bit_depth < 16) {
+            z0 = _mm512_slli_epi16(z0, 16 - in_bit_depth);
+            z1 = _mm512_slli_epi16(z1, 16 - in_bit_depth);
+        }
+        z0 = avx512_perm_for_unpack(z0);
+        z1 = avx512_perm_for_unpack(z1);
+        _mm512_mask_storeu_epi16(dst_ptr +  0, avx512_mask32(remain),      _mm512_unpacklo_epi16(z0, z1));
+        _mm512_mask_storeu_epi16(dst_ptr + 32, avx512_mask32(remain - 32), _mm512_unpackhi_epi16(z0, z1));
+    }
+}
+
+//8bit -> 16bit (lshift, offset)
+template<int lshift, int offset>
+static RGY_FORCEINLINE void copy_line_8bit_to_16bit_avx512bw(uint16_t *dst_ptr, const uint8_t *src_ptr, const int y_width) {
+    const __m512i zOffset = _mm512_set1_epi16(offset);
+    for (int x = 0; x < y_width; x += 64, dst_ptr += 64, src_ptr += 64) {
+        const int remain = y_width - x;
+        const avx512_x2 z = avx512_expand_8bit_to_16bit<lshift>(_mm512_maskz_loadu_epi8(avx512_mask64(remain), src_ptr));
+        __m512i z0 = z.lo, z1 = z.hi;
+        if (offset) {
+            z0 = _mm512_add_epi16(z0, zOffset);
+            z1 = _mm512_add_epi16(z1, zOffset);
+        }
+        _mm512_mask_storeu_epi16(dst_ptr +  0, avx512_mask32(remain),      z0);
+        _mm512_mask_storeu_epi16(dst_ptr + 32, avx512_mask32(remain - 32), z1);
+    }
+}
+
+//16bit -> 16bit (bit深度の変換)
+template<int in_bit_depth, int out_bit_depth>
+static RGY_FORCEINLINE void copy_line_high_to_high_avx512bw(uint16_t *dst_ptr, const uint16_t *src_ptr, const int y_width) {
+    if (in_bit_depth == out_bit_depth) {
+        avx512_memcpy((uint8_t *)dst_ptr, (const uint8_t *)src_ptr, y_width * (int)sizeof(uint16_t));
+        return;
+    }
+    for (int x = 0; x < y_width; x += 32, dst_ptr += 32, src_ptr += 32) {
+        const __mmask32 mask = avx512_mask32(y_width - x);
+        __m512i z0 = _mm512_maskz_loadu_epi16(mask, src_ptr);
+        if (out_bit_depth > in_bit_depth) {
+            z0 = _mm512_slli_epi16(z0, (out_bit_depth > in_bit_depth) ? out_bit_depth - in_bit_depth : 0);
+        } else {
+            const __m512i zrsftAdd = _mm512_set1_epi16((short)conv_bit_depth_rsft_add_<out_bit_depth, in_bit_depth, 0>());
+            const __m512i zMax = _mm512_set1_epi16((short)((1 << out_bit_depth) - 1));
+            z0 = _mm512_srli_epi16(_mm512_adds_epu16(z0, zrsftAdd), (in_bit_depth > out_bit_depth) ? in_bit_depth - out_bit_depth : 0);
+            z0 = _mm512_min_epu16(z0, zMax);
+        }
+        _mm512_mask_storeu_epi16(dst_ptr, mask, z0);
+    }
+}
+
+//16bit -> 8bit
+template<int in_bit_depth>
+static RGY_FORCEINLINE void copy_line_high_to_8bit_avx512bw(uint8_t *dst_ptr, const uint16_t *src_ptr, const int y_width) {
+    for (int x = 0; x < y_width; x += 64, dst_ptr += 64, src_ptr += 64) {
+        const int remain = y_width - x;
+        __m512i z0 = _mm512_maskz_loadu_epi16(avx512_mask32(remain),      src_ptr +  0);
+        __m512i z1 = _mm512_maskz_loadu_epi16(avx512_mask32(remain - 32), src_ptr + 32);
+        _mm512_mask_storeu_epi8(dst_ptr, avx512_mask64(remain), avx512_pack_high_to_8bit<in_bit_depth>(z0, z1));
+    }
+}
+
+template<bool uv_only>
+static void RGY_FORCEINLINE convert_yv12_to_nv12_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    //Y成分のコピー
+    if (!uv_only) {
+        const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+        uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+            avx512_memcpy(dstLine, srcYLine, y_width);
+        }
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *dstLine = (uint8_t *)dst[1] + dst_y_pitch_byte * uv_range.start_dst;
+    const int uv_width = width - crop_right - crop_left;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+        interleave_uv_8bit_avx512bw(dstLine, srcULine, srcVLine, uv_width);
+    }
+}
+
+void convert_yv12_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_to_nv12_avx512bw_base<false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_uv_yv12_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_to_nv12_avx512bw_base<true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint16_t *dstLine = (uint16_t *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch) {
+        copy_line_8bit_to_16bit_avx512bw<8, (2 << 6)>(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    dstLine = (uint16_t *)dst[1] + dst_y_pitch * uv_range.start_dst;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch) {
+        interleave_uv_8bit_to_16bit_avx512bw<(2 << 6)>(dstLine, srcULine, srcVLine, y_width);
+    }
+}
+
+template<int in_bit_depth>
+static void RGY_FORCEINLINE convert_yv12_high_to_nv12_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+    uint8_t *dstLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch_byte) {
+        copy_line_high_to_8bit_avx512bw<in_bit_depth>(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    const __m512i zrsftAdd = _mm512_set1_epi16((short)conv_bit_depth_rsft_add_<8, in_bit_depth, 0>());
+    const __m512i zMax8bit = _mm512_set1_epi16(255);
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    uint16_t *srcULine = (uint16_t *)src[1] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    uint16_t *srcVLine = (uint16_t *)src[2] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    dstLine = (uint8_t *)dst[1] + dst_y_pitch_byte * uv_range.start_dst;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch_byte) {
+        uint16_t *src_u_ptr = srcULine;
+        uint16_t *src_v_ptr = srcVLine;
+        uint8_t *dst_ptr = dstLine;
+        for (int x = 0; x < y_width; x += 64, src_u_ptr += 32, src_v_ptr += 32, dst_ptr += 64) {
+            const int remain = y_width - x;
+            const __mmask32 maskSrc = avx512_mask32((remain + 1) >> 1);
+            __m512i z0 = _mm512_maskz_loadu_epi16(maskSrc, src_u_ptr);
+            __m512i z1 = _mm512_maskz_loadu_epi16(maskSrc, src_v_ptr);
+            z0 = _mm512_adds_epu16(z0, zrsftAdd);
+            z1 = _mm512_adds_epu16(z1, zrsftAdd);
+            z0 = _mm512_min_epu16(_mm512_srli_epi16(z0, in_bit_depth - 8), zMax8bit);
+            z1 = _mm512_min_epu16(_mm512_srli_epi16(z1, in_bit_depth - 8), zMax8bit);
+            z1 = _mm512_slli_epi16(z1, 8);
+            _mm512_mask_storeu_epi8(dst_ptr, avx512_mask64(remain), _mm512_or_si512(z0, z1));
+        }
+    }
+}
+
+void convert_yv12_16_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_avx512bw_base<16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_14_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_avx512bw_base<14>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_12_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_avx512bw_base<12>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_10_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_avx512bw_base<10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_09_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_avx512bw_base<9>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+template<int in_bit_depth>
+static void RGY_FORCEINLINE convert_yv12_high_to_p010_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+    uint16_t *dstLine = (uint16_t *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch) {
+        copy_line_high_to_high_avx512bw<in_bit_depth, 16>(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    uint16_t *srcULine = (uint16_t *)src[1] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    uint16_t *srcVLine = (uint16_t *)src[2] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    dstLine = (uint16_t *)dst[1] + dst_y_pitch * uv_range.start_dst;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch) {
+        interleave_uv_high_to_16bit_avx512bw<in_bit_depth>(dstLine, srcULine, srcVLine, y_width);
+    }
+}
+
+void convert_yv12_16_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_avx512bw_base<16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_14_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_avx512bw_base<14>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_12_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_avx512bw_base<12>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_10_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_avx512bw_base<10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_09_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_avx512bw_base<9>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv422_to_nv16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *dstLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+        avx512_memcpy(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * y_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * y_range.start_src) + (crop_left >> 1));
+    dstLine = (uint8_t *)dst[1] + dst_y_pitch_byte * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+        interleave_uv_8bit_avx512bw(dstLine, srcULine, srcVLine, y_width);
+    }
+}
+
+void convert_yuv422_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint16_t *dstLine = (uint16_t *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch) {
+        copy_line_8bit_to_16bit_avx512bw<8, 0>(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * y_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * y_range.start_src) + (crop_left >> 1));
+    dstLine = (uint16_t *)dst[1] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch) {
+        interleave_uv_8bit_to_16bit_avx512bw<0>(dstLine, srcULine, srcVLine, y_width);
+    }
+}
+
+template<int in_bit_depth>
+static void RGY_FORCEINLINE convert_yuv422_high_to_p210_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+    uint16_t *dstLine = (uint16_t *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch) {
+        copy_line_high_to_high_avx512bw<in_bit_depth, 16>(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    uint16_t *srcULine = (uint16_t *)src[1] + ((src_uv_pitch * y_range.start_src) + (crop_left >> 1));
+    uint16_t *srcVLine = (uint16_t *)src[2] + ((src_uv_pitch * y_range.start_src) + (crop_left >> 1));
+    dstLine = (uint16_t *)dst[1] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch) {
+        interleave_uv_high_to_16bit_avx512bw<in_bit_depth>(dstLine, srcULine, srcVLine, y_width);
+    }
+}
+
+void convert_yuv422_16_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv422_high_to_p210_avx512bw_base<16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv422_14_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv422_high_to_p210_avx512bw_base<14>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv422_12_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv422_high_to_p210_avx512bw_base<12>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv422_10_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv422_high_to_p210_avx512bw_base<10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv422_09_to_p210_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv422_high_to_p210_avx512bw_base<9>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void copy_yuv444_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    for (int i = 0; i < 3; i++) {
+        const uint8_t *srcYLine = (const uint8_t *)src[i] + src_y_pitch_byte * y_range.start_src + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[i] + dst_y_pitch_byte * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+            avx512_memcpy(dstLine, srcYLine, y_width);
+        }
+    }
+}
+
+template<int in_bit_depth, int out_bit_depth>
+static void RGY_FORCEINLINE convert_yuv444_high_to_yuv444_high_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    static_assert(8 < out_bit_depth && out_bit_depth <= 16, "out_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    for (int i = 0; i < 3; i++) {
+        const uint16_t *srcYLine = (const uint16_t *)src[i] + src_y_pitch * y_range.start_src + crop_left;
+        uint16_t *dstLine = (uint16_t *)dst[i] + dst_y_pitch * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch) {
+            copy_line_high_to_high_avx512bw<in_bit_depth, out_bit_depth>(dstLine, srcYLine, y_width);
+        }
+    }
+}
+
+void convert_yuv444_16_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_high_avx512bw_base<16, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_14_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_high_avx512bw_base<14, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_12_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_high_avx512bw_base<12, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_10_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_high_avx512bw_base<10, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_09_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_high_avx512bw_base<9, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_16_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_high_avx512bw_base<16, 10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_14_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_high_avx512bw_base<14, 10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_12_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_high_avx512bw_base<12, 10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_10_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_high_avx512bw_base<10, 10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_09_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_high_avx512bw_base<9, 10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+template<int out_bit_depth>
+static void RGY_FORCEINLINE convert_yuv444_to_yuv444_high_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < out_bit_depth && out_bit_depth <= 16, "out_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    for (int i = 0; i < 3; i++) {
+        uint8_t *srcYLine = (uint8_t *)src[i] + src_y_pitch_byte * y_range.start_src + crop_left;
+        uint16_t *dstLine = (uint16_t *)dst[i] + dst_y_pitch * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch) {
+            copy_line_8bit_to_16bit_avx512bw<out_bit_depth - 8, 0>(dstLine, srcYLine, y_width);
+        }
+    }
+}
+
+void convert_yuv444_to_yuv444_16_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_yuv444_high_avx512bw_base<16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_to_yuv444_10_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_yuv444_high_avx512bw_base<10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+template<int in_bit_depth>
+static void RGY_FORCEINLINE convert_yuv444_high_to_yuv444_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    for (int i = 0; i < 3; i++) {
+        uint16_t *srcYLine = (uint16_t *)src[i] + src_y_pitch * y_range.start_src + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[i] + dst_y_pitch_byte * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch_byte) {
+            copy_line_high_to_8bit_avx512bw<in_bit_depth>(dstLine, srcYLine, y_width);
+        }
+    }
+}
+
+void convert_yuv444_16_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_avx512bw_base<16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_14_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_avx512bw_base<14>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_12_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_avx512bw_base<12>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_10_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_avx512bw_base<10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_09_to_yuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_avx512bw_base<9>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+// 8bit Y,U,V 64画素分 -> VUYA 64画素分 (256byte)
+static RGY_FORCEINLINE void store_ayuv444_avx512bw(uint8_t *dst_ptr, __m512i pixY, __m512i pixU, __m512i pixV, const int remain) {
+    __m512i pixAY0 = _mm512_unpacklo_epi8(pixY, _mm512_setzero_si512());
+    __m512i pixAY1 = _mm512_unpackhi_epi8(pixY, _mm512_setzero_si512());
+    __m512i pixUV0 = _mm512_unpacklo_epi8(pixV, pixU);
+    __m512i pixUV1 = _mm512_unpackhi_epi8(pixV, pixU);
+    __m512i pixVUYA0 = _mm512_unpacklo_epi16(pixAY0, pixUV0); // 各レーンの画素  0- 3
+    __m512i pixVUYA1 = _mm512_unpackhi_epi16(pixAY0, pixUV0); // 各レーンの画素  4- 7
+    __m512i pixVUYA2 = _mm512_unpacklo_epi16(pixAY1, pixUV1); // 各レーンの画素  8-11
+    __m512i pixVUYA3 = _mm512_unpackhi_epi16(pixAY1, pixUV1); // 各レーンの画素 12-15
+    // 128bitレーンを4x4で転置して画素順に並べる
+    __m512i t0 = avx512_shuffle_i64x2<_MM_SHUFFLE(1, 0, 1, 0)>(pixVUYA0, pixVUYA1);
+    __m512i t1 = avx512_shuffle_i64x2<_MM_SHUFFLE(1, 0, 1, 0)>(pixVUYA2, pixVUYA3);
+    __m512i t2 = avx512_shuffle_i64x2<_MM_SHUFFLE(3, 2, 3, 2)>(pixVUYA0, pixVUYA1);
+    __m512i t3 = avx512_shuffle_i64x2<_MM_SHUFFLE(3, 2, 3, 2)>(pixVUYA2, pixVUYA3);
+    _mm512_mask_storeu_epi32(dst_ptr +   0, avx512_mask16(remain -  0), avx512_shuffle_i64x2<_MM_SHUFFLE(2, 0, 2, 0)>(t0, t1));
+    _mm512_mask_storeu_epi32(dst_ptr +  64, avx512_mask16(remain - 16), avx512_shuffle_i64x2<_MM_SHUFFLE(3, 1, 3, 1)>(t0, t1));
+    _mm512_mask_storeu_epi32(dst_ptr + 128, avx512_mask16(remain - 32), avx512_shuffle_i64x2<_MM_SHUFFLE(2, 0, 2, 0)>(t2, t3));
+    _mm512_mask_storeu_epi32(dst_ptr + 192, avx512_mask16(remain - 48), avx512_shuffle_i64x2<_MM_SHUFFLE(3, 1, 3, 1)>(t2, t3));
+}
+
+void copy_yuv444_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte  * y_range.start_src + crop_left;
+    uint8_t *srcULine = (uint8_t *)src[1] + src_uv_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *srcVLine = (uint8_t *)src[2] + src_uv_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *dstLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+    const int y_width = width - crop_right - crop_left;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+        uint8_t *src_y_ptr = srcYLine;
+        uint8_t *src_u_ptr = srcULine;
+        uint8_t *src_v_ptr = srcVLine;
+        uint8_t *dst_ptr = dstLine;
+        for (int x = 0; x < y_width; x += 64, src_y_ptr += 64, src_u_ptr += 64, src_v_ptr += 64, dst_ptr += 256) {
+            const int remain = y_width - x;
+            const __mmask64 mask = avx512_mask64(remain);
+            __m512i pixY = _mm512_maskz_loadu_epi8(mask, src_y_ptr);
+            __m512i pixU = _mm512_maskz_loadu_epi8(mask, src_u_ptr);
+            __m512i pixV = _mm512_maskz_loadu_epi8(mask, src_v_ptr);
+            store_ayuv444_avx512bw(dst_ptr, pixY, pixU, pixV, remain);
+        }
+    }
+}
+
+template<int in_bit_depth>
+static void RGY_FORCEINLINE copy_yuv444_high_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch  * y_range.start_src + crop_left;
+    uint16_t *srcULine = (uint16_t *)src[1] + src_uv_pitch * y_range.start_src + crop_left;
+    uint16_t *srcVLine = (uint16_t *)src[2] + src_uv_pitch * y_range.start_src + crop_left;
+    uint8_t *dstLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+    const int y_width = width - crop_right - crop_left;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch_byte) {
+        uint16_t *src_y_ptr = srcYLine;
+        uint16_t *src_u_ptr = srcULine;
+        uint16_t *src_v_ptr = srcVLine;
+        uint8_t *dst_ptr = dstLine;
+        for (int x = 0; x < y_width; x += 64, src_y_ptr += 64, src_u_ptr += 64, src_v_ptr += 64, dst_ptr += 256) {
+            const int remain = y_width - x;
+            const __mmask32 mask0 = avx512_mask32(remain);
+            const __mmask32 mask1 = avx512_mask32(remain - 32);
+            __m512i pixY = avx512_pack_high_to_8bit<in_bit_depth>(_mm512_maskz_loadu_epi16(mask0, src_y_ptr), _mm512_maskz_loadu_epi16(mask1, src_y_ptr + 32));
+            __m512i pixU = avx512_pack_high_to_8bit<in_bit_depth>(_mm512_maskz_loadu_epi16(mask0, src_u_ptr), _mm512_maskz_loadu_epi16(mask1, src_u_ptr + 32));
+            __m512i pixV = avx512_pack_high_to_8bit<in_bit_depth>(_mm512_maskz_loadu_epi16(mask0, src_v_ptr), _mm512_maskz_loadu_epi16(mask1, src_v_ptr + 32));
+            store_ayuv444_avx512bw(dst_ptr, pixY, pixU, pixV, remain);
+        }
+    }
+}
+
+void copy_yuv444_16_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    copy_yuv444_high_to_ayuv444_avx512bw<16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void copy_yuv444_14_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    copy_yuv444_high_to_ayuv444_avx512bw<14>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void copy_yuv444_12_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    copy_yuv444_high_to_ayuv444_avx512bw<12>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void copy_yuv444_10_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    copy_yuv444_high_to_ayuv444_avx512bw<10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void copy_yuv444_09_to_ayuv444_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    copy_yuv444_high_to_ayuv444_avx512bw<9>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+#pragma warning (pop)
+
+#endif //#if defined(_MSC_VER) || defined(__AVX512BW__)
+#endif //#if defined(_M_X64) || defined(__x86_64)
@@ -0,0 +1,288 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2011-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#if defined(_M_X64) || defined(__x86_64)
+#define USE_SSE2  1
+#define USE_SSSE3 1
+#define USE_SSE41 1
+#define USE_AVX   1
+#define USE_AVX2  1
+#define USE_AVX512 1
+#include <immintrin.h>
+#include "rgy_simd.h"
+#include <stdint.h>
+#include <string.h>
+#include "convert_csp.h"
+
+#if _MSC_VER >= 1800 && !defined(__AVX512BW__) && !defined(_DEBUG)
+static_assert(false, "do not forget to set /arch:AVX512 for this file.");
+#endif
+
+#if defined(_MSC_VER) || defined(__AVX512VBMI__)
+#include "convert_csp_avx512.h"
+
+// AVX512VBMIのvpermb/vpermt2bは2本のzmmレジスタから任意のbyteを1命令で取り出せるので、
+// AVX512BW版で vpermq + unpack/packus + cvtepu8 + シフト の組み合わせで行っていた
+// 8bitのインターリーブ/デインターリーブ/16bitへの拡張をそれぞれ1命令で行う
+// 結果はAVX512BW版/C版とビット単位で一致する
+
+// 奇数byteのみ書き込むマスク (16bitの上位byteに8bitの値を置く = 8bit左シフト)
+static const __mmask64 VBMI_MASK_HIGH_BYTE = (__mmask64)0xAAAAAAAAAAAAAAAAull;
+
+// idx[i] = (i & 1) ? 64 + base + (i >> 1) : base + (i >> 1) : a,bを1byteずつ交互に並べる
+static RGY_FORCEINLINE __m512i vbmi_idx_interleave_8(int base) {
+    alignas(64) uint8_t idx[64];
+    for (int i = 0; i < 64; i++) {
+        idx[i] = (uint8_t)(((i & 1) ? 64 : 0) + base + (i >> 1));
+    }
+    return _mm512_load_si512(idx);
+}
+
+// idx[2i+1] = ((i & 1) ? 64 : 0) + base + (i >> 1) : a,bを交互に16bitの上位byteに並べる (偶数byteはマスクで0)
+static RGY_FORCEINLINE __m512i vbmi_idx_interleave_8_to_16(int base) {
+    alignas(64) uint8_t idx[64];
+    for (int i = 0; i < 32; i++) {
+        idx[2 * i + 0] = 0;
+        idx[2 * i + 1] = (uint8_t)(((i & 1) ? 64 : 0) + base + (i >> 1));
+    }
+    return _mm512_load_si512(idx);
+}
+
+// idx[2i+1] = base + i : 16bitの上位byteに並べる (偶数byteはマスクで0)
+static RGY_FORCEINLINE __m512i vbmi_idx_expand_8_to_16(int base) {
+    alignas(64) uint8_t idx[64];
+    for (int i = 0; i < 32; i++) {
+        idx[2 * i + 0] = 0;
+        idx[2 * i + 1] = (uint8_t)(base + i);
+    }
+    return _mm512_load_si512(idx);
+}
+
+// idx[i] = 2i + odd : 2本のzmmから偶数(奇数)byteを取り出す
+static RGY_FORCEINLINE __m512i vbmi_idx_deinterleave_8(int odd) {
+    alignas(64) uint8_t idx[64];
+    for (int i = 0; i < 64; i++) {
+        idx[i] = (uint8_t)(2 * i + odd);
+    }
+    return _mm512_load_si512(idx);
+}
+
+#pragma warning (push)
+#pragma warning (disable: 4100)
+#pragma warning (disable: 4127)
+void convert_yuy2_to_nv12_avx512vbmi(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const void *src = src_array[0];
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *dstYLine = (uint8_t *)dst_array[0] + dst_y_pitch_byte * y_range.start_dst;
+    uint8_t *dstCLine = (uint8_t *)dst_array[1] + dst_y_pitch_byte * (y_range.start_dst >> 1);
+    const __m512i zIdxY = vbmi_idx_deinterleave_8(0);
+    const __m512i zIdxC = vbmi_idx_deinterleave_8(1);
+    for (int y = 0; y < y_range.len; y += 2) {
+        uint8_t *p = srcLine;
+        uint8_t *pw = p + src_y_pitch_byte;
+        const int x_fin = width - crop_right - crop_left;
+        for (int x = 0; x < x_fin; x += 64, p += 128, pw += 128) {
+            const int remain = x_fin - x;
+            const __mmask64 mask0 = avx512_mask64(remain * 2);
+            const __mmask64 mask1 = avx512_mask64(remain * 2 - 64);
+            const __mmask64 maskDst = avx512_mask64(remain);
+            //-----------1行目---------------
+            __m512i z0 = _mm512_maskz_loadu_epi8(mask0, p +  0);
+            __m512i z1 = _mm512_maskz_loadu_epi8(mask1, p + 64);
+            _mm512_mask_storeu_epi8(dstYLine + x, maskDst, _mm512_permutex2var_epi8(z0, zIdxY, z1));
+            __m512i zC0 = _mm512_permutex2var_epi8(z0, zIdxC, z1);
+            //-----------1行目終了---------------
+
+            //-----------2行目---------------
+            z0 = _mm512_maskz_loadu_epi8(mask0, pw +  0);
+            z1 = _mm512_maskz_loadu_epi8(mask1, pw + 64);
+            _mm512_mask_storeu_epi8(dstYLine + dst_y_pitch_byte + x, maskDst, _mm512_permutex2var_epi8(z0, zIdxY, z1));
+            __m512i zC1 = _mm512_permutex2var_epi8(z0, zIdxC, z1);
+            //-----------2行目終了---------------
+
+            zC0 = _mm512_avg_epu8(zC0, zC1); //UVUVUVUV
+            _mm512_mask_storeu_epi8(dstCLine + x, maskDst, zC0);
+        }
+        srcLine  += src_y_pitch_byte << 1;
+        dstYLine += dst_y_pitch_byte << 1;
+        dstCLine += dst_y_pitch_byte;
+    }
+}
+
+//8bit UV -> NV12/NV16形式のUV (uv_width: 出力のバイト数)
+static RGY_FORCEINLINE void interleave_uv_8bit_avx512vbmi(uint8_t *dst_ptr, const uint8_t *src_u_ptr, const uint8_t *src_v_ptr, const int uv_width) {
+    const __m512i zIdxLo = vbmi_idx_interleave_8(0);
+    const __m512i zIdxHi = vbmi_idx_interleave_8(32);
+    for (int x = 0; x < uv_width; x += 128, src_u_ptr += 64, src_v_ptr += 64, dst_ptr += 128) {
+        const int remain = uv_width - x;
+        const __mmask64 maskSrc = avx512_mask64((remain + 1) >> 1);
+        const __m512i z0 = _mm512_maskz_loadu_epi8(maskSrc, src_u_ptr);
+        const __m512i z1 = _mm512_maskz_loadu_epi8(maskSrc, src_v_ptr);
+        _mm512_mask_storeu_epi8(dst_ptr +  0, avx512_mask64(remain),      _mm512_permutex2var_epi8(z0, zIdxLo, z1));
+        _mm512_mask_storeu_epi8(dst_ptr + 64, avx512_mask64(remain - 64), _mm512_permutex2var_epi8(z0, zIdxHi, z1));
+    }
+}
+
+//8bit UV -> P010/P210形式のUV (uv_width: 出力の画素数)
+template<int offset>
+static RGY_FORCEINLINE void interleave_uv_8bit_to_16bit_avx512vbmi(uint16_t *dst_ptr, const uint8_t *src_u_ptr, const uint8_t *src_v_ptr, const int uv_width) {
+    const __m512i zOffset = _mm512_set1_epi16(offset);
+    const __m512i zIdx0 = vbmi_idx_interleave_8_to_16( 0);
+    const __m512i zIdx1 = vbmi_idx_interleave_8_to_16(16);
+    const __m512i zIdx2 = vbmi_idx_interleave_8_to_16(32);
+    const __m512i zIdx3 = vbmi_idx_interleave_8_to_16(48);
+    for (int x = 0; x < uv_width; x += 128, src_u_ptr += 64, src_v_ptr += 64, dst_ptr += 128) {
+        const int remain = uv_width - x;
+        const __mmask64 maskSrc = avx512_mask64((remain + 1) >> 1);
+        const __m512i z0 = _mm512_maskz_loadu_epi8(maskSrc, src_u_ptr);
+        const __m512i z1 = _mm512_maskz_loadu_epi8(maskSrc, src_v_ptr);
+        __m512i z2 = _mm512_maskz_permutex2var_epi8(VBMI_MASK_HIGH_BYTE, z0, zIdx0, z1);
+        __m512i z3 = _mm512_maskz_permutex2var_epi8(VBMI_MASK_HIGH_BYTE, z0, zIdx1, z1);
+        __m512i z4 = _mm512_maskz_permutex2var_epi8(VBMI_MASK_HIGH_BYTE, z0, zIdx2, z1);
+        __m512i z5 = _mm512_maskz_permutex2var_epi8(VBMI_MASK_HIGH_BYTE, z0, zIdx3, z1);
+        if (offset) {
+            z2 = _mm512_add_epi16(z2, zOffset);
+            z3 = _mm512_add_epi16(z3, zOffset);
+            z4 = _mm512_add_epi16(z4, zOffset);
+            z5 = _mm512_add_epi16(z5, zOffset);
+        }
+        _mm512_mask_storeu_epi16(dst_ptr +  0, avx512_mask32(remain -  0), z2);
+        _mm512_mask_storeu_epi16(dst_ptr + 32, avx512_mask32(remain - 32), z3);
+        _mm512_mask_storeu_epi16(dst_ptr + 64, avx512_mask32(remain - 64), z4);
+        _mm512_mask_storeu_epi16(dst_ptr + 96, avx512_mask32(remain - 96), z5);
+    }
+}
+
+//8bit -> 16bit (8bit左シフト, offset)
+template<int offset>
+static RGY_FORCEINLINE void copy_line_8bit_to_16bit_avx512vbmi(uint16_t *dst_ptr, const uint8_t *src_ptr, const int y_width) {
+    const __m512i zOffset = _mm512_set1_epi16(offset);
+    const __m512i zIdxLo = vbmi_idx_expand_8_to_16(0);
+    const __m512i zIdxHi = vbmi_idx_expand_8_to_16(32);
+    for (int x = 0; x < y_width; x += 64, dst_ptr += 64, src_ptr += 64) {
+        const int remain = y_width - x;
+        const __m512i z = _mm512_maskz_loadu_epi8(avx512_mask64(remain), src_ptr);
+        __m512i z0 = _mm512_maskz_permutexvar_epi8(VBMI_MASK_HIGH_BYTE, zIdxLo, z);
+        __m512i z1 = _mm512_maskz_permutexvar_epi8(VBMI_MASK_HIGH_BYTE, zIdxHi, z);
+        if (offset) {
+            z0 = _mm512_add_epi16(z0, zOffset);
+            z1 = _mm512_add_epi16(z1, zOffset);
+        }
+        _mm512_mask_storeu_epi16(dst_ptr +  0, avx512_mask32(remain),      z0);
+        _mm512_mask_storeu_epi16(dst_ptr + 32, avx512_mask32(remain - 32), z1);
+    }
+}
+
+template<bool uv_only>
+static void RGY_FORCEINLINE convert_yv12_to_nv12_avx512vbmi_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    //Y成分のコピー
+    if (!uv_only) {
+        const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+        uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+            avx512_memcpy(dstLine, srcYLine, y_width);
+        }
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *dstLine = (uint8_t *)dst[1] + dst_y_pitch_byte * uv_range.start_dst;
+    const int uv_width = width - crop_right - crop_left;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+        interleave_uv_8bit_avx512vbmi(dstLine, srcULine, srcVLine, uv_width);
+    }
+}
+
+void convert_yv12_to_nv12_avx512vbmi(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_to_nv12_avx512vbmi_base<false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_uv_yv12_to_nv12_avx512vbmi(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_to_nv12_avx512vbmi_base<true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_to_p010_avx512vbmi(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint16_t *dstLine = (uint16_t *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch) {
+        copy_line_8bit_to_16bit_avx512vbmi<(2 << 6)>(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    dstLine = (uint16_t *)dst[1] + dst_y_pitch * uv_range.start_dst;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch) {
+        interleave_uv_8bit_to_16bit_avx512vbmi<(2 << 6)>(dstLine, srcULine, srcVLine, y_width);
+    }
+}
+
+void convert_yuv422_to_nv16_avx512vbmi(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *dstLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+        avx512_memcpy(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * y_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * y_range.start_src) + (crop_left >> 1));
+    dstLine = (uint8_t *)dst[1] + dst_y_pitch_byte * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+        interleave_uv_8bit_avx512vbmi(dstLine, srcULine, srcVLine, y_width);
+    }
+}
+#pragma warning (pop)
+
+#endif //#if defined(_MSC_VER) || defined(__AVX512VBMI__)
+#endif //#if defined(_M_X64) || defined(__x86_64)
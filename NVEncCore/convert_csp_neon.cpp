@@ -0,0 +1,417 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2011-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+#include <arm_neon.h>
+#include "rgy_simd.h"
+#include <stdint.h>
+#include <string.h>
+#include "convert_csp.h"
+
+// 行末の端数はスカラーで処理するので、pitchの余白への書き込み(はみ出し)を前提としない
+
+//16bit -> 8bit (丸め付き右シフト + 飽和)
+template<int in_bit_depth>
+static RGY_FORCEINLINE uint8x16_t neon_pack_high_to_8bit(uint16x8_t x0, uint16x8_t x1) {
+    return vcombine_u8(vqrshrn_n_u16(x0, in_bit_depth - 8), vqrshrn_n_u16(x1, in_bit_depth - 8));
+}
+
+//8bit UV -> NV12/NV16形式のUV (uv_pairs: 出力のUVの組の数)
+static RGY_FORCEINLINE void interleave_uv_8bit_neon(uint8_t *dst_ptr, const uint8_t *src_u_ptr, const uint8_t *src_v_ptr, const int uv_pairs) {
+    int x = 0;
+    for (; x <= uv_pairs - 16; x += 16) {
+        uint8x16x2_t uv;
+        uv.val[0] = vld1q_u8(src_u_ptr + x);
+        uv.val[1] = vld1q_u8(src_v_ptr + x);
+        vst2q_u8(dst_ptr + x * 2, uv);
+    }
+    for (; x < uv_pairs; x++) {
+        dst_ptr[2*x+0] = src_u_ptr[x];
+        dst_ptr[2*x+1] = src_v_ptr[x];
+    }
+}
+
+//8bit UV -> P010形式のUV (uv_pairs: 出力のUVの組の数)
+static RGY_FORCEINLINE void interleave_uv_8bit_to_p010_neon(uint16_t *dst_ptr, const uint8_t *src_u_ptr, const uint8_t *src_v_ptr, const int uv_pairs) {
+    const uint16x8_t xOffset = vdupq_n_u16(2 << 6);
+    int x = 0;
+    for (; x <= uv_pairs - 16; x += 16) {
+        const uint8x16_t u = vld1q_u8(src_u_ptr + x);
+        const uint8x16_t v = vld1q_u8(src_v_ptr + x);
+        uint16x8x2_t uv0, uv1;
+        uv0.val[0] = vaddq_u16(vshll_n_u8(vget_low_u8(u), 8), xOffset);
+        uv0.val[1] = vaddq_u16(vshll_n_u8(vget_low_u8(v), 8), xOffset);
+        uv1.val[0] = vaddq_u16(vshll_n_u8(vget_high_u8(u), 8), xOffset);
+        uv1.val[1] = vaddq_u16(vshll_n_u8(vget_high_u8(v), 8), xOffset);
+        vst2q_u16(dst_ptr + x * 2 +  0, uv0);
+        vst2q_u16(dst_ptr + x * 2 + 16, uv1);
+    }
+    for (; x < uv_pairs; x++) {
+        dst_ptr[2*x+0] = (uint16_t)((((uint32_t)src_u_ptr[x]) << 8) + (2 << 6));
+        dst_ptr[2*x+1] = (uint16_t)((((uint32_t)src_v_ptr[x]) << 8) + (2 << 6));
+    }
+}
+
+//16bit UV -> NV12形式のUV (uv_pairs: 出力のUVの組の数)
+template<int in_bit_depth>
+static RGY_FORCEINLINE void interleave_uv_high_to_8bit_neon(uint8_t *dst_ptr, const uint16_t *src_u_ptr, const uint16_t *src_v_ptr, const int uv_pairs) {
+    int x = 0;
+    for (; x <= uv_pairs - 16; x += 16) {
+        uint8x16x2_t uv;
+        uv.val[0] = neon_pack_high_to_8bit<in_bit_depth>(vld1q_u16(src_u_ptr + x), vld1q_u16(src_u_ptr + x + 8));
+        uv.val[1] = neon_pack_high_to_8bit<in_bit_depth>(vld1q_u16(src_v_ptr + x), vld1q_u16(src_v_ptr + x + 8));
+        vst2q_u8(dst_ptr + x * 2, uv);
+    }
+    for (; x < uv_pairs; x++) {
+        dst_ptr[2*x+0] = (uint8_t)conv_bit_depth_<8, in_bit_depth, 0>(src_u_ptr[x]);
+        dst_ptr[2*x+1] = (uint8_t)conv_bit_depth_<8, in_bit_depth, 0>(src_v_ptr[x]);
+    }
+}
+
+//16bit UV -> P010形式のUV (uv_pairs: 出力のUVの組の数)
+template<int in_bit_depth>
+static RGY_FORCEINLINE void interleave_uv_high_to_16bit_neon(uint16_t *dst_ptr, const uint16_t *src_u_ptr, const uint16_t *src_v_ptr, const int uv_pairs) {
+    int x = 0;
+    for (; x <= uv_pairs - 8; x += 8) {
+        uint16x8x2_t uv;
+        uv.val[0] = vshlq_n_u16(vld1q_u16(src_u_ptr + x), 16 - in_bit_depth);
+        uv.val[1] = vshlq_n_u16(vld1q_u16(src_v_ptr + x), 16 - in_bit_depth);
+        vst2q_u16(dst_ptr + x * 2, uv);
+    }
+    for (; x < uv_pairs; x++) {
+        dst_ptr[2*x+0] = (uint16_t)conv_bit_depth_<16, in_bit_depth, 0>(src_u_ptr[x]);
+        dst_ptr[2*x+1] = (uint16_t)conv_bit_depth_<16, in_bit_depth, 0>(src_v_ptr[x]);
+    }
+}
+
+//8bit -> P010 (<<8 + offset)
+static RGY_FORCEINLINE void copy_line_8bit_to_p010_neon(uint16_t *dst_ptr, const uint8_t *src_ptr, const int y_width) {
+    const uint16x8_t xOffset = vdupq_n_u16(2 << 6);
+    int x = 0;
+    for (; x <= y_width - 16; x += 16) {
+        const uint8x16_t y = vld1q_u8(src_ptr + x);
+        vst1q_u16(dst_ptr + x + 0, vaddq_u16(vshll_n_u8(vget_low_u8(y),  8), xOffset));
+        vst1q_u16(dst_ptr + x + 8, vaddq_u16(vshll_n_u8(vget_high_u8(y), 8), xOffset));
+    }
+    for (; x < y_width; x++) {
+        dst_ptr[x] = (uint16_t)((((uint32_t)src_ptr[x]) << 8) + (2 << 6));
+    }
+}
+
+//16bit -> 8bit
+template<int in_bit_depth>
+static RGY_FORCEINLINE void copy_line_high_to_8bit_neon(uint8_t *dst_ptr, const uint16_t *src_ptr, const int y_width) {
+    int x = 0;
+    for (; x <= y_width - 16; x += 16) {
+        vst1q_u8(dst_ptr + x, neon_pack_high_to_8bit<in_bit_depth>(vld1q_u16(src_ptr + x), vld1q_u16(src_ptr + x + 8)));
+    }
+    for (; x < y_width; x++) {
+        dst_ptr[x] = (uint8_t)conv_bit_depth_<8, in_bit_depth, 0>(src_ptr[x]);
+    }
+}
+
+//16bit -> 16bit (左シフト)
+template<int in_bit_depth>
+static RGY_FORCEINLINE void copy_line_high_to_16bit_neon(uint16_t *dst_ptr, const uint16_t *src_ptr, const int y_width) {
+    if (in_bit_depth == 16) {
+        memcpy(dst_ptr, src_ptr, y_width * sizeof(uint16_t));
+        return;
+    }
+    int x = 0;
+    for (; x <= y_width - 16; x += 16) {
+        vst1q_u16(dst_ptr + x + 0, vshlq_n_u16(vld1q_u16(src_ptr + x + 0), 16 - in_bit_depth));
+        vst1q_u16(dst_ptr + x + 8, vshlq_n_u16(vld1q_u16(src_ptr + x + 8), 16 - in_bit_depth));
+    }
+    for (; x < y_width; x++) {
+        dst_ptr[x] = (uint16_t)conv_bit_depth_<16, in_bit_depth, 0>(src_ptr[x]);
+    }
+}
+
+#pragma warning (push)
+#pragma warning (disable: 4100)
+#pragma warning (disable: 4127)
+void convert_yuy2_to_nv12_neon(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const void *src = src_array[0];
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    const uint8_t *srcLine = (const uint8_t *)src + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *dstYLine = (uint8_t *)dst_array[0] + dst_y_pitch_byte * y_range.start_dst;
+    uint8_t *dstCLine = (uint8_t *)dst_array[1] + dst_y_pitch_byte * (y_range.start_dst >> 1);
+    const int x_fin = width - crop_right - crop_left;
+    for (int y = 0; y < y_range.len; y += 2) {
+        const uint8_t *p = srcLine;
+        const uint8_t *pw = p + src_y_pitch_byte;
+        int x = 0;
+        //YUYVを4要素にdeinterleaveすると Y0, U, Y1, V となる
+        for (; x <= x_fin - 32; x += 32, p += 64, pw += 64) {
+            const uint8x16x4_t yuyv0 = vld4q_u8(p);
+            const uint8x16x4_t yuyv1 = vld4q_u8(pw);
+            uint8x16x2_t y0, y1, uv;
+            y0.val[0] = yuyv0.val[0];
+            y0.val[1] = yuyv0.val[2];
+            y1.val[0] = yuyv1.val[0];
+            y1.val[1] = yuyv1.val[2];
+            uv.val[0] = vrhaddq_u8(yuyv0.val[1], yuyv1.val[1]);
+            uv.val[1] = vrhaddq_u8(yuyv0.val[3], yuyv1.val[3]);
+            vst2q_u8(dstYLine + x, y0);
+            vst2q_u8(dstYLine + dst_y_pitch_byte + x, y1);
+            vst2q_u8(dstCLine + x, uv);
+        }
+        for (; x < x_fin; x += 2, p += 4, pw += 4) {
+            dstYLine[x + 0] = p[0];
+            dstYLine[x + 1] = p[2];
+            dstYLine[dst_y_pitch_byte + x + 0] = pw[0];
+            dstYLine[dst_y_pitch_byte + x + 1] = pw[2];
+            dstCLine[x + 0] = (uint8_t)((p[1] + pw[1] + 1) >> 1);
+            dstCLine[x + 1] = (uint8_t)((p[3] + pw[3] + 1) >> 1);
+        }
+        srcLine  += src_y_pitch_byte << 1;
+        dstYLine += dst_y_pitch_byte << 1;
+        dstCLine += dst_y_pitch_byte;
+    }
+}
+
+template<bool uv_only>
+static void RGY_FORCEINLINE convert_yv12_to_nv12_neon_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    //Y成分のコピー
+    if (!uv_only) {
+        const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+        uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+            memcpy(dstLine, srcYLine, y_width);
+        }
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *dstLine = (uint8_t *)dst[1] + dst_y_pitch_byte * uv_range.start_dst;
+    const int uv_pairs = (width - crop_right - crop_left) >> 1;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+        interleave_uv_8bit_neon(dstLine, srcULine, srcVLine, uv_pairs);
+    }
+}
+
+void convert_yv12_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_to_nv12_neon_base<false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_uv_yv12_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_to_nv12_neon_base<true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint16_t *dstLine = (uint16_t *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch) {
+        copy_line_8bit_to_p010_neon(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    dstLine = (uint16_t *)dst[1] + dst_y_pitch * uv_range.start_dst;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch) {
+        interleave_uv_8bit_to_p010_neon(dstLine, srcULine, srcVLine, (y_width + 1) >> 1);
+    }
+}
+
+template<int in_bit_depth>
+static void RGY_FORCEINLINE convert_yv12_high_to_nv12_neon_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+    uint8_t *dstLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch_byte) {
+        copy_line_high_to_8bit_neon<in_bit_depth>(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    uint16_t *srcULine = (uint16_t *)src[1] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    uint16_t *srcVLine = (uint16_t *)src[2] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    dstLine = (uint8_t *)dst[1] + dst_y_pitch_byte * uv_range.start_dst;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch_byte) {
+        interleave_uv_high_to_8bit_neon<in_bit_depth>(dstLine, srcULine, srcVLine, y_width >> 1);
+    }
+}
+
+template<int in_bit_depth>
+static void RGY_FORCEINLINE convert_yv12_high_to_p010_neon_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    const int y_width = width - crop_right - crop_left;
+    //Y成分のコピー
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+    uint16_t *dstLine = (uint16_t *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch) {
+        copy_line_high_to_16bit_neon<in_bit_depth>(dstLine, srcYLine, y_width);
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    uint16_t *srcULine = (uint16_t *)src[1] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    uint16_t *srcVLine = (uint16_t *)src[2] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    dstLine = (uint16_t *)dst[1] + dst_y_pitch * uv_range.start_dst;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch) {
+        interleave_uv_high_to_16bit_neon<in_bit_depth>(dstLine, srcULine, srcVLine, y_width >> 1);
+    }
+}
+
+template<int in_bit_depth, int out_bit_depth>
+static void RGY_FORCEINLINE convert_yuv444_high_to_yuv444_neon_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    static_assert(out_bit_depth == 8 || out_bit_depth == 16, "out_bit_depth must be 8 or 16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int y_width = width - crop_right - crop_left;
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    for (int i = 0; i < 3; i++) {
+        uint16_t *srcLine = (uint16_t *)src[i] + src_y_pitch * y_range.start_src + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[i] + dst_y_pitch_byte * y_range.start_dst;
+        for (int y = 0; y < y_range.len; y++, srcLine += src_y_pitch, dstLine += dst_y_pitch_byte) {
+            if (out_bit_depth == 8) {
+                copy_line_high_to_8bit_neon<in_bit_depth>(dstLine, srcLine, y_width);
+            } else {
+                copy_line_high_to_16bit_neon<in_bit_depth>((uint16_t *)dstLine, srcLine, y_width);
+            }
+        }
+    }
+}
+
+void convert_yv12_16_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_neon_base<16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_14_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_neon_base<14>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_12_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_neon_base<12>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_10_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_neon_base<10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_09_to_nv12_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_neon_base<9>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_16_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_neon_base<16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_14_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_neon_base<14>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_12_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_neon_base<12>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_10_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_neon_base<10>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_09_to_p010_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_neon_base<9>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_16_to_yuv444_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_neon_base<16, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_14_to_yuv444_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_neon_base<14, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_12_to_yuv444_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_neon_base<12, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_10_to_yuv444_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_neon_base<10, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_09_to_yuv444_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_neon_base<9, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_14_to_yuv444_16_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_neon_base<14, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_12_to_yuv444_16_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_neon_base<12, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_10_to_yuv444_16_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_neon_base<10, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_09_to_yuv444_16_neon(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_high_to_yuv444_neon_base<9, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+#pragma warning (pop)
+
+#endif //#if defined(_M_ARM64) || defined(__aarch64__)
@@ -522,8 +522,8 @@ static void RGY_FORCEINLINE convert_rgb24_to_rgb_simd(void **dst, const void **s
             _mm_storeu_si128((__m128i *)ptr_dst1, x1);
             _mm_storeu_si128((__m128i *)ptr_dst2, x2);
         }
-        if (width & 15) {
-            int x_offset = (16 - (width & 15));
+        if (x_fin & 15) { //クロップ後の幅の端数
+            int x_offset = (16 - (x_fin & 15));
             ptr_src -= x_offset * 3;
             ptr_dst0 -= x_offset;
             ptr_dst1 -= x_offset;
@@ -589,8 +589,8 @@ static void RGY_FORCEINLINE convert_rgb_to_rgb24_simd(void **dst, const void **s
             _mm_storeu_si128((__m128i *)(ptr_dst + 16), x1);
             _mm_storeu_si128((__m128i *)(ptr_dst + 32), x2);
         }
-        if (width & 15) {
-            int x_offset = (16 - (width & 15));
+        if (x_fin & 15) { //クロップ後の幅の端数
+            int x_offset = (16 - (x_fin & 15));
             ptr_dst -= x_offset * 3;
             ptr_srcR -= x_offset;
             ptr_srcG -= x_offset;
@@ -661,11 +661,11 @@ static void RGY_FORCEINLINE convert_rgb32_to_rgba_simd(void **dst, const void **
             if constexpr (plane_from0 != 0xff) _mm_storeu_si128((__m128i *)ptr_dst0, x0);
             if constexpr (plane_from1 != 0xff) _mm_storeu_si128((__m128i *)ptr_dst1, x1);
             if constexpr (plane_from2 != 0xff) _mm_storeu_si128((__m128i *)ptr_dst2, x2);
-            if constexpr (plane_from3 != 0xff) _mm_storeu_si128((__m128i *)ptr_dst3, x2);
+            if constexpr (plane_from3 != 0xff) _mm_storeu_si128((__m128i *)ptr_dst3, x3);
         }
-        if (width & 15) {
-            int x_offset = (16 - (width & 15));
-            ptr_src -= x_offset * 3;
+        if (x_fin & 15) { //クロップ後の幅の端数
+            int x_offset = (16 - (x_fin & 15));
+            ptr_src -= x_offset * 4;
             ptr_dst0 -= x_offset;
             ptr_dst1 -= x_offset;
             ptr_dst2 -= x_offset;
@@ -730,9 +730,9 @@ static void RGY_FORCEINLINE convert_rgb_to_rgb32_simd(void **dst, const void **s
             _mm_storeu_si128((__m128i *)(ptr_dst + 32), x2);
             _mm_storeu_si128((__m128i *)(ptr_dst + 48), x3);
         }
-        if (width & 15) {
-            int x_offset = (16 - (width & 15));
-            ptr_dst -= x_offset * 3;
+        if (x_fin & 15) { //クロップ後の幅の端数
+            int x_offset = (16 - (x_fin & 15));
+            ptr_dst -= x_offset * 4;
             ptr_srcR -= x_offset;
             ptr_srcG -= x_offset;
             ptr_srcB -= x_offset;
@@ -1013,8 +1013,8 @@ static void convert_yv12_high_to_nv12_simd(void **dst, const void **src, int wid
                 x0 = _mm_loadu_si128((const __m128i *)(src_ptr + 0));
                 x1 = _mm_loadu_si128((const __m128i *)(src_ptr + 8));
 
-                x0 = _mm_adds_epi16(x0, xrsftAdd);
-                x1 = _mm_adds_epi16(x1, xrsftAdd);
+                x0 = _mm_adds_epu16(x0, xrsftAdd);
+                x1 = _mm_adds_epu16(x1, xrsftAdd);
 
                 x0 = _mm_srli_epi16(x0, in_bit_depth - 8);
                 x1 = _mm_srli_epi16(x1, in_bit_depth - 8);
@@ -1042,15 +1042,14 @@ static void convert_yv12_high_to_nv12_simd(void **dst, const void **src, int wid
             x0 = _mm_loadu_si128((const __m128i *)src_u_ptr);
             x1 = _mm_loadu_si128((const __m128i *)src_v_ptr);
 
-            x0 = _mm_adds_epi16(x0, xrsftAdd);
-            x1 = _mm_adds_epi16(x1, xrsftAdd);
+            x0 = _mm_adds_epu16(x0, xrsftAdd);
+            x1 = _mm_adds_epu16(x1, xrsftAdd);
 
             x0 = _mm_srli_epi16(x0, in_bit_depth - 8);
-            x1 = _mm_slli_epi16(x1, 16 - in_bit_depth);
-            const __m128i xMaskHighByte = _mm_slli_epi16(_mm_cmpeq_epi8(_mm_setzero_si128(), _mm_setzero_si128()), 8);
-            x1 = _mm_and_si128(x1, xMaskHighByte);
+            x1 = _mm_srli_epi16(x1, in_bit_depth - 8);
 
-            x0 = _mm_or_si128(x0, x1);
+            //飽和packで上限をクリップしてからUVを交互に並べる
+            x0 = _mm_unpacklo_epi8(_mm_packus_epi16(x0, x0), _mm_packus_epi16(x1, x1));
 
             _mm_storeu_si128((__m128i *)(dst_ptr +  0), x0);
         }
@@ -1298,12 +1297,12 @@ static void RGY_FORCEINLINE copy_yuv444_high_to_ayuv444(void **dst, const void *
             __m128i pixY1 = _mm_loadu_si128((const __m128i *)(src_y_ptr + 8));
             __m128i pixU1 = _mm_loadu_si128((const __m128i *)(src_u_ptr + 8));
             __m128i pixV1 = _mm_loadu_si128((const __m128i *)(src_v_ptr + 8));
-            pixY0 = _mm_adds_epi16(pixY0, xrsftAdd);
-            pixU0 = _mm_adds_epi16(pixU0, xrsftAdd);
-            pixV0 = _mm_adds_epi16(pixV0, xrsftAdd);
-            pixY1 = _mm_adds_epi16(pixY1, xrsftAdd);
-            pixU1 = _mm_adds_epi16(pixU1, xrsftAdd);
-            pixV1 = _mm_adds_epi16(pixV1, xrsftAdd);
+            pixY0 = _mm_adds_epu16(pixY0, xrsftAdd);
+            pixU0 = _mm_adds_epu16(pixU0, xrsftAdd);
+            pixV0 = _mm_adds_epu16(pixV0, xrsftAdd);
+            pixY1 = _mm_adds_epu16(pixY1, xrsftAdd);
+            pixU1 = _mm_adds_epu16(pixU1, xrsftAdd);
+            pixV1 = _mm_adds_epu16(pixV1, xrsftAdd);
             pixY0 = _mm_srli_epi16(pixY0, in_bit_depth - 8);
             pixU0 = _mm_srli_epi16(pixU0, in_bit_depth - 8);
             pixV0 = _mm_srli_epi16(pixV0, in_bit_depth - 8);
@@ -1351,7 +1350,7 @@ static void RGY_FORCEINLINE convert_yuv444_to_y410_simd(void** dst, const void**
         uint8_t* src_u_ptr = srcULine;
         uint8_t* src_v_ptr = srcVLine;
         uint32_t* dst_ptr = dstLine;
-        for (int x = 0; x < y_width; x++, src_y_ptr += 16, src_u_ptr += 16, src_v_ptr += 16, dst_ptr += 16) {
+        for (int x = 0; x < y_width; x += 16, src_y_ptr += 16, src_u_ptr += 16, src_v_ptr += 16, dst_ptr += 16) {
             __m128i pixY = _mm_loadu_si128((const __m128i*)(src_y_ptr + 0));
             __m128i pixU = _mm_loadu_si128((const __m128i*)(src_u_ptr + 0));
             __m128i pixV = _mm_loadu_si128((const __m128i*)(src_v_ptr + 0));
@@ -1407,7 +1406,7 @@ void convert_yuv444_high_to_y410_simd(void** dst, const void** src, int width, i
         uint16_t* src_u_ptr = srcULine;
         uint16_t* src_v_ptr = srcVLine;
         uint32_t* dst_ptr = dstLine;
-        for (int x = 0; x < y_width; x++, src_y_ptr += 16, src_u_ptr += 16, src_v_ptr += 16, dst_ptr += 16) {
+        for (int x = 0; x < y_width; x += 16, src_y_ptr += 16, src_u_ptr += 16, src_v_ptr += 16, dst_ptr += 16) {
             __m128i pixY0 = _mm_loadu_si128((const __m128i*)(src_y_ptr + 0));
             __m128i pixY1 = _mm_loadu_si128((const __m128i*)(src_y_ptr + 8));
             __m128i pixU0 = _mm_loadu_si128((const __m128i*)(src_u_ptr + 0));
@@ -1416,12 +1415,12 @@ void convert_yuv444_high_to_y410_simd(void** dst, const void** src, int width, i
             __m128i pixV1 = _mm_loadu_si128((const __m128i*)(src_v_ptr + 8));
 
             if (in_bit_depth > out_bit_depth) {
-                pixY0 = _mm_srli_epi16(_mm_add_epi16(pixY0, xrsftAdd), in_bit_depth - out_bit_depth);
-                pixY1 = _mm_srli_epi16(_mm_add_epi16(pixY1, xrsftAdd), in_bit_depth - out_bit_depth);
-                pixU0 = _mm_srli_epi16(_mm_add_epi16(pixU0, xrsftAdd), in_bit_depth - out_bit_depth);
-                pixU1 = _mm_srli_epi16(_mm_add_epi16(pixU1, xrsftAdd), in_bit_depth - out_bit_depth);
-                pixV0 = _mm_srli_epi16(_mm_add_epi16(pixV0, xrsftAdd), in_bit_depth - out_bit_depth);
-                pixV1 = _mm_srli_epi16(_mm_add_epi16(pixV1, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixY0 = _mm_srli_epi16(_mm_adds_epu16(pixY0, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixY1 = _mm_srli_epi16(_mm_adds_epu16(pixY1, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixU0 = _mm_srli_epi16(_mm_adds_epu16(pixU0, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixU1 = _mm_srli_epi16(_mm_adds_epu16(pixU1, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixV0 = _mm_srli_epi16(_mm_adds_epu16(pixV0, xrsftAdd), in_bit_depth - out_bit_depth);
+                pixV1 = _mm_srli_epi16(_mm_adds_epu16(pixV1, xrsftAdd), in_bit_depth - out_bit_depth);
             }
             pixY0 = _mm_min_epu16_simd(pixY0, _mm_set1_epi16((1<<out_bit_depth)-1));
             pixY1 = _mm_min_epu16_simd(pixY1, _mm_set1_epi16((1<<out_bit_depth)-1));
@@ -1545,8 +1544,8 @@ static void RGY_FORCEINLINE convert_yuv444_high_to_yuv444_simd(void **dst, const
             for (int x = 0; x < y_width; x += 16, dst_ptr += 16, src_ptr += 16) {
                 __m128i x0 = _mm_loadu_si128((const __m128i *)(src_ptr + 0));
                 __m128i x1 = _mm_loadu_si128((const __m128i *)(src_ptr + 8));
-                x0 = _mm_adds_epi16(x0, xrsftAdd);
-                x1 = _mm_adds_epi16(x1, xrsftAdd);
+                x0 = _mm_adds_epu16(x0, xrsftAdd);
+                x1 = _mm_adds_epu16(x1, xrsftAdd);
                 x0 = _mm_srli_epi16(x0, in_bit_depth - 8);
                 x1 = _mm_srli_epi16(x1, in_bit_depth - 8);
                 x0 = _mm_packus_epi16(x0, x1);
@@ -0,0 +1,281 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include "rgy_avio_prefetch.h"
+#include "rgy_osdep.h"
+#include "rgy_perf_monitor.h"
+
+#if ENABLE_AVSW_READER
+
+static const size_t RGY_AVIO_PREFETCH_ALIGN = 4096;
+static const int RGY_AVIO_BUFFER_SIZE = 64 * 1024; // libavformatに渡すAVIOContextのバッファサイズ
+
+static int funcReadPacketPrefetch(void *opaque, uint8_t *buf, int buf_size) {
+    return reinterpret_cast<RGYAVIOPrefetch *>(opaque)->read(buf, buf_size);
+}
+static int64_t funcSeekPrefetch(void *opaque, int64_t offset, int whence) {
+    return reinterpret_cast<RGYAVIOPrefetch *>(opaque)->seek(offset, whence);
+}
+
+RGYAVIOPrefetch::RGYAVIOPrefetch() :
+    m_fp(),
+    m_fileSize(0),
+    m_blockSize(0),
+    m_blocks(),
+    m_avio(nullptr),
+    m_thread(),
+    m_mtx(),
+    m_cvPrefetch(),
+    m_cvReady(),
+    m_abort(false),
+    m_pos(0),
+    m_lastReadEnd(0),
+    m_readAhead(1),
+    m_hitCount(0),
+    m_missCount(0),
+    m_stallUs(0),
+    m_queueInfo(nullptr) {
+}
+
+RGYAVIOPrefetch::~RGYAVIOPrefetch() {
+    close();
+}
+
+RGY_ERR RGYAVIOPrefetch::open(const TCHAR *filename, size_t blockSize, int blockCount, PerfQueueInfo *queueInfo) {
+    close();
+    FILE *fp = nullptr;
+    if (_tfopen_s(&fp, filename, _T("rb")) != 0 || fp == nullptr) {
+        return RGY_ERR_FILE_OPEN;
+    }
+    m_fp.reset(fp);
+    // 先読みスレッドがブロック単位で読むので、stdioのバッファは不要
+    setvbuf(m_fp.get(), nullptr, _IONBF, 0);
+    if (_fseeki64(m_fp.get(), 0, SEEK_END) != 0 || (m_fileSize = _ftelli64(m_fp.get())) < 0) {
+        close();
+        return RGY_ERR_UNSUPPORTED; // シークできないファイル
+    }
+    m_blockSize = ALIGN(std::max(blockSize, RGY_AVIO_PREFETCH_ALIGN), RGY_AVIO_PREFETCH_ALIGN);
+    m_blocks.resize(std::max(blockCount, 2));
+    for (auto& block : m_blocks) {
+        block.ptr.reset((uint8_t *)_aligned_malloc(m_blockSize, RGY_AVIO_PREFETCH_ALIGN));
+        if (!block.ptr) {
+            close();
+            return RGY_ERR_MEMORY_ALLOC;
+        }
+        block.offset = -1;
+        block.size = 0;
+        block.state = BlockState::Empty;
+        block.error = false;
+    }
+    auto aviobuf = (uint8_t *)av_malloc(RGY_AVIO_BUFFER_SIZE);
+    if (aviobuf == nullptr) {
+        close();
+        return RGY_ERR_MEMORY_ALLOC;
+    }
+    m_avio = avio_alloc_context(aviobuf, RGY_AVIO_BUFFER_SIZE, 0, this, funcReadPacketPrefetch, nullptr, funcSeekPrefetch);
+    if (m_avio == nullptr) {
+        av_free(aviobuf);
+        close();
+        return RGY_ERR_NULL_PTR;
+    }
+    m_queueInfo = queueInfo;
+    m_abort = false;
+    m_thread = std::thread(&RGYAVIOPrefetch::run, this);
+    return RGY_ERR_NONE;
+}
+
+void RGYAVIOPrefetch::close() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_abort = true;
+        }
+        m_cvPrefetch.notify_all();
+        m_thread.join();
+    }
+    if (m_avio) {
+        av_freep(&m_avio->buffer);
+        avio_context_free(&m_avio);
+    }
+    m_blocks.clear();
+    m_fp.reset();
+    m_fileSize = 0;
+    m_pos = 0;
+    m_lastReadEnd = 0;
+    m_readAhead = 1;
+    m_queueInfo = nullptr;
+}
+
+RGYAVIOPrefetch::Block *RGYAVIOPrefetch::findBlock(int64_t offset) {
+    for (auto& block : m_blocks) {
+        if (block.state != BlockState::Empty && block.offset == offset) {
+            return &block;
+        }
+    }
+    return nullptr;
+}
+
+// 次に先読みすべきブロックと、それを読み込む先を探す (m_mtxをロックした状態で呼ぶこと)
+bool RGYAVIOPrefetch::findPrefetchTarget(Block **target, int64_t *offset) {
+    const int64_t curBlock = m_pos / (int64_t)m_blockSize;
+    const int64_t lastBlock = (m_fileSize + (int64_t)m_blockSize - 1) / (int64_t)m_blockSize;
+    const int64_t windowEnd = std::min(curBlock + m_readAhead, lastBlock);
+    for (int64_t ib = curBlock; ib < windowEnd; ib++) {
+        const int64_t blockOffset = ib * (int64_t)m_blockSize;
+        if (findBlock(blockOffset) != nullptr) {
+            continue;
+        }
+        // 空きブロックか、先読み範囲外の読み込み済みブロックを再利用する
+        Block *reuse = nullptr;
+        for (auto& block : m_blocks) {
+            if (block.state == BlockState::Empty) {
+                reuse = &block;
+                break;
+            }
+            if (block.state == BlockState::Ready
+                && (block.offset < curBlock * (int64_t)m_blockSize || block.offset >= windowEnd * (int64_t)m_blockSize)) {
+                // 現在位置より後ろのブロックから優先して再利用する
+                if (reuse == nullptr || block.offset < reuse->offset) {
+                    reuse = &block;
+                }
+            }
+        }
+        if (reuse == nullptr) {
+            return false;
+        }
+        *target = reuse;
+        *offset = blockOffset;
+        return true;
+    }
+    return false;
+}
+
+void RGYAVIOPrefetch::run() {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    for (;;) {
+        Block *block = nullptr;
+        int64_t offset = 0;
+        m_cvPrefetch.wait(lock, [&]() { return m_abort || findPrefetchTarget(&block, &offset); });
+        if (m_abort) {
+            break;
+        }
+        block->state = BlockState::Loading;
+        block->offset = offset;
+        block->size = 0;
+        block->error = false;
+        lock.unlock();
+
+        size_t readSize = 0;
+        bool error = _fseeki64(m_fp.get(), offset, SEEK_SET) != 0;
+        if (!error) {
+            const size_t request = (size_t)std::min<int64_t>((int64_t)m_blockSize, m_fileSize - offset);
+            readSize = _fread_nolock(block->ptr.get(), 1, request, m_fp.get());
+            error = readSize != request && ferror(m_fp.get());
+        }
+
+        lock.lock();
+        block->size = readSize;
+        block->error = error;
+        block->state = BlockState::Ready;
+        m_cvReady.notify_all();
+    }
+}
+
+void RGYAVIOPrefetch::updatePerfInfo() {
+    if (m_queueInfo) {
+        m_queueInfo->in_prefetch_hit = (size_t)m_hitCount;
+        m_queueInfo->in_prefetch_access = (size_t)accessCount();
+        m_queueInfo->in_prefetch_stall_us = (size_t)m_stallUs;
+    }
+}
+
+int RGYAVIOPrefetch::read(uint8_t *buf, int buf_size) {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    if (m_pos >= m_fileSize) {
+        return AVERROR_EOF;
+    }
+    // 連続した読み込みが続いていれば先読みするブロック数を増やし、そうでなければ1ブロックに戻す
+    const int64_t blockOffset = m_pos - m_pos % (int64_t)m_blockSize;
+    if (m_pos != m_lastReadEnd) {
+        m_readAhead = 1;
+    } else if (blockOffset == m_pos) {
+        m_readAhead = std::min(m_readAhead * 2, (int)m_blocks.size());
+    }
+
+    Block *block = findBlock(blockOffset);
+    if (block != nullptr && block->state == BlockState::Ready) {
+        m_hitCount++;
+    } else {
+        m_missCount++;
+        m_cvPrefetch.notify_one();
+        const auto start = std::chrono::steady_clock::now();
+        m_cvReady.wait(lock, [&]() {
+            block = findBlock(blockOffset);
+            return block != nullptr && block->state == BlockState::Ready;
+        });
+        m_stallUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    updatePerfInfo();
+    if (block->error) {
+        return AVERROR(EIO);
+    }
+    const int64_t posInBlock = m_pos - blockOffset;
+    const int64_t copySize = std::min<int64_t>(buf_size, (int64_t)block->size - posInBlock);
+    if (copySize <= 0) {
+        return AVERROR_EOF;
+    }
+    memcpy(buf, block->ptr.get() + posInBlock, (size_t)copySize);
+    m_pos += copySize;
+    m_lastReadEnd = m_pos;
+    // 読み込み位置が進んだので、先読みを進める
+    m_cvPrefetch.notify_one();
+    return (int)copySize;
+}
+
+int64_t RGYAVIOPrefetch::seek(int64_t offset, int whence) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    whence &= ~AVSEEK_FORCE;
+    int64_t pos = 0;
+    switch (whence) {
+    case AVSEEK_SIZE: return m_fileSize;
+    case SEEK_SET: pos = offset; break;
+    case SEEK_CUR: pos = m_pos + offset; break;
+    case SEEK_END: pos = m_fileSize + offset; break;
+    default: return AVERROR(EINVAL);
+    }
+    if (pos < 0) {
+        return AVERROR(EINVAL);
+    }
+    m_pos = pos;
+    m_cvPrefetch.notify_one();
+    return m_pos;
+}
+
+#endif //#if ENABLE_AVSW_READER
@@ -0,0 +1,113 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_AVIO_PREFETCH_H__
+#define __RGY_AVIO_PREFETCH_H__
+
+#include "rgy_version.h"
+
+#if ENABLE_AVSW_READER
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "rgy_tchar.h"
+#include "rgy_avutil.h"
+#include "rgy_util.h"
+#include "rgy_err.h"
+
+struct PerfQueueInfo;
+
+static const int RGY_AVIO_PREFETCH_BLOCK_MB = 4; // 先読みの1ブロックのサイズ
+
+// 入力ファイルを大きなブロック単位で別スレッドから先読みするAVIOContext
+// libavformatの細かい読み込みをブロックからのコピーで処理し、ストレージの往復遅延を隠す
+// 連続した読み込みが続く間は先読みするブロック数を増やし、シークされたら1ブロックに戻す
+class RGYAVIOPrefetch {
+public:
+    RGYAVIOPrefetch();
+    ~RGYAVIOPrefetch();
+
+    RGY_ERR open(const TCHAR *filename, size_t blockSize, int blockCount, PerfQueueInfo *queueInfo);
+    void close();
+    // formatCtx->pbに設定するAVIOContext (所有権はこのクラスが持つ)
+    AVIOContext *avio() { return m_avio; }
+
+    int read(uint8_t *buf, int buf_size);
+    int64_t seek(int64_t offset, int whence);
+
+    int64_t accessCount() const { return m_hitCount + m_missCount; }
+    // 読み込み時に先読みが完了していた割合
+    double hitRate() const { return (accessCount() > 0) ? m_hitCount / (double)accessCount() : 0.0; }
+    // 先読みが間に合わず待機した時間の合計 (us)
+    int64_t stallUs() const { return m_stallUs; }
+protected:
+    enum class BlockState {
+        Empty,
+        Loading,
+        Ready,
+    };
+    struct Block {
+        std::unique_ptr<uint8_t, aligned_malloc_deleter> ptr;
+        int64_t offset;    // ファイル上の位置 (m_blockSizeの倍数)
+        size_t size;       // 読み込んだサイズ
+        BlockState state;
+        bool error;
+    };
+    void run();
+    Block *findBlock(int64_t offset);
+    bool findPrefetchTarget(Block **target, int64_t *offset);
+    void updatePerfInfo();
+
+    std::unique_ptr<FILE, fp_deleter> m_fp;
+    int64_t m_fileSize;
+    size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    AVIOContext *m_avio;
+
+    std::thread m_thread;
+    std::mutex m_mtx;
+    std::condition_variable m_cvPrefetch; // 先読みスレッドの起床用
+    std::condition_variable m_cvReady;    // 読み込み側の起床用
+    bool m_abort;
+
+    int64_t m_pos;          // libavformatからの次の読み込み位置
+    int64_t m_lastReadEnd;  // 直前の読み込みの終了位置 (連続読み込みの判定用)
+    int m_readAhead;        // 現在の読み込み位置から先読みするブロック数
+
+    int64_t m_hitCount;
+    int64_t m_missCount;
+    int64_t m_stallUs;
+    PerfQueueInfo *m_queueInfo; // perf monitorに情報を渡すための構造体
+};
+
+#endif //#if ENABLE_AVSW_READER
+
+#endif //__RGY_AVIO_PREFETCH_H__
@@ -31,6 +31,7 @@
 #if ENABLE_AVSW_READER && !FOR_AUO
 
 #include "rgy_avutil.h"
+#include "rgy_perf_monitor.h"
 
 extern "C" {
 #include <libavutil/timestamp.h>
@@ -1005,4 +1006,91 @@ RGYDOVIProfile getStreamDOVIProfile(const AVStream *stream) {
 #endif
 }
 
+RGYPoolAVPacket::RGYPoolAVPacket() :
+    RGYPoolAV(),
+    m_payloadPool(),
+    m_payloadGet(0),
+    m_payloadAllocated(0),
+    m_queueInfo(nullptr) {
+    for (auto& pool : m_payloadPool) {
+        pool = nullptr;
+    }
+}
+
+RGYPoolAVPacket::~RGYPoolAVPacket() {
+    //使用中のバッファがあっても、AVBufferPoolはすべて返却された時点で解放される
+    for (auto& pool : m_payloadPool) {
+        AVBufferPool *ptr = pool.exchange(nullptr);
+        if (ptr) {
+            av_buffer_pool_uninit(&ptr);
+        }
+    }
+}
+
+int RGYPoolAVPacket::sizeClass(size_t size) {
+    for (int i = 0; i < RGYPOOLAV_PAYLOAD_CLASS_COUNT; i++) {
+        if (size <= classSize(i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+size_t RGYPoolAVPacket::classSize(int sizeClass) {
+    // 4KB, 6KB, 8KB, 12KB, 16KB, ...
+    const size_t base = (size_t)RGYPOOLAV_PAYLOAD_MIN_SIZE << (sizeClass >> 1);
+    return (sizeClass & 1) ? base + (base >> 1) : base;
+}
+
+AVBufferRef *RGYPoolAVPacket::payloadAlloc(void *opaque, size_t size) {
+    auto pool = (RGYPoolAVPacket *)opaque;
+    pool->m_payloadAllocated.fetch_add(1, std::memory_order_relaxed);
+    return av_buffer_alloc(size);
+}
+
+AVBufferPool *RGYPoolAVPacket::payloadPool(int sizeClass) {
+    AVBufferPool *pool = m_payloadPool[sizeClass].load(std::memory_order_acquire);
+    if (pool == nullptr) {
+        AVBufferPool *newPool = av_buffer_pool_init2(classSize(sizeClass), this, payloadAlloc, nullptr);
+        if (newPool == nullptr) {
+            return nullptr;
+        }
+        if (m_payloadPool[sizeClass].compare_exchange_strong(pool, newPool, std::memory_order_acq_rel)) {
+            pool = newPool;
+        } else {
+            //他のスレッドが先に作成した
+            av_buffer_pool_uninit(&newPool);
+        }
+    }
+    return pool;
+}
+
+int RGYPoolAVPacket::newPacket(AVPacket *pkt, int size) {
+    const int sizeClassIdx = (size >= 0) ? sizeClass((size_t)size + AV_INPUT_BUFFER_PADDING_SIZE) : -1;
+    AVBufferPool *pool = (sizeClassIdx >= 0) ? payloadPool(sizeClassIdx) : nullptr;
+    AVBufferRef *buf = (pool) ? av_buffer_pool_get(pool) : nullptr;
+    if (buf == nullptr) {
+        //poolの対象外のサイズ
+        return av_new_packet(pkt, size);
+    }
+    m_payloadGet.fetch_add(1, std::memory_order_relaxed);
+    //av_new_packetと同様に、各フィールドを初期値にする
+    av_packet_unref(pkt);
+    pkt->buf = buf;
+    pkt->data = buf->data;
+    pkt->size = size;
+    memset(pkt->data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    updatePerfInfo();
+    return 0;
+}
+
+void RGYPoolAVPacket::updatePerfInfo() {
+    if (m_queueInfo) {
+        m_queueInfo->pkt_pool_alloc = (size_t)allocated();
+        m_queueInfo->pkt_pool_reuse = (size_t)reused();
+        m_queueInfo->pkt_payload_alloc = (size_t)payloadAllocated();
+        m_queueInfo->pkt_payload_reuse = (size_t)payloadReused();
+    }
+}
+
 #endif //ENABLE_AVSW_READER
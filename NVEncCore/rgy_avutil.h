@@ -35,6 +35,8 @@
 #if ENABLE_AVSW_READER
 #include <algorithm>
 #include <vector>
+#include <array>
+#include <atomic>
 
 #pragma warning (push)
 #pragma warning (disable: 4244)
@@ -122,27 +124,55 @@ struct StreamInfoOptDeleter {
 };
 
 #define RGYPOOLAV_DEBUG 0
-#define RGYPOOLAV_COUNT 0
+
+static const int RGYPOOLAV_LOCAL_CACHE_SIZE = 16; // スレッドごとのキャッシュに保持する数
+
+struct PerfQueueInfo;
 
 template<typename T, T *Talloc(), void Tunref(T* ptr), void Tfree(T** ptr)>
 class RGYPoolAV {
-private:
+protected:
+    // スレッドごとのキャッシュ
+    // 取得と返却を同じスレッドで行う場合は、共有キューを使わずに再利用する
+    // キャッシュは空の状態で最初に返却したpoolが使用し、空になるまでは他のpoolは使用しない
+    struct LocalCache {
+        uint64_t owner;
+        int count;
+        T *ptr[RGYPOOLAV_LOCAL_CACHE_SIZE];
+        LocalCache() : owner(0), count(0), ptr() {};
+        ~LocalCache() {
+            for (int i = 0; i < count; i++) {
+                Tfree(&ptr[i]);
+            }
+        }
+    };
+    static LocalCache& localCache() {
+        static thread_local LocalCache cache;
+        return cache;
+    }
+    static uint64_t newPoolId() {
+        static std::atomic<uint64_t> poolId(0);
+        return ++poolId;
+    }
+
     RGYQueueMPMP<T*> queue;
-#if RGYPOOLAV_COUNT
-    std::atomic<uint64_t> allocated, reused;
-#endif
+    const uint64_t m_id;
+    std::atomic<uint64_t> m_allocated, m_reused;
 public:
-    RGYPoolAV() : queue()
-#if RGYPOOLAV_COUNT
-        , allocated(0), reused(0)
-#endif
-    { queue.init(); }
+    RGYPoolAV() : queue(), m_id(newPoolId()), m_allocated(0), m_reused(0) { queue.init(); }
     ~RGYPoolAV() {
-#if RGYPOOLAV_COUNT
-        fprintf(stderr, "RGYPoolAV: allocated %lld, reused %lld\n", allocated, reused);
-#endif
+        auto& cache = localCache();
+        if (cache.owner == m_id) {
+            for (; cache.count > 0; cache.count--) {
+                Tfree(&cache.ptr[cache.count - 1]);
+            }
+        }
         queue.close([](T **ptr) { Tfree(ptr); });
     }
+    // 新たに確保した数
+    uint64_t allocated() const { return m_allocated; }
+    // 再利用した数
+    uint64_t reused() const { return m_reused; }
     std::unique_ptr<T, RGYAVDeleter<T>> getUnique(T *ptr) {
         return std::unique_ptr<T, RGYAVDeleter<T>>(ptr, RGYAVDeleter<T>([this](T **ptr) { returnFree(ptr); }));
     }
@@ -151,17 +181,18 @@ public:
         T *ptr = Talloc();
 #else
         T *ptr = nullptr;
-        if (!queue.front_copy_and_pop_no_lock(&ptr) || ptr == nullptr) {
-            ptr = Talloc();
-#if RGYPOOLAV_COUNT
-            allocated++;
-#endif
+        auto& cache = localCache();
+        if (cache.owner == m_id && cache.count > 0) {
+            ptr = cache.ptr[--cache.count];
+        } else if (!queue.front_copy_and_pop_no_lock(&ptr)) {
+            ptr = nullptr;
         }
-#if RGYPOOLAV_COUNT
-        else {
-            reused++;
+        if (ptr == nullptr) {
+            ptr = Talloc();
+            m_allocated.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            m_reused.fetch_add(1, std::memory_order_relaxed);
         }
-#endif
 #endif
         return getUnique(ptr);
     }
@@ -171,13 +202,47 @@ public:
         Tfree(ptr);
 #else
         Tunref(*ptr);
-        queue.push(*ptr);
+        auto& cache = localCache();
+        if (cache.count == 0) {
+            cache.owner = m_id;
+        }
+        if (cache.owner == m_id && cache.count < RGYPOOLAV_LOCAL_CACHE_SIZE) {
+            cache.ptr[cache.count++] = *ptr;
+        } else {
+            queue.push(*ptr);
+        }
         *ptr = nullptr;
 #endif
     }
 };
 
-using RGYPoolAVPacket = RGYPoolAV<AVPacket, av_packet_alloc, av_packet_unref, av_packet_free>;
+static const int RGYPOOLAV_PAYLOAD_MIN_SIZE = 4096; // 最小のサイズクラス
+static const int RGYPOOLAV_PAYLOAD_CLASS_COUNT = 28; // サイズクラスの数 (4KB～48MB、2のべき乗とその1.5倍)
+
+// AVPacketのpool
+// AVPacketだけでなく、newPacket()で確保したデータ部分もサイズクラスごとのAVBufferPoolから確保する
+// パケットのunref時にデータ部分はAVBufferPoolに戻るので、次のパケットで再利用される
+class RGYPoolAVPacket : public RGYPoolAV<AVPacket, av_packet_alloc, av_packet_unref, av_packet_free> {
+public:
+    RGYPoolAVPacket();
+    ~RGYPoolAVPacket();
+    // av_new_packet()の代わりに使用する
+    int newPacket(AVPacket *pkt, int size);
+    void setQueueInfo(PerfQueueInfo *queueInfo) { m_queueInfo = queueInfo; }
+    void updatePerfInfo();
+    uint64_t payloadAllocated() const { return m_payloadAllocated; }
+    uint64_t payloadReused() const { return m_payloadGet - m_payloadAllocated; }
+protected:
+    static int sizeClass(size_t size);
+    static size_t classSize(int sizeClass);
+    static AVBufferRef *payloadAlloc(void *opaque, size_t size);
+    AVBufferPool *payloadPool(int sizeClass);
+
+    std::array<std::atomic<AVBufferPool *>, RGYPOOLAV_PAYLOAD_CLASS_COUNT> m_payloadPool; // 初回使用時に作成する
+    std::atomic<uint64_t> m_payloadGet;
+    std::atomic<uint64_t> m_payloadAllocated;
+    PerfQueueInfo *m_queueInfo; // perf monitorに情報を渡すための構造体
+};
 using RGYPoolAVFrame = RGYPoolAV<AVFrame, av_frame_alloc, av_frame_unref, av_frame_free>;
 
 typedef struct CodecMap {
@@ -515,6 +580,7 @@ RGYDOVIProfile getStreamDOVIProfile(const AVStream *stream);
 
 #else
 #define AV_NOPTS_VALUE (-1)
+#define AV_PKT_FLAG_KEY (0x0001)
 class RGYPoolAVPacket;
 class RGYPoolAVFrame;
 static bool avcodec_exists_video([[maybe_unused]] const std::string& codec) { return false; }
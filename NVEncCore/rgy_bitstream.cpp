@@ -34,29 +34,77 @@
 #include "rgy_libdovi.h"
 #endif
 
+size_t unnal(uint8_t *dst, const uint8_t *ptr, size_t len) {
+    // 00 00 03の検索はSIMD版のmemmemで行い、その間のデータはまとめてコピーする
+    static const auto memmem_func = get_memmem_func();
+    static const uint8_t epb[3] = { 0x00, 0x00, 0x03 };
+    size_t out = 0;
+    size_t pos = 0;
+    for (;;) {
+        const auto next = memmem_func(ptr + pos, len - pos, epb, sizeof(epb));
+        if (next == RGY_MEMMEM_NOT_FOUND) break;
+
+        const size_t epb_pos = pos + next + 2;
+        memmove(dst + out, ptr + pos, epb_pos - pos);
+        out += epb_pos - pos;
+        pos = epb_pos + 1; // 0x03をスキップ
+    }
+    memmove(dst + out, ptr + pos, len - pos);
+    return out + (len - pos);
+}
+
+void unnal(std::vector<uint8_t>& dst, const uint8_t *ptr, size_t len) {
+    dst.resize(len);
+    dst.resize(unnal(dst.data(), ptr, len));
+}
+
 std::vector<uint8_t> unnal(const uint8_t *ptr, size_t len) {
     std::vector<uint8_t> data;
-    data.reserve(len);
-    data.push_back(ptr[0]);
-    data.push_back(ptr[1]);
-    for (size_t i = 2; i < len; i++) {
-        if (ptr[i-2] == 0x00 && ptr[i-1] == 0x00 && ptr[i] == 0x03) {
-            //skip
-        } else {
-            data.push_back(ptr[i]);
-        }
-    }
+    unnal(data, ptr, len);
     return data;
 }
 
-void to_nal(std::vector<uint8_t>& data) {
-    for (auto it = data.begin(); it < data.end() - 2; it++) {
-        if (*it == 0
-            && *(it + 1) == 0
-            && (*(it + 2) & (~(0x03))) == 0) {
-            it = data.insert(it + 2, 0x03);
-        }
+// dst <= ptr - (挿入するバイト数) であれば、dstとptrが重なっていてもよい
+static size_t to_nal_imp(uint8_t *dst, const uint8_t *ptr, size_t len, decltype(find_nal_escape_c) *find_escape) {
+    size_t out = 0;
+    size_t pos = 0;
+    for (;;) {
+        const auto next = find_escape(ptr + pos, len - pos);
+        if (next == RGY_NAL_START_CODE_NOT_FOUND) break;
+
+        const size_t ins_pos = pos + next + 2;
+        memmove(dst + out, ptr + pos, ins_pos - pos);
+        out += ins_pos - pos;
+        dst[out++] = 0x03;
+        pos = ins_pos; // 0x03の直後から、00 00の判定をやり直す
     }
+    memmove(dst + out, ptr + pos, len - pos);
+    return out + (len - pos);
+}
+
+size_t to_nal(uint8_t *dst, const uint8_t *ptr, size_t len) {
+    static const auto find_escape = get_find_nal_escape_func();
+    return to_nal_imp(dst, ptr, len, find_escape);
+}
+
+void to_nal(std::vector<uint8_t>& data) {
+    static const auto find_escape = get_find_nal_escape_func();
+    const size_t len = data.size();
+    // 挿入するバイト数を数える (ほとんどの場合は0で、何もせずに終了する)
+    size_t count = 0;
+    for (size_t pos = 0;;) {
+        const auto next = find_escape(data.data() + pos, len - pos);
+        if (next == RGY_NAL_START_CODE_NOT_FOUND) break;
+        pos += next + 2;
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+    // 後ろに寄せてから、先頭から詰めて出力する
+    data.resize(len + count);
+    memmove(data.data() + count, data.data(), len);
+    to_nal_imp(data.data(), data.data() + count, len, find_escape);
 }
 
 void add_u16(std::vector<uint8_t>& data, uint16_t u16) {
@@ -524,7 +572,7 @@ std::pair<int, std::string> convert_dovi_rpu(std::vector<uint8_t>& data, const R
     }
     return { 0, err_mes };
 #else
-    return (prm) ? { 1, "libdovi not supported with this build." } : { 0, err_mes };
+    return (prm) ? std::make_pair(1, std::string("libdovi not supported with this build.")) : std::make_pair(0, err_mes);
 #endif // ENABLE_LIBDOVI
 }
 
@@ -722,66 +770,21 @@ const DOVIProfile *getDOVIProfile(const int id) {
     return nullptr;
 }
 
-std::vector<nal_info> parse_nal_unit_h264_c(const uint8_t *data, size_t size) {
+std::vector<nal_info> parse_nal_unit(const RGY_CODEC codec, decltype(find_nal_start_code_c) *find_start_code, const uint8_t *data, size_t size) {
     std::vector<nal_info> nal_list;
-    if (size >= 3) {
-        static const uint8_t header[3] = { 0, 0, 1 };
-        nal_info nal_start = { nullptr, 0, 0, 0, 0 };
-        int64_t i = 0;
-        for (;;) {
-            const auto next = rgy_memmem_c((const void *)(data + i), size - i, (const void *)header, sizeof(header));
-            if (next == RGY_MEMMEM_NOT_FOUND) break;
-
-            i += next;
-            if (nal_start.ptr) {
-                nal_list.push_back(nal_start);
-            }
-            nal_start.ptr = data + i - (i > 0 && data[i-1] == 0);
-            nal_start.type = data[i + 3] & 0x1f;
-            nal_start.size = data + size - nal_start.ptr;
-            if (nal_list.size()) {
-                auto prev = nal_list.end() - 1;
-                prev->size = nal_start.ptr - prev->ptr;
-            }
-            i += 3;
-        }
-        if (nal_start.ptr) {
-            nal_list.push_back(nal_start);
-        }
-    }
+    RGYNalScanner(codec, find_start_code).scan(data, size, [&nal_list](const nal_info& nal) {
+        nal_list.push_back(nal);
+        return true;
+    });
     return nal_list;
 }
 
-std::vector<nal_info> parse_nal_unit_hevc_c(const uint8_t *data, size_t size) {
-    std::vector<nal_info> nal_list;
-    if (size >= 3) {
-        static const uint8_t header[3] = { 0, 0, 1 };
-        nal_info nal_start = { nullptr, 0, 0, 0, 0 };
-        int64_t i = 0;
-        for (;;) {
-            const auto next = rgy_memmem_c((const void *)(data + i), size - i, (const void *)header, sizeof(header));
-            if (next == RGY_MEMMEM_NOT_FOUND) break;
+std::vector<nal_info> parse_nal_unit_h264_c(const uint8_t *data, size_t size) {
+    return parse_nal_unit(RGY_CODEC_H264, find_nal_start_code_c, data, size);
+}
 
-            i += next;
-            if (nal_start.ptr) {
-                nal_list.push_back(nal_start);
-            }
-            nal_start.ptr = data + i - (i > 0 && data[i - 1] == 0);
-            nal_start.type = (data[i + 3] & 0x7f) >> 1;
-            nal_start.nuh_layer_id = ((data[i + 3] & 1) << 5) | ((data[i + 4] & 0xf8) >> 3);
-            nal_start.temporal_id = (data[i + 4] & 0x07) - 1;
-            nal_start.size = data + size - nal_start.ptr;
-            if (nal_list.size()) {
-                auto prev = nal_list.end() - 1;
-                prev->size = nal_start.ptr - prev->ptr;
-            }
-            i += 3;
-        }
-        if (nal_start.ptr) {
-            nal_list.push_back(nal_start);
-        }
-    }
-    return nal_list;
+std::vector<nal_info> parse_nal_unit_hevc_c(const uint8_t *data, size_t size) {
+    return parse_nal_unit(RGY_CODEC_HEVC, find_nal_start_code_c, data, size);
 }
 
 std::vector<nal_info> parse_nal_unit_vvc_c(const uint8_t *data, size_t size) {
@@ -820,6 +823,20 @@ size_t find_header_c(const uint8_t *data, size_t size) {
     return rgy_memmem_c(data, size, DOVIRpu::rpu_header, sizeof(DOVIRpu::rpu_header));
 }
 
+size_t find_nal_escape_c(const uint8_t *data, size_t size) {
+    for (size_t i = 0; i + 2 < size; i++) {
+        if (data[i] == 0 && data[i + 1] == 0 && (data[i + 2] & (~0x03)) == 0) {
+            return i;
+        }
+    }
+    return RGY_NAL_START_CODE_NOT_FOUND;
+}
+
+size_t find_nal_start_code_c(const uint8_t *data, size_t size) {
+    static const uint8_t header[3] = { 0, 0, 1 };
+    return rgy_memmem_c(data, size, header, sizeof(header));
+}
+
 #include "rgy_simd.h"
 
 decltype(parse_nal_unit_h264_c)* get_parse_nal_unit_h264_func() {
@@ -829,6 +846,9 @@ decltype(parse_nal_unit_h264_c)* get_parse_nal_unit_h264_func() {
     if ((simd & RGY_SIMD::AVX512BW) == RGY_SIMD::AVX512BW) return parse_nal_unit_h264_avx512bw;
 #endif
     if ((simd & RGY_SIMD::AVX2) == RGY_SIMD::AVX2) return parse_nal_unit_h264_avx2;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    const auto simd = get_availableSIMD();
+    if ((simd & RGY_SIMD::NEON) == RGY_SIMD::NEON) return parse_nal_unit_h264_neon;
 #endif
     return parse_nal_unit_h264_c;
 }
@@ -839,10 +859,41 @@ decltype(parse_nal_unit_hevc_c)* get_parse_nal_unit_hevc_func() {
     if ((simd & RGY_SIMD::AVX512BW) == RGY_SIMD::AVX512BW) return parse_nal_unit_hevc_avx512bw;
 #endif
     if ((simd & RGY_SIMD::AVX2) == RGY_SIMD::AVX2) return parse_nal_unit_hevc_avx2;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    const auto simd = get_availableSIMD();
+    if ((simd & RGY_SIMD::NEON) == RGY_SIMD::NEON) return parse_nal_unit_hevc_neon;
 #endif
     return parse_nal_unit_hevc_c;
 }
 
+decltype(find_nal_start_code_c)* get_find_nal_start_code_func() {
+#if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
+    const auto simd = get_availableSIMD();
+#if defined(_M_X64) || defined(__x86_64)
+    if ((simd & RGY_SIMD::AVX512BW) == RGY_SIMD::AVX512BW) return find_nal_start_code_avx512bw;
+#endif
+    if ((simd & RGY_SIMD::AVX2) == RGY_SIMD::AVX2) return find_nal_start_code_avx2;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    const auto simd = get_availableSIMD();
+    if ((simd & RGY_SIMD::NEON) == RGY_SIMD::NEON) return find_nal_start_code_neon;
+#endif
+    return find_nal_start_code_c;
+}
+
+decltype(find_nal_escape_c)* get_find_nal_escape_func() {
+#if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
+    const auto simd = get_availableSIMD();
+#if defined(_M_X64) || defined(__x86_64)
+    if ((simd & RGY_SIMD::AVX512BW) == RGY_SIMD::AVX512BW) return find_nal_escape_avx512bw;
+#endif
+    if ((simd & RGY_SIMD::AVX2) == RGY_SIMD::AVX2) return find_nal_escape_avx2;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    const auto simd = get_availableSIMD();
+    if ((simd & RGY_SIMD::NEON) == RGY_SIMD::NEON) return find_nal_escape_neon;
+#endif
+    return find_nal_escape_c;
+}
+
 decltype(find_header_c)* get_find_header_func() {
 #if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
     const auto simd = get_availableSIMD();
@@ -850,67 +901,71 @@ decltype(find_header_c)* get_find_header_func() {
     if ((simd & RGY_SIMD::AVX512BW) == RGY_SIMD::AVX512BW) return find_header_avx512bw;
 #endif
     if ((simd & RGY_SIMD::AVX2) == RGY_SIMD::AVX2) return find_header_avx2;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    const auto simd = get_availableSIMD();
+    if ((simd & RGY_SIMD::NEON) == RGY_SIMD::NEON) return find_header_neon;
 #endif
     return find_header_c;
 }
 
-static std::unique_ptr<unit_info> get_unit(const uint8_t *data, const size_t size) {
-    std::unique_ptr<unit_info> unit;
-    if (size <= 1) {
-        return unit;
-    }
-    const uint8_t *const start_pos = data;
-    const uint8_t firstbyte = *data++;
-    const uint8_t type = (firstbyte & (0x78)) >> 3;
-    const uint8_t extension_flag = (firstbyte & 0x04) >> 2;
-    const uint8_t has_size_flag = (firstbyte & 0x02) >> 1;
-
-    unit = std::make_unique<unit_info>();
-    unit->type = type;
-    unit->extension_flag = extension_flag;
-    unit->has_size_flag = has_size_flag;
-    unit->temporal_id = 0;
-    unit->spatial_id = 0;
-    if (extension_flag) {
-        const uint8_t byte2 = *data++;
-        unit->temporal_id = (byte2 & (0xE0)) >> 5;
-        unit->spatial_id = (byte2 & (0x18)) >> 3;
-    }
-    if (!has_size_flag) {
-        size_t ret = size - 1 - extension_flag;
-        unit->unit_data.resize(ret);
-    } else {
-        size_t obu_size = 0;
-        for (int i = 0; i < 8; i++) {
-            uint8_t byte = *data++;
-            obu_size |= (uint64_t)(byte & 0x7f) << (i * 7);
-            if (!(byte & 0x80))
-                break;
+bool get_obu_info(const uint8_t *data, const size_t size, obu_info& info) {
+    if (size == 0) {
+        return false;
+    }
+    const uint8_t firstbyte = data[0];
+    info.ptr = data;
+    info.type = (firstbyte & (0x78)) >> 3;
+    info.extension_flag = (firstbyte & 0x04) >> 2;
+    info.has_size_flag = (firstbyte & 0x02) >> 1;
+    info.temporal_id = 0;
+    info.spatial_id = 0;
+    size_t pos = 1;
+    if (info.extension_flag) {
+        if (pos >= size) {
+            return false;
         }
-
-        const size_t ret = obu_size + (data - start_pos);
-        unit->unit_data.resize(ret);
+        const uint8_t byte2 = data[pos++];
+        info.temporal_id = (byte2 & (0xE0)) >> 5;
+        info.spatial_id = (byte2 & (0x18)) >> 3;
+    }
+    if (!info.has_size_flag) {
+        // obu_sizeがない場合は、残りのデータすべてが1つのOBU
+        info.obu_offset = (int)pos;
+        info.size = size;
+        return true;
+    }
+    uint64_t obu_size = 0;
+    for (int i = 0; ; i++) {
+        if (i >= 8 || pos >= size) {
+            return false;
+        }
+        const uint8_t byte = data[pos++];
+        obu_size |= (uint64_t)(byte & 0x7f) << (i * 7);
+        if (!(byte & 0x80))
+            break;
     }
-    unit->obu_offset = (int)(data - start_pos);
-    if (unit->unit_data.size() > 0) {
-        memcpy(unit->unit_data.data(), start_pos, unit->unit_data.size());
+    info.obu_offset = (int)pos;
+    if (obu_size > size - pos) {
+        return false;
     }
-    return unit;
+    info.size = (size_t)(pos + obu_size);
+    return true;
 }
 
 std::deque<std::unique_ptr<unit_info>> parse_unit_av1(const uint8_t *data, const size_t size) {
     std::deque<std::unique_ptr<unit_info>> list;
-    int64_t size_remain = (int64_t)size;
-    while (size_remain > 0) {
-        auto unit = get_unit(data, size_remain);
-        const auto unit_size = unit->unit_data.size();
-        if (unit_size == 0) {
-            break;
-        }
+    scan_unit_av1(data, size, [&list](const obu_info& info) {
+        auto unit = std::make_unique<unit_info>();
+        unit->type = info.type;
+        unit->extension_flag = info.extension_flag;
+        unit->has_size_flag = info.has_size_flag;
+        unit->temporal_id = info.temporal_id;
+        unit->spatial_id = info.spatial_id;
+        unit->obu_offset = info.obu_offset;
+        unit->unit_data.assign(info.ptr, info.ptr + info.size);
         list.push_back(std::move(unit));
-        data += unit_size;
-        size_remain -= unit_size;
-    }
+        return true;
+    });
     return list;
 }
 
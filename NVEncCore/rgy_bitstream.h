@@ -34,6 +34,9 @@
 #include <unordered_map>
 #include <cstdint>
 #include <string>
+#include <limits>
+#include <algorithm>
+#include <cstring>
 #include "rgy_def.h"
 #include "rgy_util.h"
 
@@ -45,6 +48,18 @@ struct nal_info {
     int temporal_id;
 };
 
+// AV1のOBUの情報 (データはコピーせず、解析したバッファ内を指す)
+struct obu_info {
+    const uint8_t *ptr;     // OBUの先頭 (OBUヘッダを含む)
+    size_t size;            // OBUヘッダを含むOBU全体のサイズ
+    uint8_t type;
+    uint8_t extension_flag;
+    uint8_t has_size_flag;
+    int temporal_id;
+    int spatial_id;
+    int obu_offset;         // OBUの先頭からpayloadまでのサイズ
+};
+
 struct unit_info {
     uint8_t type;
     uint8_t extension_flag;
@@ -208,8 +223,17 @@ enum PayloadType {
     SAMPLE_ASPECT_RATIO_INFO                    = 204,
 };
 
+// エミュレーション防止バイト(00 00 03の03)を除去する
 std::vector<uint8_t> unnal(const uint8_t *ptr, size_t len);
+// dstに出力し、出力サイズを返す (dst == ptrとして、その場で処理してもよい)
+size_t unnal(uint8_t *dst, const uint8_t *ptr, size_t len);
+// dstの確保済みのメモリを再利用して出力する
+void unnal(std::vector<uint8_t>& dst, const uint8_t *ptr, size_t len);
+// エミュレーション防止バイトを挿入する (その場で処理する)
 void to_nal(std::vector<uint8_t>& data);
+// dstに出力し、出力サイズを返す (dstにはto_nal_max_size(len)の領域が必要で、ptrと重なってはならない)
+size_t to_nal(uint8_t *dst, const uint8_t *ptr, size_t len);
+static inline size_t to_nal_max_size(size_t len) { return len + len / 2; }
 void add_u16(std::vector<uint8_t>& data, uint16_t u16);
 void add_u32(std::vector<uint8_t>& data, uint32_t u32);
 
@@ -219,6 +243,8 @@ std::vector<nal_info> parse_nal_unit_h264_avx2(const uint8_t *data, size_t size)
 std::vector<nal_info> parse_nal_unit_hevc_avx2(const uint8_t *data, size_t size);
 std::vector<nal_info> parse_nal_unit_h264_avx512bw(const uint8_t *data, size_t size);
 std::vector<nal_info> parse_nal_unit_hevc_avx512bw(const uint8_t *data, size_t size);
+std::vector<nal_info> parse_nal_unit_h264_neon(const uint8_t *data, size_t size);
+std::vector<nal_info> parse_nal_unit_hevc_neon(const uint8_t *data, size_t size);
 
 decltype(parse_nal_unit_h264_c)* get_parse_nal_unit_h264_func();
 decltype(parse_nal_unit_hevc_c)* get_parse_nal_unit_hevc_func();
@@ -226,9 +252,355 @@ decltype(parse_nal_unit_hevc_c)* get_parse_nal_unit_hevc_func();
 size_t find_header_c(const uint8_t *data, size_t size);
 size_t find_header_avx2(const uint8_t *data, size_t size);
 size_t find_header_avx512bw(const uint8_t *data, size_t size);
+size_t find_header_neon(const uint8_t *data, size_t size);
 
 decltype(find_header_c)* get_find_header_func();
 
+static const size_t RGY_NAL_START_CODE_NOT_FOUND = std::numeric_limits<size_t>::max();
+
+// 開始コード(00 00 01)の位置を返す (見つからない場合はRGY_NAL_START_CODE_NOT_FOUND)
+size_t find_nal_start_code_c(const uint8_t *data, size_t size);
+size_t find_nal_start_code_avx2(const uint8_t *data, size_t size);
+size_t find_nal_start_code_avx512bw(const uint8_t *data, size_t size);
+size_t find_nal_start_code_neon(const uint8_t *data, size_t size);
+
+decltype(find_nal_start_code_c)* get_find_nal_start_code_func();
+
+// エミュレーション防止バイトの挿入が必要な位置(00 00 xx, xx <= 03 の先頭)を返す (見つからない場合はRGY_NAL_START_CODE_NOT_FOUND)
+size_t find_nal_escape_c(const uint8_t *data, size_t size);
+size_t find_nal_escape_avx2(const uint8_t *data, size_t size);
+size_t find_nal_escape_avx512bw(const uint8_t *data, size_t size);
+size_t find_nal_escape_neon(const uint8_t *data, size_t size);
+
+decltype(find_nal_escape_c)* get_find_nal_escape_func();
+
+std::vector<nal_info> parse_nal_unit(const RGY_CODEC codec, decltype(find_nal_start_code_c) *find_start_code, const uint8_t *data, size_t size);
+
+// nal unitを先頭から順に列挙する
+// 列挙したnal unitはvisitorに渡し、内部でメモリ確保は行わない
+//  scan()        : 1つのバッファ内のnal unitを列挙する
+//  feed()/finish(): 分割して渡される入力から、入力の境界をまたぐnal unitも含めて列挙する
+class RGYNalScanner {
+public:
+    RGYNalScanner(RGY_CODEC codec, decltype(find_nal_start_code_c) *find_start_code = nullptr) :
+        m_codec(codec),
+        m_findStartCode((find_start_code) ? find_start_code : get_find_nal_start_code_func()) {
+        reset();
+    }
+    RGY_CODEC codec() const { return m_codec; }
+
+    // visitorは bool(const nal_info&) で、falseを返すとそこで列挙を終了する
+    // 戻り値はvisitorに渡したnal unitの数
+    template<typename Visitor>
+    size_t scan(const uint8_t *data, const size_t size, Visitor visitor) const {
+        size_t count = 0;
+        if (size < 3) {
+            return count;
+        }
+        nal_info nal = { nullptr, 0, 0, 0, 0 };
+        size_t i = 0;
+        for (;;) {
+            const auto next = m_findStartCode(data + i, size - i);
+            if (next == RGY_NAL_START_CODE_NOT_FOUND) break;
+
+            i += next;
+            const uint8_t *ptr = data + i - (i > 0 && data[i - 1] == 0);
+            if (nal.ptr) {
+                nal.size = ptr - nal.ptr;
+                count++;
+                if (!visitor(nal)) {
+                    return count;
+                }
+            }
+            nal.ptr = ptr;
+            setHeader(nal, (i + 3 < size) ? data[i + 3] : 0, (i + 4 < size) ? data[i + 4] : 0);
+            i += 3;
+        }
+        if (nal.ptr) {
+            nal.size = data + size - nal.ptr;
+            count++;
+            visitor(nal);
+        }
+        return count;
+    }
+    // 呼び出し元の用意した配列にnal unitを格納する
+    // 戻り値は見つかったnal unitの総数で、list_sizeを超えた分は格納されない
+    size_t scan(const uint8_t *data, const size_t size, nal_info *list, const size_t list_size) const {
+        size_t count = 0;
+        scan(data, size, [&](const nal_info& nal) {
+            if (count < list_size) {
+                list[count] = nal;
+            }
+            count++;
+            return true;
+        });
+        return count;
+    }
+    // listの確保済みのメモリを再利用してnal unitを格納する
+    size_t scan(const uint8_t *data, const size_t size, std::vector<nal_info>& list) const {
+        list.clear();
+        return scan(data, size, [&list](const nal_info& nal) {
+            list.push_back(nal);
+            return true;
+        });
+    }
+
+    // 分割された入力の次の部分を渡す
+    // visitorは void(const nal_info& nal, uint64_t offset) で、offsetは入力全体の先頭からのnal unitの位置
+    // nal.ptrはnal unit全体が今回の入力内にある場合のみ有効で、それ以外はnullptrとなる
+    template<typename Visitor>
+    void feed(const uint8_t *data, const size_t size, Visitor visitor) {
+        const uint64_t base = m_fedSize;
+        m_lastData = data;
+        m_lastSize = size;
+        m_lastBase = base;
+        fillHeader(data, size, base);
+        // 前回までの入力との境界をまたぐ開始コード
+        for (uint64_t pos = (base >= 2) ? base - 2 : 0; pos < base; pos++) {
+            if (pos >= m_searchFrom
+                && byteAt(data, size, base, pos) == 0
+                && byteAt(data, size, base, pos + 1) == 0
+                && byteAt(data, size, base, pos + 2) == 1) {
+                onStartCode(data, size, base, pos, visitor);
+            }
+        }
+        size_t i = (size_t)(std::max(m_searchFrom, base) - base);
+        while (i + 3 <= size) {
+            const auto next = m_findStartCode(data + i, size - i);
+            if (next == RGY_NAL_START_CODE_NOT_FOUND) break;
+            i += next;
+            onStartCode(data, size, base, base + i, visitor);
+            i += 3;
+        }
+        // 次の入力との境界の判定用に、末尾を保存しておく
+        for (size_t j = (size > sizeof(m_tail)) ? size - sizeof(m_tail) : 0; j < size; j++) {
+            memmove(m_tail, m_tail + 1, sizeof(m_tail) - 1);
+            m_tail[sizeof(m_tail) - 1] = data[j];
+        }
+        m_tailSize = (int)std::min<uint64_t>(base + size, sizeof(m_tail));
+        m_fedSize = base + size;
+    }
+    // 入力の終端で、最後のnal unitを出力する
+    // 最後にfeed()した入力が有効な間に呼ぶこと
+    template<typename Visitor>
+    void finish(Visitor visitor) {
+        if (m_hasNal) {
+            m_nal.size = (size_t)(m_fedSize - m_nalOffset);
+            m_nal.ptr = (m_nalOffset >= m_lastBase && m_lastData) ? m_lastData + (m_nalOffset - m_lastBase) : nullptr;
+            visitor(m_nal, m_nalOffset);
+        }
+        reset();
+    }
+    void reset() {
+        m_nal = { nullptr, 0, 0, 0, 0 };
+        m_hasNal = false;
+        m_nalOffset = 0;
+        m_headerPos = 0;
+        m_headerGot = 0;
+        m_header[0] = m_header[1] = 0;
+        m_searchFrom = 0;
+        m_fedSize = 0;
+        m_tail[0] = m_tail[1] = m_tail[2] = 0;
+        m_tailSize = 0;
+        m_lastData = nullptr;
+        m_lastSize = 0;
+        m_lastBase = 0;
+    }
+protected:
+    void setHeader(nal_info& nal, const uint8_t byte0, const uint8_t byte1) const {
+        switch (m_codec) {
+        case RGY_CODEC_HEVC:
+            nal.type = (byte0 & 0x7f) >> 1;
+            nal.nuh_layer_id = ((byte0 & 1) << 5) | ((byte1 & 0xf8) >> 3);
+            nal.temporal_id = (byte1 & 0x07) - 1;
+            break;
+        case RGY_CODEC_H264:
+        default:
+            nal.type = byte0 & 0x1f;
+            nal.nuh_layer_id = 0;
+            nal.temporal_id = 0;
+            break;
+        }
+    }
+    // 入力全体の先頭からposの位置の値 (今回の入力と前回の入力の末尾以外は-1)
+    int byteAt(const uint8_t *data, const size_t size, const uint64_t base, const uint64_t pos) const {
+        if (pos >= base) {
+            return (pos - base < size) ? data[pos - base] : -1;
+        }
+        const uint64_t back = base - pos;
+        return (back <= (uint64_t)m_tailSize) ? m_tail[sizeof(m_tail) - back] : -1;
+    }
+    // 現在のnal unitのヘッダのうち、まだ受け取っていない部分を取得する
+    void fillHeader(const uint8_t *data, const size_t size, const uint64_t base) {
+        if (!m_hasNal) {
+            return;
+        }
+        for (; m_headerGot < 2; m_headerGot++) {
+            const uint64_t pos = m_headerPos + m_headerGot;
+            if (pos < base || pos - base >= size) {
+                break;
+            }
+            m_header[m_headerGot] = data[pos - base];
+        }
+        setHeader(m_nal, m_header[0], m_header[1]);
+    }
+    template<typename Visitor>
+    void onStartCode(const uint8_t *data, const size_t size, const uint64_t base, const uint64_t pos, Visitor& visitor) {
+        const uint64_t nalOffset = pos - (pos > 0 && byteAt(data, size, base, pos - 1) == 0);
+        if (m_hasNal) {
+            m_nal.size = (size_t)(nalOffset - m_nalOffset);
+            m_nal.ptr = (m_nalOffset >= base) ? data + (m_nalOffset - base) : nullptr;
+            visitor(m_nal, m_nalOffset);
+        }
+        m_hasNal = true;
+        m_nalOffset = nalOffset;
+        m_headerPos = pos + 3;
+        m_headerGot = 0;
+        m_header[0] = m_header[1] = 0;
+        m_searchFrom = pos + 3;
+        fillHeader(data, size, base);
+    }
+
+    RGY_CODEC m_codec;
+    decltype(find_nal_start_code_c) *m_findStartCode; // 開始コードの検索関数へのポインタ
+    nal_info m_nal;          // 終端の確定していないnal unit
+    bool m_hasNal;
+    uint64_t m_nalOffset;    // m_nalの入力全体の先頭からの位置
+    uint64_t m_headerPos;    // m_nalのnal unitヘッダの位置
+    int m_headerGot;         // m_nalのnal unitヘッダのうち、取得済みのバイト数
+    uint8_t m_header[2];
+    uint64_t m_searchFrom;   // 開始コードの検索を開始する位置 (直前の開始コードの直後)
+    uint64_t m_fedSize;      // これまでに受け取った入力のサイズ
+    uint8_t m_tail[3];       // これまでに受け取った入力の末尾
+    int m_tailSize;
+    const uint8_t *m_lastData; // 最後に受け取った入力
+    size_t m_lastSize;
+    uint64_t m_lastBase;
+};
+
+// 1つのOBUのヘッダを解析する (データが不足している場合や不正な場合はfalse)
+bool get_obu_info(const uint8_t *data, const size_t size, obu_info& info);
+
+// AV1のOBUを先頭から順にvisitorに渡す (メモリ確保は行わない)
+// visitorは bool(const obu_info&) で、falseを返すとそこで列挙を終了する
+// 戻り値は解析できたOBUの合計サイズ (不正なデータがあった場合はその直前まで)
+template<typename Visitor>
+size_t scan_unit_av1(const uint8_t *data, const size_t size, Visitor visitor) {
+    size_t offset = 0;
+    obu_info info;
+    while (offset < size && get_obu_info(data + offset, size - offset, info)) {
+        offset += info.size;
+        if (!visitor(info)) {
+            break;
+        }
+    }
+    return offset;
+}
+
+// 分割して渡されるAV1のデータから、入力の境界をまたぐOBUも含めて列挙する (メモリ確保は行わない)
+// OBUはobu_has_size_fieldが立っている必要がある (Low Overhead Bitstream Format)
+class RGYObuScanner {
+public:
+    RGYObuScanner() { reset(); }
+
+    // visitorは void(const obu_info& info, uint64_t offset) で、offsetは入力全体の先頭からのOBUの位置
+    // info.ptrはOBU全体が今回の入力内にある場合のみ有効で、それ以外はnullptrとなる
+    // 不正なデータがあった場合はfalseを返し、以降の入力は無視する
+    template<typename Visitor>
+    bool feed(const uint8_t *data, const size_t size, Visitor visitor) {
+        size_t i = 0;
+        while (!m_error && i < size) {
+            if (m_skip > 0) {
+                // 前回の入力からつづくOBUの残り
+                const size_t skip = (size_t)std::min<uint64_t>(m_skip, size - i);
+                m_skip -= skip;
+                i += skip;
+                continue;
+            }
+            obu_info info;
+            if (m_headerSize > 0) {
+                // 前回の入力の境界で途切れたOBUヘッダ
+                const size_t copy = std::min(sizeof(m_header) - m_headerSize, size - i);
+                memcpy(m_header + m_headerSize, data + i, copy);
+                if (!getHeader(m_header, m_headerSize + copy, info)) {
+                    if (m_headerSize + copy >= sizeof(m_header)) {
+                        m_error = true;
+                    } else {
+                        m_headerSize += copy;
+                        i += copy;
+                    }
+                    continue;
+                }
+                const uint64_t offset = m_fedSize - m_headerSize;
+                const size_t used = info.obu_offset - m_headerSize; // 今回の入力から使ったヘッダのバイト数
+                info.ptr = nullptr;
+                visitor(info, offset);
+                m_skip = info.size - info.obu_offset;
+                m_headerSize = 0;
+                i += used;
+                continue;
+            }
+            if (!getHeader(data + i, size - i, info)) {
+                if (m_error) {
+                    break;
+                }
+                // ヘッダが途切れているので、次の入力を待つ
+                m_headerSize = size - i;
+                memcpy(m_header, data + i, m_headerSize);
+                i = size;
+                continue;
+            }
+            const uint64_t offset = m_fedSize + i;
+            if (info.size > size - i) {
+                m_skip = info.size - (size - i);
+                info.ptr = nullptr;
+                i = size;
+            } else {
+                i += info.size;
+            }
+            visitor(info, offset);
+        }
+        m_fedSize += size;
+        return !m_error;
+    }
+    void reset() {
+        m_fedSize = 0;
+        m_skip = 0;
+        memset(m_header, 0, sizeof(m_header));
+        m_headerSize = 0;
+        m_error = false;
+    }
+protected:
+    // OBUヘッダを解析し、sizeにOBU全体のサイズを設定する
+    // データが不足している場合はfalse、不正なデータの場合はm_errorをtrueにしてfalse
+    bool getHeader(const uint8_t *data, const size_t size, obu_info& info) {
+        if (size == 0) {
+            return false;
+        }
+        if ((data[0] & 0x02) == 0) { // obu_has_size_field = 0 には対応しない
+            m_error = true;
+            return false;
+        }
+        const size_t header_size = 1 + ((data[0] & 0x04) >> 2);
+        size_t leb_bytes = 0;
+        for (; leb_bytes < 8 && header_size + leb_bytes < size; leb_bytes++) {
+            if (!(data[header_size + leb_bytes] & 0x80)) {
+                return get_obu_info(data, std::numeric_limits<size_t>::max(), info);
+            }
+        }
+        if (leb_bytes >= 8) {
+            m_error = true;
+        }
+        return false;
+    }
+
+    uint64_t m_fedSize;      // これまでに受け取った入力のサイズ
+    uint64_t m_skip;         // 前回の入力からつづくOBUの残りのサイズ
+    uint8_t m_header[10];    // 入力の境界で途切れたOBUヘッダ (最大で1+1+8byte)
+    size_t m_headerSize;
+    bool m_error;
+};
+
 std::deque<std::unique_ptr<unit_info>> parse_unit_av1(const uint8_t *data, const size_t size);
 
 uint8_t gen_obu_header(const uint8_t obu_type);
@@ -31,68 +31,43 @@
 
 #if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
 
-std::vector<nal_info> parse_nal_unit_h264_avx2(const uint8_t * data, size_t size) {
-    std::vector<nal_info> nal_list;
-    if (size >= 3) {
-        static const uint8_t header[3] = { 0, 0, 1 };
-        nal_info nal_start = { nullptr, 0, 0, 0, 0 };
-        int64_t i = 0;
-        for (;;) {
-            const auto next = rgy_memmem_avx2_imp((const void *)(data + i), size - i, (const void *)header, sizeof(header));
-            if (next == RGY_MEMMEM_NOT_FOUND) break;
-
-            i += next;
-            if (nal_start.ptr) {
-                nal_list.push_back(nal_start);
-            }
-            nal_start.ptr = data + i - (i > 0 && data[i - 1] == 0);
-            nal_start.type = data[i + 3] & 0x1f;
-            nal_start.size = data + size - nal_start.ptr;
-            if (nal_list.size()) {
-                auto prev = nal_list.end() - 1;
-                prev->size = nal_start.ptr - prev->ptr;
-            }
-            i += 3;
-        }
-        if (nal_start.ptr) {
-            nal_list.push_back(nal_start);
-        }
-    }
-    _mm256_zeroupper();
-    return nal_list;
+std::vector<nal_info> parse_nal_unit_h264_avx2(const uint8_t *data, size_t size) {
+    return parse_nal_unit(RGY_CODEC_H264, find_nal_start_code_avx2, data, size);
 }
 
 std::vector<nal_info> parse_nal_unit_hevc_avx2(const uint8_t *data, size_t size) {
-    std::vector<nal_info> nal_list;
-    if (size >= 3) {
-        static const uint8_t header[3] = { 0, 0, 1 };
-        nal_info nal_start = { nullptr, 0, 0, 0, 0 };
-        int64_t i = 0;
-        for (;;) {
-            const auto next = rgy_memmem_avx2_imp((const void *)(data + i), size - i, (const void *)header, sizeof(header));
-            if (next == RGY_MEMMEM_NOT_FOUND) break;
+    return parse_nal_unit(RGY_CODEC_HEVC, find_nal_start_code_avx2, data, size);
+}
 
-            i += next;
-            if (nal_start.ptr) {
-                nal_list.push_back(nal_start);
-            }
-            nal_start.ptr = data + i - (i > 0 && data[i - 1] == 0);
-            nal_start.type = (data[i + 3] & 0x7f) >> 1;
-            nal_start.nuh_layer_id = ((data[i+3] & 1) << 5) | ((data[i+4] & 0xf8) >> 3);
-            nal_start.temporal_id = (data[i+4] & 0x07) - 1;
-            nal_start.size = data + size - nal_start.ptr;
-            if (nal_list.size()) {
-                auto prev = nal_list.end() - 1;
-                prev->size = nal_start.ptr - prev->ptr;
+size_t find_nal_start_code_avx2(const uint8_t *data, size_t size) {
+    static const uint8_t header[3] = { 0, 0, 1 };
+    const auto ret = rgy_memmem_avx2_imp(data, size, header, sizeof(header));
+    _mm256_zeroupper();
+    return ret;
+}
+
+size_t find_nal_escape_avx2(const uint8_t *data, size_t size) {
+    size_t i = 0;
+    if (size >= 34) {
+        const __m256i yZero = _mm256_setzero_si256();
+        const __m256i yMask = _mm256_set1_epi8((char)(~0x03));
+        // 00 00 xx (xx <= 03) を32byteずつ判定する (i+2からのロードがsizeを超えない範囲)
+        for (; i + 34 <= size; i += 32) {
+            const __m256i y0 = _mm256_loadu_si256((const __m256i *)(data + i));
+            const __m256i y1 = _mm256_loadu_si256((const __m256i *)(data + i + 1));
+            const __m256i y2 = _mm256_loadu_si256((const __m256i *)(data + i + 2));
+            const __m256i yMatch = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(y0, yZero), _mm256_cmpeq_epi8(y1, yZero)),
+                _mm256_cmpeq_epi8(_mm256_and_si256(y2, yMask), yZero));
+            const uint32_t mask = (uint32_t)_mm256_movemask_epi8(yMatch);
+            if (mask) {
+                _mm256_zeroupper();
+                return i + CTZ32(mask);
             }
-            i += 3;
-        }
-        if (nal_start.ptr) {
-            nal_list.push_back(nal_start);
         }
+        _mm256_zeroupper();
     }
-    _mm256_zeroupper();
-    return nal_list;
+    const auto ret = find_nal_escape_c(data + i, size - i);
+    return (ret == RGY_NAL_START_CODE_NOT_FOUND) ? ret : i + ret;
 }
 
 size_t find_header_avx2(const uint8_t *data, size_t size) {
@@ -31,66 +31,41 @@
 
 #if defined(_M_X64) || defined(__x86_64)
 
-std::vector<nal_info> parse_nal_unit_h264_avx512bw(const uint8_t * data, size_t size) {
-    std::vector<nal_info> nal_list;
-    if (size >= 3) {
-        static const uint8_t header[3] = { 0, 0, 1 };
-        nal_info nal_start = { nullptr, 0, 0, 0, 0 };
-        int64_t i = 0;
-        for (;;) {
-            const auto next = rgy_memmem_avx512_imp((const void *)(data + i), size - i, (const void *)header, sizeof(header));
-            if (next == RGY_MEMMEM_NOT_FOUND) break;
-
-            i += next;
-            if (nal_start.ptr) {
-                nal_list.push_back(nal_start);
-            }
-            nal_start.ptr = data + i - (i > 0 && data[i - 1] == 0);
-            nal_start.type = data[i + 3] & 0x1f;
-            nal_start.size = data + size - nal_start.ptr;
-            if (nal_list.size()) {
-                auto prev = nal_list.end() - 1;
-                prev->size = nal_start.ptr - prev->ptr;
-            }
-            i += 3;
-        }
-        if (nal_start.ptr) {
-            nal_list.push_back(nal_start);
-        }
-    }
-    return nal_list;
+std::vector<nal_info> parse_nal_unit_h264_avx512bw(const uint8_t *data, size_t size) {
+    return parse_nal_unit(RGY_CODEC_H264, find_nal_start_code_avx512bw, data, size);
 }
 
 std::vector<nal_info> parse_nal_unit_hevc_avx512bw(const uint8_t *data, size_t size) {
-    std::vector<nal_info> nal_list;
-    if (size >= 3) {
-        static const uint8_t header[3] = { 0, 0, 1 };
-        nal_info nal_start = { nullptr, 0, 0, 0, 0 };
-        int64_t i = 0;
-        for (;;) {
-            const auto next = rgy_memmem_avx512_imp((const void *)(data + i), size - i, (const void *)header, sizeof(header));
-            if (next == RGY_MEMMEM_NOT_FOUND) break;
+    return parse_nal_unit(RGY_CODEC_HEVC, find_nal_start_code_avx512bw, data, size);
+}
 
-            i += next;
-            if (nal_start.ptr) {
-                nal_list.push_back(nal_start);
-            }
-            nal_start.ptr = data + i - (i > 0 && data[i - 1] == 0);
-            nal_start.type = (data[i + 3] & 0x7f) >> 1;
-            nal_start.nuh_layer_id = ((data[i + 3] & 1) << 5) | ((data[i + 4] & 0xf8) >> 3);
-            nal_start.temporal_id = (data[i + 4] & 0x07) - 1;
-            nal_start.size = data + size - nal_start.ptr;
-            if (nal_list.size()) {
-                auto prev = nal_list.end() - 1;
-                prev->size = nal_start.ptr - prev->ptr;
+size_t find_nal_start_code_avx512bw(const uint8_t *data, size_t size) {
+    static const uint8_t header[3] = { 0, 0, 1 };
+    const auto ret = rgy_memmem_avx512_imp(data, size, header, sizeof(header));
+    _mm256_zeroupper();
+    return ret;
+}
+
+size_t find_nal_escape_avx512bw(const uint8_t *data, size_t size) {
+    size_t i = 0;
+    if (size >= 66) {
+        const __m512i zZero = _mm512_setzero_si512();
+        const __m512i zMask = _mm512_set1_epi8((char)(~0x03));
+        // 00 00 xx (xx <= 03) を64byteずつ判定する (i+2からのロードがsizeを超えない範囲)
+        for (; i + 66 <= size; i += 64) {
+            const __m512i z0 = _mm512_loadu_si512((const __m512i *)(data + i));
+            const __m512i z1 = _mm512_loadu_si512((const __m512i *)(data + i + 1));
+            const __m512i z2 = _mm512_loadu_si512((const __m512i *)(data + i + 2));
+            const uint64_t mask = _mm512_cmpeq_epi8_mask(z0, zZero) & _mm512_cmpeq_epi8_mask(z1, zZero) & _mm512_testn_epi8_mask(z2, zMask);
+            if (mask) {
+                _mm256_zeroupper();
+                return i + CTZ64(mask);
             }
-            i += 3;
-        }
-        if (nal_start.ptr) {
-            nal_list.push_back(nal_start);
         }
+        _mm256_zeroupper();
     }
-    return nal_list;
+    const auto ret = find_nal_escape_c(data + i, size - i);
+    return (ret == RGY_NAL_START_CODE_NOT_FOUND) ? ret : i + ret;
 }
 
 size_t find_header_avx512bw(const uint8_t *data, size_t size) {
@@ -0,0 +1,73 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2021 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include "rgy_bitstream.h"
+#define RGY_MEMMEM_NEON
+#include "rgy_memmem.h"
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+
+std::vector<nal_info> parse_nal_unit_h264_neon(const uint8_t *data, size_t size) {
+    return parse_nal_unit(RGY_CODEC_H264, find_nal_start_code_neon, data, size);
+}
+
+std::vector<nal_info> parse_nal_unit_hevc_neon(const uint8_t *data, size_t size) {
+    return parse_nal_unit(RGY_CODEC_HEVC, find_nal_start_code_neon, data, size);
+}
+
+size_t find_nal_start_code_neon(const uint8_t *data, size_t size) {
+    static const uint8_t header[3] = { 0, 0, 1 };
+    const auto ret = rgy_memmem_neon_imp(data, size, header, sizeof(header));
+    return ret;
+}
+
+size_t find_nal_escape_neon(const uint8_t *data, size_t size) {
+    size_t i = 0;
+    if (size >= 18) {
+        const uint8x16_t vZero = vdupq_n_u8(0);
+        const uint8x16_t vMask = vdupq_n_u8((uint8_t)(~0x03));
+        // 00 00 xx (xx <= 03) を16byteずつ判定する (i+2からのロードがsizeを超えない範囲)
+        for (; i + 18 <= size; i += 16) {
+            const uint8x16_t v0 = vld1q_u8(data + i);
+            const uint8x16_t v1 = vld1q_u8(data + i + 1);
+            const uint8x16_t v2 = vld1q_u8(data + i + 2);
+            const uint8x16_t vMatch = vandq_u8(vandq_u8(vceqq_u8(v0, vZero), vceqq_u8(v1, vZero)), vceqq_u8(vandq_u8(v2, vMask), vZero));
+            const uint64_t mask = neon_movemask_nibble(vMatch);
+            if (mask) {
+                return i + (size_t)(CTZ64(mask) >> 2);
+            }
+        }
+    }
+    const auto ret = find_nal_escape_c(data + i, size - i);
+    return (ret == RGY_NAL_START_CODE_NOT_FOUND) ? ret : i + ret;
+}
+
+size_t find_header_neon(const uint8_t *data, size_t size) {
+    return rgy_memmem_neon_imp(data, size, DOVIRpu::rpu_header, sizeof(DOVIRpu::rpu_header));
+}
+
+#endif //#if defined(_M_ARM64) || defined(__aarch64__)
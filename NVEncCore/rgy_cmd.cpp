@@ -4916,6 +4916,29 @@ int parse_one_common_option(const TCHAR *option_name, const TCHAR *strInput[], i
         common->inputRetry = v;
         return 0;
     }
+    if (IS_OPTION("input-prefetch")) {
+        i++;
+        int v = 0;
+        if (1 != _stscanf_s(strInput[i], _T("%d"), &v)) {
+            print_cmd_error_invalid_value(option_name, strInput[i]);
+            return 1;
+        }
+        if (v < 0) {
+            print_cmd_error_invalid_value(option_name, strInput[i], _T("--input-prefetch should be set in positive value."));
+            return 1;
+        }
+        common->inputPrefetchMB = v;
+        return 0;
+    }
+    if (IS_OPTION("input-index")) {
+        common->inputIndex = true;
+        if (i + 1 >= nArgNum || strInput[i + 1][0] == _T('-')) {
+            return 0;
+        }
+        i++;
+        common->inputIndexDir = strInput[i];
+        return 0;
+    }
     if (IS_OPTION("video-track")) {
         i++;
         int v = 0;
@@ -6476,7 +6499,7 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
             return 1;
         }
         i++;
-        const auto paramList = std::vector<std::string>{ "addtime", "framelist", "packets" };
+        const auto paramList = std::vector<std::string>{ "addtime", "framelist", "packets", "async" };
 
         for (const auto &param : split(strInput[i], _T(","))) {
             auto pos = param.find_first_of(_T("="));
@@ -6514,6 +6537,16 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
                     }
                     continue;
                 }
+                if (param_arg == _T("async")) {
+                    bool b = false;
+                    if (!cmd_string_to_bool(&b, param_val)) {
+                        ctrl->logOpt.async = b;
+                    } else {
+                        print_cmd_error_invalid_value(tstring(option_name) + _T(" ") + param_arg + _T("="), param_val);
+                        return 1;
+                    }
+                    continue;
+                }
                 if (param_arg == _T("framelist")) {
                     bool b = false;
                     if (!cmd_string_to_bool(&b, param_val)) {
@@ -6559,6 +6592,9 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
                 } else if (param == _T("no-color")) {
                     ctrl->logOpt.disableColor = true;
                     continue;
+                } else if (param == _T("async")) {
+                    ctrl->logOpt.async = true;
+                    continue;
                 } else if (param == _T("framelist")) {
                     ctrl->logFramePosList.enable = true;
                     continue;
@@ -6659,6 +6695,15 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
         ctrl->taskPerfMonitor = true;
         return 0;
     }
+    if (IS_OPTION("task-trace")) {
+        if (i + 1 >= nArgNum || strInput[i + 1][0] == _T('-')) {
+            print_cmd_error_invalid_value(option_name, strInput[i]);
+            return 1;
+        }
+        i++;
+        ctrl->taskTrace = strInput[i];
+        return 0;
+    }
     if (IS_OPTION("lowlatency")) {
         ctrl->lowLatency = true;
         return 0;
@@ -6709,6 +6754,20 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
         ctrl->threadAudio = value;
         return 0;
     }
+    if (IS_OPTION("thread-pipeline")) {
+        i++;
+        int value = 0;
+        if (1 != _stscanf_s(strInput[i], _T("%d"), &value)) {
+            print_cmd_error_invalid_value(option_name, strInput[i]);
+            return 1;
+        }
+        if (value < 0 || value >= 2) {
+            print_cmd_error_invalid_value(option_name, strInput[i], _T("shoule be 0 or 1"));
+            return 1;
+        }
+        ctrl->threadPipeline = value;
+        return 0;
+    }
     if (IS_OPTION("thread-affinity")) {
         if (i + 1 >= nArgNum || strInput[i + 1][0] == _T('-')) {
             return 0;
@@ -6926,6 +6985,20 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
         ctrl->outputBufSizeMB = (std::min)(value, RGY_OUTPUT_BUF_MB_MAX);
         return 0;
     }
+    if (IS_OPTION("output-async")) {
+        i++;
+        int value = 0;
+        if (1 != _stscanf_s(strInput[i], _T("%d"), &value)) {
+            print_cmd_error_invalid_value(option_name, strInput[i]);
+            return 1;
+        }
+        if (value < 0) {
+            print_cmd_error_invalid_value(option_name, strInput[i], _T("--output-async should be set in positive value."));
+            return 1;
+        }
+        ctrl->outputAsyncDepth = (std::min)(value, RGY_OUTPUT_ASYNC_DEPTH_MAX);
+        return 0;
+    }
     if (IS_OPTION("thread-csp")) {
         i++;
         int value = 0;
@@ -6987,7 +7060,30 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
             print_cmd_error_invalid_value(option_name, strInput[i]);
             return 1;
         }
-        ctrl->perfMonitorInterval = std::max(50, v);
+        ctrl->perfMonitorInterval = std::max(10, v);
+        return 0;
+    }
+    if (IS_OPTION("metrics")) {
+        if (i + 1 >= nArgNum || strInput[i + 1][0] == _T('-')) {
+            print_cmd_error_invalid_value(option_name, strInput[i]);
+            return 1;
+        }
+        i++;
+        ctrl->metrics = strInput[i];
+        return 0;
+    }
+    if (IS_OPTION("metrics-port")) {
+        i++;
+        int v = 0;
+        if (1 != _stscanf_s(strInput[i], _T("%d"), &v)) {
+            print_cmd_error_invalid_value(option_name, strInput[i]);
+            return 1;
+        }
+        if (v < 0 || v > 65535) {
+            print_cmd_error_invalid_value(option_name, strInput[i], _T("should be 1-65535 (0 to disable)"));
+            return 1;
+        }
+        ctrl->metricsPort = v;
         return 0;
     }
     if (IS_OPTION("parent-pid")) {
@@ -7170,6 +7266,15 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
                     }
                     continue;
                 }
+                if (param_arg == _T("mem-limit")) {
+                    try {
+                        ctrl->parallelEnc.memLimitMB = std::stoi(param_val);
+                    } catch (...) {
+                        print_cmd_error_invalid_value(tstring(option_name) + _T(" ") + param_arg + _T("="), param_val);
+                        return 1;
+                    }
+                    continue;
+                }
                 print_cmd_error_unknown_opt_param(option_name, param_arg, paramList);
                 return 1;
             } else {
@@ -8072,6 +8177,13 @@ tstring gen_cmd(const RGYParamCommon *param, const RGYParamCommon *defaultPrm, b
     OPT_NUM(_T("--input-probesize"), demuxProbesize);
     OPT_TSTR(_T("--input-pixel-format"), inputPixFmtStr);
     OPT_NUM(_T("--input-retry"), inputRetry);
+    OPT_NUM(_T("--input-prefetch"), inputPrefetchMB);
+    if (param->inputIndex) {
+        cmd << _T(" --input-index");
+        if (param->inputIndexDir.length() > 0) {
+            cmd << _T(" \"") << param->inputIndexDir << _T("\"");
+        }
+    }
     if (param->nTrimCount > 0) {
         cmd << _T(" --trim ");
         for (int i = 0; i < param->nTrimCount; i++) {
@@ -8493,9 +8605,11 @@ tstring gen_cmd(const RGYParamCommon *param, const RGYParamCommon *defaultPrm, b
 tstring gen_cmd(const RGYParamControl *param, const RGYParamControl *defaultPrm, bool save_disabled_prm) {
     std::basic_stringstream<TCHAR> cmd;
     OPT_NUM(_T("--output-buf"), outputBufSizeMB);
+    OPT_NUM(_T("--output-async"), outputAsyncDepth);
     OPT_NUM(_T("--thread-output"), threadOutput);
     OPT_NUM(_T("--thread-input"), threadInput);
     OPT_NUM(_T("--thread-audio"), threadAudio);
+    OPT_NUM(_T("--thread-pipeline"), threadPipeline);
     OPT_NUM(_T("--thread-csp"), threadCsp);
     if (param->threadParams != defaultPrm->threadParams) {
         cmd << _T(" --thread-affinity ")    << param->threadParams.to_string(RGYParamThreadType::affinity);
@@ -8512,6 +8626,7 @@ tstring gen_cmd(const RGYParamControl *param, const RGYParamControl *defaultPrm,
         }
     }
     OPT_BOOL(_T("--task-perf-monitor"), _T(""), taskPerfMonitor);
+    OPT_STR_PATH(_T("--task-trace"), taskTrace);
     OPT_BOOL(_T("--lowlatency"), _T(""), lowLatency);
     OPT_STR_PATH(_T("--log"), logfile);
     if (param->loglevel != defaultPrm->loglevel) {
@@ -8524,6 +8639,7 @@ tstring gen_cmd(const RGYParamControl *param, const RGYParamControl *defaultPrm,
         ADD_BOOL(_T("addtime"), logOpt.addTime);
         ADD_BOOL(_T("addlevel"), logOpt.addLogLevel);
         ADD_BOOL(_T("color"), logOpt.disableColor);
+        ADD_BOOL(_T("async"), logOpt.async);
         if (!tmp.str().empty()) {
             cmd << _T(" --log-opt ") << tmp.str().substr(1);
         }
@@ -8568,6 +8684,8 @@ tstring gen_cmd(const RGYParamControl *param, const RGYParamControl *defaultPrm,
         }
     }
     OPT_NUM(_T("--perf-monitor-interval"), perfMonitorInterval);
+    OPT_STR_PATH(_T("--metrics"), metrics);
+    OPT_NUM(_T("--metrics-port"), metricsPort);
     if (param->parentProcessID != defaultPrm->parentProcessID) {
         cmd << strsprintf(_T(" --parent-pid %x"), param->parentProcessID);
     }
@@ -8603,7 +8721,9 @@ tstring gen_cmd(const RGYParamControl *param, const RGYParamControl *defaultPrm,
         tmp.str(tstring());
         ADD_NUM(_T("mp"), parallelEnc.parallelCount);
         ADD_NUM(_T("id"), parallelEnc.parallelId);
+        ADD_NUM(_T("chunks"), parallelEnc.chunks);
         ADD_LST(_T("cache"), parallelEnc.cacheMode, list_parallel_enc_cache);
+        ADD_NUM(_T("mem-limit"), parallelEnc.memLimitMB);
         if (!tmp.str().empty()) {
             cmd << _T(" --parallel ") << tmp.str().substr(1);
         }
@@ -8740,6 +8860,16 @@ tstring gen_cmd_help_common() {
         _T("                                 could be only used with avhw/avsw reader.\n")
         _T("                                 use if reader fails to detect audio stream.\n")
         _T("   --input-probesize <int>      set size in bytes which reader analyze input file.\n")
+        _T("   --input-prefetch <int>       prefetch input file in large blocks on a separate thread,\n")
+        _T("                                 keeping up to <int> MB ahead of the read position.\n")
+        _T("                                 could be only used with avhw/avsw reader.\n")
+        _T("                                 default: 0 (disabled).\n")
+        _T("   --input-index [<string>]     save packet positions, keyframes and detected frame rate\n")
+        _T("                                 of the input file to an index file, and use it to skip\n")
+        _T("                                 analysis and seek directly in later runs.\n")
+        _T("                                 index file is saved next to the input file,\n")
+        _T("                                 or in the directory if specified.\n")
+        _T("                                 could be only used with avhw/avsw reader.\n")
         //_T("   --input-retry <int>          set retry count for openning input file.\n")
         //_T("                                 could useful for streaming input.\n")
         //_T("                                  default: disabled.\n")
@@ -9640,7 +9770,14 @@ tstring gen_cmd_help_vpp() {
 tstring gen_cmd_help_ctrl() {
     tstring str = strsprintf(_T("\n")
 #if ENABLE_PARALLEL_ENC
-        _T("   --parallel <int> or auto     Enable parallel encoding by file splitting.\n")
+        _T("   --parallel <int> or auto[,<param1>=<value>]\n")
+        _T("                                Enable parallel encoding by file splitting.\n")
+        _T("    params\n")
+        _T("      chunks=<int>              number of chunks to split the input into.\n")
+        _T("                                  by default, split into smaller keyframe aligned\n")
+        _T("                                  chunks than the parallel count when possible.\n")
+        _T("      mem-limit=<int>           max RAM (MB) to hold encoded chunks before\n")
+        _T("                                  spilling them to temporary files.\n")
 #endif
         _T("   --log <string>               set log file name\n")
         _T("   --log-level <string>         set log level\n")
@@ -9649,6 +9786,7 @@ tstring gen_cmd_help_ctrl() {
         _T("     additional options for log output.\n")
         _T("    params\n")
         _T("      addtime                   add time to log lines.\n")
+        _T("      async                     write log from a background thread.\n")
         _T("   --log-framelist [<string>]   output debug info for avsw/avhw reader.\n")
         _T("   --log-packets [<string>]     output debug info for avsw/avhw reader.\n")
         _T("   --log-mux-ts [<string>]      output debug info for avsw/avhw reader.\n"));
@@ -9668,12 +9806,26 @@ tstring gen_cmd_help_ctrl() {
         DEFAULT_DUMMY_LOAD_PERCENT);
     str += strsprintf(_T("")
         _T("   --task-perf-monitor          enable task performance monitoring.\n")
-        _T("   --lowlatency                 minimize latency (might have lower throughput).\n"));
+        _T("   --task-trace <string>        record per-frame timings of each pipeline task\n")
+        _T("                                 and demux/mux/audio threads to the file\n")
+        _T("                                 in Chrome trace event format (json),\n")
+        _T("                                 and show latency stats (p50/p99/max) at the end.\n")
+        _T("   --lowlatency                 minimize latency (might have lower throughput).\n")
+        _T("   --thread-pipeline <int>      run each pipeline stage (decode, filter, encode)\n")
+        _T("                                 on its own thread.\n")
+        _T("                                  0: disable (default)\n")
+        _T("                                  1: enable\n"));
     str += strsprintf(_T("")
         _T("   --output-buf <int>           buffer size for output in MByte\n")
         _T("                                 default %d MB (0-%d)\n"),
         RGY_OUTPUT_BUF_MB_DEFAULT, RGY_OUTPUT_BUF_MB_MAX
     );
+    str += strsprintf(_T("")
+        _T("   --output-async <int>         write elementary stream output asynchronously\n")
+        _T("                                 with <int> writes in flight (io_uring on Linux).\n")
+        _T("                                 default 0 (disabled), max %d\n"),
+        RGY_OUTPUT_ASYNC_DEPTH_MAX
+    );
 #if ENABLE_AVCODEC_OUT_THREAD
     str += strsprintf(_T("")
         _T("   --output-thread <int>        set output thread num\n")
@@ -9798,6 +9950,9 @@ tstring gen_cmd_help_ctrl() {
         _T("                                 io_read     ... io read  (MB/s)\n")
         _T("                                 io_write    ... io write (MB/s)\n")
         _T("                                 io          ... monitor all io info\n")
+        _T("                                 out_inflight... bytes in flight of --output-async (KB)\n")
+        _T("                                 out_latency ... write latency of --output-async (ms)\n")
+        _T("                                 in_prefetch ... hit rate (%) and stall time (ms) of --input-prefetch\n")
         _T("                                 fps         ... encode speed (fps)\n")
         _T("                                 fps_avg     ... encode avg. speed (fps)\n")
         _T("                                 bitrate     ... encode bitrate (kbps)\n")
@@ -9805,6 +9960,11 @@ tstring gen_cmd_help_ctrl() {
         _T("                                 frame_out   ... written_frames\n")
         _T("                                 \n")
         _T("   --perf-monitor-interval <int> set perf monitor check interval (millisec)\n")
-        _T("                                 default 500, must be 50 or more\n"));
+        _T("                                 default 500, must be 10 or more\n")
+        _T("   --metrics <string>           write progress and perf info as newline-delimited\n")
+        _T("                                 json every --perf-monitor-interval to\n")
+        _T("                                  <filename>, fd:<int> or unix:<path> (Linux only).\n")
+        _T("   --metrics-port <int>         serve progress and perf info in Prometheus text\n")
+        _T("                                 format on http://127.0.0.1:<int>/metrics.\n"));
     return str;
 }
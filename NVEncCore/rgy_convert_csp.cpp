@@ -0,0 +1,179 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#include <algorithm>
+#include <cstdlib>
+#include "rgy_osdep.h"
+#include "rgy_convert_csp.h"
+#include "rgy_thread_pool.h"
+#include "cpu_info.h"
+
+RGYConvertCSPPrm::RGYConvertCSPPrm() :
+    abort(false),
+    dst(),
+    src(),
+    interlaced(false),
+    width(0),
+    src_y_pitch_byte(0),
+    src_uv_pitch_byte(0),
+    dst_y_pitch_byte(0),
+    dst_uv_pitch_byte(0),
+    height(0),
+    dst_height(0),
+    crop() {
+
+}
+
+//1つの短冊の入出力がL2キャッシュの半分程度に収まるよう、短冊の数を決める
+//短冊の数はスレッド数以上とし、短冊の高さは16ライン以上とする
+static int convert_csp_strip_count(int threads, int height, int src_y_pitch_byte, int dst_y_pitch_byte) {
+    static const int cacheSize = []() {
+        const auto cpu = std::make_unique<cpu_info_t>(get_cpu_info());
+        const int level = (int)RGYCacheLevel::L2 - 1;
+        return (cpu->cache_count[level] > 0 && cpu->caches[level][0].size > 0) ? cpu->caches[level][0].size : 256 * 1024;
+    }();
+    //色差分も含め、おおよそ輝度の2倍のデータを読み書きするとみなす
+    const int bytesPerLine = std::max(1, (std::abs(src_y_pitch_byte) + std::abs(dst_y_pitch_byte)) * 2);
+    const int stripLines = std::max(16, ((cacheSize / 2) / bytesPerLine) & ~15);
+    const int strips = (height + stripLines - 1) / stripLines;
+    return std::max(threads, std::min(strips, height / 16));
+}
+
+
+RGYConvertCSP::RGYConvertCSP() : RGYConvertCSP(0, RGYParamThread()) {
+}
+
+RGYConvertCSP::RGYConvertCSP(int threads, RGYParamThread threadParam) :
+    m_csp(nullptr),
+    m_csp_from(RGY_CSP_NA),
+    m_csp_to(RGY_CSP_NA),
+    m_uv_only(false),
+    m_alpha(nullptr),
+    m_threads(threads),
+    m_strips(0),
+    m_pool(),
+    m_group(std::make_unique<RGYThreadPoolGroup>()),
+    m_running(false),
+    m_threadParam(threadParam), m_prm() {
+};
+
+RGYConvertCSP::~RGYConvertCSP() {
+    wait();
+    m_pool.reset();
+};
+const ConvertCSP *RGYConvertCSP::getFunc(RGY_CSP csp_from, RGY_CSP csp_to, bool uv_only, RGY_SIMD simd) {
+    if (m_csp == nullptr
+        || (m_csp_from != csp_from || m_csp_to != csp_to || m_uv_only != uv_only)) {
+        m_csp_from = csp_from;
+        m_csp_to = csp_to;
+        m_uv_only = uv_only;
+        m_alpha = get_copy_alpha_func(csp_from, csp_to);
+        m_csp = get_convert_csp_func(csp_from, csp_to, uv_only, simd);
+    }
+    return m_csp;
+}
+
+const ConvertCSP *RGYConvertCSP::getFunc(RGY_CSP csp_from, RGY_CSP csp_to, RGY_SIMD simd) {
+    return getFunc(csp_from, csp_to, m_uv_only, simd);
+}
+
+void RGYConvertCSP::runStrip(int strip_id) {
+    const auto prm = &m_prm;
+    m_csp->func[prm->interlaced](prm->dst, prm->src,
+        prm->width, prm->src_y_pitch_byte, prm->src_uv_pitch_byte, prm->dst_y_pitch_byte, prm->dst_uv_pitch_byte,
+        prm->height, prm->dst_height, strip_id, m_strips, prm->crop);
+    if (m_alpha) {
+        const int dstPlaneOffset = RGY_CSP_PLANES[m_csp_from] - 1;
+        const int srcPlaneOffset = RGY_CSP_PLANES[m_csp_to] - 1;
+        m_alpha(prm->dst + dstPlaneOffset, prm->src + srcPlaneOffset,
+            prm->width, prm->src_y_pitch_byte, 0, prm->dst_y_pitch_byte, prm->dst_uv_pitch_byte,
+            prm->height, prm->dst_height, strip_id, m_strips, prm->crop);
+    }
+}
+
+int RGYConvertCSP::runAsync(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int *crop) {
+    wait();
+    if (m_threads == 0) {
+        const int div = (m_csp->simd == RGY_SIMD::NONE) ? 2 : 4;
+        const int max = (m_csp->simd == RGY_SIMD::NONE) ? 8 : 4;
+        m_threads = (dst_y_pitch_byte % 128 != 0) ? 1 : std::min(max, ((int)get_cpu_info().physical_cores + div) / div);
+    }
+    if (m_threads > 1 && !m_pool) {
+        m_pool = RGYThreadPool::shared(m_threads, m_threadParam);
+    }
+    m_prm.abort = false;
+    m_prm.interlaced = interlaced;
+    for (int i = 0; i < RGY_MAX_PLANES; i++) {
+        m_prm.dst[i] = dst[i];
+        m_prm.src[i] = src[i];
+    }
+    m_prm.width = width;
+    m_prm.src_y_pitch_byte = src_y_pitch_byte;
+    m_prm.src_uv_pitch_byte = src_uv_pitch_byte;
+    m_prm.dst_y_pitch_byte = dst_y_pitch_byte;
+    m_prm.dst_uv_pitch_byte = dst_uv_pitch_byte;
+    m_prm.height = height;
+    m_prm.dst_height = dst_height;
+    for (int i = 0; i < _countof(m_prm.crop); i++) {
+        m_prm.crop[i] = (crop) ? crop[i] : 0;
+    }
+    if (!m_pool) {
+        m_strips = 1;
+        runStrip(0);
+        return 0;
+    }
+    //短冊ごとにタスクとして投入し、空いているワーカーから順に処理させる
+    m_strips = convert_csp_strip_count(m_threads, height, src_y_pitch_byte, dst_y_pitch_byte);
+    m_group->add(m_strips);
+    m_running = true;
+    for (int i = 0; i < m_strips; i++) {
+        RGYThreadPoolTask task;
+        task.func = [](void *ctx, int index) { ((RGYConvertCSP *)ctx)->runStrip(index); };
+        task.ctx = this;
+        task.index = i;
+        task.group = m_group.get();
+        if (!m_pool->submit(task)) {
+            runStrip(i);
+            m_group->done();
+        }
+    }
+    return 0;
+}
+
+void RGYConvertCSP::wait() {
+    if (m_running) {
+        m_pool->wait(*m_group);
+        m_running = false;
+    }
+}
+
+int RGYConvertCSP::run(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int *crop) {
+    const int ret = runAsync(interlaced, dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte, height, dst_height, crop);
+    wait();
+    return ret;
+}
@@ -0,0 +1,89 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#pragma once
+#ifndef __RGY_CONVERT_CSP_H__
+#define __RGY_CONVERT_CSP_H__
+
+#include <memory>
+#include "convert_csp.h"
+#include "rgy_thread_affinity.h"
+
+class RGYThreadPool;
+class RGYThreadPoolGroup;
+
+struct RGYConvertCSPPrm {
+    bool abort;
+    void *dst[RGY_MAX_PLANES];       //runAsyncで非同期に処理するため、ポインタの配列はコピーして保持する
+    const void *src[RGY_MAX_PLANES];
+    int interlaced;
+    int width;
+    int src_y_pitch_byte;
+    int src_uv_pitch_byte;
+    int dst_y_pitch_byte;
+    int dst_uv_pitch_byte;
+    int height;
+    int dst_height;
+    int crop[4];
+
+    RGYConvertCSPPrm();
+};
+
+class RGYConvertCSP {
+private:
+    const ConvertCSP *m_csp;
+    RGY_CSP m_csp_from;
+    RGY_CSP m_csp_to;
+    bool m_uv_only;
+    funcConvertCSP m_alpha;
+    int m_threads;
+    int m_strips; //変換を分割する短冊の数 (短冊ごとの入出力がキャッシュに収まるよう決める)
+    std::shared_ptr<RGYThreadPool> m_pool; //m_threads > 1のとき、変換を分担するスレッドプール
+    std::unique_ptr<RGYThreadPoolGroup> m_group; //runAsyncで投入した短冊の完了待ち用
+    bool m_running; //runAsyncの処理中
+    RGYParamThread m_threadParam;
+    RGYConvertCSPPrm m_prm;
+
+    void runStrip(int strip_id);
+public:
+    RGYConvertCSP();
+    RGYConvertCSP(int threads, RGYParamThread threadParam);
+    ~RGYConvertCSP();
+    const ConvertCSP *getFunc(RGY_CSP csp_from, RGY_CSP csp_to, RGY_SIMD simd);
+    const ConvertCSP *getFunc(RGY_CSP csp_from, RGY_CSP csp_to, bool uv_only, RGY_SIMD simd);
+    const ConvertCSP *getFunc() const { return m_csp; };
+
+    //変換を行い、終了するまで待つ
+    int run(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int *crop);
+    //変換をスレッドプールに投入してすぐに戻る、srcとdstの指す先はwait()まで有効である必要がある
+    int runAsync(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int *crop);
+    //runAsyncの変換の終了を待つ
+    void wait();
+};
+
+#endif //__RGY_CONVERT_CSP_H__
@@ -54,6 +54,8 @@ static const int MAX_SPLIT_CHANNELS = 32;
 static const char *RGY_CHANNEL_AUTO = "RGY_CHANNEL_AUTO";
 static const int RGY_OUTPUT_BUF_MB_DEFAULT = 8;
 static const int RGY_OUTPUT_BUF_MB_MAX = 128;
+static const int RGY_OUTPUT_ASYNC_DEPTH_MAX = 64;
+static const int RGY_OUTPUT_ASYNC_BLOCK_MB_MIN = 1;
 
 static const TCHAR *RGY_AVCODEC_AUTO = _T("auto");
 static const TCHAR *RGY_AVCODEC_COPY = _T("copy");
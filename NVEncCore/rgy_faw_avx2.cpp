@@ -25,6 +25,7 @@
 //
 // --------------------------------------------------------------------------------------------
 
+#include <algorithm>
 #define RGY_MEMMEM_AVX2
 #include "rgy_faw.h"
 
@@ -37,9 +38,9 @@ size_t rgy_memmem_fawstart1_avx2(const void *data_, const size_t data_size) {
 void rgy_convert_audio_16to8_avx2(uint8_t *dst, const short *src, const size_t n) {
     uint8_t *byte = dst;
     const short *sh = src;
-    uint8_t * const loop_start = (uint8_t *)(((size_t)dst + 31) & ~31);
-    uint8_t * const loop_fin = (uint8_t *)(((size_t)dst + n) & ~31);
     uint8_t * const fin = dst + n;
+    uint8_t * const loop_start = std::min((uint8_t *)(((size_t)dst + 31) & ~31), fin); //nが小さい場合にfinを越えないように
+    uint8_t * const loop_fin = (uint8_t *)(((size_t)dst + n) & ~31);
     __m256i ySA, ySB;
     static const __m256i yConst = _mm256_set1_epi16(128);
     //アライメント調整
@@ -71,7 +72,7 @@ void rgy_convert_audio_16to8_avx2(uint8_t *dst, const short *src, const size_t n
 
 void rgy_split_audio_16to8x2_avx2(uint8_t *dst0, uint8_t *dst1, const short *src, const size_t n) {
     const short *sh = src;
-    const short *sh_fin = src + (n & ~15);
+    const short *sh_fin = src + (n & ~31);
     __m256i y0, y1, y2, y3;
     __m256i yMask = _mm256_srli_epi16(_mm256_cmpeq_epi8(_mm256_setzero_si256(), _mm256_setzero_si256()), 8);
     __m256i yConst = _mm256_set1_epi8(-128);
@@ -89,7 +90,7 @@ void rgy_split_audio_16to8x2_avx2(uint8_t *dst0, uint8_t *dst1, const short *src
         _mm256_storeu_si256((__m256i*)dst0, y0);
         _mm256_storeu_si256((__m256i*)dst1, y2);
     }
-    sh_fin = sh + (n & 15);
+    sh_fin = sh + (n & 31);
     for (; sh < sh_fin; sh++, dst0++, dst1++) {
         *dst0 = (*sh >> 8) + 128;
         *dst1 = (*sh & 0xff) + 128;
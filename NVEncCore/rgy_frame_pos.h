@@ -0,0 +1,743 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#pragma once
+#ifndef __RGY_FRAME_POS_H__
+#define __RGY_FRAME_POS_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "rgy_avutil.h"
+#include "rgy_queue.h"
+#include "convert_csp.h"
+
+static const uint32_t AV_FRAME_MAX_REORDER = 16;
+static const int FRAMEPOS_POC_INVALID = -1;
+
+enum RGYPtsStatus : uint32_t {
+    RGY_PTS_UNKNOWN           = 0x00,
+    RGY_PTS_NORMAL            = 0x01,
+    RGY_PTS_SOMETIMES_INVALID = 0x02, //時折、無効なptsを得る
+    RGY_PTS_HALF_INVALID      = 0x04, //PAFFなため、半分のフレームのptsやdtsが無効
+    RGY_PTS_ALL_INVALID       = 0x08, //すべてのフレームのptsやdtsが無効
+    RGY_PTS_NONKEY_INVALID    = 0x10, //キーフレーム以外のフレームのptsやdtsが無効
+    RGY_PTS_DUPLICATE         = 0x20, //重複するpts/dtsが存在する
+    RGY_DTS_SOMETIMES_INVALID = 0x40, //時折、無効なdtsを得る
+};
+
+static RGYPtsStatus operator|(RGYPtsStatus a, RGYPtsStatus b) {
+    return (RGYPtsStatus)((uint32_t)a | (uint32_t)b);
+}
+
+static RGYPtsStatus operator|=(RGYPtsStatus& a, RGYPtsStatus b) {
+    a = a | b;
+    return a;
+}
+
+static RGYPtsStatus operator&(RGYPtsStatus a, RGYPtsStatus b) {
+    return (RGYPtsStatus)((uint32_t)a & (uint32_t)b);
+}
+
+static RGYPtsStatus operator&=(RGYPtsStatus& a, RGYPtsStatus b) {
+    a = (RGYPtsStatus)((uint32_t)a & (uint32_t)b);
+    return a;
+}
+
+//フレームの位置情報と長さを格納する
+typedef struct FramePos {
+    int64_t pts;  //pts
+    int64_t dts;  //dts
+    int duration;  //該当フレーム/フィールドの表示時間
+    int duration2; //ペアフィールドの表示時間
+    int poc; //出力時のフレーム番号
+    uint8_t flags;    //flags (キーフレームならAV_PKT_FLAG_KEY)
+    uint8_t pic_struct; //RGY_PICSTRUCT_xxx
+    uint8_t repeat_pict; //通常は1, RFFなら2+
+    uint8_t pict_type; //I,P,Bフレーム
+} FramePos;
+
+#if _DEBUG
+#define DEBUG_FRAME_COPY(x) { if (m_fpDebugCopyFrameData) { (x); } }
+#else
+#define DEBUG_FRAME_COPY(x)
+#endif
+
+static FramePos framePosInit() {
+    FramePos pos;
+    pos.pts = 0;
+    pos.dts = 0;
+    pos.duration = 0;
+    pos.duration2 = 0;
+    pos.poc = FRAMEPOS_POC_INVALID;
+    pos.flags = 0;
+    pos.pic_struct = RGY_PICSTRUCT_FRAME;
+    pos.repeat_pict = 0;
+    pos.pict_type = 0;
+    return pos;
+}
+
+static FramePos framePos(int64_t pts, int64_t dts,
+    int duration, int duration2 = 0,
+    int poc = FRAMEPOS_POC_INVALID,
+    uint8_t flags = 0, uint8_t pic_struct = RGY_PICSTRUCT_FRAME, uint8_t repeat_pict = 0, uint8_t pict_type = 0) {
+    FramePos pos;
+    pos.pts = pts;
+    pos.dts = dts;
+    pos.duration = duration;
+    pos.duration2 = duration2;
+    pos.poc = poc;
+    pos.flags = flags;
+    pos.pic_struct = pic_struct;
+    pos.repeat_pict = repeat_pict;
+    pos.pict_type = pict_type;
+    return pos;
+}
+
+class CompareFramePos {
+public:
+    uint32_t threshold;
+    CompareFramePos() : threshold(0xFFFFFFFF) {
+    }
+    bool operator() (const FramePos& posA, const FramePos& posB) const {
+        return ((uint32_t)std::abs(posA.pts - posB.pts) < threshold) ? posA.pts < posB.pts : posB.pts < posA.pts;
+    }
+};
+
+class FramePosList {
+public:
+    FramePosList() :
+        m_frameDuration(0.0),
+        m_list(),
+        m_nextFixNumIndex(0),
+        m_inputFin(false),
+        m_duration(0),
+        m_durationNum(0),
+        m_streamPtsStatus(RGY_PTS_UNKNOWN),
+        m_lastPoc(0),
+        m_firstKeyframePts(AV_NOPTS_VALUE),
+        m_ptsAllInvalidPtsStartPointPts(AV_NOPTS_VALUE),
+        m_ptsAllInvalidPtsStartPointIndex(0),
+        m_maxPts(0),
+        m_PAFFRewind(0),
+        m_ptsWrapArroundThreshold(0xFFFFFFFF),
+        m_fixedPts(),
+        m_fixedPtsDescent(),
+        m_fpDebugCopyFrameData() {
+        m_list.init();
+        static_assert(sizeof(m_list.get()[0]) == sizeof(m_list.get()->data), "FramePos must not have padding.");
+    };
+    virtual ~FramePosList() {
+        clear();
+    }
+#pragma warning(push)
+#pragma warning(disable:4100)
+    int setLogCopyFrameData(const TCHAR *pLogFileName) {
+        if (pLogFileName == nullptr) return 0;
+#if _DEBUG
+        FILE *fp = NULL;
+        if (_tfopen_s(&fp, pLogFileName, _T("w"))) {
+            return 1;
+        }
+        m_fpDebugCopyFrameData.reset(fp);
+        return 0;
+#else
+        return 1;
+#endif
+    }
+#pragma warning(pop)
+    //filenameに情報をcsv形式で出力する
+    int printList(const TCHAR *filename) {
+        const int nList = (int)m_list.size();
+        if (nList == 0) {
+            return 0;
+        }
+        if (filename == nullptr) {
+            return 1;
+        }
+        FILE *fp = nullptr;
+        if (0 != _tfopen_s(&fp, filename, _T("wb")) || fp == nullptr) {
+            return 1;
+        }
+        fprintf(fp, "     poc, T,flags,repeat,  pts,         dts,duration,duration2,pic_struct\r\n");
+        for (int i = 0; i < nList; i++) {
+            fprintf(fp, "%8d,%2s,%2d,%2d,%12lld, %12lld, %6d, %6d, %s\r\n",
+                m_list[i].data.poc,
+                (m_list[i].data.pict_type == 1) ? "I" : ((m_list[i].data.pict_type == 2) ? "P" : ((m_list[i].data.pict_type == 3) ? "B" : "X")),
+                (int)m_list[i].data.flags, m_list[i].data.repeat_pict,
+                (lls)m_list[i].data.pts, (lls)m_list[i].data.dts,
+                m_list[i].data.duration, m_list[i].data.duration2,
+                tchar_to_string(picstrcut_to_str((RGY_PICSTRUCT)m_list[i].data.pic_struct)).c_str());
+        }
+        fclose(fp);
+        return 0;
+    }
+    //indexの位置への参照を返す
+    // !! push側のスレッドからのみ有効 !!
+    FramePos& list(uint32_t index) {
+        return m_list[index].data;
+    }
+    //初期化
+    void clear() {
+        m_list.close();
+        m_frameDuration = 0.0;
+        m_nextFixNumIndex = 0;
+        m_inputFin = false;
+        m_duration = 0;
+        m_durationNum = 0;
+        m_streamPtsStatus = RGY_PTS_UNKNOWN;
+        m_lastPoc = 0;
+        m_firstKeyframePts = AV_NOPTS_VALUE;
+        m_ptsAllInvalidPtsStartPointPts = AV_NOPTS_VALUE;
+        m_ptsAllInvalidPtsStartPointIndex = 0;
+        m_maxPts = 0;
+        m_PAFFRewind = 0;
+        m_ptsWrapArroundThreshold = 0xFFFFFFFF;
+        invalidateFixedPts(0);
+        m_fpDebugCopyFrameData.reset();
+        m_list.init();
+    }
+    //ここまで計算したdurationを返す
+    int64_t duration() const {
+        return m_duration;
+    }
+    //登録された(ptsの確定していないものを含む)フレーム数を返す
+    int frameNum() const {
+        return (int)m_list.size();
+    }
+    //ptsが確定したフレーム数を返す
+    int fixedNum() const {
+        return m_nextFixNumIndex;
+    }
+    //登録されたフレームのptsのうち、最大のものを返す
+    int64_t getMaxPts() const {
+        return m_maxPts;
+    }
+    void clearPtsStatus() {
+        if (m_streamPtsStatus & RGY_PTS_DUPLICATE) {
+            const int nListSize = (int)m_list.size();
+            for (int i = 0; i < nListSize; i++) {
+                if (m_list[i].data.duration == 0
+                    && m_list[i].data.pts != AV_NOPTS_VALUE
+                    && m_list[i].data.dts != AV_NOPTS_VALUE
+                    && m_list[i+1].data.pts - m_list[i].data.pts <= (std::min)(m_list[i+1].data.duration / 10, 1)
+                    && m_list[i+1].data.dts - m_list[i].data.dts <= (std::min)(m_list[i+1].data.duration / 10, 1)) {
+                    m_list[i].data.duration = m_list[i+1].data.duration;
+                }
+            }
+        }
+        m_lastPoc = 0;
+        m_nextFixNumIndex = 0;
+        invalidateFixedPts(0);
+        m_streamPtsStatus = RGY_PTS_UNKNOWN;
+        m_PAFFRewind = 0;
+        m_ptsWrapArroundThreshold = 0xFFFFFFFF;
+    }
+    RGYPtsStatus getStreamPtsStatus() const {
+        return m_streamPtsStatus;
+    }
+    FramePos findpts(int64_t pts, uint32_t *lastIndex) {
+        FramePos pos_last = framePosInit();
+        for (uint32_t index = *lastIndex + 1; ; index++) {
+            FramePos pos = framePosInit();
+            if (!m_list.copy(&pos, index)) {
+                break;
+            }
+            if (pts == pos.pts) {
+                *lastIndex = index;
+                return pos;
+            }
+            pos_last = pos;
+        }
+        //最初から探索
+        for (uint32_t index = 0; ; index++) {
+            FramePos pos = framePosInit();
+            if (!m_list.copy(&pos, index)) {
+                break;
+            }
+            if (pts == pos.pts) {
+                *lastIndex = index;
+                return pos;
+            }
+            //pts < demux.videoFramePts[i]であるなら、その前のフレームを返す
+            if (pts < pos.pts) {
+                *lastIndex = index-1;
+                return pos_last;
+            }
+            pos_last = pos;
+        }
+        //エラー
+        FramePos poserr = framePosInit();
+        return poserr;
+    }
+    //index >= iStartのフレームのうち、ptsが引数のptsより大きい(upper=falseなら、pts以上の)最初のフレームのindexを返す
+    //見つからなければframeNum()を返す
+    //ptsの確定したフレームは、ptsが単調増加する範囲ごとに、iStartから指数的に範囲を広げたのち二分探索する
+    //ptsの確定していないフレームは、ソートされていないので順に探索する
+    // !! push側のスレッドからのみ有効 !!
+    int findPtsIndex(int64_t pts, int iStart, bool upper) {
+        syncFixedPts();
+        auto found = [pts, upper](int64_t framePts) { return (upper) ? pts < framePts : pts <= framePts; };
+        const int fixedNum = (int)m_fixedPts.size();
+        int i = (std::max)(iStart, 0);
+        while (i < fixedNum) {
+            //iを含む、ptsが単調増加する範囲の終わり
+            const auto descent = std::upper_bound(m_fixedPtsDescent.begin(), m_fixedPtsDescent.end(), i);
+            const int runEnd = (descent != m_fixedPtsDescent.end()) ? *descent : fixedNum;
+            if (found(m_fixedPts[runEnd-1])) {
+                //前回の位置の近くにあることが多いので、まず範囲を倍々に広げて絞り込む
+                int lo = i, hi = i;
+                for (int step = 1; !found(m_fixedPts[hi]); step *= 2) {
+                    lo = hi + 1;
+                    hi = (std::min)(hi + step, runEnd - 1);
+                }
+                const auto ptr = m_fixedPts.data();
+                return (int)(std::partition_point(ptr + lo, ptr + hi, [&found](int64_t framePts) { return !found(framePts); }) - ptr);
+            }
+            i = runEnd;
+        }
+        const int nListSize = (int)m_list.size();
+        for (; i < nListSize; i++) {
+            if (found(m_list[i].data.pts)) {
+                return i;
+            }
+        }
+        return nListSize;
+    }
+    //FramePosを追加し、内部状態を変更する
+    void add(const FramePos& pos) {
+        m_list.push(pos);
+        const int nListSize = (int)m_list.size();
+        //自分のフレームのインデックス
+        const int nIndex = nListSize-1;
+        //ptsの補正
+        adjustFrameInfo(nIndex);
+        //最初のキーフレームの位置を記憶しておく
+        if (m_firstKeyframePts == AV_NOPTS_VALUE && (pos.flags & AV_PKT_FLAG_KEY) && nIndex == 0) {
+            m_firstKeyframePts = m_list[nIndex].data.pts;
+        }
+        //m_streamPtsStatusがRGY_PTS_UNKNOWNの場合には、ソートなどは行わない
+        if (m_inputFin || (m_streamPtsStatus && nListSize - m_nextFixNumIndex > (int)AV_FRAME_MAX_REORDER)) {
+            //ptsでソート
+            sortPts(m_nextFixNumIndex, nListSize - m_nextFixNumIndex);
+            setPocAndFix(nListSize);
+        }
+        calcDuration();
+    };
+    //pocの一致するフレームの情報のコピーを返す
+    FramePos copy(int poc, uint32_t *lastIndex) {
+        assert(lastIndex != nullptr);
+        for (uint32_t index = *lastIndex + 1; ; index++) {
+            FramePos pos = framePosInit();
+            if (!m_list.copy(&pos, index)) {
+                break;
+            }
+            if (pos.poc == poc) {
+                *lastIndex = index;
+                DEBUG_FRAME_COPY(_ftprintf(m_fpDebugCopyFrameData.get(), _T("request poc: %8d, hit index: %8d, pts: %lld\n"), poc, index, (lls)pos.pts));
+                return pos;
+            }
+            if (m_inputFin && pos.poc == -1) {
+                //もう読み込みは終了しているが、さらなるフレーム情報の要求が来ている
+                //予想より出力が過剰になっているということで、tsなどで最初がopengopの場合に起こりうる
+                //なにかおかしなことが起こっており、異常なのだが、最後の最後でエラーとしてしまうのもあほらしい
+                //とりあえず、ptsを推定して返してしまう
+                pos.poc = poc;
+                FramePos pos_tmp = framePosInit();
+                m_list.copy(&pos_tmp, index-1);
+                int nLastPoc = pos_tmp.poc;
+                int64_t nLastPts = pos_tmp.pts;
+                m_list.copy(&pos_tmp, 0);
+                int64_t pts0 = pos_tmp.pts;
+                m_list.copy(&pos_tmp, 1);
+                if (pos_tmp.poc == -1) {
+                    m_list.copy(&pos_tmp, 2);
+                }
+                int64_t pts1 = pos_tmp.pts;
+                int nFrameDuration = (int)(pts1 - pts0);
+                pos.pts = nLastPts + (poc - nLastPoc) * nFrameDuration;
+                DEBUG_FRAME_COPY(_ftprintf(m_fpDebugCopyFrameData.get(), _T("request poc: %8d, hit index: %8d [invalid], estimated pts: %lld\n"), poc, index, (lls)pos.pts));
+                return pos;
+            }
+        }
+        //エラー
+        FramePos pos = framePosInit();
+        DEBUG_FRAME_COPY(_ftprintf(m_fpDebugCopyFrameData.get(), _T("request: %8d, invalid, list size: %d\n"), poc, (int)m_list.size()));
+        return pos;
+    }
+    //入力が終了した際に使用し、内部状態を変更する
+    void fin(const FramePos& pos, int64_t total_duration) {
+        m_inputFin = true;
+        if (m_streamPtsStatus == RGY_PTS_UNKNOWN) {
+            checkPtsStatus();
+        }
+        const int nFrame = (int)m_list.size();
+        sortPts(m_nextFixNumIndex, nFrame - m_nextFixNumIndex);
+        m_nextFixNumIndex += m_PAFFRewind;
+        for (int i = m_nextFixNumIndex; i < nFrame; i++) {
+            adjustDurationAfterSort(m_nextFixNumIndex);
+            setPoc(i);
+        }
+        m_nextFixNumIndex = nFrame;
+        add(pos);
+        m_nextFixNumIndex += m_PAFFRewind;
+        m_PAFFRewind = 0;
+        m_duration = total_duration;
+        m_durationNum = m_nextFixNumIndex;
+    }
+    bool isEof() const {
+        return m_inputFin;
+    }
+    //現在の情報から、ptsの状態を確認する
+    //さらにptsの補正、ptsのソート、pocの確定を行う
+    void checkPtsStatus(double durationHintifPtsAllInvalid = 0.0) {
+        const int nInputPacketCount = (int)m_list.size();
+        int nInputFrames = 0;
+        int nInputFields = 0;
+        int nInputKeys = 0;
+        int nDuplicateFrameInfo = 0;
+        int nInvalidPtsCount = 0;
+        int nInvalidDtsCount = 0;
+        int nInvalidPtsCountField = 0;
+        int nInvalidPtsCountKeyFrame = 0;
+        int nInvalidPtsCountNonKeyFrame = 0;
+        int nInvalidDuration = 0;
+        bool bFractionExists = std::abs(durationHintifPtsAllInvalid - (int)(durationHintifPtsAllInvalid + 0.5)) > 1e-6;
+        m_ptsAllInvalidPtsStartPointPts = 0;
+        vector<std::pair<int, int>> durationHistgram;
+        for (int i = 0; i < nInputPacketCount; i++) {
+            nInputFrames += (m_list[i].data.pic_struct & RGY_PICSTRUCT_FRAME) != 0;
+            nInputFields += (m_list[i].data.pic_struct & RGY_PICSTRUCT_FIELD) != 0;
+            nInputKeys   += (m_list[i].data.flags & AV_PKT_FLAG_KEY) != 0;
+            nInvalidDuration += m_list[i].data.duration <= 0;
+            if (m_list[i].data.pts == AV_NOPTS_VALUE) {
+                nInvalidPtsCount++;
+                nInvalidPtsCountField += (m_list[i].data.pic_struct & RGY_PICSTRUCT_FIELD) != 0;
+                nInvalidPtsCountKeyFrame += (m_list[i].data.flags & AV_PKT_FLAG_KEY) != 0;
+                nInvalidPtsCountNonKeyFrame += (m_list[i].data.flags & AV_PKT_FLAG_KEY) == 0;
+            }
+            if (m_list[i].data.dts == AV_NOPTS_VALUE) {
+                nInvalidDtsCount++;
+            }
+            if (i > 0) {
+                //VP8/VP9では重複するpts/dts/durationを持つフレームが存在することがあるが、これを無視する
+                if (bFractionExists
+                    && m_list[i].data.duration > 0
+                    && m_list[i].data.pts != AV_NOPTS_VALUE
+                    && m_list[i].data.dts != AV_NOPTS_VALUE
+                    && m_list[i-1].data.pts != AV_NOPTS_VALUE // mkvでは、最初の負のdtsがAV_NOPTS_VALUEで返ることがあるので判定から除外
+                    && m_list[i-1].data.dts != AV_NOPTS_VALUE // mkvでは、最初の負のdtsがAV_NOPTS_VALUEで返ることがあるので判定から除外
+                    && m_list[i].data.pts - m_list[i-1].data.pts <= (std::min)(m_list[i].data.duration / 10, 1)
+                    && m_list[i].data.dts - m_list[i-1].data.dts <= (std::min)(m_list[i].data.duration / 10, 1)
+                    && m_list[i].data.duration == m_list[i-1].data.duration) {
+                    nDuplicateFrameInfo++;
+                }
+            }
+            int nDuration = m_list[i].data.duration;
+            auto target = std::find_if(durationHistgram.begin(), durationHistgram.end(), [nDuration](const std::pair<int, int>& pair) { return pair.first == nDuration; });
+            if (target != durationHistgram.end()) {
+                target->second++;
+            } else {
+                durationHistgram.push_back(std::make_pair(nDuration, 1));
+            }
+        }
+        //多い順にソートする
+        std::sort(durationHistgram.begin(), durationHistgram.end(), [](const std::pair<int, int>& pairA, const std::pair<int, int>& pairB) { return pairA.second > pairB.second; });
+        m_streamPtsStatus = RGY_PTS_UNKNOWN;
+        if (nDuplicateFrameInfo > 0) {
+            //VP8/VP9では重複するpts/dts/durationを持つフレームが存在することがあるが、これを無視する
+            m_streamPtsStatus |= RGY_PTS_DUPLICATE;
+        }
+        if (nInvalidPtsCount == 0) {
+            m_streamPtsStatus |= RGY_PTS_NORMAL;
+        } else {
+            m_frameDuration = durationHintifPtsAllInvalid;
+            if (nInvalidPtsCount >= nInputPacketCount - 1) {
+                if (m_list[0].data.duration || durationHintifPtsAllInvalid > 0.0) {
+                    //durationが得られていれば、durationに基づいて、cfrでptsを発行する
+                    //主にH.264/HEVCのESなど
+                    m_streamPtsStatus |= RGY_PTS_ALL_INVALID;
+                } else {
+                    //durationがなければ、dtsを見てptsを発行する
+                    //主にVC-1ストリームなど
+                    m_streamPtsStatus |= RGY_PTS_SOMETIMES_INVALID;
+                }
+            } else if (nInputFields > 0 && nInvalidPtsCountField <= nInputFields / 2) {
+                //主にH.264のPAFFストリームなど
+                m_streamPtsStatus |= RGY_PTS_HALF_INVALID;
+            } else if (nInvalidPtsCountKeyFrame == 0 && nInvalidPtsCountNonKeyFrame > (nInputPacketCount - nInputKeys) * 3 / 4) {
+                m_streamPtsStatus |= RGY_PTS_NONKEY_INVALID;
+                if (nInvalidPtsCount == nInvalidDtsCount) {
+                    //ワンセグなど、ptsもdtsもキーフレーム以外は得られない場合
+                    m_streamPtsStatus |= RGY_DTS_SOMETIMES_INVALID;
+                }
+                if (nInvalidDuration == 0) {
+                    //ptsがだいぶいかれてるので、安定してdurationが得られていれば、durationベースで作っていったほうが早い
+                    m_streamPtsStatus |= RGY_PTS_SOMETIMES_INVALID;
+                }
+            }
+            if (!(m_streamPtsStatus & (RGY_PTS_ALL_INVALID | RGY_PTS_HALF_INVALID | RGY_PTS_NONKEY_INVALID | RGY_PTS_SOMETIMES_INVALID))
+                && nInvalidPtsCount > nInputPacketCount / 16) {
+                m_streamPtsStatus |= RGY_PTS_SOMETIMES_INVALID;
+            }
+        }
+        if ((m_streamPtsStatus & RGY_PTS_ALL_INVALID)) {
+            auto& mostPopularDuration = durationHistgram[durationHistgram.size() > 1 && durationHistgram[0].first == 0];
+            if ((m_frameDuration > 0.0 && m_list[0].data.duration == 0) || mostPopularDuration.first == 0) {
+                //主にH.264/HEVCのESなど向けの対策
+                m_list[0].data.duration = (int)(m_frameDuration * ((m_list[0].data.pic_struct & RGY_PICSTRUCT_FIELD) ? 0.5 : 1.0) + 0.5);
+            } else {
+                //durationのヒストグラムを作成
+                m_frameDuration = durationHistgram[durationHistgram.size() > 1 && durationHistgram[0].first == 0].first;
+            }
+            // 先頭のフレームには時刻があれば、その時刻を先頭のptsとして計算するようにする "Hard Target.mkv"等
+            if (m_list[0].data.pts != AV_NOPTS_VALUE) {
+                m_ptsAllInvalidPtsStartPointPts = m_list[0].data.pts;
+                m_ptsAllInvalidPtsStartPointIndex = 0;
+            }
+        }
+        for (int i = m_nextFixNumIndex; i < nInputPacketCount; i++) {
+            adjustFrameInfo(i);
+        }
+        sortPts(m_nextFixNumIndex, nInputPacketCount - m_nextFixNumIndex);
+        setPocAndFix(nInputPacketCount);
+        if (m_nextFixNumIndex > 1) {
+            int64_t pts0 = m_list[0].data.pts;
+            int64_t pts1 = m_list[1 + (m_list[0].data.poc == -1)].data.pts;
+            m_ptsWrapArroundThreshold = (uint32_t)clamp((int64_t)(std::max)((uint32_t)(pts1 - pts0), (uint32_t)(m_frameDuration + 0.5)) * 360, 360, (int64_t)0xFFFFFFFF);
+        }
+    }
+    RGY_PICSTRUCT getVideoPicStruct() {
+        const int nListSize = (int)m_list.size();
+        for (int i = 0; i < nListSize; i++) {
+            auto pic_struct = m_list[i].data.pic_struct;
+            if (pic_struct & RGY_PICSTRUCT_INTERLACED) {
+                return (RGY_PICSTRUCT)(pic_struct & RGY_PICSTRUCT_INTERLACED);
+            }
+        }
+        return RGY_PICSTRUCT_FRAME;
+    }
+protected:
+    //ptsでソート
+    void sortPts(uint32_t index, uint32_t len) {
+#if (!defined(_MSC_VER) && __cplusplus <= 201103) || defined(__NVCC__)
+        FramePos *pStart = (FramePos *)m_list.get(index);
+        FramePos *pEnd = (FramePos *)m_list.get(index + len);
+        std::sort(pStart, pEnd, CompareFramePos());
+#else
+        const auto nPtsWrapArroundThreshold = m_ptsWrapArroundThreshold;
+        std::sort(m_list.get(index), m_list.get(index + len), [nPtsWrapArroundThreshold](const auto& posA, const auto& posB) {
+            return ((uint32_t)(std::abs(posA.data.pts - posB.data.pts)) < nPtsWrapArroundThreshold) ? posA.data.pts < posB.data.pts : posB.data.pts < posA.data.pts; });
+#endif
+    }
+    //ptsの補正
+    void adjustFrameInfo(uint32_t nIndex) {
+        if (m_list[nIndex].data.pts != AV_NOPTS_VALUE) {
+            m_ptsAllInvalidPtsStartPointPts = m_list[nIndex].data.pts;
+            m_ptsAllInvalidPtsStartPointIndex = nIndex;
+        }
+        if (m_streamPtsStatus & RGY_PTS_SOMETIMES_INVALID) {
+            if (m_streamPtsStatus & RGY_DTS_SOMETIMES_INVALID) {
+                //ptsもdtsはあてにならないので、durationから再構築する (ワンセグなど)
+                if (nIndex == 0) {
+                    if (m_list[nIndex].data.pts == AV_NOPTS_VALUE) {
+                        m_list[nIndex].data.pts = 0;
+                    }
+                } else if (m_list[nIndex].data.pts == AV_NOPTS_VALUE) {
+                    m_list[nIndex].data.pts = m_list[nIndex-1].data.pts + m_list[nIndex-1].data.duration;
+                }
+            } else {
+                //ptsはあてにならないので、dtsから再構築する (VC-1など)
+                int64_t firstFramePtsDtsDiff = m_list[0].data.pts - m_list[0].data.dts;
+                if (nIndex > 0 && m_list[nIndex].data.dts == AV_NOPTS_VALUE) {
+                    m_list[nIndex].data.dts = m_list[nIndex-1].data.dts + m_list[0].data.duration;
+                }
+                m_list[nIndex].data.pts = m_list[nIndex].data.dts + firstFramePtsDtsDiff;
+            }
+        } else if (m_list[nIndex].data.pts == AV_NOPTS_VALUE) {
+            if (nIndex == 0) {
+                m_list[nIndex].data.pts = 0;
+                m_list[nIndex].data.dts = 0;
+            } else if (m_streamPtsStatus & RGY_PTS_ALL_INVALID) {
+                //AVPacketのもたらすptsが無効であれば、CFRを仮定して適当にptsとdurationを突っ込んでいく
+                const double frameDuration = m_frameDuration * ((m_list[0].data.pic_struct & RGY_PICSTRUCT_FIELD) ? 2.0 : 1.0);
+                m_list[nIndex].data.pts = m_ptsAllInvalidPtsStartPointPts + (int64_t)((nIndex - m_ptsAllInvalidPtsStartPointIndex) * frameDuration * ((m_list[nIndex].data.pic_struct & RGY_PICSTRUCT_FIELD) ? 0.5 : 1.0) + 0.5);
+                m_list[nIndex].data.dts = m_list[nIndex].data.pts;
+            } else if (m_streamPtsStatus & RGY_PTS_NONKEY_INVALID) {
+                //キーフレーム以外のptsとdtsが無効な場合は、適当に推定する
+                double frameDuration = m_frameDuration * ((m_list[0].data.pic_struct & RGY_PICSTRUCT_FIELD) ? 2.0 : 1.0);
+                m_list[nIndex].data.pts = m_list[nIndex-1].data.pts + (int)(frameDuration * ((m_list[nIndex].data.pic_struct & RGY_PICSTRUCT_FIELD) ? 0.5 : 1.0) + 0.5);
+                m_list[nIndex].data.dts = m_list[nIndex-1].data.dts + (int)(frameDuration * ((m_list[nIndex].data.pic_struct & RGY_PICSTRUCT_FIELD) ? 0.5 : 1.0) + 0.5);
+            } else if (m_streamPtsStatus & RGY_PTS_HALF_INVALID) {
+                //ptsがないのは音声抽出で、正常に抽出されない問題が生じる
+                //半分PTSがないPAFFのような動画については、前のフレームからの補完を行う
+                if (m_list[nIndex].data.dts == AV_NOPTS_VALUE) {
+                    m_list[nIndex].data.dts = m_list[nIndex-1].data.dts + m_list[nIndex-1].data.duration;
+                }
+                m_list[nIndex].data.pts = m_list[nIndex-1].data.pts + m_list[nIndex-1].data.duration;
+            } else if (m_streamPtsStatus & RGY_PTS_NORMAL) {
+                if (m_list[nIndex].data.pts == AV_NOPTS_VALUE) {
+                    m_list[nIndex].data.pts = m_list[nIndex-1].data.pts + m_list[nIndex-1].data.duration;
+                }
+            }
+        }
+        //最大ptsの更新
+        if (m_list[nIndex].data.pts != AV_NOPTS_VALUE) {
+            m_maxPts = std::max(m_maxPts, m_list[nIndex].data.pts);
+        }
+    }
+    //ソートにより確定したptsに対して、pocを設定する
+    void setPoc(int index) {
+        if ((m_streamPtsStatus & RGY_PTS_DUPLICATE)
+            && m_list[index].data.duration == 0
+            && m_list[index+1].data.pts - m_list[index].data.pts <= (std::min)(m_list[index+1].data.duration / 10, 1)
+            && m_list[index+1].data.dts - m_list[index].data.dts <= (std::min)(m_list[index+1].data.duration / 10, 1)) {
+            //VP8/VP9では重複するpts/dts/durationを持つフレームが存在することがあるが、これを無視する
+            m_list[index].data.poc = FRAMEPOS_POC_INVALID;
+        } else if (m_list[index].data.pic_struct & RGY_PICSTRUCT_FIELD) {
+            if (index > 0 && (m_list[index-1].data.poc != FRAMEPOS_POC_INVALID && (m_list[index-1].data.pic_struct & RGY_PICSTRUCT_FIELD))) {
+                m_list[index].data.poc = FRAMEPOS_POC_INVALID;
+                m_list[index-1].data.duration2 = m_list[index].data.duration;
+            } else {
+                m_list[index].data.poc = m_lastPoc++;
+            }
+        } else {
+            m_list[index].data.poc = m_lastPoc++;
+        }
+    }
+    //ソート後にindexのdurationを再計算する
+    //ソートはindex+1まで確定している必要がある
+    //ソート後のこの段階では、AV_NOPTS_VALUEはないものとする
+    void adjustDurationAfterSort(int index) {
+        int diff = (int)(m_list[index+1].data.pts - m_list[index].data.pts);
+        if ((m_streamPtsStatus & RGY_PTS_DUPLICATE)
+            && diff <= 1
+            && m_list[index].data.duration > 0
+            && m_list[index].data.pts != AV_NOPTS_VALUE
+            && m_list[index].data.dts != AV_NOPTS_VALUE
+            && m_list[index+1].data.duration == m_list[index].data.duration
+            && m_list[index+1].data.pts - m_list[index].data.pts <= (std::min)(m_list[index].data.duration / 10, 1)
+            && m_list[index+1].data.dts - m_list[index].data.dts <= (std::min)(m_list[index].data.duration / 10, 1)) {
+            //VP8/VP9では重複するpts/dts/durationを持つフレームが存在することがあるが、これを無視する
+            m_list[index].data.duration = 0;
+        } else if (diff > 0) {
+            m_list[index].data.duration = diff;
+        }
+    }
+    //進捗表示用のdurationの計算を行う
+    //これは16フレームに1回行う
+    void calcDuration() {
+        int nNonDurationCalculatedFrames = m_nextFixNumIndex - m_durationNum;
+        if (nNonDurationCalculatedFrames >= 16) {
+            const auto *pos_fixed = m_list.get(m_durationNum);
+            int64_t duration = pos_fixed[nNonDurationCalculatedFrames-1].data.pts - pos_fixed[0].data.pts;
+            if (duration < 0 || duration > m_ptsWrapArroundThreshold) {
+                duration = 0;
+                for (int i = 1; i < nNonDurationCalculatedFrames; i++) {
+                    int64_t diff = (std::max<int64_t>)(0, pos_fixed[i].data.pts - pos_fixed[i-1].data.pts);
+                    int64_t last_frame_dur = (std::max<int64_t>)(0, pos_fixed[i-1].data.duration);
+                    duration += (diff > m_ptsWrapArroundThreshold) ? last_frame_dur : diff;
+                }
+            }
+            m_duration += duration;
+            m_durationNum += nNonDurationCalculatedFrames;
+        }
+    }
+    //pocを確定させる
+    void setPocAndFix(int nSortedSize) {
+        //ソートによりptsが確定している範囲
+        //本来はnSortedSize - (int)AV_FRAME_MAX_REORDERでよいが、durationを確定させるためにはさらにもう一枚必要になる
+        int nSortFixedSize = nSortedSize - (int)AV_FRAME_MAX_REORDER - 1;
+        m_nextFixNumIndex += m_PAFFRewind;
+        for (; m_nextFixNumIndex < nSortFixedSize; m_nextFixNumIndex++) {
+            if (m_list[m_nextFixNumIndex].data.pts < m_firstKeyframePts //ソートの先頭のptsが塚下キーフレームの先頭のptsよりも小さいことがある(opengop)
+                && m_nextFixNumIndex <= 16) { //wrap arroundの場合は除く
+                //これはフレームリストから取り除く
+                m_list.pop();
+                m_nextFixNumIndex--;
+                nSortFixedSize--;
+                invalidateFixedPts(0); //indexがずれるので作り直す
+            } else {
+                adjustDurationAfterSort(m_nextFixNumIndex);
+                //ソートにより確定したptsに対して、pocとdurationを設定する
+                setPoc(m_nextFixNumIndex);
+            }
+        }
+        m_PAFFRewind = 0;
+        //もし、現在のインデックスがフィールドデータの片割れなら、次のフィールドがくるまでdurationは確定しない
+        //setPocでduration2が埋まるのを待つ必要がある
+        if (m_nextFixNumIndex > 0
+            && (m_list[m_nextFixNumIndex-1].data.pic_struct & RGY_PICSTRUCT_FIELD)
+            && m_list[m_nextFixNumIndex-1].data.poc != FRAMEPOS_POC_INVALID) {
+            m_nextFixNumIndex--;
+            m_PAFFRewind = 1;
+            invalidateFixedPts(m_nextFixNumIndex); //再度ソートの対象となる
+        }
+    }
+    //m_fixedPtsのうち、index以降を破棄する
+    void invalidateFixedPts(int index) {
+        if ((int)m_fixedPts.size() > index) {
+            m_fixedPts.resize(index);
+            while (!m_fixedPtsDescent.empty() && m_fixedPtsDescent.back() >= index) {
+                m_fixedPtsDescent.pop_back();
+            }
+        }
+    }
+    //ptsの確定したフレームをm_fixedPtsに追加する
+    void syncFixedPts() {
+        for (int i = (int)m_fixedPts.size(); i < m_nextFixNumIndex; i++) {
+            const auto pts = m_list[i].data.pts;
+            if (i > 0 && pts < m_fixedPts.back()) {
+                m_fixedPtsDescent.push_back(i);
+            }
+            m_fixedPts.push_back(pts);
+        }
+    }
+protected:
+    double m_frameDuration; //CFRを仮定する際のフレーム長 (RGY_PTS_ALL_INVALID, RGY_PTS_NONKEY_INVALID, RGY_PTS_NONKEY_INVALID時有効)
+    RGYQueueMPMP<FramePos, 1> m_list; //内部データサイズとFramePosのデータサイズを一致させるため、alignを1に設定
+    int m_nextFixNumIndex; //次にptsを確定させるフレームのインデックス
+    bool m_inputFin; //入力が終了したことを示すフラグ
+    int64_t m_duration; //m_durationNumのフレーム数分のdurationの総和
+    int m_durationNum; //durationを計算したフレーム数
+    RGYPtsStatus m_streamPtsStatus; //入力から提供されるptsの状態 (RGY_PTS_xxx)
+    uint32_t m_lastPoc; //ptsが確定したフレームのうち、直近のpoc
+    int64_t m_firstKeyframePts; //最初のキーフレームのpts
+    int64_t m_ptsAllInvalidPtsStartPointPts; // RGY_PTS_ALL_INVALIDの時用の最初のpts
+    uint32_t m_ptsAllInvalidPtsStartPointIndex; // RGY_PTS_ALL_INVALIDの時用の最初のpts
+    int64_t m_maxPts; //最大のpts
+    int m_PAFFRewind; //PAFFのdurationを確定させるため、戻した枚数
+    uint32_t m_ptsWrapArroundThreshold; //wrap arroundを判定する閾値
+    std::vector<int64_t> m_fixedPts; //ptsの確定したフレームのpts (m_listと同じindex、探索用)
+    std::vector<int> m_fixedPtsDescent; //m_fixedPtsでptsが前のフレームより小さくなる位置 (wrap arroundなど)
+    unique_ptr<FILE, fp_deleter> m_fpDebugCopyFrameData; //copyのデバッグ用
+};
+
+#endif //__RGY_FRAME_POS_H__
@@ -79,136 +79,6 @@ const char *csp_rgy_to_y4mheader(const RGY_CSP csp) {
     return nullptr;
 }
 
-RGYConvertCSPPrm::RGYConvertCSPPrm() :
-    abort(false),
-    dst(nullptr),
-    src(nullptr),
-    interlaced(false),
-    width(0),
-    src_y_pitch_byte(0),
-    src_uv_pitch_byte(0),
-    dst_y_pitch_byte(0),
-    dst_uv_pitch_byte(0),
-    height(0),
-    dst_height(0),
-    crop(nullptr) {
-
-}
-
-
-RGYConvertCSP::RGYConvertCSP() : RGYConvertCSP(0, RGYParamThread()) {
-}
-
-RGYConvertCSP::RGYConvertCSP(int threads, RGYParamThread threadParam) :
-    m_csp(nullptr),
-    m_csp_from(RGY_CSP_NA),
-    m_csp_to(RGY_CSP_NA),
-    m_uv_only(false),
-    m_alpha(nullptr),
-    m_threads(threads),
-    m_th(), m_heStart(), m_heFin(), m_heFinCopy(),
-    m_threadParam(threadParam), m_prm() {
-};
-
-RGYConvertCSP::~RGYConvertCSP() {
-    m_prm.abort = true;
-    for (size_t i = 0; i < m_heStart.size(); i++) {
-        SetEvent(m_heStart[i].get());
-    }
-    for (size_t i = 0; i < m_th.size(); i++) {
-        m_th[i].join();
-    }
-    m_heFinCopy.clear();
-    m_heStart.clear();
-    m_heFin.clear();
-    m_th.clear();
-};
-const ConvertCSP *RGYConvertCSP::getFunc(RGY_CSP csp_from, RGY_CSP csp_to, bool uv_only, RGY_SIMD simd) {
-    if (m_csp == nullptr
-        || (m_csp_from != csp_from || m_csp_to != csp_to || m_uv_only != uv_only)) {
-        m_csp_from = csp_from;
-        m_csp_to = csp_to;
-        m_uv_only = uv_only;
-        m_alpha = get_copy_alpha_func(csp_from, csp_to);
-        m_csp = get_convert_csp_func(csp_from, csp_to, uv_only, simd);
-    }
-    return m_csp;
-}
-
-const ConvertCSP *RGYConvertCSP::getFunc(RGY_CSP csp_from, RGY_CSP csp_to, RGY_SIMD simd) {
-    return getFunc(csp_from, csp_to, m_uv_only, simd);
-}
-
-int RGYConvertCSP::run(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int *crop) {
-    if (m_threads == 0) {
-        const int div = (m_csp->simd == RGY_SIMD::NONE) ? 2 : 4;
-        const int max = (m_csp->simd == RGY_SIMD::NONE) ? 8 : 4;
-        m_threads = (dst_y_pitch_byte % 128 != 0) ? 1 : std::min(max, ((int)get_cpu_info().physical_cores + div) / div);
-    }
-    if (m_threads > 1 && m_th.size() == 0) {
-        m_heFinCopy.clear();
-        m_heStart.clear();
-        m_heFin.clear();
-        for (int ith = 0; ith < m_threads; ith++) {
-            auto heStart = std::unique_ptr<void, handle_deleter>(CreateEvent(nullptr, false, false, nullptr), handle_deleter());
-            auto heFin = std::unique_ptr<void, handle_deleter>(CreateEvent(nullptr, false, false, nullptr), handle_deleter());
-            m_th.push_back(std::thread([heStart = heStart.get(), heFin = heFin.get(), ithId = ith, threadN = m_threads, threadParam = m_threadParam,
-                prm = &m_prm, cspfunc = &m_csp, alphafunc = m_alpha, csp_from = m_csp_from, csp_to = m_csp_to]() {
-                threadParam.apply(GetCurrentThread());
-                WaitForSingleObject((HANDLE)heStart, INFINITE);
-                while (!prm->abort) {
-                    (*cspfunc)->func[prm->interlaced](prm->dst, prm->src,
-                        prm->width, prm->src_y_pitch_byte, prm->src_uv_pitch_byte, prm->dst_y_pitch_byte, prm->dst_uv_pitch_byte,
-                        prm->height, prm->dst_height, ithId, threadN, prm->crop);
-                    if (alphafunc) {
-                        const int dstPlaneOffset = RGY_CSP_PLANES[csp_from] - 1;
-                        const int srcPlaneOffset = RGY_CSP_PLANES[csp_to] - 1;
-                        alphafunc(prm->dst + dstPlaneOffset, prm->src + srcPlaneOffset,
-                            prm->width, prm->src_y_pitch_byte, 0, prm->dst_y_pitch_byte, prm->dst_uv_pitch_byte,
-                            prm->height, prm->dst_height, ithId, threadN, prm->crop);
-                    }
-                    SetEvent((HANDLE)heFin);
-                    WaitForSingleObject((HANDLE)heStart, INFINITE);
-                }
-            }));
-            m_heFinCopy.push_back(heFin.get());
-            m_heStart.push_back(std::move(heStart));
-            m_heFin.push_back(std::move(heFin));
-        }
-    }
-    m_prm.abort = false;
-    m_prm.interlaced = interlaced;
-    m_prm.dst = dst;
-    m_prm.src = src;
-    m_prm.width = width;
-    m_prm.src_y_pitch_byte = src_y_pitch_byte;
-    m_prm.src_uv_pitch_byte = src_uv_pitch_byte;
-    m_prm.dst_y_pitch_byte = dst_y_pitch_byte;
-    m_prm.dst_uv_pitch_byte = dst_uv_pitch_byte;
-    m_prm.height = height;
-    m_prm.dst_height = dst_height;
-    m_prm.crop = crop;
-    for (size_t i = 0; i < m_heStart.size(); i++) {
-        SetEvent(m_heStart[i].get());
-    }
-    if (m_threads == 1) {
-        m_csp->func[interlaced](dst, src,
-            width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte,
-            height, dst_height, 0, 1, crop);
-        if (m_alpha) {
-            const int dstPlaneOffset = RGY_CSP_PLANES[m_csp_from] - 1;
-            const int srcPlaneOffset = RGY_CSP_PLANES[m_csp_to] - 1;
-            m_alpha(dst + dstPlaneOffset, src + srcPlaneOffset,
-                width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, dst_uv_pitch_byte,
-                height, dst_height, 0, 1, crop);
-        }
-    }
-    if (m_th.size() > 0) {
-        WaitForMultipleObjects((uint32_t)m_heFinCopy.size(), m_heFinCopy.data(), TRUE, INFINITE);
-    }
-    return 0;
-}
-
 #if !FOR_AUO
 
 std::vector<int> read_keyfile(tstring keyfile) {
@@ -477,6 +347,7 @@ RGY_ERR initReaders(
     RGYPoolAVFrame *poolFrame,
     RGYListRef<RGYFrameDataQP> *qpTableListRef,
     CPerfMonitor *perfMonitor,
+    RGYTrace *trace,
     shared_ptr<RGYLog> log
 ) {
     int sourceAudioTrackIdStart = 1;    //トラック番号は1スタート
@@ -657,6 +528,10 @@ RGY_ERR initReaders(
         inputInfoAVCuvid.threadInput = ctrl->threadInput;
         inputInfoAVCuvid.threadParamInput = ctrl->threadParams.get(RGYThreadType::INPUT);
         inputInfoAVCuvid.queueInfo = (perfMonitor) ? perfMonitor->GetQueueInfoPtr() : nullptr;
+        inputInfoAVCuvid.trace = trace;
+        inputInfoAVCuvid.prefetchMB = common->inputPrefetchMB;
+        inputInfoAVCuvid.inputIndex = common->inputIndex;
+        inputInfoAVCuvid.inputIndexDir = common->inputIndexDir;
         inputInfoAVCuvid.HWDecCodecCsp = &HWDecCodecCsp;
         inputInfoAVCuvid.videoDetectPulldown = !vpp_rff && !vpp_afs && common->AVSyncMode == RGY_AVSYNC_AUTO;
         inputInfoAVCuvid.parseHDRmetadata = common->maxCll == maxCLLSource || common->masterDisplay == masterDisplaySource || vpp_require_hdr_metadata;
@@ -38,6 +38,7 @@
 #include "rgy_status.h"
 #include "rgy_timecode.h"
 #include "convert_csp.h"
+#include "rgy_convert_csp.h"
 #include "rgy_err.h"
 #include "rgy_util.h"
 #include "rgy_prm.h"
@@ -120,47 +121,7 @@ static const char *trackMediaTypeStr(int trackID) {
 }
 #endif //#if ENABLE_AVSW_READER
 
-struct RGYConvertCSPPrm {
-    bool abort;
-    void **dst;
-    const void **src;
-    int interlaced;
-    int width;
-    int src_y_pitch_byte;
-    int src_uv_pitch_byte;
-    int dst_y_pitch_byte;
-    int dst_uv_pitch_byte;
-    int height;
-    int dst_height;
-    int *crop;
-
-    RGYConvertCSPPrm();
-};
-
-class RGYConvertCSP {
-private:
-    const ConvertCSP *m_csp;
-    RGY_CSP m_csp_from;
-    RGY_CSP m_csp_to;
-    bool m_uv_only;
-    funcConvertCSP m_alpha;
-    int m_threads;
-    std::vector<std::thread> m_th;
-    std::vector<std::unique_ptr<void, handle_deleter>> m_heStart;
-    std::vector<std::unique_ptr<void, handle_deleter>> m_heFin;
-    std::vector<HANDLE> m_heFinCopy;
-    RGYParamThread m_threadParam;
-    RGYConvertCSPPrm m_prm;
-public:
-    RGYConvertCSP();
-    RGYConvertCSP(int threads, RGYParamThread threadParam);
-    ~RGYConvertCSP();
-    const ConvertCSP *getFunc(RGY_CSP csp_from, RGY_CSP csp_to, RGY_SIMD simd);
-    const ConvertCSP *getFunc(RGY_CSP csp_from, RGY_CSP csp_to, bool uv_only, RGY_SIMD simd);
-    const ConvertCSP *getFunc() const { return m_csp; };
-
-    int run(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int dst_uv_pitch_byte, int height, int dst_height, int *crop);
-};
+class RGYTrace;
 
 class RGYInputPrm {
 public:
@@ -368,6 +329,7 @@ RGY_ERR initReaders(
     RGYPoolAVFrame *poolFrame,
     RGYListRef<RGYFrameDataQP> *qpTableListRef,
     CPerfMonitor *perfMonitor,
+    RGYTrace *trace,
     shared_ptr<RGYLog> log
 );
 
@@ -42,6 +42,7 @@
 #include "rgy_avlog.h"
 #include "rgy_filesystem.h"
 #include "rgy_language.h"
+#include "rgy_trace.h"
 
 
 #if ENABLE_AVSW_READER
@@ -80,6 +81,7 @@ AVDemuxFormat::AVDemuxFormat() :
     inputBuffer(nullptr),
     inputBufferSize(0),
     inputFilesize(0),
+    prefetch(),
     subPacketTemporalBufferIntervalCount(-1),
     inputError(RGY_ERR_NONE) {
 }
@@ -110,6 +112,15 @@ void AVDemuxFormat::close(RGYLog *log) {
         CLOSE_LOG_DEBUG(_T("Closed avformat context.\n"));
         formatCtx = nullptr;
     }
+    if (prefetch) {
+        //AVFMT_FLAG_CUSTOM_IOの場合、avformat_close_inputではAVIOContextは解放されない
+        if (log) {
+            log->write(RGY_LOG_DEBUG, RGY_LOGT_IN, _T("prefetch: hit %.2f%% (%lld reads), stall %.3f sec.\n"),
+                prefetch->hitRate() * 100.0, (long long)prefetch->accessCount(), prefetch->stallUs() * 1e-6);
+        }
+        prefetch.reset();
+        CLOSE_LOG_DEBUG(_T("Closed prefetch avio context.\n"));
+    }
     if (formatOptions) {
         CLOSE_LOG_DEBUG(_T("Free formatOptions...\n"));
         av_dict_free(&formatOptions);
@@ -151,7 +162,10 @@ AVDemuxVideo::AVDemuxVideo() :
     contentLight(std::unique_ptr<AVContentLightMetadata, RGYAVDeleter<AVContentLightMetadata>>(nullptr, RGYAVDeleter<AVContentLightMetadata>(av_freep))),
     qpTableListRef(nullptr),
     parse_nal_h264(get_parse_nal_unit_h264_func()),
-    parse_nal_hevc(get_parse_nal_unit_hevc_func()) {
+    parse_nal_hevc(get_parse_nal_unit_hevc_func()),
+    scanNalHEVC(RGY_CODEC_HEVC),
+    unnalBuffer(),
+    inputIndex() {
 }
 
 void AVDemuxVideo::close(RGYLog *log) {
@@ -210,6 +224,7 @@ void AVDemuxVideo::close(RGYLog *log) {
         CLOSE_LOG_DEBUG(_T("Freed extra data.\n"));
         extradata = nullptr;
     }
+    inputIndex.reset();
     index = -1;
 }
 
@@ -264,6 +279,10 @@ RGYInputAvcodecPrm::RGYInputAvcodecPrm(RGYInputPrm base) :
     threadInput(0),
     threadParamInput(),
     queueInfo(nullptr),
+    trace(nullptr),
+    prefetchMB(0),
+    inputIndex(false),
+    inputIndexDir(),
     HWDecCodecCsp(nullptr),
     videoDetectPulldown(false),
     parseHDRmetadata(false),
@@ -339,6 +358,19 @@ void RGYInputAvcodec::Close() {
     AddMessage(RGY_LOG_DEBUG, _T("Closing...\n"));
     //リソースの解放
     CloseThread();
+    //先頭から終端まで読み込んだ場合は、インデックスファイルを書き出す
+    if (m_Demux.video.inputIndex && m_Demux.video.inputIndex->building() && !m_Demux.video.inputIndex->readyToSave()) {
+        AddMessage(RGY_LOG_DEBUG, _T("input index \"%s\" not written as the input was not read to the end.\n"), m_Demux.video.inputIndex->path().c_str());
+        m_Demux.video.inputIndex->cancelBuild();
+    }
+    if (m_Demux.video.inputIndex && m_Demux.video.inputIndex->readyToSave()) {
+        auto err = m_Demux.video.inputIndex->save();
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_WARN, _T("failed to write input index \"%s\": %s.\n"), m_Demux.video.inputIndex->path().c_str(), get_err_mes(err));
+        } else {
+            AddMessage(RGY_LOG_DEBUG, _T("wrote input index \"%s\": %d packets.\n"), m_Demux.video.inputIndex->path().c_str(), (int)m_Demux.video.inputIndex->packets().size());
+        }
+    }
     m_Demux.qVideoPkt.close([](AVPacket **pkt) { av_packet_free(pkt); });
     for (uint32_t i = 0; i < m_Demux.qStreamPktL1.size(); i++) {
         av_packet_free(&m_Demux.qStreamPktL1[i]);
@@ -892,7 +924,10 @@ RGY_ERR RGYInputAvcodec::getFirstFramePosAndFrameRate(const sTrim *pTrimList, in
                     break;
                 }
             }
-            if (!audioStreamPacketNotFound) {
+            if (!audioStreamPacketNotFound
+                && (nTrimCount == 0 // trimがある場合、offsetを適切に取得するため、最初のキーフレームの次のフレームまでを読み込む必要がある
+                    || gotNextFrameOfFirstKeyFrame
+                    || (m_Demux.frames.getStreamPtsStatus() & (RGY_PTS_ALL_INVALID | RGY_PTS_NONKEY_INVALID)) != 0)) {
                 break; //対象のすべてのストリームの音声の最初のパケットが見つかっていればOK
             }
         } else if (nFramesToCheck > 0) {
@@ -1315,11 +1350,11 @@ RGY_ERR RGYInputAvcodec::parseHDR10plusDOVIRpuHEVC(AVPacket *pkt, const bool hdr
     if (m_Demux.video.stream->codecpar->codec_id != AV_CODEC_ID_HEVC) {
         return RGY_ERR_UNSUPPORTED;
     }
-    const auto nal_list = m_Demux.video.parse_nal_hevc(pkt->data, pkt->size);
-    for (const auto& nal_unit : nal_list) {
+    RGY_ERR sts = RGY_ERR_NONE;
+    m_Demux.video.scanNalHEVC.scan(pkt->data, pkt->size, [&](const nal_info& nal_unit) {
         if (!(nal_unit.type == NALU_HEVC_PREFIX_SEI && hdr10plus)
             && !(nal_unit.type == NALU_HEVC_UNSPECIFIED && doviRpu)) {
-            continue;
+            return true;
         }
         const uint8_t *ptr = nal_unit.ptr;
         size_t header_size = 0;
@@ -1334,7 +1369,7 @@ RGY_ERR RGYInputAvcodec::parseHDR10plusDOVIRpuHEVC(AVPacket *pkt, const bool hdr
             && ptr[3] == 0x01) {
             header_size = 4;
         } else {
-            continue;
+            return true;
         }
         ptr += header_size;
         if (hdr10plus
@@ -1343,16 +1378,17 @@ RGY_ERR RGYInputAvcodec::parseHDR10plusDOVIRpuHEVC(AVPacket *pkt, const bool hdr
             && ptr[1] == 0x01
             && ptr[2] == USER_DATA_REGISTERED_ITU_T_T35) {
             ptr += 3;
-            const auto data_unnal = unnal(ptr, nal_unit.ptr + nal_unit.size - ptr);
+            auto& data_unnal = m_Demux.video.unnalBuffer;
+            unnal(data_unnal, ptr, nal_unit.ptr + nal_unit.size - ptr);
             ptr = data_unnal.data();
             size_t size = 0;
             while (*ptr == 0xff) {
                 size += *ptr++;
             }
             size += *ptr++;
-            auto sts = packMetadataToPacket(pkt, HDR10PLUS_METADATA_KEY, ptr, size);
+            sts = packMetadataToPacket(pkt, HDR10PLUS_METADATA_KEY, ptr, size);
             if (sts != RGY_ERR_NONE) {
-                return sts;
+                return false;
             }
         }
         if (doviRpu
@@ -1361,40 +1397,42 @@ RGY_ERR RGYInputAvcodec::parseHDR10plusDOVIRpuHEVC(AVPacket *pkt, const bool hdr
             && !nal_unit.nuh_layer_id
             && !nal_unit.temporal_id) {
             const auto size = nal_unit.ptr + nal_unit.size - ptr - 2;
-            const auto data_unnal = unnal(ptr + 2, size);
-            auto sts = packMetadataToPacket(pkt, DOVI_RPU_METADATA_KEY, data_unnal.data(), data_unnal.size());
+            auto& data_unnal = m_Demux.video.unnalBuffer;
+            unnal(data_unnal, ptr + 2, size);
+            sts = packMetadataToPacket(pkt, DOVI_RPU_METADATA_KEY, data_unnal.data(), data_unnal.size());
             if (sts != RGY_ERR_NONE) {
-                return sts;
+                return false;
             }
         }
-    }
-    return RGY_ERR_NONE;
+        return true;
+    });
+    return sts;
 }
 
 RGY_ERR RGYInputAvcodec::parseHDR10plusDOVIRpuAV1(AVPacket *pkt, const bool hdr10plus, const bool doviRpu) {
     if (m_Demux.video.stream->codecpar->codec_id != AV_CODEC_ID_AV1) {
         return RGY_ERR_UNSUPPORTED;
     }
-    const auto av1_unit_list = parse_unit_av1(pkt->data, pkt->size);
-    for (const auto& av1_unit : av1_unit_list) {
-        if (av1_unit->type != OBU_METADATA) {
-            continue;
+    RGY_ERR sts = RGY_ERR_NONE;
+    scan_unit_av1(pkt->data, pkt->size, [&](const obu_info& av1_unit) {
+        if (av1_unit.type != OBU_METADATA) {
+            return true;
         }
-        const uint8_t *const start_pos = av1_unit->unit_data.data();
-        const uint8_t *const fin_pos = start_pos + av1_unit->unit_data.size();
-        const uint8_t *const start_obu = start_pos + av1_unit->obu_offset;
+        const uint8_t *const start_pos = av1_unit.ptr;
+        const uint8_t *const fin_pos = start_pos + av1_unit.size;
+        const uint8_t *const start_obu = start_pos + av1_unit.obu_offset;
         if (start_obu[0] == AV1_METADATA_TYPE_ITUT_T35) { // metadata type
             const uint8_t *const start_metadata = start_obu + 1 /*metadata type*/;
-            int metadata_size = (int)av1_unit->unit_data.size() - av1_unit->obu_offset - 1/*metadata type*/;
+            int metadata_size = (int)av1_unit.size - av1_unit.obu_offset - 1/*metadata type*/;
             if (hdr10plus
                 && metadata_size > (int)sizeof(av1_itut_t35_header_hdr10plus)
                 && memcmp(start_metadata, av1_itut_t35_header_hdr10plus, sizeof(av1_itut_t35_header_hdr10plus)) == 0) {
                 if (fin_pos[-1] == 0x80) {
                     metadata_size--;
                 }
-                auto sts = packMetadataToPacket(pkt, HDR10PLUS_METADATA_KEY, start_metadata, metadata_size);
+                sts = packMetadataToPacket(pkt, HDR10PLUS_METADATA_KEY, start_metadata, metadata_size);
                 if (sts != RGY_ERR_NONE) {
-                    return sts;
+                    return false;
                 }
             }
             if (doviRpu
@@ -1403,14 +1441,15 @@ RGY_ERR RGYInputAvcodec::parseHDR10plusDOVIRpuAV1(AVPacket *pkt, const bool hdr1
                 if (fin_pos[-1] == 0x80) {
                     metadata_size--;
                 }
-                auto sts = packMetadataToPacket(pkt, DOVI_RPU_METADATA_KEY, start_metadata + sizeof(av1_itut_t35_header_dovirpu), metadata_size - sizeof(av1_itut_t35_header_dovirpu));
+                sts = packMetadataToPacket(pkt, DOVI_RPU_METADATA_KEY, start_metadata + sizeof(av1_itut_t35_header_dovirpu), metadata_size - sizeof(av1_itut_t35_header_dovirpu));
                 if (sts != RGY_ERR_NONE) {
-                    return sts;
+                    return false;
                 }
             }
         }
-    }
-    return RGY_ERR_NONE;
+        return true;
+    });
+    return sts;
 }
 
 RGYFrameDataHDR10plus *RGYInputAvcodec::getHDR10plusMetaData(const AVFrame *frame) {
@@ -1578,6 +1617,24 @@ RGY_ERR RGYInputAvcodec::initFormatCtx(const TCHAR *strFileName, const RGYInputA
             m_Demux.format.formatCtx->video_codec = codec;
         }
     }
+    if (input_prm->prefetchMB > 0) {
+        //ローカルのファイルの場合のみ、大きなブロック単位で先読みするAVIOContextを使用する
+        if (m_Demux.format.isPipe || filename_char.find("://") != std::string::npos) {
+            AddMessage(RGY_LOG_DEBUG, _T("prefetch disabled for pipe / protocol input.\n"));
+        } else {
+            const int blockCount = std::max(input_prm->prefetchMB / RGY_AVIO_PREFETCH_BLOCK_MB, 2);
+            m_Demux.format.prefetch = std::make_unique<RGYAVIOPrefetch>();
+            auto err = m_Demux.format.prefetch->open(strFileName, (size_t)RGY_AVIO_PREFETCH_BLOCK_MB * 1024 * 1024, blockCount, input_prm->queueInfo);
+            if (err != RGY_ERR_NONE) {
+                AddMessage(RGY_LOG_WARN, _T("failed to init input prefetch: %s, disabled.\n"), get_err_mes(err));
+                m_Demux.format.prefetch.reset();
+            } else {
+                m_Demux.format.formatCtx->pb = m_Demux.format.prefetch->avio();
+                m_Demux.format.formatCtx->flags |= AVFMT_FLAG_CUSTOM_IO;
+                AddMessage(RGY_LOG_DEBUG, _T("enabled input prefetch: %d x %d MB.\n"), blockCount, RGY_AVIO_PREFETCH_BLOCK_MB);
+            }
+        }
+    }
     //ファイルのオープン
     if ((ret = avformat_open_input(&(m_Demux.format.formatCtx), filename_char.c_str(), inFormat, &m_Demux.format.formatOptions)) != 0) {
         AddMessage(RGY_LOG_ERROR, _T("error opening file \"%s\": %s\n"), char_to_tstring(filename_char, CP_UTF8).c_str(), qsv_av_err2str(ret).c_str());
@@ -1634,6 +1691,11 @@ RGY_ERR RGYInputAvcodec::Init(const TCHAR *strFileName, VideoInfo *inputInfo, co
     m_Demux.video.readVideo = input_prm->readVideo;
     m_Demux.video.hevcbsf = input_prm->hevcbsf;
     m_Demux.thread.queueInfo = input_prm->queueInfo;
+    m_Demux.thread.trace = input_prm->trace;
+    if (m_Demux.thread.trace) {
+        m_Demux.thread.traceRead = m_Demux.thread.trace->registerEvent(_T("DEMUX"), _T("read"));
+        m_Demux.thread.traceQueue = m_Demux.thread.trace->registerEvent(_T("DEMUX"), _T("queue"));
+    }
     if (input_prm->readVideo) {
         m_inputVideoInfo = *inputInfo;
     } else {
@@ -2022,6 +2084,30 @@ RGY_ERR RGYInputAvcodec::Init(const TCHAR *strFileName, VideoInfo *inputInfo, co
             m_inputVideoInfo.codecExtraSize = m_Demux.video.stream->codecpar->extradata_size;
         }
 
+        if (input_prm->inputIndex) {
+            //ローカルのファイルの場合のみ、インデックスファイルを使用する
+            if (m_Demux.format.isPipe || _tcsstr(strFileName, _T("://")) != nullptr) {
+                AddMessage(RGY_LOG_DEBUG, _T("input index disabled for pipe / protocol input.\n"));
+            } else {
+                const RGYInputIndexStream indexStream = { m_Demux.video.index, (int)m_Demux.video.stream->codecpar->codec_id, to_rgy(m_Demux.video.stream->time_base) };
+                m_Demux.video.inputIndex = std::make_unique<RGYInputIndex>();
+                auto err = m_Demux.video.inputIndex->init(strFileName, input_prm->inputIndexDir);
+                if (err != RGY_ERR_NONE) {
+                    AddMessage(RGY_LOG_WARN, _T("failed to init input index: %s, disabled.\n"), get_err_mes(err));
+                    m_Demux.video.inputIndex.reset();
+                } else if ((err = m_Demux.video.inputIndex->load(indexStream)) == RGY_ERR_NONE) {
+                    AddMessage(RGY_LOG_DEBUG, _T("loaded input index \"%s\": %d packets.\n"), m_Demux.video.inputIndex->path().c_str(), (int)m_Demux.video.inputIndex->packets().size());
+                } else if (input_prm->seekSec > 0.0f || input_prm->seekRatio > 0.0f) {
+                    //インデックスファイルは先頭から終端まで読み込んだときのみ作成する
+                    AddMessage(RGY_LOG_DEBUG, _T("input index \"%s\" not available (%s), not created as seek is set.\n"), m_Demux.video.inputIndex->path().c_str(), get_err_mes(err));
+                    m_Demux.video.inputIndex.reset();
+                } else {
+                    AddMessage(RGY_LOG_DEBUG, _T("input index \"%s\" not available (%s), will be created.\n"), m_Demux.video.inputIndex->path().c_str(), get_err_mes(err));
+                    m_Demux.video.inputIndex->startBuild(indexStream);
+                }
+            }
+        }
+
         AddMessage(RGY_LOG_DEBUG, _T("start predecode.\n"));
 
         //ヘッダーの取得を確認する
@@ -2100,7 +2186,22 @@ RGY_ERR RGYInputAvcodec::Init(const TCHAR *strFileName, VideoInfo *inputInfo, co
                 seek_sec = seek_start_sec + (duration_fin_sec - seek_start_sec) * input_prm->seekRatio;
             }
             const auto seek_time = av_rescale_q(1, av_d2q(seek_sec, 1<<24), m_Demux.video.stream->time_base);
-            int seek_ret = av_seek_frame(m_Demux.format.formatCtx, m_Demux.video.index, firstpkt->pts + seek_time, 0);
+            int seek_ret = -1;
+            if (m_Demux.video.inputIndex && m_Demux.video.inputIndex->loaded()
+                && firstpkt->pts != AV_NOPTS_VALUE
+                && avformat_index_get_entries_count(m_Demux.video.stream) == 0
+                && (m_Demux.format.formatCtx->iformat->flags & AVFMT_NO_BYTE_SEEK) == 0) {
+                //コンテナにインデックスがない場合(tsなど)は、シーク先を探して読み込みを繰り返すことになるので、
+                //インデックスファイルからシーク先のキーフレームの位置を求め、その位置に直接シークする
+                const auto keyframe = m_Demux.video.inputIndex->findKeyframe(firstpkt->pts + seek_time);
+                if (keyframe && keyframe->pos >= 0) {
+                    seek_ret = av_seek_frame(m_Demux.format.formatCtx, -1, keyframe->pos, AVSEEK_FLAG_BYTE);
+                    AddMessage(RGY_LOG_DEBUG, _T("seek to keyframe %lld at byte offset %lld by input index: %d.\n"), (long long int)keyframe->pts, (long long int)keyframe->pos, seek_ret);
+                }
+            }
+            if (0 > seek_ret) {
+                seek_ret = av_seek_frame(m_Demux.format.formatCtx, m_Demux.video.index, firstpkt->pts + seek_time, 0);
+            }
             if (0 > seek_ret) {
                 seek_ret = av_seek_frame(m_Demux.format.formatCtx, m_Demux.video.index, firstpkt->pts + seek_time, AVSEEK_FLAG_ANY);
             }
@@ -2136,10 +2237,25 @@ RGY_ERR RGYInputAvcodec::Init(const TCHAR *strFileName, VideoInfo *inputInfo, co
         }
 #endif
 
-        if (RGY_ERR_NONE != (sts = getFirstFramePosAndFrameRate(input_prm->pTrimList, input_prm->nTrimCount, input_prm->videoDetectPulldown, input_prm->lowLatency, input_prm->videoAvgFramerate))) {
+        auto fpsOverride = input_prm->videoAvgFramerate;
+        if (!fpsOverride.is_valid() && m_Demux.video.inputIndex && m_Demux.video.inputIndex->loaded()) {
+            //インデックスファイルに前回検出したフレームレートがあれば、それを使用してフレームレートの解析を省略する
+            const auto fpsIndex = m_Demux.video.inputIndex->framerate();
+            if (fpsIndex.n() > 0 && fpsIndex.d() > 0) {
+                fpsOverride = fpsIndex;
+                AddMessage(RGY_LOG_DEBUG, _T("use framerate %d/%d from input index.\n"), fpsIndex.n(), fpsIndex.d());
+            }
+        }
+        if (RGY_ERR_NONE != (sts = getFirstFramePosAndFrameRate(input_prm->pTrimList, input_prm->nTrimCount, input_prm->videoDetectPulldown, input_prm->lowLatency, fpsOverride))) {
             AddMessage(RGY_LOG_ERROR, _T("failed to get first frame position.\n"));
             return sts;
         }
+        if (m_Demux.video.inputIndex && m_Demux.video.inputIndex->building()
+            && !fpsOverride.is_valid()
+            && (m_Demux.video.streamPtsInvalid & RGY_PTS_ALL_INVALID) == 0) {
+            //検出したフレームレートをインデックスファイルに記録する
+            m_Demux.video.inputIndex->setFramerate(to_rgy(m_Demux.video.nAvgFramerate));
+        }
 
         if (m_inputVideoInfo.frames > 0) {
             // avsw/avhwでは、--framesは--trimに置き換えて実現する
@@ -2587,35 +2703,25 @@ bool RGYInputAvcodec::checkOtherTimeSeekTo(int64_t pts, const AVDemuxStream *str
 int RGYInputAvcodec::getVideoFrameIdx(int64_t pts, AVRational timebase, int iStart) {
     const int framePosCount = m_Demux.frames.frameNum();
     const AVRational vid_pkt_timebase = (m_Demux.video.stream) ? m_Demux.video.stream->time_base : av_inv_q(m_Demux.video.nAvgFramerate);
-    if (av_cmp_q(timebase, vid_pkt_timebase) == 0) {
-        for (int i = (std::max)(0, iStart); i < framePosCount; i++) {
-            if (pts == m_Demux.frames.list(i).pts) {
-                return i;
-            }
-            //pts < demux.videoFramePts[i]であるなら、その前のフレームを返す
-            if (pts < m_Demux.frames.list(i).pts) {
-                //0フレーム目なら、仮想的に -1 フレーム目を考えて、それよりも前かどうかを判定する
-                //-2を返すことで、そのパケットは削除される
-                if (i == 0 && pts < m_Demux.frames.list(i).pts - m_Demux.frames.list(i).duration) {
-                    i--;
-                }
-                return i-1;
-            }
-        }
-    } else {
-        for (int i = (std::max)(0, iStart); i < framePosCount; i++) {
-            //pts < demux.videoFramePts[i]であるなら、その前のフレームを返す
-            if (av_compare_ts(pts, timebase, m_Demux.frames.list(i).pts, vid_pkt_timebase) < 0) {
-                //0フレーム目なら、仮想的に -1 フレーム目を考えて、それよりも前かどうかを判定する
-                //-2を返すことで、そのパケットは削除される
-                if (i == 0 && av_compare_ts(pts, timebase, m_Demux.frames.list(i).pts - m_Demux.frames.list(i).duration, vid_pkt_timebase) < 0) {
-                    i--;
-                }
-                return i-1;
-            }
-        }
+    const bool sameTimebase = av_cmp_q(timebase, vid_pkt_timebase) == 0;
+    //映像のtimebaseに一度だけ変換しておく
+    //切り捨てで変換すれば、映像フレームの(整数の)ptsとの大小関係はav_compare_tsと一致する
+    const int64_t ptsVid = (sameTimebase) ? pts : av_rescale_q_rnd(pts, timebase, vid_pkt_timebase, AV_ROUND_DOWN);
+    //timebaseが同じならptsが一致するフレームを、異なるならpts < demux.videoFramePts[i]となる最初のフレームを探す
+    int i = m_Demux.frames.findPtsIndex(ptsVid, iStart, !sameTimebase);
+    if (i >= framePosCount) {
+        return framePosCount;
     }
-    return framePosCount;
+    if (sameTimebase && ptsVid == m_Demux.frames.list(i).pts) {
+        return i;
+    }
+    //pts < demux.videoFramePts[i]であるなら、その前のフレームを返す
+    //0フレーム目なら、仮想的に -1 フレーム目を考えて、それよりも前かどうかを判定する
+    //-2を返すことで、そのパケットは削除される
+    if (i == 0 && ptsVid < m_Demux.frames.list(i).pts - m_Demux.frames.list(i).duration) {
+        i--;
+    }
+    return i-1;
 }
 
 int64_t RGYInputAvcodec::convertTimebaseVidToStream(int64_t pts, const AVDemuxStream *stream) {
@@ -2943,6 +3049,9 @@ std::tuple<int, std::unique_ptr<AVPacket, RGYAVDeleter<AVPacket>>> RGYInputAvcod
                     m_trimParam.offset++;
                 }
                 m_Demux.frames.add(pos);
+                if (m_Demux.video.inputIndex) {
+                    m_Demux.video.inputIndex->addPacket({ pkt->pts, pkt->dts, pkt->pos, pkt->size, keyframe ? RGY_INPUT_INDEX_PKT_KEY : 0 });
+                }
             }
             //ptsの確定したところまで、音声を出力する
             CheckAndMoveStreamPacketList();
@@ -2967,7 +3076,14 @@ std::tuple<int, std::unique_ptr<AVPacket, RGYAVDeleter<AVPacket>>> RGYInputAvcod
     }
     pkt.reset();
     //ファイルの終わりに到達
+    if (ret_read_frame == AVERROR_EOF && m_Demux.video.inputIndex) {
+        m_Demux.video.inputIndex->setComplete();
+    }
     if (ret_read_frame != AVERROR_EOF && ret_read_frame < 0) {
+        //終端まで読み込めないので、以降はインデックスにパケットを追加しない
+        if (m_Demux.video.inputIndex && m_Demux.video.inputIndex->building()) {
+            m_Demux.video.inputIndex->cancelBuild();
+        }
         AddMessage(RGY_LOG_ERROR, _T("error while reading file: %d frames, %s\n"), m_Demux.frames.frameNum(), qsv_av_err2str(ret_read_frame).c_str());
         m_Demux.format.inputError = RGY_ERR_INVALID_DATA_TYPE;
     }
@@ -3166,7 +3282,7 @@ const AVStream *RGYInputAvcodec::GetInputVideoStream() const {
     return m_Demux.video.stream;
 }
 
-double RGYInputAvcodec::GetInputVideoDuration() {
+double RGYInputAvcodec::GetInputVideoDuration() const {
     double duration = m_Demux.format.formatCtx->duration * (1.0 / (double)AV_TIME_BASE);
     if (m_seek.second > 0.0f) {
         duration = std::min<double>(duration, m_seek.second);
@@ -3177,6 +3293,37 @@ double RGYInputAvcodec::GetInputVideoDuration() {
     return duration;
 }
 
+std::vector<double> RGYInputAvcodec::GetVideoKeyframeTimes() const {
+    std::vector<double> keyframeTimes;
+    if (m_Demux.video.stream == nullptr) {
+        return keyframeTimes;
+    }
+    const auto timebase = av_q2d(m_Demux.video.stream->time_base);
+    const int entries = avformat_index_get_entries_count(m_Demux.video.stream);
+    int64_t firstTimestamp = AV_NOPTS_VALUE;
+    for (int i = 0; i < entries; i++) {
+        const AVIndexEntry *entry = avformat_index_get_entry(m_Demux.video.stream, i);
+        if (entry == nullptr || (entry->flags & AVINDEX_KEYFRAME) == 0 || entry->timestamp == AV_NOPTS_VALUE) {
+            continue;
+        }
+        if (firstTimestamp == AV_NOPTS_VALUE) {
+            firstTimestamp = entry->timestamp;
+        }
+        keyframeTimes.push_back((entry->timestamp - firstTimestamp) * timebase);
+    }
+    //インデックスファイルのほうが多くのキーフレームを持っていれば、そちらを使用する
+    if (m_Demux.video.inputIndex && m_Demux.video.inputIndex->loaded()) {
+        const auto keyframePts = m_Demux.video.inputIndex->keyframePts();
+        if (keyframePts.size() > keyframeTimes.size()) {
+            keyframeTimes.clear();
+            for (const auto pts : keyframePts) {
+                keyframeTimes.push_back((pts - keyframePts.front()) * timebase);
+            }
+        }
+    }
+    return keyframeTimes;
+}
+
 rgy_rational<int> RGYInputAvcodec::getInputTimebase() const {
     return to_rgy(GetInputVideoStream()->time_base);
 }
@@ -3539,13 +3686,23 @@ HANDLE RGYInputAvcodec::getThreadHandleInput() {
 
 RGY_ERR RGYInputAvcodec::ThreadFuncRead(RGYParamThread threadParam) {
     threadParam.apply(GetCurrentThread());
+    RGYSetCurrentThreadName(RGY_THREAD_NAME_INPUT);
     AddMessage(RGY_LOG_DEBUG, _T("Set input thread param: %s.\n"), threadParam.desc().c_str());
+    auto trace = m_Demux.thread.trace;
+    if (trace) {
+        trace->setThreadName(char_to_tstring(RGY_THREAD_NAME_INPUT));
+    }
     while (!m_Demux.thread.bAbortInput) {
+        const int64_t traceStart = (trace) ? trace->now() : 0;
         auto [ret, pkt] = getSample();
         if (ret) {
             break;
         }
         m_Demux.qVideoPkt.push(pkt.release());
+        if (trace) {
+            trace->add(m_Demux.thread.traceRead, traceStart, -1);
+            trace->counter(m_Demux.thread.traceQueue, (int64_t)m_Demux.qVideoPkt.size());
+        }
     }
     return RGY_ERR_NONE;
 }
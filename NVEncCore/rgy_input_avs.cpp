@@ -347,7 +347,7 @@ std::vector<AVPacket*> RGYInputAvs::GetStreamDataPackets(int inputFrame) {
 
     const int size = avs_bytes_per_channel_sample(m_sAVSinfo) * samples * m_sAVSinfo->nchannels;
     auto pkt = m_poolPkt->getFree();
-    if (av_new_packet(pkt.get(), size) < 0) {
+    if (m_poolPkt->newPacket(pkt.get(), size) < 0) {
         return pkts;
     }
     pkt->pts = m_audioCurrentSample;
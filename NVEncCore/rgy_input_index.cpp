@@ -0,0 +1,260 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include "rgy_input_index.h"
+#include "rgy_osdep.h"
+#include "rgy_avutil.h"
+#include "rgy_filesystem.h"
+
+static const uint32_t RGY_INPUT_INDEX_VERSION = 1;
+static const char RGY_INPUT_INDEX_MAGIC[8] = { 'R', 'G', 'Y', 'I', 'D', 'X', '\0', '\0' };
+static const TCHAR *RGY_INPUT_INDEX_EXT = _T(".rgyidx"); // インデックスファイルの拡張子
+static const int64_t RGY_INPUT_INDEX_HASH_SIZE = 1024 * 1024; // ハッシュを計算する先頭と末尾のサイズ
+
+// インデックスファイルのヘッダ
+struct RGYInputIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t packetSize;  // sizeof(RGYInputIndexPacket)
+    int64_t fileSize;
+    int64_t fileTime;
+    uint64_t fileHash;
+    int32_t streamIndex;
+    int32_t codecId;
+    int32_t timebaseNum;
+    int32_t timebaseDen;
+    int32_t fpsNum;       // 検出したフレームレート (不明な場合は0)
+    int32_t fpsDen;
+    uint64_t packetCount;
+};
+static_assert(sizeof(RGYInputIndexHeader) == 72, "unexpected padding in RGYInputIndexHeader.");
+static_assert(sizeof(RGYInputIndexPacket) == 32, "unexpected padding in RGYInputIndexPacket.");
+
+static int64_t packet_timestamp(const RGYInputIndexPacket& pkt) {
+    return (pkt.pts != AV_NOPTS_VALUE) ? pkt.pts : pkt.dts;
+}
+
+RGYInputIndex::RGYInputIndex() :
+    m_path(),
+    m_fileSize(0),
+    m_fileTime(0),
+    m_fileHash(0),
+    m_stream({ -1, 0, rgy_rational<int>() }),
+    m_framerate(0, 0),
+    m_packets(),
+    m_keyframes(),
+    m_loaded(false),
+    m_building(false),
+    m_complete(false) {
+}
+
+RGYInputIndex::~RGYInputIndex() {
+}
+
+RGY_ERR RGYInputIndex::init(const tstring& inputFilename, const tstring& indexDir) {
+    std::error_code ec;
+    const auto inputPath = std::filesystem::path(inputFilename);
+    m_fileSize = (int64_t)std::filesystem::file_size(inputPath, ec);
+    if (ec) {
+        return RGY_ERR_FILE_OPEN;
+    }
+    m_fileTime = (int64_t)std::filesystem::last_write_time(inputPath, ec).time_since_epoch().count();
+    if (ec) {
+        return RGY_ERR_FILE_OPEN;
+    }
+    FILE *fp = nullptr;
+    if (_tfopen_s(&fp, inputFilename.c_str(), _T("rb")) != 0 || fp == nullptr) {
+        return RGY_ERR_FILE_OPEN;
+    }
+    std::unique_ptr<FILE, fp_deleter> fpInput(fp);
+    // ファイル全体を読むと時間がかかるので、先頭と末尾のみからハッシュを計算する
+    std::vector<uint8_t> buffer((size_t)RGY_INPUT_INDEX_HASH_SIZE);
+    uint64_t hash = RGY_FNV1A_64_INIT;
+    const int64_t headSize = std::min(m_fileSize, RGY_INPUT_INDEX_HASH_SIZE);
+    if (fread(buffer.data(), 1, (size_t)headSize, fpInput.get()) != (size_t)headSize) {
+        return RGY_ERR_FILE_OPEN;
+    }
+    hash = hash_fnv1a(hash, buffer.data(), (size_t)headSize);
+    if (m_fileSize > RGY_INPUT_INDEX_HASH_SIZE) {
+        const int64_t tailOffset = std::max(m_fileSize - RGY_INPUT_INDEX_HASH_SIZE, RGY_INPUT_INDEX_HASH_SIZE);
+        const int64_t tailSize = m_fileSize - tailOffset;
+        if (_fseeki64(fpInput.get(), tailOffset, SEEK_SET) != 0
+            || fread(buffer.data(), 1, (size_t)tailSize, fpInput.get()) != (size_t)tailSize) {
+            return RGY_ERR_FILE_OPEN;
+        }
+        hash = hash_fnv1a(hash, buffer.data(), (size_t)tailSize);
+    }
+    m_fileHash = hash;
+
+    if (indexDir.length() == 0) {
+        m_path = inputFilename + RGY_INPUT_INDEX_EXT;
+    } else {
+        // 同名の別のファイルと衝突しないよう、ハッシュをファイル名に含める
+        m_path = PathCombineS(indexDir, PathGetFilename(inputFilename) + strsprintf(_T(".%016llx"), (unsigned long long)m_fileHash) + RGY_INPUT_INDEX_EXT);
+    }
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYInputIndex::load(const RGYInputIndexStream& stream) {
+    m_loaded = false;
+    FILE *fp = nullptr;
+    if (_tfopen_s(&fp, m_path.c_str(), _T("rb")) != 0 || fp == nullptr) {
+        return RGY_ERR_NOT_FOUND;
+    }
+    std::unique_ptr<FILE, fp_deleter> fpIndex(fp);
+    RGYInputIndexHeader header = { 0 };
+    if (fread(&header, sizeof(header), 1, fpIndex.get()) != 1
+        || memcmp(header.magic, RGY_INPUT_INDEX_MAGIC, sizeof(header.magic)) != 0
+        || header.version != RGY_INPUT_INDEX_VERSION
+        || header.packetSize != sizeof(RGYInputIndexPacket)) {
+        return RGY_ERR_INVALID_FORMAT;
+    }
+    // 入力ファイルが変更されている場合は使用しない
+    if (header.fileSize != m_fileSize
+        || header.fileTime != m_fileTime
+        || header.fileHash != m_fileHash
+        || header.streamIndex != stream.index
+        || header.codecId != stream.codecId
+        || header.timebaseNum != stream.timebase.n()
+        || header.timebaseDen != stream.timebase.d()) {
+        return RGY_ERR_NOT_FOUND;
+    }
+    std::error_code ec;
+    const auto indexSize = std::filesystem::file_size(std::filesystem::path(m_path), ec);
+    if (ec || header.packetCount == 0 || indexSize != sizeof(header) + header.packetCount * sizeof(RGYInputIndexPacket)) {
+        return RGY_ERR_INVALID_FORMAT;
+    }
+    std::vector<RGYInputIndexPacket> packets((size_t)header.packetCount);
+    if (fread(packets.data(), sizeof(RGYInputIndexPacket), packets.size(), fpIndex.get()) != packets.size()) {
+        return RGY_ERR_INVALID_FORMAT;
+    }
+    m_stream = stream;
+    m_framerate = rgy_rational<int>(header.fpsNum, header.fpsDen);
+    m_packets = std::move(packets);
+    m_keyframes.clear();
+    for (size_t i = 0; i < m_packets.size(); i++) {
+        if ((m_packets[i].flags & RGY_INPUT_INDEX_PKT_KEY) && packet_timestamp(m_packets[i]) != AV_NOPTS_VALUE) {
+            m_keyframes.push_back(i);
+        }
+    }
+    std::stable_sort(m_keyframes.begin(), m_keyframes.end(), [this](size_t a, size_t b) {
+        return packet_timestamp(m_packets[a]) < packet_timestamp(m_packets[b]);
+    });
+    m_loaded = true;
+    m_building = false;
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYInputIndex::save() {
+    if (!readyToSave()) {
+        return RGY_ERR_NOT_INITIALIZED;
+    }
+    const auto dir = PathRemoveFileSpecFixed(m_path).second;
+    if (dir.length() > 0 && !rgy_directory_exists(dir)) {
+        CreateDirectoryRecursive(dir.c_str());
+    }
+    RGYInputIndexHeader header = { 0 };
+    memcpy(header.magic, RGY_INPUT_INDEX_MAGIC, sizeof(header.magic));
+    header.version = RGY_INPUT_INDEX_VERSION;
+    header.packetSize = sizeof(RGYInputIndexPacket);
+    header.fileSize = m_fileSize;
+    header.fileTime = m_fileTime;
+    header.fileHash = m_fileHash;
+    header.streamIndex = m_stream.index;
+    header.codecId = m_stream.codecId;
+    header.timebaseNum = m_stream.timebase.n();
+    header.timebaseDen = m_stream.timebase.d();
+    if (m_framerate.n() > 0 && m_framerate.d() > 0) {
+        header.fpsNum = m_framerate.n();
+        header.fpsDen = m_framerate.d();
+    }
+    header.packetCount = m_packets.size();
+
+    // 同じファイルを同時に読み込んでいるプロセスが書きかけのファイルを読まないよう、一時ファイルに書いてから置き換える
+    const tstring tmpPath = m_path + strsprintf(_T(".%u.tmp"), GetCurrentProcessId());
+    {
+        FILE *fp = nullptr;
+        if (_tfopen_s(&fp, tmpPath.c_str(), _T("wb")) != 0 || fp == nullptr) {
+            return RGY_ERR_FILE_OPEN;
+        }
+        std::unique_ptr<FILE, fp_deleter> fpIndex(fp);
+        if (fwrite(&header, sizeof(header), 1, fpIndex.get()) != 1
+            || fwrite(m_packets.data(), sizeof(RGYInputIndexPacket), m_packets.size(), fpIndex.get()) != m_packets.size()) {
+            fpIndex.reset();
+            rgy_file_remove(tmpPath.c_str());
+            return RGY_ERR_UNDEFINED_BEHAVIOR;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(std::filesystem::path(tmpPath), std::filesystem::path(m_path), ec);
+    if (ec) {
+        rgy_file_remove(tmpPath.c_str());
+        return RGY_ERR_UNDEFINED_BEHAVIOR;
+    }
+    return RGY_ERR_NONE;
+}
+
+void RGYInputIndex::startBuild(const RGYInputIndexStream& stream) {
+    m_stream = stream;
+    m_packets.clear();
+    m_keyframes.clear();
+    m_loaded = false;
+    m_building = true;
+    m_complete = false;
+}
+
+void RGYInputIndex::cancelBuild() {
+    m_packets.clear();
+    m_building = false;
+    m_complete = false;
+}
+
+std::vector<int64_t> RGYInputIndex::keyframePts() const {
+    std::vector<int64_t> list;
+    list.reserve(m_keyframes.size());
+    for (const auto idx : m_keyframes) {
+        list.push_back(packet_timestamp(m_packets[idx]));
+    }
+    return list;
+}
+
+const RGYInputIndexPacket *RGYInputIndex::findKeyframe(int64_t pts) const {
+    if (m_keyframes.size() == 0) {
+        return nullptr;
+    }
+    // ptsより後の最初のキーフレームの1つ前が、pts以前の最後のキーフレーム
+    auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), pts, [this](int64_t value, size_t idx) {
+        return value < packet_timestamp(m_packets[idx]);
+    });
+    if (it != m_keyframes.begin()) {
+        it--;
+    }
+    return &m_packets[*it];
+}
@@ -0,0 +1,111 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_INPUT_INDEX_H__
+#define __RGY_INPUT_INDEX_H__
+
+// FFmpegに依存しない (タイムスタンプの無効値のAV_NOPTS_VALUEのみrgy_avutil.hから使用する)
+#include <cstdint>
+#include <vector>
+#include "rgy_tchar.h"
+#include "rgy_util.h"
+#include "rgy_err.h"
+
+static const int32_t RGY_INPUT_INDEX_PKT_KEY = 0x01; // キーフレーム
+
+// インデックスファイルに格納する動画のパケットの情報
+struct RGYInputIndexPacket {
+    int64_t pts;
+    int64_t dts;
+    int64_t pos;    // ファイル上の位置 (不明な場合は-1)
+    int32_t size;
+    int32_t flags;  // RGY_INPUT_INDEX_PKT_xxx
+};
+
+// インデックスファイルの対象とする動画ストリームの情報
+struct RGYInputIndexStream {
+    int index;                  // ストリームのインデックス
+    int codecId;                // AVCodecID
+    rgy_rational<int> timebase; // ストリームのtimebase
+};
+
+// 入力ファイルの動画のパケットの位置・タイムスタンプ・キーフレームと、検出したフレームレートを
+// インデックスファイルに保存し、同じファイルを再度読み込む際の解析やシークを省略するためのクラス
+// インデックスファイルは、入力ファイルのサイズ・更新時刻・先頭と末尾のハッシュで照合する
+class RGYInputIndex {
+public:
+    RGYInputIndex();
+    ~RGYInputIndex();
+
+    // 入力ファイルの照合用の情報を取得し、インデックスファイルのパスを決める
+    // indexDirが空なら入力ファイルと同じ場所に、そうでなければindexDirに保存する
+    RGY_ERR init(const tstring& inputFilename, const tstring& indexDir);
+    // インデックスファイルを読み込む (入力ファイルやストリームと一致しなければRGY_ERR_NOT_FOUND)
+    RGY_ERR load(const RGYInputIndexStream& stream);
+    // 読み込んだパケットの情報をインデックスファイルに書き出す
+    RGY_ERR save();
+
+    // インデックスファイルの作成を開始する (先頭から読み込む場合のみ)
+    void startBuild(const RGYInputIndexStream& stream);
+    // 読み込みエラーや途中での終了などで、先頭から終端まで連続して読み込めなくなったときに作成を中止する
+    void cancelBuild();
+    void addPacket(const RGYInputIndexPacket& pkt) { if (m_building) m_packets.push_back(pkt); }
+    // 終端まで読み込んだ
+    void setComplete() { m_complete = m_building; }
+
+    const tstring& path() const { return m_path; }
+    bool loaded() const { return m_loaded; }
+    bool building() const { return m_building; }
+    // 保存すべき情報がそろっているか
+    bool readyToSave() const { return m_building && m_complete && m_packets.size() > 0; }
+
+    // 検出したフレームレート (不明な場合は無効な値)
+    rgy_rational<int> framerate() const { return m_framerate; }
+    void setFramerate(const rgy_rational<int>& fps) { m_framerate = fps; }
+
+    const std::vector<RGYInputIndexPacket>& packets() const { return m_packets; }
+    // キーフレームのptsの一覧 (pts順)
+    std::vector<int64_t> keyframePts() const;
+    // 指定したpts以前の最後のキーフレームを返す (なければ最初のキーフレーム)
+    // シーク先のフレームを含むGOPの先頭を求めるのに使う
+    const RGYInputIndexPacket *findKeyframe(int64_t pts) const;
+protected:
+    tstring m_path;             // インデックスファイルのパス
+    int64_t m_fileSize;         // 入力ファイルのサイズ
+    int64_t m_fileTime;         // 入力ファイルの更新時刻
+    uint64_t m_fileHash;        // 入力ファイルの先頭と末尾のハッシュ
+    RGYInputIndexStream m_stream;
+    rgy_rational<int> m_framerate;
+    std::vector<RGYInputIndexPacket> m_packets;
+    std::vector<size_t> m_keyframes; // m_packetsのうちキーフレームのインデックス (pts順)
+    bool m_loaded;
+    bool m_building;
+    bool m_complete;
+};
+
+#endif //__RGY_INPUT_INDEX_H__
@@ -31,6 +31,9 @@
 
 #if ENABLE_RAW_READER
 
+static const int RAW_MMAP_WINDOW_FRAMES = 4;                //メモリマップで一度にマップするフレーム数
+static const uint64_t RAW_MMAP_WINDOW_MIN = 64 * 1024 * 1024; //メモリマップで一度にマップする最小サイズ
+
 RGY_ERR RGYInputRaw::ParseY4MHeader(char *buf, VideoInfo *pInfo) {
     //どういうわけかCを指定しないy4mファイルが世の中にはあるようなので、
     //とりあえずデフォルトはYV12にしておく
@@ -116,7 +119,13 @@ RGYInputRaw::RGYInputRaw() :
     m_fSource(NULL),
     m_nBufSize(0),
     m_pBuffer(),
-    m_isPipe(false) {
+    m_pBufferNext(),
+    m_prefetched(false),
+    m_prefetchSts(RGY_ERR_NONE),
+    m_isPipe(false),
+    m_mappedFile(),
+    m_mappedPos(0),
+    m_readMargin(0) {
     m_readerName = _T("raw");
 }
 
@@ -129,7 +138,13 @@ void RGYInputRaw::Close() {
         fclose(m_fSource);
         m_fSource = NULL;
     }
+    m_mappedFile.reset();
+    m_mappedPos = 0;
+    m_readMargin = 0;
     m_pBuffer.reset();
+    m_pBufferNext.reset();
+    m_prefetched = false;
+    m_prefetchSts = RGY_ERR_NONE;
     m_nBufSize = 0;
     RGYInput::Close();
 }
@@ -247,7 +262,8 @@ RGY_ERR RGYInputRaw::Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const
         return RGY_ERR_INVALID_COLOR_FORMAT;
     }
     // 幅が割り切れない場合に備え、変換時にAVX2等で読みすぎて異常終了しないようにあらかじめ多めに確保する
-    bufferSize += (ALIGN(m_inputVideoInfo.srcWidth, 128) - m_inputVideoInfo.srcWidth) * bytesPerPix(m_inputCsp);
+    m_readMargin = (ALIGN(m_inputVideoInfo.srcWidth, 128) - m_inputVideoInfo.srcWidth) * bytesPerPix(m_inputCsp);
+    bufferSize += m_readMargin;
     AddMessage(RGY_LOG_DEBUG, _T("%dx%d, pitch:%d, bufferSize:%d.\n"), m_inputVideoInfo.srcWidth, m_inputVideoInfo.srcHeight, m_inputVideoInfo.srcPitch, bufferSize);
 
     if (nOutputCSP != RGY_CSP_NA) {
@@ -264,8 +280,27 @@ RGY_ERR RGYInputRaw::Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const
     if (cspShiftUsed(m_inputVideoInfo.csp) && RGY_CSP_BIT_DEPTH[m_inputVideoInfo.csp] > RGY_CSP_BIT_DEPTH[m_inputCsp]) {
         m_inputVideoInfo.bitdepth = RGY_CSP_BIT_DEPTH[m_inputCsp];
     }
+    if (!m_isPipe && sizeof(void *) >= 8) {
+        //シーク可能なファイルはメモリマップで読み込み、読み込みバッファへのコピーを省略する
+        //32bitではアドレス空間が足りなくなる可能性があるので、freadを使う
+        auto mappedFile = std::make_unique<RGYMappedFile>();
+        const auto windowSize = std::max<uint64_t>((uint64_t)bufferSize * RAW_MMAP_WINDOW_FRAMES, RAW_MMAP_WINDOW_MIN);
+        const auto err = mappedFile->open(strFileName, windowSize);
+        if (err == RGY_ERR_NONE) {
+            m_mappedFile = std::move(mappedFile);
+            m_mappedPos = (uint64_t)_ftelli64(m_fSource);
+            AddMessage(RGY_LOG_DEBUG, _T("use memory mapped read: file size %lld, window %lld.\n"), (long long)m_mappedFile->size(), (long long)windowSize);
+        } else {
+            AddMessage(RGY_LOG_DEBUG, _T("memory mapped read not available (%s), use fread.\n"), get_err_mes(err));
+        }
+    }
+    //メモリマップ使用時も、ファイル末尾のフレームは読みすぎを防ぐためバッファにコピーする
     m_pBuffer = std::shared_ptr<uint8_t>((uint8_t *)_aligned_malloc(bufferSize, 32), aligned_malloc_deleter());
-    if (!m_pBuffer) {
+    if (!m_mappedFile) {
+        //色変換中に次のフレームを読み込んでおくためのバッファ
+        m_pBufferNext = std::shared_ptr<uint8_t>((uint8_t *)_aligned_malloc(bufferSize, 32), aligned_malloc_deleter());
+    }
+    if (!m_pBuffer || (!m_mappedFile && !m_pBufferNext)) {
         AddMessage(RGY_LOG_ERROR, _T("Failed to allocate input buffer.\n"));
         return RGY_ERR_NULL_PTR;
     }
@@ -282,15 +317,7 @@ RGY_ERR RGYInputRaw::Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const
     return RGY_ERR_NONE;
 }
 
-RGY_ERR RGYInputRaw::LoadNextFrameInternal(RGYFrame *pSurface) {
-    if ((m_inputVideoInfo.frames > 0
-          &&(int)m_encSatusInfo->m_sData.frameIn >= m_inputVideoInfo.frames)
-        //m_encSatusInfo->m_nInputFramesがtrimの結果必要なフレーム数を大きく超えたら、エンコードを打ち切る
-        //ちょうどのところで打ち切ると他のストリームに影響があるかもしれないので、余分に取得しておく
-        || getVideoTrimMaxFramIdx() < (int)m_encSatusInfo->m_sData.frameIn - TRIM_OVERREAD_FRAMES) {
-        return RGY_ERR_MORE_DATA;
-    }
-
+RGY_ERR RGYInputRaw::ReadFrameData(uint8_t *buffer, uint32_t frameSize) {
     if (m_inputVideoInfo.type == RGY_INPUT_FMT_Y4M) {
         uint8_t y4m_buf[8] = { 0 };
         if (_fread_nolock(y4m_buf, 1, strlen("FRAME"), m_fSource) != strlen("FRAME")) {
@@ -310,6 +337,69 @@ RGY_ERR RGYInputRaw::LoadNextFrameInternal(RGYFrame *pSurface) {
         }
     }
 
+    if (frameSize != _fread_nolock(buffer, 1, frameSize, m_fSource)) {
+        AddMessage(RGY_LOG_DEBUG, _T("fread: finish: %d.\n"), frameSize);
+        return RGY_ERR_MORE_DATA;
+    }
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYInputRaw::MapFrameData(const uint8_t **data, uint32_t frameSize) {
+    const uint64_t fileSize = m_mappedFile->size();
+    if (m_inputVideoInfo.type == RGY_INPUT_FMT_Y4M) {
+        const size_t headerLen = strlen("FRAME");
+        const size_t headerMax = (size_t)std::min<uint64_t>(headerLen + 64 + 1, fileSize - std::min(m_mappedPos, fileSize));
+        const char *header = (headerMax >= headerLen) ? (const char *)m_mappedFile->map(m_mappedPos, headerMax) : nullptr;
+        if (header == nullptr || memcmp(header, "FRAME", headerLen) != 0) {
+            AddMessage(RGY_LOG_DEBUG, _T("header1: finish.\n"));
+            return RGY_ERR_MORE_DATA;
+        }
+        size_t i = headerLen;
+        for (; header[i] != '\n'; i++) {
+            if (i + 1 >= headerMax || i - headerLen >= 64) {
+                AddMessage(RGY_LOG_DEBUG, _T("header3: finish.\n"));
+                return RGY_ERR_MORE_DATA;
+            }
+        }
+        m_mappedPos += i + 1;
+    }
+    if (m_mappedPos + frameSize > fileSize) {
+        AddMessage(RGY_LOG_DEBUG, _T("mmap: finish: %d.\n"), frameSize);
+        return RGY_ERR_MORE_DATA;
+    }
+    if (m_mappedPos + frameSize + m_readMargin <= fileSize) {
+        //マップした領域を直接色変換に渡す
+        *data = m_mappedFile->map(m_mappedPos, frameSize + m_readMargin);
+    } else {
+        //ファイル末尾では、色変換時にファイルの外を読まないようにバッファにコピーする
+        const uint8_t *ptr = m_mappedFile->map(m_mappedPos, frameSize);
+        if (ptr != nullptr) {
+            memcpy(m_pBuffer.get(), ptr, frameSize);
+        }
+        *data = (ptr != nullptr) ? m_pBuffer.get() : nullptr;
+    }
+    if (*data == nullptr) {
+        AddMessage(RGY_LOG_ERROR, _T("Failed to map input file at %lld.\n"), (long long)m_mappedPos);
+        return RGY_ERR_NULL_PTR;
+    }
+    m_mappedPos += frameSize;
+    return RGY_ERR_NONE;
+}
+
+bool RGYInputRaw::frameRequired(int frameIdx) {
+    if (m_inputVideoInfo.frames > 0 && frameIdx >= m_inputVideoInfo.frames) {
+        return false;
+    }
+    //m_encSatusInfo->m_nInputFramesがtrimの結果必要なフレーム数を大きく超えたら、エンコードを打ち切る
+    //ちょうどのところで打ち切ると他のストリームに影響があるかもしれないので、余分に取得しておく
+    return getVideoTrimMaxFramIdx() >= frameIdx - TRIM_OVERREAD_FRAMES;
+}
+
+RGY_ERR RGYInputRaw::LoadNextFrameInternal(RGYFrame *pSurface) {
+    if (!frameRequired((int)m_encSatusInfo->m_sData.frameIn)) {
+        return RGY_ERR_MORE_DATA;
+    }
+
     uint32_t frameSize = 0;
     switch (m_convert->getFunc()->csp_from) {
     case RGY_CSP_NV12:
@@ -346,16 +436,32 @@ RGY_ERR RGYInputRaw::LoadNextFrameInternal(RGYFrame *pSurface) {
     if (rgy_csp_has_alpha(m_convert->getFunc()->csp_from)) {
         frameSize += m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight;
     }
-    if (frameSize != _fread_nolock(m_pBuffer.get(), 1, frameSize, m_fSource)) {
-        AddMessage(RGY_LOG_DEBUG, _T("fread: finish: %d.\n"), frameSize);
-        return RGY_ERR_MORE_DATA;
+    const uint8_t *frameData = m_pBuffer.get();
+    if (m_mappedFile) {
+        auto sts = MapFrameData(&frameData, frameSize);
+        if (sts != RGY_ERR_NONE) {
+            return sts;
+        }
+    } else if (!m_prefetched) {
+        auto sts = ReadFrameData(m_pBuffer.get(), frameSize);
+        if (sts != RGY_ERR_NONE) {
+            return sts;
+        }
+    } else {
+        //前回の色変換中に読み込んでおいたデータを使う
+        m_prefetched = false;
+        if (m_prefetchSts != RGY_ERR_NONE) {
+            return m_prefetchSts;
+        }
+        std::swap(m_pBuffer, m_pBufferNext);
+        frameData = m_pBuffer.get();
     }
 
     void *dst_array[RGY_MAX_PLANES];
     pSurface->ptrArray(dst_array);
 
     const void *src_array[RGY_MAX_PLANES];
-    src_array[0] = m_pBuffer.get();
+    src_array[0] = frameData;
     src_array[1] = (uint8_t *)src_array[0] + m_inputVideoInfo.srcPitch * m_inputVideoInfo.srcHeight;
     switch (m_convert->getFunc()->csp_from) {
     case RGY_CSP_YV12:
@@ -404,9 +510,28 @@ RGY_ERR RGYInputRaw::LoadNextFrameInternal(RGYFrame *pSurface) {
         src_uv_pitch >>= 1;
         break;
     }
-    m_convert->run((m_inputVideoInfo.picstruct & RGY_PICSTRUCT_INTERLACED) ? 1 : 0,
+    m_convert->runAsync((m_inputVideoInfo.picstruct & RGY_PICSTRUCT_INTERLACED) ? 1 : 0,
         dst_array, src_array, m_inputVideoInfo.srcWidth, m_inputVideoInfo.srcPitch,
         src_uv_pitch, pSurface->pitch(), pSurface->pitch(RGY_PLANE_C), m_inputVideoInfo.srcHeight, m_inputVideoInfo.srcHeight, m_inputVideoInfo.crop.c);
+    //次のフレームが要求されない場合(--frames/trimの上限)は先読みしない
+    //パイプから余分に読み込んでしまったり、読み込めなかった場合のエラーを返したりしないようにする
+    const bool prefetchNext = frameRequired((int)m_encSatusInfo->m_sData.frameIn + 1);
+    if (m_mappedFile) {
+        if (prefetchNext) {
+            //色変換をしている間に、次のフレームの先読みを指示しておく
+            m_mappedFile->prefetch(m_mappedPos, frameSize + 128);
+        }
+        m_convert->wait();
+        //変換の終わったフレームは常駐メモリから解放し、使用量を抑える
+        m_mappedFile->release(m_mappedPos - frameSize, frameSize);
+    } else if (prefetchNext) {
+        //色変換をしている間に、次のフレームを読み込んでおく
+        m_prefetchSts = ReadFrameData(m_pBufferNext.get(), frameSize);
+        m_prefetched = true;
+        m_convert->wait();
+    } else {
+        m_convert->wait();
+    }
 
     m_encSatusInfo->m_sData.frameIn++;
     return m_encSatusInfo->UpdateDisplay();
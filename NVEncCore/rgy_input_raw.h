@@ -30,6 +30,7 @@
 #define __RGY_INPUT_RAW_H__
 
 #include "rgy_input.h"
+#include "rgy_mapped_file.h"
 
 #if ENABLE_RAW_READER
 
@@ -58,12 +59,21 @@ protected:
     virtual RGY_ERR Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const RGYInputPrm *prm) override;
     virtual RGY_ERR LoadNextFrameInternal(RGYFrame *pSurface) override;
     RGY_ERR ParseY4MHeader(char *buf, VideoInfo *pInfo);
+    RGY_ERR ReadFrameData(uint8_t *buffer, uint32_t frameSize);
+    RGY_ERR MapFrameData(const uint8_t **data, uint32_t frameSize);
+    bool frameRequired(int frameIdx); //frameIdx番目のフレームを読み込む必要があるか
 
     FILE *m_fSource;
 
     uint32_t m_nBufSize;
     shared_ptr<uint8_t> m_pBuffer;
+    shared_ptr<uint8_t> m_pBufferNext; //色変換中に次のフレームを読み込むバッファ
+    bool m_prefetched;                 //m_pBufferNextに次のフレームの読み込みを行った
+    RGY_ERR m_prefetchSts;             //次のフレームの読み込み結果
     bool m_isPipe;
+    std::unique_ptr<RGYMappedFile> m_mappedFile; //ファイル入力時にメモリマップで読み込む場合に使用
+    uint64_t m_mappedPos;              //m_mappedFileで次に読み込む位置
+    uint32_t m_readMargin;             //色変換時にフレームの末尾から読みすぎる可能性のあるサイズ
 };
 
 #endif //ENABLE_RAW_READER
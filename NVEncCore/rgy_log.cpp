@@ -30,6 +30,7 @@
 #include <mutex>
 #include <chrono>
 #include "rgy_log.h"
+#include "rgy_log_async.h"
 #include "rgy_version.h"
 #include "rgy_util.h"
 #include "rgy_def.h"
@@ -243,29 +244,47 @@ tstring RGYParamLogLevel::to_string() const {
     return tmp.str();
 }
 
-RGYLog::RGYLog(const TCHAR *pLogFile, const RGYLogLevel log_level, bool showTime, bool addLogLevel, bool disableColor) :
+RGYLog::RGYLog(const TCHAR *pLogFile, const RGYLogLevel log_level, bool showTime, bool addLogLevel, bool disableColor, bool async) :
     m_nLogLevel(),
     m_pStrLog(),
     m_bHtml(false),
     m_showTime(showTime),
     m_addLogLevel(addLogLevel),
     m_disableColor(disableColor),
-    m_mtx() {
+    m_mtx(),
+    m_async() {
     init(pLogFile, RGYParamLogLevel(log_level));
+    if (async) {
+        m_async = std::make_unique<RGYLogAsync>(this);
+        m_async->start();
+    }
 };
 
-RGYLog::RGYLog(const TCHAR *pLogFile, const RGYParamLogLevel& log_level, bool showTime, bool addLogLevel, bool disableColor) :
+RGYLog::RGYLog(const TCHAR *pLogFile, const RGYParamLogLevel& log_level, bool showTime, bool addLogLevel, bool disableColor, bool async) :
     m_nLogLevel(),
     m_pStrLog(),
     m_bHtml(false),
     m_showTime(showTime),
     m_addLogLevel(addLogLevel),
     m_disableColor(disableColor),
-    m_mtx() {
+    m_mtx(),
+    m_async() {
     init(pLogFile, log_level);
+    if (async) {
+        m_async = std::make_unique<RGYLogAsync>(this);
+        m_async->start();
+    }
 }
 
 RGYLog::~RGYLog() {
+    //書き出しスレッドに残っているログを出力してから終了する
+    m_async.reset();
+}
+
+void RGYLog::flush() {
+    if (m_async) {
+        m_async->flush();
+    }
 }
 
 void RGYLog::init(const TCHAR *pLogFile, const RGYParamLogLevel& log_level) {
@@ -388,8 +407,51 @@ void RGYLog::write_log(RGYLogLevel log_level, const RGYLogType logtype, const TC
     if (log_level < m_nLogLevel.get(logtype)) {
         return;
     }
+    //時刻は出力を要求した時点のものを使う
+    const int64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (m_async && m_async->push(log_level, buffer, file_only, time_us)) {
+        if (log_level >= RGY_LOG_ERROR) {
+            //エラーの直後に終了することがあるので、エラーは出力を待つ
+            m_async->flush();
+        }
+        return;
+    }
+    RGYLogRecord record;
+    record.level = log_level;
+    record.file_only = file_only;
+    record.time_us = time_us;
+    record.mes = buffer;
+    const RGYLogRecord *ptr = &record;
+    writeRecords(&ptr, 1);
+}
 
-    auto convert_to_html = [log_level](std::string str) {
+tstring RGYLog::addTime(const tstring& str, int64_t time_us, bool file_only) const {
+    const auto ms = time_us / 1000;
+    const time_t sec1 = (time_t)(ms / 1000);
+    const auto timeinfo = localtime(&sec1);
+    TCHAR buf[64] = { 0 };
+    _tcsftime(buf, _countof(buf), _T("[%Y-%m-%d %H:%M:%S"), timeinfo);
+    tstring strWithTime = buf + strsprintf(_T(".%03d] "), (int)(ms - (sec1 * 1000)));
+    if (file_only) {
+        // file_only の場合は分解するとおかしな出力になることがあるので途中の改行については無視して出力する
+        return strWithTime + str;
+    } else {
+        const auto timeLength = strWithTime.length();
+
+        auto strLines = split(str, _T("\n"));
+        strWithTime.reserve(str.length() + strLines.size() * timeLength);
+
+        strWithTime += strLines[0] + _T("\n");
+        const auto blank = tstring(timeLength, _T(' '));
+        for (uint32_t i = 1; i < strLines.size() - 1; i++) {
+            strWithTime += blank + strLines[i] + _T("\n");
+        }
+    }
+    return strWithTime;
+}
+
+void RGYLog::writeRecords(const RGYLogRecord *const *records, size_t count) {
+    auto convert_to_html = [](std::string str, RGYLogLevel log_level) {
         //str = str_replace(str, "<", "&lt;");
         //str = str_replace(str, ">", "&gt;");
         //str = str_replace(str, "&", "&amp;");
@@ -405,68 +467,42 @@ void RGYLog::write_log(RGYLogLevel log_level, const RGYLogType logtype, const TC
         }
         return strHtml;
     };
-    auto add_time = [file_only](tstring str) {
-        const auto tp = std::chrono::system_clock::now();
-        const auto duration = tp.time_since_epoch();
-        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
-        const auto sec1 = ms / 1000;
-        const auto timeinfo = localtime(&sec1);
-        TCHAR buf[64] = { 0 };
-        _tcsftime(buf, _countof(buf), _T("[%Y-%m-%d %H:%M:%S"), timeinfo);
-        tstring strWithTime = buf + strsprintf(_T(".%03d] "), ms - (sec1 * 1000));
-        if (file_only) {
-            // file_only の場合は分解するとおかしな出力になることがあるので途中の改行については無視して出力する
-            return strWithTime + str;
-        } else {
-            const auto timeLength = strWithTime.length();
-
-            auto strLines = split(str, _T("\n"));
-            strWithTime.reserve(str.length() + strLines.size() * timeLength);
-
-            strWithTime += strLines[0] + _T("\n");
-            const auto blank = tstring(timeLength, _T(' '));
-            for (uint32_t i = 1; i < strLines.size() - 1; i++) {
-                strWithTime += blank + strLines[i] + _T("\n");
-            }
-        }
-        return strWithTime;
-    };
 
 #if defined(_WIN32) || defined(_WIN64)
     HANDLE hStdErr = GetStdHandle(STD_ERROR_HANDLE);
 #else
     HANDLE hStdErr = NULL;
 #endif //defined(_WIN32) || defined(_WIN64)
-
-    tstring bufWithTime;
-    if (m_showTime) {
-        bufWithTime = add_time(buffer);
-        buffer = bufWithTime.c_str();
-    }
-    std::string buffer_char;
 #ifdef UNICODE
-    char *buffer_ptr = NULL;
     DWORD mode = 0;
-    bool stderr_write_to_console = 0 != GetConsoleMode(hStdErr, &mode); //stderrの出力先がコンソールかどうか
-    if (m_pStrLog.length() > 0 || !stderr_write_to_console) {
-        buffer_char = tchar_to_string(buffer, (m_bHtml) ? CP_UTF8 : CP_THREAD_ACP);
-        if (m_bHtml) {
-            buffer_char = convert_to_html(buffer_char);
-        }
-        buffer_ptr = &buffer_char[0];
+    const bool stderr_write_to_console = 0 != GetConsoleMode(hStdErr, &mode); //stderrの出力先がコンソールかどうか
+#endif
+
+    //時刻を付加したログ
+    std::vector<tstring> bufWithTime(m_showTime ? count : 0);
+    for (size_t i = 0; i < bufWithTime.size(); i++) {
+        bufWithTime[i] = addTime(records[i]->mes, records[i]->time_us, records[i]->file_only);
     }
+    auto get_buffer = [&](size_t i) {
+        return (m_showTime) ? bufWithTime[i].c_str() : records[i]->mes.c_str();
+    };
+
+    //ファイルに書き込む内容をまとめる
+    std::string fileBuffer;
+    if (m_pStrLog.length() > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const TCHAR *buffer = get_buffer(i);
+#ifdef UNICODE
+            auto buffer_char = tchar_to_string(buffer, (m_bHtml) ? CP_UTF8 : CP_THREAD_ACP);
 #else
-    const char *buffer_ptr = &buffer[0];
-    if (m_bHtml) {
-        buffer_char = wstring_to_string(char_to_wstring(buffer_ptr), CP_UTF8);
-        if (m_bHtml) {
-            buffer_char = convert_to_html(buffer_char);
+            std::string buffer_char = (m_bHtml) ? wstring_to_string(char_to_wstring(buffer), CP_UTF8) : std::string(buffer);
+#endif
+            fileBuffer += (m_bHtml) ? convert_to_html(buffer_char, records[i]->level) : buffer_char;
         }
-        buffer_ptr = &buffer_char[0];
     }
-#endif
+
     std::lock_guard<std::mutex> lock(*m_mtx.get());
-    if (m_pStrLog.length() > 0) {
+    if (fileBuffer.length() > 0) {
         FILE *fp_log = NULL;
         //logはANSI(まあようはShift-JIS)で保存する
         if (0 == _tfopen_s(&fp_log, m_pStrLog.c_str(), (m_bHtml) ? _T("rb+") : _T("a")) && fp_log) {
@@ -476,24 +512,28 @@ void RGYLog::write_log(RGYLogLevel log_level, const RGYLogType logtype, const TC
                 _fseeki64(fp_log, 0, SEEK_SET);
                 _fseeki64(fp_log, pos -1 * strlen(HTML_FOOTER), SEEK_CUR);
             }
-            fwrite(buffer_ptr, 1, strlen(buffer_ptr), fp_log);
+            fwrite(fileBuffer.data(), 1, fileBuffer.length(), fp_log);
             if (m_bHtml) {
                 fwrite(HTML_FOOTER, 1, strlen(HTML_FOOTER), fp_log);
             }
             fclose(fp_log);
         }
     }
-    if (!file_only) {
+    for (size_t i = 0; i < count; i++) {
+        if (records[i]->file_only) {
+            continue;
+        }
+        const auto log_level = records[i]->level;
+        const TCHAR *buffer = get_buffer(i);
         if (m_addLogLevel) {
             auto strLines = split(buffer, _T("\n"));
-            for (size_t i = 0; i < strLines.size(); i++) {
-                const bool lastLine = i == strLines.size() - 1;
-                if (lastLine && strLines[i].length() == 0) break;
-                auto line = tstring(rgy_log_level_to_str(log_level)) + _T(":") + strLines[i] + _T("\n");
+            for (size_t j = 0; j < strLines.size(); j++) {
+                const bool lastLine = j == strLines.size() - 1;
+                if (lastLine && strLines[j].length() == 0) break;
+                auto line = tstring(rgy_log_level_to_str(log_level)) + _T(":") + strLines[j] + _T("\n");
 #ifdef UNICODE
                 if (!stderr_write_to_console) { //出力先がリダイレクトされるならANSIで
-                    buffer_char = wstring_to_string(tchar_to_wstring(line), CP_UTF8);
-                    fprintf(stderr, buffer_ptr);
+                    fprintf(stderr, "%s", wstring_to_string(tchar_to_wstring(line), CP_UTF8).c_str());
                 }
                 if (stderr_write_to_console) //出力先がコンソールならWCHARで
 #endif
@@ -502,7 +542,7 @@ void RGYLog::write_log(RGYLogLevel log_level, const RGYLogType logtype, const TC
         } else {
 #ifdef UNICODE
             if (!stderr_write_to_console) //出力先がリダイレクトされるならANSIで
-                fprintf(stderr, buffer_ptr);
+                fprintf(stderr, "%s", tchar_to_string(buffer, CP_THREAD_ACP).c_str());
             if (stderr_write_to_console) //出力先がコンソールならWCHARで
 #endif
                 rgy_print_stderr(log_level, buffer, hStdErr, m_disableColor);
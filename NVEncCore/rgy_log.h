@@ -159,6 +159,16 @@ public:
 
 int rgy_print_stderr(int log_level, const TCHAR *mes, void *handle = NULL, bool disableColor = false);
 
+// 出力待ちのログ (非同期出力用)
+struct RGYLogRecord {
+    RGYLogLevel level;
+    bool file_only;
+    int64_t time_us; // 出力を要求した時刻 (system_clock, us)
+    tstring mes;
+};
+
+class RGYLogAsync;
+
 class RGYLog {
 protected:
     RGYParamLogLevel m_nLogLevel;
@@ -168,10 +178,16 @@ protected:
     bool m_addLogLevel;
     bool m_disableColor;
     std::shared_ptr<std::mutex> m_mtx;
+    std::unique_ptr<RGYLogAsync> m_async; // 非同期出力 (無効ならnullptr)
     static const char *HTML_FOOTER;
+
+    friend class RGYLogAsync;
+    tstring addTime(const tstring& str, int64_t time_us, bool file_only) const;
+    // ログをファイル/コンソールに出力する (ファイルはまとめて1回で書き込む)
+    void writeRecords(const RGYLogRecord *const *records, size_t count);
 public:
-    RGYLog(const TCHAR *pLogFile, const RGYLogLevel log_level = RGY_LOG_INFO, bool showTime = false, bool addLogLevel = false, bool disableColor = false);
-    RGYLog(const TCHAR *pLogFile, const RGYParamLogLevel& log_level, bool showTime = false, bool addLogLevel = false, bool disableColor = false);
+    RGYLog(const TCHAR *pLogFile, const RGYLogLevel log_level = RGY_LOG_INFO, bool showTime = false, bool addLogLevel = false, bool disableColor = false, bool async = false);
+    RGYLog(const TCHAR *pLogFile, const RGYParamLogLevel& log_level, bool showTime = false, bool addLogLevel = false, bool disableColor = false, bool async = false);
     virtual ~RGYLog();
     void init(const TCHAR *pLogFile, const RGYParamLogLevel& log_level);
     void writeHtmlHeader();
@@ -195,9 +211,12 @@ public:
         return m_pStrLog.length() > 0;
     }
     void setLogFile(const TCHAR *pLogFile) {
+        flush();
         m_pStrLog.clear();
         if (pLogFile) m_pStrLog = pLogFile;
     }
+    // 非同期出力時に、呼び出し時点までのログの出力を待つ
+    void flush();
     void setLock(std::shared_ptr<std::mutex> mtx) { m_mtx = mtx; }
     std::shared_ptr<std::mutex> getLock() { return m_mtx; }
     virtual void write_log(RGYLogLevel log_level, const RGYLogType logtype, const TCHAR *buffer, bool file_only = false);
@@ -0,0 +1,304 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include <array>
+#include <chrono>
+#include <algorithm>
+#include "rgy_log_async.h"
+#include "rgy_util.h"
+#include "rgy_thread_affinity.h"
+
+static_assert((RGY_LOG_ASYNC_RING_SIZE & (RGY_LOG_ASYNC_RING_SIZE - 1)) == 0, "RGY_LOG_ASYNC_RING_SIZE must be power of 2.");
+
+static std::atomic<uint64_t> g_logAsyncId(0);
+
+// スレッドごとに、直近に使用したリングバッファを保持しておく
+// 通常は1スレッドから出力するRGYLogはわずかなので、数個分あれば十分
+struct RGYLogAsyncRingCache {
+    uint64_t id;
+    void *ring;
+};
+static const int RGY_LOG_ASYNC_RING_CACHE = 4;
+static thread_local std::array<RGYLogAsyncRingCache, RGY_LOG_ASYNC_RING_CACHE> t_ringCache = { 0 };
+static thread_local int t_ringCacheNext = 0;
+static thread_local bool t_ringExited = false;
+
+// スレッドの終了時に、そのスレッドのリングバッファを解放してよいことを書き出しスレッドに知らせる
+// (スレッドを作っては終了させる使い方でも、リングバッファが増え続けないようにする)
+struct RGYLogAsyncThreadExit {
+    std::vector<std::weak_ptr<std::atomic<bool>>> exited;
+    ~RGYLogAsyncThreadExit() {
+        //これ以降に破棄されるthread_localの変数からのログは、同期出力にまかせる
+        t_ringExited = true;
+        for (auto& cache : t_ringCache) {
+            cache.id = 0;
+            cache.ring = nullptr;
+        }
+        for (auto& e : exited) {
+            if (auto flag = e.lock()) {
+                flag->store(true, std::memory_order_release);
+            }
+        }
+    }
+};
+static thread_local RGYLogAsyncThreadExit t_ringExit;
+
+RGYLogAsync::Ring::Ring(std::thread::id id) :
+    owner(id),
+    slots(std::make_unique<RGYLogRecord[]>(RGY_LOG_ASYNC_RING_SIZE)),
+    head(0),
+    tail(0),
+    pushing(false),
+    dropped(0),
+    exited(false) {
+}
+
+RGYLogAsync::RGYLogAsync(RGYLog *log) :
+    m_log(log),
+    m_id(++g_logAsyncId),
+    m_ringsMtx(),
+    m_rings(),
+    m_drainRings(),
+    m_batch(),
+    m_thread(),
+    m_running(false),
+    m_mtx(),
+    m_cvWake(),
+    m_cvFlushed(),
+    m_abort(false),
+    m_flushRequested(0),
+    m_flushDone(0),
+    m_droppedTotal(0) {
+}
+
+RGYLogAsync::~RGYLogAsync() {
+    close();
+}
+
+void RGYLogAsync::start() {
+    if (m_thread.joinable()) {
+        return;
+    }
+    m_abort = false;
+    m_running = true;
+    m_thread = std::thread(&RGYLogAsync::run, this);
+}
+
+void RGYLogAsync::close() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_abort = true;
+        }
+        m_cvWake.notify_all();
+        m_thread.join();
+    }
+}
+
+RGYLogAsync::Ring *RGYLogAsync::getRing() {
+    if (t_ringExited) {
+        return nullptr;
+    }
+    for (const auto& cache : t_ringCache) {
+        if (cache.id == m_id) {
+            return (Ring *)cache.ring;
+        }
+    }
+    //このスレッドからの初回の出力 (またはキャッシュから追い出された) なので、登録済みのリングバッファを探すか追加する
+    const auto threadId = std::this_thread::get_id();
+    Ring *ring = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMtx);
+        for (auto& r : m_rings) {
+            //終了したスレッドのIDは再利用されることがあるので、exitedのものは対象外
+            if (r->owner == threadId && !r->exited.load(std::memory_order_relaxed)) {
+                ring = r.get();
+                break;
+            }
+        }
+        if (ring == nullptr) {
+            m_rings.push_back(std::make_shared<Ring>(threadId));
+            ring = m_rings.back().get();
+            auto& exited = t_ringExit.exited;
+            exited.erase(std::remove_if(exited.begin(), exited.end(), [](const std::weak_ptr<std::atomic<bool>>& e) { return e.expired(); }), exited.end());
+            exited.push_back(std::shared_ptr<std::atomic<bool>>(m_rings.back(), &ring->exited));
+        }
+    }
+    auto& cache = t_ringCache[t_ringCacheNext];
+    t_ringCacheNext = (t_ringCacheNext + 1) % RGY_LOG_ASYNC_RING_CACHE;
+    cache.id = m_id;
+    cache.ring = ring;
+    return ring;
+}
+
+bool RGYLogAsync::push(RGYLogLevel log_level, const TCHAR *mes, bool file_only, int64_t time_us) {
+    if (!m_running) {
+        return false;
+    }
+    Ring *ring = getRing();
+    if (ring == nullptr) {
+        return false;
+    }
+    //pushingを立ててからm_runningを確認するので (いずれもseq_cst)、書き出しスレッドがm_running = falseとした後の
+    //最後のdrainで、ここで積んだログが取りこぼされることはない
+    ring->pushing.store(true);
+    const bool ret = pushRecord(ring, log_level, mes, file_only, time_us);
+    ring->pushing.store(false, std::memory_order_release);
+    return ret;
+}
+
+bool RGYLogAsync::pushRecord(Ring *ring, RGYLogLevel log_level, const TCHAR *mes, bool file_only, int64_t time_us) {
+    if (!m_running) {
+        return false;
+    }
+    const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail - ring->head.load(std::memory_order_acquire) >= (uint64_t)RGY_LOG_ASYNC_RING_SIZE) {
+        if (log_level < RGY_LOG_INFO) {
+            //詳細なログは捨てて、出力スレッドを止めないようにする
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        //重要なログは捨てずに、空きができるまで待つ
+        m_cvWake.notify_one();
+        while (tail - ring->head.load(std::memory_order_acquire) >= (uint64_t)RGY_LOG_ASYNC_RING_SIZE) {
+            if (!m_running) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    //リングバッファの要素の文字列は使いまわすので、通常は新たなメモリ確保は発生しない
+    auto& slot = ring->slots[tail & (RGY_LOG_ASYNC_RING_SIZE - 1)];
+    slot.level = log_level;
+    slot.file_only = file_only;
+    slot.time_us = time_us;
+    slot.mes.assign(mes);
+    ring->tail.store(tail + 1, std::memory_order_release);
+    if (log_level >= RGY_LOG_WARN) {
+        m_cvWake.notify_one();
+    }
+    return true;
+}
+
+void RGYLogAsync::flush() {
+    if (!m_running) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mtx);
+    const auto request = ++m_flushRequested;
+    m_cvWake.notify_one();
+    m_cvFlushed.wait(lock, [&]() { return m_flushDone >= request || !m_running; });
+}
+
+void RGYLogAsync::drain() {
+    m_drainRings.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMtx);
+        for (auto& r : m_rings) {
+            m_drainRings.push_back(r.get());
+        }
+    }
+    //各リングバッファにたまっているログを集め、要求された時刻順に並べて出力する
+    m_batch.clear();
+    std::vector<uint64_t> tails(m_drainRings.size());
+    int64_t dropped = 0;
+    for (size_t i = 0; i < m_drainRings.size(); i++) {
+        auto ring = m_drainRings[i];
+        tails[i] = ring->tail.load(std::memory_order_acquire);
+        for (uint64_t pos = ring->head.load(std::memory_order_relaxed); pos < tails[i]; pos++) {
+            m_batch.push_back(&ring->slots[pos & (RGY_LOG_ASYNC_RING_SIZE - 1)]);
+        }
+        dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+    std::stable_sort(m_batch.begin(), m_batch.end(), [](const RGYLogRecord *a, const RGYLogRecord *b) {
+        return a->time_us < b->time_us;
+    });
+    if (m_batch.size() > 0) {
+        m_log->writeRecords(m_batch.data(), m_batch.size());
+    }
+    //出力が終わったので、リングバッファの要素を解放する
+    bool exited = false;
+    for (size_t i = 0; i < m_drainRings.size(); i++) {
+        m_drainRings[i]->head.store(tails[i], std::memory_order_release);
+        exited |= m_drainRings[i]->exited.load(std::memory_order_relaxed);
+    }
+    //終了したスレッドのリングバッファは、出力し終えていれば破棄する
+    //(exitedを確認してからtailを読むので、終了前に積まれたログは必ずtailに反映されている)
+    if (exited) {
+        std::lock_guard<std::mutex> lock(m_ringsMtx);
+        m_rings.erase(std::remove_if(m_rings.begin(), m_rings.end(), [](const std::shared_ptr<Ring>& r) {
+            return r->exited.load(std::memory_order_acquire)
+                && r->head.load(std::memory_order_relaxed) == r->tail.load(std::memory_order_acquire);
+        }), m_rings.end());
+    }
+    if (dropped > 0) {
+        m_droppedTotal += dropped;
+        RGYLogRecord record;
+        record.level = RGY_LOG_WARN;
+        record.file_only = false;
+        record.time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        record.mes = strsprintf(_T("log: %lld log messages dropped.\n"), (long long int)dropped);
+        const RGYLogRecord *ptr = &record;
+        m_log->writeRecords(&ptr, 1);
+    }
+}
+
+void RGYLogAsync::run() {
+    RGYSetCurrentThreadName(RGY_THREAD_NAME_LOG);
+    std::unique_lock<std::mutex> lock(m_mtx);
+    for (;;) {
+        m_cvWake.wait_for(lock, std::chrono::milliseconds(RGY_LOG_ASYNC_INTERVAL_MS), [&]() {
+            return m_abort || m_flushRequested > m_flushDone;
+        });
+        const auto flushRequested = m_flushRequested;
+        const bool abort = m_abort;
+        lock.unlock();
+        drain();
+        lock.lock();
+        m_flushDone = flushRequested;
+        m_cvFlushed.notify_all();
+        if (abort) {
+            break;
+        }
+    }
+    //以降のログは呼び出し側で同期出力する
+    m_running = false;
+    lock.unlock();
+    //m_running = falseを見る前にpushに入ったスレッドが積み終わるのを待ってから、最後の出力を行う
+    //(この後に登録されるリングバッファは、m_ringsMtxを介してm_running = falseが見えるので積まれない)
+    {
+        std::lock_guard<std::mutex> ringsLock(m_ringsMtx);
+        for (auto& r : m_rings) {
+            while (r->pushing.load()) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    drain();
+    lock.lock();
+    m_cvFlushed.notify_all();
+}
@@ -0,0 +1,97 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_LOG_ASYNC_H__
+#define __RGY_LOG_ASYNC_H__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "rgy_log.h"
+
+static const int RGY_LOG_ASYNC_RING_SIZE = 1024;    // スレッドごとのリングバッファの要素数 (2の累乗)
+static const int RGY_LOG_ASYNC_INTERVAL_MS = 20;    // 書き出しスレッドが起床する間隔
+
+// RGYLogの非同期出力
+// 各スレッドは自分専用のリングバッファ(single producer/single consumer)にログを積むだけで、
+// ファイル/コンソールへの出力は書き出しスレッドがまとめて行う
+// リングバッファが一杯のときは、RGY_LOG_INFO未満のログは捨て、それ以外は空きができるまで待つ
+class RGYLogAsync {
+public:
+    RGYLogAsync(RGYLog *log);
+    ~RGYLogAsync();
+
+    void start();
+    // 書き出しスレッドに残っているログをすべて出力して終了する
+    void close();
+    // 書き出しスレッドが動作していなければfalseを返す (呼び出し側で同期出力すること)
+    bool push(RGYLogLevel log_level, const TCHAR *mes, bool file_only, int64_t time_us);
+    // 呼び出し時点までに積まれたログの出力を待つ
+    void flush();
+    // これまでに捨てたログの数
+    int64_t dropped() const { return m_droppedTotal; }
+protected:
+    struct Ring {
+        std::thread::id owner;
+        std::unique_ptr<RGYLogRecord[]> slots;
+        alignas(64) std::atomic<uint64_t> head; // 書き出しスレッドが次に読む位置
+        alignas(64) std::atomic<uint64_t> tail; // 積む側が次に書く位置
+        std::atomic<bool> pushing;              // 積む側がpush中 (書き出しスレッドは終了前にこれがfalseになるのを待つ)
+        std::atomic<int64_t> dropped;
+        std::atomic<bool> exited; // 積む側のスレッドが終了した (出力し終えたら解放してよい)
+
+        Ring(std::thread::id id);
+    };
+    Ring *getRing();
+    bool pushRecord(Ring *ring, RGYLogLevel log_level, const TCHAR *mes, bool file_only, int64_t time_us);
+    void run();
+    void drain();
+
+    RGYLog *m_log;
+    uint64_t m_id;                              // スレッドローカルのキャッシュでインスタンスを識別するためのID
+    std::mutex m_ringsMtx;                      // m_ringsへの追加/参照/削除用 (スレッドの初回出力時と終了時のみ)
+    std::vector<std::shared_ptr<Ring>> m_rings;
+    std::vector<Ring *> m_drainRings;           // 書き出しスレッドの作業用
+    std::vector<const RGYLogRecord *> m_batch;  // 書き出しスレッドの作業用
+
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::mutex m_mtx;
+    std::condition_variable m_cvWake;    // 書き出しスレッドの起床用
+    std::condition_variable m_cvFlushed; // flush()の完了通知用
+    bool m_abort;
+    uint64_t m_flushRequested;
+    uint64_t m_flushDone;
+    std::atomic<int64_t> m_droppedTotal;
+};
+
+#endif //__RGY_LOG_ASYNC_H__
@@ -0,0 +1,224 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#pragma once
+#ifndef __RGY_MAPPED_FILE_H__
+#define __RGY_MAPPED_FILE_H__
+
+#include <cstdint>
+#include <algorithm>
+#include "rgy_osdep.h"
+#include "rgy_tchar.h"
+#include "rgy_err.h"
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+// 読み込み専用でファイルをメモリマップする
+// ファイル全体ではなく、指定サイズの窓だけをマップし、読み進めるにつれて窓をずらしていく
+// これにより、巨大なファイルでも仮想メモリ・常駐メモリの使用量を一定に抑える
+class RGYMappedFile {
+public:
+    RGYMappedFile() :
+#if defined(_WIN32) || defined(_WIN64)
+        m_file(INVALID_HANDLE_VALUE),
+        m_mapping(nullptr),
+#else
+        m_fd(-1),
+#endif
+        m_fileSize(0),
+        m_windowSize(0),
+        m_align(4096),
+        m_view(nullptr),
+        m_viewOffset(0),
+        m_viewSize(0) {
+    }
+    ~RGYMappedFile() {
+        close();
+    }
+    RGYMappedFile(const RGYMappedFile&) = delete;
+    RGYMappedFile& operator=(const RGYMappedFile&) = delete;
+
+    // windowSize: 一度にマップする最大サイズ (0ならファイル全体)
+    RGY_ERR open(const TCHAR *filename, uint64_t windowSize) {
+        close();
+#if defined(_WIN32) || defined(_WIN64)
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        m_align = si.dwAllocationGranularity;
+        m_file = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            return RGY_ERR_FILE_OPEN;
+        }
+        LARGE_INTEGER size;
+        if (GetFileType(m_file) != FILE_TYPE_DISK || !GetFileSizeEx(m_file, &size) || size.QuadPart <= 0) {
+            close();
+            return RGY_ERR_UNSUPPORTED;
+        }
+        m_fileSize = (uint64_t)size.QuadPart;
+        m_mapping = CreateFileMapping(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr) {
+            close();
+            return RGY_ERR_UNSUPPORTED;
+        }
+#else
+        m_align = (uint64_t)sysconf(_SC_PAGESIZE);
+        m_fd = ::open(filename, O_RDONLY);
+        if (m_fd < 0) {
+            return RGY_ERR_FILE_OPEN;
+        }
+        struct stat st;
+        if (fstat(m_fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+            close();
+            return RGY_ERR_UNSUPPORTED;
+        }
+        m_fileSize = (uint64_t)st.st_size;
+        posix_fadvise(m_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        m_windowSize = (windowSize > 0) ? std::min(alignUp(windowSize), m_fileSize) : m_fileSize;
+        return RGY_ERR_NONE;
+    }
+
+    void close() {
+        unmap();
+#if defined(_WIN32) || defined(_WIN64)
+        if (m_mapping != nullptr) {
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+        if (m_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+#endif
+        m_fileSize = 0;
+        m_windowSize = 0;
+    }
+
+    bool is_open() const { return m_fileSize > 0; }
+    uint64_t size() const { return m_fileSize; }
+
+    // [offset, offset+size) を参照できるポインタを返す
+    // 返したポインタは次にmap()を呼ぶかclose()するまで有効
+    const uint8_t *map(uint64_t offset, size_t size) {
+        if (offset + size > m_fileSize) {
+            return nullptr;
+        }
+        if (m_view == nullptr || offset < m_viewOffset || offset + size > m_viewOffset + m_viewSize) {
+            unmap();
+            const uint64_t viewOffset = offset & ~(m_align - 1);
+            const uint64_t viewSize = std::min(std::max(m_windowSize, offset + size - viewOffset), m_fileSize - viewOffset);
+#if defined(_WIN32) || defined(_WIN64)
+            m_view = (uint8_t *)MapViewOfFile(m_mapping, FILE_MAP_READ, (DWORD)(viewOffset >> 32), (DWORD)(viewOffset & 0xffffffffu), (SIZE_T)viewSize);
+#else
+            void *ptr = mmap(nullptr, (size_t)viewSize, PROT_READ, MAP_PRIVATE, m_fd, (off_t)viewOffset);
+            m_view = (ptr == MAP_FAILED) ? nullptr : (uint8_t *)ptr;
+            if (m_view) {
+                madvise(m_view, (size_t)viewSize, MADV_SEQUENTIAL);
+            }
+#endif
+            if (m_view == nullptr) {
+                return nullptr;
+            }
+            m_viewOffset = viewOffset;
+            m_viewSize = viewSize;
+        }
+        return m_view + (offset - m_viewOffset);
+    }
+
+    // これから読む範囲の先読みを指示する
+    void prefetch(uint64_t offset, size_t size) {
+        if (offset >= m_fileSize) {
+            return;
+        }
+        size = (size_t)std::min<uint64_t>(size, m_fileSize - offset);
+#if defined(_WIN32) || defined(_WIN64)
+        // Windowsでは FILE_FLAG_SEQUENTIAL_SCAN によるOSの先読みに任せる
+        UNREFERENCED_PARAMETER(size);
+#else
+        posix_fadvise(m_fd, (off_t)offset, (off_t)size, POSIX_FADV_WILLNEED);
+#endif
+    }
+
+    // 読み終わった範囲を常駐メモリから解放する
+    void release(uint64_t offset, size_t size) {
+#if defined(_WIN32) || defined(_WIN64)
+        // Windowsでは窓の移動時のアンマップで解放される
+        UNREFERENCED_PARAMETER(offset);
+        UNREFERENCED_PARAMETER(size);
+#else
+        if (m_view == nullptr) {
+            return;
+        }
+        // ページ境界の内側だけを対象とする
+        const uint64_t start = std::max(alignUp(offset), m_viewOffset);
+        const uint64_t fin = std::min((offset + size) & ~(m_align - 1), m_viewOffset + m_viewSize);
+        if (start < fin) {
+            madvise(m_view + (start - m_viewOffset), (size_t)(fin - start), MADV_DONTNEED);
+        }
+#endif
+    }
+
+protected:
+    uint64_t alignUp(uint64_t value) const {
+        return (value + m_align - 1) & ~(m_align - 1);
+    }
+    void unmap() {
+        if (m_view != nullptr) {
+#if defined(_WIN32) || defined(_WIN64)
+            UnmapViewOfFile(m_view);
+#else
+            munmap(m_view, (size_t)m_viewSize);
+#endif
+            m_view = nullptr;
+        }
+        m_viewOffset = 0;
+        m_viewSize = 0;
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_fd;
+#endif
+    uint64_t m_fileSize;   // ファイルサイズ
+    uint64_t m_windowSize; // 一度にマップするサイズ
+    uint64_t m_align;      // マップ開始位置のアライメント
+    uint8_t *m_view;       // 現在マップしている領域
+    uint64_t m_viewOffset; // 現在マップしている領域のファイル上の位置
+    uint64_t m_viewSize;   // 現在マップしている領域のサイズ
+};
+
+#endif //__RGY_MAPPED_FILE_H__
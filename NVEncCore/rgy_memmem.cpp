@@ -50,6 +50,9 @@ decltype(rgy_memmem_c)* get_memmem_func() {
     if ((simd & RGY_SIMD::AVX512BW) == RGY_SIMD::AVX512BW) return rgy_memmem_avx512bw;
 #endif
     if ((simd & RGY_SIMD::AVX2) == RGY_SIMD::AVX2) return rgy_memmem_avx2;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    const auto simd = get_availableSIMD();
+    if ((simd & RGY_SIMD::NEON) == RGY_SIMD::NEON) return rgy_memmem_neon;
 #endif
     return rgy_memmem_c;
 }
@@ -37,6 +37,7 @@
 size_t rgy_memmem_c(const void *data_, const size_t data_size, const void *target_, const size_t target_size);
 size_t rgy_memmem_avx2(const void *data_, const size_t data_size, const void *target_, const size_t target_size);
 size_t rgy_memmem_avx512bw(const void *data_, const size_t data_size, const void *target_, const size_t target_size);
+size_t rgy_memmem_neon(const void *data_, const size_t data_size, const void *target_, const size_t target_size);
 
 static const auto RGY_MEMMEM_NOT_FOUND = std::numeric_limits<decltype(rgy_memmem_c(nullptr, 0, nullptr, 0))>::max();
 
@@ -109,7 +110,7 @@ static RGY_FORCEINLINE size_t rgy_memmem_avx2_imp(const void *data_, const size_
             uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(r0, target_first), _mm256_cmpeq_epi8(r1, target_last)));
             while (mask != 0) {
                 const auto j = CTZ32(mask);
-                if (memcmp(data + i + j + 1, target + 1, target_size - 2) == 0) {
+                if (target_size <= 2 || memcmp(data + i + j + 1, target + 1, target_size - 2) == 0) {
                     const auto ret = i + j;
                     return ret;
                 }
@@ -126,7 +127,7 @@ static RGY_FORCEINLINE size_t rgy_memmem_avx2_imp(const void *data_, const size_
         while (mask != 0) {
             const auto j = CTZ32(mask);
             if ((i + j + target_size - 1 < data_size)
-                && memcmp(data + i + j + 1, target + 1, target_size - 2) == 0) {
+                && (target_size <= 2 || memcmp(data + i + j + 1, target + 1, target_size - 2) == 0)) {
                 const auto ret = i + j;
                 return ret < data_size ? ret : RGY_MEMMEM_NOT_FOUND;
             }
@@ -165,7 +166,7 @@ static RGY_FORCEINLINE __m512i _mm512_loadu_si512_exact(const uint8_t *const dat
         48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63
     };
     const __m512i inc = _mm512_load_si512((const __m512i*)inctable);
-    const uint8_t remain_size = (uint8_t)std::min<decltype(data_fin - data)>(data_fin - data, 64);
+    const uint8_t remain_size = (uint8_t)std::max<decltype(data_fin - data)>(std::min<decltype(data_fin - data)>(data_fin - data, 64), 0);
     const auto mask = _mm512_cmplt_epi8_mask(inc, _mm512_set1_epi8(remain_size));
     return _mm512_maskz_loadu_epi8(mask, (const __m512i*)data);
 }
@@ -189,7 +190,7 @@ static RGY_FORCEINLINE size_t rgy_memmem_avx512_imp(const void *data_, const siz
             uint64_t mask = _mm512_mask_cmpeq_epi8_mask(_mm512_cmpeq_epi8_mask(r0, target_first), r1, target_last);
             while (mask != 0) {
                 const auto j = CTZ64(mask);
-                if (memcmp(data + i + j + 1, target + 1, target_size - 2) == 0) {
+                if (target_size <= 2 || memcmp(data + i + j + 1, target + 1, target_size - 2) == 0) {
                     const auto ret = i + j;
                     return ret;
                 }
@@ -206,7 +207,7 @@ static RGY_FORCEINLINE size_t rgy_memmem_avx512_imp(const void *data_, const siz
         while (mask != 0) {
             const auto j = CTZ64(mask);
             if ((i + j + target_size - 1 < data_size)
-                && memcmp(data + i + j + 1, target + 1, target_size - 2) == 0) {
+                && (target_size <= 2 || memcmp(data + i + j + 1, target + 1, target_size - 2) == 0)) {
                 const auto ret = i + j;
                 return ret;
             }
@@ -218,6 +219,59 @@ static RGY_FORCEINLINE size_t rgy_memmem_avx512_imp(const void *data_, const siz
 
 #endif //#if defined(_M_X64) || defined(__x86_64)
 
+#elif defined(RGY_MEMMEM_NEON)
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+
+#include <arm_neon.h>
+
+#if defined(_MSC_VER)
+#define CTZ64(x) _CountTrailingZeros64(x)
+#else
+#define CTZ64(x) __builtin_ctzll(x)
+#endif
+
+//NEONにはmovemaskがないので、1byteあたり4bitのマスクに縮約する
+static RGY_FORCEINLINE uint64_t neon_movemask_nibble(const uint8x16_t cmp) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
+}
+
+static RGY_FORCEINLINE size_t rgy_memmem_neon_imp(const void *data_, const size_t data_size, const void *target_, const size_t target_size) {
+    if (data_size < target_size) {
+        return RGY_MEMMEM_NOT_FOUND;
+    }
+    const uint8_t *data = (const uint8_t *)data_;
+    const uint8_t *target = (const uint8_t *)target_;
+    const uint8x16_t target_first = vdupq_n_u8(target[0]);
+    const uint8x16_t target_last = vdupq_n_u8(target[target_size - 1]);
+    const int64_t fin64 = (int64_t)data_size - (int64_t)(target_size + 16 - 1); // r1の16byteロードが安全に行える限界
+    size_t i = 0;
+    if (fin64 > 0) {
+        const size_t fin = (size_t)fin64;
+        for (; i < fin; i += 16) {
+            const uint8x16_t r0 = vld1q_u8(data + i);
+            const uint8x16_t r1 = vld1q_u8(data + i + target_size - 1);
+            uint64_t mask = neon_movemask_nibble(vandq_u8(vceqq_u8(r0, target_first), vceqq_u8(r1, target_last)));
+            while (mask != 0) {
+                const auto j = (size_t)(CTZ64(mask) >> 2);
+                if (target_size <= 2 || memcmp(data + i + j + 1, target + 1, target_size - 2) == 0) {
+                    return i + j;
+                }
+                mask &= ~(UINT64_C(0xf) << (j * 4));
+            }
+        }
+    }
+    //残りはページ境界を越えて読まないよう1byteずつ
+    for (; i + target_size <= data_size; i++) {
+        if (data[i] == target[0] && memcmp(data + i, target, target_size) == 0) {
+            return i;
+        }
+    }
+    return RGY_MEMMEM_NOT_FOUND;
+}
+
+#endif //#if defined(_M_ARM64) || defined(__aarch64__)
+
 #endif //#if defined(RGY_MEMMEM_AVX2)
 
 #endif //__RGY_MEMMEM_H__
\ No newline at end of file
@@ -0,0 +1,547 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#if defined(_WIN32) || defined(_WIN64)
+// windows.hより先に読み込む必要がある
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <io.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+#include <cerrno>
+#endif
+#include <algorithm>
+#include <cstdarg>
+#include <cstring>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <vector>
+#include "rgy_metrics.h"
+#include "rgy_version.h"
+#include "rgy_osdep.h"
+#include "rgy_util.h"
+#include "rgy_status.h"
+#include "rgy_perf_monitor.h"
+#include "rgy_thread_affinity.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+typedef SOCKET rgy_socket_t;
+static const int RGY_SEND_FLAGS = 0;
+static int rgy_socket_close(rgy_socket_t sock) { return closesocket(sock); }
+static int rgy_fd_write(int fd, const char *buf, size_t size) { return _write(fd, buf, (unsigned int)size); }
+#else
+typedef int rgy_socket_t;
+static const rgy_socket_t INVALID_SOCKET = -1;
+static const int RGY_SEND_FLAGS = MSG_NOSIGNAL; // 切断時にSIGPIPEで終了しないように
+static int rgy_socket_close(rgy_socket_t sock) { return ::close(sock); }
+static int rgy_fd_write(int fd, const char *buf, size_t size) { return (int)::write(fd, buf, size); }
+#endif
+
+static const int RGY_METRICS_SELECT_TIMEOUT_MS  = 100;  // 終了を確認する間隔
+static const int RGY_METRICS_REQUEST_TIMEOUT_MS = 1000; // リクエストの受信を待つ時間
+static const size_t RGY_METRICS_REQUEST_MAX = 8192;
+
+static rgy_socket_t toSocket(int64_t sock) {
+    return (sock < 0) ? INVALID_SOCKET : (rgy_socket_t)sock;
+}
+
+// sockが読み込み可能になるまで最大timeoutMs待つ
+static bool waitReadable(rgy_socket_t sock, int timeoutMs) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(sock, &fds);
+    struct timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    return select((int)sock + 1, &fds, nullptr, nullptr, &tv) > 0;
+}
+
+static bool sendAll(rgy_socket_t sock, const char *buf, size_t size) {
+    while (size > 0) {
+        const int ret = send(sock, buf, (int)size, RGY_SEND_FLAGS);
+        if (ret <= 0) {
+#if !(defined(_WIN32) || defined(_WIN64))
+            if (ret < 0 && errno == EINTR) continue;
+#endif
+            return false;
+        }
+        buf += ret;
+        size -= ret;
+    }
+    return true;
+}
+
+// 出力する値
+struct RGYMetricValue {
+    const char *name;
+    const char *help;
+    bool counter;   // 単調増加する値
+    bool integer;
+    double value;
+};
+
+RGYMetrics::RGYMetrics() :
+    m_log(),
+    m_prefix(),
+    m_startTime(0),
+    m_outputName(),
+    m_fp(nullptr),
+    m_fd(-1),
+    m_sock(-1),
+    m_thOutput(),
+    m_outputMtx(),
+    m_outputCond(),
+    m_lines(),
+    m_linesDropped(0),
+    m_outputEnabled(false),
+    m_listenSock(-1),
+    m_wsaInit(false),
+    m_thServer(),
+    m_textMtx(),
+    m_text(),
+    m_abort(false) {
+}
+
+RGYMetrics::~RGYMetrics() {
+    close();
+}
+
+void RGYMetrics::AddMessage(RGYLogLevel log_level, const TCHAR *format, ...) {
+    if (m_log == nullptr || log_level < m_log->getLogLevel(RGY_LOGT_PERF_MONITOR)) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int len = _vsctprintf(format, args) + 1; // _vscprintf doesn't count terminating '\0'
+    tstring buffer;
+    buffer.resize(len, _T('\0'));
+    _vstprintf_s(&buffer[0], len, format, args);
+    va_end(args);
+    m_log->write(log_level, RGY_LOGT_PERF_MONITOR, (_T("metrics: ") + tstring(buffer.c_str())).c_str());
+}
+
+RGY_ERR RGYMetrics::init(const tstring& output, int port, std::shared_ptr<RGYLog> log) {
+    close();
+    m_log = log;
+    m_abort = false;
+    m_startTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    m_prefix = ENCODER_NAME;
+    std::transform(m_prefix.begin(), m_prefix.end(), m_prefix.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+    m_prefix += "_";
+
+    if (output.length() > 0) {
+        auto err = openOutput(output);
+        if (err != RGY_ERR_NONE) {
+            close();
+            return err;
+        }
+        m_outputEnabled = true;
+        m_thOutput = std::thread(&RGYMetrics::runOutput, this);
+        AddMessage(RGY_LOG_DEBUG, _T("writing metrics to %s.\n"), output.c_str());
+    }
+    if (port > 0) {
+        auto err = openServer(port);
+        if (err != RGY_ERR_NONE) {
+            close();
+            return err;
+        }
+        m_thServer = std::thread(&RGYMetrics::runServer, this);
+        AddMessage(RGY_LOG_DEBUG, _T("serving metrics on http://127.0.0.1:%d/metrics.\n"), port);
+    }
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYMetrics::openOutput(const tstring& output) {
+    m_outputName = output;
+    if (output.substr(0, 3) == _T("fd:")) {
+        int fd = -1;
+        if (_stscanf_s(output.c_str() + 3, _T("%d"), &fd) != 1 || fd < 0) {
+            AddMessage(RGY_LOG_ERROR, _T("invalid fd: %s.\n"), output.c_str());
+            return RGY_ERR_INVALID_PARAM;
+        }
+        m_fd = fd;
+        return RGY_ERR_NONE;
+    }
+    if (output.substr(0, 5) == _T("unix:")) {
+#if defined(_WIN32) || defined(_WIN64)
+        AddMessage(RGY_LOG_ERROR, _T("unix socket is not supported on Windows: %s.\n"), output.c_str());
+        return RGY_ERR_UNSUPPORTED;
+#else
+        const auto path = tchar_to_string(output.substr(5));
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.length() == 0 || path.length() >= sizeof(addr.sun_path)) {
+            AddMessage(RGY_LOG_ERROR, _T("invalid unix socket path: %s.\n"), output.c_str());
+            return RGY_ERR_INVALID_PARAM;
+        }
+        strcpy(addr.sun_path, path.c_str());
+        rgy_socket_t sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sock == INVALID_SOCKET) {
+            AddMessage(RGY_LOG_ERROR, _T("failed to create unix socket: %s.\n"), char_to_tstring(strerror(errno)).c_str());
+            return RGY_ERR_UNKNOWN;
+        }
+        if (connect(sock, (const struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            AddMessage(RGY_LOG_ERROR, _T("failed to connect to %s: %s.\n"), output.c_str(), char_to_tstring(strerror(errno)).c_str());
+            rgy_socket_close(sock);
+            return RGY_ERR_FILE_OPEN;
+        }
+        m_sock = sock;
+        return RGY_ERR_NONE;
+#endif
+    }
+    m_fp = _tfopen(output.c_str(), _T("a"));
+    if (m_fp == nullptr) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to open %s.\n"), output.c_str());
+        return RGY_ERR_FILE_OPEN;
+    }
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYMetrics::openServer(int port) {
+#if defined(_WIN32) || defined(_WIN64)
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to initialize winsock.\n"));
+        return RGY_ERR_UNKNOWN;
+    }
+    m_wsaInit = true;
+#endif
+    rgy_socket_t sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to create socket.\n"));
+        return RGY_ERR_UNKNOWN;
+    }
+#if !(defined(_WIN32) || defined(_WIN64))
+    // 直前に終了したプロセスのTIME_WAITが残っていても同じポートを使えるように
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // 外部からは接続させない
+    if (bind(sock, (const struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(sock, 16) != 0) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to listen on 127.0.0.1:%d.\n"), port);
+        rgy_socket_close(sock);
+        return RGY_ERR_UNKNOWN;
+    }
+    m_listenSock = (int64_t)sock;
+    return RGY_ERR_NONE;
+}
+
+void RGYMetrics::close() {
+    m_abort = true;
+    m_outputCond.notify_all();
+    if (m_thOutput.joinable()) {
+        m_thOutput.join();
+    }
+    if (m_thServer.joinable()) {
+        m_thServer.join();
+    }
+    closeOutput();
+    if (m_listenSock >= 0) {
+        rgy_socket_close(toSocket(m_listenSock));
+        m_listenSock = -1;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    if (m_wsaInit) {
+        WSACleanup();
+        m_wsaInit = false;
+    }
+#endif
+    if (m_linesDropped > 0) {
+        AddMessage(RGY_LOG_DEBUG, _T("%llu lines were dropped as the output could not keep up.\n"), (unsigned long long)m_linesDropped);
+        m_linesDropped = 0;
+    }
+    m_lines.clear();
+    m_outputEnabled = false;
+    m_log.reset();
+}
+
+void RGYMetrics::closeOutput() {
+    if (m_fp) {
+        fclose(m_fp);
+        m_fp = nullptr;
+    }
+    if (m_sock >= 0) {
+        rgy_socket_close(toSocket(m_sock));
+        m_sock = -1;
+    }
+    m_fd = -1; // 指定されたfdは呼び出し元のものなので閉じない
+}
+
+bool RGYMetrics::writeLine(const std::string& line) {
+    if (m_fp) {
+        fwrite(line.c_str(), 1, line.length(), m_fp);
+        fflush(m_fp);
+        return ferror(m_fp) == 0;
+    }
+    if (m_sock >= 0) {
+        return sendAll(toSocket(m_sock), line.c_str(), line.length());
+    }
+    if (m_fd >= 0) {
+        const char *ptr = line.c_str();
+        size_t remain = line.length();
+        while (remain > 0) {
+            const int ret = rgy_fd_write(m_fd, ptr, remain);
+            if (ret <= 0) {
+#if !(defined(_WIN32) || defined(_WIN64))
+                if (ret < 0 && errno == EINTR) continue;
+                if (ret < 0 && errno == EPIPE) {
+                    // ブロックしておいたSIGPIPEを取り除く
+                    sigset_t sigpipe;
+                    sigemptyset(&sigpipe);
+                    sigaddset(&sigpipe, SIGPIPE);
+                    struct timespec ts = { 0, 0 };
+                    sigtimedwait(&sigpipe, nullptr, &ts);
+                }
+#endif
+                return false;
+            }
+            ptr += ret;
+            remain -= ret;
+        }
+        return true;
+    }
+    return false;
+}
+
+void RGYMetrics::runOutput() {
+    RGYSetCurrentThreadName(RGY_THREAD_NAME_METRICS);
+#if !(defined(_WIN32) || defined(_WIN64))
+    // パイプの読み込み側が閉じられても、SIGPIPEでプロセスが終了しないように
+    sigset_t sigpipe;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, nullptr);
+#endif
+    std::unique_lock<std::mutex> lock(m_outputMtx);
+    for (;;) {
+        m_outputCond.wait(lock, [this]() { return m_abort || !m_lines.empty(); });
+        if (m_lines.empty()) {
+            break; // m_abortの場合も、残っている行はすべて書き出してから終了する
+        }
+        auto line = std::move(m_lines.front());
+        m_lines.pop_front();
+        lock.unlock();
+        const bool ok = writeLine(line);
+        lock.lock();
+        if (!ok) {
+            AddMessage(RGY_LOG_WARN, _T("failed to write to %s, metrics output disabled.\n"), m_outputName.c_str());
+            m_outputEnabled = false;
+            m_lines.clear();
+            break;
+        }
+    }
+}
+
+void RGYMetrics::runServer() {
+    RGYSetCurrentThreadName(RGY_THREAD_NAME_METRICS);
+    const auto listenSock = toSocket(m_listenSock);
+    while (!m_abort) {
+        if (!waitReadable(listenSock, RGY_METRICS_SELECT_TIMEOUT_MS)) {
+            continue;
+        }
+        rgy_socket_t sock = accept(listenSock, nullptr, nullptr);
+        if (sock == INVALID_SOCKET) {
+            continue;
+        }
+        // ヘッダの終わりまで受信する
+        std::string request;
+        char buf[1024];
+        const auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(RGY_METRICS_REQUEST_TIMEOUT_MS);
+        while (!m_abort && request.find("\r\n\r\n") == std::string::npos && request.length() < RGY_METRICS_REQUEST_MAX
+            && std::chrono::steady_clock::now() < timeout) {
+            if (!waitReadable(sock, RGY_METRICS_SELECT_TIMEOUT_MS)) {
+                continue;
+            }
+            const int ret = recv(sock, buf, sizeof(buf), 0);
+            if (ret <= 0) {
+                break;
+            }
+            request.append(buf, ret);
+        }
+        // "GET /metrics HTTP/1.1" の形式のリクエストのみ受け付ける
+        const auto lineEnd = request.find("\r\n");
+        const auto tokens = split(request.substr(0, lineEnd), " ");
+        std::string status = "200 OK";
+        std::string body;
+        if (lineEnd == std::string::npos || tokens.size() < 2) {
+            status = "400 Bad Request";
+        } else if (tokens[0] != "GET" && tokens[0] != "HEAD") {
+            status = "405 Method Not Allowed";
+        } else {
+            const auto path = tokens[1].substr(0, tokens[1].find('?'));
+            if (path == "/" || path == "/metrics") {
+                std::lock_guard<std::mutex> lock(m_textMtx);
+                body = m_text;
+            } else {
+                status = "404 Not Found";
+            }
+        }
+        std::string response = "HTTP/1.0 " + status + "\r\n";
+        response += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+        response += strsprintf("Content-Length: %llu\r\n", (unsigned long long)body.length());
+        response += "Connection: close\r\n\r\n";
+        if (tokens.size() > 0 && tokens[0] != "HEAD") {
+            response += body;
+        }
+        sendAll(sock, response.c_str(), response.length());
+        rgy_socket_close(sock);
+    }
+}
+
+void RGYMetrics::update(const EncodeStatusData& status, const PerfInfo& perf, const PerfQueueInfo& queue, bool finished) {
+    auto avg = [](double sum, double count) { return (count > 0) ? sum / count : 0.0; };
+    std::vector<RGYMetricValue> values = {
+        { "progress_percent",         "encode progress (%)",                         false, false, status.progressPercent },
+        { "frames_total",             "number of frames to be encoded (0 if unknown)", false, true, (double)status.frameTotal },
+        { "duration_total_seconds",   "duration of the input to be encoded (s)",     false, false, status.totalDuration },
+        { "output_fps",               "output frame rate",                           false, false, avg(status.outputFPSRate, status.outputFPSScale) },
+        { "frames_in",                "frames sent to the encoder",                  true,  true,  (double)status.frameIn },
+        { "frames_out",               "frames output",                               true,  true,  (double)status.frameOut },
+        { "frames_drop",              "frames dropped",                              true,  true,  (double)status.frameDrop },
+        { "frames_out_idr",           "IDR frames output",                           true,  true,  (double)status.frameOutIDR },
+        { "frames_out_i",             "I frames output",                             true,  true,  (double)status.frameOutI },
+        { "frames_out_p",             "P frames output",                             true,  true,  (double)status.frameOutP },
+        { "frames_out_b",             "B frames output",                             true,  true,  (double)status.frameOutB },
+        { "frames_out_i_bytes",       "size of I frames output (byte)",              true,  true,  (double)status.frameOutISize },
+        { "frames_out_p_bytes",       "size of P frames output (byte)",              true,  true,  (double)status.frameOutPSize },
+        { "frames_out_b_bytes",       "size of B frames output (byte)",              true,  true,  (double)status.frameOutBSize },
+        { "frames_out_i_qp_avg",      "average QP of I frames",                      false, false, avg(status.frameOutIQPSum, status.frameOutI) },
+        { "frames_out_p_qp_avg",      "average QP of P frames",                      false, false, avg(status.frameOutPQPSum, status.frameOutP) },
+        { "frames_out_b_qp_avg",      "average QP of B frames",                      false, false, avg(status.frameOutBQPSum, status.frameOutB) },
+        { "out_file_bytes",           "size of the output file (byte)",              true,  true,  (double)status.outFileSize },
+        { "encode_fps",               "encode speed (fps)",                          false, false, status.encodeFps },
+        { "bitrate_kbps",             "bitrate of the output (kbps)",                false, false, status.bitrateKbps },
+        { "gpu_info_success",         "successful GPU usage samples",                true,  true,  (double)status.GPUInfoCountSuccess },
+        { "gpu_info_fail",            "failed GPU usage samples",                    true,  true,  (double)status.GPUInfoCountFail },
+        { "gpu_load_percent_avg",     "average GPU load (%)",                        false, false, avg(status.GPULoadPercentTotal, status.GPUInfoCountSuccess) },
+        { "vee_load_percent_avg",     "average video encode engine load (%)",        false, false, avg(status.VEELoadPercentTotal, status.GPUInfoCountSuccess) },
+        { "ved_load_percent_avg",     "average video decode engine load (%)",        false, false, avg(status.VEDLoadPercentTotal, status.GPUInfoCountSuccess) },
+        { "gpu_clock_avg",            "average GPU clock (MHz)",                     false, false, avg(status.GPUClockTotal, status.GPUInfoCountSuccess) },
+        { "ve_clock_avg",             "average video engine clock (MHz)",            false, false, avg(status.VEClockTotal, status.GPUInfoCountSuccess) },
+        { "cpu_percent",              "CPU usage of the process (%)",                false, false, perf.cpu_percent },
+        { "cpu_kernel_percent",       "CPU usage of the process in kernel (%)",      false, false, perf.cpu_kernel_percent },
+        { "thread_main_percent",      "CPU usage of the main thread (%)",            false, false, perf.main_thread_percent },
+        { "thread_enc_percent",       "CPU usage of the encode thread (%)",          false, false, perf.enc_thread_percent },
+        { "thread_aud_proc_percent",  "CPU usage of the audio process thread (%)",   false, false, perf.aud_proc_thread_percent },
+        { "thread_aud_enc_percent",   "CPU usage of the audio encode thread (%)",    false, false, perf.aud_enc_thread_percent },
+        { "thread_out_percent",       "CPU usage of the output thread (%)",          false, false, perf.out_thread_percent },
+        { "thread_in_percent",        "CPU usage of the input thread (%)",           false, false, perf.in_thread_percent },
+        { "mem_private_bytes",        "private memory of the process (byte)",        false, true,  (double)perf.mem_private },
+        { "mem_virtual_bytes",        "virtual memory of the process (byte)",        false, true,  (double)perf.mem_virtual },
+        { "io_read_bytes",            "bytes read by the process",                   true,  true,  (double)perf.io_total_read },
+        { "io_write_bytes",           "bytes written by the process",                true,  true,  (double)perf.io_total_write },
+        { "io_read_bytes_per_sec",    "read speed of the process (byte/s)",          false, false, perf.io_read_per_sec },
+        { "io_write_bytes_per_sec",   "write speed of the process (byte/s)",         false, false, perf.io_write_per_sec },
+        { "fps_avg",                  "average encode speed (fps)",                  false, false, perf.fps_avg },
+        { "bitrate_kbps_avg",         "average bitrate of the output (kbps)",        false, false, perf.bitrate_kbps_avg },
+        { "queue_vid_in",             "video packets queued in the input",           false, true,  (double)queue.usage_vid_in },
+        { "queue_aud_in",             "audio packets queued in the input",           false, true,  (double)queue.usage_aud_in },
+        { "queue_vid_out",            "video packets queued in the output",          false, true,  (double)queue.usage_vid_out },
+        { "queue_aud_out",            "audio packets queued in the output",          false, true,  (double)queue.usage_aud_out },
+        { "queue_aud_enc",            "audio frames queued for encoding",            false, true,  (double)queue.usage_aud_enc },
+        { "queue_aud_proc",           "audio packets queued for processing",         false, true,  (double)queue.usage_aud_proc },
+        { "out_bytes_in_flight",      "bytes being written by the async output",     false, true,  (double)queue.out_bytes_in_flight },
+        { "out_write_latency_us",     "latency of the last async write (us)",        false, true,  (double)queue.out_write_latency_us },
+        { "in_prefetch_hit",          "input reads served by the prefetch",          true,  true,  (double)queue.in_prefetch_hit },
+        { "in_prefetch_access",       "input reads with prefetch",                   true,  true,  (double)queue.in_prefetch_access },
+        { "in_prefetch_stall_us",     "time waited for the input prefetch (us)",     true,  true,  (double)queue.in_prefetch_stall_us },
+        { "pkt_pool_alloc",           "packets allocated by the packet pool",        true,  true,  (double)queue.pkt_pool_alloc },
+        { "pkt_pool_reuse",           "packets reused by the packet pool",           true,  true,  (double)queue.pkt_pool_reuse },
+        { "pkt_payload_alloc",        "packet payloads allocated by the packet pool", true, true,  (double)queue.pkt_payload_alloc },
+        { "pkt_payload_reuse",        "packet payloads reused by the packet pool",   true,  true,  (double)queue.pkt_payload_reuse },
+    };
+    if (perf.gpu_info_valid) {
+        values.push_back({ "gpu_load_percent",     "GPU load (%)",                       false, false, perf.gpu_load_percent });
+        values.push_back({ "gpu_clock",            "GPU clock (MHz)",                    false, false, perf.gpu_clock });
+        values.push_back({ "vee_load_percent",     "video encode engine load (%)",       false, false, perf.vee_load_percent });
+        values.push_back({ "ved_load_percent",     "video decode engine load (%)",       false, false, perf.ved_load_percent });
+        values.push_back({ "ve_clock",             "video engine clock (MHz)",           false, false, perf.ve_clock });
+        values.push_back({ "pcie_gen",             "PCIe generation",                    false, true,  (double)perf.pcie_gen });
+        values.push_back({ "pcie_link",            "PCIe link width",                    false, true,  (double)perf.pcie_link });
+        values.push_back({ "pcie_tx_kb_per_sec",   "PCIe TX throughput (KB/s)",          false, true,  (double)perf.pcie_throughput_tx_per_sec });
+        values.push_back({ "pcie_rx_kb_per_sec",   "PCIe RX throughput (KB/s)",          false, true,  (double)perf.pcie_throughput_rx_per_sec });
+    }
+    // 非有限値は%.3fだと"nan"/"inf"となりJSONとして不正なので、JSONではnull、PrometheusではNaNとして出力する
+    auto valueStr = [](const RGYMetricValue& v, const char *nonFinite) {
+        if (!std::isfinite(v.value)) {
+            return std::string(nonFinite);
+        }
+        return (v.integer) ? strsprintf("%lld", (long long)v.value) : strsprintf("%.3f", v.value);
+    };
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() - m_startTime;
+    const auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Prometheusのtext形式
+    std::string text;
+    text += strsprintf("# HELP %selapsed_seconds time since the metrics were enabled (s)\n# TYPE %selapsed_seconds gauge\n%selapsed_seconds %.3f\n",
+        m_prefix.c_str(), m_prefix.c_str(), m_prefix.c_str(), elapsed * 1e-3);
+    text += strsprintf("# HELP %sfinished 1 if the encode has finished\n# TYPE %sfinished gauge\n%sfinished %d\n",
+        m_prefix.c_str(), m_prefix.c_str(), m_prefix.c_str(), (finished) ? 1 : 0);
+    for (const auto& v : values) {
+        const auto name = m_prefix + v.name + ((v.counter) ? "_total" : "");
+        text += strsprintf("# HELP %s %s\n# TYPE %s %s\n%s %s\n",
+            name.c_str(), v.help, name.c_str(), (v.counter) ? "counter" : "gauge", name.c_str(), valueStr(v, "NaN").c_str());
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_textMtx);
+        m_text = std::move(text);
+    }
+
+    // newline-delimited JSON
+    std::lock_guard<std::mutex> lock(m_outputMtx);
+    if (!m_outputEnabled) {
+        return;
+    }
+    std::string line = strsprintf("{\"timestamp\":%.3f,\"elapsed\":%.3f,\"pid\":%u,\"finished\":%s",
+        timestamp * 1e-3, elapsed * 1e-3, (uint32_t)GetCurrentProcessId(), (finished) ? "true" : "false");
+    for (const auto& v : values) {
+        line += strsprintf(",\"%s\":%s", v.name, valueStr(v, "null").c_str());
+    }
+    line += "}\n";
+    m_lines.push_back(std::move(line));
+    if (m_lines.size() > RGY_METRICS_MAX_PENDING_LINES) {
+        m_lines.pop_front();
+        m_linesDropped++;
+    }
+    m_outputCond.notify_one();
+}
@@ -0,0 +1,102 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#pragma once
+#ifndef __RGY_METRICS_H__
+#define __RGY_METRICS_H__
+
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "rgy_tchar.h"
+#include "rgy_err.h"
+#include "rgy_log.h"
+
+struct EncodeStatusData;
+struct PerfInfo;
+struct PerfQueueInfo;
+
+static const size_t RGY_METRICS_MAX_PENDING_LINES = 64; // 書き込みが追いつかない場合に保持する行数 (超えた分は古いものから捨てる)
+
+// 進捗と性能情報を外部のプロセスから取得できるようにするためのクラス
+// CPerfMonitorのスレッドから定期的にupdateを呼び、
+//  - 出力先 (ファイル, fd:<n>, unix:<path>) にnewline-delimited JSONを書き出す
+//  - localhostの指定したポートでPrometheusのtext形式の値を返す
+// 書き込み・応答はそれぞれ専用のスレッドで行い、updateを呼んだスレッドは待たせない
+class RGYMetrics {
+public:
+    RGYMetrics();
+    ~RGYMetrics();
+
+    RGY_ERR init(const tstring& output, int port, std::shared_ptr<RGYLog> log);
+    void close();
+
+    // 現在の値で出力を更新する (finished: エンコード終了後の最後の更新)
+    void update(const EncodeStatusData& status, const PerfInfo& perf, const PerfQueueInfo& queue, bool finished);
+protected:
+    RGY_ERR openOutput(const tstring& output);
+    RGY_ERR openServer(int port);
+    void runOutput();
+    void runServer();
+    bool writeLine(const std::string& line);
+    void closeOutput();
+
+    void AddMessage(RGYLogLevel log_level, const TCHAR *format, ...);
+
+    std::shared_ptr<RGYLog> m_log;
+    std::string m_prefix;       // Prometheusのメトリクス名の接頭辞
+    int64_t m_startTime;        // updateで出力する経過時間の基準 (ms)
+
+    // newline-delimited JSONの出力
+    tstring m_outputName;
+    FILE *m_fp;                 // ファイルに出力する場合
+    int m_fd;                   // fd:<n>で指定された場合
+    int64_t m_sock;             // unix:<path>で指定された場合 (無効な場合は-1)
+    std::thread m_thOutput;
+    std::mutex m_outputMtx;
+    std::condition_variable m_outputCond;
+    std::deque<std::string> m_lines; // 書き込み待ちの行
+    uint64_t m_linesDropped;
+    bool m_outputEnabled;       // 書き込みに失敗した場合はfalseにして以降の出力をやめる
+
+    // Prometheusのtext形式の応答
+    int64_t m_listenSock;       // 無効な場合は-1
+    bool m_wsaInit;
+    std::thread m_thServer;
+    std::mutex m_textMtx;
+    std::string m_text;         // 最新の値
+
+    std::atomic<bool> m_abort;
+};
+
+#endif //__RGY_METRICS_H__
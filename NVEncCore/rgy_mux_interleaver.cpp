@@ -0,0 +1,227 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include <climits>
+#include <algorithm>
+#include "rgy_mux_interleaver.h"
+
+bool RGYIndexedMinHeap::less(int a, int b) const {
+    // キーが同じなら、idの小さいほうを優先する
+    return (m_heap[a].key != m_heap[b].key) ? m_heap[a].key < m_heap[b].key : m_heap[a].id < m_heap[b].id;
+}
+
+void RGYIndexedMinHeap::swapEntry(int a, int b) {
+    std::swap(m_heap[a], m_heap[b]);
+    m_pos[m_heap[a].id] = a;
+    m_pos[m_heap[b].id] = b;
+}
+
+void RGYIndexedMinHeap::up(int idx) {
+    while (idx > 0) {
+        const int parent = (idx - 1) >> 1;
+        if (!less(idx, parent)) break;
+        swapEntry(idx, parent);
+        idx = parent;
+    }
+}
+
+void RGYIndexedMinHeap::down(int idx) {
+    const int n = (int)m_heap.size();
+    for (;;) {
+        const int left = idx * 2 + 1;
+        if (left >= n) break;
+        int child = left;
+        if (left + 1 < n && less(left + 1, left)) {
+            child = left + 1;
+        }
+        if (!less(child, idx)) break;
+        swapEntry(idx, child);
+        idx = child;
+    }
+}
+
+void RGYIndexedMinHeap::set(int id, int64_t key) {
+    if (id >= (int)m_pos.size()) {
+        m_pos.resize(id + 1, -1);
+    }
+    int idx = m_pos[id];
+    if (idx < 0) {
+        idx = (int)m_heap.size();
+        m_heap.push_back({ key, id });
+        m_pos[id] = idx;
+        up(idx);
+        return;
+    }
+    const auto prevKey = m_heap[idx].key;
+    m_heap[idx].key = key;
+    if (key < prevKey) {
+        up(idx);
+    } else {
+        down(idx);
+    }
+}
+
+void RGYIndexedMinHeap::erase(int id) {
+    if (!contains(id)) {
+        return;
+    }
+    const int idx = m_pos[id];
+    const int last = (int)m_heap.size() - 1;
+    if (idx != last) {
+        swapEntry(idx, last);
+    }
+    m_heap.pop_back();
+    m_pos[id] = -1;
+    if (idx < (int)m_heap.size()) {
+        up(idx);
+        down(idx);
+    }
+}
+
+RGYMuxInterleaver::RGYMuxInterleaver() :
+    m_dtsThreshold(0),
+    m_stallWait(0),
+    m_pressureCount(0),
+    m_pressureGate(-1),
+    m_streams(),
+    m_gate(),
+    m_ready() {
+}
+
+void RGYMuxInterleaver::init(int64_t dtsThreshold, int stallWait) {
+    m_dtsThreshold = dtsThreshold;
+    m_stallWait = stallWait;
+    m_pressureCount = 0;
+    m_pressureGate = -1;
+    m_streams.clear();
+    m_gate = RGYIndexedMinHeap();
+    m_ready = RGYIndexedMinHeap();
+}
+
+int RGYMuxInterleaver::addStream(const tstring& name, bool gating, int64_t initDts) {
+    const int id = (int)m_streams.size();
+    Stream stream;
+    stream.name = name;
+    stream.gating = gating;
+    stream.ended = false;
+    stream.lastDts = initDts;
+    stream.depth = 0;
+    stream.maxDepth = 0;
+    stream.written = 0;
+    stream.stalled = 0;
+    m_streams.push_back(stream);
+    if (gating) {
+        m_gate.set(id, initDts);
+    }
+    return id;
+}
+
+int64_t RGYMuxInterleaver::readyKey(int id) const {
+    // 同期対象外のストリームは待たせる理由がないので、先に書き出す
+    return (m_streams[id].gating) ? m_streams[id].lastDts : INT64_MIN;
+}
+
+void RGYMuxInterleaver::setDepth(int id, size_t depth) {
+    auto& stream = m_streams[id];
+    stream.depth = depth;
+    stream.maxDepth = std::max(stream.maxDepth, depth);
+    if (depth > 0) {
+        m_ready.set(id, readyKey(id));
+    } else {
+        m_ready.erase(id);
+    }
+}
+
+void RGYMuxInterleaver::written(int id, int64_t dts) {
+    auto& stream = m_streams[id];
+    stream.written++;
+    if (dts <= stream.lastDts) {
+        return;
+    }
+    stream.lastDts = dts;
+    if (m_gate.contains(id)) {
+        if (m_pressureGate == id) {
+            // 待っていたストリームが進んだ
+            m_pressureCount = 0;
+            m_pressureGate = -1;
+        }
+        m_gate.set(id, dts);
+    }
+    if (m_ready.contains(id)) {
+        m_ready.set(id, readyKey(id));
+    }
+}
+
+void RGYMuxInterleaver::setEnded(int id) {
+    m_streams[id].ended = true;
+    m_gate.erase(id);
+}
+
+int RGYMuxInterleaver::gatingStream() const {
+    if (m_gate.empty()) {
+        return -1;
+    }
+    const int gate = m_gate.top();
+    return (m_streams[gate].depth == 0) ? gate : -1;
+}
+
+int RGYMuxInterleaver::next(bool pressure) {
+    if (m_ready.empty()) {
+        return -1;
+    }
+    const int cand = m_ready.top();
+    if (m_gate.empty()) {
+        return cand;
+    }
+    const int gate = m_gate.top();
+    const int64_t gateDts = m_gate.topKey();
+    // gating streamにパケットがあれば、candはgating stream自身か、それと同じdtsのストリーム
+    if (m_streams[gate].depth > 0
+        || !m_streams[cand].gating
+        || gateDts < 0
+        || m_streams[cand].lastDts - m_dtsThreshold <= gateDts) {
+        return cand;
+    }
+    // gating streamのパケットが来るのを待つ
+    if (!pressure) {
+        return -1;
+    }
+    if (m_pressureGate != gate) {
+        m_pressureGate = gate;
+        m_pressureCount = 0;
+    }
+    if (++m_pressureCount <= m_stallWait) {
+        return -1;
+    }
+    // 一定以上待ってもgating streamのパケットが来ないので、
+    // gating streamを無視して進める (ストリームが途中までしかない場合など)
+    auto& gateStream = m_streams[gate];
+    gateStream.stalled++;
+    gateStream.lastDts = m_streams[cand].lastDts;
+    m_gate.set(gate, gateStream.lastDts);
+    return cand;
+}
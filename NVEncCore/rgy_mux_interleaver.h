@@ -0,0 +1,108 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_MUX_INTERLEAVER_H__
+#define __RGY_MUX_INTERLEAVER_H__
+
+#include <cstdint>
+#include <vector>
+#include "rgy_tchar.h"
+
+// idをキーの小さい順に取り出すためのmin-heap
+// 各idのheap上の位置を保持しており、キーの更新・削除をO(log n)で行える
+class RGYIndexedMinHeap {
+public:
+    RGYIndexedMinHeap() : m_heap(), m_pos() {};
+    bool empty() const { return m_heap.empty(); }
+    bool contains(int id) const { return id < (int)m_pos.size() && m_pos[id] >= 0; }
+    int top() const { return m_heap.front().id; }
+    int64_t topKey() const { return m_heap.front().key; }
+    void set(int id, int64_t key); // 追加、またはキーの更新
+    void erase(int id);
+protected:
+    struct Entry {
+        int64_t key;
+        int id;
+    };
+    bool less(int a, int b) const;
+    void swapEntry(int a, int b);
+    void up(int idx);
+    void down(int idx);
+
+    std::vector<Entry> m_heap;
+    std::vector<int> m_pos; // 各idのheap上の位置 (-1: heapにない)
+};
+
+// 出力スレッドで、映像・音声・字幕の各ストリームをdts順に書き出すための並べ替え
+// 各ストリームは、書き出し待ちのパケット数(depth)と、最後に書き出したdts(共通のtimebase)を持つ
+//  - 同期対象のストリームのうち、dtsが最も進んでいないものがgating streamとなる
+//  - gating streamに書き出し待ちのパケットがあれば、それを書き出す
+//  - gating streamが空なら、ほかのストリームはgating streamのdts+閾値までしか進めない
+// 同期対象外のストリーム(字幕・データなど)は、いつでも書き出せる
+class RGYMuxInterleaver {
+public:
+    struct Stream {
+        tstring name;
+        bool gating;      // 同期の対象とするか
+        bool ended;       // 終了したか (終了したストリームは待たない)
+        int64_t lastDts;  // 最後に書き出したdts
+        size_t depth;     // 書き出し待ちのパケット数
+        size_t maxDepth;  // depthの最大値
+        int64_t written;  // 書き出したパケット数
+        int64_t stalled;  // このストリームを待たずに進めた回数
+    };
+    RGYMuxInterleaver();
+
+    // dtsThreshold: gating streamからどこまで先行して書き出してよいか
+    // stallWait   : 書き出し待ちがたまった状態で、gating streamを何回待ったらあきらめるか
+    void init(int64_t dtsThreshold, int stallWait);
+    int addStream(const tstring& name, bool gating, int64_t initDts);
+    void setDepth(int id, size_t depth);
+    void written(int id, int64_t dts);
+    void setEnded(int id);
+    // 次に書き出すストリームを返す (書き出せるものがなければ-1)
+    // pressure: 書き出し待ちがたまっており、入力側が止まりそうな場合にtrue
+    int next(bool pressure);
+    // 現在進行を止めているストリーム (なければ-1)
+    int gatingStream() const;
+
+    int streamCount() const { return (int)m_streams.size(); }
+    const Stream& stream(int id) const { return m_streams[id]; }
+protected:
+    int64_t readyKey(int id) const;
+
+    int64_t m_dtsThreshold;
+    int m_stallWait;
+    int m_pressureCount;   // gating streamを待った回数 (pressureがある場合のみ)
+    int m_pressureGate;    // m_pressureCountの対象のストリーム
+    std::vector<Stream> m_streams;
+    RGYIndexedMinHeap m_gate;  // 同期対象で終了していないストリーム (キー: lastDts)
+    RGYIndexedMinHeap m_ready; // 書き出し待ちのパケットがあるストリーム (キー: lastDts, 同期対象外はINT64_MIN)
+};
+
+#endif //__RGY_MUX_INTERLEAVER_H__
@@ -0,0 +1,263 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include "rgy_nvrtc_cache.h"
+#include "rgy_osdep.h"
+#include "rgy_util.h"
+#include "rgy_filesystem.h"
+
+static const uint32_t RGY_NVRTC_CACHE_VERSION = 1;
+static const char RGY_NVRTC_CACHE_MAGIC[8] = { 'R', 'G', 'Y', 'N', 'V', 'R', 'T', 'C' };
+static const TCHAR *RGY_NVRTC_CACHE_EXT = _T(".nvrtc"); // キャッシュファイルの拡張子
+static const TCHAR *RGY_NVRTC_CACHE_TMP_EXT = _T(".tmp");
+static const uint64_t RGY_NVRTC_CACHE_MAX_ENTRY_SIZE = 256 * 1024 * 1024; // 壊れたファイルで巨大な確保をしないための上限
+static const auto RGY_NVRTC_CACHE_TMP_EXPIRE = std::chrono::hours(1); // 異常終了で残った一時ファイルを削除するまでの時間
+
+// キャッシュファイルのヘッダ
+struct RGYNVRTCCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t keySize;
+    uint64_t keyHash;     // ファイル名とは別の初期値で計算したキーのハッシュ (ファイル名の衝突の確認用)
+    uint64_t mangledSize;
+    uint64_t ptxSize;
+};
+static_assert(sizeof(RGYNVRTCCacheHeader) == 48, "unexpected padding in RGYNVRTCCacheHeader.");
+
+static uint64_t keyHashName(const std::string& key) {
+    return hash_fnv1a(RGY_FNV1A_64_INIT, (const uint8_t *)key.data(), key.size());
+}
+
+static uint64_t keyHashCheck(const std::string& key) {
+    return hash_fnv1a(0x84222325cbf29ce4ull, (const uint8_t *)key.data(), key.size());
+}
+
+// 区切り文字を含む値でも別のキーと一致しないよう、長さを付けて追加する
+static void keyAppend(std::string& key, const char *name, const std::string& value) {
+    key += strsprintf("%s %llu\n", name, (unsigned long long)value.size());
+    key += value;
+    key += "\n";
+}
+
+static void keyAppend(std::string& key, const char *name, const std::vector<std::string>& values) {
+    key += strsprintf("%s[%llu]\n", name, (unsigned long long)values.size());
+    for (const auto& value : values) {
+        keyAppend(key, name, value);
+    }
+}
+
+std::string RGYNVRTCCache::programKey(const std::vector<std::string>& options, const std::vector<std::string>& includePaths, const std::map<std::string, std::string>& sources) {
+    std::string key;
+    keyAppend(key, "program option", options);
+    keyAppend(key, "include path", includePaths);
+    for (const auto& source : sources) {
+        keyAppend(key, "source", source.first);
+        keyAppend(key, "content", source.second);
+    }
+    return key;
+}
+
+std::string RGYNVRTCCache::kernelKey(int nvrtcMajor, int nvrtcMinor, const std::string& instantiation, const std::vector<std::string>& options, const std::string& programKey) {
+    std::string key = strsprintf("nvrtc %d.%d\n", nvrtcMajor, nvrtcMinor);
+    keyAppend(key, "instantiation", instantiation);
+    keyAppend(key, "option", options);
+    key += programKey;
+    return key;
+}
+
+RGYNVRTCCache::RGYNVRTCCache() :
+    m_dir(),
+    m_maxSize(0),
+    m_mtx(),
+    m_hits(0),
+    m_misses(0) {
+}
+
+RGYNVRTCCache::~RGYNVRTCCache() {
+}
+
+RGY_ERR RGYNVRTCCache::init(const tstring& dir, int64_t maxSize) {
+    if (dir.length() == 0) {
+        return RGY_ERR_INVALID_PARAM;
+    }
+    m_dir = dir;
+    m_maxSize = maxSize;
+    if (!rgy_directory_exists(m_dir) && !CreateDirectoryRecursive(m_dir.c_str())) {
+        return RGY_ERR_FILE_OPEN;
+    }
+    return RGY_ERR_NONE;
+}
+
+tstring RGYNVRTCCache::path(uint64_t hash) const {
+    return PathCombineS(m_dir, strsprintf(_T("%016llx"), (unsigned long long)hash) + RGY_NVRTC_CACHE_EXT);
+}
+
+RGY_ERR RGYNVRTCCache::load(const std::string& key, std::string& ptx, std::string& mangledName) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    const auto cachePath = path(keyHashName(key));
+    RGYNVRTCCacheHeader header = { 0 };
+    {
+        FILE *fp = nullptr;
+        if (_tfopen_s(&fp, cachePath.c_str(), _T("rb")) != 0 || fp == nullptr) {
+            m_misses++;
+            return RGY_ERR_NOT_FOUND;
+        }
+        std::unique_ptr<FILE, fp_deleter> fpCache(fp);
+        bool valid = fread(&header, sizeof(header), 1, fpCache.get()) == 1
+            && memcmp(header.magic, RGY_NVRTC_CACHE_MAGIC, sizeof(header.magic)) == 0
+            && header.version == RGY_NVRTC_CACHE_VERSION
+            && header.keySize == key.size()
+            && header.keyHash == keyHashCheck(key)
+            && header.mangledSize < RGY_NVRTC_CACHE_MAX_ENTRY_SIZE
+            && header.ptxSize < RGY_NVRTC_CACHE_MAX_ENTRY_SIZE;
+        if (valid) {
+            mangledName.resize((size_t)header.mangledSize);
+            ptx.resize((size_t)header.ptxSize);
+            valid = (header.mangledSize == 0 || fread(&mangledName[0], 1, mangledName.size(), fpCache.get()) == mangledName.size())
+                && (header.ptxSize == 0 || fread(&ptx[0], 1, ptx.size(), fpCache.get()) == ptx.size());
+        }
+        if (!valid) {
+            ptx.clear();
+            mangledName.clear();
+            m_misses++;
+            return RGY_ERR_NOT_FOUND;
+        }
+    }
+    // 最後に使用した時刻として更新時刻を使う
+    std::error_code ec;
+    std::filesystem::last_write_time(std::filesystem::path(cachePath), std::filesystem::file_time_type::clock::now(), ec);
+    m_hits++;
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYNVRTCCache::store(const std::string& key, const std::string& ptx, const std::string& mangledName) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (!rgy_directory_exists(m_dir)) {
+        CreateDirectoryRecursive(m_dir.c_str());
+    }
+    RGYNVRTCCacheHeader header = { 0 };
+    memcpy(header.magic, RGY_NVRTC_CACHE_MAGIC, sizeof(header.magic));
+    header.version = RGY_NVRTC_CACHE_VERSION;
+    header.keySize = key.size();
+    header.keyHash = keyHashCheck(key);
+    header.mangledSize = mangledName.size();
+    header.ptxSize = ptx.size();
+
+    // 同時に起動したほかのプロセスが書きかけのファイルを読まないよう、一時ファイルに書いてから置き換える
+    const auto cachePath = path(keyHashName(key));
+    const tstring tmpPath = cachePath + strsprintf(_T(".%u"), GetCurrentProcessId()) + RGY_NVRTC_CACHE_TMP_EXT;
+    {
+        FILE *fp = nullptr;
+        if (_tfopen_s(&fp, tmpPath.c_str(), _T("wb")) != 0 || fp == nullptr) {
+            return RGY_ERR_FILE_OPEN;
+        }
+        std::unique_ptr<FILE, fp_deleter> fpCache(fp);
+        if (fwrite(&header, sizeof(header), 1, fpCache.get()) != 1
+            || fwrite(mangledName.data(), 1, mangledName.size(), fpCache.get()) != mangledName.size()
+            || fwrite(ptx.data(), 1, ptx.size(), fpCache.get()) != ptx.size()
+            || fflush(fpCache.get()) != 0) {
+            fpCache.reset();
+            rgy_file_remove(tmpPath.c_str());
+            return RGY_ERR_UNDEFINED_BEHAVIOR;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(std::filesystem::path(tmpPath), std::filesystem::path(cachePath), ec);
+    if (ec) {
+        rgy_file_remove(tmpPath.c_str());
+        return RGY_ERR_UNDEFINED_BEHAVIOR;
+    }
+    evict();
+    return RGY_ERR_NONE;
+}
+
+void RGYNVRTCCache::evict() {
+    struct CacheEntry {
+        std::filesystem::path path;
+        uint64_t size;
+        std::filesystem::file_time_type time;
+    };
+    std::vector<CacheEntry> entries;
+    uint64_t totalSize = 0;
+    const auto now = std::filesystem::file_time_type::clock::now();
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(m_dir), ec)) {
+        std::error_code ecEntry;
+        if (!entry.is_regular_file(ecEntry)) {
+            continue;
+        }
+        const auto ext = entry.path().extension();
+        const auto size = entry.file_size(ecEntry);
+        const auto time = entry.last_write_time(ecEntry);
+        if (ecEntry) {
+            continue; // ほかのプロセスが削除した
+        }
+        if (ext == std::filesystem::path(RGY_NVRTC_CACHE_EXT)) {
+            entries.push_back({ entry.path(), (uint64_t)size, time });
+            totalSize += size;
+        } else if (ext == std::filesystem::path(RGY_NVRTC_CACHE_TMP_EXT) && now - time > RGY_NVRTC_CACHE_TMP_EXPIRE) {
+            std::filesystem::remove(entry.path(), ecEntry);
+        }
+    }
+    if (totalSize <= (uint64_t)m_maxSize) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b) { return a.time < b.time; });
+    for (const auto& entry : entries) {
+        if (totalSize <= (uint64_t)m_maxSize) {
+            break;
+        }
+        std::error_code ecRemove;
+        if (std::filesystem::remove(entry.path, ecRemove)) {
+            totalSize -= entry.size;
+        }
+    }
+}
+
+static std::unique_ptr<RGYNVRTCCache> g_nvrtcCache;
+
+RGY_ERR initNVRTCCacheGlobal(const tstring& dir, int64_t maxSize) {
+    auto cache = std::make_unique<RGYNVRTCCache>();
+    auto err = cache->init(dir, maxSize);
+    if (err != RGY_ERR_NONE) {
+        return err;
+    }
+    g_nvrtcCache = std::move(cache);
+    return RGY_ERR_NONE;
+}
+
+RGYNVRTCCache *getNVRTCCacheGlobal() {
+    return g_nvrtcCache.get();
+}
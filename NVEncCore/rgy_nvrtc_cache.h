@@ -0,0 +1,83 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#pragma once
+#ifndef __RGY_NVRTC_CACHE_H__
+#define __RGY_NVRTC_CACHE_H__
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "rgy_tchar.h"
+#include "rgy_err.h"
+
+static const int RGY_NVRTC_CACHE_SIZE_MB_DEFAULT = 256;
+
+// NVRTCでコンパイルしたPTXをディレクトリに保存し、次回以降の起動時のコンパイルを省略するためのキャッシュ
+// キーにはコンパイル結果に影響するもの (ソース, ヘッダ, コンパイルオプション, NVRTCのバージョンなど) をすべて含めた文字列を渡し、
+// そのハッシュをファイル名とする
+// 別プロセスから同時に使用されてもよいよう、書き込みは一時ファイルに書いてから置き換え、
+// 合計サイズが上限を超えたら最後に使用した時刻の古いものから削除する
+class RGYNVRTCCache {
+public:
+    RGYNVRTCCache();
+    ~RGYNVRTCCache();
+
+    RGY_ERR init(const tstring& dir, int64_t maxSize);
+    const tstring& dir() const { return m_dir; }
+
+    // キャッシュから読み込む (見つからなければRGY_ERR_NOT_FOUND)
+    RGY_ERR load(const std::string& key, std::string& ptx, std::string& mangledName);
+    RGY_ERR store(const std::string& key, const std::string& ptx, const std::string& mangledName);
+
+    // キーのうちプログラム単位の部分 (コンパイルオプション, インクルードパス, ソースとヘッダ)
+    static std::string programKey(const std::vector<std::string>& options, const std::vector<std::string>& includePaths, const std::map<std::string, std::string>& sources);
+    // カーネル単位のキー (NVRTCのバージョン, インスタンス化するカーネル, コンパイルオプション) にprogramKeyを加えたもの
+    static std::string kernelKey(int nvrtcMajor, int nvrtcMinor, const std::string& instantiation, const std::vector<std::string>& options, const std::string& programKey);
+
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+protected:
+    tstring path(uint64_t hash) const;
+    // 合計サイズが上限を超えていたら古いものから削除する
+    void evict();
+
+    tstring m_dir;
+    int64_t m_maxSize;
+    std::mutex m_mtx;
+    uint64_t m_hits;
+    uint64_t m_misses;
+};
+
+// --nvrtc-cacheで指定されたキャッシュ (指定がなければnullptr)
+RGY_ERR initNVRTCCacheGlobal(const tstring& dir, int64_t maxSize);
+RGYNVRTCCache *getNVRTCCacheGlobal();
+
+#endif //__RGY_NVRTC_CACHE_H__
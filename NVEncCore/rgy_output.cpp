@@ -90,7 +90,9 @@ RGYOutput::RGYOutput() :
     m_readBuffer(),
     m_UVBuffer(),
     m_bsf(),
-    m_parse_nal_hevc(get_parse_nal_unit_hevc_func()) {
+    m_nalScannerHEVC(RGY_CODEC_HEVC),
+    m_nalList(),
+    m_obuList() {
 }
 
 RGYOutput::~RGYOutput() {
@@ -358,13 +360,19 @@ RGY_ERR RGYOutput::OverwriteHEVCAlphaChannelInfoSEI(RGYBitstream *bitstream) {
     if (m_VideoOutputInfo.codec != RGY_CODEC_HEVC || !m_enableHEVCAlphaChannelInfoSEIOverwrite) {
         return RGY_ERR_NONE;
     }
-    RGYBitstream bsCopy = RGYBitstreamInit();
-    bsCopy.copy(bitstream);
-    const auto nal_list = m_parse_nal_hevc(bsCopy.data(), bsCopy.size());
-    const bool has_prefix_sei = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.nuh_layer_id == 0 && info.type == NALU_HEVC_PREFIX_SEI; }) != nal_list.end();
+    // 置き換え対象のSEIがなければ、コピーせずにそのまま返す
+    bool has_prefix_sei = false;
+    m_nalScannerHEVC.scan(bitstream->data(), bitstream->size(), [&has_prefix_sei](const nal_info& nal) {
+        has_prefix_sei = nal.nuh_layer_id == 0 && nal.type == NALU_HEVC_PREFIX_SEI;
+        return !has_prefix_sei;
+    });
     if (!has_prefix_sei) {
         return RGY_ERR_NONE;
     }
+    RGYBitstream bsCopy = RGYBitstreamInit();
+    bsCopy.copy(bitstream);
+    m_nalScannerHEVC.scan(bsCopy.data(), bsCopy.size(), m_nalList);
+    const auto& nal_list = m_nalList;
 
     bitstream->setSize(0);
     bitstream->setOffset(0);
@@ -380,8 +388,8 @@ RGY_ERR RGYOutput::OverwriteHEVCAlphaChannelInfoSEI(RGYBitstream *bitstream) {
             }
             nal_header_size += 2;
             ptr += nal_header_size;
-            const auto sei_data = unnal(ptr, nal.size - nal_header_size);
-            const auto sei_type = sei_data[0];
+            // payloadTypeの先頭バイトはエミュレーション防止バイトの対象とならないので、unnalせずにそのまま参照する
+            const auto sei_type = (nal.size > (size_t)nal_header_size) ? ptr[0] : 0;
             if (sei_type == ALPHA_CHANNEL_INFO) { // alpha_channel_information
                 const auto nalbuf = gen_hevc_alpha_channel_info_sei(m_HEVCAlphaChannelMode);
                 bitstream->append(nalbuf.data(), nalbuf.size());
@@ -402,7 +410,8 @@ RGY_ERR RGYOutput::InsertMetadata(RGYBitstream *bitstream, std::vector<std::uniq
     if (m_VideoOutputInfo.codec == RGY_CODEC_HEVC) {
         RGYBitstream bsCopy = RGYBitstreamInit();
         bsCopy.copy(bitstream);
-        const auto nal_list = m_parse_nal_hevc(bsCopy.data(), bsCopy.size());
+        m_nalScannerHEVC.scan(bsCopy.data(), bsCopy.size(), m_nalList);
+        const auto& nal_list = m_nalList;
         const auto hevc_vps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_VPS; });
         const auto hevc_sps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_SPS; });
         const auto hevc_pps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_PPS; });
@@ -453,12 +462,19 @@ RGY_ERR RGYOutput::InsertMetadata(RGYBitstream *bitstream, std::vector<std::uniq
             }
         }
     } else if (m_VideoOutputInfo.codec == RGY_CODEC_AV1) {
-        const auto av1_units = parse_unit_av1(bitstream->data(), bitstream->size());
+        RGYBitstream bsCopy = RGYBitstreamInit();
+        bsCopy.copy(bitstream);
+        m_obuList.clear();
+        scan_unit_av1(bsCopy.data(), bsCopy.size(), [this](const obu_info& info) {
+            m_obuList.push_back(info);
+            return true;
+        });
+        const auto& av1_units = m_obuList;
         bitstream->setSize(0);
         bitstream->setOffset(0);
 
-        const auto has_seq_header = std::find_if(av1_units.begin(), av1_units.end(), [](const std::unique_ptr<unit_info>& info) { return info->type == OBU_SEQUENCE_HEADER; }) != av1_units.end();
-        const auto has_td = std::find_if(av1_units.begin(), av1_units.end(), [](const std::unique_ptr<unit_info>& info) { return info->type == OBU_TEMPORAL_DELIMITER; }) != av1_units.end();
+        const auto has_seq_header = std::find_if(av1_units.begin(), av1_units.end(), [](const obu_info& info) { return info.type == OBU_SEQUENCE_HEADER; }) != av1_units.end();
+        const auto has_td = std::find_if(av1_units.begin(), av1_units.end(), [](const obu_info& info) { return info.type == OBU_TEMPORAL_DELIMITER; }) != av1_units.end();
 
         // onSequenceHeader = trueの場合、ヘッダーがない場合は、written=trueにして書き込まないようにする
         for (auto& metadata : metadataList) {
@@ -479,7 +495,7 @@ RGY_ERR RGYOutput::InsertMetadata(RGYBitstream *bitstream, std::vector<std::uniq
         //最後のFRAME/FRAME_HEADER OBUの位置
         int lastFrameIdx = -1;
         for (int i = (int)av1_units.size()-1; i >= 0; i--) {
-            if (av1_units[i]->type == OBU_FRAME || av1_units[i]->type == OBU_FRAME_HEADER) {
+            if (av1_units[i].type == OBU_FRAME || av1_units[i].type == OBU_FRAME_HEADER) {
                 lastFrameIdx = i;
                 break;
             }
@@ -494,10 +510,10 @@ RGY_ERR RGYOutput::InsertMetadata(RGYBitstream *bitstream, std::vector<std::uniq
                     }
                 }
             }
-            bitstream->append(av1_units[i]->unit_data.data(), av1_units[i]->unit_data.size());
-            if (av1_units[i]->type == OBU_TEMPORAL_DELIMITER || av1_units[i]->type == OBU_SEQUENCE_HEADER) {
+            bitstream->append(av1_units[i].ptr, av1_units[i].size);
+            if (av1_units[i].type == OBU_TEMPORAL_DELIMITER || av1_units[i].type == OBU_SEQUENCE_HEADER) {
                 if (i + 1 < (int)av1_units.size()
-                    && (av1_units[i + 1]->type != OBU_TEMPORAL_DELIMITER && av1_units[i + 1]->type != OBU_SEQUENCE_HEADER)) {
+                    && (av1_units[i + 1].type != OBU_TEMPORAL_DELIMITER && av1_units[i + 1].type != OBU_SEQUENCE_HEADER)) {
                     for (auto& metadata : metadataList) {
                         if (!metadata->written && metadata->pos == RGYOutputInsertMetadataPosition::Prefix) {
                             bitstream->append(metadata->mdata.data(), metadata->mdata.size());
@@ -513,6 +529,7 @@ RGY_ERR RGYOutput::InsertMetadata(RGYBitstream *bitstream, std::vector<std::uniq
                 metadata->written = true;
             }
         }
+        bsCopy.clear();
         for (auto& metadata : metadataList) {
             if (!metadata->written) {
                 AddMessage(RGY_LOG_ERROR, _T("metadata not written, unexpected AV1 frame.\n"));
@@ -533,8 +550,8 @@ RGYOutputBSF::RGYOutputBSF(AVBSFContext *bsf, RGY_CODEC codec, tstring strWriter
     m_bsfc(std::unique_ptr<AVBSFContext, RGYAVDeleter<AVBSFContext>>(bsf, RGYAVDeleter<AVBSFContext>(av_bsf_free))),
     m_pkt(std::unique_ptr<AVPacket, RGYAVDeleter<AVPacket>>(av_packet_alloc(), RGYAVDeleter<AVPacket>(av_packet_free))),
     m_bsfBuffer(codec),
-    m_parse_nal_h264(get_parse_nal_unit_h264_func()),
-    m_parse_nal_hevc(get_parse_nal_unit_hevc_func()) {
+    m_nalScanner(codec),
+    m_nalList() {
 
 }
 
@@ -544,9 +561,9 @@ RGY_ERR RGYOutputBSF::applyBitstreamFilter(RGYBitstream *bitstream) {
     if (m_codec == RGY_CODEC_H264 || m_codec == RGY_CODEC_HEVC) {
         int target_nal_start = -1;
         int target_nal_end = -1;
-        std::vector<nal_info> nal_list;
+        m_nalScanner.scan(bitstream->data(), bitstream->size(), m_nalList);
+        const auto& nal_list = m_nalList;
         if (m_codec == RGY_CODEC_HEVC) {
-            nal_list = m_parse_nal_hevc(bitstream->data(), bitstream->size());
             for (int i = 0; i < (int)nal_list.size(); i++) {
                 if (nal_list[i].type == NALU_HEVC_VPS || nal_list[i].type == NALU_HEVC_SPS || nal_list[i].type == NALU_HEVC_PPS) {
                     if (target_nal_start < 0) target_nal_start = i;
@@ -556,7 +573,6 @@ RGY_ERR RGYOutputBSF::applyBitstreamFilter(RGYBitstream *bitstream) {
                 }
             }
         } else if (m_codec == RGY_CODEC_H264) {
-            nal_list = m_parse_nal_h264(bitstream->data(), bitstream->size());
             for (int i = 0; i < (int)nal_list.size(); i++) {
                 if (nal_list[i].type == NALU_H264_SPS || nal_list[i].type == NALU_H264_PPS) {
                     if (target_nal_start < 0) target_nal_start = i;
@@ -657,7 +673,11 @@ RGYOutputRaw::RGYOutputRaw() :
     m_debugDirectAV1Out(false),
     m_extPERaw(false),
     m_qFirstProcessData(nullptr),
-    m_qFirstProcessDataFree(nullptr) {
+    m_qFirstProcessDataFree(nullptr),
+    m_qFirstProcessDataFreeLarge(nullptr),
+    m_peSendData(nullptr),
+    m_bufSizeMB(0),
+    m_asyncWriter() {
     m_strWriterName = _T("bitstream");
     m_OutType = OUT_TYPE_BITSTREAM;
 }
@@ -670,6 +690,22 @@ RGYOutputRaw::~RGYOutputRaw() {
     if (m_fpDebug) {
         m_fpDebug.reset();
     }
+    m_asyncWriter.reset();
+}
+
+void RGYOutputRaw::Close() {
+    if (m_asyncWriter) {
+        AddMessage(RGY_LOG_DEBUG, _T("Closing async writer...\n"));
+        const auto err = m_asyncWriter->close();
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("Error writing file: %s.\n"), get_err_mes(err));
+        } else {
+            AddMessage(RGY_LOG_DEBUG, _T("Closed async writer: write latency avg %.3f ms, max %.3f ms.\n"),
+                m_asyncWriter->latencyAvgUs() / 1000.0, m_asyncWriter->latencyMaxUs() / 1000.0);
+        }
+        m_asyncWriter.reset();
+    }
+    RGYOutput::Close();
 }
 
 #pragma warning (push)
@@ -692,27 +728,23 @@ RGY_ERR RGYOutputRaw::Init(const TCHAR *strFileName, const VideoInfo *pVideoOutp
             m_fDest.reset(stdout);
             m_outputIsStdout = true;
             AddMessage(RGY_LOG_DEBUG, _T("using stdout\n"));
-        } else {
+        } else if (rawPrm->asyncDepth > 0) {
             CreateDirectoryRecursive(PathRemoveFileSpecFixed(strFileName).second.c_str());
-            FILE *fp = NULL;
-            int error = _tfopen_s(&fp, strFileName, _T("wb+"));
-            if (error != 0 || fp == NULL) {
-                AddMessage(RGY_LOG_ERROR, _T("failed to open output file \"%s\": %s\n"), strFileName, _tcserror(error));
-                return RGY_ERR_FILE_OPEN;
-            }
-            m_fDest.reset(fp);
-            AddMessage(RGY_LOG_DEBUG, _T("Opened file \"%s\"\n"), strFileName);
-
-            int bufferSizeByte = clamp(rawPrm->bufSizeMB, 0, RGY_OUTPUT_BUF_MB_MAX) * 1024 * 1024;
-            if (bufferSizeByte) {
-                void *ptr = nullptr;
-                bufferSizeByte = (int)malloc_degeneracy(&ptr, bufferSizeByte, 1024 * 1024);
-                if (bufferSizeByte) {
-                    m_outputBuffer.reset((char*)ptr);
-                    setvbuf(m_fDest.get(), m_outputBuffer.get(), _IOFBF, bufferSizeByte);
-                    AddMessage(RGY_LOG_DEBUG, _T("Added %d MB output buffer.\n"), bufferSizeByte / (1024 * 1024));
-                }
+            //出力バッファを書き込み中にできるブロック数で分割し、ブロック単位で非同期に書き込む
+            const size_t blockSize = std::max<size_t>((size_t)clamp(rawPrm->bufSizeMB, 0, RGY_OUTPUT_BUF_MB_MAX) * 1024 * 1024 / rawPrm->asyncDepth,
+                                                      (size_t)RGY_OUTPUT_ASYNC_BLOCK_MB_MIN * 1024 * 1024);
+            m_asyncWriter = std::make_unique<RGYAsyncWriter>();
+            auto err = m_asyncWriter->open(strFileName, rawPrm->asyncDepth, blockSize, rawPrm->queueInfo);
+            if (err != RGY_ERR_NONE) {
+                AddMessage(RGY_LOG_ERROR, _T("failed to open output file \"%s\": %s\n"), strFileName, get_err_mes(err));
+                m_asyncWriter.reset();
+                return err;
             }
+            AddMessage(RGY_LOG_DEBUG, _T("Opened file \"%s\" with async writer: %s%s, %d x %d KB.\n"), strFileName,
+                get_async_writer_type_str(m_asyncWriter->type()), (m_asyncWriter->directIO()) ? _T(" (direct io)") : _T(""),
+                rawPrm->asyncDepth, (int)(blockSize / 1024));
+        } else if (auto sts = OpenFile(strFileName, rawPrm->bufSizeMB); sts != RGY_ERR_NONE) {
+            return sts;
         }
 
         if (auto sts = InitVideoBsf(pVideoOutputInfo); sts != RGY_ERR_NONE) {
@@ -734,6 +766,8 @@ RGY_ERR RGYOutputRaw::Init(const TCHAR *strFileName, const VideoInfo *pVideoOutp
         m_qFirstProcessData = rawPrm->qFirstProcessData;
         m_qFirstProcessDataFree = rawPrm->qFirstProcessDataFree;
         m_qFirstProcessDataFreeLarge = rawPrm->qFirstProcessDataFreeLarge;
+        m_peSendData = rawPrm->peSendData;
+        m_bufSizeMB = rawPrm->bufSizeMB;
         m_hdr10plusMetadataCopy = rawPrm->hdr10plusMetadataCopy;
         m_hdr10plus = rawPrm->hdr10plus;
         m_doviProfileDst = rawPrm->doviProfile;
@@ -794,16 +828,21 @@ RGY_ERR RGYOutputRaw::WriteNextFrame(RGYBitstream *pBitstream) {
     writeRawDebug(pBitstream);
 
     if (m_VideoOutputInfo.codec == RGY_CODEC_AV1) {
-        const auto av1_units = parse_unit_av1(pBitstream->data(), pBitstream->size());
-        const auto td_count = std::count_if(av1_units.begin(), av1_units.end(), [](const std::unique_ptr<unit_info>& info) { return info->type == OBU_TEMPORAL_DELIMITER; });
+        // 複数のTEMPORAL_DELIMITERを含むかを確認する (2つ目が見つかった時点で打ち切る)
+        int td_count = 0;
+        scan_unit_av1(pBitstream->data(), pBitstream->size(), [&td_count](const obu_info& info) {
+            if (info.type == OBU_TEMPORAL_DELIMITER) td_count++;
+            return td_count <= 1;
+        });
         if (td_count > 1) {
             RGYBitstream bsCopy = RGYBitstreamInit();
-            for (int i = 0; i < (int)av1_units.size(); i++) {
-                if (av1_units[i]->type == OBU_TEMPORAL_DELIMITER && bsCopy.size() > 0) {
+            scan_unit_av1(pBitstream->data(), pBitstream->size(), [&](const obu_info& info) {
+                if (info.type == OBU_TEMPORAL_DELIMITER && bsCopy.size() > 0) {
                     WriteNextOneFrame(&bsCopy);
                 }
-                bsCopy.append(av1_units[i]->unit_data.data(), av1_units[i]->unit_data.size());
-            }
+                bsCopy.append(info.ptr, info.size);
+                return true;
+            });
             if (bsCopy.size() > 0) {
                 return WriteNextOneFrame(&bsCopy);
             }
@@ -813,6 +852,43 @@ RGY_ERR RGYOutputRaw::WriteNextFrame(RGYBitstream *pBitstream) {
     return WriteNextOneFrame(pBitstream);
 }
 
+RGY_ERR RGYOutputRaw::OpenFile(const TCHAR *strFileName, int bufSizeMB) {
+    CreateDirectoryRecursive(PathRemoveFileSpecFixed(strFileName).second.c_str());
+    FILE *fp = NULL;
+    int error = _tfopen_s(&fp, strFileName, _T("wb+"));
+    if (error != 0 || fp == NULL) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to open output file \"%s\": %s\n"), strFileName, _tcserror(error));
+        return RGY_ERR_FILE_OPEN;
+    }
+    m_fDest.reset(fp);
+    AddMessage(RGY_LOG_DEBUG, _T("Opened file \"%s\"\n"), strFileName);
+
+    int bufferSizeByte = clamp(bufSizeMB, 0, RGY_OUTPUT_BUF_MB_MAX) * 1024 * 1024;
+    if (bufferSizeByte) {
+        void *ptr = nullptr;
+        bufferSizeByte = (int)malloc_degeneracy(&ptr, bufferSizeByte, 1024 * 1024);
+        if (bufferSizeByte) {
+            m_outputBuffer.reset((char*)ptr);
+            setvbuf(m_fDest.get(), m_outputBuffer.get(), _IOFBF, bufferSizeByte);
+            AddMessage(RGY_LOG_DEBUG, _T("Added %d MB output buffer.\n"), bufferSizeByte / (1024 * 1024));
+        }
+    }
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYOutputRaw::WriteData(const void *data, size_t size) {
+    if (m_asyncWriter) {
+        auto err = m_asyncWriter->write(data, size);
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("Error writing file: %s.\n"), get_err_mes(err));
+        }
+        return err;
+    }
+    const auto writtenBytes = _fwrite_nolock(data, 1, size, m_fDest.get());
+    WRITE_CHECK(writtenBytes, size);
+    return RGY_ERR_NONE;
+}
+
 RGY_ERR RGYOutputRaw::WriteNextOneFrame(RGYBitstream *pBitstream) {
     if (m_noOutput) {
         return RGY_ERR_NONE;
@@ -881,6 +957,7 @@ RGY_ERR RGYOutputRaw::WriteNextOneFrame(RGYBitstream *pBitstream) {
     }
 
     size_t nBytesWritten = 0;
+    bool sendToQueue = m_qFirstProcessData != nullptr;
     if (m_qFirstProcessData || m_extPERaw) {
         RGYOutputRawPEExtHeader peHeader;
         peHeader.pts = pBitstream->pts();
@@ -892,7 +969,22 @@ RGY_ERR RGYOutputRaw::WriteNextOneFrame(RGYBitstream *pBitstream) {
         peHeader.encodeFrameIdx = bs_framedata.encodeFrameId;
         peHeader.flags = pBitstream->dataflag();
         peHeader.size = pBitstream->size();
-        if (m_qFirstProcessData) { // 並列エンコード用のキューが指定されている場合は、ファイル出力せず、キューにデータを渡す
+        if (sendToQueue && m_peSendData) {
+            // メモリ使用量が上限を超える場合は、以降のデータを一時ファイルに出力する
+            const auto dest = m_peSendData->reservePacket(sizeof(peHeader) + pBitstream->size());
+            if (dest == RGYParallelEncPacketDest::Abort) {
+                return RGY_ERR_ABORTED;
+            } else if (dest == RGYParallelEncPacketDest::File) {
+                sendToQueue = false;
+                if (!m_fDest) {
+                    AddMessage(RGY_LOG_DEBUG, _T("memory limit for parallel encoding reached, switching to file output.\n"));
+                    if (auto sts = OpenFile(m_outFilename.c_str(), m_bufSizeMB); sts != RGY_ERR_NONE) {
+                        return sts;
+                    }
+                }
+            }
+        }
+        if (sendToQueue) { // 並列エンコード用のキューが指定されている場合は、ファイル出力せず、キューにデータを渡す
             RGYOutputRawPEExtHeader *ptr = nullptr;
             //空きポインタを保持するキューから取得
             RGYQueueMPMP<RGYOutputRawPEExtHeader*> *freeQueue = (sizeof(peHeader) + pBitstream->size() <= RGY_PE_EXT_HEADER_DATA_NORMAL_BUF_SIZE) ? m_qFirstProcessDataFree : m_qFirstProcessDataFreeLarge;
@@ -916,15 +1008,15 @@ RGY_ERR RGYOutputRaw::WriteNextOneFrame(RGYBitstream *pBitstream) {
             ptr->allocSize = allocSize; // allocsizeはpeHeaderで上書きされているので、ここで再設定
             m_qFirstProcessData->push(ptr);
             nBytesWritten += pBitstream->size();
-        } else {
-            auto ret = _fwrite_nolock(&peHeader, 1, sizeof(peHeader), m_fDest.get());
-            WRITE_CHECK(ret, sizeof(peHeader));
+        } else if (auto sts = WriteData(&peHeader, sizeof(peHeader)); sts != RGY_ERR_NONE) {
+            return sts;
         }
     }
-    if (!m_qFirstProcessData) {
-        const auto dataSize = _fwrite_nolock(pBitstream->data(), 1, pBitstream->size(), m_fDest.get());
-        WRITE_CHECK(dataSize, pBitstream->size());
-        nBytesWritten += dataSize;
+    if (!sendToQueue) {
+        if (auto sts = WriteData(pBitstream->data(), pBitstream->size()); sts != RGY_ERR_NONE) {
+            return sts;
+        }
+        nBytesWritten += pBitstream->size();
     }
 
     m_encSatusInfo->SetOutputData(pBitstream->frametype(), nBytesWritten, 0);
@@ -1243,6 +1335,7 @@ RGY_ERR initWriters(
     RGYPoolAVFrame *poolFrame,
     shared_ptr<EncodeStatus> pStatus,
     shared_ptr<CPerfMonitor> pPerfMonitor,
+    RGYTrace *trace,
     shared_ptr<RGYLog> log
 ) {
     bool stdoutUsed = false;
@@ -1301,6 +1394,7 @@ RGY_ERR initWriters(
         writerPrm.audioResampler          = common->audioResampler;
         writerPrm.audioIgnoreDecodeError  = common->audioIgnoreDecodeError;
         writerPrm.queueInfo = (pPerfMonitor) ? pPerfMonitor->GetQueueInfoPtr() : nullptr;
+        writerPrm.trace                   = trace;
         writerPrm.muxVidTsLogFile         = ctrl->logMuxVidTs.getFilename(common->outputFilename, _T(".muxts.log"));
         writerPrm.bitstreamTimebase       = av_make_q(outputTimebase);
         writerPrm.chapterNoTrim           = common->chapterNoTrim;
@@ -1619,6 +1713,8 @@ RGY_ERR initWriters(
             pFileWriter = std::make_shared<RGYOutputRaw>();
             RGYOutputRawPrm rawPrm;
             rawPrm.bufSizeMB = ctrl->outputBufSizeMB;
+            rawPrm.asyncDepth = ctrl->outputAsyncDepth;
+            rawPrm.queueInfo = (pPerfMonitor) ? pPerfMonitor->GetQueueInfoPtr() : nullptr;
             rawPrm.benchmark = benchmark;
             rawPrm.codecId = outputVideoInfo.codec;
             rawPrm.hdrMetadataIn = hdrMetadataIn;
@@ -1635,6 +1731,7 @@ RGY_ERR initWriters(
             rawPrm.qFirstProcessData = (ctrl->parallelEnc.sendData) ? ctrl->parallelEnc.sendData->qFirstProcessData : nullptr;
             rawPrm.qFirstProcessDataFree = (ctrl->parallelEnc.sendData) ? ctrl->parallelEnc.sendData->qFirstProcessDataFree : nullptr;
             rawPrm.qFirstProcessDataFreeLarge = (ctrl->parallelEnc.sendData) ? ctrl->parallelEnc.sendData->qFirstProcessDataFreeLarge : nullptr;
+            rawPrm.peSendData = ctrl->parallelEnc.sendData;
             rawPrm.extPERaw = ctrl->parallelEnc.isChild();
             rawPrm.debugRawOut = common->debugRawOut;
             rawPrm.outReplayFile = common->outReplayFile;
@@ -33,6 +33,7 @@
 #include <vector>
 #include <unordered_map>
 #include <mutex>
+#include <limits>
 #include "rgy_osdep.h"
 #include "rgy_tchar.h"
 #include "rgy_log.h"
@@ -40,6 +41,8 @@
 #include "rgy_avutil.h"
 #include "rgy_bitstream.h"
 #include "rgy_input.h"
+#include "rgy_output_async.h"
+#include "rgy_timestamp.h"
 #if ENCODER_NVENC
 #include "NVEncUtil.h"
 #include "NVEncParam.h"
@@ -60,106 +63,6 @@ enum OutputType {
     OUT_TYPE_SURFACE
 };
 
-struct RGYTimestampMapVal {
-    int64_t timestamp, inputFrameId, encodeFrameId, duration;
-    std::vector<std::shared_ptr<RGYFrameData>> dataList;
-
-    RGYTimestampMapVal() : timestamp(-1), inputFrameId(-1), encodeFrameId(-1), duration(-1), dataList() {};
-    RGYTimestampMapVal(int64_t timestamp_, int64_t inputFrameId_, int64_t encodeFrameId_, int64_t duration_, std::vector<std::shared_ptr<RGYFrameData>>& datalist)
-        : timestamp(timestamp_), inputFrameId(inputFrameId_), encodeFrameId(encodeFrameId_), duration(duration_), dataList(datalist) {};
-    void addMetadata(std::shared_ptr<RGYFrameData>& data) { dataList.push_back(data); }
-    void addMetadata(std::vector<std::shared_ptr<RGYFrameData>>& list) { dataList.insert(dataList.end(), list.begin(), list.end()); }
-};
-
-class RGYTimestamp {
-private:
-    std::unordered_map<int64_t, RGYTimestampMapVal> m_frame;
-    std::mutex mtx;
-    int64_t last_add_pts;
-    int64_t last_check_pts;
-    int64_t last_input_frame_id;
-    int64_t offset;
-    int64_t last_clean_id;
-    bool timestampPassThrough;
-    bool noDurationFix; // durationの修正を行わない場合にtrue
-public:
-    RGYTimestamp(bool timestampPassThrough_, bool noDurationFix_) : m_frame(), mtx(), last_add_pts(-1), last_check_pts(-1), offset(0), last_clean_id(-1), timestampPassThrough(timestampPassThrough_), noDurationFix(noDurationFix_) {};
-    ~RGYTimestamp() {};
-    void clear() {
-        std::lock_guard<std::mutex> lock(mtx);
-        m_frame.clear();
-        last_check_pts = -1;
-        offset = 0;
-    }
-    void add(int64_t pts, int64_t inputFrameId, int64_t encodeFrameId, int64_t duration, std::vector<std::shared_ptr<RGYFrameData>> metadatalist) {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (last_add_pts >= 0) { // 前のフレームのdurationの更新
-            auto& last_add_pos = m_frame.find(last_add_pts)->second;
-            if (!noDurationFix) last_add_pos.duration = pts - last_add_pos.timestamp;
-            if (duration == 0) duration = last_add_pos.duration;
-        }
-        m_frame[pts] = RGYTimestampMapVal(pts, inputFrameId, encodeFrameId, duration, metadatalist);
-        last_add_pts = pts;
-    }
-    RGYTimestampMapVal check(int64_t pts) {
-        if (last_check_pts < 0 && pts > 0 && !timestampPassThrough) {
-            offset = -pts;
-        }
-        std::lock_guard<std::mutex> lock(mtx);
-        pts += offset;
-        auto pos = m_frame.find(pts);
-        if (pos == m_frame.end()) {
-            auto& last_check_pos = m_frame.find(last_check_pts)->second;
-            pts = last_check_pos.timestamp + last_check_pos.duration / 2;
-            auto next_pts = last_check_pos.timestamp + last_check_pos.duration;
-            last_check_pos.duration = pts - last_check_pos.timestamp;
-            m_frame[pts] = RGYTimestampMapVal(pts, last_input_frame_id, last_check_pos.encodeFrameId, next_pts - pts, last_check_pos.dataList);
-            pos = m_frame.find(pts);
-        }
-        last_input_frame_id = pos->second.inputFrameId;
-        last_check_pts = pos->second.timestamp;
-        return pos->second;
-    }
-    void clean(const int64_t current_id) {
-        if (current_id >= last_clean_id + 64) {
-            for (auto it = m_frame.begin(); it != m_frame.end();) {
-                if (it->second.inputFrameId < current_id - 64) {
-                    it = m_frame.erase(it);
-                } else {
-                    it++;
-                }
-            }
-            last_clean_id = current_id;
-        }
-    }
-    RGYTimestampMapVal getByEncodeFrameID(const int64_t id) {
-        std::lock_guard<std::mutex> lock(mtx);
-        auto pos = m_frame.end();
-        for (auto it = m_frame.begin(); it != m_frame.end(); it++) {
-            if (it->second.encodeFrameId == id) {
-                pos = it;
-                break;
-            }
-        }
-        if (pos == m_frame.end()) {
-            return RGYTimestampMapVal();
-        }
-        auto ret = pos->second;
-        clean(ret.inputFrameId);
-        return ret;
-    }
-    RGYTimestampMapVal get(int64_t pts) {
-        std::lock_guard<std::mutex> lock(mtx);
-        auto pos = m_frame.find(pts);
-        if (pos == m_frame.end()) {
-            return RGYTimestampMapVal();
-        }
-        auto ret = pos->second;
-        clean(ret.inputFrameId);
-        return ret;
-    }
-};
-
 class RGYDurationCheck {
 private:
     std::array<int64_t, 64> m_ts;
@@ -239,8 +142,8 @@ protected:
     std::unique_ptr<AVBSFContext, RGYAVDeleter<AVBSFContext>> m_bsfc;
     std::unique_ptr<AVPacket, RGYAVDeleter<AVPacket>> m_pkt;
     std::vector<uint8_t> m_bsfBuffer;
-    decltype(parse_nal_unit_h264_c) *m_parse_nal_h264; // H.264用のnal unit分解関数へのポインタ
-    decltype(parse_nal_unit_hevc_c) *m_parse_nal_hevc; // HEVC用のnal unit分解関数へのポインタ
+    RGYNalScanner m_nalScanner;       // nal unit分解用
+    std::vector<nal_info> m_nalList;  // nal unit分解結果 (毎フレームのメモリ確保を避けるため再利用する)
 };
 
 enum class RGYOutputInsertMetadataPosition {
@@ -382,10 +285,13 @@ protected:
     std::unique_ptr<uint8_t, aligned_malloc_deleter> m_readBuffer;
     std::unique_ptr<uint8_t, aligned_malloc_deleter> m_UVBuffer;
     std::unique_ptr<RGYOutputBSF> m_bsf;
-    decltype(parse_nal_unit_hevc_c) *m_parse_nal_hevc; // HEVC用のnal unit分解関数へのポインタ
+    RGYNalScanner m_nalScannerHEVC;   // HEVC用のnal unit分解用
+    std::vector<nal_info> m_nalList;  // nal unit分解結果 (毎フレームのメモリ確保を避けるため再利用する)
+    std::vector<obu_info> m_obuList;  // OBU分解結果 (毎フレームのメモリ確保を避けるため再利用する)
 };
 
 struct RGYOutputRawPEExtHeader;
+struct RGYParallelEncSendData;
 
 struct RGYOutputRawPrm {
     bool benchmark;
@@ -397,6 +303,8 @@ struct RGYOutputRawPrm {
     tstring outReplayFile;
     RGY_CODEC outReplayCodec;
     int bufSizeMB;
+    int asyncDepth;               //非同期出力で同時に書き込み中にできるブロック数 (0で無効)
+    PerfQueueInfo *queueInfo;     //非同期出力の情報をperf monitorに渡すための構造体
     RGY_CODEC codecId;
     const RGYHDRMetadata *hdrMetadataIn;
     RGYHDR10Plus *hdr10plus;
@@ -409,6 +317,7 @@ struct RGYOutputRawPrm {
     RGYQueueMPMP<RGYOutputRawPEExtHeader*> *qFirstProcessData;
     RGYQueueMPMP<RGYOutputRawPEExtHeader*> *qFirstProcessDataFree;
     RGYQueueMPMP<RGYOutputRawPEExtHeader*> *qFirstProcessDataFreeLarge;
+    RGYParallelEncSendData *peSendData; //キューで渡すか一時ファイルに出力するかの判定用
 };
 
 class RGYOutputRaw : public RGYOutput {
@@ -419,9 +328,12 @@ public:
 
     virtual RGY_ERR WriteNextFrame(RGYBitstream *pBitstream) override;
     virtual RGY_ERR WriteNextFrame(RGYFrame *pSurface) override;
+    virtual void Close() override;
 protected:
     virtual RGY_ERR Init(const TCHAR *strFileName, const VideoInfo *pOutputInfo, const void *prm) override;
     virtual RGY_ERR WriteNextOneFrame(RGYBitstream *pBitstream);
+    RGY_ERR OpenFile(const TCHAR *strFileName, int bufSizeMB);
+    RGY_ERR WriteData(const void *data, size_t size);
 
     vector<uint8_t> m_outputBuf2;
     vector<uint8_t> m_hdrBitstream;
@@ -439,6 +351,9 @@ protected:
     RGYQueueMPMP<RGYOutputRawPEExtHeader*> *m_qFirstProcessData;
     RGYQueueMPMP<RGYOutputRawPEExtHeader*> *m_qFirstProcessDataFree;
     RGYQueueMPMP<RGYOutputRawPEExtHeader*> *m_qFirstProcessDataFreeLarge;
+    RGYParallelEncSendData *m_peSendData;
+    int m_bufSizeMB;
+    std::unique_ptr<RGYAsyncWriter> m_asyncWriter; //非同期出力 (使用しない場合はm_fDestに書き込む)
 };
 
 std::unique_ptr<RGYHDRMetadata> createHEVCHDRSei(const std::string &maxCll, const std::string &masterDisplay, CspTransfer atcSei, const RGYInput *reader);
@@ -469,6 +384,7 @@ RGY_ERR initWriters(
     RGYPoolAVFrame *poolFrame,
     shared_ptr<EncodeStatus> pStatus,
     shared_ptr<CPerfMonitor> pPerfMonitor,
+    RGYTrace *trace,
     shared_ptr<RGYLog> log
 );
 
@@ -0,0 +1,563 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
+#include "rgy_output_async.h"
+#include "rgy_osdep.h"
+#include "rgy_util.h"
+#include "rgy_perf_monitor.h"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ENABLE_IO_URING 1
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#else
+#define ENABLE_IO_URING 0
+#endif
+
+// O_DIRECTで書き込む場合のアラインメント
+static const size_t RGY_ASYNC_WRITER_ALIGN = 4096;
+
+const TCHAR *get_async_writer_type_str(RGYAsyncWriterType type) {
+    switch (type) {
+    case RGYAsyncWriterType::IOURing: return _T("io_uring");
+    case RGYAsyncWriterType::Thread:  return _T("thread");
+    default:                          return _T("none");
+    }
+}
+
+static int64_t async_writer_time_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class RGYAsyncWriterBackend {
+public:
+    RGYAsyncWriterBackend() {};
+    virtual ~RGYAsyncWriterBackend() {};
+    // ブロックの書き込みを開始する
+    virtual RGY_ERR submit(RGYAsyncWriterBlock *block) = 0;
+    // 書き込みの完了したブロックを取得する
+    // waitがtrueの場合、書き込み中のブロックがあれば1つ以上完了するまで待機する
+    virtual RGY_ERR reap(std::vector<RGYAsyncWriterBlock *>& completed, bool wait) = 0;
+    // ファイルサイズをfileSizeに合わせて、ファイルを閉じる
+    virtual RGY_ERR finish(uint64_t fileSize) = 0;
+};
+
+#if ENABLE_IO_URING
+// io_uringによる書き込み
+// liburingには依存せず、システムコールを直接呼び出す
+class RGYAsyncWriterIOURing : public RGYAsyncWriterBackend {
+public:
+    RGYAsyncWriterIOURing() :
+        m_fd(-1), m_ring(-1),
+        m_sqPtr(nullptr), m_sqSize(0), m_cqPtr(nullptr), m_cqSize(0), m_sqes(nullptr), m_sqesSize(0),
+        m_sqTail(nullptr), m_sqMask(nullptr), m_sqArray(nullptr),
+        m_cqHead(nullptr), m_cqTail(nullptr), m_cqMask(nullptr), m_cqes(nullptr),
+        m_inFlight(0) {};
+    virtual ~RGYAsyncWriterIOURing() {
+        release();
+    }
+    RGY_ERR init(const TCHAR *filename, int queueDepth, bool *directIO) {
+        // オフセット指定での書き込み、O_DIRECT、最後のftruncateは通常のファイルでしか使えないので、
+        // パイプやデバイス(/dev/nullなど)はスレッドでの書き込みにまかせる
+        // (FIFOはopenの時点で読み込み側を待ってしまうので、openする前に確認する)
+        struct stat st;
+        if (stat(filename, &st) == 0 && !S_ISREG(st.st_mode)) {
+            return RGY_ERR_UNSUPPORTED;
+        }
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        m_ring = (int)syscall(__NR_io_uring_setup, queueDepth, &params);
+        if (m_ring < 0) {
+            return RGY_ERR_UNSUPPORTED; // カーネルが対応していない、あるいはseccomp等で制限されている
+        }
+        m_sqSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        m_cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMmap) {
+            m_sqSize = m_cqSize = std::max(m_sqSize, m_cqSize);
+        }
+        m_sqPtr = mmap(nullptr, m_sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQ_RING);
+        if (m_sqPtr == MAP_FAILED) {
+            m_sqPtr = nullptr;
+            return RGY_ERR_UNSUPPORTED;
+        }
+        if (singleMmap) {
+            m_cqPtr = m_sqPtr;
+        } else {
+            m_cqPtr = mmap(nullptr, m_cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_CQ_RING);
+            if (m_cqPtr == MAP_FAILED) {
+                m_cqPtr = nullptr;
+                return RGY_ERR_UNSUPPORTED;
+            }
+        }
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return RGY_ERR_UNSUPPORTED;
+        }
+        m_sqes = (io_uring_sqe *)sqes;
+        uint8_t *sq = (uint8_t *)m_sqPtr;
+        uint8_t *cq = (uint8_t *)m_cqPtr;
+        m_sqTail  = (uint32_t *)(sq + params.sq_off.tail);
+        m_sqMask  = (uint32_t *)(sq + params.sq_off.ring_mask);
+        m_sqArray = (uint32_t *)(sq + params.sq_off.array);
+        m_cqHead  = (uint32_t *)(cq + params.cq_off.head);
+        m_cqTail  = (uint32_t *)(cq + params.cq_off.tail);
+        m_cqMask  = (uint32_t *)(cq + params.cq_off.ring_mask);
+        m_cqes    = (io_uring_cqe *)(cq + params.cq_off.cqes);
+
+        // IORING_OP_WRITE (Linux 5.6～) に対応しているか確認する
+        std::vector<uint8_t> probeBuf(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+        auto probe = (io_uring_probe *)probeBuf.data();
+        if (syscall(__NR_io_uring_register, m_ring, IORING_REGISTER_PROBE, probe, 256) < 0
+            || probe->last_op < IORING_OP_WRITE
+            || (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED) == 0) {
+            return RGY_ERR_UNSUPPORTED;
+        }
+
+        // ページキャッシュを経由しないよう、可能ならO_DIRECTで開く
+        m_fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0666);
+        *directIO = m_fd >= 0;
+        if (m_fd < 0 && errno == EINVAL) { // tmpfsなどO_DIRECTに対応していないファイルシステム
+            m_fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        }
+        if (m_fd < 0) {
+            return RGY_ERR_FILE_OPEN;
+        }
+        // stat後に差し替えられた場合に備え、開いたものも確認する
+        if (fstat(m_fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(m_fd);
+            m_fd = -1;
+            return RGY_ERR_UNSUPPORTED;
+        }
+        return RGY_ERR_NONE;
+    }
+    virtual RGY_ERR submit(RGYAsyncWriterBlock *block) override {
+        const uint32_t tail = *m_sqTail;
+        const uint32_t idx = tail & *m_sqMask;
+        io_uring_sqe *sqe = &m_sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = m_fd;
+        sqe->addr = (uint64_t)(uintptr_t)block->ptr;
+        sqe->len = (uint32_t)block->size;
+        sqe->off = block->offset;
+        sqe->user_data = (uint64_t)(uintptr_t)block;
+        m_sqArray[idx] = idx;
+        __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+        for (;;) {
+            const auto ret = syscall(__NR_io_uring_enter, m_ring, 1, 0, 0, nullptr, 0);
+            if (ret >= 0) break;
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return RGY_ERR_UNDEFINED_BEHAVIOR;
+            }
+        }
+        m_inFlight++;
+        return RGY_ERR_NONE;
+    }
+    virtual RGY_ERR reap(std::vector<RGYAsyncWriterBlock *>& completed, bool wait) override {
+        RGY_ERR err = RGY_ERR_NONE;
+        for (;;) {
+            uint32_t head = *m_cqHead;
+            const uint32_t tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++) {
+                const io_uring_cqe *cqe = &m_cqes[head & *m_cqMask];
+                auto block = (RGYAsyncWriterBlock *)(uintptr_t)cqe->user_data;
+                if (cqe->res < 0) {
+                    err = RGY_ERR_UNDEFINED_BEHAVIOR;
+                } else if ((size_t)cqe->res < block->size) {
+                    // 書き込みきれなかった部分は同期的に書き込む
+                    if (!writeRemaining(block, (size_t)cqe->res)) {
+                        err = RGY_ERR_UNDEFINED_BEHAVIOR;
+                    }
+                }
+                m_inFlight--;
+                completed.push_back(block);
+            }
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+            if (!wait || completed.size() > 0 || m_inFlight == 0) {
+                break;
+            }
+            if (syscall(__NR_io_uring_enter, m_ring, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0
+                && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                return RGY_ERR_UNDEFINED_BEHAVIOR;
+            }
+        }
+        return err;
+    }
+    virtual RGY_ERR finish(uint64_t fileSize) override {
+        RGY_ERR err = RGY_ERR_NONE;
+        if (m_fd >= 0) {
+            // O_DIRECTの場合は末尾をアラインメントに合わせて書き込んでいるので、本来のサイズに戻す
+            if (ftruncate(m_fd, (off_t)fileSize) != 0) {
+                err = RGY_ERR_UNDEFINED_BEHAVIOR;
+            }
+        }
+        release();
+        return err;
+    }
+protected:
+    bool writeRemaining(const RGYAsyncWriterBlock *block, size_t written) {
+        // O_DIRECTの制約を避けるため、アラインメントを気にしなくてよいfdで書き込む
+        const int fd = open(("/proc/self/fd/" + std::to_string(m_fd)).c_str(), O_WRONLY);
+        if (fd < 0) {
+            return false;
+        }
+        bool ret = true;
+        while (written < block->size) {
+            const auto n = pwrite(fd, block->ptr + written, block->size - written, (off_t)(block->offset + written));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                ret = false;
+                break;
+            }
+            written += (size_t)n;
+        }
+        ::close(fd);
+        return ret;
+    }
+    void release() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            m_fd = -1;
+        }
+        if (m_sqes) {
+            munmap(m_sqes, m_sqesSize);
+            m_sqes = nullptr;
+        }
+        if (m_cqPtr && m_cqPtr != m_sqPtr) {
+            munmap(m_cqPtr, m_cqSize);
+        }
+        m_cqPtr = nullptr;
+        if (m_sqPtr) {
+            munmap(m_sqPtr, m_sqSize);
+            m_sqPtr = nullptr;
+        }
+        if (m_ring >= 0) {
+            ::close(m_ring);
+            m_ring = -1;
+        }
+    }
+
+    int m_fd;
+    int m_ring;
+    void *m_sqPtr;
+    size_t m_sqSize;
+    void *m_cqPtr;
+    size_t m_cqSize;
+    io_uring_sqe *m_sqes;
+    size_t m_sqesSize;
+    uint32_t *m_sqTail;
+    uint32_t *m_sqMask;
+    uint32_t *m_sqArray;
+    uint32_t *m_cqHead;
+    uint32_t *m_cqTail;
+    uint32_t *m_cqMask;
+    io_uring_cqe *m_cqes;
+    int m_inFlight;
+};
+#endif //#if ENABLE_IO_URING
+
+// io_uringが使用できない場合の、書き込みスレッドによる書き込み
+// ブロックは投入された順に書き込む
+class RGYAsyncWriterThread : public RGYAsyncWriterBackend {
+public:
+    RGYAsyncWriterThread() : m_fp(), m_thread(), m_mtx(), m_cvSubmit(), m_cvDone(), m_queue(), m_done(), m_abort(false), m_err(RGY_ERR_NONE), m_inFlight(0) {};
+    virtual ~RGYAsyncWriterThread() {
+        stop();
+    }
+    RGY_ERR init(const TCHAR *filename) {
+        FILE *fp = nullptr;
+        if (_tfopen_s(&fp, filename, _T("wb")) != 0 || fp == nullptr) {
+            return RGY_ERR_FILE_OPEN;
+        }
+        m_fp.reset(fp);
+        m_thread = std::thread(&RGYAsyncWriterThread::run, this);
+        return RGY_ERR_NONE;
+    }
+    virtual RGY_ERR submit(RGYAsyncWriterBlock *block) override {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_queue.push_back(block);
+            m_inFlight++;
+        }
+        m_cvSubmit.notify_one();
+        return RGY_ERR_NONE;
+    }
+    virtual RGY_ERR reap(std::vector<RGYAsyncWriterBlock *>& completed, bool wait) override {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        if (wait) {
+            m_cvDone.wait(lock, [this]() { return m_done.size() > 0 || m_inFlight == 0; });
+        }
+        m_inFlight -= (int)m_done.size();
+        completed.insert(completed.end(), m_done.begin(), m_done.end());
+        m_done.clear();
+        return m_err;
+    }
+    virtual RGY_ERR finish(uint64_t fileSize) override {
+        UNREFERENCED_PARAMETER(fileSize);
+        stop();
+        RGY_ERR err = m_err;
+        if (m_fp) {
+            if (fflush(m_fp.get()) != 0) {
+                err = RGY_ERR_UNDEFINED_BEHAVIOR;
+            }
+            m_fp.reset();
+        }
+        return err;
+    }
+protected:
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        for (;;) {
+            m_cvSubmit.wait(lock, [this]() { return m_queue.size() > 0 || m_abort; });
+            if (m_queue.size() == 0) {
+                break;
+            }
+            auto block = m_queue.front();
+            m_queue.pop_front();
+            lock.unlock();
+            const auto written = _fwrite_nolock(block->ptr, 1, block->size, m_fp.get());
+            lock.lock();
+            if (written != block->size) {
+                m_err = RGY_ERR_UNDEFINED_BEHAVIOR;
+            }
+            m_done.push_back(block);
+            m_cvDone.notify_one();
+        }
+    }
+    void stop() {
+        if (m_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                m_abort = true;
+            }
+            m_cvSubmit.notify_one();
+            m_thread.join();
+        }
+    }
+
+    std::unique_ptr<FILE, fp_deleter> m_fp;
+    std::thread m_thread;
+    std::mutex m_mtx;
+    std::condition_variable m_cvSubmit;
+    std::condition_variable m_cvDone;
+    std::deque<RGYAsyncWriterBlock *> m_queue;
+    std::vector<RGYAsyncWriterBlock *> m_done;
+    bool m_abort;
+    RGY_ERR m_err;
+    int m_inFlight;
+};
+
+RGYAsyncWriter::RGYAsyncWriter() :
+    m_backend(),
+    m_type(RGYAsyncWriterType::None),
+    m_directIO(false),
+    m_blockSize(0),
+    m_blocks(),
+    m_freeBlocks(),
+    m_cur(nullptr),
+    m_fileOffset(0),
+    m_bytesInFlight(0),
+    m_completedCount(0),
+    m_latencySumUs(0),
+    m_latencyMaxUs(0),
+    m_queueInfo(nullptr) {
+}
+
+RGYAsyncWriter::~RGYAsyncWriter() {
+    close();
+}
+
+RGY_ERR RGYAsyncWriter::open(const TCHAR *filename, int queueDepth, size_t blockSize, PerfQueueInfo *queueInfo) {
+    close();
+    queueDepth = std::max(queueDepth, 1);
+    m_blockSize = ALIGN(std::max(blockSize, RGY_ASYNC_WRITER_ALIGN), RGY_ASYNC_WRITER_ALIGN);
+    m_queueInfo = queueInfo;
+
+#if ENABLE_IO_URING
+    {
+        auto backend = std::make_unique<RGYAsyncWriterIOURing>();
+        bool directIO = false;
+        if (backend->init(filename, queueDepth, &directIO) == RGY_ERR_NONE) {
+            m_backend = std::move(backend);
+            m_type = RGYAsyncWriterType::IOURing;
+            m_directIO = directIO;
+        }
+    }
+#endif //#if ENABLE_IO_URING
+    if (!m_backend) {
+        auto backend = std::make_unique<RGYAsyncWriterThread>();
+        auto err = backend->init(filename);
+        if (err != RGY_ERR_NONE) {
+            return err;
+        }
+        m_backend = std::move(backend);
+        m_type = RGYAsyncWriterType::Thread;
+        m_directIO = false;
+    }
+
+    // 書き込み中のブロック + データをためるブロック
+    m_blocks.resize(queueDepth + 1);
+    for (auto& block : m_blocks) {
+        memset(&block, 0, sizeof(block));
+        block.ptr = (uint8_t *)_aligned_malloc(m_blockSize, RGY_ASYNC_WRITER_ALIGN);
+        if (block.ptr == nullptr) {
+            close();
+            return RGY_ERR_NULL_PTR;
+        }
+        m_freeBlocks.push_back(&block);
+    }
+    return RGY_ERR_NONE;
+}
+
+void RGYAsyncWriter::onCompleted(RGYAsyncWriterBlock *block) {
+    const auto latency = async_writer_time_us() - block->submitted;
+    m_bytesInFlight -= block->size;
+    m_completedCount++;
+    m_latencySumUs += latency;
+    m_latencyMaxUs = std::max(m_latencyMaxUs, latency);
+    if (m_queueInfo) {
+        m_queueInfo->out_bytes_in_flight = (size_t)m_bytesInFlight;
+        m_queueInfo->out_write_latency_us = (size_t)latency;
+    }
+    block->size = 0;
+    m_freeBlocks.push_back(block);
+}
+
+RGY_ERR RGYAsyncWriter::waitCompleted(bool wait) {
+    std::vector<RGYAsyncWriterBlock *> completed;
+    auto err = m_backend->reap(completed, wait);
+    for (auto block : completed) {
+        onCompleted(block);
+    }
+    return err;
+}
+
+RGY_ERR RGYAsyncWriter::submitCurrentBlock() {
+    auto block = m_cur;
+    m_cur = nullptr;
+    block->offset = m_fileOffset;
+    block->submitted = async_writer_time_us();
+    m_fileOffset += block->size;
+    m_bytesInFlight += block->size;
+    if (m_queueInfo) {
+        m_queueInfo->out_bytes_in_flight = (size_t)m_bytesInFlight;
+    }
+    return m_backend->submit(block);
+}
+
+RGY_ERR RGYAsyncWriter::write(const void *data, size_t size) {
+    if (!m_backend) {
+        return RGY_ERR_NOT_INITIALIZED;
+    }
+    auto src = (const uint8_t *)data;
+    while (size > 0) {
+        if (m_cur == nullptr) {
+            // 書き込みの完了したブロックを回収し、空きがなければ完了を待つ
+            auto err = waitCompleted(m_freeBlocks.size() == 0);
+            if (err != RGY_ERR_NONE) {
+                return err;
+            }
+            m_cur = m_freeBlocks.back();
+            m_freeBlocks.pop_back();
+        }
+        const auto copySize = std::min(size, m_blockSize - m_cur->size);
+        memcpy(m_cur->ptr + m_cur->size, src, copySize);
+        m_cur->size += copySize;
+        src += copySize;
+        size -= copySize;
+        if (m_cur->size == m_blockSize) {
+            auto err = submitCurrentBlock();
+            if (err != RGY_ERR_NONE) {
+                return err;
+            }
+        }
+    }
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYAsyncWriter::close() {
+    RGY_ERR err = RGY_ERR_NONE;
+    if (m_backend) {
+        uint64_t fileSize = m_fileOffset;
+        if (m_cur && m_cur->size > 0) {
+            fileSize += m_cur->size;
+            if (m_directIO) {
+                // O_DIRECTではアラインメントに合わせたサイズで書き込む必要があるので、0埋めしておき最後にtruncateする
+                const auto alignedSize = ALIGN(m_cur->size, RGY_ASYNC_WRITER_ALIGN);
+                memset(m_cur->ptr + m_cur->size, 0, alignedSize - m_cur->size);
+                m_cur->size = alignedSize;
+            }
+            err = submitCurrentBlock();
+        } else if (m_cur) {
+            m_freeBlocks.push_back(m_cur);
+            m_cur = nullptr;
+        }
+        // 書き込み中のブロックがなくなるまで待つ
+        while (m_freeBlocks.size() < m_blocks.size()) {
+            const auto freeCount = m_freeBlocks.size();
+            auto sts = waitCompleted(true);
+            if (sts != RGY_ERR_NONE && err == RGY_ERR_NONE) {
+                err = sts;
+            }
+            if (m_freeBlocks.size() == freeCount) {
+                break;
+            }
+        }
+        auto sts = m_backend->finish(fileSize);
+        if (err == RGY_ERR_NONE) {
+            err = sts;
+        }
+        m_backend.reset();
+    }
+    for (auto& block : m_blocks) {
+        if (block.ptr) {
+            _aligned_free(block.ptr);
+        }
+    }
+    m_blocks.clear();
+    m_freeBlocks.clear();
+    m_cur = nullptr;
+    m_fileOffset = 0;
+    m_bytesInFlight = 0;
+    m_type = RGYAsyncWriterType::None;
+    m_directIO = false;
+    return err;
+}
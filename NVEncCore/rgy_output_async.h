@@ -0,0 +1,101 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_OUTPUT_ASYNC_H__
+#define __RGY_OUTPUT_ASYNC_H__
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "rgy_tchar.h"
+#include "rgy_err.h"
+
+struct PerfQueueInfo;
+class RGYAsyncWriterBackend;
+
+enum class RGYAsyncWriterType {
+    None,
+    IOURing, // io_uring (Linux)
+    Thread,  // 書き込みスレッド
+};
+
+const TCHAR *get_async_writer_type_str(RGYAsyncWriterType type);
+
+// 非同期書き込み用のブロック
+struct RGYAsyncWriterBlock {
+    uint8_t *ptr;      // 書き込みデータ (RGY_ASYNC_WRITER_ALIGN にアラインされている)
+    size_t size;       // 書き込むデータのサイズ
+    uint64_t offset;   // ファイル上の書き込み位置
+    int64_t submitted; // 書き込み開始時刻 (us)
+};
+
+// ファイル出力を書き込みスレッドをブロックせずに行うためのクラス
+// 書き込みデータは固定サイズのブロックにまとめ、一定数のブロックを同時に書き込み中にできる
+// ブロックはプールから再利用し、書き込み中のブロックが上限に達したときのみ完了を待つ
+class RGYAsyncWriter {
+public:
+    RGYAsyncWriter();
+    ~RGYAsyncWriter();
+
+    // queueDepth: 同時に書き込み中にできるブロック数
+    // blockSize : 1ブロックのサイズ (RGY_ASYNC_WRITER_ALIGN の倍数に切り上げる)
+    RGY_ERR open(const TCHAR *filename, int queueDepth, size_t blockSize, PerfQueueInfo *queueInfo);
+    RGY_ERR write(const void *data, size_t size);
+    // 残りのデータを書き出して、すべての書き込みの完了を待ってからファイルを閉じる
+    RGY_ERR close();
+
+    bool is_open() const { return m_backend != nullptr; }
+    RGYAsyncWriterType type() const { return m_type; }
+    bool directIO() const { return m_directIO; }
+    // 書き込み中のデータ量
+    uint64_t bytesInFlight() const { return m_bytesInFlight; }
+    // 書き込みの平均/最大レイテンシ (us)
+    int64_t latencyAvgUs() const { return (m_completedCount > 0) ? m_latencySumUs / m_completedCount : 0; }
+    int64_t latencyMaxUs() const { return m_latencyMaxUs; }
+protected:
+    RGY_ERR submitCurrentBlock();
+    RGY_ERR waitCompleted(bool wait);
+    void onCompleted(RGYAsyncWriterBlock *block);
+
+    std::unique_ptr<RGYAsyncWriterBackend> m_backend;
+    RGYAsyncWriterType m_type;
+    bool m_directIO;
+    size_t m_blockSize;
+    std::vector<RGYAsyncWriterBlock> m_blocks;    // 確保したブロック
+    std::vector<RGYAsyncWriterBlock*> m_freeBlocks; // 再利用可能なブロック
+    RGYAsyncWriterBlock *m_cur;                   // 書き込みデータをためているブロック
+    uint64_t m_fileOffset;                        // 次に書き込むブロックのファイル上の位置
+    std::atomic<uint64_t> m_bytesInFlight;
+    int64_t m_completedCount;
+    int64_t m_latencySumUs;
+    int64_t m_latencyMaxUs;
+    PerfQueueInfo *m_queueInfo;                   // perf monitorに情報を渡すための構造体
+};
+
+#endif //__RGY_OUTPUT_ASYNC_H__
@@ -30,6 +30,7 @@
 #include <cctype>
 #include <cmath>
 #include <memory>
+#include <map>
 #include <fstream>
 #include <iostream>
 #include "rgy_osdep.h"
@@ -39,6 +40,8 @@
 #include "rgy_avlog.h"
 #include "rgy_bitstream.h"
 #include "rgy_codepage.h"
+#include "rgy_mux_interleaver.h"
+#include "rgy_trace.h"
 
 #define WRITE_PTS_DEBUG (0)
 
@@ -166,7 +169,8 @@ AVMuxVideo::AVMuxVideo() :
     rawVideoConvert(),
     simdCsp(RGY_SIMD::SIMD_ALL),
     parse_nal_h264(get_parse_nal_unit_h264_func()),
-    parse_nal_hevc(get_parse_nal_unit_hevc_func()) {
+    parse_nal_hevc(get_parse_nal_unit_hevc_func()),
+    scanNalH264(RGY_CODEC_H264) {
 }
 
 AVMuxAudio::AVMuxAudio() :
@@ -240,6 +244,7 @@ AVMuxOther::AVMuxOther() :
 
 AVMuxThreadWorker::AVMuxThreadWorker() :
     thread(),
+    serial(),
     thAbort(false),
     sentEOS(false),
     heEventPktAdded(nullptr),
@@ -247,6 +252,10 @@ AVMuxThreadWorker::AVMuxThreadWorker() :
     qPackets() {}
 
 AVMuxThreadWorker::~AVMuxThreadWorker() {
+    if (serial) {
+        serial->wait();
+        serial.reset();
+    }
     if (heEventPktAdded) {
         CloseEvent(heEventPktAdded);
         heEventPktAdded = nullptr;
@@ -258,8 +267,28 @@ AVMuxThreadWorker::~AVMuxThreadWorker() {
     qPackets.close();
 }
 
+bool AVMuxThreadWorker::active() const {
+    return thread.joinable() || serial;
+}
+
+void AVMuxThreadWorker::notify() {
+    if (heEventPktAdded) {
+        SetEvent(heEventPktAdded);
+    }
+    if (serial) {
+        serial->kick();
+    }
+}
+
 void AVMuxThreadWorker::close() {
     thAbort = true;
+    if (serial) {
+        //thAbortを見て残りをすべて処理するよう、もう一度実行させてから終了を待つ
+        serial->kick();
+        serial->wait();
+        serial.reset();
+        qPackets.close();
+    }
     if (thread.joinable()) {
         //ここに来た時に、まだメインスレッドがループ中の可能性がある
         //その場合、SetEvent(thread.heEventPktAddedOutput)を一度やるだけだと、
@@ -296,11 +325,11 @@ void AVMuxThreadAudio::closeProcess() {
 }
 
 bool AVMuxThreadAudio::threadActiveEncode() {
-    return encode.thread.joinable();
+    return encode.active();
 }
 
 bool AVMuxThreadAudio::threadActiveProcess() {
-    return process.thread.joinable();
+    return process.active();
 }
 
 #if ENABLE_AVCODEC_OUT_THREAD
@@ -314,8 +343,15 @@ AVMuxThread::AVMuxThread() :
     qVideobitstreamFreePB(),
     qVideobitstream(),
     thAud(),
+    audioPool(),
     streamOutMaxDts(0),
-    queueInfo(nullptr) {
+    queueInfo(nullptr),
+    trace(nullptr),
+    traceVideo(-1),
+    traceAudio(-1),
+    traceQueue(-1),
+    traceAudProc(-1),
+    traceAudEnc(-1) {
 }
 #endif
 
@@ -494,14 +530,14 @@ void RGYOutputAvcodec::CloseThread() {
 #if ENABLE_AVCODEC_OUT_THREAD
     // process -> encode -> output の順に終了させる
     for (auto& [mux, thread] : m_Mux.thread.thAud) {
-        if (thread->process.thread.joinable()) {
+        if (thread->threadActiveProcess()) {
             thread->closeProcess();
             const auto target = (mux) ? strsprintf(_T("%d.%d"), trackID(mux->inTrackId), mux->inSubStream) : tstring(_T("default"));
             AddMessage(RGY_LOG_DEBUG, _T("closed audio process thread %s.\n"), target.c_str());
         }
     }
     for (auto& [mux, thread] : m_Mux.thread.thAud) {
-        if (thread->encode.thread.joinable()) {
+        if (thread->threadActiveEncode()) {
             thread->closeEncode();
             const auto target = (mux) ? strsprintf(_T("%d.%d"), trackID(mux->inTrackId), mux->inSubStream) : tstring(_T("default"));
             AddMessage(RGY_LOG_DEBUG, _T("closed audio encode thread %s.\n"), target.c_str());
@@ -2454,6 +2490,14 @@ RGY_ERR RGYOutputAvcodec::Init(const TCHAR *strFileName, const VideoInfo *videoO
 #if ENABLE_AVCODEC_OUT_THREAD
     m_Mux.thread.streamOutMaxDts = 0;
     m_Mux.thread.queueInfo = prm->queueInfo;
+    m_Mux.thread.trace = prm->trace;
+    if (m_Mux.thread.trace) {
+        m_Mux.thread.traceVideo   = m_Mux.thread.trace->registerEvent(_T("MUX"), _T("video"));
+        m_Mux.thread.traceAudio   = m_Mux.thread.trace->registerEvent(_T("MUX"), _T("audio"));
+        m_Mux.thread.traceQueue   = m_Mux.thread.trace->registerEvent(_T("MUX"), _T("queue"));
+        m_Mux.thread.traceAudProc = m_Mux.thread.trace->registerEvent(_T("AUDIO"), _T("process"));
+        m_Mux.thread.traceAudEnc  = m_Mux.thread.trace->registerEvent(_T("AUDIO"), _T("encode"));
+    }
     //スレッドの使用数を設定
     if (prm->threadOutput == RGY_OUTPUT_THREAD_AUTO) {
         prm->threadOutput = 1;
@@ -2491,6 +2535,8 @@ RGY_ERR RGYOutputAvcodec::Init(const TCHAR *strFileName, const VideoInfo *videoO
         }
 #if ENABLE_AVCODEC_AUDPROCESS_THREAD
         if (m_Mux.thread.enableAudProcessThread) {
+            //音声処理/音声エンコードは専用のスレッドを持たず、プロセス内で共有するスレッドプール上で実行する
+            m_Mux.thread.audioPool = RGYThreadPool::shared(0, prm->threadParamAudio);
             auto muxAudioPtr = std::vector<const AVMuxAudio*>{ nullptr };
             if (prm->threadAudio > 2) {
                 for (auto& aud : m_Mux.audio) {
@@ -2500,21 +2546,21 @@ RGY_ERR RGYOutputAvcodec::Init(const TCHAR *strFileName, const VideoInfo *videoO
             const auto audioQueueMultiplizer = (prm->threadAudio > 2) ? 2 : std::max(2, (int)m_Mux.audio.size());
             for (auto mux : muxAudioPtr) {
                 const auto target = (mux) ? strsprintf(_T("%d.%d"), trackID(mux->inTrackId), mux->inSubStream) : tstring(_T("default"));
-                AddMessage(RGY_LOG_DEBUG, _T("starting audio process thread %s...\n"), target.c_str());
+                AddMessage(RGY_LOG_DEBUG, _T("starting audio process %s...\n"), target.c_str());
                 m_Mux.thread.thAud[mux] = std::make_unique<AVMuxThreadAudio>();
                 m_Mux.thread.thAud[mux]->process.thAbort = false;
                 m_Mux.thread.thAud[mux]->process.qPackets.init(16384, audioQueueCapacity * audioQueueMultiplizer, 4);
                 m_Mux.thread.thAud[mux]->process.heEventPktAdded = CreateEvent(NULL, TRUE, FALSE, NULL);
                 m_Mux.thread.thAud[mux]->process.heEventClosing = CreateEvent(NULL, TRUE, FALSE, NULL);
-                m_Mux.thread.thAud[mux]->process.thread = std::thread(&RGYOutputAvcodec::ThreadFuncAudThread, this, mux, prm->threadParamAudio);
+                m_Mux.thread.thAud[mux]->process.serial = std::make_unique<RGYThreadPoolSerial>(m_Mux.thread.audioPool, [this, mux]() { ProcessAudQueue(mux); });
                 AddMessage(RGY_LOG_DEBUG, _T("Set audio process thread param %s: %s.\n"), target.c_str(), prm->threadParamAudio.desc().c_str());
                 if (m_Mux.thread.enableAudEncodeThread) {
-                    AddMessage(RGY_LOG_DEBUG, _T("starting audio encode thread %s...\n"), target.c_str());
+                    AddMessage(RGY_LOG_DEBUG, _T("starting audio encode %s...\n"), target.c_str());
                     m_Mux.thread.thAud[mux]->encode.thAbort = false;
                     m_Mux.thread.thAud[mux]->encode.qPackets.init(16384, audioQueueCapacity * audioQueueMultiplizer, 4);
                     m_Mux.thread.thAud[mux]->encode.heEventPktAdded = CreateEvent(NULL, TRUE, FALSE, NULL);
                     m_Mux.thread.thAud[mux]->encode.heEventClosing = CreateEvent(NULL, TRUE, FALSE, NULL);
-                    m_Mux.thread.thAud[mux]->encode.thread = std::thread(&RGYOutputAvcodec::ThreadFuncAudEncodeThread, this, mux, prm->threadParamAudio);
+                    m_Mux.thread.thAud[mux]->encode.serial = std::make_unique<RGYThreadPoolSerial>(m_Mux.thread.audioPool, [this, mux]() { EncodeAudQueue(mux); });
                     AddMessage(RGY_LOG_DEBUG, _T("Set audio encode thread param %s: %s.\n"), target.c_str(), prm->threadParamAudio.desc().c_str());
                 }
             }
@@ -2527,7 +2573,7 @@ RGY_ERR RGYOutputAvcodec::Init(const TCHAR *strFileName, const VideoInfo *videoO
         if (sts != RGY_ERR_NONE) {
             return sts;
         }
-        m_Mux.format.fileHeaderWritten = true;
+        SetFileHeaderWritten();
     }
     m_inited = true;
     return RGY_ERR_NONE;
@@ -2929,7 +2975,7 @@ RGY_ERR RGYOutputAvcodec::VidCheckStreamAVParser(RGYBitstream *pBitstream) {
     RGY_ERR err = RGY_ERR_NONE;
     m_Mux.video.parserStreamPos += pBitstream->size();
     AVPacket *pkt = m_Mux.video.pktParse;
-    av_new_packet(pkt, (int)pBitstream->size());
+    m_Mux.poolPkt->newPacket(pkt, (int)pBitstream->size());
     memcpy(pkt->data, pBitstream->data(), pBitstream->size());
     pkt->size = (int)pBitstream->size();
     pkt->pts = pBitstream->pts();
@@ -2978,10 +3024,24 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrameFinish(RGYBitstream *bitstream, const RG
 #if ENABLE_AVCODEC_OUT_THREAD
     }
 #endif
-    m_Mux.format.fileHeaderWritten = true;
+    SetFileHeaderWritten();
     return (m_Mux.format.streamError) ? RGY_ERR_UNKNOWN : RGY_ERR_NONE;
 }
 
+void RGYOutputAvcodec::SetFileHeaderWritten() {
+    if (m_Mux.format.fileHeaderWritten) {
+        return;
+    }
+    m_Mux.format.fileHeaderWritten = true;
+#if ENABLE_AVCODEC_OUT_THREAD
+    //ヘッダが書かれるまで処理せずに返っているので、改めて実行させる
+    for (auto& [mux, thread] : m_Mux.thread.thAud) {
+        thread->process.notify();
+        thread->encode.notify();
+    }
+#endif //#if ENABLE_AVCODEC_OUT_THREAD
+}
+
 #pragma warning (push)
 #pragma warning (disable: 4127) //warning C4127: 条件式が定数です。
 RGY_ERR RGYOutputAvcodec::WriteNextFrameInternalOneFrame(RGYBitstream *bitstream, int64_t *writtenDts, const RGYTimestampMapVal& bs_framedata) {
@@ -3005,10 +3065,13 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrameInternalOneFrame(RGYBitstream *bitstream
     bool isKey = (bitstream->frametype() & (RGY_FRAMETYPE_IDR | RGY_FRAMETYPE_xIDR | RGY_FRAMETYPE_I | RGY_FRAMETYPE_xI)) != 0; //Keyフレームかどうかのフラグ
     if (m_Mux.video.streamOut->codecpar->field_order != AV_FIELD_PROGRESSIVE) {
         if (m_VideoOutputInfo.codec == RGY_CODEC_H264) {
-            const auto nal_list = m_Mux.video.parse_nal_h264(bitstream->data(), bitstream->size());
             //インタレ保持の際、IDRかどうかのフラグが正しく設定されていないことがある
             //どちらかのフィールドがIDRならIDRのフラグを立てる
-            isIDR = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_H264_IDR; }) != nal_list.end();
+            isIDR = false;
+            m_Mux.video.scanNalH264.scan(bitstream->data(), bitstream->size(), [&isIDR](const nal_info& nal) {
+                isIDR = nal.type == NALU_H264_IDR;
+                return !isIDR;
+            });
             isKey |= isIDR;
         } else if (m_VideoOutputInfo.codec == RGY_CODEC_HEVC) {
             AddMessage(RGY_LOG_ERROR, _T("Interlaced HEVC encoding not supported!\n"));
@@ -3059,7 +3122,7 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrameInternalOneFrame(RGYBitstream *bitstream
     }
 
     AVPacket *pkt = m_Mux.video.pktOut;
-    av_new_packet(pkt, (int)bitstream->size());
+    m_Mux.poolPkt->newPacket(pkt, (int)bitstream->size());
     memcpy(pkt->data, bitstream->data(), bitstream->size());
     pkt->size = (int)bitstream->size();
 
@@ -3183,23 +3246,24 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrameInternal(RGYBitstream *bitstream, int64_
         return RGY_ERR_NULL_PTR;
     }
 
-    // まず、AV1をユニット単位に分割し、その種類を取得する
-    auto new_units = parse_unit_av1(bitstream->data(), bitstream->size());
-    // バッファに連結
-    m_Mux.videoAV1Merge.insert(m_Mux.videoAV1Merge.end(), std::make_move_iterator(new_units.begin()), std::make_move_iterator(new_units.end()));
+    // まず、AV1をユニット単位に解析し、解析できた部分をバッファに連結する
+    const auto valid_size = scan_unit_av1(bitstream->data(), bitstream->size(), [](const obu_info&) { return true; });
+    m_Mux.videoAV1Merge.insert(m_Mux.videoAV1Merge.end(), bitstream->data(), bitstream->data() + valid_size);
     bitstream->setSize(0);
     bitstream->setOffset(0);
 
     for (;;) {
         // 先頭ユニットは、OBU_AV1_TEMPORAL_DELIMITERになるようになっている
         // その次のOBU_AV1_TEMPORAL_DELIMITERが見つかったら、そこまでを一単位として送出する
-        size_t next_delim = 0;
-        for (size_t iunit = 1; iunit < m_Mux.videoAV1Merge.size(); iunit++) {
-            if (m_Mux.videoAV1Merge[iunit]->type == OBU_TEMPORAL_DELIMITER) {
-                next_delim = iunit;
-                break;
+        size_t next_delim = 0; // 次のOBU_AV1_TEMPORAL_DELIMITERの位置
+        const uint8_t *merge_data = m_Mux.videoAV1Merge.data();
+        scan_unit_av1(merge_data, m_Mux.videoAV1Merge.size(), [&next_delim, merge_data](const obu_info& info) {
+            if (info.ptr != merge_data && info.type == OBU_TEMPORAL_DELIMITER) {
+                next_delim = info.ptr - merge_data;
+                return false;
             }
-        }
+            return true;
+        });
         if (next_delim == 0) { // 見つからなかった
             if (flush) { // flushする場合は最後まで
                 next_delim = m_Mux.videoAV1Merge.size();
@@ -3218,11 +3282,8 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrameInternal(RGYBitstream *bitstream, int64_
             m_Mux.video.prevEncodeFrameId++;
         }
 
-        //送出すべきデータサイズを取得
-        size_t data_size = 0;
-        for (size_t iunit = 0; iunit < next_delim; iunit++) {
-            data_size += m_Mux.videoAV1Merge[iunit]->unit_data.size();
-        }
+        //送出すべきデータサイズ
+        const size_t data_size = next_delim;
         //bitstreamを設定
         bitstream->init(data_size);
         bitstream->setSize(data_size);
@@ -3230,16 +3291,9 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrameInternal(RGYBitstream *bitstream, int64_
         bitstream->setDts(bs_framedata.timestamp);
         bitstream->setDuration(bs_framedata.duration);
 
-        size_t copy_size = 0; // コピーしたデータサイズ
-        for (size_t iunit = 0; iunit < next_delim; iunit++) {
-            const auto& unit_data = m_Mux.videoAV1Merge[iunit]->unit_data;
-            memcpy(bitstream->data() + copy_size, unit_data.data(), unit_data.size());
-            copy_size += unit_data.size();
-        }
-        // コピーし終わったユニットを破棄
-        for (size_t iunit = 0; iunit < next_delim; iunit++) {
-            m_Mux.videoAV1Merge.pop_front();
-        }
+        memcpy(bitstream->data(), m_Mux.videoAV1Merge.data(), data_size);
+        // コピーし終わったデータを破棄 (確保済みのメモリは再利用する)
+        m_Mux.videoAV1Merge.erase(m_Mux.videoAV1Merge.begin(), m_Mux.videoAV1Merge.begin() + data_size);
 
         auto err = WriteNextFrameInternalOneFrame(bitstream, writtenDts, bs_framedata);
         if (err != RGY_ERR_NONE) {
@@ -3264,7 +3318,7 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrame(RGYFrame *surface) {
         }
         m_Mux.video.fpsBaseNextDts = 0;
         m_Mux.video.timestampList.clear();
-        m_Mux.format.fileHeaderWritten = true;
+        SetFileHeaderWritten();
     }
 
     const AVRational streamTimebase = m_Mux.video.streamOut->time_base;
@@ -3354,6 +3408,7 @@ RGY_ERR RGYOutputAvcodec::VideoEncodeRawFrame(AVFrame *avframe) {
     if (m_Mux.thread.thOutput) {
         auto pktFrame = pktMuxData(pkt.release());
         m_Mux.thread.qVideoRawFrames.push(pktFrame);
+        SetEvent(m_Mux.thread.thOutput->heEventPktAdded);
     } else {
         return WriteNextPacketRawVideo(pkt.release(), nullptr);
     }
@@ -4095,15 +4150,19 @@ RGY_ERR RGYOutputAvcodec::WriteNextPacket(AVPacket *pkt) {
                     }
                 }
             }
+            //keep_lengthの解除で取り出せるようになったパケットも含め、残りを処理させる
+            for (auto& [mux, thread] : m_Mux.thread.thAud) {
+                thread->process.notify();
+                thread->encode.notify();
+            }
         } else {
             AVMuxThreadWorker *worker = (m_Mux.thread.threadActiveAudioProcess()) ? getPacketWorker(pktData.muxAudio, AUD_QUEUE_PROCESS) : m_Mux.thread.thOutput.get();
             auto& audioQueue = worker->qPackets;
-            auto heEventPktAdd = worker->heEventPktAdded;
             if (!audioQueue.push(pktData)) {
                 AddMessage(RGY_LOG_ERROR, _T("Failed to allocate memory for audio packet queue.\n"));
                 m_Mux.format.streamError = true;
             }
-            SetEvent(heEventPktAdd);
+            worker->notify();
         }
         return (m_Mux.format.streamError) ? RGY_ERR_UNKNOWN : RGY_ERR_NONE;
     }
@@ -4130,13 +4189,16 @@ RGY_ERR RGYOutputAvcodec::AddAudQueue(AVPktMuxData *pktData, int type) {
         AVMuxThreadWorker *worker = getPacketWorker(pktData->muxAudio, type);
 
         //出力キューに追加する
-        auto& qAudio       = worker->qPackets;
-        auto& heEventAdded = worker->heEventPktAdded;
-        if (!qAudio.push(*pktData)) {
+        //音声エンコードはスレッドプール上で実行するので、同じプール上で動く音声処理から
+        //容量の空き待ちをすると、プールのワーカーが埋まっている場合に進まなくなる
+        //音声処理への入力側で容量を制限しているので、ここでは待たずに追加する
+        auto& qAudio = worker->qPackets;
+        const bool pushed = (type == AUD_QUEUE_ENCODE) ? qAudio.push_no_event(*pktData) : qAudio.push(*pktData);
+        if (!pushed) {
             AddMessage(RGY_LOG_ERROR, _T("Failed to allocate memory for audio queue.\n"));
             m_Mux.format.streamError = true;
         }
-        SetEvent(heEventAdded);
+        worker->notify();
         return (m_Mux.format.streamError) ? RGY_ERR_UNKNOWN : RGY_ERR_NONE;
     } else
 #endif //#if ENABLE_AVCODEC_AUDPROCESS_THREAD
@@ -4475,69 +4537,42 @@ RGY_ERR RGYOutputAvcodec::WriteNextAudioFrame(AVPktMuxData *pktData) {
     return (m_Mux.format.streamError) ? RGY_ERR_UNKNOWN : RGY_ERR_NONE;
 }
 
-RGY_ERR RGYOutputAvcodec::ThreadFuncAudEncodeThread(const AVMuxAudio *const muxAudio, RGYParamThread threadParam) {
+//音声エンコードのstrandから呼ばれる
+//キューにたまっている分を処理したら返り、次にデータが追加されたときに再び呼ばれる
+RGY_ERR RGYOutputAvcodec::EncodeAudQueue(const AVMuxAudio *const muxAudio) {
 #if ENABLE_AVCODEC_AUDPROCESS_THREAD
-    threadParam.apply(GetCurrentThread());
     auto worker = getPacketWorker(muxAudio, AUD_QUEUE_ENCODE);
-    WaitForSingleObject(worker->heEventPktAdded, INFINITE);
-    while (!worker->thAbort) {
-        if (!m_Mux.format.fileHeaderWritten) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        } else {
-            AVPktMuxData pktData = { 0 };
-            while (worker->qPackets.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_aud_enc : nullptr)) {
-                //音声エンコードを実行、出力キューに追加する
-                WriteNextAudioFrame(&pktData);
-            }
-        }
-        if (m_Mux.format.lowlatency) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        } else {
-            ResetEvent(worker->heEventPktAdded);
-            WaitForSingleObject(worker->heEventPktAdded, 16);
-        }
+    //ファイルヘッダが書かれるまでは処理しない (書かれた時点で再び呼ばれる)
+    //終了時はヘッダの有無にかかわらず、残りをすべてエンコードする
+    if (!m_Mux.format.fileHeaderWritten && !worker->thAbort) {
+        return RGY_ERR_NONE;
     }
-    {   //音声をすべてエンコード
-        AVPktMuxData pktData = { 0 };
-        while (worker->qPackets.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_aud_enc : nullptr)) {
-            WriteNextAudioFrame(&pktData);
-        }
+    AVPktMuxData pktData = { 0 };
+    while (worker->qPackets.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_aud_enc : nullptr)) {
+        RGYTraceScope traceScope(m_Mux.thread.trace, m_Mux.thread.traceAudEnc);
+        //音声エンコードを実行、出力キューに追加する
+        WriteNextAudioFrame(&pktData);
     }
-    SetEvent(worker->heEventClosing);
 #endif //#if ENABLE_AVCODEC_AUDPROCESS_THREAD
     return (m_Mux.format.streamError) ? RGY_ERR_UNKNOWN : RGY_ERR_NONE;
 }
 
-RGY_ERR RGYOutputAvcodec::ThreadFuncAudThread(const AVMuxAudio *const muxAudio, RGYParamThread threadParam) {
+//音声処理のstrandから呼ばれる
+//キューにたまっている分を処理したら返り、次にデータが追加されたときに再び呼ばれる
+RGY_ERR RGYOutputAvcodec::ProcessAudQueue(const AVMuxAudio *const muxAudio) {
 #if ENABLE_AVCODEC_AUDPROCESS_THREAD
-    threadParam.apply(GetCurrentThread());
     auto worker = getPacketWorker(muxAudio, AUD_QUEUE_PROCESS);
-    WaitForSingleObject(worker->heEventPktAdded, INFINITE);
-    while (!worker->thAbort) {
-        if (!m_Mux.format.fileHeaderWritten) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        } else {
-            AVPktMuxData pktData = { 0 };
-            while (worker->qPackets.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_aud_proc : nullptr)) {
-                //音声処理を実行、出力キューに追加する
-                WriteNextPacketInternal(&pktData, INT64_MAX);
-            }
-        }
-        if (m_Mux.format.lowlatency) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        } else {
-            ResetEvent(worker->heEventPktAdded);
-            WaitForSingleObject(worker->heEventPktAdded, 16);
-        }
+    //ファイルヘッダが書かれるまでは処理しない (書かれた時点で再び呼ばれる)
+    //終了時はヘッダの有無にかかわらず、残りをすべて書き出す
+    if (!m_Mux.format.fileHeaderWritten && !worker->thAbort) {
+        return RGY_ERR_NONE;
     }
-    {   //音声をすべて書き出す
-        AVPktMuxData pktData = { 0 };
-        while (worker->qPackets.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_aud_proc : nullptr)) {
-            //音声処理を実行、出力キューに追加する
-            WriteNextPacketInternal(&pktData, INT64_MAX);
-        }
+    AVPktMuxData pktData = { 0 };
+    while (worker->qPackets.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_aud_proc : nullptr)) {
+        RGYTraceScope traceScope(m_Mux.thread.trace, m_Mux.thread.traceAudProc);
+        //音声処理を実行、出力キューに追加する
+        WriteNextPacketInternal(&pktData, INT64_MAX);
     }
-    SetEvent(worker->heEventClosing);
 #endif //#if ENABLE_AVCODEC_AUDPROCESS_THREAD
     return (m_Mux.format.streamError) ? RGY_ERR_UNKNOWN : RGY_ERR_NONE;
 }
@@ -4557,20 +4592,20 @@ RGY_ERR RGYOutputAvcodec::WriteThreadFuncRawVideo(RGYParamThread threadParam) {
 RGY_ERR RGYOutputAvcodec::WriteThreadFunc(RGYParamThread threadParam) {
 #if ENABLE_AVCODEC_OUT_THREAD
     threadParam.apply(GetCurrentThread());
+    RGYSetCurrentThreadName(RGY_THREAD_NAME_OUTPUT);
+    if (m_Mux.thread.trace) {
+        m_Mux.thread.trace->setThreadName(char_to_tstring(RGY_THREAD_NAME_OUTPUT));
+    }
     //映像と音声の同期をとる際に、それをあきらめるまでの閾値
     const int nWaitThreshold = 32;
-    //キューにデータが存在するか
-    bool bAudioExists = false;
-    bool bVideoExists = false;
     const bool videoIsRaw = m_Mux.format.formatCtx->video_codec_id == AV_CODEC_ID_RAWVIDEO;
+    const bool bThAudProcess = m_Mux.thread.threadActiveAudioProcess();
     const auto fpsTimebase = av_inv_q(m_Mux.video.outputFps);
     const int VideoAudioPickSwitchThresholdFrames = m_Mux.format.lowlatency ? 1 : 2; // 映像-音声の切り替え間隔(フレーム数)
     const auto dtsThreshold = std::max<int64_t>(av_rescale_q(VideoAudioPickSwitchThresholdFrames, fpsTimebase, QUEUE_DTS_TIMEBASE), 4);
     //syncIgnoreDtsは映像と音声の同期を行う必要がないことを意味する
     //dtsThresholdを加算したときにオーバーフローしないよう、dtsThresholdを引いておく
     const int64_t syncIgnoreDts = INT64_MAX - dtsThreshold;
-    int64_t audioDts = (m_Mux.audio.size() + m_Mux.other.size()) ? 0 : syncIgnoreDts;
-    int64_t videoDts = (m_Mux.video.streamOut) ? 0 : syncIgnoreDts;
     auto writeProcessedPacket = [this](AVPktMuxData *pktData) {
         //音声処理スレッドが別にあるなら、出力スレッドがすべきことは単に出力するだけ
         auto sts = RGY_ERR_NONE;
@@ -4585,225 +4620,227 @@ RGY_ERR RGYOutputAvcodec::WriteThreadFunc(RGYParamThread threadParam) {
         }
         return sts;
     };
-    const bool MUX_DEBUG = false;
-    std::unique_ptr<FILE, fp_deleter> fpMuxDebug;
-    if (MUX_DEBUG) {
-        fpMuxDebug = std::unique_ptr<FILE, fp_deleter>(_tfopen(_T("mux_debug.txt"), _T("w")));
-        fprintf(fpMuxDebug.get(), "mux_debug\n");
-        fprintf(fpMuxDebug.get(), "dtsThreshold : %20lld\n", (lls)dtsThreshold);
-        fprintf(fpMuxDebug.get(), "syncIgnoreDts: %20lld\n", (lls)syncIgnoreDts);
-        fprintf(fpMuxDebug.get(), "audioDts     : %20lld\n", (lls)audioDts);
-        fprintf(fpMuxDebug.get(), "videoDts     : %20lld\n", (lls)videoDts);
-        fprintf(fpMuxDebug.get(), "\n");
-    }
-    bool bThAudProcess = false;
+    auto videoQueueSize = [&]() {
+        return (videoIsRaw) ? m_Mux.thread.qVideoRawFrames.size() : m_Mux.thread.qVideobitstream.size();
+    };
+    auto videoQueueCapacity = [&]() {
+        return (videoIsRaw) ? m_Mux.thread.qVideoRawFrames.capacity() : m_Mux.thread.qVideobitstream.capacity();
+    };
+
+    //各ストリームを最後に書き出したdtsの順に並べ、dtsの最も進んでいないストリームから書き出す
+    //映像はそのままqVideobitstream/qVideoRawFramesを、音声・字幕は共通のキューからストリームごとのキューに振り分けたものを使う
+    RGYMuxInterleaver interleaver;
+    interleaver.init(dtsThreshold, nWaitThreshold);
+    const int vidId = (m_Mux.video.streamOut) ? interleaver.addStream(_T("video"), true, 0) : -1;
+    std::vector<std::deque<AVPktMuxData>> qStreams(interleaver.streamCount()); //音声・字幕のストリームごとのキュー (indexはinterleaverのid)
+    std::map<std::pair<const AVMuxAudio *, int>, int> streamIds;
+    auto addStream = [&](const AVMuxAudio *muxAudio, const int trackId, const bool gating) {
+        const auto name = (muxAudio) ? strsprintf(_T("audio#%d.%d"), trackID(muxAudio->inTrackId), muxAudio->inSubStream) : strsprintf(_T("track#%d"), trackID(trackId));
+        const int id = interleaver.addStream(name, gating, 0);
+        qStreams.resize(interleaver.streamCount());
+        streamIds[std::make_pair(muxAudio, trackId)] = id;
+        return id;
+    };
+    for (auto& muxAudio : m_Mux.audio) {
+        //音声処理スレッドがない場合、サブストリームは親のトラックのパケットとして送られてくる
+        if (muxAudio.streamOut && (bThAudProcess || muxAudio.inSubStream == 0)) {
+            addStream(&muxAudio, 0, muxAudio.streamOut->codecpar->codec_type == AVMEDIA_TYPE_AUDIO);
+        }
+    }
+    auto getStreamId = [&](const AVPktMuxData& pktData) {
+        const int trackId = (pktData.muxAudio == nullptr && pktData.pkt) ? pktFlagGetTrackID(pktData.pkt) : 0;
+        auto it = streamIds.find(std::make_pair((const AVMuxAudio *)pktData.muxAudio, trackId));
+        // 字幕やデータストリームに関しては、連続で来るとは限らないので、同期の対象としない
+        return (it != streamIds.end()) ? it->second : addStream(pktData.muxAudio, trackId, false);
+    };
+
+    size_t audioBuffered = 0; //ストリームごとのキューにためている音声・字幕のパケット数
+    size_t audioBufferLimit = m_Mux.thread.thOutput->qPackets.capacity();
     int audPacketsPerSec = 64;
-    int nWaitAudio = 0;
-    int nWaitVideo = 0;
-    while (!m_Mux.thread.thOutput->thAbort) {
-        // 起動遅れの場合がありえるのでここでチェック
-        if (!bThAudProcess && m_Mux.thread.threadActiveAudioProcess()) {
-            bThAudProcess = true;
-        }
-        do {
-            if (!m_Mux.format.fileHeaderWritten) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                //ヘッダー取得前に音声キューのサイズが足りず、エンコードが進まなくなってしまうことがある
-                //キューのcapcityを増やすことでこれを回避する
-                if (!m_Mux.thread.threadActiveAudioProcess()) {
-                    auto worker = m_Mux.thread.thOutput.get();
-                    auto& qAudio = worker->qPackets;
-                    const auto nQueueCapacity = qAudio.capacity();
-                    if (qAudio.size() >= nQueueCapacity) {
-                        qAudio.set_capacity(nQueueCapacity * 3 / 2);
-                    }
-                } else {
-                    for (auto& [mux, thAud] : m_Mux.thread.thAud) {
-                        auto worker = getPacketWorker(mux, AUD_QUEUE_PROCESS);
-                        auto& qAudio = worker->qPackets;
-                        const auto nQueueCapacity = qAudio.capacity();
-                        if (qAudio.size() >= nQueueCapacity) {
-                            qAudio.set_capacity(nQueueCapacity * 3 / 2);
-                        }
-                    }
-                }
-                //動画キューになにもなかったら再度待機する
-                if ((!videoIsRaw && m_Mux.thread.qVideobitstream.size() == 0) ||
-                    (videoIsRaw && m_Mux.thread.qVideoRawFrames.size() == 0)) {
-                    break;
-                }
+    //共通のキューから、音声・字幕のパケットをストリームごとのキューに振り分ける
+    //limitがtrueなら、たまっている量がaudioBufferLimitに達したところで止め、音声側を待たせる
+    auto pullAudioPackets = [&](const bool limit) {
+        AVPktMuxData pktData = { 0 };
+        while ((!limit || audioBuffered < audioBufferLimit)
+            && m_Mux.thread.thOutput->qPackets.front_copy_and_pop_no_lock(&pktData)) {
+            const int id = getStreamId(pktData);
+            if (pktData.muxAudio && pktData.muxAudio->streamIn && pktData.pkt) {
+                audPacketsPerSec = (pktData.pkt->duration <= 0) ? pktData.muxAudio->streamIn->codecpar->sample_rate * 8 : std::max(audPacketsPerSec, (int)(1.0 / (av_q2d(pktData.muxAudio->streamIn->time_base) * pktData.pkt->duration) + 0.5));
+                const auto videoDelay = (vidId >= 0) ? (interleaver.stream(id).lastDts - interleaver.stream(vidId).lastDts) * av_q2d(QUEUE_DTS_TIMEBASE) : 0.0;
+                const auto streamQueueCapacity = (size_t)(audPacketsPerSec * std::max(5.0, videoDelay * 1.5) * std::max((int)m_Mux.audio.size(), 1) + 0.5);
+                audioBufferLimit = std::max(audioBufferLimit, streamQueueCapacity);
             }
-
-            //映像・音声の同期待ちが必要な場合、falseとなってループから抜けるよう、ここでfalseに設定する
-            bAudioExists = false;
-            bVideoExists = false;
+            qStreams[id].push_back(pktData);
+            interleaver.setDepth(id, qStreams[id].size());
+            audioBuffered++;
+        }
+        if (m_Mux.thread.queueInfo) {
+            m_Mux.thread.queueInfo->usage_aud_out = m_Mux.thread.thOutput->qPackets.size() + audioBuffered;
+#if ENABLE_AVCODEC_AUDPROCESS_THREAD
+            //音声処理/音声エンコードのstrandが使ったCPU時間をperf monitorに渡す
+            int64_t audProcCpuUs = 0, audEncCpuUs = 0;
+            for (const auto& aud : m_Mux.thread.thAud) {
+                if (aud.second->process.serial) audProcCpuUs += aud.second->process.serial->cpu_time_us();
+                if (aud.second->encode.serial)  audEncCpuUs  += aud.second->encode.serial->cpu_time_us();
+            }
+            m_Mux.thread.queueInfo->aud_proc_cpu_us = (size_t)audProcCpuUs;
+            m_Mux.thread.queueInfo->aud_enc_cpu_us  = (size_t)audEncCpuUs;
+#endif //#if ENABLE_AVCODEC_AUDPROCESS_THREAD
+        }
+    };
+    //指定したストリームのパケットを1つ書き出す
+    auto writeStream = [&](const int id) {
+        RGYTraceScope traceScope(m_Mux.thread.trace, (id == vidId) ? m_Mux.thread.traceVideo : m_Mux.thread.traceAudio);
+        if (id == vidId) {
+            int64_t videoDts = AV_NOPTS_VALUE;
             if (videoIsRaw) {
                 AVPktMuxData pktData = { 0 };
-                while ((audioDts < 0 || videoDts <= audioDts + dtsThreshold)
-                    && false != (bVideoExists = m_Mux.thread.qVideoRawFrames.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr))) {
-                    WriteNextPacketRawVideo(pktData.pkt, &videoDts);
-                    nWaitVideo = 0;
-                    const auto log_level = RGY_LOG_TRACE;
-                    if (m_printMes && log_level >= m_printMes->getLogLevel(RGY_LOGT_OUT)) {
-                        AddMessage(log_level, _T("videoDts=%8lld: %s.\n"), (lls)videoDts, getTimestampString(videoDts, QUEUE_DTS_TIMEBASE).c_str());
-                    }
-                    if (fpMuxDebug) fprintf(fpMuxDebug.get(), "video: v %3d, a %3d, [videoDts=%16lld],  audioDts=%16lld .\n", (int)m_Mux.thread.qVideoRawFrames.size(), (int)m_Mux.thread.thOutput->qPackets.size(), (lls)videoDts, (lls)audioDts);
+                if (!m_Mux.thread.qVideoRawFrames.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr)) {
+                    interleaver.setDepth(vidId, 0);
+                    return;
                 }
+                WriteNextPacketRawVideo(pktData.pkt, &videoDts);
             } else {
                 RGYBitstream bitstream = RGYBitstreamInit();
-                while ((audioDts < 0 || videoDts <= audioDts + dtsThreshold)
-                    && false != (bVideoExists = m_Mux.thread.qVideobitstream.front_copy_and_pop_no_lock(&bitstream, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr))) {
-                    WriteNextFrameInternal(&bitstream, &videoDts);
-                    nWaitVideo = 0;
-                    const auto log_level = RGY_LOG_TRACE;
-                    if (m_printMes && log_level >= m_printMes->getLogLevel(RGY_LOGT_OUT)) {
-                        AddMessage(log_level, _T("videoDts=%8lld: %s.\n"), (lls)videoDts, getTimestampString(videoDts, QUEUE_DTS_TIMEBASE).c_str());
-                    }
-                    if (fpMuxDebug) fprintf(fpMuxDebug.get(), "video: v %3d, a %3d, [videoDts=%16lld],  audioDts=%16lld .\n", (int)m_Mux.thread.qVideobitstream.size(), (int)m_Mux.thread.thOutput->qPackets.size(), (lls)videoDts, (lls)audioDts);
+                if (!m_Mux.thread.qVideobitstream.front_copy_and_pop_no_lock(&bitstream, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr)) {
+                    interleaver.setDepth(vidId, 0);
+                    return;
                 }
+                WriteNextFrameInternal(&bitstream, &videoDts);
             }
-            AVPktMuxData pktData = { 0 };
-            while ((videoDts < 0 || audioDts <= videoDts + dtsThreshold)
-                && false != (bAudioExists = m_Mux.thread.thOutput->qPackets.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_aud_out : nullptr))) {
-                bool isAudio = false;
-                if (pktData.muxAudio && pktData.muxAudio->streamIn && pktData.pkt) {
-                    audPacketsPerSec = (pktData.pkt->duration <= 0) ? pktData.muxAudio->streamIn->codecpar->sample_rate * 8 : std::max(audPacketsPerSec, (int)(1.0 / (av_q2d(pktData.muxAudio->streamIn->time_base) * pktData.pkt->duration) + 0.5));
-                    const auto videoDelay = (audioDts - videoDts) * av_q2d(QUEUE_DTS_TIMEBASE);
-                    const auto streamQueueCapacity = (int)(audPacketsPerSec * std::max(5.0, videoDelay * 1.5) * std::max((int)m_Mux.audio.size(), 1) + 0.5);
-                    if ((int)m_Mux.thread.thOutput->qPackets.capacity() < streamQueueCapacity) {
-                        m_Mux.thread.thOutput->qPackets.set_capacity(streamQueueCapacity);
-                    }
-                    isAudio = pktData.muxAudio->streamOut->codecpar->codec_type == AVMEDIA_TYPE_AUDIO;
-                }
-                const int64_t maxDts = (videoDts >= 0) ? videoDts + dtsThreshold : syncIgnoreDts;
-                //音声処理スレッドが別にあるなら、出力スレッドがすべきことは単に出力するだけ
-                (m_Mux.thread.threadActiveAudioProcess()) ? writeProcessedPacket(&pktData) : WriteNextPacketInternal(&pktData, maxDts);
-                // 字幕やデータストリームに関しては、連続で来るとは限らないので、考慮しないことにする
-                if (isAudio
-                    && pktData.dts != AV_NOPTS_VALUE && pktData.dts != (int64_t)((uint64_t)AV_NOPTS_VALUE - 1)) {
-                    // 複数のトラックがあり得るので、最大値をとる
-                    audioDts = (std::max)(audioDts, (std::max)(pktData.dts, m_Mux.thread.streamOutMaxDts.load()));
-                }
-                nWaitAudio = 0;
-                const auto log_level = RGY_LOG_TRACE;
-                if (m_printMes && log_level >= m_printMes->getLogLevel(RGY_LOGT_OUT)) {
-                    AddMessage(log_level, _T("audioDts=%8lld: %s, maxDst=%8lld.\n"), (lls)audioDts, getTimestampString(audioDts, QUEUE_DTS_TIMEBASE).c_str(), (lls)maxDts);
-                }
-                if (fpMuxDebug) fprintf(fpMuxDebug.get(), "audio: v %3d, a %3d,  videoDts=%16lld , [audioDts=%16lld].\n",
-                    (videoIsRaw) ? (int)m_Mux.thread.qVideoRawFrames.size() : (int)m_Mux.thread.qVideobitstream.size(),
-                    (int)m_Mux.thread.thOutput->qPackets.size(), (lls)videoDts, (lls)audioDts);
+            interleaver.setDepth(vidId, videoQueueSize());
+            if (m_Mux.thread.trace) {
+                m_Mux.thread.trace->counter(m_Mux.thread.traceQueue, (int64_t)videoQueueSize());
             }
-            //一定以上の動画フレームがキューにたまっており、音声キューになにもなければ、
-            //音声を無視して動画フレームの処理を開始させる
-            //音声が途中までしかなかったり、途中からしかなかったりする場合にこうした処理が必要
-            const size_t videoPacketThreshold = std::max<size_t>(std::min<size_t>(3072, (videoIsRaw) ? (int)m_Mux.thread.qVideoRawFrames.capacity() : (int)m_Mux.thread.qVideobitstream.capacity()), nWaitThreshold) - nWaitThreshold;
-            auto vidQueueSize = (videoIsRaw) ? (int)m_Mux.thread.qVideoRawFrames.size() : (int)m_Mux.thread.qVideobitstream.size();
-            if (m_Mux.thread.thOutput->qPackets.size() == 0 && vidQueueSize > videoPacketThreshold) {
-                nWaitAudio++;
-                if (nWaitAudio <= nWaitThreshold) {
-                    //時折まだパケットが来ているのにタイミングによってsize() == 0が成立することがある
-                    //なのである程度連続でパケットが来ていないときのみ無視するようにする
-                    //このようにすることで適切に同期がとれる
-                    //また、映像キューのサイズが足りないことが考えられるので、拡大する
-                    if (videoIsRaw) {
-                        m_Mux.thread.qVideoRawFrames.set_capacity(m_Mux.thread.qVideoRawFrames.capacity() + 50);
-                    } else {
-                        m_Mux.thread.qVideobitstream.set_capacity(m_Mux.thread.qVideobitstream.capacity() + 50);
+            if (videoDts != AV_NOPTS_VALUE) {
+                interleaver.written(vidId, videoDts);
+            }
+            const auto log_level = RGY_LOG_TRACE;
+            if (m_printMes && log_level >= m_printMes->getLogLevel(RGY_LOGT_OUT)) {
+                AddMessage(log_level, _T("videoDts=%8lld: %s.\n"), (lls)videoDts, getTimestampString(videoDts, QUEUE_DTS_TIMEBASE).c_str());
+            }
+            return;
+        }
+        auto& qStream = qStreams[id];
+        AVPktMuxData pktData = qStream.front();
+        qStream.pop_front();
+        interleaver.setDepth(id, qStream.size());
+        audioBuffered--;
+        const bool flush = pktData.pkt == nullptr;
+        const int64_t videoDts = (vidId >= 0) ? interleaver.stream(vidId).lastDts : -1;
+        const int64_t maxDts = (videoDts >= 0) ? videoDts + dtsThreshold : syncIgnoreDts;
+        //音声処理スレッドが別にあるなら、出力スレッドがすべきことは単に出力するだけ
+        (bThAudProcess) ? writeProcessedPacket(&pktData) : WriteNextPacketInternal(&pktData, maxDts);
+        if (flush) {
+            //このストリームにはもうパケットは来ないので、待たないようにする
+            interleaver.setEnded(id);
+        } else if (pktData.dts != AV_NOPTS_VALUE && pktData.dts != (int64_t)((uint64_t)AV_NOPTS_VALUE - 1)) {
+            interleaver.written(id, pktData.dts);
+        }
+        const auto log_level = RGY_LOG_TRACE;
+        if (m_printMes && log_level >= m_printMes->getLogLevel(RGY_LOGT_OUT)) {
+            AddMessage(log_level, _T("%s: dts=%8lld: %s, maxDst=%8lld.\n"), interleaver.stream(id).name.c_str(),
+                (lls)pktData.dts, getTimestampString(pktData.dts, QUEUE_DTS_TIMEBASE).c_str(), (lls)maxDts);
+        }
+    };
+
+    while (!m_Mux.thread.thOutput->thAbort) {
+        //キューを確認する前にリセットしておくことで、確認後に追加されたパケットの通知を取りこぼさないようにする
+        ResetEvent(m_Mux.thread.thOutput->heEventPktAdded);
+        bool written = false;
+        if (!m_Mux.format.fileHeaderWritten) {
+            //ヘッダー取得前に音声キューのサイズが足りず、エンコードが進まなくなってしまうことがある
+            //ヘッダーは最初の映像フレームで書き出されるので、それまで音声は制限なくためておく
+            pullAudioPackets(false);
+            if (bThAudProcess) {
+                for (auto& [mux, thAud] : m_Mux.thread.thAud) {
+                    auto worker = getPacketWorker(mux, AUD_QUEUE_PROCESS);
+                    auto& qAudio = worker->qPackets;
+                    const auto nQueueCapacity = qAudio.capacity();
+                    if (qAudio.size() >= nQueueCapacity) {
+                        qAudio.set_capacity(nQueueCapacity * 3 / 2);
                     }
-                    break;
                 }
-                audioDts = videoDts;
-                AddMessage(RGY_LOG_TRACE, _T("audio not coming: %d.\n"), nWaitAudio);
             }
-            //一定以上の音声フレームがキューにたまっており、動画キューになにもなければ、
-            //動画を無視して音声フレームの処理を開始させる
-            const size_t audioPacketThreshold = std::max<size_t>(std::min<size_t>(10 * 1024 * 1024, m_Mux.thread.thOutput->qPackets.capacity()), nWaitThreshold) - nWaitThreshold;
-            vidQueueSize = (videoIsRaw) ? (int)m_Mux.thread.qVideoRawFrames.size() : (int)m_Mux.thread.qVideobitstream.size();
-            if (vidQueueSize == 0 && m_Mux.thread.thOutput->qPackets.size() > audioPacketThreshold) {
-                nWaitVideo++;
-                if (nWaitVideo <= nWaitThreshold) {
-                    //時折まだパケットが来ているのにタイミングによってsize() == 0が成立することがある
-                    //なのである程度連続でパケットが来ていないときのみ無視するようにする
-                    //このようにすることで適切に同期がとれる
-                    //また、音声キューのサイズが足りないことが考えられるので、拡大する
-                    m_Mux.thread.thOutput->qPackets.set_capacity(m_Mux.thread.thOutput->qPackets.capacity() * 3 / 2);
+            if (vidId >= 0 && videoQueueSize() > 0) {
+                writeStream(vidId);
+                written = true;
+            }
+        } else {
+            for (;;) {
+                pullAudioPackets(true);
+                if (vidId >= 0) {
+                    interleaver.setDepth(vidId, videoQueueSize());
+                }
+                //書き出し待ちがたまっており、入力側が止まってしまいそうか
+                //一定以上の動画フレームがたまっていて音声が来ない、あるいはその逆の場合、
+                //音声(映像)が途中までしかなかったり、途中からしかなかったりする可能性がある
+                const size_t videoPacketThreshold = std::max<size_t>(std::min<size_t>(3072, videoQueueCapacity()), nWaitThreshold) - nWaitThreshold;
+                const bool videoPressure = vidId >= 0 && videoQueueSize() > videoPacketThreshold;
+                const bool audioPressure = audioBuffered >= audioBufferLimit;
+                const int id = interleaver.next(videoPressure || audioPressure);
+                if (id < 0) {
+                    if (videoPressure) {
+                        //映像キューのサイズが足りないことが考えられるので、拡大する
+                        if (videoIsRaw) {
+                            m_Mux.thread.qVideoRawFrames.set_capacity(m_Mux.thread.qVideoRawFrames.capacity() + 50);
+                        } else {
+                            m_Mux.thread.qVideobitstream.set_capacity(m_Mux.thread.qVideobitstream.capacity() + 50);
+                        }
+                    }
+                    if (audioPressure) {
+                        //音声をためる量が足りないことが考えられるので、拡大する
+                        audioBufferLimit = audioBufferLimit * 3 / 2;
+                    }
+                    const int gate = interleaver.gatingStream();
+                    if (gate >= 0 && (videoPressure || audioPressure)) {
+                        AddMessage(RGY_LOG_TRACE, _T("waiting for %s.\n"), interleaver.stream(gate).name.c_str());
+                    }
                     break;
                 }
-                videoDts = audioDts;
-                AddMessage(RGY_LOG_TRACE, _T("video not coming: %d\n"), nWaitVideo);
-            }
-        } while (bAudioExists || bVideoExists); //両方のキューがひとまず空になるか、映像・音声の同期待ちが必要になるまで回す
-                                                //次のフレーム・パケットが送られてくるまで待機する
-        //キューの容量が両方とも半分以下なら、すこし待ってみる
-        //一方、どちらかのキューが半分以上使われていれば、なるべく早く処理する必要がある
-        if (   m_Mux.thread.qVideobitstream.size() / (double)m_Mux.thread.qVideobitstream.capacity() < 0.5
-            && m_Mux.thread.thOutput->qPackets.size() / (double)m_Mux.thread.thOutput->qPackets.capacity() < 0.5) {
-            if (m_Mux.format.lowlatency) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            } else {
-                ResetEvent(m_Mux.thread.thOutput->heEventPktAdded);
-                WaitForSingleObject(m_Mux.thread.thOutput->heEventPktAdded, 16);
+                writeStream(id);
+                written = true;
             }
-        } else {
-            std::this_thread::yield();
+        }
+        if (!written) {
+            //書き出せるものがなければ、次のフレーム・パケットが送られてくるまで待機する
+            WaitForSingleObject(m_Mux.thread.thOutput->heEventPktAdded, 16);
         }
     }
     //メインループを抜けたことを通知する
     SetEvent(m_Mux.thread.thOutput->heEventClosing);
     m_Mux.thread.thOutput->qPackets.set_keep_length(0);
     m_Mux.thread.qVideobitstream.set_keep_length(0);
-    bAudioExists = !m_Mux.thread.thOutput->qPackets.empty();
-    bVideoExists = !m_Mux.thread.qVideobitstream.empty();
-    //まずは映像と音声の同期をとって出力するためのループ
-    while (bAudioExists && bVideoExists) {
-        AVPktMuxData pktData = { 0 };
-        while (audioDts <= videoDts + dtsThreshold
-            && false != (bAudioExists = m_Mux.thread.thOutput->qPackets.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_aud_out : nullptr))) {
-            //音声処理スレッドが別にあるなら、出力スレッドがすべきことは単に出力するだけ
-            const int64_t maxDts = (videoDts >= 0) ? videoDts + dtsThreshold : INT64_MAX;
-            (bThAudProcess) ? writeProcessedPacket(&pktData) : WriteNextPacketInternal(&pktData, maxDts);
-            //複数のstreamがあり得るので最大値をとる
-            if (pktData.dts != AV_NOPTS_VALUE && pktData.dts != (int64_t)((uint64_t)AV_NOPTS_VALUE - 1)) {
-                audioDts = (std::max)(audioDts, pktData.dts);
-            }
-        }
-        if (videoIsRaw) {
-            pktData = AVPktMuxData();
-            while (videoDts <= audioDts + dtsThreshold
-                && false != (bVideoExists = m_Mux.thread.qVideoRawFrames.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr))) {
-                WriteNextPacketRawVideo(pktData.pkt, &videoDts);
-            }
-        } else {
-            RGYBitstream bitstream = RGYBitstreamInit();
-            while (videoDts <= audioDts + dtsThreshold
-                && false != (bVideoExists = m_Mux.thread.qVideobitstream.front_copy_and_pop_no_lock(&bitstream, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr))) {
-                WriteNextFrameInternal(&bitstream, &videoDts);
-            }
-            bVideoExists = !m_Mux.thread.qVideobitstream.empty();
-        }
-        bAudioExists = !m_Mux.thread.thOutput->qPackets.empty();
+    //残りをすべて取り出し、これ以上パケットが来ないストリームは待たないようにして、同期をとりながら書き出す
+    pullAudioPackets(false);
+    if (vidId >= 0) {
+        interleaver.setDepth(vidId, videoQueueSize());
     }
-    { //音声を書き出す
-        AVPktMuxData pktData = { 0 };
-        while (m_Mux.thread.thOutput->qPackets.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_aud_out : nullptr)) {
-            //音声処理スレッドが別にあるなら、出力スレッドがすべきことは単に出力するだけ
-            (bThAudProcess) ? writeProcessedPacket(&pktData) : WriteNextPacketInternal(&pktData, INT64_MAX);
+    for (int id = 0; id < interleaver.streamCount(); id++) {
+        if (interleaver.stream(id).depth == 0) {
+            interleaver.setEnded(id);
         }
     }
-    if (videoIsRaw) { //動画を書き出す
-        AVPktMuxData pktData = { 0 };
-        while (m_Mux.thread.qVideoRawFrames.front_copy_and_pop_no_lock(&pktData, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr)) {
-            WriteNextPacketRawVideo(pktData.pkt, &videoDts);
+    for (int id; (id = interleaver.next(false)) >= 0; ) {
+        writeStream(id);
+        if (interleaver.stream(id).depth == 0) {
+            interleaver.setEnded(id);
         }
+    }
+    //ストリームごとのバッファリングの状況
+    for (int id = 0; id < interleaver.streamCount(); id++) {
+        const auto& stream = interleaver.stream(id);
+        AddMessage(RGY_LOG_DEBUG, _T("mux %s: %lld packets, max buffered %zu, stalled %lld.\n"),
+            stream.name.c_str(), (lls)stream.written, stream.maxDepth, (lls)stream.stalled);
+    }
+    if (videoIsRaw) {
         //nullptrを送って終了を通知する
+        int64_t videoDts = 0;
         WriteNextPacketRawVideo(nullptr, &videoDts);
     } else {
-        RGYBitstream bitstream = RGYBitstreamInit();
-        while (m_Mux.thread.qVideobitstream.front_copy_and_pop_no_lock(&bitstream, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr)) {
-            WriteNextFrameInternal(&bitstream, &videoDts);
-        }
         //空のbitstreamを送って終了を通知する
-        bitstream = RGYBitstreamInit();
+        int64_t videoDts = 0;
+        RGYBitstream bitstream = RGYBitstreamInit();
         WriteNextFrameInternal(&bitstream, &videoDts);
     }
 #endif
@@ -4822,22 +4859,6 @@ HANDLE RGYOutputAvcodec::getThreadHandleOutput() {
 #endif
 }
 
-HANDLE RGYOutputAvcodec::getThreadHandleAudProcess() {
-#if ENABLE_AVCODEC_OUT_THREAD && ENABLE_AVCODEC_AUDPROCESS_THREAD
-    return (m_Mux.thread.threadActiveAudioProcess()) ? (HANDLE)m_Mux.thread.thAud[nullptr]->process.thread.native_handle() : nullptr;
-#else
-    return NULL;
-#endif
-}
-
-HANDLE RGYOutputAvcodec::getThreadHandleAudEncode() {
-#if ENABLE_AVCODEC_OUT_THREAD && ENABLE_AVCODEC_AUDPROCESS_THREAD
-    return (m_Mux.thread.threadActiveAudioEncode()) ? (HANDLE)m_Mux.thread.thAud[nullptr]->encode.thread.native_handle() : nullptr;
-#else
-    return NULL;
-#endif
-}
-
 #if USE_CUSTOM_IO
 int RGYOutputAvcodec::readPacket(uint8_t *buf, int buf_size) {
     return (int)_fread_nolock(buf, 1, buf_size, m_Mux.format.fpOutput);
@@ -43,6 +43,7 @@
 #include "rgy_input_avcodec.h"
 #include "rgy_output.h"
 #include "rgy_perf_monitor.h"
+#include "rgy_thread_pool.h"
 #include "rgy_util.h"
 #if ENCODER_NVENC
 #include "NVEncUtil.h"
@@ -174,6 +175,7 @@ struct AVMuxVideo {
     
     decltype(parse_nal_unit_h264_c) *parse_nal_h264; // H.264用のnal unit分解関数へのポインタ
     decltype(parse_nal_unit_hevc_c) *parse_nal_hevc; // HEVC用のnal unit分解関数へのポインタ
+    RGYNalScanner scanNalH264;                       // H.264用のnal unit列挙 (毎フレームの判定用)
 
     AVMuxVideo();
 };
@@ -286,22 +288,26 @@ enum {
 };
 
 struct AVMuxThreadWorker {
-    std::thread                    thread;          //音声処理スレッド(デコード/thAudEncodeがなければエンコードも担当)
+    std::thread                    thread;          //出力スレッド/raw映像処理スレッド
+    std::unique_ptr<RGYThreadPoolSerial> serial;    //音声処理/音声エンコード (専用スレッドを持たず、スレッドプール上で順に実行する)
     std::atomic<bool>              thAbort;         //音声処理スレッドに停止を通知する
     bool                           sentEOS;         //EOSパケットを送信側からこのworkerに送ったことを示す
     HANDLE                         heEventPktAdded; //キューのいずれかにデータが追加されたことを通知する
     HANDLE                         heEventClosing;  //音声処理スレッドが停止処理を開始したことを通知する
-    RGYQueueMPMP<AVPktMuxData, 64> qPackets;        //音声パケットをスレッドに渡すためのキュー
+    RGYQueueLockFree<AVPktMuxData, 64> qPackets;    //音声パケットをスレッドに渡すためのキュー
 
     AVMuxThreadWorker();
     ~AVMuxThreadWorker();
+    bool active() const;
+    //qPacketsにデータを追加したことを通知する
+    void notify();
     void close();
 };
 
 
 struct AVMuxThreadAudio {
-    AVMuxThreadWorker encode;   //音声エンコードスレッド
-    AVMuxThreadWorker process;  //音声処理スレッド
+    AVMuxThreadWorker encode;   //音声エンコード
+    AVMuxThreadWorker process;  //音声処理
 
     AVMuxThreadAudio();
     ~AVMuxThreadAudio();
@@ -318,13 +324,20 @@ struct AVMuxThread {
     bool                           enableAudEncodeThread;     //音声エンコードスレッドを使用する
     std::unique_ptr<AVMuxThreadWorker> thOutput;              //出力スレッド
     std::unique_ptr<AVMuxThreadWorker> thRawVideo;            //raw映像処理用スレッド
-    RGYQueueMPMP<AVPktMuxData, 64> qVideoRawFrames;           //raw映像フレームを出力スレッドに渡すためのキュー
-    RGYQueueMPMP<RGYBitstream, 64> qVideobitstreamFreeI;      //映像 Iフレーム用に空いているデータ領域を格納する
-    RGYQueueMPMP<RGYBitstream, 64> qVideobitstreamFreePB;     //映像 P/Bフレーム用に空いているデータ領域を格納する
-    RGYQueueMPMP<RGYBitstream, 64> qVideobitstream;           //映像パケットを出力スレッドに渡すためのキュー
-    std::unordered_map<const AVMuxAudio *, std::unique_ptr<AVMuxThreadAudio>> thAud; //音声スレッド
+    RGYQueueLockFree<AVPktMuxData, 64> qVideoRawFrames;       //raw映像フレームを出力スレッドに渡すためのキュー
+    RGYQueueLockFree<RGYBitstream, 64> qVideobitstreamFreeI;  //映像 Iフレーム用に空いているデータ領域を格納する
+    RGYQueueLockFree<RGYBitstream, 64> qVideobitstreamFreePB; //映像 P/Bフレーム用に空いているデータ領域を格納する
+    RGYQueueLockFree<RGYBitstream, 64> qVideobitstream;       //映像パケットを出力スレッドに渡すためのキュー
+    std::unordered_map<const AVMuxAudio *, std::unique_ptr<AVMuxThreadAudio>> thAud; //音声処理/音声エンコード
+    std::shared_ptr<RGYThreadPool> audioPool;                 //音声処理/音声エンコードを実行するスレッドプール
     std::atomic<int64_t>           streamOutMaxDts;           //音声・字幕キューの最後のdts (timebase = QUEUE_DTS_TIMEBASE) (キューの同期に使用)
     PerfQueueInfo                 *queueInfo;                 //キューの情報を格納する構造体
+    RGYTrace                      *trace;                     //mux・音声処理の区間を記録する (--task-trace)
+    int                            traceVideo;                //traceに登録したid
+    int                            traceAudio;                //traceに登録したid
+    int                            traceQueue;                //traceに登録したid
+    int                            traceAudProc;              //traceに登録したid
+    int                            traceAudEnc;               //traceに登録したid
 
     AVMuxThread();
     bool threadActiveAudio() const { return enableAudProcessThread; };
@@ -336,7 +349,7 @@ struct AVMuxThread {
 struct AVMux {
     AVMuxFormat         format;
     AVMuxVideo          video;
-    std::deque<std::unique_ptr<unit_info>> videoAV1Merge;
+    std::vector<uint8_t> videoAV1Merge; // TEMPORAL_DELIMITER単位に区切り直す前のAV1のデータ (OBU単位で連結)
     vector<AVMuxAudio>  audio;
     vector<AVMuxOther>  other;
     vector<sTrim>       trim;
@@ -411,6 +424,7 @@ struct AvcodecWriterPrm {
     RGYParamThread               threadParamCsp;          //色空間変換用のスレッドのパラメータ
     RGYOptList                   muxOpt;                  //mux時に使用するオプション
     PerfQueueInfo               *queueInfo;               //キューの情報を格納する構造体
+    RGYTrace                    *trace;                   //mux・音声処理の区間を記録する (--task-trace)
     tstring                      muxVidTsLogFile;         //mux timestampログファイル
     const RGYHDRMetadata        *hdrMetadataIn;           //HDR関連のmetadata
     RGYHDR10Plus                *hdr10plus;                //追加のhdr10plus
@@ -460,6 +474,7 @@ struct AvcodecWriterPrm {
         threadParamCsp(),
         muxOpt(),
         queueInfo(nullptr),
+        trace(nullptr),
         muxVidTsLogFile(),
         hdrMetadataIn(nullptr),
         hdr10plus(nullptr),
@@ -509,8 +524,6 @@ public:
 #endif //USE_CUSTOM_IO
     //出力スレッドのハンドルを取得する
     HANDLE getThreadHandleOutput();
-    HANDLE getThreadHandleAudProcess();
-    HANDLE getThreadHandleAudEncode();
 protected:
     virtual RGY_ERR Init(const TCHAR *strFileName, const VideoInfo *videoOutputInfo, const void *option) override;
 
@@ -520,11 +533,16 @@ protected:
     //別のスレッドで実行する場合のスレッド関数 (raw video)
     RGY_ERR WriteThreadFuncRawVideo(RGYParamThread threadParam);
 
-    //別のスレッドで実行する場合のスレッド関数 (音声処理)
-    RGY_ERR ThreadFuncAudThread(const AVMuxAudio *const muxAudio, RGYParamThread threadParam);
+    //スレッドプールで実行する場合の処理関数 (音声処理)
+    //キューにたまっている音声パケットを処理して返る
+    RGY_ERR ProcessAudQueue(const AVMuxAudio *const muxAudio);
 
-    //別のスレッドで実行する場合のスレッド関数 (音声エンコード処理)
-    RGY_ERR ThreadFuncAudEncodeThread(const AVMuxAudio *const muxAudio, RGYParamThread threadParam);
+    //スレッドプールで実行する場合の処理関数 (音声エンコード処理)
+    //キューにたまっている音声フレームをエンコードして返る
+    RGY_ERR EncodeAudQueue(const AVMuxAudio *const muxAudio);
+
+    //ファイルヘッダを書いたことを記録し、ヘッダ待ちの音声処理を開始させる
+    void SetFileHeaderWritten();
 
     //対象パケットの担当スレッドを探す
     AVMuxThreadWorker *getPacketWorker(const AVMuxAudio *muxAudio, const int type);
@@ -28,6 +28,7 @@
 #include "rgy_parallel_enc.h"
 #include "rgy_filesystem.h"
 #include "rgy_input.h"
+#include "rgy_input_avcodec.h"
 #include "rgy_output.h"
 #if ENCODER_QSV
 #include "qsv_pipeline.h"
@@ -39,8 +40,12 @@
 #include "mpp_core.h"
 #endif
 #include "rgy_perf_monitor.h"
+#include "rgy_env.h"
 
 static const int RGY_PARALLEL_ENC_TIMEOUT = 10000;
+static const int RGY_PARALLEL_ENC_MEM_LIMIT_MIN_MB = 256;
+static const int RGY_PARALLEL_ENC_CHUNKS_PER_PROCESS = 4; // キーフレームの位置がわかる場合に、並列数あたりに分割するチャンク数
+static const double RGY_PARALLEL_ENC_CHUNK_MIN_SEC = 30.0; // 自動で分割する場合のチャンクの最小の長さ
 
 static RGY_CODEC enc_codec(const encParams *prm) {
 #if ENCODER_NVENC
@@ -78,7 +83,65 @@ void RGYParallelEncodeStatusData::reset() {
     encStatusData.reset();
 }
 
-RGYParallelEncProcess::RGYParallelEncProcess(const int id, const tstring& tmpfile, std::shared_ptr<RGYLog> log) :
+RGYParallelEncMemBudget::RGYParallelEncMemBudget(const size_t limit) : m_limit(limit), m_used(0) {};
+
+bool RGYParallelEncMemBudget::tryAcquire(const size_t size) {
+    auto used = m_used.load();
+    do {
+        if (used + size > m_limit) {
+            return false;
+        }
+    } while (!m_used.compare_exchange_weak(used, used + size));
+    return true;
+}
+
+void RGYParallelEncMemBudget::acquire(const size_t size) {
+    m_used += size;
+}
+
+void RGYParallelEncMemBudget::release(const size_t size) {
+    m_used -= size;
+}
+
+RGYParallelEncPacketDest RGYParallelEncSendData::reservePacket(const size_t size) {
+    if (spilled) {
+        return RGYParallelEncPacketDest::File; // 順序を保つため、一度ファイルに切り替えたら最後までファイルに出力する
+    }
+    if (!readerActive) {
+        // 親がまだ読み出していないチャンクは、上限を超えたらファイルに切り替える
+        if (memBudget && !memBudget->tryAcquire(size)) {
+            spilled = true;
+            return RGYParallelEncPacketDest::File;
+        }
+    } else {
+        // 親が読み出し中のチャンクは、キューが空くのを待つ
+        const size_t ringLimit = (memBudget) ? memBudget->ringLimit() : std::numeric_limits<size_t>::max();
+        while (queuedSize > 0 && queuedSize + size > ringLimit) {
+            if (readerAbort) {
+                return RGYParallelEncPacketDest::Abort;
+            }
+            // releasePacket()で通知される (自動リセットなので、判定後に通知されても取りこぼさない)
+            WaitForSingleObject(eventPacketReleased.get(), 16);
+        }
+        if (memBudget) {
+            memBudget->acquire(size);
+        }
+    }
+    queuedSize += size;
+    return RGYParallelEncPacketDest::Queue;
+}
+
+void RGYParallelEncSendData::releasePacket(const size_t size) {
+    queuedSize -= size;
+    if (memBudget) {
+        memBudget->release(size);
+    }
+    if (eventPacketReleased) {
+        SetEvent(eventPacketReleased.get());
+    }
+}
+
+RGYParallelEncProcess::RGYParallelEncProcess(const int id, const tstring& tmpfile, RGYParallelEncMemBudget *memBudget, std::shared_ptr<RGYLog> log) :
     m_id(id),
     m_process(),
     m_qFirstProcessData(),
@@ -92,6 +155,7 @@ RGYParallelEncProcess::RGYParallelEncProcess(const int id, const tstring& tmpfil
     m_processFinished(unique_event(nullptr, nullptr)),
     m_thAbort(false),
     m_log(log) {
+    m_sendData.memBudget = memBudget;
 }
 
 RGYParallelEncProcess::~RGYParallelEncProcess() {
@@ -102,10 +166,19 @@ RGY_ERR RGYParallelEncProcess::close(const bool deleteTempFiles) {
     auto err = RGY_ERR_NONE;
     if (m_thRunProcess.joinable()) {
         m_thAbort = true;
+        m_sendData.readerAbort = true;
+        if (m_sendData.eventPacketReleased) {
+            SetEvent(m_sendData.eventPacketReleased.get()); // reservePacketで待機中なら起こす
+        }
         m_thRunProcess.join();
         m_sendData.processStatus = RGYParallelEncProcessStatus::Finished;
         if (m_qFirstProcessData) {
-            m_qFirstProcessData->close([](RGYOutputRawPEExtHeader **ptr) { if (*ptr) free(*ptr); });
+            m_qFirstProcessData->close([this](RGYOutputRawPEExtHeader **ptr) {
+                if (*ptr) {
+                    m_sendData.releasePacket(sizeof(**ptr) + (*ptr)->size);
+                    free(*ptr);
+                }
+            });
             m_qFirstProcessData.reset();
         }
         if (m_qFirstProcessDataFree) {
@@ -167,6 +240,7 @@ RGY_ERR RGYParallelEncProcess::startThread(const encParams& peParams, CPerfMonit
     m_sendData.logMutex = m_log->getLock();
     m_sendData.eventChildHasSentFirstKeyPts = CreateEventUnique(nullptr, FALSE, FALSE);
     m_sendData.eventParentHasSentFinKeyPts = CreateEventUnique(nullptr, FALSE, FALSE);
+    m_sendData.eventPacketReleased = CreateEventUnique(nullptr, FALSE, FALSE);
 #if ENABLE_PERF_COUNTER
     if (perfMonitor) {
         m_sendData.perfCounter = perfMonitor->perfCounter();
@@ -184,6 +258,8 @@ RGY_ERR RGYParallelEncProcess::startThread(const encParams& peParams, CPerfMonit
         m_sendData.qFirstProcessData = m_qFirstProcessData.get(); // キューのポインタを渡す
         m_sendData.qFirstProcessDataFree = m_qFirstProcessDataFree.get(); // キューのポインタを渡す
         m_sendData.qFirstProcessDataFreeLarge = m_qFirstProcessDataFreeLarge.get(); // キューのポインタを渡す
+        // 最初のプロセスは親がすぐに読み出しを始めるので、ファイルには切り替えずキューが空くのを待つようにする
+        m_sendData.readerActive = peParams.ctrl.parallelEnc.parallelId == 0;
     }
     m_thRunProcess = std::thread([&]() {
         AddMessage(RGY_LOG_DEBUG, _T("\nPE%d[%d]: Start thread...\n"), m_id, GetCurrentThreadId());
@@ -218,7 +294,10 @@ RGY_ERR RGYParallelEncProcess::getNextPacket(RGYOutputRawPEExtHeader **ptr) {
         if (nSize == 0 && m_thRunProcessRet.has_value()) { // キューにデータがなく、かつ処理が終了している
             return m_thRunProcessRet.value() == RGY_ERR_NONE ? RGY_ERR_MORE_BITSTREAM : m_thRunProcessRet.value();
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        // 取り出しに失敗した時点で追加の通知はリセットされているので、その後に追加されていなければ次の追加を待つ
+        if (m_qFirstProcessData->size() == 0) {
+            m_qFirstProcessData->wait_for_push();
+        }
     }
     if ((*ptr == nullptr)) {
         return RGY_ERR_MORE_BITSTREAM;
@@ -233,11 +312,25 @@ RGY_ERR RGYParallelEncProcess::putFreePacket(RGYOutputRawPEExtHeader *ptr) {
     if (ptr->allocSize == 0) {
         return RGY_ERR_UNKNOWN;
     }
+    m_sendData.releasePacket(sizeof(*ptr) + ptr->size);
     // もう終了していた場合は再利用する必要はないのでメモリを解放する
     if (m_sendData.processStatus == RGYParallelEncProcessStatus::Finished) {
         free(ptr);
         return RGY_ERR_NONE;
     }
+    // 一時ファイルに切り替えた後は子がキューを使うことはないので、再利用せずにメモリを解放する
+    // 空きキューのバッファはmemBudgetで管理されていないため、ためたままだと上限を超えてメモリを保持し続けてしまう
+    // spilledの設定後は子は空きキューから取り出さないので、ここでたまっているものも解放する
+    if (m_sendData.spilled) {
+        free(ptr);
+        for (auto freeQueue : { m_qFirstProcessDataFree.get(), m_qFirstProcessDataFreeLarge.get() }) {
+            RGYOutputRawPEExtHeader *cached = nullptr;
+            while (freeQueue && freeQueue->front_copy_and_pop_no_lock(&cached)) {
+                free(cached);
+            }
+        }
+        return RGY_ERR_NONE;
+    }
     RGYQueueMPMP<RGYOutputRawPEExtHeader*> *freeQueue = (ptr->allocSize <= RGY_PE_EXT_HEADER_DATA_NORMAL_BUF_SIZE) ? m_qFirstProcessDataFree.get() : m_qFirstProcessDataFreeLarge.get();
     freeQueue->push(ptr);
     return RGY_ERR_NONE;
@@ -278,10 +371,14 @@ int RGYParallelEncProcess::waitProcessFinished(const uint32_t timeout) {
 
 RGYParallelEnc::RGYParallelEnc(std::shared_ptr<RGYLog> log) :
     m_id(-1),
+    m_memBudget(),
     m_encProcess(),
+    m_encProcessMtx(),
     m_log(log),
     m_thParallelRun(),
     m_thParallelRunAbort(false),
+    m_thParallelRunErr(RGY_ERR_NONE),
+    m_chunkSeekRatio(),
     m_videoEndKeyPts(-1),
     m_videoFinished(false),
     m_parallelCount(0),
@@ -296,68 +393,113 @@ void RGYParallelEnc::close(const bool deleteTempFiles) {
         m_thParallelRunAbort = true;
         m_thParallelRun.join();
     }
+    // プロセスを起動するスレッドは終了しているので、ここでは設定されない
     for (auto &proc : m_encProcess) {
-        proc->close(deleteTempFiles);
+        if (proc) {
+            proc->close(deleteTempFiles);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_encProcessMtx);
+        m_encProcess.clear();
     }
-    m_encProcess.clear();
+    m_memBudget.reset();
     m_videoEndKeyPts = -1;
 }
 
+RGYParallelEncProcess *RGYParallelEnc::encProcess(const int ichunk) const {
+    std::lock_guard<std::mutex> lock(m_encProcessMtx);
+    if (ichunk < 0 || ichunk >= (int)m_encProcess.size()) {
+        return nullptr;
+    }
+    return m_encProcess[ichunk].get();
+}
+
 int64_t RGYParallelEnc::getVideofirstKeyPts(const int ichunk) const {
-    if (ichunk >= (int)m_encProcess.size()) {
+    auto proc = encProcess(ichunk);
+    if (!proc) {
         return -1;
     }
-    return m_encProcess[ichunk]->getVideoFirstKeyPts();
+    return proc->getVideoFirstKeyPts();
 }
 
 tstring RGYParallelEnc::tmpPath(const int ichunk) const {
-    if (ichunk >= (int)m_encProcess.size()) {
+    auto proc = encProcess(ichunk);
+    if (!proc) {
         return _T("");
     }
-    return m_encProcess[ichunk]->tmpPath();
+    return proc->tmpPath();
+}
+
+void RGYParallelEnc::setReaderActive(const int ichunk) {
+    auto proc = encProcess(ichunk);
+    if (!proc) {
+        return;
+    }
+    proc->setReaderActive();
+}
+
+bool RGYParallelEnc::spilled(const int ichunk) const {
+    auto proc = encProcess(ichunk);
+    if (!proc) {
+        return false;
+    }
+    return proc->spilled();
 }
 
 RGYParamParallelEncCache RGYParallelEnc::cacheMode(const int ichunk) const {
-    if (ichunk >= (int)m_encProcess.size()) {
+    auto proc = encProcess(ichunk);
+    if (!proc) {
         return RGYParamParallelEncCache::Mem;
     }
-    return m_encProcess[ichunk]->cacheMode();
+    return proc->cacheMode();
 }
 
 RGY_ERR RGYParallelEnc::getNextPacket(const int ichunk, RGYOutputRawPEExtHeader **ptr) {
-    if (m_encProcess.size() == 0) {
+    auto proc = encProcess(ichunk);
+    if (!proc) {
         AddMessage(RGY_LOG_ERROR, _T("Invalid call for getNextPacketFromFirst.\n"));
         return RGY_ERR_UNKNOWN;
     }
-    return m_encProcess[ichunk]->getNextPacket(ptr);
+    return proc->getNextPacket(ptr);
 }
 
 RGY_ERR RGYParallelEnc::putFreePacket(const int ichunk, RGYOutputRawPEExtHeader *ptr) {
-    if (m_encProcess.size() == 0) {
+    auto proc = encProcess(ichunk);
+    if (!proc) {
         AddMessage(RGY_LOG_ERROR, _T("Invalid call for pushNextPacket.\n"));
         return RGY_ERR_UNKNOWN;
     }
-    return m_encProcess[ichunk]->putFreePacket(ptr);
+    return proc->putFreePacket(ptr);
 }
 
 int RGYParallelEnc::waitProcessFinished(const int id, const uint32_t timeout) {
-    if (id >= (int)m_encProcess.size()) {
+    auto proc = encProcess(id);
+    if (!proc) {
         AddMessage(RGY_LOG_ERROR, _T("Invalid parallel id #%d for waitProcess.\n"), id);
         return -1;
     }
-    return m_encProcess[id]->waitProcessFinished(timeout);
+    return proc->waitProcessFinished(timeout);
 }
 
 std::optional<RGY_ERR> RGYParallelEnc::processReturnCode(const int id) {
-    if (id >= (int)m_encProcess.size()) {
+    auto proc = encProcess(id);
+    if (!proc) {
         AddMessage(RGY_LOG_ERROR, _T("Invalid parallel id #%d for processReturnCode.\n"), id);
         return std::nullopt;
     }
-    return m_encProcess[id]->getThreadRunResult();
+    return proc->getThreadRunResult();
 }
 
 RGY_ERR RGYParallelEnc::checkAllProcessErrors() {
+    if (m_thParallelRunErr != RGY_ERR_NONE) {
+        return m_thParallelRunErr;
+    }
+    std::lock_guard<std::mutex> lock(m_encProcessMtx);
     for (const auto& proc : m_encProcess) {
+        if (!proc) {
+            continue;
+        }
         auto returnCode = proc->getThreadRunResult();
         if (returnCode.has_value() && returnCode.value() != RGY_ERR_NONE) {
             return returnCode.value();
@@ -367,11 +509,12 @@ RGY_ERR RGYParallelEnc::checkAllProcessErrors() {
 }
 
 void RGYParallelEnc::encStatusReset(const int id) {
-    if (id >= (int)m_encProcess.size()) {
+    auto proc = encProcess(id);
+    if (!proc) {
         AddMessage(RGY_LOG_ERROR, _T("Invalid parallel id #%d for encStatusReset.\n"), id);
         return;
     }
-    m_encProcess[id]->getEncodeStatus()->reset();
+    proc->getEncodeStatus()->reset();
 }
 
 std::pair<RGY_ERR, const TCHAR *> RGYParallelEnc::isParallelEncPossible(const encParams *prm, const RGYInput *input) {
@@ -448,6 +591,68 @@ RGYParamLogLevel RGYParallelEnc::setChildLogLevel(const RGYParamLogLevel& logLev
     return logLevelChild;
 }
 
+void RGYParallelEnc::initChunks(encParams *prm, const RGYInput *input) {
+    auto& parallelEnc = prm->ctrl.parallelEnc;
+    m_chunkSeekRatio.clear();
+    // キーフレームの一覧はコンテナのインデックスから取得する (インデックスのないコンテナでは、チャンク数で等分する)
+    std::vector<double> keyframeTimes;
+    double seekStart = 0.0, duration = 0.0;
+#if ENABLE_AVSW_READER
+    if (auto reader = dynamic_cast<const RGYInputAvcodec *>(input); reader != nullptr) {
+        keyframeTimes = reader->GetVideoKeyframeTimes();
+        seekStart = std::max(0.0, (double)prm->common.seekSec);
+        duration = reader->GetInputVideoDuration();
+    }
+#endif
+    // インデックスが入力の大部分を網羅していない場合は使用しない
+    if (duration <= 0.0 || keyframeTimes.size() < 2 || keyframeTimes.back() < seekStart + duration * 0.5) {
+        keyframeTimes.clear();
+    }
+    const bool autoChunks = parallelEnc.chunks <= 0;
+    if (autoChunks) {
+        parallelEnc.chunks = parallelEnc.parallelCount;
+        if (keyframeTimes.size() > 0) {
+            // 並列数より細かく分割しておき、空いたエンコーダから順に割り当てることで、重いチャンクがあっても処理時間を平準化する
+            parallelEnc.chunks = std::max(parallelEnc.parallelCount,
+                std::min(parallelEnc.parallelCount * RGY_PARALLEL_ENC_CHUNKS_PER_PROCESS, (int)(duration / RGY_PARALLEL_ENC_CHUNK_MIN_SEC)));
+        }
+    }
+    parallelEnc.chunks = std::max(parallelEnc.chunks, parallelEnc.parallelCount);
+    if (keyframeTimes.size() == 0) {
+        return;
+    }
+    // 各チャンクの開始位置を、等分した位置に最も近いキーフレームに合わせる
+    std::vector<float> seekRatio = { 0.0f };
+    size_t prevKey = std::lower_bound(keyframeTimes.begin(), keyframeTimes.end(), seekStart) - keyframeTimes.begin();
+    for (int i = 1; i < parallelEnc.chunks; i++) {
+        const double target = seekStart + duration * i / parallelEnc.chunks;
+        size_t key = std::lower_bound(keyframeTimes.begin(), keyframeTimes.end(), target) - keyframeTimes.begin();
+        if (key >= keyframeTimes.size()) {
+            break;
+        }
+        if (key > 0 && target - keyframeTimes[key - 1] < keyframeTimes[key] - target) {
+            key--;
+        }
+        if (key < prevKey + 2) {
+            continue; // キーフレーム間隔より細かくは分割しない
+        }
+        // 子側のシークでこのキーフレームに到達するよう、ひとつ前のキーフレームとの中間の位置を指定する
+        const double seekTime = (keyframeTimes[key - 1] + keyframeTimes[key]) * 0.5;
+        seekRatio.push_back((float)((seekTime - seekStart) / duration));
+        prevKey = key;
+    }
+    if ((int)seekRatio.size() < parallelEnc.parallelCount) {
+        // キーフレームが少なすぎる場合は、チャンク数で等分する
+        if (autoChunks) {
+            parallelEnc.chunks = parallelEnc.parallelCount;
+        }
+        return;
+    }
+    m_chunkSeekRatio = seekRatio;
+    parallelEnc.chunks = (int)seekRatio.size();
+    AddMessage(RGY_LOG_DEBUG, _T("Split into %d chunks using %d keyframes in container index.\n"), parallelEnc.chunks, (int)keyframeTimes.size());
+}
+
 encParams RGYParallelEnc::genPEParam(const int ip, const encParams *prm, rgy_rational<int> outputTimebase, const bool delayChildSync, const tstring& tmpfile) {
     encParams prmParallel = *prm;
     prmParallel.ctrl.parallelEnc.parallelId = ip;
@@ -455,6 +660,11 @@ encParams RGYParallelEnc::genPEParam(const int ip, const encParams *prm, rgy_rat
     prmParallel.ctrl.loglevel = setChildLogLevel(prm->ctrl.loglevel);
     prmParallel.ctrl.parallelEnc.cacheMode = (ip == 0) ? RGYParamParallelEncCache::Mem : prm->ctrl.parallelEnc.cacheMode; // parallelId = 0 は必ずMem キャッシュモード
     prmParallel.ctrl.parallelEnc.delayChildSync = delayChildSync;
+    if (prm->ctrl.taskTrace.length() > 0) { // 子の記録は別のファイルに出力する
+        prmParallel.ctrl.taskTrace = PathRemoveExtensionS(prm->ctrl.taskTrace) + strsprintf(_T(".%d"), ip) + rgy_get_extension(prm->ctrl.taskTrace);
+    }
+    prmParallel.ctrl.metrics.clear(); // 進捗は親が子の分も含めて出力する
+    prmParallel.ctrl.metricsPort = 0;
 #if __has_include("rgy_opencl.h")
     prmParallel.ctrl.openclBuildThreads = std::max(1, (prm->ctrl.openclBuildThreads > 0 ? prm->ctrl.openclBuildThreads : std::min(RGY_OPENCL_BUILD_THREAD_DEFAULT_MAX, (int)std::thread::hardware_concurrency())) / prm->ctrl.parallelEnc.parallelCount); // 並列数の制限
 #endif
@@ -474,7 +684,7 @@ encParams RGYParallelEnc::genPEParam(const int ip, const encParams *prm, rgy_rat
     prmParallel.common.ppAttachmentSelectList = nullptr;
     prmParallel.common.outReplayCodec = RGY_CODEC_UNKNOWN;
     prmParallel.common.outReplayFile.clear();
-    prmParallel.common.seekRatio = ip / (float)prmParallel.ctrl.parallelEnc.chunks;
+    prmParallel.common.seekRatio = (ip < (int)m_chunkSeekRatio.size()) ? m_chunkSeekRatio[ip] : ip / (float)prmParallel.ctrl.parallelEnc.chunks;
     prmParallel.common.timebase = outputTimebase; // timebaseがずれると致命的なので、強制的に上書きする
     prmParallel.common.dynamicHdr10plusJson.clear(); // hdr10plusのファイルからの読み込みは親プロセスでmux時に行う
     prmParallel.common.doviRpuFile.clear(); // doviRpuのファイルからの読み込みは親プロセスでmux時に行う
@@ -488,7 +698,7 @@ encParams RGYParallelEnc::genPEParam(const int ip, const encParams *prm, rgy_rat
 RGY_ERR RGYParallelEnc::startChunkProcess(const int ip, const encParams *prm, int64_t parentFirstKeyPts, rgy_rational<int> outputTimebase, const bool delayChildSync, EncodeStatus *encStatus, CPerfMonitor *perfMonitor) {
     const auto tmpfile = prm->common.outputFilename + _T(".pe") + std::to_tstring(ip);
     const auto peParam = genPEParam(ip, prm, outputTimebase, delayChildSync, tmpfile);
-    auto process = std::make_unique<RGYParallelEncProcess>(ip, tmpfile, m_log);
+    auto process = std::make_unique<RGYParallelEncProcess>(ip, tmpfile, m_memBudget.get(), m_log);
     if (auto err = process->startThread(peParam, perfMonitor); err != RGY_ERR_NONE) {
         AddMessage(RGY_LOG_ERROR, _T("Failed to run PE%d: %s.\n"), ip, get_err_mes(err));
         return err;
@@ -512,16 +722,22 @@ RGY_ERR RGYParallelEnc::startChunkProcess(const int ip, const encParams *prm, in
         }
     }
     AddMessage(RGY_LOG_DEBUG, _T("PE%d: Got first key pts: raw %lld, offset %lld.\n"), ip, firstKeyPts, firstKeyPts - parentFirstKeyPts);
-    encStatus->addChildStatus({ 1.0f / prm->ctrl.parallelEnc.parallelCount, process->getEncodeStatus() });
+    encStatus->addChildStatus({ 1.0f / prm->ctrl.parallelEnc.chunks, process->getEncodeStatus() });
 
     AddMessage(RGY_LOG_DEBUG, _T("Started encoder PE%d.\n"), ip);
-    m_encProcess.push_back(std::move(process));
+    std::lock_guard<std::mutex> lock(m_encProcessMtx);
+    m_encProcess[ip] = std::move(process);
     return RGY_ERR_NONE;
 }
 
 RGY_ERR RGYParallelEnc::startParallelThreads(const encParams *prm, const RGYInput *input, rgy_rational<int> outputTimebase, const bool delayChildSync, EncodeStatus *encStatus, CPerfMonitor *perfMonitor) {
     const auto parentFirstKeyPts = input->GetVideoFirstKeyPts();
-    m_encProcess.clear();
+    {
+        // 親側の読み出しと並行して起動したものから設定するので、あらかじめチャンク数分の枠を用意しておく
+        std::lock_guard<std::mutex> lock(m_encProcessMtx);
+        m_encProcess.clear();
+        m_encProcess.resize(prm->ctrl.parallelEnc.chunks);
+    }
     // とりあえず、並列数分起動する
     int startId = 0;
     for (; startId < prm->ctrl.parallelEnc.parallelCount; startId++) {
@@ -545,62 +761,72 @@ RGY_ERR RGYParallelEnc::startParallelThreads(const encParams *prm, const RGYInpu
     if (prm->ctrl.parallelEnc.parallelCount >= prm->ctrl.parallelEnc.chunks) {
         //最後のプロセスの終了時刻(=終わりまで)を転送
         AddMessage(RGY_LOG_DEBUG, _T("Send PE%d end key pts -1.\n"), (int)m_encProcess.size() - 1);
-        auto err = m_encProcess.back()->sendEndPts(-1);
+        auto err = m_encProcess.back()->sendEndPts(-1); // 全チャンク起動済み
         if (err != RGY_ERR_NONE) {
             AddMessage(RGY_LOG_ERROR, _T("Failed to send end pts to encoder PE%d: %s.\n"), (int)m_encProcess.size() - 1, get_err_mes(err));
             return err;
         }
     } else {
         // プロセス起動用のスレッドを開始する
+        // 残りのチャンクは、エンコードが終了して空きができたら順に起動する
+        // チャンクの終了時刻は次のチャンクの最初のキーフレームのptsなので、起動待ちのチャンクは常に1つだけ先行して起動しておく
         m_thParallelRun = std::thread([this](int startId, const int parallelCount, const int chunkCount,
             encParams prm, rgy_rational<int> outputTimebase, const bool delayChildSync, EncodeStatus *encStatus, CPerfMonitor *perfMonitor) {
+            auto err = runChunkScheduler(startId, parallelCount, chunkCount, prm, outputTimebase, delayChildSync, encStatus, perfMonitor);
+            if (err != RGY_ERR_NONE) {
+                AddMessage(RGY_LOG_ERROR, _T("Error in chunk scheduler: %s.\n"), get_err_mes(err));
+                m_thParallelRunErr = err;
+            }
+        }, startId, prm->ctrl.parallelEnc.parallelCount, prm->ctrl.parallelEnc.chunks, *prm, outputTimebase, delayChildSync, encStatus, perfMonitor);
+    }
+    return RGY_ERR_NONE;
+}
 
-            int runCount = startId-1; // 実行したチャック数
-
-            // とりあえず並列数分開始準備
-            for (; startId < chunkCount; startId++) {
-                if (auto err = startChunkProcess(startId, &prm, -1, outputTimebase, delayChildSync, encStatus, perfMonitor); err != RGY_ERR_NONE) {
+RGY_ERR RGYParallelEnc::runChunkScheduler(const int startId, const int parallelCount, const int chunkCount,
+    const encParams& prm, rgy_rational<int> outputTimebase, const bool delayChildSync, EncodeStatus *encStatus, CPerfMonitor *perfMonitor) {
+    int runCount = startId-1; // 実行したチャック数
+
+    while (!m_thParallelRunAbort && runCount < chunkCount) {
+        // 実行中のプロセス数を取得
+        // m_encProcessを設定するのはこのスレッドだけなので、ここでの参照にはロックは不要
+        const auto runningCount = std::count_if(m_encProcess.begin(), m_encProcess.end(), [](const auto& proc) {
+            return proc && proc->processStatus() == RGYParallelEncProcessStatus::Running;
+        });
+        if (runningCount < parallelCount) {
+            // 実行中のプロセス数が並列数より少ない場合、新しいプロセスを起動する
+            if (runCount < chunkCount-1) {
+                // 次のチャンクを起動して、その最初のキーフレームのptsを取得する
+                if (!m_encProcess[runCount + 1]) {
+                    if (auto err = startChunkProcess(runCount + 1, &prm, -1, outputTimebase, delayChildSync, encStatus, perfMonitor); err != RGY_ERR_NONE) {
+                        return err;
+                    }
+                }
+                // ひとつ前のプロセスの終了時刻として転送
+                const auto firstKeyPts = m_encProcess[runCount+1]->getVideoFirstKeyPts();
+                AddMessage(RGY_LOG_DEBUG, _T("Send PE%d end key pts %lld.\n"), runCount, firstKeyPts);
+                auto err = m_encProcess[runCount]->sendEndPts(firstKeyPts);
+                if (err != RGY_ERR_NONE) {
+                    AddMessage(RGY_LOG_ERROR, _T("Failed to send end pts to PE%d: %s.\n"), runCount, get_err_mes(err));
+                    return err;
+                }
+            } else {
+                auto err = m_encProcess.back()->sendEndPts(-1); // 最後のチャンクは起動済み
+                if (err != RGY_ERR_NONE) {
+                    AddMessage(RGY_LOG_ERROR, _T("Failed to send end pts to encoder PE%d: %s.\n"), (int)m_encProcess.size() - 1, get_err_mes(err));
                     return err;
                 }
             }
-
-            while (!m_thParallelRunAbort && runCount < chunkCount) {
-                // 実行中のプロセス数を取得
-                const auto runningCount = std::count_if(m_encProcess.begin(), m_encProcess.end(), [](const auto& proc) {
-                    return proc->processStatus() == RGYParallelEncProcessStatus::Running;
-                });
-                if (runningCount < parallelCount) {
-                    // 実行中のプロセス数が並列数より少ない場合、新しいプロセスを起動する
-                    if (runCount < chunkCount-1) {
-                        // ひとつ前のプロセスの終了時刻として転送
-                        const auto firstKeyPts = m_encProcess[runCount+1]->getVideoFirstKeyPts();
-                        AddMessage(RGY_LOG_DEBUG, _T("Send PE%d end key pts %lld.\n"), runCount, firstKeyPts);
-                        auto err = m_encProcess[runCount]->sendEndPts(firstKeyPts);
-                        if (err != RGY_ERR_NONE) {
-                            AddMessage(RGY_LOG_ERROR, _T("Failed to send end pts to PE%d: %s.\n"), startId, get_err_mes(err));
-                            return err;
-                        }
-                    } else {
-                        auto err = m_encProcess.back()->sendEndPts(-1);
-                        if (err != RGY_ERR_NONE) {
-                            AddMessage(RGY_LOG_ERROR, _T("Failed to send end pts to encoder PE%d: %s.\n"), (int)m_encProcess.size() - 1, get_err_mes(err));
-                            return err;
-                        }
-                    }
-                    runCount++; // 実行したチャック数をインクリメント
-                } else {
-                    // 実行中のプロセス数が並列数と同じ場合、いずれかのプロセスが終了するまで待つ
-                    std::vector<HANDLE> eventProcessFinished;
-                    for (const auto& proc : m_encProcess) {
-                        if (proc->processStatus() != RGYParallelEncProcessStatus::Finished) {
-                            eventProcessFinished.push_back(proc->eventProcessFinished());
-                        }
-                    }
-                    WaitForMultipleObjects((uint32_t)eventProcessFinished.size(), eventProcessFinished.data(), FALSE, 16);
+            runCount++; // 実行したチャック数をインクリメント
+        } else {
+            // 実行中のプロセス数が並列数と同じ場合、いずれかのプロセスが終了するまで待つ
+            std::vector<HANDLE> eventProcessFinished;
+            for (const auto& proc : m_encProcess) {
+                if (proc && proc->processStatus() != RGYParallelEncProcessStatus::Finished) {
+                    eventProcessFinished.push_back(proc->eventProcessFinished());
                 }
             }
-            return RGY_ERR_NONE;
-        }, startId, prm->ctrl.parallelEnc.parallelCount, prm->ctrl.parallelEnc.chunks, *prm, outputTimebase, delayChildSync, encStatus, perfMonitor);
+            WaitForMultipleObjects((uint32_t)eventProcessFinished.size(), eventProcessFinished.data(), FALSE, 16);
+        }
     }
     return RGY_ERR_NONE;
 }
@@ -614,18 +840,24 @@ RGY_ERR RGYParallelEnc::parallelRun(encParams *prm, const RGYInput *input, rgy_r
     if (prm->ctrl.parallelEnc.isChild()) { // 子プロセスから呼ばれた
         return parallelChild(prm, input); // 子プロセスの処理
     }
-    if (prm->ctrl.parallelEnc.chunks <= 0) {
-        prm->ctrl.parallelEnc.chunks = prm->ctrl.parallelEnc.parallelCount;
-    }
+    initChunks(prm, input);
     m_chunks = prm->ctrl.parallelEnc.chunks;
     AddMessage(RGY_LOG_DEBUG, _T("parallelRun: parallel count %d, chunks %d\n"), prm->ctrl.parallelEnc.parallelCount, prm->ctrl.parallelEnc.chunks);
+    // 子から親へ転送中のデータを保持するメモリの上限 (指定がなければ物理メモリの1/4)
+    const size_t memLimit = (prm->ctrl.parallelEnc.memLimitMB > 0)
+        ? (size_t)prm->ctrl.parallelEnc.memLimitMB * 1024 * 1024
+        : std::max<size_t>((size_t)(getPhysicalRamSize(nullptr) / 4), (size_t)RGY_PARALLEL_ENC_MEM_LIMIT_MIN_MB * 1024 * 1024);
+    m_memBudget = std::make_unique<RGYParallelEncMemBudget>(memLimit);
+    AddMessage(RGY_LOG_DEBUG, _T("parallelRun: memory limit %d MB, ring %d MB\n"), (int)(memLimit >> 20), (int)(m_memBudget->ringLimit() >> 20));
     auto [sts, errmes ] = isParallelEncPossible(prm, input);
     if (sts != RGY_ERR_NONE
         || (sts = startParallelThreads(prm, input, outputTimebase, delayChildSync, encStatus, perfMonitor)) != RGY_ERR_NONE) {
         // 並列処理を無効化して続行する
         // まず終了させるため、スレッドの処理を続行させる
-        if (m_encProcess.size() > 0) {
-            m_encProcess.back()->sendEndPts(-1);
+        std::lock_guard<std::mutex> lock(m_encProcessMtx);
+        auto lastProc = std::find_if(m_encProcess.rbegin(), m_encProcess.rend(), [](const auto& proc) { return proc != nullptr; });
+        if (lastProc != m_encProcess.rend()) {
+            (*lastProc)->sendEndPts(-1);
         }
         m_encProcess.clear();
         prm->ctrl.parallelEnc.parallelCount = 0;
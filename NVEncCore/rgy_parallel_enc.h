@@ -32,6 +32,7 @@
 #include <thread>
 #include <optional>
 #include <mutex>
+#include <atomic>
 #include "rgy_osdep.h"
 #include "rgy_err.h"
 #include "rgy_event.h"
@@ -83,6 +84,29 @@ public:
     void reset();
 };
 
+static const int RGY_PARALLEL_ENC_MEM_RING_MB = 64; // 親が読み出し中のチャンクでキューにためる最大量
+
+// 並列エンコードで子から親へ転送中のデータのメモリ使用量を管理する (全チャンクで共有)
+class RGYParallelEncMemBudget {
+public:
+    RGYParallelEncMemBudget(const size_t limit);
+    bool tryAcquire(const size_t size); // 上限を超えない場合のみ確保する
+    void acquire(const size_t size);    // 上限に関わらず確保する
+    void release(const size_t size);
+    size_t limit() const { return m_limit; }
+    size_t used() const { return m_used; }
+    size_t ringLimit() const { return std::min<size_t>((size_t)RGY_PARALLEL_ENC_MEM_RING_MB * 1024 * 1024, m_limit / 2); }
+protected:
+    const size_t m_limit;
+    std::atomic<size_t> m_used;
+};
+
+enum class RGYParallelEncPacketDest {
+    Queue, // キューを介して親へ渡す
+    File,  // 一時ファイルに出力する
+    Abort, // 親が読み出しを中止した
+};
+
 enum class RGYParallelEncProcessStatus {
     Init,
     Running,
@@ -106,6 +130,13 @@ struct RGYParallelEncSendData {
     RGYQueueMPMP<RGYOutputRawPEExtHeader*> *qFirstProcessDataFree; // 転送し終わった(不要になった)ポインタを回収するキュー
     RGYQueueMPMP<RGYOutputRawPEExtHeader*> *qFirstProcessDataFreeLarge; // 転送し終わった(不要になった)ポインタを回収するキュー(大きいサイズ用)
 
+    RGYParallelEncMemBudget *memBudget; // 全チャンクで共有するメモリ使用量の上限 (nullptrなら無制限)
+    std::atomic<size_t> queuedSize;     // キューにためているデータ量
+    std::atomic<bool> readerActive;     // 親がこのチャンクのデータを読み出し中
+    std::atomic<bool> readerAbort;      // 親がデータの読み出しを中止した
+    std::atomic<bool> spilled;          // メモリの上限を超えたため、以降のデータを一時ファイルに出力した
+    unique_event eventPacketReleased;   // 親がパケットを読み出し終わった(キューが空いた)ことを子へ通知するイベント
+
     std::shared_ptr<RGYGPUCounterWin> perfCounter; // 親 → 子にperfCounterのインスタンスを渡す
 
     RGYParallelEncSendData() :
@@ -119,12 +150,24 @@ struct RGYParallelEncSendData {
         qFirstProcessData(nullptr),
         qFirstProcessDataFree(nullptr),
         qFirstProcessDataFreeLarge(nullptr),
+        memBudget(nullptr),
+        queuedSize(0),
+        readerActive(false),
+        readerAbort(false),
+        spilled(false),
+        eventPacketReleased(unique_event(nullptr, nullptr)),
         perfCounter() {};
+
+    // 子側: パケットをキューで渡すか、一時ファイルに出力するかを決める
+    // 親が読み出し中のチャンクはキューが空くまで待機し、それ以外のチャンクはメモリの上限を超えたら一時ファイルに切り替える
+    RGYParallelEncPacketDest reservePacket(const size_t size);
+    // 親側: 読み出し終わったパケットの分のメモリ使用量を戻す
+    void releasePacket(const size_t size);
 };
 
 class RGYParallelEncProcess {
 public:
-    RGYParallelEncProcess(const int id, const tstring& tmpfile, std::shared_ptr<RGYLog> log);
+    RGYParallelEncProcess(const int id, const tstring& tmpfile, RGYParallelEncMemBudget *memBudget, std::shared_ptr<RGYLog> log);
     ~RGYParallelEncProcess();
     RGY_ERR startThread(const encParams& peParams, CPerfMonitor *perfMonitor);
     RGY_ERR run(const encParams& peParams);
@@ -135,6 +178,8 @@ public:
     RGYParamParallelEncCache cacheMode() const { return m_cacheMode; }
     RGY_ERR getNextPacket(RGYOutputRawPEExtHeader **ptr);
     RGY_ERR putFreePacket(RGYOutputRawPEExtHeader *ptr);
+    void setReaderActive() { m_sendData.readerActive = true; }
+    bool spilled() const { return m_sendData.spilled; }
 
     int waitProcessFinished(const uint32_t timeout);
     std::optional<RGY_ERR> getThreadRunResult();
@@ -204,16 +249,23 @@ public:
     int64_t getVideofirstKeyPts(const int ichunk) const;
     RGY_ERR getNextPacket(const int ichunk, RGYOutputRawPEExtHeader **ptr);
     RGY_ERR putFreePacket(const int ichunk, RGYOutputRawPEExtHeader *ptr);
+    void setReaderActive(const int ichunk);
+    bool spilled(const int ichunk) const;
     RGYParamParallelEncCache cacheMode(const int ichunk) const;
     tstring tmpPath(const int ichunk) const;
     int parallelCount() const { return m_parallelCount; }
     int chunks() const { return m_chunks; }
 protected:
+    void initChunks(encParams *prm, const RGYInput *input);
     encParams genPEParam(const int ip, const encParams *prm, rgy_rational<int> outputTimebase, const bool delayChildSync, const tstring& tmpfile);
     RGY_ERR startChunkProcess(int ichunk, const encParams *prm, int64_t parentFirstKeyPts, rgy_rational<int> outputTimebase, const bool delayChildSync, EncodeStatus *encStatus, CPerfMonitor *perfMonitor);
     RGY_ERR startParallelThreads(const encParams *prm, const RGYInput *input, rgy_rational<int> outputTimebase, const bool delayChildSync, EncodeStatus *encStatus, CPerfMonitor *perfMonitor);
+    RGY_ERR runChunkScheduler(const int startId, const int parallelCount, const int chunkCount,
+        const encParams& prm, rgy_rational<int> outputTimebase, const bool delayChildSync, EncodeStatus *encStatus, CPerfMonitor *perfMonitor);
     RGY_ERR parallelChild(const encParams *prm, const RGYInput *input);
     RGYParamLogLevel setChildLogLevel(const RGYParamLogLevel& logLevel);
+    // 起動済みのチャンクのプロセス (未起動ならnullptr)
+    RGYParallelEncProcess *encProcess(const int ichunk) const;
 
     void AddMessage(RGYLogLevel log_level, const tstring &str) {
         if (m_log == nullptr || log_level < m_log->getLogLevel(RGY_LOGT_CORE_PARALLEL)) {
@@ -242,10 +294,14 @@ protected:
     }
 
     int m_id;
-    std::vector<std::unique_ptr<RGYParallelEncProcess>> m_encProcess;
+    std::unique_ptr<RGYParallelEncMemBudget> m_memBudget;
+    std::vector<std::unique_ptr<RGYParallelEncProcess>> m_encProcess; // チャンクごとのプロセス (未起動ならnullptr)
+    mutable std::mutex m_encProcessMtx; // m_encProcessの設定は親側の読み出しと並行して行われるので、ロックして設定/参照する
     std::shared_ptr<RGYLog> m_log;
     std::thread m_thParallelRun;
     bool m_thParallelRunAbort;
+    std::atomic<RGY_ERR> m_thParallelRunErr; // チャンクを起動するスレッドで発生したエラー
+    std::vector<float> m_chunkSeekRatio; // 各チャンクの開始位置 (空ならチャンク数で等分する)
     int64_t m_videoEndKeyPts;
     bool m_videoFinished;
     int m_parallelCount;
@@ -36,6 +36,7 @@
 #include <string>
 #include "rgy_status.h"
 #include "rgy_perf_monitor.h"
+#include "rgy_metrics.h"
 #include "rgy_resource.h"
 #include "cpu_info.h"
 #include "rgy_osdep.h"
@@ -453,8 +454,6 @@ CPerfMonitor::CPerfMonitor() :
     m_thEncThread(NULL),
     m_thInThread(NULL),
     m_thOutThread(NULL),
-    m_thAudProcThread(NULL),
-    m_thAudEncThread(NULL),
     m_nLogicalCPU(get_cpu_info().logical_cores),
     m_pEncStatus(),
     m_nEncStartTime(0),
@@ -470,6 +469,7 @@ CPerfMonitor::CPerfMonitor() :
     m_nSelectOutputLog(0),
     m_nSelectOutputPlot(0),
     m_QueueInfo(),
+    m_metrics(),
     m_pRGYLog(),
 #if ENABLE_METRIC_FRAMEWORK
     m_pLoader(nullptr),
@@ -488,6 +488,9 @@ CPerfMonitor::CPerfMonitor() :
     m_perfCounter(),
 #endif //#if ENABLE_PERF_COUNTER
     m_prefCounterValid(false)
+#if !(defined(_WIN32) || defined(_WIN64))
+    , m_procSampler()
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
 {
     memset(m_info, 0, sizeof(m_info));
     memset(&m_QueueInfo, 0, sizeof(m_QueueInfo));
@@ -511,11 +514,23 @@ void CPerfMonitor::clear() {
         m_thCheck.join();
         AddMessage(RGY_LOG_DEBUG, _T("Closed thread.\n"));
     }
+#if !(defined(_WIN32) || defined(_WIN64))
+    if (m_procSampler) {
+        writeThreadPMUSummary();
+        m_procSampler.reset();
+    }
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
 #if ENABLE_PERF_COUNTER
     AddMessage(RGY_LOG_DEBUG, _T("Closing perf counter...\n"));
     m_perfCounter.reset();
     AddMessage(RGY_LOG_DEBUG, _T("Closed perf counter.\n"));
 #endif //#if ENABLE_PERF_COUNTER
+    if (m_QueueInfo.pkt_pool_alloc + m_QueueInfo.pkt_payload_alloc > 0) {
+        AddMessage(RGY_LOG_DEBUG, _T("packet pool: packets allocated %llu, reused %llu, payloads allocated %llu, reused %llu.\n"),
+            (unsigned long long)m_QueueInfo.pkt_pool_alloc, (unsigned long long)m_QueueInfo.pkt_pool_reuse,
+            (unsigned long long)m_QueueInfo.pkt_payload_alloc, (unsigned long long)m_QueueInfo.pkt_payload_reuse);
+    }
+    m_metrics.reset();
     memset(m_info, 0, sizeof(m_info));
     memset(&m_QueueInfo, 0, sizeof(m_QueueInfo));
 #if ENABLE_METRIC_FRAMEWORK
@@ -533,7 +548,6 @@ void CPerfMonitor::clear() {
 
     m_nStep = 0;
     m_thMainThread.reset();
-    m_thAudProcThread = NULL;
     m_thEncThread = NULL;
     m_thOutThread = NULL;
     m_bAbort = false;
@@ -547,6 +561,25 @@ void CPerfMonitor::clear() {
     m_pRGYLog.reset();
 }
 
+#if !(defined(_WIN32) || defined(_WIN64))
+void CPerfMonitor::writeThreadPMUSummary() {
+    if (m_procSampler->pmuError() != 0) {
+        AddMessage(RGY_LOG_DEBUG, _T("PMU counters not available: %s.\n"), char_to_tstring(strerror(m_procSampler->pmuError())).c_str());
+    }
+    auto threads = m_procSampler->exitedThreads();
+    threads.insert(threads.end(), m_procSampler->threads().begin(), m_procSampler->threads().end());
+    for (const auto& th : threads) {
+        if (!th.pmu_valid) continue;
+        AddMessage(RGY_LOG_DEBUG, _T("thread %-12s: cycles %14llu, instructions %14llu (IPC %.2f), cache misses %12llu (%.2f MPKI)\n"),
+            char_to_tstring(th.name).c_str(),
+            (unsigned long long)th.cycles, (unsigned long long)th.instructions,
+            (th.cycles > 0) ? th.instructions / (double)th.cycles : 0.0,
+            (unsigned long long)th.cache_misses,
+            (th.instructions > 0) ? th.cache_misses * 1000.0 / th.instructions : 0.0);
+    }
+}
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
+
 void CPerfMonitor::send_thread_fin() {
     m_bAbort = true;
 #if ENABLE_PERF_COUNTER
@@ -642,6 +675,15 @@ std::string CPerfMonitor::write_header(int nSelect) {
     if (nSelect & PERF_MONITOR_QUEUE_AUD_OUT) {
         str += ",queue aud out";
     }
+    if (nSelect & PERF_MONITOR_OUT_INFLIGHT) {
+        str += ",out inflight (KB)";
+    }
+    if (nSelect & PERF_MONITOR_OUT_LATENCY) {
+        str += ",out latency (ms)";
+    }
+    if (nSelect & PERF_MONITOR_IN_PREFETCH) {
+        str += ",in prefetch hit (%),in prefetch stall (ms)";
+    }
     if (nSelect & PERF_MONITOR_MEM_PRIVATE) {
         str += ",mem private (MB)";
     }
@@ -700,9 +742,21 @@ int CPerfMonitor::init(tstring filename, const TCHAR *pPythonPath,
     std::shared_ptr<RGYLog> pRGYLog, CPerfMonitorPrm *prm) {
     m_pRGYLog = pRGYLog;
     m_luid = prm->luid;
+    m_metrics = prm->metrics;
     m_pid = GetCurrentProcessId();
 
+#if defined(_WIN32) || defined(_WIN64)
     m_nCreateTime100ns = (int64_t)(clock() * (1e7 / CLOCKS_PER_SEC) + 0.5);
+#else
+    // clock()はプロセスのCPU時間なので、経過時間には使えない
+    m_nCreateTime100ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 100;
+    m_procSampler = std::make_unique<RGYProcSampler>();
+    // PMUのカウンタはperf monitorのログレベルがdebugの場合のみ取得し、終了時にスレッドごとに表示する
+    const bool enablePMU = m_pRGYLog && m_pRGYLog->getLogLevel(RGY_LOGT_PERF_MONITOR) <= RGY_LOG_DEBUG;
+    if (m_procSampler->init(enablePMU)) {
+        AddMessage(RGY_LOG_WARN, _T("Failed to open /proc/self, memory and io info will not be available.\n"));
+    }
+#endif //#if defined(_WIN32) || defined(_WIN64)
     m_sMonitorFilename = filename;
     m_nInterval = interval;
     m_nSelectOutputPlot = nSelectOutputPlot;
@@ -855,12 +909,6 @@ int CPerfMonitor::init(tstring filename, const TCHAR *pPythonPath,
 
     //未実装
 #if !(defined(_WIN32) || defined(_WIN64))
-    m_nSelectCheck &= (~PERF_MONITOR_THREAD_MAIN);
-    m_nSelectCheck &= (~PERF_MONITOR_THREAD_ENC);
-    m_nSelectCheck &= (~PERF_MONITOR_THREAD_AUDP);
-    m_nSelectCheck &= (~PERF_MONITOR_THREAD_AUDE);
-    m_nSelectCheck &= (~PERF_MONITOR_THREAD_OUT);
-    m_nSelectCheck &= (~PERF_MONITOR_THREAD_IN);
     m_nSelectCheck &= (~PERF_MONITOR_GPU_CLOCK);
     m_nSelectCheck &= (~PERF_MONITOR_GPU_LOAD);
     m_nSelectCheck &= (~PERF_MONITOR_MFX_LOAD);
@@ -899,12 +947,10 @@ void CPerfMonitor::SetEncStatus(std::shared_ptr<EncodeStatus> encStatus) {
     m_nOutputFPSRate = data.outputFPSRate;
 }
 
-void CPerfMonitor::SetThreadHandles(HANDLE thEncThread, HANDLE thInThread, HANDLE thOutThread, HANDLE thAudProcThread, HANDLE thAudEncThread) {
+void CPerfMonitor::SetThreadHandles(HANDLE thEncThread, HANDLE thInThread, HANDLE thOutThread) {
     m_thEncThread = thEncThread;
     m_thInThread = thInThread;
     m_thOutThread = thOutThread;
-    m_thAudProcThread = thAudProcThread;
-    m_thAudEncThread = thAudEncThread;
 }
 
 void CPerfMonitor::check() {
@@ -1035,54 +1081,23 @@ void CPerfMonitor::check() {
 #endif //#if ENABLE_PERF_COUNTER
 
 #if !(defined(_WIN32) || defined(_WIN64))
-    struct rusage usage = { 0 };
-    getrusage(RUSAGE_SELF, &usage);
-
-    //現在時間
+    //現在時間 (fps_avgの計算用、EncodeStatusの開始時刻と合わせてclock()を使う)
     uint64_t current_time = clock() * (1e7 / CLOCKS_PER_SEC);
 
-    std::string proc_dir = strsprintf("/proc/%d/", (int)getpid());
-    //メモリ情報
-    FILE *fp_mem = popen((std::string("cat ") + proc_dir + std::string("status")).c_str(), "r");
-    if (fp_mem) {
-        char buffer[2048] = { 0 };
-        while (NULL != fgets(buffer, _countof(buffer), fp_mem)) {
-            if (nullptr != strstr(buffer, "VmSize")) {
-                long long i = 0;
-                if (1 == sscanf(buffer, "VmSize: %lld kB", &i)) {
-                    pInfoNew->mem_virtual = i << 10;
-                }
-            } else if (nullptr != strstr(buffer, "VmRSS")) {
-                long long i = 0;
-                if (1 == sscanf(buffer, "VmRSS: %lld kB", &i)) {
-                    pInfoNew->mem_private = i << 10;
-                }
-            }
-        }
-        pclose(fp_mem);
+    RGYProcInfo procInfo = { 0 };
+    if (m_procSampler) {
+        m_procSampler->sample(&procInfo);
     }
+    //メモリ情報
+    pInfoNew->mem_virtual = procInfo.mem_virtual;
+    pInfoNew->mem_private = procInfo.mem_private;
     //IO情報
-    FILE *fp_io = popen((std::string("cat ") + proc_dir + std::string("io")).c_str(), "r");
-    if (fp_io) {
-        char buffer[2048] = { 0 };
-        while (NULL != fgets(buffer, _countof(buffer), fp_io)) {
-            if (nullptr != strstr(buffer, "rchar:")) {
-                long long i = 0;
-                if (1 == sscanf(buffer, "rchar: %lld", &i)) {
-                    pInfoNew->io_total_read = i;
-                }
-            } else if (nullptr != strstr(buffer, "wchar")) {
-                long long i = 0;
-                if (1 == sscanf(buffer, "wchar: %lld", &i)) {
-                    pInfoNew->io_total_write = i;
-                }
-            }
-        }
-        pclose(fp_io);
-    }
+    pInfoNew->io_total_read = procInfo.io_total_read;
+    pInfoNew->io_total_write = procInfo.io_total_write;
 
     //CPU情報
-    pInfoNew->time_us = (current_time - m_nCreateTime100ns) / 10;
+    const int64_t elapsed_100ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 100;
+    pInfoNew->time_us = (elapsed_100ns - m_nCreateTime100ns) / 10;
     const double time_diff_inv = 1.0 / (pInfoNew->time_us - pInfoOld->time_us);
 #endif
 
@@ -1091,10 +1106,8 @@ void CPerfMonitor::check() {
         pInfoNew->cpu_total_us = (pt.user + pt.kernel) / 10;
         pInfoNew->cpu_total_kernel_us = pt.kernel / 10;
 #else
-        int64_t cpu_user_us = usage.ru_utime.tv_sec * 1000000 + usage.ru_utime.tv_usec;
-        int64_t cpu_kernel_us = usage.ru_stime.tv_sec * 1000000 + usage.ru_stime.tv_usec;
-        pInfoNew->cpu_total_us = cpu_user_us + cpu_kernel_us;
-        pInfoNew->cpu_total_kernel_us = cpu_kernel_us;
+        pInfoNew->cpu_total_us = procInfo.cpu_user_us + procInfo.cpu_kernel_us;
+        pInfoNew->cpu_total_kernel_us = procInfo.cpu_kernel_us;
 #endif //#if defined(_WIN32) || defined(_WIN64)
 
         //CPU使用率
@@ -1125,28 +1138,6 @@ void CPerfMonitor::check() {
             }
         }
 
-        if (m_thAudProcThread) {
-            DWORD exit_code = 0;
-            if (0 != GetExitCodeThread(m_thAudProcThread, &exit_code) && exit_code == STILL_ACTIVE) {
-                getThreadTime(m_thAudProcThread, &pt);
-                pInfoNew->aud_proc_thread_total_active_us = (pt.user + pt.kernel) / 10;
-                pInfoNew->aud_proc_thread_percent  = (pInfoNew->aud_proc_thread_total_active_us  - pInfoOld->aud_proc_thread_total_active_us) * 100.0 * logical_cpu_inv * time_diff_inv;
-            } else {
-                pInfoNew->aud_proc_thread_percent = 0.0;
-            }
-        }
-
-        if (m_thAudEncThread) {
-            DWORD exit_code = 0;
-            if (0 != GetExitCodeThread(m_thAudEncThread, &exit_code) && exit_code == STILL_ACTIVE) {
-                getThreadTime(m_thAudEncThread, &pt);
-                pInfoNew->aud_enc_thread_total_active_us = (pt.user + pt.kernel) / 10;
-                pInfoNew->aud_enc_thread_percent  = (pInfoNew->aud_enc_thread_total_active_us  - pInfoOld->aud_enc_thread_total_active_us) * 100.0 * logical_cpu_inv * time_diff_inv;
-            } else {
-                pInfoNew->aud_enc_thread_percent = 0.0;
-            }
-        }
-
         if (m_thInThread) {
             DWORD exit_code = 0;
             if (0 != GetExitCodeThread(m_thInThread, &exit_code) && exit_code == STILL_ACTIVE) {
@@ -1168,7 +1159,37 @@ void CPerfMonitor::check() {
                 pInfoNew->out_thread_percent = 0.0;
             }
         }
+#else
+        //スレッドCPU使用率 (スレッド名で識別し、同じ名前のスレッドは合算する)
+        struct ThreadCPUTarget {
+            const char *name; // nullptrならメインスレッド
+            int64_t PerfInfo::*total_us;
+            double PerfInfo::*percent;
+        };
+        static const ThreadCPUTarget threadTargets[] = {
+            { nullptr,                  &PerfInfo::main_thread_total_active_us,     &PerfInfo::main_thread_percent },
+            { RGY_THREAD_NAME_ENC,      &PerfInfo::enc_thread_total_active_us,      &PerfInfo::enc_thread_percent },
+            { RGY_THREAD_NAME_OUTPUT,   &PerfInfo::out_thread_total_active_us,      &PerfInfo::out_thread_percent },
+            { RGY_THREAD_NAME_INPUT,    &PerfInfo::in_thread_total_active_us,       &PerfInfo::in_thread_percent },
+        };
+        if (m_procSampler) {
+            for (const auto& target : threadTargets) {
+                pInfoNew->*target.total_us = 0;
+                for (const auto& th : m_procSampler->threads()) {
+                    if ((target.name) ? th.name == target.name : th.tid == (pid_t)m_pid) {
+                        pInfoNew->*target.total_us += th.cpu_total_us;
+                    }
+                }
+                // スレッドが終了すると合計値が減るので、負にならないようにする
+                pInfoNew->*target.percent = std::max(0.0, (pInfoNew->*target.total_us - pInfoOld->*target.total_us) * 100.0 * logical_cpu_inv * time_diff_inv);
+            }
+        }
 #endif //defined(_WIN32) || defined(_WIN64)
+        //音声処理/音声エンコードはスレッドプール上で実行されるので、出力側で集計したCPU時間を使う
+        pInfoNew->aud_proc_thread_total_active_us = (int64_t)m_QueueInfo.aud_proc_cpu_us;
+        pInfoNew->aud_enc_thread_total_active_us  = (int64_t)m_QueueInfo.aud_enc_cpu_us;
+        pInfoNew->aud_proc_thread_percent = std::max(0.0, (pInfoNew->aud_proc_thread_total_active_us - pInfoOld->aud_proc_thread_total_active_us) * 100.0 * logical_cpu_inv * time_diff_inv);
+        pInfoNew->aud_enc_thread_percent  = std::max(0.0, (pInfoNew->aud_enc_thread_total_active_us  - pInfoOld->aud_enc_thread_total_active_us)  * 100.0 * logical_cpu_inv * time_diff_inv);
     }
 
     if (!m_bEncStarted && m_pEncStatus) {
@@ -1269,6 +1290,16 @@ std::string CPerfMonitor::write(int nSelect) {
     if (nSelect & PERF_MONITOR_QUEUE_AUD_OUT) {
         str += strsprintf(",%d", (int)m_QueueInfo.usage_aud_out);
     }
+    if (nSelect & PERF_MONITOR_OUT_INFLIGHT) {
+        str += strsprintf(",%.1lf", m_QueueInfo.out_bytes_in_flight / 1024.0);
+    }
+    if (nSelect & PERF_MONITOR_OUT_LATENCY) {
+        str += strsprintf(",%.3lf", m_QueueInfo.out_write_latency_us / 1000.0);
+    }
+    if (nSelect & PERF_MONITOR_IN_PREFETCH) {
+        str += strsprintf(",%.2lf", (m_QueueInfo.in_prefetch_access > 0) ? m_QueueInfo.in_prefetch_hit * 100.0 / m_QueueInfo.in_prefetch_access : 0.0);
+        str += strsprintf(",%.3lf", m_QueueInfo.in_prefetch_stall_us / 1000.0);
+    }
     if (nSelect & PERF_MONITOR_MEM_PRIVATE) {
         str += strsprintf(",%.2lf", pInfo->mem_private / (double)(1024 * 1024));
     }
@@ -1309,6 +1340,7 @@ void CPerfMonitor::loader(void *prm) {
 
 void CPerfMonitor::run() {
     m_threadParam.apply(GetCurrentThread());
+    RGYSetCurrentThreadName(RGY_THREAD_NAME_PERF_MON);
     AddMessage(RGY_LOG_DEBUG, _T("Set perf monitor thread param %s.\n"), m_threadParam.desc().c_str());
     while (!m_bAbort) {
         auto timenow = std::chrono::system_clock::now();
@@ -1327,6 +1359,7 @@ void CPerfMonitor::run() {
                 m_pProcess->stdInFpWrite(str.c_str(), str.length());
                 m_pProcess->stdInFpFlush();
             }
+            updateMetrics(false);
             m_refreshedTime = timenow;
         }
         std::this_thread::sleep_for(std::chrono::milliseconds((m_nInterval <= 100) ? m_nInterval : 50));
@@ -1339,4 +1372,18 @@ void CPerfMonitor::run() {
         m_pProcess->stdInFpFlush();
         m_pProcess->close();
     }
+    updateMetrics(true);
+}
+
+void CPerfMonitor::updateMetrics(bool finished) {
+    if (!m_metrics) {
+        return;
+    }
+    EncodeStatusData status;
+    memset(&status, 0, sizeof(status));
+    if (m_pEncStatus) {
+        status = m_pEncStatus->GetEncodeData();
+    }
+    const PerfQueueInfo queue = m_QueueInfo;
+    m_metrics->update(status, m_info[m_nStep & 1], queue, finished);
 }
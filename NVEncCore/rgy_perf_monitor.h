@@ -42,6 +42,7 @@
 #include "gpuz_info.h"
 #include "rgy_util.h"
 #include "rgy_thread_affinity.h"
+#include "rgy_proc_sampler.h"
 
 #if ENABLE_PERF_COUNTER
 #include "rgy_perf_counter.h"
@@ -70,6 +71,7 @@ typedef void * HANDLE;
 #endif
 
 class EncodeStatus;
+class RGYMetrics;
 
 enum : int {
     PERF_MONITOR_CPU           = 0x00000001,
@@ -101,6 +103,9 @@ enum : int {
     PERF_MONITOR_VEE_LOAD      = 0x04000000,
     PERF_MONITOR_VED_LOAD      = 0x08000000,
     PERF_MONITOR_PCIE_LOAD     = 0x10000000,
+    PERF_MONITOR_OUT_INFLIGHT  = 0x20000000,
+    PERF_MONITOR_OUT_LATENCY   = 0x40000000,
+    PERF_MONITOR_IN_PREFETCH   = (int)0x80000000,
     PERF_MONITOR_ALL         = (int)UINT_MAX,
 };
 
@@ -122,6 +127,10 @@ static const CX_DESC list_pref_monitor[] = {
     { _T("io"),          PERF_MONITOR_IO_READ | PERF_MONITOR_IO_WRITE },
     { _T("io_read"),     PERF_MONITOR_IO_READ },
     { _T("io_write"),    PERF_MONITOR_IO_WRITE },
+    { _T("out_async"),   PERF_MONITOR_OUT_INFLIGHT | PERF_MONITOR_OUT_LATENCY },
+    { _T("out_inflight"),PERF_MONITOR_OUT_INFLIGHT },
+    { _T("out_latency"), PERF_MONITOR_OUT_LATENCY },
+    { _T("in_prefetch"), PERF_MONITOR_IN_PREFETCH },
     { _T("fps"),         PERF_MONITOR_FPS },
     { _T("fps_avg"),     PERF_MONITOR_FPS_AVG },
     { _T("bitrate"),     PERF_MONITOR_BITRATE },
@@ -211,6 +220,17 @@ struct PerfQueueInfo {
     size_t usage_aud_out;
     size_t usage_aud_enc;
     size_t usage_aud_proc;
+    size_t out_bytes_in_flight;  //非同期出力で書き込み中のデータ量
+    size_t out_write_latency_us; //非同期出力の直近の書き込みのレイテンシ
+    size_t in_prefetch_hit;      //入力の先読みで、読み込み時に先読みが完了していた回数
+    size_t in_prefetch_access;   //入力の先読みで、読み込みを行った回数
+    size_t in_prefetch_stall_us; //入力の先読みが間に合わず待機した時間の合計
+    size_t pkt_pool_alloc;       //AVPacketのpoolで、新たに確保した数
+    size_t pkt_pool_reuse;       //AVPacketのpoolで、再利用した数
+    size_t pkt_payload_alloc;    //AVPacketのpoolで、データ部分を新たに確保した数
+    size_t pkt_payload_reuse;    //AVPacketのpoolで、データ部分を再利用した数
+    size_t aud_proc_cpu_us;      //音声処理 (スレッドプール上で実行) に使ったCPU時間の合計
+    size_t aud_enc_cpu_us;       //音声エンコード (スレッドプール上で実行) に使ったCPU時間の合計
 };
 
 #if ENABLE_METRIC_FRAMEWORK
@@ -368,13 +388,14 @@ struct CPerfMonitorPrm {
     std::string pciBusId;
 #endif
     LUID luid;
+    std::shared_ptr<RGYMetrics> metrics; // 取得した値の出力先 (不要ならnullptr)
     char reserved[256];
 
     CPerfMonitorPrm() :
 #if ENABLE_NVML
         pciBusId(),
 #endif
-        luid({ 0 }), reserved() {};
+        luid({ 0 }), metrics(), reserved() {};
 };
 
 class CPerfMonitor {
@@ -388,7 +409,7 @@ public:
     ~CPerfMonitor();
 
     void SetEncStatus(std::shared_ptr<EncodeStatus> encStatus);
-    void SetThreadHandles(HANDLE thEncThread, HANDLE thInThread, HANDLE thOutThread, HANDLE thAudProcThread, HANDLE thAudEncThread);
+    void SetThreadHandles(HANDLE thEncThread, HANDLE thInThread, HANDLE thOutThread);
     PerfQueueInfo *GetQueueInfoPtr() {
         return &m_QueueInfo;
     }
@@ -441,10 +462,14 @@ public:
     void send_thread_fin();
 protected:
     int createPerfMpnitorPyw(const TCHAR *pywPath);
+#if !(defined(_WIN32) || defined(_WIN64))
+    void writeThreadPMUSummary();
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
     void check();
     void run();
     std::string write_header(int nSelect);
     std::string write(int nSelect);
+    void updateMetrics(bool finished);
 
     void AddMessage(RGYLogLevel log_level, const tstring &str) {
         if (m_pRGYLog == nullptr || log_level < m_pRGYLog->getLogLevel(RGY_LOGT_PERF_MONITOR)) {
@@ -488,8 +513,6 @@ protected:
     HANDLE m_thEncThread;
     HANDLE m_thInThread;
     HANDLE m_thOutThread;
-    HANDLE m_thAudProcThread;
-    HANDLE m_thAudEncThread;
     int m_nLogicalCPU;
     std::shared_ptr<EncodeStatus> m_pEncStatus;
     int64_t m_nEncStartTime;
@@ -505,6 +528,7 @@ protected:
     int m_nSelectOutputLog;
     int m_nSelectOutputPlot;
     PerfQueueInfo m_QueueInfo;
+    std::shared_ptr<RGYMetrics> m_metrics;
     std::shared_ptr<RGYLog> m_pRGYLog;
     RGYParamThread m_threadParam;
 
@@ -526,6 +550,9 @@ protected:
     std::shared_ptr<RGYGPUCounterWin> m_perfCounter;
 #endif
     bool m_prefCounterValid;
+#if !(defined(_WIN32) || defined(_WIN64))
+    std::unique_ptr<RGYProcSampler> m_procSampler;
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
 };
 
 
@@ -0,0 +1,460 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_PIPELINE_EXECUTOR_H__
+#define __RGY_PIPELINE_EXECUTOR_H__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <optional>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <condition_variable>
+#include "rgy_tchar.h"
+#include "rgy_util.h"
+#include "rgy_err.h"
+#include "rgy_log.h"
+
+// パイプラインの段と段の間をつなぐ、上限付きのキュー (1つの段が追加し、次の段が取り出す)
+// 上限に達した場合は、取り出されて空きができるまで追加側を待機させる
+template<typename TOutput>
+class RGYPipelineStageQueue {
+public:
+    RGYPipelineStageQueue(size_t capacity) : m_mtx(), m_cvPush(), m_cvPop(), m_queue(), m_capacity(std::max<size_t>(capacity, 1)), m_eos(false), m_closed(false), m_abort(false) {};
+    ~RGYPipelineStageQueue() {};
+
+    // 空きができるまで待機して追加する
+    // 取り出し側が終了している場合はRGY_ERR_MORE_BITSTREAM、中断された場合はRGY_ERR_ABORTEDを返す
+    RGY_ERR push(std::unique_ptr<TOutput>& data) {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_cvPop.wait(lock, [&]() { return m_abort || m_closed || m_queue.size() < m_capacity; });
+        if (m_abort) return RGY_ERR_ABORTED;
+        if (m_closed) return RGY_ERR_MORE_BITSTREAM;
+        m_queue.push_back(std::move(data));
+        m_cvPush.notify_one();
+        return RGY_ERR_NONE;
+    }
+    // これ以上追加しないことを通知する
+    void pushEOS() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_eos = true;
+        m_cvPush.notify_one();
+    }
+    // 先頭のデータを取り出す (最大timeoutMs待機する)
+    // RGY_ERR_NONE: 取り出した, RGY_ERR_MORE_DATA: タイムアウト, RGY_ERR_MORE_BITSTREAM: 終端, RGY_ERR_ABORTED: 中断
+    RGY_ERR pop(std::unique_ptr<TOutput>& data, const int timeoutMs) {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_cvPush.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]() { return m_abort || m_eos || m_queue.size() > 0; });
+        if (m_abort) return RGY_ERR_ABORTED;
+        if (m_queue.size() == 0) {
+            return (m_eos) ? RGY_ERR_MORE_BITSTREAM : RGY_ERR_MORE_DATA;
+        }
+        data = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_cvPop.notify_one();
+        return RGY_ERR_NONE;
+    }
+    // 取り出し側が終了したので、以降の追加を受け付けない
+    void close() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_closed = true;
+        m_cvPop.notify_all();
+    }
+    void abort() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_abort = true;
+        m_cvPush.notify_all();
+        m_cvPop.notify_all();
+    }
+    void clear() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_queue.clear();
+    }
+    size_t size() {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_queue.size();
+    }
+    size_t capacity() const { return m_capacity; }
+protected:
+    std::mutex m_mtx;
+    std::condition_variable m_cvPush; // 取り出し側の起床用
+    std::condition_variable m_cvPop;  // 追加側の起床用
+    std::deque<std::unique_ptr<TOutput>> m_queue;
+    size_t m_capacity;
+    bool m_eos;
+    bool m_closed;
+    bool m_abort;
+};
+
+// パイプラインのtaskを段に分け、各段を別スレッドで実行する
+// 通常は1スレッドで深さ優先に処理しているtaskを、段ごとに並行して処理できるようにする
+// 各段は、段内のtaskを従来と同じ順序で処理し、最後のtaskの出力を次の段のキューに渡す
+// 入力の終端に達した段は、段内のtaskを前方から順にflushしたのち、次の段に終端を通知する
+// 最終段の出力は、run()を呼び出したスレッドで書き出す
+// TTaskは、PipelineTaskと同様に sendFrameTrace/getOutputTrace/setOutputMaxQueueSize/print を持つこと
+template<typename TTask, typename TOutput>
+class RGYPipelineExecutor {
+public:
+    // 各段の設定
+    struct StageParam {
+        size_t taskStart;  // 段の最初のtaskのインデックス (次の段の最初のtaskの手前までがこの段のtask)
+        size_t queueSize;  // 前の段からの入力キューのサイズ (最初の段では無視する)
+    };
+    // run()で使用するコールバック
+    struct Callbacks {
+        std::function<bool(size_t itask)> requireSync;          // itaskの出力を次のtaskに渡す前に同期が必要か
+        std::function<void()> waitInput;                        // 最初の段で入力を取得する前に呼ぶ (速度制限用)
+        std::function<void(size_t istage)> threadInit;          // 各段のスレッドの開始時に呼ぶ
+        std::function<bool(bool flushing)> checkAbort;          // run()を呼び出したスレッドで定期的に呼び、trueなら中断する
+        std::function<RGY_ERR(std::unique_ptr<TOutput>&)> write; // 最終段の出力を書き出す (run()を呼び出したスレッドで呼ぶ)
+    };
+    static const int WAIT_INTERVAL_MS = 16;
+
+    RGYPipelineExecutor(std::shared_ptr<RGYLog> log) :
+        m_tasks(), m_stages(), m_lockWriter(), m_outputQueueSize(1), m_queues(), m_threads(), m_callbacks(), m_writerMtx(), m_errMtx(), m_err(RGY_ERR_NONE), m_abort(false), m_flushing(false), m_log(log) {};
+    ~RGYPipelineExecutor() {
+        abort(RGY_ERR_ABORTED);
+        joinThreads();
+    }
+
+    // tasks: パイプラインのtask, stages: 段の分割
+    // lockWriter: 書き出し処理と排他して実行する必要のあるtask (音声の出力など)
+    // outputQueueSize: 最終段の出力を書き出しに渡すキューのサイズ
+    RGY_ERR init(const std::vector<TTask *>& tasks, const std::vector<StageParam>& stages, const std::vector<bool>& lockWriter, const size_t outputQueueSize) {
+        if (tasks.size() == 0 || stages.size() == 0 || stages.front().taskStart != 0 || lockWriter.size() != tasks.size()) {
+            return RGY_ERR_INVALID_PARAM;
+        }
+        for (size_t i = 1; i < stages.size(); i++) {
+            if (stages[i].taskStart <= stages[i - 1].taskStart || stages[i].taskStart >= tasks.size()) {
+                return RGY_ERR_INVALID_PARAM;
+            }
+        }
+        m_tasks = tasks;
+        m_stages = stages;
+        m_lockWriter = lockWriter;
+        m_outputQueueSize = outputQueueSize;
+        return RGY_ERR_NONE;
+    }
+    size_t stageCount() const { return m_stages.size(); }
+    size_t stageTaskStart(size_t istage) const { return m_stages[istage].taskStart; }
+    size_t stageTaskEnd(size_t istage) const { return (istage + 1 < m_stages.size()) ? m_stages[istage + 1].taskStart : m_tasks.size(); }
+    size_t stageQueueSize(size_t istage) const { return (istage > 0) ? m_stages[istage].queueSize : 0; }
+
+    // 各段のスレッドを起動し、最終段の出力を書き出しながら全段の終了を待つ
+    RGY_ERR run(const Callbacks& callbacks) {
+        m_callbacks = callbacks;
+        m_err = RGY_ERR_NONE;
+        m_abort = false;
+        m_flushing = false;
+        // m_queues[istage]: istageの段への入力キュー (m_queues[0]は使用しない)
+        // m_queues[stageCount()]: 最終段の出力キュー
+        m_queues.clear();
+        for (size_t istage = 0; istage <= m_stages.size(); istage++) {
+            const size_t queueSize = (istage == 0) ? 0 : (istage < m_stages.size()) ? m_stages[istage].queueSize : m_outputQueueSize;
+            m_queues.push_back(std::make_unique<RGYPipelineStageQueue<TOutput>>(queueSize));
+        }
+        for (size_t istage = 0; istage < m_stages.size(); istage++) {
+            m_threads.push_back(std::thread([this, istage]() {
+                if (m_callbacks.threadInit) {
+                    m_callbacks.threadInit(istage);
+                }
+                auto err = RGY_ERR_NONE;
+                try {
+                    err = runStage(istage);
+                } catch (const std::exception& e) {
+                    PrintMes(RGY_LOG_ERROR, _T("Pipeline stage #%d failed: %s.\n"), (int)istage, char_to_tstring(e.what()).c_str());
+                    err = RGY_ERR_UNKNOWN;
+                } catch (...) {
+                    PrintMes(RGY_LOG_ERROR, _T("Pipeline stage #%d failed.\n"), (int)istage);
+                    err = RGY_ERR_UNKNOWN;
+                }
+                if (!(err == RGY_ERR_NONE || err == RGY_ERR_MORE_DATA || err == RGY_ERR_MORE_SURFACE || err == RGY_ERR_MORE_BITSTREAM)) {
+                    abort(err);
+                }
+            }));
+        }
+        // 最終段の出力を書き出す
+        auto& queueOut = m_queues.back();
+        for (;;) {
+            if (m_callbacks.checkAbort && m_callbacks.checkAbort(m_flushing)) {
+                abort(RGY_ERR_ABORTED);
+            }
+            std::unique_ptr<TOutput> data;
+            auto err = queueOut->pop(data, WAIT_INTERVAL_MS);
+            if (err == RGY_ERR_MORE_DATA) {
+                continue;
+            } else if (err != RGY_ERR_NONE) {
+                break; // 終端または中断
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_writerMtx);
+                err = m_callbacks.write(data);
+            }
+            if (err != RGY_ERR_NONE) {
+                abort(err);
+                break;
+            }
+        }
+        queueOut->close();
+        joinThreads();
+        // エラー終了の場合も含めキューをすべて開放する (taskを解放する前に行う)
+        m_queues.clear();
+        m_callbacks = Callbacks();
+        return m_err;
+    }
+protected:
+    struct TaskData {
+        size_t task;
+        std::unique_ptr<TOutput> data;
+        TaskData(size_t t) : task(t), data() {};
+        TaskData(size_t t, std::unique_ptr<TOutput>& d) : task(t), data(std::move(d)) {};
+    };
+
+    // 最初に発生したエラーを記録し、全段を中断する
+    void abort(RGY_ERR err) {
+        {
+            std::lock_guard<std::mutex> lock(m_errMtx);
+            if (m_err == RGY_ERR_NONE) {
+                m_err = err;
+            }
+        }
+        m_abort = true;
+        for (auto& q : m_queues) {
+            q->abort();
+        }
+    }
+    void joinThreads() {
+        for (auto& th : m_threads) {
+            if (th.joinable()) {
+                th.join();
+            }
+        }
+        m_threads.clear();
+    }
+    RGY_ERR sendFrame(const size_t itask, std::unique_ptr<TOutput>& data) {
+        std::optional<std::lock_guard<std::mutex>> lock;
+        if (m_lockWriter[itask]) {
+            lock.emplace(m_writerMtx);
+        }
+        return m_tasks[itask]->sendFrameTrace(data);
+    }
+    std::vector<std::unique_ptr<TOutput>> getOutput(const size_t itask) {
+        const bool sync = m_callbacks.requireSync && m_callbacks.requireSync(itask);
+        std::optional<std::lock_guard<std::mutex>> lock;
+        if (m_lockWriter[itask]) {
+            lock.emplace(m_writerMtx);
+        }
+        return m_tasks[itask]->getOutputTrace(sync);
+    }
+    // 出力されたものは先頭に追加していく
+    static void pushFront(std::deque<TaskData>& dataqueue, const size_t itask, std::vector<std::unique_ptr<TOutput>>& output) {
+        std::for_each(output.rbegin(), output.rend(), [itask, &dataqueue](auto&& o) {
+            dataqueue.push_front(TaskData(itask + 1, o));
+        });
+    }
+    // 段内のtaskを前方からひとつづつ出力が残っていないかチェック(主にcheckptsの処理のため)
+    bool checkRemainingOutput(std::deque<TaskData>& dataqueue, const size_t taskStart, const size_t taskEnd) {
+        for (size_t itask = taskStart; itask < taskEnd; itask++) {
+            auto output = getOutput(itask);
+            if (output.size() > 0) {
+                pushFront(dataqueue, itask, output);
+                //checkptsの処理上、でてきたフレームはすぐに後続処理に渡したいのでbreak
+                return true;
+            }
+        }
+        return false;
+    }
+
+    RGY_ERR runStage(const size_t istage) {
+        const size_t taskStart = stageTaskStart(istage);
+        const size_t taskEnd = stageTaskEnd(istage);
+        auto queueIn = (istage > 0) ? m_queues[istage].get() : nullptr;
+        auto queueOut = m_queues[istage + 1].get();
+        auto setloglevel = [](RGY_ERR err) {
+            if (err == RGY_ERR_NONE || err == RGY_ERR_MORE_DATA || err == RGY_ERR_MORE_SURFACE || err == RGY_ERR_MORE_BITSTREAM) return RGY_LOG_DEBUG;
+            if (err > RGY_ERR_NONE) return RGY_LOG_WARN;
+            return RGY_LOG_ERROR;
+        };
+
+        std::deque<TaskData> dataqueue;
+        RGY_ERR err = RGY_ERR_NONE;
+        {
+            auto checkContinue = [this](RGY_ERR& err) {
+                if (m_abort) { err = RGY_ERR_ABORTED; return false; }
+                return err >= RGY_ERR_NONE || err == RGY_ERR_MORE_DATA || err == RGY_ERR_MORE_SURFACE;
+            };
+            while (checkContinue(err)) {
+                if (dataqueue.empty()) {
+                    if (!queueIn) {
+                        if (m_callbacks.waitInput) m_callbacks.waitInput();
+                        dataqueue.push_back(TaskData(taskStart)); // デコード実行用
+                    } else {
+                        std::unique_ptr<TOutput> data;
+                        err = queueIn->pop(data, WAIT_INTERVAL_MS);
+                        if (err == RGY_ERR_NONE) {
+                            dataqueue.push_back(TaskData(taskStart, data));
+                        } else if (err == RGY_ERR_MORE_DATA) {
+                            err = RGY_ERR_NONE; // 入力がなくても、非同期に出力されるものがないかチェックする
+                        } else {
+                            break; // 前の段の終端(RGY_ERR_MORE_BITSTREAM)または中断
+                        }
+                    }
+                }
+                while (!dataqueue.empty()) {
+                    auto d = std::move(dataqueue.front());
+                    dataqueue.pop_front();
+                    if (d.task < taskEnd) {
+                        err = sendFrame(d.task, d.data);
+                        if (!checkContinue(err)) {
+                            PrintMes(setloglevel(err), _T("Break in task %s: %s.\n"), m_tasks[d.task]->print().c_str(), get_err_mes(err));
+                            break;
+                        }
+                        if (err == RGY_ERR_NONE) {
+                            auto output = getOutput(d.task);
+                            if (output.size() == 0) break;
+                            pushFront(dataqueue, d.task, output);
+                        }
+                    } else { // 次の段に渡す
+                        // 次の段が終了している場合はRGY_ERR_MORE_BITSTREAMとなり、この段もflushに移る
+                        if ((err = queueOut->push(d.data)) != RGY_ERR_NONE) {
+                            break;
+                        }
+                    }
+                }
+                if (dataqueue.empty() && !m_abort) {
+                    checkRemainingOutput(dataqueue, taskStart, taskEnd);
+                }
+            }
+        }
+        // flush
+        if (err == RGY_ERR_MORE_BITSTREAM) { // 入力の完了を示すフラグ
+            PrintMes(RGY_LOG_DEBUG, _T("Flushing pipeline stage #%d....\n"), (int)istage);
+            if (istage == 0) {
+                m_flushing = true;
+            }
+            err = RGY_ERR_NONE;
+            for (size_t itask = taskStart; itask < taskEnd; itask++) {
+                m_tasks[itask]->setOutputMaxQueueSize(0); //flushのため
+            }
+            auto checkContinue = [this](RGY_ERR& err) {
+                if (m_abort) { err = RGY_ERR_ABORTED; return false; }
+                return err >= RGY_ERR_NONE || err == RGY_ERR_MORE_SURFACE;
+            };
+            for (size_t flushedTaskSend = taskStart, flushedTaskGet = taskStart; flushedTaskGet < taskEnd && !m_abort; ) { // taskを前方からひとつづつflushしていく
+                err = RGY_ERR_NONE;
+                if (flushedTaskSend == flushedTaskGet) {
+                    dataqueue.push_back(TaskData(flushedTaskSend)); //flush用
+                }
+                while (!dataqueue.empty() && checkContinue(err)) {
+                    auto d = std::move(dataqueue.front());
+                    dataqueue.pop_front();
+                    if (d.task < taskEnd) {
+                        err = sendFrame(d.task, d.data);
+                        if (!checkContinue(err)) {
+                            if (d.task == flushedTaskSend) flushedTaskSend++;
+                            break;
+                        }
+                        auto output = getOutput(d.task);
+                        if (output.size() == 0) break;
+                        pushFront(dataqueue, d.task, output);
+                        if (err == RGY_ERR_MORE_DATA) err = RGY_ERR_NONE; //VPPなどでsendFrameがRGY_ERR_MORE_DATAだったが、フレームが出てくる場合がある
+                    } else { // 次の段に渡す
+                        auto sts = queueOut->push(d.data);
+                        if (sts == RGY_ERR_ABORTED) {
+                            err = sts;
+                            break;
+                        }
+                        // 次の段が終了している場合(RGY_ERR_MORE_BITSTREAM)は、出力を破棄してflushを続ける
+                    }
+                }
+                if (err == RGY_ERR_ABORTED || !(err >= RGY_ERR_NONE || err == RGY_ERR_MORE_DATA || err == RGY_ERR_MORE_SURFACE || err == RGY_ERR_MORE_BITSTREAM)) {
+                    break;
+                }
+                if (dataqueue.empty()) {
+                    // taskを前方からひとつづつ出力が残っていないかチェック(主にcheckptsの処理のため)
+                    for (size_t itask = flushedTaskGet; itask < taskEnd; itask++) {
+                        auto output = getOutput(itask);
+                        if (output.size() > 0) {
+                            pushFront(dataqueue, itask, output);
+                            //checkptsの処理上、でてきたフレームはすぐに後続処理に渡したいのでbreak
+                            break;
+                        } else if (itask == flushedTaskGet && flushedTaskGet < flushedTaskSend) {
+                            flushedTaskGet++;
+                        }
+                    }
+                }
+            }
+            if (!m_abort) {
+                queueOut->pushEOS();
+            }
+        } else if (!m_abort && (err == RGY_ERR_NONE || err == RGY_ERR_MORE_DATA || err == RGY_ERR_MORE_SURFACE)) {
+            queueOut->pushEOS();
+        }
+        if (queueIn) {
+            queueIn->close(); // 前の段がこの段の終了後に待ち続けないようにする
+        }
+        dataqueue.clear();
+        PrintMes(RGY_LOG_DEBUG, _T("Finished pipeline stage #%d: %s.\n"), (int)istage, get_err_mes(err));
+        return err;
+    }
+
+    void PrintMes(RGYLogLevel log_level, const TCHAR *format, ...) {
+        if (m_log.get() == nullptr || log_level < m_log->getLogLevel(RGY_LOGT_CORE)) {
+            return;
+        }
+        va_list args;
+        va_start(args, format);
+        int len = _vsctprintf(format, args) + 1; // _vscprintf doesn't count terminating '\0'
+        std::vector<TCHAR> buffer(len, 0);
+        _vstprintf_s(buffer.data(), len, format, args);
+        va_end(args);
+        m_log->write(log_level, RGY_LOGT_CORE, (tstring(_T("pipeline: ")) + buffer.data()).c_str());
+    }
+
+    std::vector<TTask *> m_tasks;
+    std::vector<StageParam> m_stages;
+    std::vector<bool> m_lockWriter;  // 書き出し処理と排他して実行するtask
+    size_t m_outputQueueSize;        // 最終段の出力キューのサイズ
+    std::vector<std::unique_ptr<RGYPipelineStageQueue<TOutput>>> m_queues;
+    std::vector<std::thread> m_threads;
+    Callbacks m_callbacks;
+    std::mutex m_writerMtx;          // 書き出し処理の排他用
+    std::mutex m_errMtx;
+    RGY_ERR m_err;                   // 最初に発生したエラー
+    std::atomic<bool> m_abort;
+    std::atomic<bool> m_flushing;    // 最初の段がflushを開始した
+    std::shared_ptr<RGYLog> m_log;
+};
+
+#endif //__RGY_PIPELINE_EXECUTOR_H__
@@ -2295,6 +2295,9 @@ RGYParamCommon::RGYParamCommon() :
     attachmentSource(),
     audioResampler(RGY_RESAMPLER_SWR),
     inputRetry(0),
+    inputPrefetchMB(0),
+    inputIndex(false),
+    inputIndexDir(),
     demuxAnalyzeSec(-1),
     demuxProbesize(-1),
     inputPixFmtStr(),
@@ -2347,6 +2350,7 @@ RGYParamParallelEnc::RGYParamParallelEnc() :
     parallelId(-1),
     chunks(0),
     cacheMode(RGYParamParallelEncCache::Mem),
+    memLimitMB(0),
     delayChildSync(false),
     sendData(nullptr) {
 
@@ -2355,18 +2359,20 @@ bool RGYParamParallelEnc::operator==(const RGYParamParallelEnc &x) const {
     return parallelCount == x.parallelCount
         && parallelId == x.parallelId
         && chunks == x.chunks
-        && cacheMode == x.cacheMode;
+        && cacheMode == x.cacheMode
+        && memLimitMB == x.memLimitMB;
 }
 bool RGYParamParallelEnc::operator!=(const RGYParamParallelEnc &x) const {
     return !(*this == x);
 }
 
-RGYParamLogOpt::RGYParamLogOpt() : addTime(false), addLogLevel(false), disableColor(false) {}
+RGYParamLogOpt::RGYParamLogOpt() : addTime(false), addLogLevel(false), disableColor(false), async(false) {}
 
 bool RGYParamLogOpt::operator==(const RGYParamLogOpt &x) const {
     return addTime == x.addTime
         && addLogLevel == x.addLogLevel
-        && disableColor == x.disableColor;
+        && disableColor == x.disableColor
+        && async == x.async;
 }
 bool RGYParamLogOpt::operator!=(const RGYParamLogOpt &x) const {
     return !(*this == x);
@@ -2386,12 +2392,16 @@ RGYParamControl::RGYParamControl() :
     threadOutput(RGY_OUTPUT_THREAD_AUTO),
     threadAudio(RGY_AUDIO_THREAD_AUTO),
     threadInput(RGY_INPUT_THREAD_AUTO),
+    threadPipeline(0),
     threadParams(),
     procSpeedLimit(0),      //処理速度制限 (0で制限なし)
     taskPerfMonitor(false),   //タスクの処理時間を計測する
+    taskTrace(),
     perfMonitorSelect(0),
     perfMonitorSelectMatplot(0),
     perfMonitorInterval(RGY_DEFAULT_PERF_MONITOR_INTERVAL),
+    metrics(),
+    metricsPort(0),
     parentProcessID(0),
     lowLatency(false),
     gpuSelect(),
@@ -2406,6 +2416,7 @@ RGYParamControl::RGYParamControl() :
     processMonitorDevUsage(false),
     processMonitorDevUsageReset(false),
     outputBufSizeMB(RGY_OUTPUT_BUF_MB_DEFAULT),
+    outputAsyncDepth(0),
     parallelEnc() {
 
 }
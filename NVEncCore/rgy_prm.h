@@ -2478,6 +2478,9 @@ struct RGYParamCommon {
     std::vector<AttachmentSource> attachmentSource;
     int audioResampler;
     int inputRetry;
+    int inputPrefetchMB;                   //avsw/avhwリーダーで入力ファイルを先読みするサイズ (MB, 0で使用しない)
+    bool inputIndex;                       //avsw/avhwリーダーでパケットのインデックスファイルを使用する
+    tstring inputIndexDir;                 //インデックスファイルの保存先 (空なら入力ファイルと同じ場所)
     double demuxAnalyzeSec;
     int64_t demuxProbesize;
     tstring inputPixFmtStr;
@@ -2556,6 +2559,7 @@ struct RGYParamParallelEnc {
     int parallelId; // 親=-1, 子=0～
     int chunks; // 分割数
     RGYParamParallelEncCache cacheMode;
+    int memLimitMB; // 子から親へ転送中のデータを保持するメモリの上限 (0で自動)
     bool delayChildSync; // 親-子間のデータやり取りを少し遅らせる
     RGYParallelEncSendData *sendData; // 並列処理時に親-子間のデータやり取り用
     RGYParamParallelEnc();
@@ -2576,6 +2580,7 @@ struct RGYParamLogOpt {
     bool addTime;
     bool addLogLevel;
     bool disableColor;
+    bool async;
 
     RGYParamLogOpt();
     bool operator==(const RGYParamLogOpt &x) const;
@@ -2594,12 +2599,16 @@ struct RGYParamControl {
     int threadOutput;
     int threadAudio;
     int threadInput;
+    int threadPipeline;      //パイプラインの各段を別スレッドで実行する (0で無効)
     RGYParamThreads threadParams;
     int procSpeedLimit;      //処理速度制限 (0で制限なし)
     bool taskPerfMonitor;
+    tstring taskTrace;       //処理区間の記録の出力先 (Chrome trace形式)
     int64_t perfMonitorSelect;
     int64_t perfMonitorSelectMatplot;
     int     perfMonitorInterval;
+    tstring metrics;         //進捗と性能情報のnewline-delimited JSONの出力先 (ファイル, fd:<n>, unix:<path>)
+    int     metricsPort;     //Prometheus形式で進捗と性能情報を返すlocalhostのポート (0で無効)
     uint32_t parentProcessID;
     bool lowLatency;
     GPUAutoSelectMul gpuSelect;
@@ -2615,6 +2624,7 @@ struct RGYParamControl {
     bool processMonitorDevUsageReset;
 
     int outputBufSizeMB;         //出力バッファサイズ
+    int outputAsyncDepth;        //非同期出力で同時に書き込み中にできるブロック数 (0で無効)
 
     RGYParamParallelEnc parallelEnc;
 
@@ -0,0 +1,332 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#include "rgy_proc_sampler.h"
+
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <linux/perf_event.h>
+
+static const char *RGY_PROC_SAMPLER_THREAD_PREFIX = "rgy_"; // PMUを計測するスレッドの名前
+
+static int openProcFile(const char *path) {
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+static void closeFd(int& fd) {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+// ファイルの先頭から読み直す (procfsのファイルは先頭から読めば最新の値が得られる)
+static int preadProcFile(int fd, char *buf, size_t size) {
+    if (fd < 0) {
+        return -1;
+    }
+    ssize_t ret = 0;
+    do {
+        ret = pread(fd, buf, size - 1, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret <= 0) {
+        return -1;
+    }
+    buf[ret] = '\0';
+    return (int)ret;
+}
+
+// "key: value" 形式の行からvalueを取得する
+static bool getProcValue(const char *buf, const char *key, long long *value) {
+    const char *ptr = strstr(buf, key);
+    if (ptr == nullptr) {
+        return false;
+    }
+    *value = strtoll(ptr + strlen(key), nullptr, 10);
+    return true;
+}
+
+// statの")"以降の項目を取得する
+// idxは"pid (comm) state ..."のstateを3番目とした通し番号 (man 5 proc を参照) で、昇順で指定する
+static bool getStatFields(const char *buf, const int *idx, long long *value, int count) {
+    const char *ptr = strrchr(buf, ')');
+    if (ptr == nullptr) {
+        return false;
+    }
+    ptr++;
+    int field = 3;
+    for (int i = 0; i < count; i++) {
+        for (; ; field++) {
+            while (*ptr == ' ') ptr++;
+            if (*ptr == '\0') {
+                return false;
+            }
+            if (field == idx[i]) {
+                break;
+            }
+            while (*ptr != ' ' && *ptr != '\0') ptr++;
+        }
+        char *end = nullptr;
+        value[i] = strtoll(ptr, &end, 10);
+        ptr = end;
+        field++;
+    }
+    return true;
+}
+
+static int openPerfCounter(pid_t tid, uint64_t config, int groupFd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1; // perf_event_paranoid=2でも使えるよう、ユーザー空間のみ計測する
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, tid, -1, groupFd, PERF_FLAG_FD_CLOEXEC);
+}
+
+RGYProcSampler::RGYProcSampler() :
+    m_fdStat(-1),
+    m_fdStatus(-1),
+    m_fdIO(-1),
+    m_threads(),
+    m_threadInfo(),
+    m_exitedThreadInfo(),
+    m_numThreads(0),
+    m_pid(0),
+    m_clockTick(100),
+    m_enablePMU(false),
+    m_pmuError(0) {
+}
+
+RGYProcSampler::~RGYProcSampler() {
+    close();
+}
+
+int RGYProcSampler::init(bool enablePMU) {
+    close();
+    m_pid = getpid();
+    m_clockTick = std::max<long>(sysconf(_SC_CLK_TCK), 1);
+    m_enablePMU = enablePMU;
+    m_pmuError = 0;
+    m_fdStat = openProcFile("/proc/self/stat");
+    m_fdStatus = openProcFile("/proc/self/status");
+    m_fdIO = openProcFile("/proc/self/io"); // 環境によっては読めないことがある
+    return (m_fdStat >= 0 && m_fdStatus >= 0) ? 0 : 1;
+}
+
+void RGYProcSampler::close() {
+    for (auto& th : m_threads) {
+        closeThread(th);
+    }
+    m_threads.clear();
+    m_threadInfo.clear();
+    m_exitedThreadInfo.clear();
+    m_numThreads = 0;
+    closeFd(m_fdStat);
+    closeFd(m_fdStatus);
+    closeFd(m_fdIO);
+}
+
+void RGYProcSampler::closeThread(ThreadEntry& th) {
+    closeFd(th.fdStat);
+    closeFd(th.fdSchedstat);
+    closeFd(th.fdPMUInstr);
+    closeFd(th.fdPMUCache);
+    closeFd(th.fdPMU);
+}
+
+void RGYProcSampler::updateThreadList() {
+    std::vector<pid_t> tids;
+    DIR *dir = opendir("/proc/self/task");
+    if (dir == nullptr) {
+        return;
+    }
+    while (auto entry = readdir(dir)) {
+        char *end = nullptr;
+        const long tid = strtol(entry->d_name, &end, 10);
+        if (end != entry->d_name && *end == '\0' && tid > 0) {
+            tids.push_back((pid_t)tid);
+        }
+    }
+    closedir(dir);
+    std::sort(tids.begin(), tids.end());
+
+    // 終了したスレッドを取り除く
+    for (auto it = m_threads.begin(); it != m_threads.end();) {
+        if (it->fdStat < 0 || !std::binary_search(tids.begin(), tids.end(), it->info.tid)) {
+            closeThread(*it);
+            it = m_threads.erase(it);
+        } else {
+            it++;
+        }
+    }
+    // 新しいスレッドを追加する
+    for (const auto tid : tids) {
+        if (std::any_of(m_threads.begin(), m_threads.end(), [tid](const ThreadEntry& th) { return th.info.tid == tid; })) {
+            continue;
+        }
+        ThreadEntry th;
+        th.info = RGYProcThreadInfo();
+        th.info.tid = tid;
+        th.info.pmu_valid = false;
+        th.fdPMU = th.fdPMUInstr = th.fdPMUCache = -1;
+        th.pmuTried = false;
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/self/task/%d/stat", (int)tid);
+        th.fdStat = openProcFile(path);
+        snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", (int)tid);
+        th.fdSchedstat = openProcFile(path); // CONFIG_SCHED_INFOが無効な場合はstatの値を使う
+        if (th.fdStat < 0) {
+            closeThread(th);
+            continue;
+        }
+        m_threads.push_back(th);
+    }
+    std::sort(m_threads.begin(), m_threads.end(), [](const ThreadEntry& a, const ThreadEntry& b) { return a.info.tid < b.info.tid; });
+}
+
+void RGYProcSampler::openPMU(ThreadEntry& th) {
+    th.pmuTried = true;
+    th.fdPMU = openPerfCounter(th.info.tid, PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (th.fdPMU < 0) {
+        m_pmuError = errno;
+        if (m_pmuError != ESRCH) {
+            m_enablePMU = false; // 権限がないかPMUが使えない環境なので、以降は試さない
+        }
+        return;
+    }
+    th.fdPMUInstr = openPerfCounter(th.info.tid, PERF_COUNT_HW_INSTRUCTIONS, th.fdPMU);
+    th.fdPMUCache = openPerfCounter(th.info.tid, PERF_COUNT_HW_CACHE_MISSES, th.fdPMU);
+    if (th.fdPMUInstr < 0 || th.fdPMUCache < 0) {
+        m_pmuError = errno;
+        closeFd(th.fdPMUInstr);
+        closeFd(th.fdPMUCache);
+        closeFd(th.fdPMU);
+    }
+}
+
+bool RGYProcSampler::readThread(ThreadEntry& th) {
+    char buf[1024];
+    if (preadProcFile(th.fdStat, buf, sizeof(buf)) < 0) {
+        return false; // スレッドが終了した
+    }
+    const char *nameStart = strchr(buf, '(');
+    const char *nameEnd = strrchr(buf, ')');
+    if (nameStart && nameEnd && nameStart < nameEnd) {
+        th.info.name.assign(nameStart + 1, nameEnd);
+    }
+    char bufSched[128];
+    if (preadProcFile(th.fdSchedstat, bufSched, sizeof(bufSched)) > 0) {
+        th.info.cpu_total_us = strtoll(bufSched, nullptr, 10) / 1000; // ns -> us
+    } else {
+        static const int idx[] = { 14, 15 }; // utime, stime
+        long long value[2] = { 0 };
+        if (getStatFields(buf, idx, value, 2)) {
+            th.info.cpu_total_us = (value[0] + value[1]) * 1000000 / m_clockTick;
+        }
+    }
+
+    if (m_enablePMU && !th.pmuTried
+        && (th.info.tid == m_pid || th.info.name.compare(0, strlen(RGY_PROC_SAMPLER_THREAD_PREFIX), RGY_PROC_SAMPLER_THREAD_PREFIX) == 0)) {
+        openPMU(th);
+    }
+    if (th.fdPMU >= 0) {
+        struct {
+            uint64_t nr;
+            uint64_t values[3];
+        } counters = { 0 };
+        th.info.pmu_valid = read(th.fdPMU, &counters, sizeof(counters)) == (ssize_t)sizeof(counters) && counters.nr == 3;
+        if (th.info.pmu_valid) {
+            th.info.cycles       = counters.values[0];
+            th.info.instructions = counters.values[1];
+            th.info.cache_misses = counters.values[2];
+        }
+    }
+    return true;
+}
+
+int RGYProcSampler::sample(RGYProcInfo *info) {
+    memset(info, 0, sizeof(info[0]));
+    char buf[4096];
+    if (preadProcFile(m_fdStat, buf, sizeof(buf)) > 0) {
+        static const int idx[] = { 20 }; // num_threads
+        long long value[1] = { 0 };
+        if (getStatFields(buf, idx, value, 1)) {
+            info->num_threads = (int)value[0];
+        }
+    }
+    if (preadProcFile(m_fdStatus, buf, sizeof(buf)) > 0) {
+        long long value = 0;
+        if (getProcValue(buf, "VmSize:", &value)) info->mem_virtual = value << 10;
+        if (getProcValue(buf, "VmRSS:",  &value)) info->mem_private = value << 10;
+    }
+    if (preadProcFile(m_fdIO, buf, sizeof(buf)) > 0) {
+        long long value = 0;
+        if (getProcValue(buf, "rchar:", &value)) info->io_total_read  = value;
+        if (getProcValue(buf, "wchar:", &value)) info->io_total_write = value;
+    }
+    struct rusage usage = { 0 };
+    getrusage(RUSAGE_SELF, &usage);
+    info->cpu_user_us   = usage.ru_utime.tv_sec * 1000000 + usage.ru_utime.tv_usec;
+    info->cpu_kernel_us = usage.ru_stime.tv_sec * 1000000 + usage.ru_stime.tv_usec;
+
+    // スレッド数が変化した場合のみ、スレッドの一覧を取得しなおす
+    if (info->num_threads != m_numThreads) {
+        updateThreadList();
+        m_numThreads = info->num_threads;
+    }
+    m_threadInfo.clear();
+    bool threadExited = false;
+    for (auto& th : m_threads) {
+        if (readThread(th)) {
+            m_threadInfo.push_back(th.info);
+        } else {
+            if (th.info.pmu_valid) {
+                m_exitedThreadInfo.push_back(th.info);
+            }
+            closeThread(th);
+            threadExited = true;
+        }
+    }
+    if (threadExited) {
+        m_numThreads = 0; // 次回スレッドの一覧を取得しなおす
+    }
+    return (m_fdStat >= 0) ? 0 : 1;
+}
+
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
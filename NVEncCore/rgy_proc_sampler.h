@@ -0,0 +1,109 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#pragma once
+#ifndef __RGY_PROC_SAMPLER_H__
+#define __RGY_PROC_SAMPLER_H__
+
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+// スレッドごとの情報
+struct RGYProcThreadInfo {
+    pid_t tid;
+    std::string name;      // スレッド名 (comm)
+    int64_t cpu_total_us;  // ユーザー + カーネル時間
+    bool pmu_valid;        // 以下のカウンタが有効か
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t cache_misses;
+};
+
+// プロセス全体の情報
+struct RGYProcInfo {
+    int64_t mem_virtual;    // VmSize (byte)
+    int64_t mem_private;    // VmRSS (byte)
+    int64_t io_total_read;  // rchar (byte)
+    int64_t io_total_write; // wchar (byte)
+    int64_t cpu_user_us;
+    int64_t cpu_kernel_us;
+    int num_threads;
+};
+
+// /proc/self 以下からプロセスとスレッドの情報を取得する
+// ファイルは開いたままにしてpreadで読み直すので、サンプリングごとにプロセスを起動したりファイルを開いたりしない
+// スレッドの一覧はスレッド数が変化した場合と、スレッドが終了していた場合のみ取得しなおす
+class RGYProcSampler {
+public:
+    RGYProcSampler();
+    ~RGYProcSampler();
+
+    // enablePMU: 名前を設定したスレッド(とメインスレッド)について、perf_event_openでcycles/instructions/cache-missesを計測する
+    int init(bool enablePMU);
+    void close();
+    int sample(RGYProcInfo *info);
+    const std::vector<RGYProcThreadInfo>& threads() const { return m_threadInfo; }
+    // 終了したスレッドのうち、PMUのカウンタを取得していたものの最後の値
+    const std::vector<RGYProcThreadInfo>& exitedThreads() const { return m_exitedThreadInfo; }
+    bool pmuEnabled() const { return m_enablePMU; }
+    // PMUのカウンタが使用できなかった場合のerrno (0なら問題なし)
+    int pmuError() const { return m_pmuError; }
+protected:
+    struct ThreadEntry {
+        RGYProcThreadInfo info;
+        int fdStat;
+        int fdSchedstat;
+        int fdPMU;      // cyclesのfd (グループリーダー)
+        int fdPMUInstr;
+        int fdPMUCache;
+        bool pmuTried;  // perf_event_openを試したか
+    };
+    void updateThreadList();
+    bool readThread(ThreadEntry& th);
+    void openPMU(ThreadEntry& th);
+    void closeThread(ThreadEntry& th);
+
+    int m_fdStat;
+    int m_fdStatus;
+    int m_fdIO;
+    std::vector<ThreadEntry> m_threads;
+    std::vector<RGYProcThreadInfo> m_threadInfo;
+    std::vector<RGYProcThreadInfo> m_exitedThreadInfo;
+    int m_numThreads;
+    pid_t m_pid;
+    int64_t m_clockTick;
+    bool m_enablePMU;
+    int m_pmuError;
+};
+
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
+
+#endif //__RGY_PROC_SAMPLER_H__
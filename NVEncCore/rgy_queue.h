@@ -369,6 +369,433 @@ protected:
 };
 #pragma warning (pop)
 
+#pragma warning (push)
+#pragma warning (disable: 4324) //アラインメント指定子のために構造体がパッドされました
+//ロックフリーで押し込みと取り出しが可能なキュー
+//各スロットにシーケンス番号を持たせたリングバッファ(セグメント)で構成し、
+//push/popはCASのみで行うため、RGYQueueMPMPのようにスピンロックで待機することがない
+//セグメントが満杯になった場合は、そのセグメントを閉じて倍の大きさのセグメントを後ろにつなぐ
+//取り出し終わったセグメントは退避リストに移し、それ以前から処理中のスレッドがすべて抜けたのちに破棄する
+//(2世代のエポックで管理する、処理中のスレッドが古いセグメントを参照していても安全)
+//インデックスによるアクセス(copy/get/operator[])が必要な場合はRGYQueueMPMPを使用すること
+template<typename Type, size_t align_byte = sizeof(Type)>
+class RGYQueueLockFree {
+    static const size_t CACHE_LINE = 64;
+    static const size_t CELL_ALIGN = (align_byte >= CACHE_LINE) ? CACHE_LINE : alignof(std::atomic<size_t>);
+    struct alignas(CELL_ALIGN) queueCell {
+        std::atomic<size_t> seq; //このスロットに次に書き込める(読み出せる)位置
+        Type data;
+    };
+    static const size_t SEGMENT_CLOSED = (size_t)1 << (sizeof(size_t) * 8 - 1); //posInの最上位ビット: セグメントへの追加を締め切った
+    struct queueSegment {
+        queueCell *cells;
+        size_t mask;
+        alignas(CACHE_LINE) std::atomic<size_t> posIn;  //次に書き込む位置 (SEGMENT_CLOSEDが立っていればこれ以上書き込まない)
+        alignas(CACHE_LINE) std::atomic<size_t> posOut; //次に読み出す位置
+        alignas(CACHE_LINE) std::atomic<queueSegment *> next; //このセグメントが満杯になったときに次に使うセグメント
+        queueSegment *retiredNext; //退避リストでの次のセグメント
+        size_t retiredEpoch;       //退避リストに移したときのエポック
+    };
+    //push/pop/sizeの間、現在のエポックの参照数を増やしておく
+    class EpochGuard {
+    public:
+        EpochGuard(const RGYQueueLockFree *queue) : m_queue(queue), m_epoch(queue->enterEpoch()) {};
+        ~EpochGuard() { m_queue->leaveEpoch(m_epoch); };
+    private:
+        const RGYQueueLockFree *m_queue;
+        size_t m_epoch;
+    };
+public:
+    RGYQueueLockFree() :
+        m_nPushRestartExtra(0),
+        m_heEventPoped(NULL),
+        m_heEventPushed(NULL),
+        m_nMaxCapacity(SIZE_MAX),
+        m_nKeepLength(0),
+        m_nAllocCells(0),
+        m_segRetired(nullptr),
+        m_segIn(nullptr),
+        m_segOut(nullptr),
+        m_epoch(0),
+        m_epochRef(),
+        m_reclaiming(false) {
+    }
+    ~RGYQueueLockFree() {
+        close();
+    }
+    //キューが一定の長さに達しないとfront_copy/popできないように設定する
+    void set_keep_length(size_t keepLength) {
+        m_nKeepLength = keepLength;
+    }
+    size_t get_keep_length() {
+        return m_nKeepLength;
+    }
+    //キューを初期化する
+    //bufSizeはキューの内部データバッファサイズ (2の累乗に切り上げる) maxCapacityを超えてもかまわない
+    //maxCapacityはキューに格納できる最大のデータ数
+    void init(size_t bufSize = 1024, size_t maxCapacity = SIZE_MAX, int nPushRestart = 1) {
+        close();
+        m_segOut = allocSegment(bufSize);
+        m_segIn = m_segOut.load();
+        m_heEventPoped = CreateEvent(NULL, TRUE, TRUE, NULL);
+        m_heEventPushed = CreateEvent(NULL, TRUE, TRUE, NULL);
+        m_nMaxCapacity = maxCapacity;
+        m_nKeepLength = 0;
+        m_nPushRestartExtra = clamp(nPushRestart - 1, 0, (int)std::min<size_t>(INT_MAX, maxCapacity) - 4);
+    }
+    //キューのデータをクリアする
+    // !! 他のスレッドがpush/popしていないときのみ有効 !!
+    void clear() {
+        if (!m_segOut) return;
+        freeRetired(SIZE_MAX);
+        //最後のセグメント(最も大きい)のみを残して再利用する
+        queueSegment *last = m_segOut;
+        while (last->next.load() != nullptr) {
+            queueSegment *next = last->next.load();
+            freeSegment(last);
+            last = next;
+        }
+        for (size_t i = 0; i <= last->mask; i++) {
+            last->cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+        last->posIn = 0;
+        last->posOut = 0;
+        m_segIn = last;
+        m_segOut = last;
+    }
+    //キューのデータをクリアする際に、指定した関数で内部データを開放してから、データをクリアする
+    // !! 他のスレッドがpush/popしていないときのみ有効 !!
+    template<typename Func>
+    void clear(Func deleter) {
+        if (!m_segOut) return;
+        Type data;
+        while (popInternal(&data)) {
+            deleter(&data);
+        }
+        clear();
+    }
+    //キューのデータをクリアし、リソースを破棄する
+    void close() {
+        if (m_heEventPoped) {
+            CloseEvent(m_heEventPoped);
+            m_heEventPoped = nullptr;
+        }
+        if (m_heEventPushed) {
+            CloseEvent(m_heEventPushed);
+            m_heEventPushed = nullptr;
+        }
+        freeRetired(SIZE_MAX);
+        for (queueSegment *seg = m_segOut; seg != nullptr;) {
+            queueSegment *next = seg->next.load();
+            freeSegment(seg);
+            seg = next;
+        }
+        m_segIn = nullptr;
+        m_segOut = nullptr;
+    }
+    //キューのデータをクリアする際に、指定した関数で内部データを開放してから、リソースを破棄する
+    template<typename Func>
+    void close(Func deleter) {
+        clear(deleter);
+        close();
+    }
+    //データをキューにコピーし押し込む
+    //キューのデータ量があらかじめ設定した上限に達した場合は、キューに空きができるまで待機する
+    bool push(const Type& in) {
+        //最初に決めた容量分までキューにデータがたまっていたら、キューに空きができるまで待機する
+        while (size() >= m_nMaxCapacity) {
+            ResetEvent(m_heEventPoped);
+            WaitForSingleObject(m_heEventPoped, 16);
+        }
+        if (!pushInternal(in)) {
+            return false;
+        }
+        SetEvent(m_heEventPushed);
+        return true;
+    }
+    //データをキューにコピーし押し込む
+    //容量の確認やイベントの操作を行わないので、イベントで待機しない使い方(スレッドプールなど)向け
+    bool push_no_event(const Type& in) {
+        return pushInternal(in);
+    }
+    //キューの先頭のデータを取り出しながら(outにコピーする)、キューから取り除く
+    //キューが空ならfalseを返す
+    //size()の計算やイベントの操作を行わないので、空のキューを頻繁にポーリングする使い方向け
+    bool pop_no_event(Type *out) {
+        bool bCopy = false;
+        {
+            EpochGuard guard(this);
+            bCopy = popInternal(out);
+        }
+        reclaim();
+        return bCopy;
+    }
+    //キューのsizeを取得する
+    //他のスレッドがpush/popしている場合は近似値となる
+    size_t size() const {
+        EpochGuard guard(this);
+        size_t nSize = 0;
+        for (queueSegment *seg = m_segOut.load(); seg != nullptr; seg = seg->next.load(std::memory_order_acquire)) {
+            const size_t posOut = seg->posOut.load(std::memory_order_acquire);
+            const size_t posIn = seg->posIn.load(std::memory_order_acquire) & (~SEGMENT_CLOSED);
+            nSize += (posIn > posOut) ? posIn - posOut : 0;
+            if (seg == m_segIn.load()) {
+                break;
+            }
+        }
+        return nSize;
+    }
+    //確保しているセグメントの要素数の合計を取得する (破棄待ちのセグメントを含む)
+    size_t allocated_size() const {
+        return m_nAllocCells.load(std::memory_order_relaxed);
+    }
+    //キューが空ならtrueを返す
+    bool empty() const {
+        return size() == 0;
+    }
+    //キューの最大サイズを取得する
+    size_t capacity() const {
+        return m_nMaxCapacity;
+    }
+    //キューの最大サイズを設定する
+    void set_capacity(size_t capacity) {
+        m_nMaxCapacity = capacity;
+        m_nPushRestartExtra = (std::min)(m_nPushRestartExtra, (int)std::min<size_t>(INT_MAX, capacity) - 1);
+    }
+    //キューの先頭のデータを取り出しながら(outにコピーする)、キューから取り除く
+    //キューが空ならなにもせずfalseを返す
+    bool front_copy_and_pop_no_lock(Type *out, size_t *pnSize = nullptr) {
+        const size_t nSize = size();
+        bool bCopy = false;
+        if (nSize > m_nKeepLength) {
+            EpochGuard guard(this);
+            bCopy = popInternal(out);
+        }
+        reclaim();
+        if (bCopy) {
+            if (nSize <= m_nMaxCapacity - m_nPushRestartExtra) {
+                SetEvent(m_heEventPoped);
+            }
+        } else {
+            ResetEvent(m_heEventPushed);
+        }
+        if (pnSize) {
+            *pnSize = nSize;
+        }
+        return bCopy;
+    }
+    //キューの先頭のデータを取り除く
+    //キューが空ならfalseを返す
+    bool pop() {
+        Type data;
+        return front_copy_and_pop_no_lock(&data);
+    }
+    //要素が追加されるまで待機する
+    void wait_for_push() {
+        WaitForSingleObject(m_heEventPushed, 16);
+    }
+    //要素が追加されるまで待機するイベントを取得
+    HANDLE get_push_event() {
+        return m_heEventPushed;
+    }
+protected:
+    //要素数を2の累乗に切り上げたセグメントを確保する
+    queueSegment *allocSegment(size_t bufSize) {
+        size_t cellCount = 2;
+        while (cellCount < bufSize && cellCount < (SEGMENT_CLOSED >> 1)) {
+            cellCount <<= 1;
+        }
+        auto cells = (queueCell *)_aligned_malloc(sizeof(queueCell) * cellCount, (CELL_ALIGN > 16) ? CELL_ALIGN : 16);
+        if (cells == nullptr) {
+            return nullptr;
+        }
+        for (size_t i = 0; i < cellCount; i++) {
+            new (&cells[i]) queueCell();
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+        auto seg = new queueSegment();
+        seg->cells = cells;
+        seg->mask = cellCount - 1;
+        seg->posIn = 0;
+        seg->posOut = 0;
+        seg->next = nullptr;
+        seg->retiredNext = nullptr;
+        seg->retiredEpoch = 0;
+        m_nAllocCells += cellCount;
+        return seg;
+    }
+    void freeSegment(queueSegment *seg) {
+        for (size_t i = 0; i <= seg->mask; i++) {
+            seg->cells[i].~queueCell();
+        }
+        _aligned_free(seg->cells);
+        m_nAllocCells -= seg->mask + 1;
+        delete seg;
+    }
+    //現在のエポックの参照数を増やし、そのエポックを返す
+    size_t enterEpoch() const {
+        for (;;) {
+            const size_t epoch = m_epoch.load();
+            m_epochRef[epoch & 1].count.fetch_add(1);
+            if (m_epoch.load() == epoch) {
+                return epoch;
+            }
+            //参照数を増やしている間にエポックが進んだのでやり直す
+            m_epochRef[epoch & 1].count.fetch_sub(1);
+        }
+    }
+    void leaveEpoch(size_t epoch) const {
+        m_epochRef[epoch & 1].count.fetch_sub(1, std::memory_order_release);
+    }
+    //取り出し終わってどこからもたどれなくなったセグメントを退避リストに移す
+    void retireSegment(queueSegment *seg) {
+        seg->retiredEpoch = m_epoch.load();
+        pushRetired(seg);
+    }
+    void pushRetired(queueSegment *seg) {
+        queueSegment *head = m_segRetired.load(std::memory_order_relaxed);
+        do {
+            seg->retiredNext = head;
+        } while (!m_segRetired.compare_exchange_weak(head, seg, std::memory_order_release, std::memory_order_relaxed));
+    }
+    //退避リストのうち、epochより前に退避したセグメントを破棄する
+    void freeRetired(size_t epoch) {
+        queueSegment *seg = m_segRetired.exchange(nullptr, std::memory_order_acquire);
+        while (seg != nullptr) {
+            queueSegment *next = seg->retiredNext;
+            if (seg->retiredEpoch < epoch) {
+                freeSegment(seg);
+            } else {
+                pushRetired(seg);
+            }
+            seg = next;
+        }
+    }
+    //ひとつ前のエポックで処理中のスレッドがなくなっていれば、それ以前に退避したセグメントを破棄してエポックを進める
+    //破棄は一度にひとつのスレッドのみが行う、ほかのスレッドが破棄中ならなにもしない
+    void reclaim() {
+        if (m_segRetired.load(std::memory_order_relaxed) == nullptr
+            || m_reclaiming.exchange(true, std::memory_order_acquire)) {
+            return;
+        }
+        const size_t epoch = m_epoch.load();
+        if (m_epochRef[(epoch + 1) & 1].count.load() == 0) {
+            freeRetired(epoch);
+            m_epoch.store(epoch + 1);
+        }
+        m_reclaiming.store(false, std::memory_order_release);
+    }
+    //segに追加する セグメントが満杯なら閉じてfalseを返す
+    bool pushSegment(queueSegment *seg, const Type& in) {
+        size_t pos = seg->posIn.load(std::memory_order_relaxed);
+        queueCell *cell = nullptr;
+        for (;;) {
+            if (pos & SEGMENT_CLOSED) {
+                return false;
+            }
+            cell = &seg->cells[pos & seg->mask];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (seg->posIn.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (dif < 0) {
+                //満杯なので締め切る、締め切ったセグメントには以後書き込まない
+                if (seg->posIn.compare_exchange_weak(pos, pos | SEGMENT_CLOSED, std::memory_order_acq_rel)) {
+                    return false;
+                }
+            } else {
+                pos = seg->posIn.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = in;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    //末尾にデータを追加する セグメントが満杯なら次のセグメントへ移る
+    bool pushInternal(const Type& in) {
+        EpochGuard guard(this);
+        for (;;) {
+            queueSegment *seg = m_segIn.load();
+            if (pushSegment(seg, in)) {
+                return true;
+            }
+            //セグメントが閉じられているので、次のセグメントへ移る (なければ倍の大きさで作成する)
+            queueSegment *next = seg->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                queueSegment *newSeg = allocSegment((seg->mask + 1) * 2);
+                if (newSeg == nullptr) {
+                    return false;
+                }
+                if (seg->next.compare_exchange_strong(next, newSeg)) {
+                    next = newSeg;
+                } else {
+                    freeSegment(newSeg); //他のスレッドが先に追加した
+                }
+            }
+            m_segIn.compare_exchange_strong(seg, next);
+        }
+    }
+    //先頭のデータを取り出す 空ならfalseを返す
+    bool popInternal(Type *out) {
+        if (m_segOut.load(std::memory_order_relaxed) == nullptr) {
+            return false;
+        }
+        for (;;) {
+            queueSegment *seg = m_segOut.load();
+            size_t pos = seg->posOut.load(std::memory_order_relaxed);
+            for (;;) {
+                queueCell *cell = &seg->cells[pos & seg->mask];
+                const size_t seq = cell->seq.load(std::memory_order_acquire);
+                const intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (dif == 0) {
+                    if (seg->posOut.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        *out = cell->data;
+                        cell->seq.store(pos + seg->mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (dif < 0) {
+                    //このセグメントは空
+                    //締め切られていて、書き込み途中のデータもなければ次のセグメントに移る
+                    const size_t posIn = seg->posIn.load(std::memory_order_acquire);
+                    queueSegment *next = seg->next.load(std::memory_order_acquire);
+                    if (!(posIn & SEGMENT_CLOSED) || (posIn & (~SEGMENT_CLOSED)) != pos || next == nullptr) {
+                        return false;
+                    }
+                    if (m_segOut.compare_exchange_strong(seg, next)) {
+                        //取り出し側が次に移ったので、格納側も古いセグメントを指していれば次に移してから退避する
+                        queueSegment *segIn = seg;
+                        m_segIn.compare_exchange_strong(segIn, next);
+                        retireSegment(seg);
+                    }
+                    break;
+                } else {
+                    pos = seg->posOut.load(std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    int m_nPushRestartExtra; //キューに空きがこのぶんだけ余剰にないと空き通知を行わない (0 = ひとつあけば通知を行う)
+    HANDLE m_heEventPoped; //キューからデータを取り出したときセットする
+    HANDLE m_heEventPushed; //キューにデータが追加されたときセットする
+    std::atomic<size_t> m_nMaxCapacity; //キューに詰められる有効なデータの最大数
+    std::atomic<size_t> m_nKeepLength; //ある一定の長さを常にキュー内に保持するようにする
+    std::atomic<size_t> m_nAllocCells; //確保しているセグメントの要素数の合計
+    std::atomic<queueSegment *> m_segRetired; //取り出し終わって破棄を待っているセグメント
+    alignas(CACHE_LINE) std::atomic<queueSegment *> m_segIn;  //データを格納するセグメント
+    alignas(CACHE_LINE) std::atomic<queueSegment *> m_segOut; //データを取り出すセグメント (これより前のセグメントは退避済み)
+    struct alignas(CACHE_LINE) epochRef {
+        std::atomic<size_t> count;
+        epochRef() : count(0) {};
+    };
+    alignas(CACHE_LINE) mutable std::atomic<size_t> m_epoch; //セグメントの破棄を行うたびに進めるエポック
+    mutable epochRef m_epochRef[2]; //エポックごとのpush/pop/size中のスレッド数 (偶数/奇数)
+    std::atomic<bool> m_reclaiming; //セグメントの破棄中
+};
+#pragma warning (pop)
+
 class RGYQueueBuffer {
 public:
     RGYQueueBuffer() :
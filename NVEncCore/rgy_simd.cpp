@@ -81,6 +81,11 @@ RGY_SIMD get_availableSIMD() {
     }
     return simd;
 }
+#elif defined(_M_ARM64) || defined(__aarch64__)
+RGY_SIMD get_availableSIMD() {
+    //AArch64ではAdvanced SIMD(NEON)は必須
+    return RGY_SIMD::NEON;
+}
 #else
 RGY_SIMD get_availableSIMD() {
     return RGY_SIMD::NONE;
@@ -65,6 +65,7 @@ enum class RGY_SIMD : uint64_t {
     AVX512VNNI      = 0x100000,
     AVX512BITALG    = 0x200000,
     AVX512VPOPCNTDQ = 0x400000,
+    NEON            = 0x800000,
 
     SIMD_ALL        = std::numeric_limits<uint64_t>::max(),
 };
@@ -0,0 +1,554 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include "rgy_osdep.h"
+#include "rgy_util.h"
+#include "rgy_simd.h"
+#include "rgy_memmem.h"
+#include "rgy_bitstream.h"
+#include "rgy_faw.h"
+#include "convert_csp.h"
+#include "rgy_simd_check.h"
+
+static const int SIMD_CHECK_BENCH_WIDTH  = 1920;
+static const int SIMD_CHECK_BENCH_HEIGHT = 1080;
+static const double SIMD_CHECK_BENCH_SEC = 0.05;
+
+typedef std::unique_ptr<uint8_t, aligned_malloc_deleter> simd_check_buf;
+
+static simd_check_buf simd_check_alloc(size_t size) {
+    return simd_check_buf((uint8_t *)_aligned_malloc(size, 64));
+}
+
+static tstring simd_check_name(RGY_SIMD simd) {
+    static const std::pair<RGY_SIMD, const TCHAR *> simd_name_list[] = {
+        { RGY_SIMD::AVX512VBMI, _T("AVX512VBMI") },
+        { RGY_SIMD::AVX512BW,   _T("AVX512BW")   },
+        { RGY_SIMD::AVX2,       _T("AVX2")       },
+        { RGY_SIMD::AVX,        _T("AVX")        },
+        { RGY_SIMD::SSE42,      _T("SSE4.2")     },
+        { RGY_SIMD::SSE41,      _T("SSE4.1")     },
+        { RGY_SIMD::SSSE3,      _T("SSSE3")      },
+        { RGY_SIMD::SSE2,       _T("SSE2")       },
+        { RGY_SIMD::NEON,       _T("NEON")       },
+    };
+    //一番上位の命令セットを表示する
+    for (const auto& s : simd_name_list) {
+        if ((simd & s.first) == s.first) {
+            return s.second;
+        }
+    }
+    return _T("C");
+}
+
+//一定時間以上実行して、1回あたりの処理時間(秒)を返す
+template<typename Func>
+static double simd_check_bench(Func func) {
+    func(); //warmup
+    int loop = 0;
+    const auto start = std::chrono::high_resolution_clock::now();
+    double elapsed = 0.0;
+    do {
+        func();
+        loop++;
+        elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    } while (elapsed < SIMD_CHECK_BENCH_SEC || loop < 3);
+    return elapsed / loop;
+}
+
+//convert_cspのテスト用のフレームバッファ
+struct SIMDCheckFrame {
+    int width;
+    int height;
+    int pitch;
+    size_t plane_size;
+    simd_check_buf buf;
+
+    SIMDCheckFrame(int w, int h, int p) : width(w), height(h), pitch(p), plane_size((size_t)p * h), buf() {
+        buf = simd_check_alloc(plane_size * RGY_MAX_PLANES + 256);
+    }
+    size_t size() const {
+        return plane_size * RGY_MAX_PLANES + 256;
+    }
+    void planes(void **ptr) {
+        for (int i = 0; i < RGY_MAX_PLANES; i++) {
+            ptr[i] = buf.get() + plane_size * i;
+        }
+    }
+};
+
+struct SIMDCheckConvPrm {
+    int width, height, dst_height;
+    int src_pitch, dst_pitch;
+    int crop[4];
+};
+
+static void simd_check_conv_run(funcConvertCSP func, SIMDCheckFrame& dst, const SIMDCheckFrame& src, const SIMDCheckConvPrm& prm, int thread_n) {
+    void *dst_ptr[RGY_MAX_PLANES];
+    const void *src_ptr[RGY_MAX_PLANES];
+    dst.planes(dst_ptr);
+    for (int i = 0; i < RGY_MAX_PLANES; i++) {
+        src_ptr[i] = src.buf.get() + src.plane_size * i;
+    }
+    int crop[4];
+    memcpy(crop, prm.crop, sizeof(crop));
+    for (int ithread = 0; ithread < thread_n; ithread++) {
+        func(dst_ptr, src_ptr, prm.width, prm.src_pitch, prm.src_pitch, prm.dst_pitch, prm.dst_pitch,
+            prm.height, prm.dst_height, ithread, thread_n, crop);
+    }
+}
+
+static void simd_check_fill_src(SIMDCheckFrame& src, RGY_CSP csp, std::mt19937& mt) {
+    if (RGY_CSP_DATA_TYPE[csp] != RGY_DATA_TYPE_U16
+        || csp == RGY_CSP_Y410 || csp == RGY_CSP_RBGA64_10 || csp == RGY_CSP_YC48) {
+        std::uniform_int_distribution<int> dist(0, 255);
+        for (size_t i = 0; i < src.size(); i++) {
+            src.buf.get()[i] = (uint8_t)dist(mt);
+        }
+    } else {
+        //P010等は上位bit詰め、それ以外は下位bit詰め
+        const int bit_depth = RGY_CSP_BIT_DEPTH[csp];
+        const bool msb_aligned = csp == RGY_CSP_P010 || csp == RGY_CSP_P010A || csp == RGY_CSP_P210 || csp == RGY_CSP_Y210;
+        const int shift = (msb_aligned) ? 16 - bit_depth : 0;
+        std::uniform_int_distribution<int> dist(0, (1 << bit_depth) - 1);
+        uint16_t *ptr = (uint16_t *)src.buf.get();
+        for (size_t i = 0; i < src.size() / sizeof(uint16_t); i++) {
+            ptr[i] = (uint16_t)(dist(mt) << shift);
+        }
+    }
+}
+
+//C版で書き込まれる領域を求める
+//0x00と0xffで埋めた出力先に2回変換を行い、どちらでも元の値のままの箇所は書き込みなしと判定する
+//SIMD版は行末のpitch内に余分に書き込むことがあるので、比較はC版が書き込んだ箇所のみとする
+static size_t simd_check_ref(std::vector<uint8_t>& ref, std::vector<uint8_t>& mask, funcConvertCSP func_c,
+    SIMDCheckFrame& dst, const SIMDCheckFrame& src, const SIMDCheckConvPrm& prm) {
+    memset(dst.buf.get(), 0x00, dst.size());
+    simd_check_conv_run(func_c, dst, src, prm, 1);
+    ref.assign(dst.buf.get(), dst.buf.get() + dst.size());
+    memset(dst.buf.get(), 0xff, dst.size());
+    simd_check_conv_run(func_c, dst, src, prm, 1);
+    mask.resize(dst.size());
+    size_t written = 0;
+    for (size_t i = 0; i < dst.size(); i++) {
+        mask[i] = (ref[i] != 0x00 || dst.buf.get()[i] != 0xff) ? 1 : 0;
+        written += mask[i];
+    }
+    return written;
+}
+
+static int simd_check_convert_csp(tstring& result, const RGYSIMDCheckPrm& prm) {
+    const auto available = get_availableSIMD();
+    std::mt19937 mt(prm.seed);
+    int errors = 0;
+    size_t count = 0;
+    const ConvertCSP *list = get_convert_csp_func_list(&count);
+    for (size_t ilist = 0; ilist < count; ilist++) {
+        const ConvertCSP *conv = &list[ilist];
+        if (conv->simd == RGY_SIMD::NONE || (conv->simd & available) != conv->simd) {
+            continue;
+        }
+        if (RGY_CSP_DATA_TYPE[conv->csp_from] == RGY_DATA_TYPE_FP32 || RGY_CSP_DATA_TYPE[conv->csp_to] == RGY_DATA_TYPE_FP32
+            || RGY_CSP_DATA_TYPE[conv->csp_from] == RGY_DATA_TYPE_FP16 || RGY_CSP_DATA_TYPE[conv->csp_to] == RGY_DATA_TYPE_FP16) {
+            continue;
+        }
+        //funcListの並びにより選択されることのない関数は対象外とする
+        if (get_convert_csp_func(conv->csp_from, conv->csp_to, conv->uv_only, conv->simd) != conv) {
+            continue;
+        }
+        const tstring name = strsprintf(_T("%s -> %s%s"), RGY_CSP_NAMES[conv->csp_from], RGY_CSP_NAMES[conv->csp_to], (conv->uv_only) ? _T(" (uv)") : _T(""));
+        const ConvertCSP *conv_c = get_convert_csp_func(conv->csp_from, conv->csp_to, conv->uv_only, RGY_SIMD::NONE);
+        if (conv_c == nullptr) {
+            result += strsprintf(_T("  %-36s %-10s skip (no C reference)\n"), name.c_str(), simd_check_name(conv->simd).c_str());
+            continue;
+        }
+        //色差が間引かれている場合は、縦方向は4の倍数とする (インタレ保持の場合を考慮)
+        const bool subsampled = RGY_CSP_CHROMA_FORMAT[conv->csp_from] == RGY_CHROMAFMT_YUV420 || RGY_CSP_CHROMA_FORMAT[conv->csp_to] == RGY_CHROMAFMT_YUV420
+            || RGY_CSP_CHROMA_FORMAT[conv->csp_from] == RGY_CHROMAFMT_YUV422 || RGY_CSP_CHROMA_FORMAT[conv->csp_to] == RGY_CHROMAFMT_YUV422
+            || conv->csp_from == RGY_CSP_YUY2;
+        for (int interlaced = 0; interlaced < 2; interlaced++) {
+            if (conv->func[interlaced] == nullptr || conv_c->func[interlaced] == nullptr) {
+                continue;
+            }
+            bool ok = true;
+            tstring err_msg;
+            for (int iloop = 0; iloop < prm.loop && ok; iloop++) {
+                SIMDCheckConvPrm cprm;
+                const int h_align = (subsampled) ? 4 : 1;
+                cprm.width = std::uniform_int_distribution<int>(64, 640)(mt) & ~1;
+                cprm.height = std::uniform_int_distribution<int>(8, 72)(mt) / h_align * h_align;
+                cprm.crop[0] = std::uniform_int_distribution<int>(0, 3)(mt) * 4;
+                cprm.crop[2] = std::uniform_int_distribution<int>(0, 3)(mt) * 4;
+                cprm.crop[1] = std::uniform_int_distribution<int>(0, 2)(mt) * h_align * 2;
+                cprm.crop[3] = std::uniform_int_distribution<int>(0, 2)(mt) * h_align * 2;
+                if (cprm.width <= cprm.crop[0] + cprm.crop[2] + 2) {
+                    cprm.crop[0] = cprm.crop[2] = 0;
+                }
+                if (cprm.height < cprm.crop[1] + cprm.crop[3] + h_align * 2) {
+                    cprm.crop[1] = cprm.crop[3] = 0;
+                }
+                cprm.dst_height = cprm.height - cprm.crop[1] - cprm.crop[3];
+                //1画素あたり最大8byte(RGBA 16bit)として、さらにランダムな余白を付与する
+                cprm.src_pitch = ALIGN(cprm.width * 8, 64) + std::uniform_int_distribution<int>(0, 4)(mt) * 64;
+                cprm.dst_pitch = ALIGN(cprm.width * 8, 64) + std::uniform_int_distribution<int>(0, 4)(mt) * 64;
+                const int thread_n = std::uniform_int_distribution<int>(1, 4)(mt);
+
+                SIMDCheckFrame src(cprm.width, cprm.height, cprm.src_pitch);
+                SIMDCheckFrame dst(cprm.width, cprm.dst_height, cprm.dst_pitch);
+                simd_check_fill_src(src, conv->csp_from, mt);
+
+                std::vector<uint8_t> ref, mask;
+                simd_check_ref(ref, mask, conv_c->func[interlaced], dst, src, cprm);
+
+                memset(dst.buf.get(), 0x00, dst.size());
+                simd_check_conv_run(conv->func[interlaced], dst, src, cprm, thread_n);
+                for (size_t i = 0; i < dst.size(); i++) {
+                    if (mask[i] && dst.buf.get()[i] != ref[i]) {
+                        err_msg = strsprintf(_T("mismatch: %dx%d, pitch %d/%d, crop %d,%d,%d,%d, threads %d, plane %d y %d x(byte) %d: 0x%02x (C: 0x%02x)"),
+                            cprm.width, cprm.height, cprm.src_pitch, cprm.dst_pitch,
+                            cprm.crop[0], cprm.crop[1], cprm.crop[2], cprm.crop[3], thread_n,
+                            (int)(i / dst.plane_size), (int)((i % dst.plane_size) / cprm.dst_pitch), (int)(i % cprm.dst_pitch),
+                            dst.buf.get()[i], ref[i]);
+                        ok = false;
+                        break;
+                    }
+                }
+            }
+            tstring bench_msg;
+            if (ok && prm.benchmark) {
+                SIMDCheckConvPrm cprm;
+                cprm.width = SIMD_CHECK_BENCH_WIDTH;
+                cprm.height = SIMD_CHECK_BENCH_HEIGHT;
+                cprm.dst_height = SIMD_CHECK_BENCH_HEIGHT;
+                cprm.src_pitch = ALIGN(SIMD_CHECK_BENCH_WIDTH * 8, 64);
+                cprm.dst_pitch = ALIGN(SIMD_CHECK_BENCH_WIDTH * 8, 64);
+                memset(cprm.crop, 0, sizeof(cprm.crop));
+                SIMDCheckFrame src(cprm.width, cprm.height, cprm.src_pitch);
+                SIMDCheckFrame dst(cprm.width, cprm.dst_height, cprm.dst_pitch);
+                simd_check_fill_src(src, conv->csp_from, mt);
+                std::vector<uint8_t> ref, mask;
+                //出力されるバイト数を基準に速度を算出する
+                const double written = (double)simd_check_ref(ref, mask, conv_c->func[interlaced], dst, src, cprm);
+                const double time_simd = simd_check_bench([&]() { simd_check_conv_run(conv->func[interlaced], dst, src, cprm, 1); });
+                const double time_c    = simd_check_bench([&]() { simd_check_conv_run(conv_c->func[interlaced], dst, src, cprm, 1); });
+                bench_msg = strsprintf(_T(" %7.2f GB/s (C %6.2f GB/s, x%.2f)"), written / time_simd * 1e-9, written / time_c * 1e-9, time_c / time_simd);
+            }
+            result += strsprintf(_T("  %-36s %-10s %s %s%s\n"), name.c_str(), simd_check_name(conv->simd).c_str(),
+                (interlaced) ? _T("i") : _T("p"), (ok) ? _T("OK") : _T("NG"), (ok) ? bench_msg.c_str() : (_T(" ") + err_msg).c_str());
+            if (!ok) {
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+//1次元の関数の比較結果を出力する
+static int simd_check_result(tstring& result, const TCHAR *name, RGY_SIMD simd, const tstring& err_msg, double bytes, double time_simd, double time_c) {
+    tstring bench_msg;
+    if (err_msg.length() == 0 && time_simd > 0.0) {
+        bench_msg = strsprintf(_T(" %7.2f GB/s (C %6.2f GB/s, x%.2f)"), bytes / time_simd * 1e-9, bytes / time_c * 1e-9, time_c / time_simd);
+    }
+    result += strsprintf(_T("  %-36s %-10s %s%s\n"), name, simd_check_name(simd).c_str(),
+        (err_msg.length() == 0) ? _T("OK") : _T("NG "), (err_msg.length() == 0) ? bench_msg.c_str() : err_msg.c_str());
+    return (err_msg.length() == 0) ? 0 : 1;
+}
+
+static int simd_check_memmem(tstring& result, const RGYSIMDCheckPrm& prm, const TCHAR *name, RGY_SIMD simd, decltype(rgy_memmem_c) *func) {
+    if ((get_availableSIMD() & simd) != simd) {
+        return 0;
+    }
+    std::mt19937 mt(prm.seed);
+    tstring err_msg;
+    for (int iloop = 0; iloop < prm.loop * 64 && err_msg.length() == 0; iloop++) {
+        const size_t data_size = std::uniform_int_distribution<size_t>(0, 4096)(mt);
+        const size_t target_size = std::uniform_int_distribution<size_t>(1, 16)(mt);
+        //見つからない場合と見つかる場合が半々程度になるよう、小さな値域で乱数を生成する
+        std::uniform_int_distribution<int> dist(0, 3);
+        std::vector<uint8_t> target(target_size);
+        for (auto& t : target) t = (uint8_t)dist(mt);
+        //ページ境界をまたいだ読み込みを検出しやすいよう、バッファの末尾にデータを配置する
+        simd_check_buf buf = simd_check_alloc(ALIGN(data_size, 64) + 64);
+        uint8_t *data = buf.get() + ALIGN(data_size, 64) - data_size;
+        for (size_t i = 0; i < data_size; i++) data[i] = (uint8_t)dist(mt);
+        if (data_size >= target_size && (iloop & 1)) {
+            const size_t pos = std::uniform_int_distribution<size_t>(0, data_size - target_size)(mt);
+            memcpy(data + pos, target.data(), target_size);
+        }
+        const auto ret_c = rgy_memmem_c(data, data_size, target.data(), target_size);
+        const auto ret_simd = func(data, data_size, target.data(), target_size);
+        if (ret_c != ret_simd) {
+            err_msg = strsprintf(_T("mismatch: size %d, target size %d: %lld (C: %lld)"), (int)data_size, (int)target_size,
+                (ret_simd == RGY_MEMMEM_NOT_FOUND) ? -1ll : (long long)ret_simd, (ret_c == RGY_MEMMEM_NOT_FOUND) ? -1ll : (long long)ret_c);
+        }
+    }
+    double bytes = 0.0, time_simd = 0.0, time_c = 0.0;
+    if (err_msg.length() == 0 && prm.benchmark) {
+        const size_t data_size = 16 * 1024 * 1024;
+        simd_check_buf buf = simd_check_alloc(data_size);
+        memset(buf.get(), 0, data_size);
+        static const uint8_t target[4] = { 0, 0, 1, 0xff };
+        bytes = (double)data_size;
+        time_simd = simd_check_bench([&]() { func(buf.get(), data_size, target, sizeof(target)); });
+        time_c    = simd_check_bench([&]() { rgy_memmem_c(buf.get(), data_size, target, sizeof(target)); });
+    }
+    return simd_check_result(result, name, simd, err_msg, bytes, time_simd, time_c);
+}
+
+//ランダムなNALユニット列を生成する
+static std::vector<uint8_t> simd_check_gen_nal(std::mt19937& mt, size_t size) {
+    std::vector<uint8_t> data(size);
+    std::uniform_int_distribution<int> dist(0, 255);
+    for (auto& d : data) d = (uint8_t)dist(mt);
+    //スタートコードがランダムに発生しないよう0を除去してから、スタートコードを埋め込む
+    for (auto& d : data) if (d == 0) d = 1;
+    for (size_t pos = 0; pos + 8 < size; pos += std::uniform_int_distribution<size_t>(6, 512)(mt)) {
+        const bool long_startcode = dist(mt) & 1;
+        if (long_startcode) {
+            data[pos++] = 0;
+        }
+        data[pos+0] = 0;
+        data[pos+1] = 0;
+        data[pos+2] = 1;
+    }
+    return data;
+}
+
+static bool simd_check_nal_equal(const std::vector<nal_info>& a, const std::vector<nal_info>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].ptr != b[i].ptr || a[i].type != b[i].type || a[i].size != b[i].size
+            || a[i].nuh_layer_id != b[i].nuh_layer_id || a[i].temporal_id != b[i].temporal_id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int simd_check_parse_nal(tstring& result, const RGYSIMDCheckPrm& prm, const TCHAR *name, RGY_SIMD simd,
+    decltype(parse_nal_unit_h264_c) *func, decltype(parse_nal_unit_h264_c) *func_c) {
+    if ((get_availableSIMD() & simd) != simd) {
+        return 0;
+    }
+    std::mt19937 mt(prm.seed);
+    tstring err_msg;
+    for (int iloop = 0; iloop < prm.loop * 16 && err_msg.length() == 0; iloop++) {
+        const auto data = simd_check_gen_nal(mt, std::uniform_int_distribution<size_t>(0, 16384)(mt));
+        const auto nal_c = func_c(data.data(), data.size());
+        const auto nal_simd = func(data.data(), data.size());
+        if (!simd_check_nal_equal(nal_c, nal_simd)) {
+            err_msg = strsprintf(_T("mismatch: size %d, nal count %d (C: %d)"), (int)data.size(), (int)nal_simd.size(), (int)nal_c.size());
+        }
+    }
+    double bytes = 0.0, time_simd = 0.0, time_c = 0.0;
+    if (err_msg.length() == 0 && prm.benchmark) {
+        const auto data = simd_check_gen_nal(mt, 4 * 1024 * 1024);
+        bytes = (double)data.size();
+        time_simd = simd_check_bench([&]() { func(data.data(), data.size()); });
+        time_c    = simd_check_bench([&]() { func_c(data.data(), data.size()); });
+    }
+    return simd_check_result(result, name, simd, err_msg, bytes, time_simd, time_c);
+}
+
+static int simd_check_find_header(tstring& result, const RGYSIMDCheckPrm& prm, const TCHAR *name, RGY_SIMD simd, decltype(find_header_c) *func) {
+    if ((get_availableSIMD() & simd) != simd) {
+        return 0;
+    }
+    std::mt19937 mt(prm.seed);
+    tstring err_msg;
+    for (int iloop = 0; iloop < prm.loop * 16 && err_msg.length() == 0; iloop++) {
+        const auto data = simd_check_gen_nal(mt, std::uniform_int_distribution<size_t>(0, 16384)(mt));
+        const auto ret_c = find_header_c(data.data(), data.size());
+        const auto ret_simd = func(data.data(), data.size());
+        if (ret_c != ret_simd) {
+            err_msg = strsprintf(_T("mismatch: size %d"), (int)data.size());
+        }
+    }
+    double bytes = 0.0, time_simd = 0.0, time_c = 0.0;
+    if (err_msg.length() == 0 && prm.benchmark) {
+        std::vector<uint8_t> data(16 * 1024 * 1024, 1);
+        bytes = (double)data.size();
+        time_simd = simd_check_bench([&]() { func(data.data(), data.size()); });
+        time_c    = simd_check_bench([&]() { find_header_c(data.data(), data.size()); });
+    }
+    return simd_check_result(result, name, simd, err_msg, bytes, time_simd, time_c);
+}
+
+static int simd_check_find_nal_escape(tstring& result, const RGYSIMDCheckPrm& prm, const TCHAR *name, RGY_SIMD simd, decltype(find_nal_escape_c) *func) {
+    if ((get_availableSIMD() & simd) != simd) {
+        return 0;
+    }
+    std::mt19937 mt(prm.seed);
+    std::uniform_int_distribution<int> dist(0, 255);
+    tstring err_msg;
+    for (int iloop = 0; iloop < prm.loop * 16 && err_msg.length() == 0; iloop++) {
+        //0と0x00-0x03が連続しやすいデータで、見つかった位置から順に比較する
+        std::vector<uint8_t> data(std::uniform_int_distribution<size_t>(0, 16384)(mt));
+        for (auto& d : data) d = (dist(mt) < 32) ? (uint8_t)(dist(mt) & 0x03) : (uint8_t)dist(mt);
+        for (size_t pos = 0; pos <= data.size() && err_msg.length() == 0;) {
+            const auto ret_c = find_nal_escape_c(data.data() + pos, data.size() - pos);
+            const auto ret_simd = func(data.data() + pos, data.size() - pos);
+            if (ret_c != ret_simd) {
+                err_msg = strsprintf(_T("mismatch: size %d, pos %d"), (int)data.size(), (int)pos);
+            }
+            if (ret_c == RGY_NAL_START_CODE_NOT_FOUND) break;
+            pos += ret_c + 1;
+        }
+    }
+    double bytes = 0.0, time_simd = 0.0, time_c = 0.0;
+    if (err_msg.length() == 0 && prm.benchmark) {
+        std::vector<uint8_t> data(16 * 1024 * 1024, 1);
+        bytes = (double)data.size();
+        time_simd = simd_check_bench([&]() { func(data.data(), data.size()); });
+        time_c    = simd_check_bench([&]() { find_nal_escape_c(data.data(), data.size()); });
+    }
+    return simd_check_result(result, name, simd, err_msg, bytes, time_simd, time_c);
+}
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
+static int simd_check_fawstart1(tstring& result, const RGYSIMDCheckPrm& prm, const TCHAR *name, RGY_SIMD simd, decltype(rgy_memmem_fawstart1_c) *func) {
+    if ((get_availableSIMD() & simd) != simd) {
+        return 0;
+    }
+    std::mt19937 mt(prm.seed);
+    tstring err_msg;
+    for (int iloop = 0; iloop < prm.loop * 16 && err_msg.length() == 0; iloop++) {
+        std::vector<uint8_t> data(std::uniform_int_distribution<size_t>(0, 16384)(mt));
+        std::uniform_int_distribution<int> dist(0, 255);
+        for (auto& d : data) d = (uint8_t)dist(mt);
+        if (data.size() >= fawstart1.size() && (iloop & 1)) {
+            const size_t pos = std::uniform_int_distribution<size_t>(0, data.size() - fawstart1.size())(mt);
+            memcpy(data.data() + pos, fawstart1.data(), fawstart1.size());
+        }
+        const auto ret_c = rgy_memmem_fawstart1_c(data.data(), data.size());
+        const auto ret_simd = func(data.data(), data.size());
+        if (ret_c != ret_simd) {
+            err_msg = strsprintf(_T("mismatch: size %d"), (int)data.size());
+        }
+    }
+    double bytes = 0.0, time_simd = 0.0, time_c = 0.0;
+    if (err_msg.length() == 0 && prm.benchmark) {
+        std::vector<uint8_t> data(16 * 1024 * 1024, 0);
+        bytes = (double)data.size();
+        time_simd = simd_check_bench([&]() { func(data.data(), data.size()); });
+        time_c    = simd_check_bench([&]() { rgy_memmem_fawstart1_c(data.data(), data.size()); });
+    }
+    return simd_check_result(result, name, simd, err_msg, bytes, time_simd, time_c);
+}
+
+static int simd_check_audio16to8(tstring& result, const RGYSIMDCheckPrm& prm) {
+    const RGY_SIMD simd = RGY_SIMD::AVX2;
+    if ((get_availableSIMD() & simd) != simd) {
+        return 0;
+    }
+    std::mt19937 mt(prm.seed);
+    std::uniform_int_distribution<int> dist(-32768, 32767);
+    int errors = 0;
+    for (int split = 0; split < 2; split++) {
+        tstring err_msg;
+        for (int iloop = 0; iloop < prm.loop * 16 && err_msg.length() == 0; iloop++) {
+            const size_t n = std::uniform_int_distribution<size_t>(0, 8192)(mt);
+            std::vector<short> src(n);
+            for (auto& s : src) s = (short)dist(mt);
+            std::vector<uint8_t> dst_c(n * 2 + 64, 0), dst_simd(n * 2 + 64, 0);
+            if (split) {
+                rgy_split_audio_16to8x2(dst_c.data(), dst_c.data() + n + 32, src.data(), n);
+                rgy_split_audio_16to8x2_avx2(dst_simd.data(), dst_simd.data() + n + 32, src.data(), n);
+            } else {
+                rgy_convert_audio_16to8(dst_c.data(), src.data(), n);
+                rgy_convert_audio_16to8_avx2(dst_simd.data(), src.data(), n);
+            }
+            if (dst_c != dst_simd) {
+                err_msg = strsprintf(_T("mismatch: n %d"), (int)n);
+            }
+        }
+        double bytes = 0.0, time_simd = 0.0, time_c = 0.0;
+        if (err_msg.length() == 0 && prm.benchmark) {
+            const size_t n = 4 * 1024 * 1024;
+            std::vector<short> src(n, 0);
+            std::vector<uint8_t> dst(n * 2);
+            bytes = (double)(n * sizeof(short));
+            if (split) {
+                time_simd = simd_check_bench([&]() { rgy_split_audio_16to8x2_avx2(dst.data(), dst.data() + n, src.data(), n); });
+                time_c    = simd_check_bench([&]() { rgy_split_audio_16to8x2(dst.data(), dst.data() + n, src.data(), n); });
+            } else {
+                time_simd = simd_check_bench([&]() { rgy_convert_audio_16to8_avx2(dst.data(), src.data(), n); });
+                time_c    = simd_check_bench([&]() { rgy_convert_audio_16to8(dst.data(), src.data(), n); });
+            }
+        }
+        errors += simd_check_result(result, (split) ? _T("split_audio_16to8x2") : _T("convert_audio_16to8"), simd, err_msg, bytes, time_simd, time_c);
+    }
+    return errors;
+}
+#endif //#if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
+
+int rgy_check_simd(tstring& result, const RGYSIMDCheckPrm& prm) {
+    int errors = 0;
+    result += strsprintf(_T("SIMD check (available: %s, seed: %u)\n"), simd_check_name(get_availableSIMD()).c_str(), prm.seed);
+    result += _T("convert_csp\n");
+    errors += simd_check_convert_csp(result, prm);
+
+    result += _T("memmem / bitstream\n");
+#if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
+#if defined(_M_X64) || defined(__x86_64)
+    errors += simd_check_memmem(result, prm, _T("memmem"), RGY_SIMD::AVX512BW, rgy_memmem_avx512bw);
+#endif
+    errors += simd_check_memmem(result, prm, _T("memmem"), RGY_SIMD::AVX2, rgy_memmem_avx2);
+#if defined(_M_X64) || defined(__x86_64)
+    errors += simd_check_parse_nal(result, prm, _T("parse_nal_unit_h264"), RGY_SIMD::AVX512BW, parse_nal_unit_h264_avx512bw, parse_nal_unit_h264_c);
+    errors += simd_check_parse_nal(result, prm, _T("parse_nal_unit_hevc"), RGY_SIMD::AVX512BW, parse_nal_unit_hevc_avx512bw, parse_nal_unit_hevc_c);
+    errors += simd_check_find_header(result, prm, _T("find_header"), RGY_SIMD::AVX512BW, find_header_avx512bw);
+    errors += simd_check_find_nal_escape(result, prm, _T("find_nal_escape"), RGY_SIMD::AVX512BW, find_nal_escape_avx512bw);
+#endif
+    errors += simd_check_parse_nal(result, prm, _T("parse_nal_unit_h264"), RGY_SIMD::AVX2, parse_nal_unit_h264_avx2, parse_nal_unit_h264_c);
+    errors += simd_check_parse_nal(result, prm, _T("parse_nal_unit_hevc"), RGY_SIMD::AVX2, parse_nal_unit_hevc_avx2, parse_nal_unit_hevc_c);
+    errors += simd_check_find_header(result, prm, _T("find_header"), RGY_SIMD::AVX2, find_header_avx2);
+    errors += simd_check_find_nal_escape(result, prm, _T("find_nal_escape"), RGY_SIMD::AVX2, find_nal_escape_avx2);
+
+    result += _T("faw\n");
+#if defined(_M_X64) || defined(__x86_64)
+    errors += simd_check_fawstart1(result, prm, _T("memmem_fawstart1"), RGY_SIMD::AVX512BW, rgy_memmem_fawstart1_avx512bw);
+#endif
+    errors += simd_check_fawstart1(result, prm, _T("memmem_fawstart1"), RGY_SIMD::AVX2, rgy_memmem_fawstart1_avx2);
+    errors += simd_check_audio16to8(result, prm);
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    errors += simd_check_memmem(result, prm, _T("memmem"), RGY_SIMD::NEON, rgy_memmem_neon);
+    errors += simd_check_parse_nal(result, prm, _T("parse_nal_unit_h264"), RGY_SIMD::NEON, parse_nal_unit_h264_neon, parse_nal_unit_h264_c);
+    errors += simd_check_parse_nal(result, prm, _T("parse_nal_unit_hevc"), RGY_SIMD::NEON, parse_nal_unit_hevc_neon, parse_nal_unit_hevc_c);
+    errors += simd_check_find_header(result, prm, _T("find_header"), RGY_SIMD::NEON, find_header_neon);
+    errors += simd_check_find_nal_escape(result, prm, _T("find_nal_escape"), RGY_SIMD::NEON, find_nal_escape_neon);
+#endif
+    result += strsprintf(_T("%s: %d error(s)\n"), (errors) ? _T("NG") : _T("OK"), errors);
+    return errors;
+}
@@ -0,0 +1,47 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_SIMD_CHECK_H__
+#define __RGY_SIMD_CHECK_H__
+
+#include <cstdint>
+#include "rgy_tchar.h"
+
+struct RGYSIMDCheckPrm {
+    int loop;       // 乱数パラメータでの比較回数
+    bool benchmark; // 速度計測を行うか
+    uint32_t seed;  // 乱数のシード
+
+    RGYSIMDCheckPrm() : loop(16), benchmark(true), seed(0) {};
+};
+
+// SIMD版の関数をC版と比較し、その結果を返す
+// 戻り値は不一致となった関数の数
+int rgy_check_simd(tstring& result, const RGYSIMDCheckPrm& prm);
+
+#endif //__RGY_SIMD_CHECK_H__
@@ -38,6 +38,7 @@
 #include <chrono>
 #include <memory>
 #include <vector>
+#include <mutex>
 #include <cmath>
 #include <algorithm>
 #include "rgy_err.h"
@@ -126,6 +127,7 @@ protected:
     std::chrono::system_clock::time_point m_tmStart;          //エンコード開始時刻
     std::chrono::system_clock::time_point m_tmLastUpdate;     //最終更新時刻
     RGYParallelEncodeStatusData *m_peStatusShare; // 子エンコーダ側から親への進捗表示共有するためのクラスへのポインタ (実体はRGYParallelEncProcess::m_sendData::encStatus)
+    std::mutex m_childStatusMtx; // チャンクの起動に合わせて別スレッドから追加されるので、ロックして参照する
     std::vector<std::pair<double, RGYParallelEncodeStatusData*>> m_childStatus; // 親側で使用する、子エンコーダの担当割合と子エンコーダから進捗表示を取得するクラスへのポインタ (実体はRGYParallelEncProcess::m_sendData::encStatus)
     bool m_bStdErrWriteToConsole;
     bool m_bEncStarted;
@@ -626,7 +626,17 @@ bool SetThreadPowerThrottolingModeForModule(const uint32_t TargetProcessId, cons
     }
     return ret;
 }
+void RGYSetCurrentThreadName(const char *name) {
+    // Windowsではスレッド名は使用していない
+    UNREFERENCED_PARAMETER(name);
+}
 #else
+void RGYSetCurrentThreadName(const char *name) {
+    // pthread_setname_npは終端を含め16文字まで
+    char buf[16] = { 0 };
+    strncpy(buf, name, sizeof(buf) - 1);
+    pthread_setname_np(pthread_self(), buf);
+}
 bool SetThreadPriorityForModule(const uint32_t TargetProcessId, const TCHAR* TargetModule, const RGYThreadPriority ThreadPriority) {
     return false;
 }
@@ -216,4 +216,17 @@ bool SetThreadAffinityForModule(const uint32_t TargetProcessId, const TCHAR *Tar
 bool SetThreadPowerThrottolingMode(RGYThreadHandle threadHandle, const RGYThreadPowerThrottlingMode mode);
 bool SetThreadPowerThrottolingModeForModule(const uint32_t TargetProcessId, const TCHAR* TargetModule, const RGYThreadPowerThrottlingMode mode);
 
+// perf monitorがスレッドを識別するためのスレッド名 (15文字まで)
+static const char *const RGY_THREAD_NAME_DEC       = "rgy_dec";
+static const char *const RGY_THREAD_NAME_ENC       = "rgy_enc";
+static const char *const RGY_THREAD_NAME_INPUT     = "rgy_input";
+static const char *const RGY_THREAD_NAME_OUTPUT    = "rgy_output";
+static const char *const RGY_THREAD_NAME_PERF_MON  = "rgy_perfmon";
+static const char *const RGY_THREAD_NAME_LOG       = "rgy_log";
+static const char *const RGY_THREAD_NAME_PIPELINE  = "rgy_pipeline";
+static const char *const RGY_THREAD_NAME_METRICS   = "rgy_metrics";
+
+// 呼び出したスレッドに名前を設定する (Linuxのみ)
+void RGYSetCurrentThreadName(const char *name);
+
 #endif //__RGY_THREAD_AFFINITY_H__
@@ -30,6 +30,7 @@
 #define __RGY_THREAD_POOL_H__
 
 #include <vector>
+#include <algorithm>
 #include <queue>
 #include <thread>
 #include <mutex>
@@ -37,74 +38,578 @@
 #include <functional>
 #include <future>
 #include <memory>
+#include <atomic>
+#include "rgy_osdep.h"
+#include "rgy_queue.h"
+#include "rgy_thread_affinity.h"
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <cerrno>
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#endif
 
+class RGYThreadPoolGroup;
+
+//スレッドプールに投入するタスク
+//関数ポインタと引数のみを持ち、投入時にメモリ確保を行わない
+struct RGYThreadPoolTask {
+    void (*func)(void *ctx, int index); //実行する関数
+    void *ctx;                          //funcに渡すデータ
+    int index;                          //funcに渡すインデックス
+    RGYThreadPoolGroup *group;          //完了を通知するグループ (nullptrなら通知しない)
+};
+
+//タスクの完了待ちを行うためのカウンタ
+//parallel_forなどで呼び出し側のスタック上に置いて使用する
+class RGYThreadPoolGroup {
+public:
+    RGYThreadPoolGroup() : m_remaining(0) {};
+    void add(int n) { m_remaining.fetch_add(n, std::memory_order_relaxed); }
+    //RGYThreadPool::waitで眠っているスレッドとの間で取りこぼしがないよう、seq_cstで操作する
+    void done() { m_remaining.fetch_sub(1, std::memory_order_seq_cst); }
+    bool finished() const { return m_remaining.load(std::memory_order_seq_cst) == 0; }
+private:
+    std::atomic<int> m_remaining;
+};
+
+//各ワーカーが持つ固定長のwork-stealing deque (Chase-Lev)
+//push/popは所有するワーカーのみ、stealは任意のスレッドから呼んでよい
+class RGYThreadPoolDeque {
+public:
+    static const int64_t DEQUE_SIZE = 256; //2の累乗
+    RGYThreadPoolDeque() : m_top(0), m_bottom(0), m_buf() {};
+    //満杯ならfalseを返す
+    bool push(const RGYThreadPoolTask& task) {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed);
+        const int64_t t = m_top.load(std::memory_order_acquire);
+        if (b - t >= DEQUE_SIZE) {
+            return false;
+        }
+        m_buf[b & (DEQUE_SIZE - 1)] = task;
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+    bool pop(RGYThreadPoolTask *task) {
+        const int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+        if (t > b) {
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        *task = m_buf[b & (DEQUE_SIZE - 1)];
+        if (t == b) {
+            //最後の1つはstealと競合するので、topを進めて取り合う
+            const bool won = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+    bool steal(RGYThreadPoolTask *task) {
+        int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = m_bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return false;
+        }
+        *task = m_buf[t & (DEQUE_SIZE - 1)];
+        return m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+private:
+    alignas(64) std::atomic<int64_t> m_top;
+    alignas(64) std::atomic<int64_t> m_bottom;
+    alignas(64) RGYThreadPoolTask m_buf[DEQUE_SIZE];
+};
+
+//同じマシン上のプロセス間で、スレッドプールのワーカーが同時に実行できる数(枠)を制限する
+//複数のエンコードを同時に実行しても、各プロセスのプールのワーカーの合計が論理コア数を超えないようにする
+//プロセスが異常終了しても、保持していた枠はOSにより返却される
+//  Windows: 名前付きmutexを枠の数だけ作成し、いずれかを所有している間だけ実行する (放棄されたmutexは取得可能になる)
+//  Linux  : ユーザーごとのディレクトリに枠の数だけファイルを作成し、いずれかをflockしている間だけ実行する
+//           ロックはファイルを閉じると (プロセス終了時も) 解除され、カーネルに何も残らない
+//           ファイルは枠の番号ごとに1つで、$XDG_RUNTIME_DIRにある場合はログアウト時に削除される
+class RGYThreadPoolSlots {
+public:
+#if defined(_WIN32) || defined(_WIN64)
+    static const int MAX_SLOTS = 64; //WaitForMultipleObjectsの上限
+    RGYThreadPoolSlots(int slots) : m_handles() {
+        slots = std::min(std::max(slots, 1), MAX_SLOTS);
+        for (int i = 0; i < slots; i++) {
+            char name[64];
+            sprintf_s(name, "Local\\RGYThreadPoolSlot%d", i);
+            HANDLE handle = CreateMutexA(nullptr, FALSE, name);
+            if (handle == nullptr) {
+                close();
+                return;
+            }
+            m_handles.push_back(handle);
+        }
+    }
+    ~RGYThreadPoolSlots() {
+        close();
+    }
+    bool valid() const { return !m_handles.empty(); }
+    //枠を1つ取得する timeout_ms以内に取得できなければ-1を返す
+    int acquire(uint32_t timeout_ms) {
+        const DWORD count = (DWORD)m_handles.size();
+        const DWORD ret = WaitForMultipleObjects(count, m_handles.data(), FALSE, timeout_ms);
+        if (WAIT_OBJECT_0 <= ret && ret < WAIT_OBJECT_0 + count) {
+            return (int)(ret - WAIT_OBJECT_0);
+        }
+        if (WAIT_ABANDONED_0 <= ret && ret < WAIT_ABANDONED_0 + count) {
+            return (int)(ret - WAIT_ABANDONED_0);
+        }
+        return -1;
+    }
+    //acquireで取得した枠を返却する (mutexなので、acquireしたスレッドから呼ぶこと)
+    void release(int slot) {
+        ReleaseMutex(m_handles[slot]);
+    }
+private:
+    void close() {
+        for (auto handle : m_handles) {
+            CloseHandle(handle);
+        }
+        m_handles.clear();
+    }
+    std::vector<HANDLE> m_handles;
+#else
+    RGYThreadPoolSlots(int slots) : m_fds(), m_held(), m_next(0) {
+        slots = std::max(slots, 1);
+        const auto dir = slot_dir();
+        if (dir.empty()) {
+            return;
+        }
+        for (int i = 0; i < slots; i++) {
+            const auto path = dir + "/slot" + std::to_string(i);
+            const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, S_IRUSR | S_IWUSR);
+            if (fd < 0) {
+                close();
+                return;
+            }
+            m_fds.push_back(fd);
+        }
+        m_held = std::make_unique<std::atomic<bool>[]>(m_fds.size());
+        for (size_t i = 0; i < m_fds.size(); i++) {
+            m_held[i] = false;
+        }
+    }
+    ~RGYThreadPoolSlots() {
+        close();
+    }
+    bool valid() const { return !m_fds.empty(); }
+    //枠を1つ取得する timeout_ms以内に取得できなければ-1を返す
+    //flockにはタイムアウトがないので、すべての枠が他のプロセスに使われている間は2msごとに再試行する
+    int acquire(uint32_t timeout_ms) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        for (;;) {
+            const int slot = try_acquire();
+            if (slot >= 0) {
+                return slot;
+            }
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                return -1;
+            }
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(deadline - now, std::chrono::milliseconds(2)));
+        }
+    }
+    //acquireで取得した枠を返却する
+    void release(int slot) {
+        flock(m_fds[slot], LOCK_UN);
+        m_held[slot].store(false, std::memory_order_release);
+    }
+private:
+    //枠のファイルを置くディレクトリ (他のユーザーのものは使わない)
+    static std::string slot_dir() {
+        const char *runtime = getenv("XDG_RUNTIME_DIR");
+        const auto dir = (runtime && runtime[0])
+            ? std::string(runtime) + "/rgy_thread_pool_slots"
+            : std::string("/tmp/rgy_thread_pool_slots_") + std::to_string(getuid());
+        if (mkdir(dir.c_str(), S_IRWXU) != 0 && errno != EEXIST) {
+            return "";
+        }
+        struct stat st;
+        if (lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid()) {
+            return "";
+        }
+        return dir;
+    }
+    //空いている枠を1つ取得する
+    //flockは同じプロセス内でもfdが同じなら排他されないので、プロセス内の排他はm_heldで行う
+    int try_acquire() {
+        const int n = (int)m_fds.size();
+        const int offset = (int)(m_next.fetch_add(1, std::memory_order_relaxed) % (uint32_t)n);
+        for (int i = 0; i < n; i++) {
+            const int slot = (offset + i) % n;
+            bool expected = false;
+            if (!m_held[slot].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                continue;
+            }
+            if (flock(m_fds[slot], LOCK_EX | LOCK_NB) == 0) {
+                return slot;
+            }
+            m_held[slot].store(false, std::memory_order_release);
+        }
+        return -1;
+    }
+    void close() {
+        for (auto fd : m_fds) {
+            ::close(fd);
+        }
+        m_fds.clear();
+    }
+    std::vector<int> m_fds; //枠ごとのファイル (開いたままにし、flockで取得する)
+    std::unique_ptr<std::atomic<bool>[]> m_held; //プロセス内で使用中の枠
+    std::atomic<uint32_t> m_next; //次に探し始める枠
+#endif
+public:
+    //プロセス内で共有する、論理コア数分の枠を取得する
+    //作成できなかった場合はnullptrを返す (制限なしで動作する)
+    static std::shared_ptr<RGYThreadPoolSlots> shared() {
+        static std::shared_ptr<RGYThreadPoolSlots> slots = []() {
+            auto ptr = std::make_shared<RGYThreadPoolSlots>((int)std::thread::hardware_concurrency());
+            return (ptr->valid()) ? ptr : std::shared_ptr<RGYThreadPoolSlots>();
+        }();
+        return slots;
+    }
+};
+
+//work-stealing型のスレッドプール
+//ワーカーは自分のdequeから取り出し、空なら外部からの投入キュー、他のワーカーのdequeの順にタスクを探す
+//ワーカーから投入されたタスクは自分のdequeへ、それ以外のスレッドからのタスクは投入キューへ入る
+//slotsを指定した場合、ワーカーはタスクを実行する間slotsの枠を1つ保持する (待機する前に返却する)
+//dequeは論理コア数 (num_threadsがそれより多ければnum_threads) 分を最初に確保し、grow()でその数までワーカーを追加できる
 class RGYThreadPool {
 public:
-    RGYThreadPool(int num_threads = 0) {
+    RGYThreadPool(int num_threads = 0, RGYParamThread threadParam = RGYParamThread(), std::shared_ptr<RGYThreadPoolSlots> slots = nullptr) :
+        m_threadParam(threadParam), m_slots(slots), m_deques(), m_workers(), m_numThreads(0), m_growMutex(), m_injection(), m_pending(0), m_sleeping(0), m_waiters(0),
+        m_mutex(), m_condition(), m_conditionWait(), m_stop(false) {
         if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
         num_threads = std::max(num_threads, 1);
-        for (int i = 0; i < num_threads; i++) {
-            workers.emplace_back([this] {
-                while (true) {
-                    std::function<void()> task;
-                    {
-                        std::unique_lock<std::mutex> lock(queue_mutex);
-                        condition.wait(lock, [this] {
-                            return stop || !tasks.empty();
-                        });
-                        
-                        if (stop && tasks.empty()) {
-                            return;
-                        }
-                        
-                        task = std::move(tasks.front());
-                        tasks.pop();
-                    }
-                    task();
-                }
+        const int capacity = std::max(num_threads, (int)std::thread::hardware_concurrency());
+        m_injection.init(1024);
+        m_deques.reserve(capacity);
+        for (int i = 0; i < capacity; i++) {
+            m_deques.push_back(std::make_unique<RGYThreadPoolDeque>());
+        }
+        m_workers.reserve(capacity);
+        grow(num_threads);
+    }
+
+    ~RGYThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_condition.notify_all();
+        m_conditionWait.notify_all();
+        std::lock_guard<std::mutex> lock(m_growMutex);
+        for (std::thread &worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    int threads() const { return m_numThreads.load(); }
+    int capacity() const { return (int)m_deques.size(); }
+    const RGYParamThread& threadParam() const { return m_threadParam; }
+
+    //ワーカーがnum_threads (0なら論理コア数) 未満なら追加する 追加できるのはcapacity()まで
+    void grow(int num_threads) {
+        if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+        num_threads = std::min(num_threads, capacity());
+        std::lock_guard<std::mutex> lock(m_growMutex);
+        for (int i = (int)m_workers.size(); i < num_threads && !m_stop; i++) {
+            m_workers.emplace_back(&RGYThreadPool::worker_func, this, i);
+            m_numThreads++;
+        }
+    }
+
+    //メモリ確保なしでタスクを投入する
+    bool submit(const RGYThreadPoolTask& task) {
+        if (m_stop) {
+            return false;
+        }
+        const int workerId = current_worker_id(this);
+        if (workerId < 0 || !m_deques[workerId]->push(task)) {
+            if (!m_injection.push_no_event(task)) {
+                return false;
+            }
+        }
+        m_pending.fetch_add(1);
+        if (m_sleeping.load() > 0 || m_waiters.load() > 0) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.notify_one();
+            m_conditionWait.notify_all();
+        }
+        return true;
+    }
+
+    //groupのタスクがすべて終了するまで待つ
+    //待機中も呼び出し側のスレッドでタスクを実行するので、ワーカーから呼んでもデッドロックしない
+    //実行できるタスクがなければ、groupのタスクが終了するか新たなタスクが投入されるまで眠る
+    void wait(RGYThreadPoolGroup& group) {
+        const int workerId = current_worker_id(this);
+        while (!group.finished()) {
+            RGYThreadPoolTask task;
+            if (get_task(workerId, &task)) {
+                run_task(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_waiters++;
+            m_conditionWait.wait(lock, [this, &group] {
+                return group.finished() || m_pending.load() > 0 || m_stop;
             });
+            m_waiters--;
+        }
+    }
+
+    //func(0) ～ func(n-1) を並列に実行し、すべての終了を待つ
+    //func(0)は呼び出し側のスレッドで実行する
+    template<typename Func>
+    void parallel_for(int n, Func&& func) {
+        using FuncType = typename std::remove_reference<Func>::type;
+        if (n <= 0) return;
+        RGYThreadPoolGroup group;
+        group.add(n - 1);
+        for (int i = 1; i < n; i++) {
+            RGYThreadPoolTask task;
+            task.func = [](void *ctx, int index) { (*(FuncType *)ctx)(index); };
+            task.ctx = (void *)&func;
+            task.index = i;
+            task.group = &group;
+            if (!submit(task)) {
+                run_task(task);
+            }
         }
+        func(0);
+        wait(group);
     }
 
     template<class F, class... Args>
-    auto enqueue(F&& f, Args&&... args) 
+    auto enqueue(F&& f, Args&&... args)
         -> std::future<typename std::invoke_result<F, Args...>::type> {
         using return_type = typename std::invoke_result<F, Args...>::type;
 
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
+        auto task = new std::packaged_task<return_type()>(
             std::bind(std::forward<F>(f), std::forward<Args>(args)...)
         );
 
         std::future<return_type> res = task->get_future();
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            if (stop) {
-                throw std::runtime_error("スレッドプールは停止しています");
-            }
-            tasks.emplace([task]() { (*task)(); });
+        RGYThreadPoolTask poolTask;
+        poolTask.func = [](void *ctx, int) {
+            auto ptr = std::unique_ptr<std::packaged_task<return_type()>>((std::packaged_task<return_type()> *)ctx);
+            (*ptr)();
+        };
+        poolTask.ctx = task;
+        poolTask.index = 0;
+        poolTask.group = nullptr;
+        if (!submit(poolTask)) {
+            delete task;
+            throw std::runtime_error("スレッドプールは停止しています");
         }
-        condition.notify_one();
         return res;
     }
 
-    ~RGYThreadPool() {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            stop = true;
+    //プロセス内で共有するスレッドプールを取得する
+    //スレッドのパラメータごとに1つのプールを共有し、スレッド数が足りなければそのプールにワーカーを追加する
+    //共有プールのワーカーはRGYThreadPoolSlots::shared()の枠を使用し、同時に実行するプロセス間で論理コア数を超えないようにする
+    static std::shared_ptr<RGYThreadPool> shared(int num_threads, const RGYParamThread& threadParam) {
+        static std::mutex mtx;
+        static std::vector<std::pair<RGYParamThread, std::weak_ptr<RGYThreadPool>>> sharedPools;
+        std::lock_guard<std::mutex> lock(mtx);
+        sharedPools.erase(std::remove_if(sharedPools.begin(), sharedPools.end(),
+            [](const std::pair<RGYParamThread, std::weak_ptr<RGYThreadPool>>& p) { return p.second.expired(); }), sharedPools.end());
+        for (auto& p : sharedPools) {
+            if (p.first == threadParam) {
+                auto pool = p.second.lock();
+                if (pool) {
+                    pool->grow(num_threads);
+                    return pool;
+                }
+            }
         }
-        condition.notify_all();
-        for (std::thread &worker : workers) {
-            worker.join();
+        auto pool = std::make_shared<RGYThreadPool>(num_threads, threadParam, RGYThreadPoolSlots::shared());
+        sharedPools.push_back(std::make_pair(threadParam, std::weak_ptr<RGYThreadPool>(pool)));
+        return pool;
+    }
+
+private:
+    //現在のスレッドがpoolのワーカーならそのid、そうでなければ-1を返す
+    static int current_worker_id(const RGYThreadPool *pool, int set_id = -1) {
+        thread_local const RGYThreadPool *tl_pool = nullptr;
+        thread_local int tl_id = -1;
+        if (set_id >= 0) {
+            tl_pool = pool;
+            tl_id = set_id;
+        }
+        return (tl_pool == pool) ? tl_id : -1;
+    }
+
+    bool get_task(int workerId, RGYThreadPoolTask *task) {
+        bool found = (workerId >= 0 && m_deques[workerId]->pop(task))
+            || m_injection.pop_no_event(task);
+        const int nDeques = (int)m_deques.size();
+        for (int i = 1; !found && i <= nDeques; i++) {
+            const int target = (std::max(workerId, 0) + i) % nDeques;
+            found = target != workerId && m_deques[target]->steal(task);
+        }
+        if (found) {
+            m_pending.fetch_sub(1);
         }
+        return found;
     }
 
+    void run_task(const RGYThreadPoolTask& task) {
+        task.func(task.ctx, task.index);
+        if (task.group) {
+            //done()の後はgroupが破棄されている可能性があるので、以降はgroupに触れない
+            task.group->done();
+            if (m_waiters.load() > 0) {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_conditionWait.notify_all();
+            }
+        }
+    }
+
+    //枠を取得できるまで待つ 停止が要求された場合は-1を返す
+    int acquire_slot() {
+        while (!m_stop) {
+            const int slot = m_slots->acquire(16);
+            if (slot >= 0) {
+                return slot;
+            }
+        }
+        return -1;
+    }
+
+    void worker_func(int workerId) {
+        current_worker_id(this, workerId);
+        m_threadParam.apply(GetCurrentThread());
+        int slot = -1;
+        for (;;) {
+            if (m_slots && slot < 0 && m_pending.load() > 0) {
+                slot = acquire_slot();
+            }
+            RGYThreadPoolTask task;
+            //枠を持っていない場合は、停止処理中を除いてタスクを実行しない
+            if ((!m_slots || slot >= 0 || m_stop) && get_task(workerId, &task)) {
+                run_task(task);
+                continue;
+            }
+            if (slot >= 0) {
+                m_slots->release(slot);
+                slot = -1;
+            }
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_sleeping++;
+            m_condition.wait(lock, [this] {
+                return m_stop || m_pending.load() > 0;
+            });
+            m_sleeping--;
+            if (m_stop && m_pending.load() == 0) {
+                return;
+            }
+        }
+    }
+
+    RGYParamThread m_threadParam;
+    std::shared_ptr<RGYThreadPoolSlots> m_slots; //プロセス間で共有する実行枠 (nullptrなら制限しない)
+    std::vector<std::unique_ptr<RGYThreadPoolDeque>> m_deques; //capacity()分 (起動していないワーカーのdequeは空のまま)
+    std::vector<std::thread> m_workers;
+    std::atomic<int> m_numThreads; //起動済みのワーカーの数
+    std::mutex m_growMutex; //m_workersの操作用
+    RGYQueueLockFree<RGYThreadPoolTask> m_injection; //ワーカー以外のスレッドから投入されたタスク
+    std::atomic<int> m_pending;  //まだ取り出されていないタスクの数
+    std::atomic<int> m_sleeping; //待機中のワーカーの数
+    std::atomic<int> m_waiters;  //waitで眠っているスレッドの数
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;     //ワーカーの待機用
+    std::condition_variable m_conditionWait; //waitの待機用
+    std::atomic<bool> m_stop;
+};
+
+//プール上で順番に実行される処理 (strand)
+//kick()されるとfuncを実行するタスクをプールに投入する
+//funcが同時に複数実行されることはなく、実行中にkick()された場合は、終了後にもう一度funcを実行する
+//専用のスレッドを持たずに、キューにたまったデータを順番に処理する用途向け
+//スレッド単位でCPU使用率を測れないので、funcの実行に使ったCPU時間をcpu_time_us()で取得できるようにする
+class RGYThreadPoolSerial {
+public:
+    RGYThreadPoolSerial(std::shared_ptr<RGYThreadPool> pool, std::function<void()> func) :
+        m_pool(pool), m_func(func), m_requests(0), m_cpuTimeUs(0), m_group() {};
+    ~RGYThreadPoolSerial() {
+        wait();
+    }
+    void kick() {
+        if (m_requests.fetch_add(1, std::memory_order_acq_rel) == 0) {
+            m_group.add(1);
+            RGYThreadPoolTask task;
+            task.func = [](void *ctx, int) { ((RGYThreadPoolSerial *)ctx)->run(); };
+            task.ctx = this;
+            task.index = 0;
+            task.group = &m_group;
+            if (!m_pool->submit(task)) {
+                //プールが停止している場合は呼び出し側で実行する
+                run();
+                m_group.done();
+            }
+        }
+    }
+    //kick()によるfuncの実行がすべて終わるまで待つ
+    void wait() {
+        m_pool->wait(m_group);
+    }
+    RGYThreadPool *pool() { return m_pool.get(); }
+    //funcの実行に使ったCPU時間の合計 (us)
+    int64_t cpu_time_us() const { return m_cpuTimeUs.load(std::memory_order_relaxed); }
 private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
-    
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    bool stop = false;
+    //現在のスレッドのCPU時間 (user + kernel, us)
+    static int64_t thread_cpu_time_us() {
+#if defined(_WIN32) || defined(_WIN64)
+        FILETIME creation, exit, kernel, user;
+        if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+            return 0;
+        }
+        return (int64_t)((((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime)
+                       + (((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime)) / 10;
+#else
+        struct timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+            return 0;
+        }
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+    }
+    void run() {
+        int requests = m_requests.load(std::memory_order_acquire);
+        for (;;) {
+            const int64_t cpuStart = thread_cpu_time_us();
+            m_func();
+            m_cpuTimeUs.fetch_add(thread_cpu_time_us() - cpuStart, std::memory_order_relaxed);
+            //実行中に追加されたkick()があれば、もう一度実行する
+            const int remain = m_requests.fetch_sub(requests, std::memory_order_acq_rel) - requests;
+            if (remain == 0) {
+                break;
+            }
+            requests = remain;
+        }
+    }
+    std::shared_ptr<RGYThreadPool> m_pool;
+    std::function<void()> m_func;
+    std::atomic<int> m_requests; //未処理のkick()の数
+    std::atomic<int64_t> m_cpuTimeUs; //funcの実行に使ったCPU時間の合計
+    RGYThreadPoolGroup m_group;
 };
 
 #endif //__RGY_THREAD_POOL_H__
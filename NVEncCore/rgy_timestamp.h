@@ -0,0 +1,271 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+
+#pragma once
+#ifndef __RGY_TIMESTAMP_H__
+#define __RGY_TIMESTAMP_H__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <limits>
+#include <algorithm>
+
+class RGYFrameData;
+
+struct RGYTimestampMapVal {
+    int64_t timestamp, inputFrameId, encodeFrameId, duration;
+    std::vector<std::shared_ptr<RGYFrameData>> dataList;
+
+    RGYTimestampMapVal() : timestamp(-1), inputFrameId(-1), encodeFrameId(-1), duration(-1), dataList() {};
+    RGYTimestampMapVal(int64_t timestamp_, int64_t inputFrameId_, int64_t encodeFrameId_, int64_t duration_, std::vector<std::shared_ptr<RGYFrameData>> datalist)
+        : timestamp(timestamp_), inputFrameId(inputFrameId_), encodeFrameId(encodeFrameId_), duration(duration_), dataList(std::move(datalist)) {};
+    void addMetadata(std::shared_ptr<RGYFrameData>& data) { dataList.push_back(data); }
+    void addMetadata(std::vector<std::shared_ptr<RGYFrameData>>& list) { dataList.insert(dataList.end(), list.begin(), list.end()); }
+};
+
+// int64_tのキー -> RGYTimestampのリングバッファの位置 のハッシュテーブル (オープンアドレス法)
+// 削除時は後続のエントリを詰める(backward shift)ので、削除済みの印が溜まらない
+class RGYTimestampIndex {
+private:
+    struct Entry {
+        int64_t key;
+        int slot; // 0未満なら空き
+    };
+    std::vector<Entry> m_table;
+    size_t m_mask;
+    int m_bits;
+    // ptsは等間隔に近い値が続くので、フィボナッチハッシュで上位ビットを使うと偏りなく分散する
+    size_t hash(int64_t key) const {
+        return (size_t)(((uint64_t)key * 0x9e3779b97f4a7c15ull) >> (64 - m_bits));
+    }
+public:
+    RGYTimestampIndex() : m_table(), m_mask(0), m_bits(1) {};
+    // capacityは2のべき乗
+    void init(size_t capacity) {
+        m_table.assign(capacity, Entry{ 0, -1 });
+        m_mask = capacity - 1;
+        m_bits = 0;
+        while (((size_t)1 << m_bits) < capacity) m_bits++;
+    }
+    int find(int64_t key) const {
+        for (size_t i = hash(key); ; i = (i + 1) & m_mask) {
+            if (m_table[i].slot < 0) return -1;
+            if (m_table[i].key == key) return m_table[i].slot;
+        }
+    }
+    // 既に登録されているキーなら上書きする
+    void set(int64_t key, int slot) {
+        for (size_t i = hash(key); ; i = (i + 1) & m_mask) {
+            if (m_table[i].slot < 0 || m_table[i].key == key) {
+                m_table[i] = Entry{ key, slot };
+                return;
+            }
+        }
+    }
+    // keyがslotを指している場合のみ削除する
+    void erase(int64_t key, int slot) {
+        size_t i = hash(key);
+        for (; ; i = (i + 1) & m_mask) {
+            if (m_table[i].slot < 0) return;
+            if (m_table[i].key == key) break;
+        }
+        if (m_table[i].slot != slot) return;
+        for (size_t j = (i + 1) & m_mask; m_table[j].slot >= 0; j = (j + 1) & m_mask) {
+            // jのエントリの本来の位置がiからjの間になければ、iに詰める
+            const size_t home = hash(m_table[j].key);
+            if (((j - home) & m_mask) >= ((j - i) & m_mask)) {
+                m_table[i] = m_table[j];
+                i = j;
+            }
+        }
+        m_table[i].slot = -1;
+    }
+};
+
+// エンコード中のフレームのtimestampとメタデータを保持する
+// フレームはadd順の通し番号でリングバッファに格納し、pts/encodeFrameIdからの索引をハッシュテーブルで持つ
+// 取り出しは常にO(1)で、古いフレームはリングバッファの上書き時に索引ごと削除する
+// まだ取り出される可能性のあるフレームを上書きしそうになった場合はリングバッファを拡張する
+class RGYTimestamp {
+private:
+    static const int RING_INIT_SIZE = 256;
+    static const int CLEAN_MARGIN = 64; // 取り出されたinputFrameIdよりこれ以上古いフレームは削除してよい
+    struct Slot {
+        int64_t seq; // addの通し番号 (0未満なら空き)
+        RGYTimestampMapVal val;
+        Slot() : seq(-1), val() {};
+    };
+    std::vector<Slot> m_ring;
+    size_t m_ringMask;
+    RGYTimestampIndex m_ptsIndex;
+    RGYTimestampIndex m_encIdIndex;
+    int64_t m_addCount;
+    int64_t m_cleanThreshold; // inputFrameIdがこれより小さいフレームは上書きしてよい
+    std::mutex mtx;
+    int64_t last_add_seq;
+    int64_t last_check_pts;
+    int64_t last_input_frame_id;
+    int64_t offset;
+    bool timestampPassThrough;
+    bool noDurationFix; // durationの修正を行わない場合にtrue
+
+    void initRing(size_t size) {
+        m_ring.clear();
+        m_ring.resize(size);
+        m_ringMask = size - 1;
+        m_ptsIndex.init(size * 2);
+        m_encIdIndex.init(size * 2);
+    }
+    void evict(int slot) {
+        auto& s = m_ring[slot];
+        m_ptsIndex.erase(s.val.timestamp, slot);
+        m_encIdIndex.erase(s.val.encodeFrameId, slot);
+        s.seq = -1;
+        s.val = RGYTimestampMapVal();
+    }
+    void grow() {
+        auto old = std::move(m_ring);
+        const size_t oldMask = m_ringMask;
+        initRing(old.size() * 2);
+        // encodeFrameIdが重複した場合に先にaddしたものを優先するため、古い順に入れなおす
+        for (int64_t seq = std::max<int64_t>(0, m_addCount - (int64_t)old.size()); seq < m_addCount; seq++) {
+            auto& s = old[(size_t)seq & oldMask];
+            if (s.seq != seq) continue;
+            const int slot = (int)((size_t)seq & m_ringMask);
+            m_ring[slot] = std::move(s);
+            m_ptsIndex.set(m_ring[slot].val.timestamp, slot);
+            if (m_encIdIndex.find(m_ring[slot].val.encodeFrameId) < 0) {
+                m_encIdIndex.set(m_ring[slot].val.encodeFrameId, slot);
+            }
+        }
+    }
+    int insert(RGYTimestampMapVal&& val) {
+        const int dup = m_ptsIndex.find(val.timestamp);
+        if (dup >= 0) { // 同じptsのフレームは上書き
+            evict(dup);
+        }
+        const auto& next = m_ring[(size_t)m_addCount & m_ringMask];
+        if (next.seq >= 0 && next.val.inputFrameId >= m_cleanThreshold) {
+            grow();
+        }
+        const int slot = (int)((size_t)m_addCount & m_ringMask);
+        if (m_ring[slot].seq >= 0) {
+            evict(slot);
+        }
+        m_ring[slot].seq = m_addCount++;
+        m_ring[slot].val = std::move(val);
+        m_ptsIndex.set(m_ring[slot].val.timestamp, slot);
+        if (m_encIdIndex.find(m_ring[slot].val.encodeFrameId) < 0) {
+            m_encIdIndex.set(m_ring[slot].val.encodeFrameId, slot);
+        }
+        return slot;
+    }
+    // メタデータはコピーせず、取り出し側に引き渡す
+    static RGYTimestampMapVal handoff(RGYTimestampMapVal& val) {
+        RGYTimestampMapVal ret(val.timestamp, val.inputFrameId, val.encodeFrameId, val.duration, std::move(val.dataList));
+        val.dataList.clear();
+        return ret;
+    }
+public:
+    RGYTimestamp(bool timestampPassThrough_, bool noDurationFix_) : m_ring(), m_ringMask(0), m_ptsIndex(), m_encIdIndex(), m_addCount(0), m_cleanThreshold(std::numeric_limits<int64_t>::min()),
+        mtx(), last_add_seq(-1), last_check_pts(-1), last_input_frame_id(-1), offset(0), timestampPassThrough(timestampPassThrough_), noDurationFix(noDurationFix_) {
+        initRing(RING_INIT_SIZE);
+    };
+    ~RGYTimestamp() {};
+    void clear() {
+        std::lock_guard<std::mutex> lock(mtx);
+        initRing(RING_INIT_SIZE);
+        m_addCount = 0;
+        m_cleanThreshold = std::numeric_limits<int64_t>::min();
+        last_add_seq = -1;
+        last_check_pts = -1;
+        offset = 0;
+    }
+    void add(int64_t pts, int64_t inputFrameId, int64_t encodeFrameId, int64_t duration, std::vector<std::shared_ptr<RGYFrameData>> metadatalist) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (last_add_seq >= 0) { // 前のフレームのdurationの更新
+            auto& last_add_pos = m_ring[(size_t)last_add_seq & m_ringMask];
+            if (last_add_pos.seq == last_add_seq) {
+                if (!noDurationFix) last_add_pos.val.duration = pts - last_add_pos.val.timestamp;
+                if (duration == 0) duration = last_add_pos.val.duration;
+            }
+        }
+        insert(RGYTimestampMapVal(pts, inputFrameId, encodeFrameId, duration, std::move(metadatalist)));
+        last_add_seq = m_addCount - 1;
+    }
+    RGYTimestampMapVal check(int64_t pts) {
+        if (last_check_pts < 0 && pts > 0 && !timestampPassThrough) {
+            offset = -pts;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        pts += offset;
+        int slot = m_ptsIndex.find(pts);
+        if (slot < 0) {
+            const int last_check_slot = m_ptsIndex.find(last_check_pts);
+            if (last_check_slot < 0) {
+                return RGYTimestampMapVal();
+            }
+            auto& last_check_pos = m_ring[last_check_slot].val;
+            pts = last_check_pos.timestamp + last_check_pos.duration / 2;
+            auto next_pts = last_check_pos.timestamp + last_check_pos.duration;
+            last_check_pos.duration = pts - last_check_pos.timestamp;
+            slot = insert(RGYTimestampMapVal(pts, last_input_frame_id, last_check_pos.encodeFrameId, next_pts - pts, last_check_pos.dataList));
+        }
+        const auto& pos = m_ring[slot].val;
+        last_input_frame_id = pos.inputFrameId;
+        last_check_pts = pos.timestamp;
+        return pos;
+    }
+    void clean(const int64_t current_id) {
+        m_cleanThreshold = std::max(m_cleanThreshold, current_id - CLEAN_MARGIN);
+    }
+    RGYTimestampMapVal getByEncodeFrameID(const int64_t id) {
+        std::lock_guard<std::mutex> lock(mtx);
+        const int slot = m_encIdIndex.find(id);
+        if (slot < 0) {
+            return RGYTimestampMapVal();
+        }
+        auto ret = handoff(m_ring[slot].val);
+        clean(ret.inputFrameId);
+        return ret;
+    }
+    RGYTimestampMapVal get(int64_t pts) {
+        std::lock_guard<std::mutex> lock(mtx);
+        const int slot = m_ptsIndex.find(pts);
+        if (slot < 0) {
+            return RGYTimestampMapVal();
+        }
+        auto ret = handoff(m_ring[slot].val);
+        clean(ret.inputFrameId);
+        return ret;
+    }
+};
+
+#endif //__RGY_TIMESTAMP_H__
@@ -0,0 +1,276 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include "rgy_trace.h"
+#include "rgy_version.h"
+#include "rgy_osdep.h"
+#include "rgy_util.h"
+
+RGYTraceHistogram::RGYTraceHistogram() :
+    m_bins(),
+    m_count(0),
+    m_sum(0),
+    m_max(0) {
+    m_bins.fill(0);
+}
+
+int RGYTraceHistogram::bin(int64_t value) {
+    if (value < (1 << SUB_BITS)) {
+        return (int)std::max<int64_t>(value, 0);
+    }
+    int msb = SUB_BITS;
+    for (int shift = 32; shift > 0; shift >>= 1) {
+        if ((value >> (msb + shift)) != 0) {
+            msb += shift;
+        }
+    }
+    const int sub = (int)(value >> (msb - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+    return ((msb - SUB_BITS + 1) << SUB_BITS) | sub;
+}
+
+int64_t RGYTraceHistogram::binValue(int idx) {
+    if (idx < (1 << SUB_BITS)) {
+        return idx;
+    }
+    const int msb = (idx >> SUB_BITS) + SUB_BITS - 1;
+    const int sub = idx & ((1 << SUB_BITS) - 1);
+    const int64_t width = (int64_t)1 << (msb - SUB_BITS);
+    return (((int64_t)1 << SUB_BITS) + sub) * width + width / 2; // binの中央の値
+}
+
+void RGYTraceHistogram::add(int64_t value) {
+    m_bins[bin(value)]++;
+    m_count++;
+    m_sum += value;
+    m_max = std::max(m_max, value);
+}
+
+void RGYTraceHistogram::merge(const RGYTraceHistogram& hist) {
+    for (int i = 0; i < BINS; i++) {
+        m_bins[i] += hist.m_bins[i];
+    }
+    m_count += hist.m_count;
+    m_sum += hist.m_sum;
+    m_max = std::max(m_max, hist.m_max);
+}
+
+int64_t RGYTraceHistogram::percentile(double ratio) const {
+    if (m_count == 0) {
+        return 0;
+    }
+    const int64_t target = std::max<int64_t>(1, (int64_t)(m_count * ratio + 0.5));
+    int64_t total = 0;
+    for (int i = 0; i < BINS; i++) {
+        total += m_bins[i];
+        if (total >= target) {
+            return std::min(binValue(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+RGYTraceThread::RGYTraceThread(int tid_) :
+    tid(tid_),
+    name(strsprintf(_T("thread#%d"), tid_)),
+    events(),
+    count(0),
+    hist() {
+}
+
+static std::atomic<uint64_t> g_traceInstanceId(0);
+
+RGYTrace::RGYTrace() :
+    m_filename(),
+    m_eventsPerThread(RGY_TRACE_EVENTS_PER_THREAD),
+    m_start(std::chrono::steady_clock::now()),
+    m_instanceId(++g_traceInstanceId),
+    m_mtx(),
+    m_events(),
+    m_threads(),
+    m_threadMap() {
+}
+
+RGYTrace::~RGYTrace() {
+}
+
+RGY_ERR RGYTrace::init(const tstring& filename, size_t eventsPerThread) {
+    m_filename = filename;
+    m_eventsPerThread = std::max<size_t>(eventsPerThread, 1);
+    m_start = std::chrono::steady_clock::now();
+    return RGY_ERR_NONE;
+}
+
+int RGYTrace::registerEvent(const tstring& category, const tstring& name) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_events.push_back({ category, name });
+    return (int)m_events.size() - 1;
+}
+
+RGYTraceThread *RGYTrace::threadData() {
+    // 同じスレッドからの2回目以降はロックを取らずに済むよう、直前に使用したものを覚えておく
+    struct TraceThreadCache {
+        uint64_t instanceId;
+        RGYTraceThread *data;
+    };
+    thread_local TraceThreadCache cache = { 0, nullptr };
+    if (cache.instanceId == m_instanceId) {
+        return cache.data;
+    }
+    std::lock_guard<std::mutex> lock(m_mtx);
+    const auto threadId = std::this_thread::get_id();
+    auto it = m_threadMap.find(threadId);
+    if (it == m_threadMap.end()) {
+        m_threads.push_back(std::make_unique<RGYTraceThread>((int)m_threads.size() + 1));
+        it = m_threadMap.insert({ threadId, m_threads.back().get() }).first;
+    }
+    cache.instanceId = m_instanceId;
+    cache.data = it->second;
+    return cache.data;
+}
+
+void RGYTrace::setThreadName(const tstring& name) {
+    auto data = threadData();
+    std::lock_guard<std::mutex> lock(m_mtx);
+    data->name = name;
+}
+
+void RGYTrace::push(RGYTraceThread *data, const RGYTraceEvent& ev) {
+    if (data->events.size() < m_eventsPerThread) {
+        data->events.push_back(ev);
+    } else {
+        data->events[data->count % m_eventsPerThread] = ev;
+    }
+    data->count++;
+}
+
+void RGYTrace::add(int id, int64_t start, int64_t frame) {
+    const int64_t end = now();
+    auto data = threadData();
+    if ((int)data->hist.size() <= id) {
+        data->hist.resize(id + 1);
+    }
+    data->hist[id].add(end - start);
+    push(data, RGYTraceEvent{ start, end - start, frame, id, RGYTraceEventType::Complete });
+}
+
+void RGYTrace::counter(int id, int64_t value) {
+    push(threadData(), RGYTraceEvent{ now(), 0, value, id, RGYTraceEventType::Counter });
+}
+
+static std::string traceJsonStr(const tstring& str) {
+    std::string ret;
+    for (const auto c : tchar_to_string(str, CP_UTF8)) {
+        switch (c) {
+        case '"':  ret += "\\\""; break;
+        case '\\': ret += "\\\\"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                ret += strsprintf("\\u%04x", (unsigned char)c);
+            } else {
+                ret += c;
+            }
+            break;
+        }
+    }
+    return ret;
+}
+
+RGY_ERR RGYTrace::write() const {
+    FILE *fp = nullptr;
+    if (_tfopen_s(&fp, m_filename.c_str(), _T("w")) != 0 || fp == nullptr) {
+        return RGY_ERR_FILE_OPEN;
+    }
+    std::unique_ptr<FILE, fp_deleter> fpTrace(fp);
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::vector<std::string> names(m_events.size());
+    std::vector<std::string> categories(m_events.size());
+    for (size_t i = 0; i < m_events.size(); i++) {
+        categories[i] = traceJsonStr(m_events[i].first);
+        names[i] = traceJsonStr(m_events[i].second);
+    }
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"%s\"}}", ENCODER_NAME);
+    for (const auto& th : m_threads) {
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", th->tid, traceJsonStr(th->name).c_str());
+    }
+    for (const auto& th : m_threads) {
+        // リングバッファの古いものから順に出力する
+        const size_t eventCount = th->events.size();
+        const size_t first = (th->count > eventCount) ? (size_t)(th->count % eventCount) : 0;
+        for (size_t i = 0; i < eventCount; i++) {
+            const auto& ev = th->events[(first + i) % eventCount];
+            if (ev.id < 0 || ev.id >= (int)m_events.size()) continue;
+            if (ev.type == RGYTraceEventType::Complete) {
+                fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+                    names[ev.id].c_str(), categories[ev.id].c_str(), ev.ts * 1e-3, ev.dur * 1e-3, th->tid);
+                if (ev.value >= 0) {
+                    fprintf(fp, ",\"args\":{\"frame\":%lld}", (long long)ev.value);
+                }
+                fprintf(fp, "}");
+            } else {
+                fprintf(fp, ",\n{\"name\":\"%s %s\",\"cat\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%lld}}",
+                    categories[ev.id].c_str(), names[ev.id].c_str(), categories[ev.id].c_str(), ev.ts * 1e-3, th->tid, (long long)ev.value);
+            }
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    return (ferror(fp)) ? RGY_ERR_UNDEFINED_BEHAVIOR : RGY_ERR_NONE;
+}
+
+tstring RGYTrace::summary() const {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::vector<RGYTraceHistogram> hist(m_events.size());
+    uint64_t dropped = 0;
+    for (const auto& th : m_threads) {
+        for (size_t i = 0; i < th->hist.size() && i < hist.size(); i++) {
+            hist[i].merge(th->hist[i]);
+        }
+        dropped += th->count - th->events.size();
+    }
+    std::vector<tstring> labels(m_events.size());
+    size_t maxLen = _tcslen(_T("Trace latency (ms)"));
+    for (size_t i = 0; i < m_events.size(); i++) {
+        labels[i] = m_events[i].first + _T(" ") + m_events[i].second;
+        maxLen = std::max(maxLen, labels[i].length());
+    }
+    tstring str = _T("Trace latency (ms)") + tstring(maxLen - _tcslen(_T("Trace latency (ms)")), _T(' '));
+    str += _T("    count      avg      p50      p99      max\n");
+    for (size_t i = 0; i < m_events.size(); i++) {
+        const auto& h = hist[i];
+        if (h.count() == 0) continue;
+        str += labels[i] + tstring(maxLen - labels[i].length(), _T(' '));
+        str += strsprintf(_T(" %8lld %8.3f %8.3f %8.3f %8.3f\n"), (long long)h.count(),
+            h.sum() * 1e-6 / h.count(), h.percentile(0.5) * 1e-6, h.percentile(0.99) * 1e-6, h.max() * 1e-6);
+    }
+    if (dropped > 0) {
+        str += strsprintf(_T("%llu events were overwritten in the trace ring buffer (latency stats include all events).\n"), (unsigned long long)dropped);
+    }
+    return str;
+}
@@ -0,0 +1,153 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_TRACE_H__
+#define __RGY_TRACE_H__
+
+#include <cstdint>
+#include <array>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "rgy_tchar.h"
+#include "rgy_err.h"
+
+static const size_t RGY_TRACE_EVENTS_PER_THREAD = 256 * 1024; // スレッドごとに保持するイベント数 (超えた分は古いものから上書き)
+
+enum class RGYTraceEventType : uint8_t {
+    Complete, // 区間 (ts〜ts+dur)
+    Counter,  // キューの長さなどの値
+};
+
+struct RGYTraceEvent {
+    int64_t ts;    // トレース開始からの時刻 (ns)
+    int64_t dur;   // 区間の長さ (ns)
+    int64_t value; // Complete: フレーム番号 (不明な場合は-1), Counter: 値
+    int32_t id;    // registerEventで登録したid
+    RGYTraceEventType type;
+};
+
+// 区間の長さの分布
+// 2倍ごとに8分割したbinで数えるので、パーセンタイルの誤差は最大12.5%程度
+class RGYTraceHistogram {
+public:
+    static const int SUB_BITS = 3;
+    static const int BINS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+    RGYTraceHistogram();
+    void add(int64_t value);
+    void merge(const RGYTraceHistogram& hist);
+    int64_t count() const { return m_count; }
+    int64_t sum() const { return m_sum; }
+    int64_t max() const { return m_max; }
+    // 指定した割合 (0.0〜1.0) の位置の値
+    int64_t percentile(double ratio) const;
+protected:
+    static int bin(int64_t value);
+    static int64_t binValue(int idx);
+
+    std::array<int64_t, BINS> m_bins;
+    int64_t m_count;
+    int64_t m_sum;
+    int64_t m_max;
+};
+
+// スレッドごとのイベントの記録先
+// 書き込みはそのスレッドからのみ行うので、記録時にはロックを取らない
+struct RGYTraceThread {
+    int tid;
+    tstring name;
+    std::vector<RGYTraceEvent> events; // リングバッファ
+    uint64_t count;                    // 記録したイベントの総数
+    std::vector<RGYTraceHistogram> hist; // Completeのイベントのidごとの分布
+
+    RGYTraceThread(int tid_);
+};
+
+// パイプラインの各タスクや入出力スレッドの処理区間・キューの長さを記録し、
+// Chrome/Perfettoで読み込めるtrace event形式のjsonと、区間ごとの処理時間の分布を出力する
+// 記録はスレッドごとのリングバッファに対して行い、出力は全スレッドの終了後に行う
+class RGYTrace {
+public:
+    RGYTrace();
+    ~RGYTrace();
+
+    RGY_ERR init(const tstring& filename, size_t eventsPerThread = RGY_TRACE_EVENTS_PER_THREAD);
+    const tstring& filename() const { return m_filename; }
+
+    // 記録する区間・カウンタを登録し、記録時に使用するidを返す
+    int registerEvent(const tstring& category, const tstring& name);
+    // 現在のスレッドの名前を設定する
+    void setThreadName(const tstring& name);
+
+    int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+    }
+    // start〜現在の区間を記録する
+    void add(int id, int64_t start, int64_t frame);
+    void counter(int id, int64_t value);
+
+    // trace event形式のjsonを書き出す
+    RGY_ERR write() const;
+    // 区間ごとの処理時間の分布 (count/avg/p50/p99/max)
+    tstring summary() const;
+protected:
+    RGYTraceThread *threadData();
+    void push(RGYTraceThread *data, const RGYTraceEvent& ev);
+
+    tstring m_filename;
+    size_t m_eventsPerThread;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_instanceId; // thread_localのキャッシュを別のインスタンスと区別するためのid
+
+    mutable std::mutex m_mtx; // m_events, m_threadsの変更時のみ使用
+    std::vector<std::pair<tstring, tstring>> m_events; // idごとの(category, name)
+    std::vector<std::unique_ptr<RGYTraceThread>> m_threads;
+    std::map<std::thread::id, RGYTraceThread *> m_threadMap;
+};
+
+// スコープの区間を記録する
+class RGYTraceScope {
+public:
+    RGYTraceScope(RGYTrace *trace, int id, int64_t frame = -1) :
+        m_trace(trace), m_id(id), m_frame(frame), m_start((trace) ? trace->now() : 0) {};
+    ~RGYTraceScope() {
+        if (m_trace) m_trace->add(m_id, m_start, m_frame);
+    }
+    void setFrame(int64_t frame) { m_frame = frame; }
+protected:
+    RGYTrace *m_trace;
+    int m_id;
+    int64_t m_frame;
+    int64_t m_start;
+};
+
+#endif //__RGY_TRACE_H__
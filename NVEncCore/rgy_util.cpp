@@ -643,6 +643,14 @@ size_t malloc_degeneracy(void **ptr, size_t nSize, size_t nMinSize) {
     return 0;
 }
 
+uint64_t hash_fnv1a(uint64_t hash, const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
 // convert float to half precision floating point
 unsigned short float2half(float value) {
     // 1 : 8 : 23
@@ -702,6 +702,10 @@ static tstring fourccToStr(uint32_t nFourCC) {
 //確保できなかったら、サイズを小さくして再度確保を試みる (最終的にnMinSizeも確保できなかったら諦める)
 size_t malloc_degeneracy(void **ptr, size_t nSize, size_t nMinSize);
 
+// 64bit FNV-1aハッシュ (分割したデータは前回の戻り値をhashに渡して続けて計算する)
+static const uint64_t RGY_FNV1A_64_INIT = 0xcbf29ce484222325ull;
+uint64_t hash_fnv1a(uint64_t hash, const uint8_t *data, size_t size);
+
 template<typename T>
 class RGYVec3 {
 public:
@@ -1954,15 +1954,51 @@ class Kernel;
 class Program;
 class JitCache;
 
+/*! Interface of a cache that keeps compiled kernels across processes
+ *  (e.g. on disk).
+ *  \param key A string containing everything that affects the compiled
+ *    result (sources, options, instantiation and NVRTC version), built with
+ *    program_key and kernel_key.
+ */
+class PersistentCache {
+ public:
+  virtual ~PersistentCache() {}
+  virtual bool load(std::string const& key, std::string* ptx,
+                    std::string* mangled_instantiation) = 0;
+  virtual void store(std::string const& key, std::string const& ptx,
+                     std::string const& mangled_instantiation) = 0;
+  // The part of the key shared by all instantiations of a program.
+  virtual std::string program_key(
+      std::vector<std::string> const& options,
+      std::vector<std::string> const& include_paths,
+      std::map<std::string, std::string> const& sources) = 0;
+  // The key of an instantiation, including program_key.
+  virtual std::string kernel_key(int nvrtc_major, int nvrtc_minor,
+                                 std::string const& instantiation,
+                                 std::vector<std::string> const& options,
+                                 std::string const& program_key) = 0;
+};
+
 struct ProgramConfig {
   std::vector<std::string> options;
   std::vector<std::string> include_paths;
   std::string name;
   typedef std::map<std::string, std::string> source_map;
   source_map sources;
+  // Headers are resolved lazily when a persistent cache is used, so that
+  //   nothing is compiled when all instantiations are found in the cache.
+  std::vector<std::string> compiler_options;
+  file_callback_type file_callback = 0;
+  bool includes_resolved = false;
+  // Set when resolving includes loaded a header that was not passed in, or
+  //   commented out a missing one. The result then depends on files outside
+  //   of persistent_key, so the persistent cache is not used for the program.
+  bool includes_external = false;
+  std::string persistent_key;
 };
 
 class JitCache_impl {
+  friend class JitCache;
   friend class Program_impl;
   friend class KernelInstantiation_impl;
   friend class KernelLauncher_impl;
@@ -1970,13 +2006,17 @@ class JitCache_impl {
   jitify::ObjectCache<key_type, detail::CUDAKernel> _kernel_cache;
   jitify::ObjectCache<key_type, ProgramConfig> _program_config_cache;
   std::vector<std::string> _options;
+  PersistentCache* _persistent_cache;
 #if JITIFY_THREAD_SAFE
   std::mutex _kernel_cache_mutex;
   std::mutex _program_cache_mutex;
+  // Guards lazy include resolution of the shared ProgramConfig
+  std::mutex _resolve_includes_mutex;
 #endif
  public:
   inline JitCache_impl(size_t cache_size)
-      : _kernel_cache(cache_size), _program_config_cache(cache_size) {
+      : _kernel_cache(cache_size), _program_config_cache(cache_size),
+        _persistent_cache(0) {
     detail::add_options_from_env(_options);
 
     // Bootstrap the cuda context to avoid errors
@@ -1999,6 +2039,7 @@ class Program_impl {
   void load_sources(std::string source, std::vector<std::string> headers,
                     std::vector<std::string> options,
                     file_callback_type file_callback);
+  static void resolve_includes(ProgramConfig& config, std::string& compile_log);
 
  public:
   inline Program_impl(JitCache_impl& cache, std::string source,
@@ -2319,6 +2360,13 @@ class JitCache {
   JitCache(size_t cache_size = DEFAULT_CACHE_SIZE)
       : _impl(new JitCache_impl(cache_size)) {}
 
+  /*! Set a cache to keep compiled kernels across processes.
+   *  Must be set before creating programs, and must outlive this JitCache.
+   */
+  inline void set_persistent_cache(PersistentCache* cache) {
+    _impl->_persistent_cache = cache;
+  }
+
   /*! Create a program.
    *
    *  \param source A string containing either the source filename or
@@ -2469,6 +2517,46 @@ inline void KernelInstantiation_impl::build_kernel() {
   std::string log;
   std::string ptx;
   std::string mangled_instantiation;
+
+  PersistentCache* persistent_cache = program._cache._persistent_cache;
+  std::string persistent_key;
+  if (persistent_cache && !program._config->persistent_key.empty()) {
+    bool includes_external = false;
+    {
+#if JITIFY_THREAD_SAFE
+      std::lock_guard<std::mutex> lock(
+          program._cache._resolve_includes_mutex);
+#endif
+      includes_external = program._config->includes_external;
+    }
+    if (!includes_external) {
+      int nvrtc_major = 0, nvrtc_minor = 0;
+      nvrtcVersion(&nvrtc_major, &nvrtc_minor);
+      persistent_key = persistent_cache->kernel_key(
+          nvrtc_major, nvrtc_minor, instantiation, compiler_options,
+          program._config->persistent_key);
+      if (persistent_cache->load(persistent_key, &ptx,
+                                 &mangled_instantiation)) {
+        _compile_log += "Loaded " + instantiation + " from persistent cache\n";
+        _cuda_kernel->set(mangled_instantiation.c_str(), ptx.c_str(),
+                          linker_files, linker_paths);
+        return;
+      }
+    }
+#if JITIFY_THREAD_SAFE
+    std::lock_guard<std::mutex> lock(program._cache._resolve_includes_mutex);
+#endif
+    if (!program._config->includes_resolved) {
+      Program_impl::resolve_includes(*program._config, _compile_log);
+    }
+    if (program._config->includes_external && !persistent_key.empty()) {
+      // The key does not cover the headers found while resolving includes
+      _compile_log += "Not storing " + instantiation +
+                      " to persistent cache: program uses external headers\n";
+      persistent_key.clear();
+    }
+  }
+
   nvrtcResult ret = detail::compile_kernel(program.name(), program.sources(),
                                            compiler_options, instantiation,
                                            &log, &ptx, &mangled_instantiation);
@@ -2495,6 +2583,10 @@ inline void KernelInstantiation_impl::build_kernel() {
 #endif
   _compile_log += ptx_ss.str();
 
+  if (!persistent_key.empty()) {
+    persistent_cache->store(persistent_key, ptx, mangled_instantiation);
+  }
+
   _cuda_kernel->set(mangled_instantiation.c_str(), ptx.c_str(), linker_files,
                     linker_paths);
 }
@@ -2617,11 +2709,36 @@ inline void Program_impl::load_sources(std::string source,
   log_ss.clear();
 #endif
 
+  _config->compiler_options = compiler_options;
+  _config->file_callback = file_callback;
+  if (_cache._persistent_cache) {
+    // Everything loaded so far goes into the key. If resolving includes
+    //   later needs any other header, the program is not cached (see
+    //   ProgramConfig::includes_external).
+    _config->persistent_key = _cache._persistent_cache->program_key(
+        compiler_options, include_paths, sources);
+    return;
+  }
+  resolve_includes(*_config, _compile_log);
+}
+
+inline void Program_impl::resolve_includes(ProgramConfig& config,
+                                           std::string& _compile_log) {
+  std::vector<std::string> const& include_paths = config.include_paths;
+  std::string const& name = config.name;
+  ProgramConfig::source_map& sources = config.sources;
+  std::vector<std::string> const& compiler_options = config.compiler_options;
+  file_callback_type file_callback = config.file_callback;
+  std::stringstream log_ss;
+
   std::string log;
   nvrtcResult ret;
   while ((ret = detail::compile_kernel(name, sources, compiler_options, "",
                                        &log)) == NVRTC_ERROR_COMPILATION) {
      _compile_log += std::string("\n") + detail::print_compile_log(name, log);
+    // Either a header is loaded or the include line is commented out below;
+    //   both make the result depend on more than the sources passed in.
+    config.includes_external = true;
 
     std::string include_name;
     std::string include_parent;
@@ -2681,6 +2798,7 @@ inline void Program_impl::load_sources(std::string source,
     throw std::runtime_error(std::string("NVRTC error: ") +
                              nvrtcGetErrorString(ret));
   }
+  config.includes_resolved = true;
 }
 
 #if __cplusplus >= 201103L
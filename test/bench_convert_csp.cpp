@@ -0,0 +1,139 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// raw/y4m読み込みで使用する色変換について、RGYConvertCSPのスループットを
+// 1スレッドの場合とスレッドプールで短冊に分割した場合とで比較する
+// あわせて、スレッドプールでの変換結果が1スレッドでの変換結果と一致することを確認する
+// 使い方: bench_convert_csp [<幅>] [<高さ>] [<スレッド数>] [<フレーム数>]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "rgy_simd.h"
+#include "rgy_convert_csp.h"
+
+//raw/y4m読み込みで入力となりうる色空間
+static const RGY_CSP BENCH_CSP_FROM[] = {
+    RGY_CSP_NV12, RGY_CSP_YV12, RGY_CSP_P010, RGY_CSP_YUV422, RGY_CSP_YUV444,
+    RGY_CSP_YV12_10, RGY_CSP_YV12_16, RGY_CSP_YUV422_10, RGY_CSP_YUV444_10, RGY_CSP_YUV444_16
+};
+
+struct BenchConvertCSPBuf {
+    std::vector<uint8_t> planes[RGY_MAX_PLANES];
+    void *ptr[RGY_MAX_PLANES];
+
+    BenchConvertCSPBuf(size_t planeSize) : planes(), ptr() {
+        for (int i = 0; i < RGY_MAX_PLANES; i++) {
+            //SIMD版が読み込む可能性のある余白を含めて確保する
+            planes[i].resize(planeSize + 256);
+            ptr[i] = (void *)(((size_t)planes[i].data() + 63) & ~(size_t)63);
+        }
+    }
+    void fill(uint8_t value) {
+        for (auto& p : planes) {
+            std::fill(p.begin(), p.end(), value);
+        }
+    }
+};
+
+static double bench_convert_csp_run(RGYConvertCSP& convert, BenchConvertCSPBuf& dst, const BenchConvertCSPBuf& src,
+    int interlaced, int width, int height, int pitch, int frames) {
+    const void *src_array[RGY_MAX_PLANES];
+    for (int i = 0; i < RGY_MAX_PLANES; i++) {
+        src_array[i] = src.ptr[i];
+    }
+    int crop[4] = { 0 };
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        convert.run(interlaced, dst.ptr, src_array, width, pitch, pitch, pitch, pitch, height, height, crop);
+    }
+    const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return frames / sec;
+}
+
+int main(int argc, char **argv) {
+    const int width   = (argc > 1) ? std::max(64, atoi(argv[1]) & ~15) : 3840;
+    const int height  = (argc > 2) ? std::max(64, atoi(argv[2]) & ~15) : 2160;
+    const int threads = (argc > 3) ? std::max(2, atoi(argv[3])) : std::max(2, std::min(8, (int)std::thread::hardware_concurrency()));
+    const int frames  = (argc > 4) ? std::max(1, atoi(argv[4])) : 20;
+    //1画素あたり最大8byte(16bit x 4ch)を想定し、128byte境界に揃える
+    const int pitch = (width * 8 + 127) & ~127;
+    const size_t planeSize = (size_t)pitch * height;
+
+    BenchConvertCSPBuf src(planeSize), dst1(planeSize), dstN(planeSize);
+    srand(1234);
+    for (auto& p : src.planes) {
+        for (auto& v : p) {
+            v = (uint8_t)rand();
+        }
+    }
+
+    const RGY_SIMD simd = get_availableSIMD();
+    size_t count = 0;
+    const ConvertCSP *list = get_convert_csp_func_list(&count);
+    std::vector<std::pair<RGY_CSP, RGY_CSP>> tested;
+    bool ok = true;
+    fprintf(stdout, "%dx%d, %d threads, %d frames\n", width, height, threads, frames);
+    fprintf(stdout, "%-12s -> %-12s %-10s %10s %10s  (fps)\n", "from", "to", "simd", "1 thread", "pool");
+    for (size_t i = 0; i < count; i++) {
+        const auto from = list[i].csp_from;
+        const auto to = list[i].csp_to;
+        if (list[i].uv_only
+            || std::find(std::begin(BENCH_CSP_FROM), std::end(BENCH_CSP_FROM), from) == std::end(BENCH_CSP_FROM)
+            || std::find(tested.begin(), tested.end(), std::make_pair(from, to)) != tested.end()) {
+            continue;
+        }
+        tested.push_back(std::make_pair(from, to));
+
+        RGYConvertCSP convert1(1, RGYParamThread());
+        RGYConvertCSP convertN(threads, RGYParamThread());
+        const auto func = convert1.getFunc(from, to, false, simd);
+        if (func == nullptr || convertN.getFunc(from, to, false, simd) != func) {
+            continue;
+        }
+        //プログレッシブ/インタレの両方で、短冊の境界で結果が変わらないことを確認する
+        bool match = true;
+        double fps1 = 0.0, fpsN = 0.0;
+        for (int interlaced = 1; interlaced >= 0; interlaced--) {
+            dst1.fill(0);
+            dstN.fill(0);
+            const int n = (interlaced) ? 1 : frames;
+            fps1 = bench_convert_csp_run(convert1, dst1, src, interlaced, width, height, pitch, n);
+            fpsN = bench_convert_csp_run(convertN, dstN, src, interlaced, width, height, pitch, n);
+            for (int ip = 0; ip < RGY_MAX_PLANES; ip++) {
+                match &= memcmp(dst1.ptr[ip], dstN.ptr[ip], planeSize) == 0;
+            }
+        }
+        fprintf(stdout, "%-12s -> %-12s %-10s %10.1f %10.1f%s\n",
+            RGY_CSP_NAMES[from], RGY_CSP_NAMES[to], get_simd_str(func->simd), fps1, fpsN, (match) ? "" : "  NG");
+        ok &= match;
+    }
+    fprintf(stdout, "%s\n", (ok) ? "OK" : "NG");
+    return (ok) ? 0 : 1;
+}
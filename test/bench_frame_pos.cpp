@@ -0,0 +1,212 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// 音声/字幕パケットの対応する映像フレームの検索 (RGYInputAvcodec::getVideoFrameIdx) のベンチマーク
+// 3時間(29.97fps)の映像に40トラック(音声30, 字幕10)が多重化されたファイルを想定した合成データで、
+// FramePosList::findPtsIndexを使う現行の実装と、旧実装 (iStartからの線形探索) の結果と処理時間を比較する
+// FFmpegに依存しないよう、timebaseの変換/比較はここで定義したものを使う
+// 使い方: bench_frame_pos [<映像の長さ(秒)>]
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <chrono>
+#include "rgy_frame_pos.h"
+
+struct BenchRational {
+    int num, den;
+};
+
+static bool bench_rational_equal(BenchRational a, BenchRational b) {
+    return (int64_t)a.num * b.den == (int64_t)b.num * a.den;
+}
+
+// av_rescale_q_rnd(a, b, c, AV_ROUND_DOWN) 相当
+static int64_t bench_rescale_down(int64_t a, BenchRational b, BenchRational c) {
+    const __int128 n = (__int128)a * b.num * c.den;
+    const __int128 d = (__int128)b.den * c.num;
+    __int128 q = n / d;
+    if (n % d != 0 && ((n < 0) != (d < 0))) q--;
+    return (int64_t)q;
+}
+
+// av_compare_ts 相当
+static int bench_compare_ts(int64_t a, BenchRational ta, int64_t b, BenchRational tb) {
+    const __int128 x = (__int128)a * ta.num * tb.den;
+    const __int128 y = (__int128)b * tb.num * ta.den;
+    return (x > y) - (x < y);
+}
+
+// 旧実装: iStartから線形に探索し、パケットごとにav_compare_tsで比較する
+static int bench_frame_idx_linear(FramePosList& frames, int64_t pts, BenchRational timebase, BenchRational vid_timebase, int iStart) {
+    const int framePosCount = frames.frameNum();
+    if (bench_rational_equal(timebase, vid_timebase)) {
+        for (int i = (std::max)(0, iStart); i < framePosCount; i++) {
+            if (pts == frames.list(i).pts) {
+                return i;
+            }
+            if (pts < frames.list(i).pts) {
+                if (i == 0 && pts < frames.list(i).pts - frames.list(i).duration) {
+                    i--;
+                }
+                return i-1;
+            }
+        }
+    } else {
+        for (int i = (std::max)(0, iStart); i < framePosCount; i++) {
+            if (bench_compare_ts(pts, timebase, frames.list(i).pts, vid_timebase) < 0) {
+                if (i == 0 && bench_compare_ts(pts, timebase, frames.list(i).pts - frames.list(i).duration, vid_timebase) < 0) {
+                    i--;
+                }
+                return i-1;
+            }
+        }
+    }
+    return framePosCount;
+}
+
+// 現行の実装 (RGYInputAvcodec::getVideoFrameIdxと同じ処理)
+static int bench_frame_idx_index(FramePosList& frames, int64_t pts, BenchRational timebase, BenchRational vid_timebase, int iStart) {
+    const int framePosCount = frames.frameNum();
+    const bool sameTimebase = bench_rational_equal(timebase, vid_timebase);
+    const int64_t ptsVid = (sameTimebase) ? pts : bench_rescale_down(pts, timebase, vid_timebase);
+    int i = frames.findPtsIndex(ptsVid, iStart, !sameTimebase);
+    if (i >= framePosCount) {
+        return framePosCount;
+    }
+    if (sameTimebase && ptsVid == frames.list(i).pts) {
+        return i;
+    }
+    if (i == 0 && ptsVid < frames.list(i).pts - frames.list(i).duration) {
+        i--;
+    }
+    return i-1;
+}
+
+static const BenchRational BENCH_VID_TIMEBASE = { 1, 90000 };
+static const BenchRational BENCH_AUD_TIMEBASE = { 1, 48000 };
+static const BenchRational BENCH_SUB_TIMEBASE = { 1, 1000 };
+static const int BENCH_FRAME_DURATION = 3003; // 29.97fps (timebase 1/90000)
+
+// B-frameの並び替え相当のpts (4フレームごとに前後を入れ替える)
+static int bench_reorder(int i) {
+    return i ^ ((i % 4 == 1) ? 3 : 0);
+}
+
+// 乱数のptsと探索開始位置で、フレームの追加途中の状態も含めて旧実装と結果を比較する
+static int bench_frame_pos_compare() {
+    std::mt19937 rng(5);
+    for (int trial = 0; trial < 20; trial++) {
+        FramePosList frames;
+        const int nFrames = 3000;
+        const int wrapAt = (trial % 3 == 0) ? 1500 : -1; // ptsのwrap arround
+        for (int i = 0; i < nFrames; i++) {
+            const int k = bench_reorder(i);
+            int64_t pts = (int64_t)BENCH_FRAME_DURATION * k + 1000;
+            if (wrapAt > 0 && k >= wrapAt) {
+                pts -= (int64_t)BENCH_FRAME_DURATION * wrapAt + 500;
+            }
+            frames.add(framePos(pts, (int64_t)BENCH_FRAME_DURATION * i, BENCH_FRAME_DURATION, 0, FRAMEPOS_POC_INVALID, (i % 30 == 0) ? AV_PKT_FLAG_KEY : 0));
+            if (i == 40) {
+                frames.checkPtsStatus();
+            }
+            for (int q = 0; q < 8; q++) {
+                const int64_t ptsVid = (int64_t)(rng() % ((uint64_t)BENCH_FRAME_DURATION * (i + 2))) - 6000;
+                const int iStart = (int)(rng() % (i + 3)) - 2;
+                const BenchRational timebase = (q & 1) ? BENCH_VID_TIMEBASE : ((q & 2) ? BENCH_AUD_TIMEBASE : BENCH_SUB_TIMEBASE);
+                const int64_t pts = (q & 1) ? ptsVid : ptsVid * timebase.den / BENCH_VID_TIMEBASE.den;
+                const int a = bench_frame_idx_linear(frames, pts, timebase, BENCH_VID_TIMEBASE, iStart);
+                const int b = bench_frame_idx_index(frames, pts, timebase, BENCH_VID_TIMEBASE, iStart);
+                if (a != b) {
+                    fprintf(stderr, "mismatch: trial %d, frame %d, pts %lld, start %d: %d (linear) != %d (index)\n", trial, i, (long long)pts, iStart, a, b);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// 音声(1024サンプル/パケット)と字幕(疎)のパケットを順に処理する
+// 10分ごとに各トラックの探索位置を戻す (seek/trimで探索をやり直す場合を想定)
+static double bench_frame_pos_run(FramePosList& frames, bool useIndex, int tracks, int audioTracks, int64_t& checksum, size_t& packets) {
+    std::vector<int> lastVidIndex(tracks, -1);
+    checksum = 0;
+    packets = 0;
+    const int64_t end = (int64_t)frames.frameNum() * BENCH_FRAME_DURATION * BENCH_AUD_TIMEBASE.den / BENCH_VID_TIMEBASE.den;
+    const auto start = std::chrono::steady_clock::now();
+    for (int64_t ts = 0; ts < end; ts += 1024) {
+        const int64_t packet = ts / 1024;
+        for (int t = 0; t < tracks; t++) {
+            const bool audio = t < audioTracks;
+            if (!audio && packet % 40) {
+                continue;
+            }
+            if (packet % 28125 == 0) {
+                lastVidIndex[t] = -1;
+            }
+            const BenchRational timebase = (audio) ? BENCH_AUD_TIMEBASE : BENCH_SUB_TIMEBASE;
+            const int64_t pts = (audio) ? ts : ts * BENCH_SUB_TIMEBASE.den / BENCH_AUD_TIMEBASE.den;
+            lastVidIndex[t] = (useIndex)
+                ? bench_frame_idx_index(frames, pts, timebase, BENCH_VID_TIMEBASE, lastVidIndex[t])
+                : bench_frame_idx_linear(frames, pts, timebase, BENCH_VID_TIMEBASE, lastVidIndex[t]);
+            checksum += lastVidIndex[t];
+            packets++;
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    const int seconds = (argc > 1) ? std::max(atoi(argv[1]), 60) : 3 * 3600;
+    if (bench_frame_pos_compare()) {
+        fprintf(stderr, "NG: result differs from the linear search implementation\n");
+        return 1;
+    }
+    printf("compare with linear search implementation: OK\n");
+
+    FramePosList frames;
+    const int nFrames = (int)(seconds * 30000LL / 1001);
+    for (int i = 0; i < nFrames; i++) {
+        frames.add(framePos((int64_t)BENCH_FRAME_DURATION * bench_reorder(i), (int64_t)BENCH_FRAME_DURATION * i, BENCH_FRAME_DURATION, 0, FRAMEPOS_POC_INVALID, (i % 30 == 0) ? AV_PKT_FLAG_KEY : 0));
+        if (i == 100) {
+            frames.checkPtsStatus();
+        }
+    }
+    frames.fin(framePos(0, 0, 0), 0);
+    const int tracks = 40, audioTracks = 30;
+    printf("%d frames, %d tracks (audio %d, subtitle %d)\n", frames.frameNum(), tracks, audioTracks, tracks - audioTracks);
+    int64_t checksumIndex = 0, checksumLinear = 0;
+    size_t packets = 0;
+    const double msIndex = bench_frame_pos_run(frames, true, tracks, audioTracks, checksumIndex, packets);
+    printf("findPtsIndex: %zu packets, %8.1f ms (%6.1f ns/packet)\n", packets, msIndex, msIndex * 1e6 / packets);
+    const double msLinear = bench_frame_pos_run(frames, false, tracks, audioTracks, checksumLinear, packets);
+    printf("linear      : %zu packets, %8.1f ms (%6.1f ns/packet)\n", packets, msLinear, msLinear * 1e6 / packets);
+    if (checksumIndex != checksumLinear) {
+        fprintf(stderr, "NG: checksum differs %lld != %lld\n", (long long)checksumIndex, (long long)checksumLinear);
+        return 1;
+    }
+    return 0;
+}
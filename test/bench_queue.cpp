@@ -0,0 +1,140 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+// RGYQueueLockFreeとRGYQueueMPMPのスループットを、producer/consumerの組の数を変えて比較する
+// あわせて、取り出し終わったセグメントが破棄されてメモリが増え続けないことを確認する
+// 使い方: bench_queue [<最大の組数(1-32)>] [<1スレッドあたりのデータ数>]
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "rgy_queue.h"
+
+struct BenchQueueData {
+    int64_t producer;
+    int64_t value;
+    int64_t pad[6];
+};
+
+struct BenchQueueResult {
+    double mops;
+    bool ok;
+};
+
+template<typename Queue>
+static BenchQueueResult bench_queue_run(Queue& queue, int pairs, int64_t count) {
+    std::atomic<int64_t> popped(0);
+    std::atomic<int64_t> sum(0);
+    std::atomic<int> order_error(0);
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < pairs; i++) {
+        threads.emplace_back([&queue, i, count]() {
+            for (int64_t v = 0; v < count; v++) {
+                BenchQueueData data = { 0 };
+                data.producer = i;
+                data.value = v;
+                queue.push(data);
+            }
+        });
+        threads.emplace_back([&queue, &popped, &sum, &order_error, pairs, count]() {
+            //producerごとの順序が保たれていることを確認する
+            std::vector<int64_t> last(pairs, -1);
+            const int64_t total = count * pairs;
+            int64_t local_sum = 0;
+            while (popped.load(std::memory_order_relaxed) < total) {
+                BenchQueueData data;
+                if (queue.front_copy_and_pop_no_lock(&data)) {
+                    if (data.value <= last[data.producer]) {
+                        order_error++;
+                    }
+                    last[data.producer] = data.value;
+                    local_sum += data.value;
+                    popped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            sum += local_sum;
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    BenchQueueResult result;
+    result.mops = (double)(count * pairs) / sec * 1e-6;
+    result.ok = order_error == 0 && popped == count * pairs && sum == (count * (count - 1) / 2) * pairs;
+    return result;
+}
+
+//伸びたキューを取り出し終わったのち、最後のセグメントのみが残っているか
+static bool check_queue_retire() {
+    RGYQueueLockFree<BenchQueueData, 64> queue;
+    queue.init(16);
+    size_t peak = 0;
+    for (int round = 0; round < 8; round++) {
+        //毎回キューを伸ばし切ってから空にする
+        const int n = 4096 << (round & 1);
+        for (int i = 0; i < n; i++) {
+            BenchQueueData data = { 0 };
+            data.value = i;
+            queue.push(data);
+        }
+        peak = std::max(peak, queue.allocated_size());
+        BenchQueueData data;
+        while (queue.front_copy_and_pop_no_lock(&data)) {
+        }
+    }
+    const size_t remain = queue.allocated_size();
+    fprintf(stdout, "retire: peak %zu cells, after drain %zu cells\n", peak, remain);
+    //セグメントの要素数は2の累乗なので、ひとつだけ残っていれば合計も2の累乗になる
+    return remain < peak && (remain & (remain - 1)) == 0;
+}
+
+int main(int argc, char **argv) {
+    const int max_pairs = (argc > 1) ? std::max(1, std::min(32, atoi(argv[1]))) : 32;
+    const int64_t count = (argc > 2) ? std::max(1, atoi(argv[2])) : 200000;
+    bool ok = check_queue_retire();
+    fprintf(stdout, "pairs   RGYQueueMPMP   RGYQueueLockFree  (Mops/s)\n");
+    for (int pairs = 1; pairs <= max_pairs; pairs *= 2) {
+        RGYQueueMPMP<BenchQueueData, 64> queue_old;
+        queue_old.init(1024);
+        const auto result_old = bench_queue_run(queue_old, pairs, count / pairs);
+        RGYQueueLockFree<BenchQueueData, 64> queue_new;
+        queue_new.init(1024);
+        const auto result_new = bench_queue_run(queue_new, pairs, count / pairs);
+        fprintf(stdout, "%5d   %12.2f   %16.2f%s\n", pairs, result_old.mops, result_new.mops,
+            (result_old.ok && result_new.ok) ? "" : "  NG");
+        ok &= result_old.ok && result_new.ok;
+    }
+    fprintf(stdout, "%s\n", (ok) ? "OK" : "NG");
+    return (ok) ? 0 : 1;
+}
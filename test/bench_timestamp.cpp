@@ -0,0 +1,236 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// RGYTimestampの検索コストがフレームレートや出力遅延(lookahead/B-frame)に依存しないことを確認する
+// 旧実装 (unordered_map + getByEncodeFrameIDの線形探索) と同じ結果を返すことも確認する
+// 使い方: bench_timestamp [<ベンチマークのフレーム数>]
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <unordered_map>
+#include <random>
+#include <chrono>
+#include "rgy_timestamp.h"
+
+// rgy_frame.hはCUDAのヘッダに依存するので、ここではポインタの比較に必要な最小限の定義を使う
+class RGYFrameData {
+public:
+    RGYFrameData(int value) : m_value(value) {};
+    virtual ~RGYFrameData() {};
+    int m_value;
+};
+
+// 比較用の旧実装 (std::unordered_map)
+class BenchTimestampRef {
+private:
+    std::unordered_map<int64_t, RGYTimestampMapVal> m_frame;
+    int64_t last_add_pts;
+    int64_t last_check_pts;
+    int64_t last_input_frame_id;
+    int64_t offset;
+    int64_t last_clean_id;
+    bool timestampPassThrough;
+    bool noDurationFix;
+
+    void clean(const int64_t current_id) {
+        if (current_id >= last_clean_id + 64) {
+            for (auto it = m_frame.begin(); it != m_frame.end();) {
+                if (it->second.inputFrameId < current_id - 64) {
+                    it = m_frame.erase(it);
+                } else {
+                    it++;
+                }
+            }
+            last_clean_id = current_id;
+        }
+    }
+public:
+    BenchTimestampRef(bool timestampPassThrough_, bool noDurationFix_) : m_frame(), last_add_pts(-1), last_check_pts(-1), last_input_frame_id(-1), offset(0), last_clean_id(-1),
+        timestampPassThrough(timestampPassThrough_), noDurationFix(noDurationFix_) {};
+    void add(int64_t pts, int64_t inputFrameId, int64_t encodeFrameId, int64_t duration, std::vector<std::shared_ptr<RGYFrameData>> metadatalist) {
+        if (last_add_pts >= 0) {
+            auto& last_add_pos = m_frame.find(last_add_pts)->second;
+            if (!noDurationFix) last_add_pos.duration = pts - last_add_pos.timestamp;
+            if (duration == 0) duration = last_add_pos.duration;
+        }
+        m_frame[pts] = RGYTimestampMapVal(pts, inputFrameId, encodeFrameId, duration, metadatalist);
+        last_add_pts = pts;
+    }
+    RGYTimestampMapVal check(int64_t pts) {
+        if (last_check_pts < 0 && pts > 0 && !timestampPassThrough) {
+            offset = -pts;
+        }
+        pts += offset;
+        auto pos = m_frame.find(pts);
+        if (pos == m_frame.end()) {
+            auto& last_check_pos = m_frame.find(last_check_pts)->second;
+            pts = last_check_pos.timestamp + last_check_pos.duration / 2;
+            auto next_pts = last_check_pos.timestamp + last_check_pos.duration;
+            last_check_pos.duration = pts - last_check_pos.timestamp;
+            m_frame[pts] = RGYTimestampMapVal(pts, last_input_frame_id, last_check_pos.encodeFrameId, next_pts - pts, last_check_pos.dataList);
+            pos = m_frame.find(pts);
+        }
+        last_input_frame_id = pos->second.inputFrameId;
+        last_check_pts = pos->second.timestamp;
+        return pos->second;
+    }
+    RGYTimestampMapVal getByEncodeFrameID(const int64_t id) {
+        auto pos = m_frame.end();
+        for (auto it = m_frame.begin(); it != m_frame.end(); it++) {
+            if (it->second.encodeFrameId == id) {
+                pos = it;
+                break;
+            }
+        }
+        if (pos == m_frame.end()) {
+            return RGYTimestampMapVal();
+        }
+        auto ret = pos->second;
+        clean(ret.inputFrameId);
+        return ret;
+    }
+    RGYTimestampMapVal get(int64_t pts) {
+        auto pos = m_frame.find(pts);
+        if (pos == m_frame.end()) {
+            return RGYTimestampMapVal();
+        }
+        auto ret = pos->second;
+        clean(ret.inputFrameId);
+        return ret;
+    }
+};
+
+static bool bench_timestamp_equal(const RGYTimestampMapVal& a, const RGYTimestampMapVal& b) {
+    return a.timestamp == b.timestamp && a.inputFrameId == b.inputFrameId && a.encodeFrameId == b.encodeFrameId
+        && a.duration == b.duration && a.dataList == b.dataList;
+}
+
+// 乱数でB-frameの並び替え相当の出力順を作り、旧実装と結果を比較する
+static int bench_timestamp_compare() {
+    std::mt19937 rng(1);
+    for (int trial = 0; trial < 200; trial++) {
+        BenchTimestampRef ref(false, (trial & 1) != 0);
+        RGYTimestamp ts(false, (trial & 1) != 0);
+        const int frames = 3000;
+        const int delay = 1 + rng() % 100; // 出力遅延 (lookahead)
+        std::vector<int64_t> pending;
+        int64_t pts = 0;
+        for (int i = 0; i < frames + delay; i++) {
+            if (i < frames) {
+                const int64_t duration = (rng() % 5 == 0) ? 0 : 1000 + rng() % 3;
+                std::vector<std::shared_ptr<RGYFrameData>> metadata;
+                if (rng() % 3 == 0) {
+                    metadata.push_back(std::make_shared<RGYFrameData>(i));
+                }
+                ref.add(pts, i, i, duration, metadata);
+                ts.add(pts, i, i, duration, std::move(metadata));
+                pending.push_back(pts);
+                pts += 1000 + rng() % 7;
+            }
+            if (i >= delay && !pending.empty()) {
+                // 先頭付近から少し順番を入れ替えて取り出す
+                const size_t k = std::min<size_t>(pending.size() - 1, rng() % 4);
+                const int64_t target = pending[k];
+                pending.erase(pending.begin() + k);
+                RGYTimestampMapVal a, b;
+                if (rng() % 2) {
+                    const auto encodeFrameId = ref.get(target).encodeFrameId;
+                    a = ref.getByEncodeFrameID(encodeFrameId);
+                    b = ts.getByEncodeFrameID(encodeFrameId);
+                } else {
+                    a = ref.get(target);
+                    b = ts.get(target);
+                }
+                if (!bench_timestamp_equal(a, b)) {
+                    fprintf(stderr, "mismatch: trial %d, frame %d\n", trial, i);
+                    return 1;
+                }
+            }
+        }
+        if (ts.get(-5).inputFrameId != -1 || ts.getByEncodeFrameID(1 << 30).inputFrameId != -1) {
+            fprintf(stderr, "mismatch: trial %d, missing frame found\n", trial);
+            return 1;
+        }
+    }
+    // checkでの補間
+    BenchTimestampRef ref(true, false);
+    RGYTimestamp ts(true, false);
+    for (int i = 0; i < 10; i++) {
+        ref.add(i * 1000, i, i, 1000, {});
+        ts.add(i * 1000, i, i, 1000, {});
+    }
+    for (const int64_t pts : { 0, 1000, 1500, 2000, 2500, 3000 }) {
+        if (!bench_timestamp_equal(ref.check(pts), ts.check(pts))) {
+            fprintf(stderr, "mismatch: check(%lld)\n", (long long)pts);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// delayフレーム遅れて取り出すときの1フレームあたりの処理時間(ns)
+template<typename Timestamp>
+static double bench_timestamp_run(Timestamp& ts, int frames, int delay, bool byEncodeFrameId) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames + delay; i++) {
+        if (i < frames) {
+            ts.add((int64_t)i * 1001, i, i, 1001, std::vector<std::shared_ptr<RGYFrameData>>());
+        }
+        if (i >= delay) {
+            const int j = i - delay;
+            if (byEncodeFrameId) {
+                ts.getByEncodeFrameID(j);
+            } else {
+                ts.get((int64_t)j * 1001);
+            }
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames;
+}
+
+int main(int argc, char **argv) {
+    const int frames = (argc > 1) ? std::max(atoi(argv[1]), 1000) : 2000000;
+    if (bench_timestamp_compare()) {
+        fprintf(stderr, "NG: result differs from the unordered_map implementation\n");
+        return 1;
+    }
+    printf("compare with unordered_map implementation: OK\n");
+    printf("%d frames, ns/frame (frames/s)\n", frames);
+    printf("delay  lookup  %-24s %-24s\n", "RGYTimestamp", "unordered_map");
+    for (const int delay : { 4, 64, 256, 1024 }) {
+        for (const bool byEncodeFrameId : { false, true }) {
+            RGYTimestamp ts(false, false);
+            const double ns = bench_timestamp_run(ts, frames, delay, byEncodeFrameId);
+            printf("%5d  %-6s  %8.1f (%9.0f fps)  ", delay, byEncodeFrameId ? "encid" : "pts", ns, 1e9 / ns);
+            // 旧実装のencodeFrameIdの検索は線形探索なので、遅延が大きいときはフレーム数を減らす
+            const int ref_frames = (byEncodeFrameId && delay > 64) ? std::max(frames / 20, 1000) : frames;
+            BenchTimestampRef ref(false, false);
+            const double ns_ref = bench_timestamp_run(ref, ref_frames, delay, byEncodeFrameId);
+            printf("%8.1f (%9.0f fps)\n", ns_ref, 1e9 / ns_ref);
+        }
+    }
+    return 0;
+}
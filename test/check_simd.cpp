@@ -0,0 +1,48 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// SIMD版の関数をC版と比較し、あわせて速度を計測する
+// CUDAを必要としないので、GPUのない環境でも実行できる
+// 使い方: check_simd [<比較回数>] [--no-bench]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "rgy_simd_check.h"
+
+int main(int argc, char **argv) {
+    RGYSIMDCheckPrm prm;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-bench") == 0) {
+            prm.benchmark = false;
+        } else if (atoi(argv[i]) > 0) {
+            prm.loop = atoi(argv[i]);
+        }
+    }
+    tstring result;
+    const int errors = rgy_check_simd(result, prm);
+    fprintf(stdout, "%s", result.c_str());
+    return (errors == 0) ? 0 : 1;
+}
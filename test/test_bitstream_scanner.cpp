@@ -0,0 +1,320 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// RGYNalScanner::feed/finish, RGYObuScannerのテスト
+//  - 入力を分割して渡したときに、1つのバッファで解析した場合と同じnal unit/OBUが同じ順で得られること
+//    (2分割はすべての位置で分割し、開始コード・nal unitヘッダ・OBUヘッダ・leb128のサイズが境界をまたぐ場合を網羅する)
+//  - 1byteずつ渡した場合、ランダムな位置で分割した場合も同じ結果になること
+//  - nullptrでないptrは、その時点の入力内を指していること
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "rgy_bitstream.h"
+
+struct ScanResult {
+    uint64_t offset;
+    size_t size;
+    int type;
+    int id0; // nuh_layer_id / temporal_id (OBU)
+    int id1; // temporal_id / spatial_id (OBU)
+    int id2; // - / obu_offset (OBU)
+
+    bool operator==(const ScanResult& r) const {
+        return offset == r.offset && size == r.size && type == r.type && id0 == r.id0 && id1 == r.id1 && id2 == r.id2;
+    }
+};
+
+// 分割位置 (昇順) で入力を分割し、それぞれを別のバッファにコピーして渡す
+// 前の入力のバッファは次の入力を渡した後に解放し、前の入力を参照していれば検出できるようにする
+template<typename FeedFunc>
+static bool feed_split(const std::vector<uint8_t>& data, const std::vector<size_t>& splits, FeedFunc feed) {
+    bool ok = true;
+    size_t start = 0;
+    std::vector<uint8_t> chunk;
+    for (size_t i = 0; i <= splits.size(); i++) {
+        const size_t end = (i < splits.size()) ? splits[i] : data.size();
+        chunk.assign(data.begin() + start, data.begin() + end);
+        ok &= feed(chunk.data(), chunk.size(), start, i == splits.size());
+        start = end;
+    }
+    return ok;
+}
+
+// ptrが今回の入力内を指していて、内容が一致するか
+static bool check_ptr(const uint8_t *ptr, size_t size, uint64_t offset, const uint8_t *chunk, size_t chunkSize, uint64_t chunkOffset, const std::vector<uint8_t>& data) {
+    if (!ptr) {
+        return true;
+    }
+    return ptr >= chunk && ptr + size <= chunk + chunkSize
+        && offset == chunkOffset + (uint64_t)(ptr - chunk)
+        && memcmp(ptr, data.data() + offset, size) == 0;
+}
+
+// ---- nal unit ----
+
+static void append_nal(std::vector<uint8_t>& data, RGY_CODEC codec, int type, bool longStartCode, size_t payloadSize, std::mt19937& rnd) {
+    if (longStartCode) {
+        data.push_back(0);
+    }
+    data.push_back(0); data.push_back(0); data.push_back(1);
+    if (codec == RGY_CODEC_HEVC) {
+        const int layer = rnd() % 2;
+        const int tid = 1 + rnd() % 3;
+        data.push_back((uint8_t)((type << 1) | (layer >> 5)));
+        data.push_back((uint8_t)(((layer & 0x1f) << 3) | tid));
+    } else {
+        data.push_back((uint8_t)(0x60 | type));
+    }
+    // 0が続く部分も作るが、開始コードと同じ並びにならないようにする (エミュレーション防止)
+    int zeros = 0;
+    for (size_t i = 0; i < payloadSize; i++) {
+        uint8_t v = (rnd() % 4 == 0) ? 0 : (uint8_t)(rnd() & 0xff);
+        if (zeros >= 2 && v <= 3) {
+            data.push_back(3);
+            zeros = 0;
+        }
+        data.push_back(v);
+        zeros = (v == 0) ? zeros + 1 : 0;
+    }
+    if (zeros > 0) {
+        data.push_back(0x80); // rbsp_trailing_bits
+    }
+}
+
+static std::vector<uint8_t> gen_nal_stream(RGY_CODEC codec, int nalCount, size_t maxPayload, std::mt19937& rnd) {
+    std::vector<uint8_t> data;
+    for (int i = 0; i < nalCount; i++) {
+        const int type = (codec == RGY_CODEC_HEVC) ? (int)(rnd() % 41) : (int)(1 + rnd() % 23);
+        append_nal(data, codec, type, rnd() % 2 == 0, (maxPayload > 0) ? rnd() % (maxPayload + 1) : 0, rnd);
+    }
+    return data;
+}
+
+static std::vector<ScanResult> scan_nal_single(RGY_CODEC codec, decltype(find_nal_start_code_c) *func, const std::vector<uint8_t>& data) {
+    std::vector<ScanResult> result;
+    RGYNalScanner scanner(codec, func);
+    scanner.scan(data.data(), data.size(), [&](const nal_info& nal) {
+        result.push_back({ (uint64_t)(nal.ptr - data.data()), nal.size, nal.type, nal.nuh_layer_id, nal.temporal_id, 0 });
+        return true;
+    });
+    return result;
+}
+
+static bool scan_nal_chunked(RGYNalScanner& scanner, const std::vector<uint8_t>& data, const std::vector<size_t>& splits, std::vector<ScanResult>& result) {
+    result.clear();
+    scanner.reset();
+    return feed_split(data, splits, [&](const uint8_t *chunk, size_t size, uint64_t chunkOffset, bool last) {
+        bool ok = true;
+        auto visitor = [&](const nal_info& nal, uint64_t offset) {
+            ok &= check_ptr(nal.ptr, nal.size, offset, chunk, size, chunkOffset, data);
+            result.push_back({ offset, nal.size, nal.type, nal.nuh_layer_id, nal.temporal_id, 0 });
+        };
+        scanner.feed(chunk, size, visitor);
+        if (last) {
+            scanner.finish(visitor);
+        }
+        return ok;
+    });
+}
+
+static bool test_nal(RGY_CODEC codec, const char *codecName, decltype(find_nal_start_code_c) *func, const char *funcName) {
+    std::mt19937 rnd(codec * 100 + (func == find_nal_start_code_c));
+    RGYNalScanner scanner(codec, func);
+    std::vector<ScanResult> result;
+    bool ok = true;
+
+    // 1つのバッファで渡せば、すべてptrが有効
+    {
+        const auto data = gen_nal_stream(codec, 20, 64, rnd);
+        const auto ref = scan_nal_single(codec, func, data);
+        bool allPtr = true;
+        scanner.reset();
+        scanner.feed(data.data(), data.size(), [&](const nal_info& nal, uint64_t offset) { allPtr &= nal.ptr == data.data() + offset; });
+        scanner.finish([&](const nal_info& nal, uint64_t offset) { allPtr &= nal.ptr == data.data() + offset; });
+        ok &= allPtr && scan_nal_chunked(scanner, data, {}, result) && result == ref && ref.size() == 20;
+    }
+    // 短いnal unitのみのストリームを、すべての位置で2分割
+    {
+        const auto data = gen_nal_stream(codec, 12, 3, rnd);
+        const auto ref = scan_nal_single(codec, func, data);
+        for (size_t split = 0; split <= data.size(); split++) {
+            ok &= scan_nal_chunked(scanner, data, { split }, result) && result == ref;
+        }
+        // 3分割 (開始コードが3つの入力にまたがる場合)
+        for (size_t split0 = 0; split0 <= data.size(); split0++) {
+            for (size_t split1 = split0; split1 <= std::min(data.size(), split0 + 4); split1++) {
+                ok &= scan_nal_chunked(scanner, data, { split0, split1 }, result) && result == ref;
+            }
+        }
+    }
+    // 1byteずつ
+    {
+        const auto data = gen_nal_stream(codec, 30, 16, rnd);
+        const auto ref = scan_nal_single(codec, func, data);
+        std::vector<size_t> splits;
+        for (size_t i = 1; i < data.size(); i++) {
+            splits.push_back(i);
+        }
+        ok &= scan_nal_chunked(scanner, data, splits, result) && result == ref;
+    }
+    // ランダムな位置で分割
+    for (int iter = 0; iter < 200; iter++) {
+        const auto data = gen_nal_stream(codec, 1 + rnd() % 40, (rnd() % 2) ? 8 : 512, rnd);
+        const auto ref = scan_nal_single(codec, func, data);
+        std::vector<size_t> splits;
+        for (size_t pos = 0; pos < data.size(); pos += 1 + rnd() % 64) {
+            splits.push_back(pos);
+        }
+        ok &= scan_nal_chunked(scanner, data, splits, result) && result == ref;
+    }
+    printf("nal scanner (%s, %s): %s\n", codecName, funcName, ok ? "OK" : "NG");
+    return ok;
+}
+
+// ---- OBU ----
+
+static void append_obu(std::vector<uint8_t>& data, int type, bool extension, size_t payloadSize, std::mt19937& rnd) {
+    data.push_back((uint8_t)((type << 3) | ((extension) ? 0x04 : 0) | 0x02));
+    if (extension) {
+        data.push_back((uint8_t)(((rnd() % 8) << 5) | ((rnd() % 4) << 3)));
+    }
+    const auto leb = get_av1_uleb_size_data(payloadSize);
+    data.insert(data.end(), leb.begin(), leb.end());
+    for (size_t i = 0; i < payloadSize; i++) {
+        data.push_back((uint8_t)(rnd() & 0xff));
+    }
+}
+
+static std::vector<uint8_t> gen_obu_stream(int obuCount, size_t maxPayload, std::mt19937& rnd) {
+    static const int types[] = { 1, 2, 3, 4, 5, 6, 7, 8, 15 };
+    std::vector<uint8_t> data;
+    for (int i = 0; i < obuCount; i++) {
+        size_t payload = (maxPayload > 0) ? rnd() % (maxPayload + 1) : 0;
+        if (rnd() % 8 == 0) {
+            payload = 128 + rnd() % 20000; // leb128が2byte以上
+        }
+        append_obu(data, types[rnd() % _countof(types)], rnd() % 2 == 0, payload, rnd);
+    }
+    return data;
+}
+
+static ScanResult obu_result(const obu_info& info, uint64_t offset) {
+    return { offset, info.size, info.type, info.temporal_id, info.spatial_id, info.obu_offset };
+}
+
+static std::vector<ScanResult> scan_obu_single(const std::vector<uint8_t>& data) {
+    std::vector<ScanResult> result;
+    scan_unit_av1(data.data(), data.size(), [&](const obu_info& info) {
+        result.push_back(obu_result(info, (uint64_t)(info.ptr - data.data())));
+        return true;
+    });
+    return result;
+}
+
+static bool scan_obu_chunked(const std::vector<uint8_t>& data, const std::vector<size_t>& splits, std::vector<ScanResult>& result) {
+    result.clear();
+    RGYObuScanner scanner;
+    return feed_split(data, splits, [&](const uint8_t *chunk, size_t size, uint64_t chunkOffset, bool last) {
+        bool ok = true;
+        ok &= scanner.feed(chunk, size, [&](const obu_info& info, uint64_t offset) {
+            ok &= check_ptr(info.ptr, info.size, offset, chunk, size, chunkOffset, data);
+            result.push_back(obu_result(info, offset));
+        });
+        return ok;
+    });
+}
+
+static bool test_obu() {
+    std::mt19937 rnd(5678);
+    std::vector<ScanResult> result;
+    bool ok = true;
+    // 短いOBUのみのストリームを、すべての位置で2分割/3分割
+    {
+        std::vector<uint8_t> data;
+        for (int i = 0; i < 12; i++) {
+            append_obu(data, 1 + i % 6, i % 2 == 0, (i % 3 == 0) ? 300 + i : i % 4, rnd); // 300byte以上はleb128が2byte
+        }
+        const auto ref = scan_obu_single(data);
+        ok &= ref.size() == 12;
+        for (size_t split = 0; split <= data.size(); split++) {
+            ok &= scan_obu_chunked(data, { split }, result) && result == ref;
+        }
+        for (size_t split0 = 0; split0 <= data.size(); split0++) {
+            for (size_t split1 = split0; split1 <= std::min(data.size(), split0 + 4); split1++) {
+                ok &= scan_obu_chunked(data, { split0, split1 }, result) && result == ref;
+            }
+        }
+        // 1byteずつ
+        std::vector<size_t> splits;
+        for (size_t i = 1; i < data.size(); i++) {
+            splits.push_back(i);
+        }
+        ok &= scan_obu_chunked(data, splits, result) && result == ref;
+    }
+    // ランダムな位置で分割
+    for (int iter = 0; iter < 200; iter++) {
+        const auto data = gen_obu_stream(1 + rnd() % 30, 64, rnd);
+        const auto ref = scan_obu_single(data);
+        std::vector<size_t> splits;
+        for (size_t pos = 0; pos < data.size(); pos += 1 + rnd() % 256) {
+            splits.push_back(pos);
+        }
+        ok &= scan_obu_chunked(data, splits, result) && result == ref;
+    }
+    printf("obu scanner: %s\n", ok ? "OK" : "NG");
+
+    // obu_has_size_field = 0 のOBUは不正なデータとして扱い、それ以降は無視する
+    {
+        std::vector<uint8_t> data;
+        append_obu(data, 2, false, 0, rnd);
+        append_obu(data, 6, false, 10, rnd);
+        const size_t invalid = data.size();
+        data.push_back(6 << 3); // obu_has_size_field = 0
+        append_obu(data, 6, false, 10, rnd);
+        RGYObuScanner scanner;
+        int count = 0;
+        const bool ret0 = scanner.feed(data.data(), invalid + 1, [&](const obu_info&, uint64_t) { count++; });
+        const bool ret1 = scanner.feed(data.data() + invalid + 1, data.size() - invalid - 1, [&](const obu_info&, uint64_t) { count++; });
+        const bool errOk = !ret0 && !ret1 && count == 2;
+        printf("obu scanner invalid data: %s\n", errOk ? "OK" : "NG");
+        ok &= errOk;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    bool ok = true;
+    for (auto codec : { RGY_CODEC_H264, RGY_CODEC_HEVC }) {
+        const char *codecName = (codec == RGY_CODEC_HEVC) ? "hevc" : "h264";
+        ok &= test_nal(codec, codecName, find_nal_start_code_c, "c");
+        ok &= test_nal(codec, codecName, get_find_nal_start_code_func(), "auto");
+    }
+    ok &= test_obu();
+    printf("%s\n", ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
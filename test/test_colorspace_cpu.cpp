@@ -0,0 +1,541 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// NVEncFilterColorspaceCPUのテスト
+//  - 行列 (YUV->RGB)、トーンマップ (PQ->hable->BT.709)、LUT3D (trilinear/tetrahedral) の各チェーンを
+//    ColorspaceOpCtrl::runCPUと同じ流れでC版/AVX2版/AVX-512BW版 (使用可能なもの) で実行する
+//  - 出力はfloatも含めてC版とSIMD版でビット単位で一致し、doubleで計算した参照値とは許容誤差以内であること
+//  - storeで範囲外の値、NaN、infがGPUのtoPix<T>と同じく丸められること
+//  - ブロックサイズの端数 (SIMDの幅で割り切れない画素数) も処理されること
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+#include <functional>
+#include "rgy_util.h"
+#include "rgy_simd.h"
+#include "NVEncFilterColorspaceCPU.h"
+#include "NVEncFilterColorspaceFunc.h"
+
+struct ColorspaceCPUFuncsInfo {
+    const char *name;
+    ColorspaceCPUFuncs funcs;
+};
+
+// テスト対象の実装 (使用できないSIMD版は除く)
+static std::vector<ColorspaceCPUFuncsInfo> colorspace_cpu_funcs_list() {
+    std::vector<ColorspaceCPUFuncsInfo> list;
+    list.push_back({ "c", { colorspace_cpu_load_c, colorspace_cpu_store_c, colorspace_cpu_affine_c, colorspace_cpu_matrix_c } });
+#if defined(_M_IX86) || defined(_M_X64) || defined(__x86_64)
+    const auto simd = get_availableSIMD();
+    if ((simd & RGY_SIMD::AVX2) == RGY_SIMD::AVX2) {
+        list.push_back({ "avx2", { colorspace_cpu_load_avx2, colorspace_cpu_store_avx2, colorspace_cpu_affine_avx2, colorspace_cpu_matrix_avx2 } });
+    } else {
+        printf("avx2: skipped (not supported)\n");
+    }
+#if defined(_M_X64) || defined(__x86_64)
+    if ((simd & RGY_SIMD::AVX512BW) == RGY_SIMD::AVX512BW) {
+        list.push_back({ "avx512bw", { colorspace_cpu_load_avx512bw, colorspace_cpu_store_avx512bw, colorspace_cpu_affine_avx512bw, colorspace_cpu_matrix_avx512bw } });
+    } else {
+        printf("avx512bw: skipped (not supported)\n");
+    }
+#endif
+#endif
+    return list;
+}
+
+static int colorspace_cpu_pix_size(RGY_DATA_TYPE type) {
+    return (type == RGY_DATA_TYPE_U8) ? 1 : ((type == RGY_DATA_TYPE_U16) ? 2 : 4);
+}
+
+// 3プレーン分の1ライン
+struct ColorspaceCPUPlanes {
+    RGY_DATA_TYPE type;
+    int n;
+    std::vector<uint8_t> buf[3];
+
+    ColorspaceCPUPlanes(RGY_DATA_TYPE type_, int n_) : type(type_), n(n_) {
+        for (auto& b : buf) {
+            b.resize((size_t)n * colorspace_cpu_pix_size(type), 0);
+        }
+    }
+    uint8_t *ptr(int plane, int i) { return buf[plane].data() + (size_t)i * colorspace_cpu_pix_size(type); }
+    double get(int plane, int i) const {
+        switch (type) {
+        case RGY_DATA_TYPE_U8:  return ((const uint8_t *)buf[plane].data())[i];
+        case RGY_DATA_TYPE_U16: return ((const uint16_t *)buf[plane].data())[i];
+        default:                return ((const float *)buf[plane].data())[i];
+        }
+    }
+    void set(int plane, int i, double v) {
+        switch (type) {
+        case RGY_DATA_TYPE_U8:  ((uint8_t *)buf[plane].data())[i]  = (uint8_t)v; break;
+        case RGY_DATA_TYPE_U16: ((uint16_t *)buf[plane].data())[i] = (uint16_t)v; break;
+        default:                ((float *)buf[plane].data())[i]    = (float)v; break;
+        }
+    }
+};
+
+typedef std::function<void(ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs)> ColorspaceCPUStage;
+
+// ColorspaceOpCtrl::runCPUと同じく、ブロックごとに読み込み、各段を適用して書き込む
+static void run_chain(const ColorspaceCPUFuncs *funcs, const std::vector<ColorspaceCPUStage>& stages, ColorspaceCPUPlanes& in, ColorspaceCPUPlanes& out) {
+    auto blk = std::make_unique<ColorspaceCPUBlock>();
+    for (int ix = 0; ix < in.n; ix += COLORSPACE_CPU_BLOCK_SIZE) {
+        const int n = std::min(COLORSPACE_CPU_BLOCK_SIZE, in.n - ix);
+        funcs->load(blk.get(), in.ptr(0, ix), in.ptr(1, ix), in.ptr(2, ix), in.type, n);
+        for (const auto& stage : stages) {
+            stage(blk.get(), funcs);
+        }
+        funcs->store(out.ptr(0, ix), out.ptr(1, ix), out.ptr(2, ix), out.type, blk.get());
+    }
+}
+
+// 各成分に同じ関数を適用する (ColorspaceOpGammaFuncなどと同じ)
+static ColorspaceCPUStage stage_per_pixel(std::function<float3(float3)> func) {
+    return [func](ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *) {
+        for (int i = 0; i < blk->n; i++) {
+            const float3 x = func(make_float3(blk->x[i], blk->y[i], blk->z[i]));
+            blk->x[i] = x.x;
+            blk->y[i] = x.y;
+            blk->z[i] = x.z;
+        }
+    };
+}
+
+static ColorspaceCPUStage stage_affine(const double scale[3], const double offset[3]) {
+    const std::vector<float> s = { (float)scale[0], (float)scale[1], (float)scale[2] };
+    const std::vector<float> o = { (float)offset[0], (float)offset[1], (float)offset[2] };
+    return [s, o](ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs) { funcs->affine(blk, s.data(), o.data()); };
+}
+
+static ColorspaceCPUStage stage_matrix(const double m[3][3]) {
+    std::vector<float> mf(9);
+    for (int i = 0; i < 9; i++) {
+        mf[i] = (float)m[i / 3][i % 3];
+    }
+    return [mf](ColorspaceCPUBlock *blk, const ColorspaceCPUFuncs *funcs) {
+        float m[3][3];
+        memcpy(m, mf.data(), sizeof(m));
+        funcs->matrix(blk, m);
+    };
+}
+
+static void matrix_mul_ref(const double m[3][3], double v[3]) {
+    const double x = v[0], y = v[1], z = v[2];
+    for (int j = 0; j < 3; j++) {
+        v[j] = m[j][0] * x + m[j][1] * y + m[j][2] * z;
+    }
+}
+
+// storeと同じく丸めて範囲内に収めた参照値
+static double round_ref(RGY_DATA_TYPE type, double v) {
+    if (type == RGY_DATA_TYPE_FP32) {
+        return v;
+    }
+    const double high = (type == RGY_DATA_TYPE_U8) ? 255.0 : 65535.0;
+    return clamp(std::floor(v + 0.5), 0.0, high);
+}
+
+static const char *data_type_name(RGY_DATA_TYPE type) {
+    return (type == RGY_DATA_TYPE_U8) ? "u8" : ((type == RGY_DATA_TYPE_U16) ? "u16" : "fp32");
+}
+
+static bool check(const std::string& name, bool result) {
+    printf("%s: %s\n", name.c_str(), result ? "OK" : "NG");
+    return result;
+}
+
+// 参照値とは許容誤差以内、C版の出力とはビット単位で一致すること
+// refは各画素3成分の参照値 (丸める前)、NGの場合のみ詳細を表示する
+static bool check_chain(const std::string& name, const std::vector<ColorspaceCPUFuncsInfo>& funcsList,
+    const std::vector<ColorspaceCPUStage>& stages, ColorspaceCPUPlanes& in, RGY_DATA_TYPE outType,
+    const std::vector<double>& ref, double refTolerance) {
+    bool ok = true;
+    ColorspaceCPUPlanes outC(outType, in.n);
+    for (const auto& f : funcsList) {
+        ColorspaceCPUPlanes out(outType, in.n);
+        run_chain(&f.funcs, stages, in, out);
+        if (&f == &funcsList.front()) {
+            outC = out;
+        }
+        double maxRefDiff = 0.0, maxSimdDiff = 0.0;
+        for (int i = 0; i < in.n; i++) {
+            for (int p = 0; p < 3; p++) {
+                const double v = out.get(p, i);
+                maxRefDiff  = std::max(maxRefDiff, std::abs(v - round_ref(outType, ref[i * 3 + p])));
+                maxSimdDiff = std::max(maxSimdDiff, std::abs(v - outC.get(p, i)));
+            }
+        }
+        if (maxRefDiff > refTolerance || out.buf[0] != outC.buf[0] || out.buf[1] != outC.buf[1] || out.buf[2] != outC.buf[2]) {
+            printf("%s %s %s->%s: NG (diff from ref %e, diff from c %e)\n", name.c_str(), f.name, data_type_name(in.type), data_type_name(outType), maxRefDiff, maxSimdDiff);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// ブロックサイズの端数を含む画素数
+static const int TEST_PIXELS[] = { 1, 7, 15, 17, 33, COLORSPACE_CPU_BLOCK_SIZE - 1, COLORSPACE_CPU_BLOCK_SIZE, COLORSPACE_CPU_BLOCK_SIZE * 3 + 37 };
+
+// ---- 行列 ----
+// limited rangeのBT.709 YUVをfull rangeのRGBへ
+
+static bool test_matrix(const std::vector<ColorspaceCPUFuncsInfo>& funcsList) {
+    const double kr = 0.2126, kb = 0.0722, kg = 1.0 - kr - kb;
+    const double yuv2rgb[3][3] = {
+        { 1.0,  0.0,                             2.0 * (1.0 - kr) },
+        { 1.0, -2.0 * kb * (1.0 - kb) / kg,     -2.0 * kr * (1.0 - kr) / kg },
+        { 1.0,  2.0 * (1.0 - kb),                0.0 },
+    };
+    std::mt19937 rnd(709);
+    bool ok = true;
+    for (auto inType : { RGY_DATA_TYPE_U8, RGY_DATA_TYPE_U16 }) {
+        const double inMul = (inType == RGY_DATA_TYPE_U8) ? 1.0 : 256.0;
+        const double inMax = (inType == RGY_DATA_TYPE_U8) ? 255.0 : 65535.0;
+        const double scaleIn[3]  = { 1.0 / (219.0 * inMul), 1.0 / (224.0 * inMul), 1.0 / (224.0 * inMul) };
+        const double offsetIn[3] = { -16.0 / 219.0, -128.0 / 224.0, -128.0 / 224.0 };
+        for (auto outType : { RGY_DATA_TYPE_U8, RGY_DATA_TYPE_U16, RGY_DATA_TYPE_FP32 }) {
+            const double outMax = (outType == RGY_DATA_TYPE_U8) ? 255.0 : ((outType == RGY_DATA_TYPE_U16) ? 65535.0 : 1.0);
+            const double scaleOut[3]  = { outMax, outMax, outMax };
+            const double offsetOut[3] = { 0.0, 0.0, 0.0 };
+            const std::vector<ColorspaceCPUStage> stages = { stage_affine(scaleIn, offsetIn), stage_matrix(yuv2rgb), stage_affine(scaleOut, offsetOut) };
+            for (int n : TEST_PIXELS) {
+                ColorspaceCPUPlanes in(inType, n);
+                std::vector<double> ref(n * 3);
+                for (int i = 0; i < n; i++) {
+                    // 先頭は黒と白、以降は範囲外を含む乱数
+                    const double black[3] = { 16.0, 128.0, 128.0 }, white[3] = { 235.0, 128.0, 128.0 };
+                    double v[3];
+                    for (int p = 0; p < 3; p++) {
+                        v[p] = (i == 0) ? black[p] * inMul : ((i == 1) ? white[p] * inMul : (double)(rnd() % ((int)inMax + 1)));
+                        in.set(p, i, v[p]);
+                        v[p] = v[p] * scaleIn[p] + offsetIn[p];
+                    }
+                    matrix_mul_ref(yuv2rgb, v);
+                    for (int p = 0; p < 3; p++) {
+                        ref[i * 3 + p] = v[p] * outMax;
+                    }
+                }
+                // 黒と白は参照値と完全に一致すること
+                if (n >= 2) {
+                    ref[0] = ref[1] = ref[2] = 0.0;
+                    ref[3] = ref[4] = ref[5] = outMax;
+                }
+                const double tolerance = (outType == RGY_DATA_TYPE_FP32) ? 1e-5 : 1.0;
+                ok &= check_chain(strsprintf("matrix n=%d", n), funcsList, stages, in, outType, ref, tolerance);
+                if (n >= 2 && outType != RGY_DATA_TYPE_FP32) {
+                    for (const auto& f : funcsList) {
+                        ColorspaceCPUPlanes out(outType, n);
+                        run_chain(&f.funcs, stages, in, out);
+                        bool exact = true;
+                        for (int p = 0; p < 3; p++) {
+                            exact &= out.get(p, 0) == 0.0 && out.get(p, 1) == outMax;
+                        }
+                        if (!exact) {
+                            printf("matrix black/white n=%d %s %s->%s: NG\n", n, f.name, data_type_name(inType), data_type_name(outType));
+                            ok = false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return check("matrix", ok);
+}
+
+// ---- トーンマップ ----
+// full rangeのPQ (BT.2020) RGBを、BT.709の色域に変換してhableでトーンマップし、limited rangeのBT.709 YUVへ
+
+static double st_2084_eotf_ref(double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    const double xpow = std::pow(x, 1.0 / (double)ST2084_M2);
+    const double num = std::max(xpow - (double)ST2084_C1, 0.0);
+    const double den = std::max((double)ST2084_C2 - (double)ST2084_C3 * xpow, (double)FLOAT_EPS);
+    return std::pow(num / den, 1.0 / (double)ST2084_M1);
+}
+
+static double hable_ref(double x, double A, double B, double C, double D, double E, double F) {
+    return ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F;
+}
+
+static double rec_709_oetf_ref(double x) {
+    return (x < (double)REC709_BETA) ? x * 4.5 : (double)REC709_ALPHA * std::pow(x, 0.45) - ((double)REC709_ALPHA - 1.0);
+}
+
+static bool test_tonemap(const std::vector<ColorspaceCPUFuncsInfo>& funcsList) {
+    const double source_peak = 1000.0, ldr_nits = 100.0;
+    const double A = 0.22, B = 0.3, C = 0.1, D = 0.2, E = 0.01, F = 0.3;
+    const double to_linear_scale = 10000.0 / ldr_nits;
+    const double bt2020_to_bt709[3][3] = {
+        {  1.660491, -0.587641, -0.072850 },
+        { -0.124550,  1.132900, -0.008349 },
+        { -0.018151, -0.100579,  1.118730 },
+    };
+    const double kr = 0.2126, kb = 0.0722, kg = 1.0 - kr - kb;
+    const double rgb2yuv[3][3] = {
+        { kr,                           kg,                           kb },
+        { -kr / (2.0 * (1.0 - kb)),     -kg / (2.0 * (1.0 - kb)),     0.5 },
+        { 0.5,                          -kg / (2.0 * (1.0 - kr)),     -kb / (2.0 * (1.0 - kr)) },
+    };
+    const float source_peak_f = (float)source_peak, ldr_nits_f = (float)ldr_nits, to_linear_scale_f = (float)to_linear_scale;
+    const float Af = (float)A, Bf = (float)B, Cf = (float)C, Df = (float)D, Ef = (float)E, Ff = (float)F;
+    const double scaleIn[3]  = { 1.0 / 65535.0, 1.0 / 65535.0, 1.0 / 65535.0 };
+    const double offsetIn[3] = { 0.0, 0.0, 0.0 };
+    std::mt19937 rnd(2084);
+    bool ok = true;
+    for (auto outType : { RGY_DATA_TYPE_U8, RGY_DATA_TYPE_U16, RGY_DATA_TYPE_FP32 }) {
+        const double outMul = (outType == RGY_DATA_TYPE_U8) ? 1.0 : ((outType == RGY_DATA_TYPE_U16) ? 256.0 : 1.0 / 255.0);
+        const double scaleOut[3]  = { 219.0 * outMul, 224.0 * outMul, 224.0 * outMul };
+        const double offsetOut[3] = { 16.0 * outMul, 128.0 * outMul, 128.0 * outMul };
+        const std::vector<ColorspaceCPUStage> stages = {
+            stage_affine(scaleIn, offsetIn),
+            stage_per_pixel([=](float3 x) {
+                return make_float3(to_linear_scale_f * st_2084_eotf(x.x), to_linear_scale_f * st_2084_eotf(x.y), to_linear_scale_f * st_2084_eotf(x.z));
+            }),
+            stage_matrix(bt2020_to_bt709),
+            stage_per_pixel([=](float3 x) {
+                return make_float3(
+                    hdr2sdr_hable(x.x, source_peak_f, ldr_nits_f, Af, Bf, Cf, Df, Ef, Ff),
+                    hdr2sdr_hable(x.y, source_peak_f, ldr_nits_f, Af, Bf, Cf, Df, Ef, Ff),
+                    hdr2sdr_hable(x.z, source_peak_f, ldr_nits_f, Af, Bf, Cf, Df, Ef, Ff));
+            }),
+            stage_per_pixel([](float3 x) { return make_float3(rec_709_oetf(x.x), rec_709_oetf(x.y), rec_709_oetf(x.z)); }),
+            stage_matrix(rgb2yuv),
+            stage_affine(scaleOut, offsetOut),
+        };
+        for (int n : TEST_PIXELS) {
+            ColorspaceCPUPlanes in(RGY_DATA_TYPE_U16, n);
+            std::vector<double> ref(n * 3);
+            for (int i = 0; i < n; i++) {
+                // 偶数番目はグレー
+                // hableは負の入力に極があり、floatとdoubleの差が大きくなるので、BT.709の色域外となる色は使わない
+                const int gray = rnd() % 65536;
+                double v[3];
+                do {
+                    for (int p = 0; p < 3; p++) {
+                        v[p] = (i % 2 == 0) ? gray : (double)(rnd() % 65536);
+                        in.set(p, i, v[p]);
+                        v[p] = st_2084_eotf_ref(v[p] / 65535.0) * to_linear_scale;
+                    }
+                    matrix_mul_ref(bt2020_to_bt709, v);
+                } while (v[0] < 0.0 || v[1] < 0.0 || v[2] < 0.0);
+                for (int p = 0; p < 3; p++) {
+                    v[p] = rec_709_oetf_ref(hable_ref(v[p], A, B, C, D, E, F) / hable_ref(source_peak / ldr_nits, A, B, C, D, E, F));
+                }
+                matrix_mul_ref(rgb2yuv, v);
+                for (int p = 0; p < 3; p++) {
+                    ref[i * 3 + p] = v[p] * scaleOut[p] + offsetOut[p];
+                }
+            }
+            // floatで計算するため、彩度の高い明るい色では色域変換の桁落ちでdoubleの参照値と差が出る
+            // u16とfp32は8bit換算で1/4階調まで許容する
+            const double tolerance = (outType == RGY_DATA_TYPE_U8) ? 1.0 : ((outType == RGY_DATA_TYPE_U16) ? 64.0 : 0.25 / 255.0);
+            ok &= check_chain(strsprintf("tonemap n=%d", n), funcsList, stages, in, outType, ref, tolerance);
+        }
+    }
+    return check("tonemap", ok);
+}
+
+// ---- LUT3D ----
+
+struct LUT3DTable {
+    int size;
+    std::vector<LUTVEC> lut; // [r][g][b]
+    LUT3DTable(int size_) : size(size_), lut(size_ * size_ * size_) {}
+    LUTVEC& at(int r, int g, int b) { return lut[(r * size + g) * size + b]; }
+};
+
+// ColorspaceOpLUT3D::runと同じく、テーブルのインデックスに変換して補間する
+static ColorspaceCPUStage stage_lut3d(const LUT3DTable& table, decltype(lut3d_interp_trilinear) *interp) {
+    const float scale = (float)(table.size - 1);
+    const float lut_max_idx = (float)(table.size - 1) + 1e-6f;
+    const int lutSize0 = table.size, lutSize01 = table.size * table.size;
+    const auto *lut = &table.lut;
+    return stage_per_pixel([=](float3 x) {
+        x.x = clamp(x.x * scale, 0.0f, lut_max_idx);
+        x.y = clamp(x.y * scale, 0.0f, lut_max_idx);
+        x.z = clamp(x.z * scale, 0.0f, lut_max_idx);
+        return interp(x, lut->data(), lutSize0, lutSize01);
+    });
+}
+
+static bool test_lut3d(const std::vector<ColorspaceCPUFuncsInfo>& funcsList) {
+    // 線形なLUTは、trilinearでもtetrahedralでも補間結果が元の線形変換と一致する
+    const double m[3][3] = {
+        { 0.80, 0.10, 0.05 },
+        { 0.05, 0.70, 0.20 },
+        { 0.10, 0.05, 0.75 },
+    };
+    const double c[3] = { 0.02, 0.03, 0.01 };
+    LUT3DTable linearTable(17);
+    for (int r = 0; r < linearTable.size; r++) {
+        for (int g = 0; g < linearTable.size; g++) {
+            for (int b = 0; b < linearTable.size; b++) {
+                double v[3] = { r / 16.0, g / 16.0, b / 16.0 };
+                matrix_mul_ref(m, v);
+                linearTable.at(r, g, b) = make_float4((float)(v[0] + c[0]), (float)(v[1] + c[1]), (float)(v[2] + c[2]), 0.0f);
+            }
+        }
+    }
+    // 非線形なLUTは、格子点上ではテーブルの値と一致する
+    std::mt19937 rnd(3);
+    LUT3DTable randomTable(16);
+    for (auto& v : randomTable.lut) {
+        v = make_float4((rnd() % 1000) / 1000.0f, (rnd() % 1000) / 1000.0f, (rnd() % 1000) / 1000.0f, 0.0f);
+    }
+
+    const struct {
+        const char *name;
+        decltype(lut3d_interp_trilinear) *interp;
+    } interps[] = {
+        { "trilinear", lut3d_interp_trilinear },
+        { "tetrahedral", lut3d_interp_tetrahedral },
+    };
+    bool ok = true;
+    for (const auto& interp : interps) {
+        bool okInterp = true;
+        for (auto inType : { RGY_DATA_TYPE_U8, RGY_DATA_TYPE_FP32 }) {
+            const double inMax = (inType == RGY_DATA_TYPE_U8) ? 255.0 : 1.0;
+            const double scaleIn[3]  = { 1.0 / inMax, 1.0 / inMax, 1.0 / inMax };
+            const double offsetIn[3] = { 0.0, 0.0, 0.0 };
+            for (auto outType : { RGY_DATA_TYPE_U8, RGY_DATA_TYPE_FP32 }) {
+                const double outMax = (outType == RGY_DATA_TYPE_U8) ? 255.0 : 1.0;
+                const double scaleOut[3]  = { outMax, outMax, outMax };
+                const double offsetOut[3] = { 0.0, 0.0, 0.0 };
+                const double tolerance = (outType == RGY_DATA_TYPE_FP32) ? 1e-5 : 1.0;
+                for (int n : TEST_PIXELS) {
+                    // 線形なLUT (floatの入力は範囲外の値を含み、テーブルの端でclampされる)
+                    {
+                        const std::vector<ColorspaceCPUStage> stages = { stage_affine(scaleIn, offsetIn), stage_lut3d(linearTable, interp.interp), stage_affine(scaleOut, offsetOut) };
+                        ColorspaceCPUPlanes in(inType, n);
+                        std::vector<double> ref(n * 3);
+                        for (int i = 0; i < n; i++) {
+                            double v[3];
+                            for (int p = 0; p < 3; p++) {
+                                v[p] = (inType == RGY_DATA_TYPE_U8) ? (double)(rnd() % 256) : (rnd() % 2001) / 1000.0 - 0.5;
+                                in.set(p, i, v[p]);
+                                v[p] = clamp(v[p] / inMax, 0.0, 1.0);
+                            }
+                            matrix_mul_ref(m, v);
+                            for (int p = 0; p < 3; p++) {
+                                ref[i * 3 + p] = (v[p] + c[p]) * outMax;
+                            }
+                        }
+                        okInterp &= check_chain(strsprintf("lut3d %s linear n=%d", interp.name, n), funcsList, stages, in, outType, ref, tolerance);
+                    }
+                    // 非線形なLUTの格子点
+                    if (inType == RGY_DATA_TYPE_U8) {
+                        const std::vector<ColorspaceCPUStage> stages = { stage_affine(scaleIn, offsetIn), stage_lut3d(randomTable, interp.interp), stage_affine(scaleOut, offsetOut) };
+                        ColorspaceCPUPlanes in(inType, n);
+                        std::vector<double> ref(n * 3);
+                        for (int i = 0; i < n; i++) {
+                            const int idx[3] = { (int)(rnd() % 16), (int)(rnd() % 16), (int)(rnd() % 16) };
+                            for (int p = 0; p < 3; p++) {
+                                in.set(p, i, idx[p] * 17); // 255 / (16 - 1)
+                            }
+                            const auto& v = randomTable.at(idx[0], idx[1], idx[2]);
+                            ref[i * 3 + 0] = v.x * outMax;
+                            ref[i * 3 + 1] = v.y * outMax;
+                            ref[i * 3 + 2] = v.z * outMax;
+                        }
+                        okInterp &= check_chain(strsprintf("lut3d %s grid n=%d", interp.name, n), funcsList, stages, in, outType, ref, tolerance);
+                    }
+                }
+            }
+        }
+        ok &= check(strsprintf("lut3d %s", interp.name), okInterp);
+    }
+    return ok;
+}
+
+// ---- store ----
+// GPUのtoPix<T>と同じく、四捨五入して範囲内に収め、NaNは最大値になること
+
+static bool test_store(const std::vector<ColorspaceCPUFuncsInfo>& funcsList) {
+    const float values[] = { 0.0f, 0.49f, 0.5f, -0.49f, -0.5f, -1.0f, 1.5f, 254.49f, 254.5f, 255.49f, 255.5f, 256.0f, 65534.5f, 65535.49f, 65536.0f, 1e9f, -1e9f,
+        std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() };
+    const int count = (int)_countof(values);
+    bool ok = true;
+    for (auto outType : { RGY_DATA_TYPE_U8, RGY_DATA_TYPE_U16 }) {
+        const double high = (outType == RGY_DATA_TYPE_U8) ? 255.0 : 65535.0;
+        for (int n : TEST_PIXELS) {
+            ColorspaceCPUPlanes in(RGY_DATA_TYPE_FP32, n);
+            std::vector<double> ref(n * 3);
+            for (int i = 0; i < n; i++) {
+                for (int p = 0; p < 3; p++) {
+                    const float v = values[(i * 3 + p) % count];
+                    in.set(p, i, v);
+                    ref[i * 3 + p] = std::isnan(v) ? high : (double)v;
+                }
+            }
+            for (const auto& f : funcsList) {
+                ColorspaceCPUPlanes out(outType, n);
+                run_chain(&f.funcs, {}, in, out);
+                bool result = true;
+                for (int i = 0; i < n; i++) {
+                    for (int p = 0; p < 3; p++) {
+                        result &= out.get(p, i) == round_ref(outType, ref[i * 3 + p]);
+                    }
+                }
+                if (!result) {
+                    printf("store n=%d %s fp32->%s: NG\n", n, f.name, data_type_name(outType));
+                    ok = false;
+                }
+            }
+        }
+    }
+    return check("store", ok);
+}
+
+// get_colorspace_cpu_funcsが、指定したSIMDの範囲で使用可能な実装を返すこと
+static bool test_select(const std::vector<ColorspaceCPUFuncsInfo>& funcsList) {
+    bool ok = check("select c", get_colorspace_cpu_funcs(RGY_SIMD::NONE)->matrix == colorspace_cpu_matrix_c);
+    const auto best = get_colorspace_cpu_funcs(RGY_SIMD::AVX2 | RGY_SIMD::AVX512BW);
+    ok &= check(strsprintf("select %s", funcsList.back().name), best->load == funcsList.back().funcs.load
+        && best->store == funcsList.back().funcs.store
+        && best->affine == funcsList.back().funcs.affine
+        && best->matrix == funcsList.back().funcs.matrix);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const auto funcsList = colorspace_cpu_funcs_list();
+    bool ok = true;
+    ok &= test_select(funcsList);
+    ok &= test_store(funcsList);
+    ok &= test_matrix(funcsList);
+    ok &= test_tonemap(funcsList);
+    ok &= test_lut3d(funcsList);
+    printf("%s\n", ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
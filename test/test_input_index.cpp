@@ -0,0 +1,255 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// RGYInputIndexのテスト
+//  - save()で書き出したインデックスをload()で読み込むと、パケット・フレームレート・キーフレームが一致すること
+//  - 入力ファイルのサイズ・更新時刻・ハッシュ、ストリームのいずれかが異なるインデックスは読み込まないこと
+//  - 途中で切れたインデックスファイルは読み込まないこと
+//  - findKeyframeが指定したpts以前の最後のキーフレームを返すこと (先頭より前は最初のキーフレーム)
+//  - cancelBuild()の後はインデックスを書き出さないこと
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include "rgy_input_index.h"
+#include "rgy_filesystem.h"
+#include "rgy_avutil.h"
+
+static const TCHAR *TEST_INPUT = _T("test_input_index.bin");
+static const TCHAR *TEST_INDEX_DIR = _T("test_input_index_dir");
+static const int TEST_GOP = 30;
+static const int TEST_FRAMES = 300;
+
+static bool write_input(const TCHAR *filename, size_t size, uint8_t seed) {
+    FILE *fp = _tfopen(filename, _T("wb"));
+    if (!fp) {
+        return false;
+    }
+    std::vector<uint8_t> data(size);
+    uint32_t x = seed * 2654435761u + 1;
+    for (auto& d : data) {
+        x = x * 1664525u + 1013904223u;
+        d = (uint8_t)(x >> 24);
+    }
+    const bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    fclose(fp);
+    return ok;
+}
+
+static RGYInputIndexStream test_stream() {
+    return RGYInputIndexStream{ 0, 27 /*H.264*/, rgy_rational<int>(1, 90000) };
+}
+
+// 先頭から終端まで読み込んだとして、インデックスを作成して書き出す
+static RGY_ERR build_index(const tstring& indexDir, tstring *path) {
+    RGYInputIndex index;
+    auto err = index.init(TEST_INPUT, indexDir);
+    if (err != RGY_ERR_NONE) {
+        return err;
+    }
+    index.startBuild(test_stream());
+    for (int i = 0; i < TEST_FRAMES; i++) {
+        const int64_t pts = (int64_t)i * 3003;
+        index.addPacket({ pts, pts - 3003, (int64_t)i * 1000, 1000, (i % TEST_GOP == 0) ? RGY_INPUT_INDEX_PKT_KEY : 0 });
+    }
+    index.setFramerate(rgy_rational<int>(30000, 1001));
+    index.setComplete();
+    *path = index.path();
+    return index.save();
+}
+
+static RGY_ERR load_index(const tstring& indexDir, const RGYInputIndexStream& stream, RGYInputIndex *index) {
+    auto err = index->init(TEST_INPUT, indexDir);
+    return (err != RGY_ERR_NONE) ? err : index->load(stream);
+}
+
+static bool test_round_trip(const tstring& indexDir) {
+    tstring path;
+    auto err = build_index(indexDir, &path);
+    if (err != RGY_ERR_NONE) {
+        printf("round trip (%s): save failed: %s\n", (indexDir.length() > 0) ? "index dir" : "same dir", tchar_to_string(get_err_mes(err)).c_str());
+        return false;
+    }
+    RGYInputIndex index;
+    err = load_index(indexDir, test_stream(), &index);
+    bool ok = err == RGY_ERR_NONE && index.loaded() && index.path() == path
+        && (int)index.packets().size() == TEST_FRAMES
+        && index.framerate() == rgy_rational<int>(30000, 1001);
+    if (ok) {
+        for (int i = 0; i < TEST_FRAMES; i++) {
+            const auto& pkt = index.packets()[i];
+            ok &= pkt.pts == (int64_t)i * 3003 && pkt.dts == pkt.pts - 3003 && pkt.pos == (int64_t)i * 1000 && pkt.size == 1000
+                && pkt.flags == ((i % TEST_GOP == 0) ? RGY_INPUT_INDEX_PKT_KEY : 0);
+        }
+        const auto keyframes = index.keyframePts();
+        ok &= (int)keyframes.size() == TEST_FRAMES / TEST_GOP;
+        for (size_t i = 0; ok && i < keyframes.size(); i++) {
+            ok &= keyframes[i] == (int64_t)i * TEST_GOP * 3003;
+        }
+    }
+    printf("round trip (%s): %s: %s\n", (indexDir.length() > 0) ? "index dir" : "same dir", tchar_to_string(get_err_mes(err)).c_str(), ok ? "OK" : "NG");
+    return ok;
+}
+
+// 入力ファイルやストリームが変わったときに、古いインデックスを読み込まないこと
+static bool test_stale() {
+    bool ok = true;
+    auto check = [&ok](const char *name, RGY_ERR expected, RGY_ERR err) {
+        const bool result = err == expected;
+        printf("stale %s: %s: %s\n", name, tchar_to_string(get_err_mes(err)).c_str(), result ? "OK" : "NG");
+        ok &= result;
+    };
+    const auto inputPath = std::filesystem::path(TEST_INPUT);
+    tstring path;
+    // ストリームが異なる
+    {
+        build_index(_T(""), &path);
+        RGYInputIndex index;
+        auto stream = test_stream();
+        stream.codecId++;
+        check("codec", RGY_ERR_NOT_FOUND, load_index(_T(""), stream, &index));
+        stream = test_stream();
+        stream.index = 1;
+        check("stream index", RGY_ERR_NOT_FOUND, load_index(_T(""), stream, &index));
+        stream = test_stream();
+        stream.timebase = rgy_rational<int>(1, 1000);
+        check("timebase", RGY_ERR_NOT_FOUND, load_index(_T(""), stream, &index));
+    }
+    // 更新時刻が異なる
+    {
+        build_index(_T(""), &path);
+        std::error_code ec;
+        const auto time = std::filesystem::last_write_time(inputPath, ec);
+        std::filesystem::last_write_time(inputPath, time + std::chrono::seconds(10), ec);
+        RGYInputIndex index;
+        check("mtime", RGY_ERR_NOT_FOUND, load_index(_T(""), test_stream(), &index));
+    }
+    // サイズが異なる
+    {
+        write_input(TEST_INPUT, 3 * 1024 * 1024, 1);
+        build_index(_T(""), &path);
+        write_input(TEST_INPUT, 3 * 1024 * 1024 + 1, 1);
+        RGYInputIndex index;
+        check("size", RGY_ERR_NOT_FOUND, load_index(_T(""), test_stream(), &index));
+    }
+    // サイズと更新時刻が同じで、末尾の内容が異なる
+    {
+        write_input(TEST_INPUT, 3 * 1024 * 1024, 1);
+        build_index(_T(""), &path);
+        std::error_code ec;
+        const auto time = std::filesystem::last_write_time(inputPath, ec);
+        write_input(TEST_INPUT, 3 * 1024 * 1024, 2);
+        std::filesystem::last_write_time(inputPath, time, ec);
+        RGYInputIndex index;
+        check("hash", RGY_ERR_NOT_FOUND, load_index(_T(""), test_stream(), &index));
+    }
+    // インデックスファイルが途中で切れている
+    {
+        write_input(TEST_INPUT, 3 * 1024 * 1024, 1);
+        build_index(_T(""), &path);
+        std::error_code ec;
+        std::filesystem::resize_file(std::filesystem::path(path), std::filesystem::file_size(std::filesystem::path(path)) - 1, ec);
+        RGYInputIndex index;
+        check("truncated", RGY_ERR_INVALID_FORMAT, load_index(_T(""), test_stream(), &index));
+        std::filesystem::resize_file(std::filesystem::path(path), 16, ec);
+        check("truncated header", RGY_ERR_INVALID_FORMAT, load_index(_T(""), test_stream(), &index));
+    }
+    _tremove(path.c_str());
+    return ok;
+}
+
+static bool test_find_keyframe() {
+    tstring path;
+    build_index(_T(""), &path);
+    RGYInputIndex index;
+    load_index(_T(""), test_stream(), &index);
+    _tremove(path.c_str());
+    const int64_t gopDuration = (int64_t)TEST_GOP * 3003;
+    const int64_t lastKey = (int64_t)(TEST_FRAMES / TEST_GOP - 1) * gopDuration;
+    struct {
+        const char *name;
+        int64_t pts;
+        int64_t expected;
+    } cases[] = {
+        { "before first",     -100,                 0 },
+        { "first",            0,                    0 },
+        { "inside first gop", gopDuration - 1,      0 },
+        { "exact keyframe",   gopDuration * 3,      gopDuration * 3 },
+        { "just after key",   gopDuration * 3 + 1,  gopDuration * 3 },
+        { "just before key",  gopDuration * 4 - 1,  gopDuration * 3 },
+        { "last keyframe",    lastKey,              lastKey },
+        { "after last",       lastKey + 100000,     lastKey },
+    };
+    bool ok = true;
+    for (const auto& c : cases) {
+        const auto pkt = index.findKeyframe(c.pts);
+        const bool result = pkt && (pkt->flags & RGY_INPUT_INDEX_PKT_KEY) && pkt->pts == c.expected;
+        printf("findKeyframe %s (%lld): %lld: %s\n", c.name, (long long)c.pts, (pkt) ? (long long)pkt->pts : -1ll, result ? "OK" : "NG");
+        ok &= result;
+    }
+    RGYInputIndex empty;
+    const bool emptyOk = empty.findKeyframe(0) == nullptr;
+    printf("findKeyframe empty: %s\n", emptyOk ? "OK" : "NG");
+    return ok && emptyOk;
+}
+
+static bool test_cancel_build() {
+    RGYInputIndex index;
+    index.init(TEST_INPUT, _T(""));
+    _tremove(index.path().c_str());
+    index.startBuild(test_stream());
+    index.addPacket({ 0, 0, 0, 1000, RGY_INPUT_INDEX_PKT_KEY });
+    index.cancelBuild();
+    index.addPacket({ 3003, 3003, 1000, 1000, 0 }); // 中止後は追加されない
+    index.setComplete();
+    const auto err = index.save();
+    const bool ok = !index.building() && !index.readyToSave() && index.packets().size() == 0
+        && err == RGY_ERR_NOT_INITIALIZED && !rgy_file_exists(index.path());
+    printf("cancelBuild: %s\n", ok ? "OK" : "NG");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    if (!write_input(TEST_INPUT, 3 * 1024 * 1024, 1)) {
+        printf("failed to create %s.\n", tchar_to_string(TEST_INPUT).c_str());
+        return 1;
+    }
+    bool ok = true;
+    ok &= test_round_trip(_T(""));
+    ok &= test_round_trip(TEST_INDEX_DIR);
+    ok &= test_stale();
+    ok &= test_find_keyframe();
+    ok &= test_cancel_build();
+    std::error_code ec;
+    std::filesystem::remove_all(std::filesystem::path(TEST_INDEX_DIR), ec);
+    _tremove((tstring(TEST_INPUT) + _T(".rgyidx")).c_str());
+    _tremove(TEST_INPUT);
+    printf("%s\n", ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// RGYLogAsyncのテスト
+//  - close()と同時にpushしても、積まれたログが失われないこと
+//  - 終了したスレッドのリングバッファが解放され、スレッドを作っては終了させてもリングバッファが増え続けないこと
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "rgy_log.h"
+#include "rgy_log_async.h"
+#include "rgy_filesystem.h"
+
+class TestLogAsync : public RGYLogAsync {
+public:
+    TestLogAsync(RGYLog *log) : RGYLogAsync(log) {};
+    size_t ringCount() {
+        std::lock_guard<std::mutex> lock(m_ringsMtx);
+        return m_rings.size();
+    }
+};
+
+static int64_t test_log_async_now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static int64_t test_log_async_count_lines(const TCHAR *filename) {
+    FILE *fp = _tfopen(filename, _T("r"));
+    if (!fp) {
+        return -1;
+    }
+    int64_t lines = 0;
+    for (int c; (c = fgetc(fp)) != EOF; ) {
+        lines += (c == '\n');
+    }
+    fclose(fp);
+    return lines;
+}
+
+// 各スレッドがログを積み続けている最中にclose()し、積めなかった分は同期出力する
+static bool test_log_async_close_race(int trials) {
+    const TCHAR *filename = _T("test_log_async.log");
+    const int threads = 4;
+    const int count = 2000;
+    for (int trial = 0; trial < trials; trial++) {
+        _tremove(filename);
+        RGYLog log(filename, RGY_LOG_INFO);
+        TestLogAsync async(&log);
+        async.start();
+        std::atomic<int> started(0);
+        std::vector<std::thread> th;
+        for (int i = 0; i < threads; i++) {
+            th.emplace_back([&]() {
+                started++;
+                for (int j = 0; j < count; j++) {
+                    if (!async.push(RGY_LOG_WARN, _T("log\n"), true, test_log_async_now())) {
+                        log.write_log(RGY_LOG_WARN, RGY_LOGT_CORE, _T("log\n"), true);
+                    }
+                }
+            });
+        }
+        while (started < threads) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds((trial * 37) % 500));
+        async.close();
+        for (auto& t : th) {
+            t.join();
+        }
+        const int64_t lines = test_log_async_count_lines(filename);
+        if (lines != (int64_t)threads * count) {
+            fprintf(stderr, "close race: trial %d, %lld lines written, expected %d: NG\n", trial, (long long)lines, threads * count);
+            return false;
+        }
+    }
+    _tremove(filename);
+    printf("close race: %d trials: OK\n", trials);
+    return true;
+}
+
+// スレッドを作っては終了させても、リングバッファが残り続けないこと
+// (終了したスレッドのIDは再利用されるので、同時に複数のスレッドを動かしてIDが重ならないようにする)
+static bool test_log_async_thread_exit(int rounds, int concurrent) {
+    const TCHAR *filename = _T("test_log_async.log");
+    const int threads = rounds * concurrent;
+    _tremove(filename);
+    RGYLog log(filename, RGY_LOG_INFO);
+    TestLogAsync async(&log);
+    async.start();
+    for (int i = 0; i < rounds; i++) {
+        std::atomic<int> pushed(0);
+        std::vector<std::thread> th;
+        for (int j = 0; j < concurrent; j++) {
+            th.emplace_back([&]() {
+                async.push(RGY_LOG_WARN, _T("log\n"), true, test_log_async_now());
+                pushed++;
+                while (pushed < concurrent) {
+                    std::this_thread::yield();
+                }
+            });
+        }
+        for (auto& t : th) {
+            t.join();
+        }
+    }
+    async.flush();
+    async.flush(); // 1回目のflushで出力済みになったものが、2回目のflushで解放される
+    const size_t rings = async.ringCount();
+    async.close();
+    const int64_t lines = test_log_async_count_lines(filename);
+    _tremove(filename);
+    const bool ok = rings == 0 && lines == threads;
+    printf("thread exit: %d threads, %d rings left, %lld lines: %s\n", threads, (int)rings, (long long)lines, ok ? "OK" : "NG");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const int trials = (argc > 1) ? std::max(atoi(argv[1]), 1) : 200;
+    bool ok = true;
+    ok &= test_log_async_close_race(trials);
+    ok &= test_log_async_thread_exit(16, 64);
+    printf("%s\n", ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
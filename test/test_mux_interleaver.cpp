@@ -0,0 +1,233 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// RGYMuxInterleaver, RGYIndexedMinHeapのテスト
+//  - RGYIndexedMinHeapがキーの小さい順 (同じならidの小さい順) に取り出せること (追加・更新・削除をランダムに行う)
+//  - gating streamにパケットがなければ、ほかの同期対象のストリームは閾値を超えて先行しないこと
+//  - pressureがある場合のみ、一定回数待ったらgating streamを飛ばして進めること
+//    (飛ばしたストリームは、パケットを書き出すまで再度待たない)
+//  - 終了したストリームは待たないこと
+//  - 同期対象外のストリーム (字幕など) は、gating streamに関係なく先に書き出すこと
+
+#include <cstdio>
+#include <cstdint>
+#include <climits>
+#include <random>
+#include <vector>
+#include "rgy_mux_interleaver.h"
+
+static bool check(const char *name, bool result) {
+    printf("%s: %s\n", name, result ? "OK" : "NG");
+    return result;
+}
+
+static bool test_heap() {
+    std::mt19937 rnd(1234);
+    RGYIndexedMinHeap heap;
+    const int ids = 64;
+    std::vector<int64_t> keys(ids, 0);
+    std::vector<bool> inHeap(ids, false);
+    bool ok = true;
+    for (int i = 0; i < 20000 && ok; i++) {
+        const int id = (int)(rnd() % ids);
+        switch (rnd() % 4) {
+        case 0:
+            heap.erase(id);
+            inHeap[id] = false;
+            break;
+        default:
+            keys[id] = (int64_t)(rnd() % 100) - 50; // 同じキーを多く作る
+            heap.set(id, keys[id]);
+            inHeap[id] = true;
+            break;
+        }
+        // 参照: 全探索で最小のものを求める
+        int minId = -1;
+        for (int j = 0; j < ids; j++) {
+            ok &= heap.contains(j) == inHeap[j];
+            if (inHeap[j] && (minId < 0 || keys[j] < keys[minId])) {
+                minId = j;
+            }
+        }
+        ok &= heap.empty() == (minId < 0);
+        if (minId >= 0) {
+            ok &= heap.top() == minId && heap.topKey() == keys[minId];
+        }
+    }
+    // すべて取り出すと昇順になる
+    int64_t prevKey = INT64_MIN;
+    int prevId = -1;
+    while (ok && !heap.empty()) {
+        const int id = heap.top();
+        ok &= keys[id] > prevKey || (keys[id] == prevKey && id > prevId);
+        prevKey = keys[id];
+        prevId = id;
+        heap.erase(id);
+        ok &= !heap.contains(id);
+    }
+    return check("heap: random set/erase", ok);
+}
+
+static const int64_t THRESHOLD = 100;
+static const int STALL_WAIT = 3;
+
+// 映像と音声 (ともに同期対象) で、音声だけにパケットがある状態
+static void init_av(RGYMuxInterleaver& mux, int& video, int& audio) {
+    mux.init(THRESHOLD, STALL_WAIT);
+    video = mux.addStream(_T("video"), true, 0);
+    audio = mux.addStream(_T("audio"), true, 0);
+    mux.setDepth(audio, 10);
+}
+
+static bool test_gating() {
+    RGYMuxInterleaver mux;
+    int video, audio;
+    init_av(mux, video, audio);
+    bool ok = true;
+    ok &= check("gating: audio within threshold", mux.next(false) == audio);
+    mux.written(audio, THRESHOLD);
+    ok &= check("gating: audio at threshold", mux.next(false) == audio);
+    mux.written(audio, THRESHOLD + 1);
+    ok &= check("gating: audio blocked beyond threshold", mux.next(false) == -1 && mux.next(false) == -1);
+    ok &= check("gating: video is gating stream", mux.gatingStream() == video);
+
+    // 映像のパケットが来たら映像を書き出す
+    mux.setDepth(video, 1);
+    ok &= check("gating: video written first", mux.next(false) == video && mux.gatingStream() == -1);
+    mux.written(video, 50);
+    mux.setDepth(video, 0);
+    ok &= check("gating: audio resumes after video advanced", mux.next(false) == audio);
+    mux.written(audio, 50 + THRESHOLD + 1);
+    ok &= check("gating: audio blocked again", mux.next(false) == -1 && mux.stream(video).stalled == 0);
+
+    // 書き出し待ちのパケットのあるストリーム同士は、dtsの小さい順
+    mux.setDepth(video, 3);
+    ok &= check("gating: smaller dts first", mux.next(false) == video);
+    mux.written(video, 50 + THRESHOLD + 2);
+    ok &= check("gating: then the other stream", mux.next(false) == audio);
+    return ok;
+}
+
+static bool test_stall() {
+    RGYMuxInterleaver mux;
+    int video, audio;
+    init_av(mux, video, audio);
+    mux.written(audio, THRESHOLD + 1);
+    bool ok = true;
+    // pressureがなければいつまでも待つ
+    bool blocked = true;
+    for (int i = 0; i < STALL_WAIT * 4; i++) {
+        blocked &= mux.next(false) == -1;
+    }
+    ok &= check("stall: no skip without pressure", blocked && mux.stream(video).stalled == 0);
+
+    // pressureがあれば、STALL_WAIT回待った後に進める
+    blocked = true;
+    for (int i = 0; i < STALL_WAIT; i++) {
+        blocked &= mux.next(true) == -1;
+    }
+    ok &= check("stall: waits under pressure", blocked);
+    ok &= check("stall: skips after wait", mux.next(true) == audio
+        && mux.stream(video).stalled == 1 && mux.stream(video).lastDts == THRESHOLD + 1);
+    // 飛ばしたgating streamのdtsは進んでいるので、続けて書き出せる
+    mux.written(audio, THRESHOLD + 2);
+    ok &= check("stall: continues after skip", mux.next(false) == audio);
+
+    // gating streamのパケットが来ないままなら、再度待たずに飛ばす (ストリームが途中までしかない場合など)
+    mux.written(audio, THRESHOLD * 3);
+    ok &= check("stall: keeps skipping a stream that has not advanced", mux.next(true) == audio
+        && mux.stream(video).stalled == 2 && mux.stream(video).lastDts == THRESHOLD * 3);
+
+    // gating streamのパケットを書き出したら、待った回数はリセットされる
+    mux.setDepth(video, 1);
+    ok &= check("stall: gating stream written when it has packets", mux.next(true) == video);
+    mux.written(video, THRESHOLD * 4);
+    mux.setDepth(video, 0);
+    mux.written(audio, THRESHOLD * 5 + 1);
+    blocked = true;
+    for (int i = 0; i < STALL_WAIT; i++) {
+        blocked &= mux.next(true) == -1;
+    }
+    ok &= check("stall: wait count reset when gating stream advances", blocked && mux.stream(video).stalled == 2);
+    ok &= check("stall: skips again after wait", mux.next(true) == audio && mux.stream(video).stalled == 3);
+    return ok;
+}
+
+static bool test_ended() {
+    RGYMuxInterleaver mux;
+    int video, audio;
+    init_av(mux, video, audio);
+    mux.written(audio, THRESHOLD * 5);
+    bool ok = check("ended: blocked before end", mux.next(false) == -1);
+    mux.setEnded(video);
+    ok &= check("ended: not waited", mux.next(false) == audio && mux.gatingStream() == -1);
+    mux.written(audio, THRESHOLD * 100);
+    ok &= check("ended: no limit", mux.next(false) == audio);
+    mux.setEnded(audio);
+    ok &= check("ended: all ended", mux.next(false) == audio && mux.gatingStream() == -1);
+    mux.setDepth(audio, 0);
+    ok &= check("ended: nothing to write", mux.next(true) == -1);
+    return ok;
+}
+
+static bool test_non_gating() {
+    RGYMuxInterleaver mux;
+    int video, audio;
+    init_av(mux, video, audio);
+    const int sub = mux.addStream(_T("subtitle"), false, 0);
+    mux.written(audio, THRESHOLD + 1);
+    bool ok = check("non-gating: audio blocked", mux.next(false) == -1);
+    // 字幕のdtsがどれだけ先行していても書き出せる
+    mux.written(sub, THRESHOLD * 10);
+    mux.setDepth(sub, 2);
+    ok &= check("non-gating: subtitle passes while blocked", mux.next(false) == sub && mux.gatingStream() == video);
+    mux.written(sub, THRESHOLD * 20);
+    ok &= check("non-gating: subtitle passes again", mux.next(false) == sub);
+    mux.setDepth(sub, 0);
+    ok &= check("non-gating: back to blocked", mux.next(false) == -1);
+    // 同期対象のストリームにパケットがあっても、字幕が先
+    mux.setDepth(video, 1);
+    mux.setDepth(sub, 1);
+    ok &= check("non-gating: subtitle before gating streams", mux.next(false) == sub);
+    mux.setDepth(sub, 0);
+    ok &= check("non-gating: then video", mux.next(false) == video);
+    // 字幕は同期対象ではないので、字幕を待つことはない
+    mux.setDepth(video, 0);
+    mux.written(video, THRESHOLD * 30);
+    mux.written(audio, THRESHOLD * 30);
+    ok &= check("non-gating: never the gating stream", mux.gatingStream() != sub && mux.stream(sub).stalled == 0);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    bool ok = true;
+    ok &= test_heap();
+    ok &= test_gating();
+    ok &= test_stall();
+    ok &= test_ended();
+    ok &= test_non_gating();
+    printf("%s\n", ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
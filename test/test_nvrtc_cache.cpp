@@ -0,0 +1,290 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// RGYNVRTCCacheのテスト (CUDA, NVRTCは不要)
+//  - キーがソース, ヘッダ, インクルードパス, コンパイルオプション, NVRTCのバージョン, インスタンス化のいずれが異なっても別になること
+//  - store()は一時ファイルに書いてから置き換え、一時ファイルを残さないこと (古い一時ファイルのみ削除すること)
+//  - 途中で切れた/壊れた/別のキーのキャッシュファイルを読み込まないこと
+//  - 合計サイズが上限を超えたら、最後に使用した時刻の古いものから削除すること
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include "rgy_nvrtc_cache.h"
+#include "rgy_util.h"
+
+static const TCHAR *TEST_CACHE_DIR = _T("test_nvrtc_cache_dir");
+
+struct TestKeyParam {
+    std::vector<std::string> programOptions;
+    std::vector<std::string> includePaths;
+    std::map<std::string, std::string> sources;
+    int nvrtcMajor;
+    int nvrtcMinor;
+    std::string instantiation;
+    std::vector<std::string> options;
+
+    std::string key() const {
+        return RGYNVRTCCache::kernelKey(nvrtcMajor, nvrtcMinor, instantiation, options,
+            RGYNVRTCCache::programKey(programOptions, includePaths, sources));
+    }
+};
+
+static TestKeyParam test_key_param() {
+    TestKeyParam prm;
+    prm.programOptions = { "-std=c++14", "-DTEST=1" };
+    prm.includePaths = { "include" };
+    prm.sources = {
+        { "kernel.cu", "#include \"header.h\"\n__global__ void kernel_filter(int *ptr) { *ptr = VALUE; }\n" },
+        { "header.h", "#define VALUE 1\n" },
+    };
+    prm.nvrtcMajor = 12;
+    prm.nvrtcMinor = 4;
+    prm.instantiation = "kernel_filter<0, 1>";
+    prm.options = { "-arch=compute_75" };
+    return prm;
+}
+
+static std::vector<std::filesystem::path> list_files(const TCHAR *ext) {
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(std::filesystem::path(TEST_CACHE_DIR), ec)) {
+        if (entry.path().extension() == std::filesystem::path(ext)) {
+            files.push_back(entry.path());
+        }
+    }
+    return files;
+}
+
+static bool check(const char *name, bool result) {
+    printf("%s: %s\n", name, result ? "OK" : "NG");
+    return result;
+}
+
+static bool test_key() {
+    const auto base = test_key_param();
+    const auto baseKey = base.key();
+    bool ok = check("key: same input", test_key_param().key() == baseKey);
+    struct {
+        const char *name;
+        void (*modify)(TestKeyParam& prm);
+    } cases[] = {
+        { "key: source content",   [](TestKeyParam& prm) { prm.sources["kernel.cu"] += " "; } },
+        { "key: source name",      [](TestKeyParam& prm) { auto src = prm.sources["kernel.cu"]; prm.sources.erase("kernel.cu"); prm.sources["kernel2.cu"] = src; } },
+        { "key: header content",   [](TestKeyParam& prm) { prm.sources["header.h"] = "#define VALUE 2\n"; } },
+        { "key: header added",     [](TestKeyParam& prm) { prm.sources["header2.h"] = ""; } },
+        { "key: include path",     [](TestKeyParam& prm) { prm.includePaths.push_back("include2"); } },
+        { "key: program option",   [](TestKeyParam& prm) { prm.programOptions[1] = "-DTEST=2"; } },
+        { "key: option",           [](TestKeyParam& prm) { prm.options.push_back("-use_fast_math"); } },
+        { "key: option split",     [](TestKeyParam& prm) { prm.options = { "-arch=", "compute_75" }; } },
+        { "key: option moved",     [](TestKeyParam& prm) { prm.programOptions.push_back(prm.options[0]); prm.options.clear(); } },
+        { "key: nvrtc major",      [](TestKeyParam& prm) { prm.nvrtcMajor = 11; } },
+        { "key: nvrtc minor",      [](TestKeyParam& prm) { prm.nvrtcMinor = 8; } },
+        { "key: instantiation",    [](TestKeyParam& prm) { prm.instantiation = "kernel_filter<1, 1>"; } },
+    };
+    for (const auto& c : cases) {
+        auto prm = test_key_param();
+        c.modify(prm);
+        ok &= check(c.name, prm.key() != baseKey);
+    }
+
+    // NVRTCのバージョンが異なれば、キャッシュから読み込まない
+    RGYNVRTCCache cache;
+    cache.init(TEST_CACHE_DIR, 1024 * 1024);
+    cache.store(baseKey, "ptx", "mangled");
+    auto other = test_key_param();
+    other.nvrtcMinor++;
+    std::string ptx, mangled;
+    ok &= check("key: load with other nvrtc version", cache.load(other.key(), ptx, mangled) == RGY_ERR_NOT_FOUND);
+    ok &= check("key: load with same key", cache.load(baseKey, ptx, mangled) == RGY_ERR_NONE && ptx == "ptx" && mangled == "mangled");
+    return ok;
+}
+
+static bool test_store() {
+    std::error_code ec;
+    std::filesystem::remove_all(std::filesystem::path(TEST_CACHE_DIR), ec);
+    RGYNVRTCCache cache;
+    bool ok = check("store: init", cache.init(TEST_CACHE_DIR, 1024 * 1024) == RGY_ERR_NONE);
+
+    // 異常終了で残った一時ファイル (古いものは削除され、書き込み中の可能性がある新しいものは残る)
+    const auto tmpOld = std::filesystem::path(TEST_CACHE_DIR) / "0000000000000000.nvrtc.1.tmp";
+    const auto tmpNew = std::filesystem::path(TEST_CACHE_DIR) / "0000000000000000.nvrtc.2.tmp";
+    for (const auto& tmp : { tmpOld, tmpNew }) {
+        FILE *fp = _tfopen(tmp.c_str(), _T("wb"));
+        fputs("partial", fp);
+        fclose(fp);
+    }
+    std::filesystem::last_write_time(tmpOld, std::filesystem::file_time_type::clock::now() - std::chrono::hours(2), ec);
+
+    const auto key = test_key_param().key();
+    const std::string ptx(10000, 'p');
+    ok &= check("store: write", cache.store(key, ptx, "mangled") == RGY_ERR_NONE);
+    const auto entries = list_files(_T(".nvrtc"));
+    ok &= check("store: one entry", entries.size() == 1);
+    const auto tmps = list_files(_T(".tmp"));
+    ok &= check("store: own temporary file renamed, old one removed", tmps.size() == 1 && tmps[0] == tmpNew);
+
+    std::string loadPtx, loadMangled;
+    ok &= check("store: load", cache.load(key, loadPtx, loadMangled) == RGY_ERR_NONE && loadPtx == ptx && loadMangled == "mangled");
+
+    // 既存のファイルを置き換える
+    ok &= check("store: overwrite", cache.store(key, "ptx2", "") == RGY_ERR_NONE && list_files(_T(".nvrtc")).size() == 1);
+    ok &= check("store: load overwritten", cache.load(key, loadPtx, loadMangled) == RGY_ERR_NONE && loadPtx == "ptx2" && loadMangled.empty());
+
+    // 別のインスタンス (別のプロセスを想定) から読み込める
+    RGYNVRTCCache cache2;
+    cache2.init(TEST_CACHE_DIR, 1024 * 1024);
+    ok &= check("store: load from other instance", cache2.load(key, loadPtx, loadMangled) == RGY_ERR_NONE && loadPtx == "ptx2");
+    ok &= check("store: hits/misses", cache.hits() == 2 && cache.misses() == 0 && cache2.hits() == 1);
+    return ok;
+}
+
+// キャッシュファイルを書き換えて読み込む
+static bool load_modified(const char *name, const std::string& key, void (*modify)(const std::filesystem::path& path, const std::filesystem::path& other)) {
+    std::error_code ec;
+    std::filesystem::remove_all(std::filesystem::path(TEST_CACHE_DIR), ec);
+    RGYNVRTCCache cache;
+    cache.init(TEST_CACHE_DIR, 1024 * 1024);
+    cache.store(key, std::string(1000, 'p'), "mangled");
+    const auto path = list_files(_T(".nvrtc"))[0];
+    const auto other = std::filesystem::path(TEST_CACHE_DIR) / "other.nvrtc";
+    modify(path, other);
+    std::string ptx = "dummy", mangled = "dummy";
+    const auto err = cache.load(key, ptx, mangled);
+    return check(name, err == RGY_ERR_NOT_FOUND && ptx.empty() && mangled.empty() && cache.misses() == 1);
+}
+
+static bool test_corrupt() {
+    const auto key = test_key_param().key();
+    bool ok = true;
+    ok &= load_modified("corrupt: truncated data", key, [](const std::filesystem::path& path, const std::filesystem::path& other) {
+        std::error_code ec;
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1, ec);
+    });
+    ok &= load_modified("corrupt: truncated header", key, [](const std::filesystem::path& path, const std::filesystem::path& other) {
+        std::error_code ec;
+        std::filesystem::resize_file(path, 20, ec);
+    });
+    ok &= load_modified("corrupt: empty", key, [](const std::filesystem::path& path, const std::filesystem::path& other) {
+        std::error_code ec;
+        std::filesystem::resize_file(path, 0, ec);
+    });
+    ok &= load_modified("corrupt: magic", key, [](const std::filesystem::path& path, const std::filesystem::path& other) {
+        FILE *fp = _tfopen(path.c_str(), _T("r+b"));
+        fputc('X', fp);
+        fclose(fp);
+    });
+    ok &= load_modified("corrupt: huge size", key, [](const std::filesystem::path& path, const std::filesystem::path& other) {
+        // ptxSize (ヘッダの末尾)
+        FILE *fp = _tfopen(path.c_str(), _T("r+b"));
+        fseek(fp, 40, SEEK_SET);
+        const uint64_t size = 0x7fffffffffffffffull;
+        fwrite(&size, sizeof(size), 1, fp);
+        fclose(fp);
+    });
+    // ファイル名が衝突した別のキーのファイル
+    ok &= load_modified("corrupt: other key", key, [](const std::filesystem::path& path, const std::filesystem::path& other) {
+        RGYNVRTCCache cache;
+        cache.init(TEST_CACHE_DIR, 1024 * 1024);
+        auto prm = test_key_param();
+        prm.instantiation += " ";
+        cache.store(prm.key(), "other", "other");
+        std::error_code ec;
+        for (const auto& file : list_files(_T(".nvrtc"))) {
+            if (file != path) {
+                std::filesystem::rename(file, path, ec);
+            }
+        }
+    });
+    return ok;
+}
+
+static bool test_evict() {
+    std::error_code ec;
+    std::filesystem::remove_all(std::filesystem::path(TEST_CACHE_DIR), ec);
+    // ヘッダ(48) + mangled(1) + ptx(1000) = 1049byteのエントリが3つまで入る
+    RGYNVRTCCache cache;
+    cache.init(TEST_CACHE_DIR, 3500);
+    std::vector<std::string> keys;
+    std::map<std::string, std::filesystem::path> paths;
+    for (int i = 0; i < 5; i++) {
+        auto prm = test_key_param();
+        prm.instantiation = strsprintf("kernel_filter<%d>", i);
+        keys.push_back(prm.key());
+    }
+    const auto now = std::filesystem::file_time_type::clock::now();
+    auto store = [&](int i, size_t ptxSize) {
+        const auto before = list_files(_T(".nvrtc"));
+        cache.store(keys[i], std::string(ptxSize, 'a' + i), "m");
+        for (const auto& file : list_files(_T(".nvrtc"))) {
+            if (std::find(before.begin(), before.end(), file) == before.end()) {
+                paths[keys[i]] = file;
+            }
+        }
+    };
+    auto set_time = [&](int i, int seconds_ago) {
+        std::filesystem::last_write_time(paths[keys[i]], now - std::chrono::seconds(seconds_ago), ec);
+    };
+    auto exists = [&](int i) {
+        return std::filesystem::exists(paths[keys[i]]);
+    };
+    store(0, 1000); set_time(0, 40);
+    store(1, 1000); set_time(1, 30);
+    store(2, 1000); set_time(2, 20);
+    bool ok = check("evict: under limit", exists(0) && exists(1) && exists(2));
+
+    // 読み込むと最後に使用した時刻が更新され、0ではなく1が最も古くなる
+    std::string ptx, mangled;
+    cache.load(keys[0], ptx, mangled);
+    store(3, 1000);
+    ok &= check("evict: least recently used removed", exists(0) && !exists(1) && exists(2) && exists(3));
+    ok &= check("evict: removed entry not found", cache.load(keys[1], ptx, mangled) == RGY_ERR_NOT_FOUND);
+
+    // 2つ削除しないと収まらない場合は、古い順に2つ削除する
+    set_time(2, 30);
+    set_time(0, 20);
+    set_time(3, 10);
+    store(4, 2000);
+    ok &= check("evict: oldest two removed", !exists(2) && !exists(0) && exists(3) && exists(4));
+    ok &= check("evict: remaining entries", cache.load(keys[3], ptx, mangled) == RGY_ERR_NONE && cache.load(keys[4], ptx, mangled) == RGY_ERR_NONE && ptx == std::string(2000, 'e'));
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    std::error_code ec;
+    std::filesystem::remove_all(std::filesystem::path(TEST_CACHE_DIR), ec);
+    bool ok = true;
+    ok &= test_key();
+    ok &= test_store();
+    ok &= test_corrupt();
+    ok &= test_evict();
+    std::filesystem::remove_all(std::filesystem::path(TEST_CACHE_DIR), ec);
+    printf("%s\n", ok ? "OK" : "NG");
+    return ok ? 0 : 1;
+}
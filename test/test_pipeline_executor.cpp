@@ -0,0 +1,277 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+// RGYPipelineExecutor (--thread-pipeline) のテスト
+// エンコーダやフィルタの代わりに、PipelineTaskと同じインターフェースを持つスタブのtaskを使う
+//  - 段の分割によらず、すべてのフレームが入力順に、1フレームずつ欠けることなく書き出されること
+//  - 時間方向にフレームを保持するtaskや非同期に出力するエンコーダがあっても、flushで残りがすべて出力されること
+//  - 書き出しでエラーが発生した場合、そのエラーを返し、以降のフレームを書き出さないこと
+//  - checkAbortでtrueを返した場合、RGY_ERR_ABORTEDを返すこと
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include "rgy_pipeline_executor.h"
+
+struct TestFrame {
+    int value;
+};
+
+enum class TestTaskType {
+    Input,       // フレームを生成する (value = 0, 1, 2, ...)
+    PassThrough, // value + 1 して、そのまま次のtaskに渡す
+    Hold,        // value * 2 して、2フレーム保持してから出力する (時間方向のフィルタ相当)
+    Encoder,     // value をそのまま、別スレッドから遅れて出力する (非同期のエンコーダ相当)
+};
+
+class TestTask {
+public:
+    TestTask(TestTaskType type, int frames, int seed) :
+        m_type(type), m_frames(frames), m_index(0), m_inputFin(false), m_outputMaxQueueSize(1),
+        m_mtx(), m_output(), m_hold(), m_encQueue(), m_encPending(0), m_encStop(false), m_encThread(), m_rng(seed) {
+        if (m_type == TestTaskType::Encoder) {
+            m_encThread = std::thread([this]() { runEncoder(); });
+        }
+    }
+    ~TestTask() {
+        m_encStop = true;
+        if (m_encThread.joinable()) {
+            m_encThread.join();
+        }
+    }
+    bool isPassThrough() const { return m_type == TestTaskType::PassThrough; }
+    tstring print() const {
+        switch (m_type) {
+        case TestTaskType::Input:       return _T("input");
+        case TestTaskType::PassThrough: return _T("passthrough");
+        case TestTaskType::Hold:        return _T("hold");
+        case TestTaskType::Encoder:     return _T("encoder");
+        default:                        return _T("unknown");
+        }
+    }
+    void setOutputMaxQueueSize(int size) { m_outputMaxQueueSize = size; }
+    RGY_ERR sendFrameTrace(std::unique_ptr<TestFrame>& frame) {
+        std::this_thread::sleep_for(std::chrono::microseconds(randomWait(200)));
+        switch (m_type) {
+        case TestTaskType::Input:
+            if (m_index >= m_frames) {
+                if (m_inputFin) {
+                    return RGY_ERR_MORE_DATA;
+                }
+                m_inputFin = true;
+                return RGY_ERR_MORE_BITSTREAM;
+            }
+            pushOutput(std::make_unique<TestFrame>(TestFrame{ m_index++ }));
+            return RGY_ERR_NONE;
+        case TestTaskType::PassThrough:
+            if (!frame) {
+                return RGY_ERR_MORE_DATA;
+            }
+            frame->value += 1;
+            pushOutput(std::move(frame));
+            return RGY_ERR_NONE;
+        case TestTaskType::Hold:
+            if (!frame) {
+                while (!m_hold.empty()) {
+                    pushOutput(std::move(m_hold.front()));
+                    m_hold.pop_front();
+                }
+                return RGY_ERR_MORE_DATA;
+            }
+            frame->value *= 2;
+            m_hold.push_back(std::move(frame));
+            if (m_hold.size() > 2) {
+                pushOutput(std::move(m_hold.front()));
+                m_hold.pop_front();
+            }
+            return RGY_ERR_NONE;
+        case TestTaskType::Encoder:
+        default:
+            if (!frame) {
+                while (m_encPending > 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+                return RGY_ERR_MORE_DATA;
+            } else {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                m_encPending++;
+                m_encQueue.push_back(std::move(frame));
+            }
+            return RGY_ERR_NONE;
+        }
+    }
+    std::vector<std::unique_ptr<TestFrame>> getOutputTrace(bool sync) {
+        std::vector<std::unique_ptr<TestFrame>> output;
+        std::lock_guard<std::mutex> lock(m_mtx);
+        while ((int)m_output.size() > m_outputMaxQueueSize) {
+            output.push_back(std::move(m_output.front()));
+            m_output.pop_front();
+        }
+        return output;
+    }
+protected:
+    int randomWait(int maxUs) {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return (int)(m_rng() % maxUs);
+    }
+    void pushOutput(std::unique_ptr<TestFrame> frame) {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_output.push_back(std::move(frame));
+    }
+    void runEncoder() {
+        while (!m_encStop) {
+            std::unique_ptr<TestFrame> frame;
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                if (!m_encQueue.empty()) {
+                    frame = std::move(m_encQueue.front());
+                    m_encQueue.pop_front();
+                }
+            }
+            if (!frame) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(randomWait(300)));
+            pushOutput(std::move(frame));
+            m_encPending--;
+        }
+    }
+
+    TestTaskType m_type;
+    int m_frames;
+    int m_index;
+    bool m_inputFin;
+    int m_outputMaxQueueSize;
+    std::mutex m_mtx;
+    std::deque<std::unique_ptr<TestFrame>> m_output;
+    std::deque<std::unique_ptr<TestFrame>> m_hold;
+    std::deque<std::unique_ptr<TestFrame>> m_encQueue;
+    std::atomic<int> m_encPending;
+    std::atomic<bool> m_encStop;
+    std::thread m_encThread;
+    std::mt19937 m_rng;
+};
+
+typedef RGYPipelineExecutor<TestTask, TestFrame> TestExecutor;
+
+enum class TestCase {
+    Normal,
+    WriteError,
+    Abort,
+};
+
+static const int TEST_FRAMES = 200;
+static const int TEST_WRITE_ERROR_AT = 30;
+static const int TEST_ABORT_AT = 50;
+
+// input → passthrough → hold → hold → encoder を stages で分割して実行する
+static bool test_pipeline(const std::vector<TestExecutor::StageParam>& stages, const TestCase testCase, const int seed) {
+    std::vector<std::unique_ptr<TestTask>> tasks;
+    tasks.push_back(std::make_unique<TestTask>(TestTaskType::Input, TEST_FRAMES, seed + 0));
+    tasks.push_back(std::make_unique<TestTask>(TestTaskType::PassThrough, 0, seed + 1));
+    tasks.push_back(std::make_unique<TestTask>(TestTaskType::Hold, 0, seed + 2));
+    tasks.push_back(std::make_unique<TestTask>(TestTaskType::Hold, 0, seed + 3));
+    tasks.push_back(std::make_unique<TestTask>(TestTaskType::Encoder, 0, seed + 4));
+    std::vector<TestTask *> taskPtrs;
+    for (auto& task : tasks) {
+        taskPtrs.push_back(task.get());
+    }
+    TestExecutor executor(std::make_shared<RGYLog>(nullptr, RGY_LOG_QUIET));
+    if (auto err = executor.init(taskPtrs, stages, std::vector<bool>(taskPtrs.size(), false), 4); err != RGY_ERR_NONE) {
+        fprintf(stderr, "init failed: %s.\n", tchar_to_string(get_err_mes(err)).c_str());
+        return false;
+    }
+    std::vector<int> written;
+    TestExecutor::Callbacks callbacks;
+    callbacks.checkAbort = [&](bool) {
+        return testCase == TestCase::Abort && (int)written.size() >= TEST_ABORT_AT;
+    };
+    callbacks.write = [&](std::unique_ptr<TestFrame>& frame) {
+        written.push_back(frame->value);
+        return (testCase == TestCase::WriteError && (int)written.size() == TEST_WRITE_ERROR_AT) ? RGY_ERR_UNKNOWN : RGY_ERR_NONE;
+    };
+    const auto err = executor.run(callbacks);
+    switch (testCase) {
+    case TestCase::WriteError:
+        if (err != RGY_ERR_UNKNOWN || (int)written.size() != TEST_WRITE_ERROR_AT) {
+            fprintf(stderr, "write error: returned %s, %d frames written.\n", tchar_to_string(get_err_mes(err)).c_str(), (int)written.size());
+            return false;
+        }
+        return true;
+    case TestCase::Abort:
+        if (err != RGY_ERR_ABORTED) {
+            fprintf(stderr, "abort: returned %s.\n", tchar_to_string(get_err_mes(err)).c_str());
+            return false;
+        }
+        return true;
+    case TestCase::Normal:
+    default:
+        break;
+    }
+    if (err != RGY_ERR_NONE || (int)written.size() != TEST_FRAMES) {
+        fprintf(stderr, "returned %s, %d frames written.\n", tchar_to_string(get_err_mes(err)).c_str(), (int)written.size());
+        return false;
+    }
+    for (int i = 0; i < TEST_FRAMES; i++) {
+        if (written[i] != (i + 1) * 4) {
+            fprintf(stderr, "frame %d: %d (expected %d).\n", i, written[i], (i + 1) * 4);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    // 段の分割: 1段 (従来の処理と同じ)、入力/フィルタ/エンコーダ、taskごと
+    const std::vector<std::pair<const char *, std::vector<TestExecutor::StageParam>>> stageList = {
+        { "1 stage",  { { 0, 0 } } },
+        { "4 stages", { { 0, 0 }, { 2, 2 }, { 3, 1 }, { 4, 3 } } },
+        { "5 stages", { { 0, 0 }, { 1, 1 }, { 2, 1 }, { 3, 1 }, { 4, 1 } } },
+    };
+    const std::vector<std::pair<const char *, TestCase>> caseList = {
+        { "normal",      TestCase::Normal },
+        { "write error", TestCase::WriteError },
+        { "abort",       TestCase::Abort },
+    };
+    int errors = 0;
+    for (const auto& stages : stageList) {
+        for (const auto& testCase : caseList) {
+            const int loops = (testCase.second == TestCase::Normal) ? 16 : 4;
+            int ng = 0;
+            for (int i = 0; i < loops; i++) {
+                ng += (test_pipeline(stages.second, testCase.second, i * 5)) ? 0 : 1;
+            }
+            fprintf((ng) ? stderr : stdout, "%s, %s: %s\n", stages.first, testCase.first, (ng) ? "NG" : "OK");
+            errors += ng;
+        }
+    }
+    return (errors) ? 1 : 0;
+}
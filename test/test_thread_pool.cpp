@@ -0,0 +1,244 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2024 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// RGYThreadPoolのテスト
+//  - parallel_forですべてのインデックスが1回ずつ実行されること
+//  - waitが実行できるタスクのないときにCPUを消費せずに眠ること
+//  - RGYThreadPoolSerialのfuncが同時に実行されず、kick()の前に積んだデータがすべて処理されること
+//  - RGYThreadPoolSlotsを共有するプール間で、同時に実行されるワーカーの数が枠の数を超えないこと
+//  - RGYThreadPoolSlotsの枠が同じプロセス内でも排他され、破棄すると解放されること
+//  - RGYThreadPool::sharedが同じパラメータに対して1つのプールを返し、その場でワーカーを追加すること
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <sys/resource.h>
+#include "rgy_thread_pool.h"
+
+static double thread_cpu_time_ms() {
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-3;
+}
+
+static bool test_parallel_for(RGYThreadPool& pool) {
+    const int n = 1000;
+    std::vector<std::atomic<int>> count(n);
+    for (auto& c : count) c = 0;
+    for (int loop = 0; loop < 100; loop++) {
+        pool.parallel_for(n, [&count](int i) { count[i]++; });
+    }
+    for (int i = 0; i < n; i++) {
+        if (count[i] != 100) {
+            fprintf(stderr, "parallel_for: index %d executed %d times.\n", i, count[i].load());
+            return false;
+        }
+    }
+    fprintf(stdout, "parallel_for: OK\n");
+    return true;
+}
+
+static bool test_wait_sleeps(RGYThreadPool& pool) {
+    //ワーカーで長いタスクを実行させ、その完了を待つ間の呼び出し側のCPU時間を測る
+    RGYThreadPoolGroup group;
+    group.add(1);
+    RGYThreadPoolTask task;
+    task.func = [](void *, int) { std::this_thread::sleep_for(std::chrono::milliseconds(300)); };
+    task.ctx = nullptr;
+    task.index = 0;
+    task.group = &group;
+    //呼び出し側で取ってしまわないよう、ワーカーが取り出すのを待ってからwaitする
+    pool.submit(task);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const double cpu_start = thread_cpu_time_ms();
+    pool.wait(group);
+    const double cpu_ms = thread_cpu_time_ms() - cpu_start;
+    const bool ok = cpu_ms < 50.0;
+    fprintf(stdout, "wait: cpu time while waiting %.1f ms: %s\n", cpu_ms, (ok) ? "OK" : "NG");
+    return ok;
+}
+
+static bool test_serial(const std::shared_ptr<RGYThreadPool>& pool) {
+    const int producers = 4;
+    const int count = 20000;
+    RGYQueueLockFree<int> queue;
+    queue.init(1024);
+    std::atomic<int> running(0);
+    std::atomic<bool> overlap(false);
+    int64_t sum = 0; //funcは同時に実行されないので、ロックなしで更新できる
+    RGYThreadPoolSerial serial(pool, [&]() {
+        if (running.fetch_add(1) != 0) {
+            overlap = true;
+        }
+        int value = 0;
+        while (queue.pop_no_event(&value)) {
+            sum += value;
+        }
+        running--;
+    });
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; i++) {
+        threads.emplace_back([&]() {
+            for (int v = 1; v <= count; v++) {
+                queue.push_no_event(v);
+                serial.kick();
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    serial.wait();
+    const int64_t expected = (int64_t)producers * count * (count + 1) / 2;
+    const bool ok = !overlap && sum == expected;
+    fprintf(stdout, "serial: sum %lld (expected %lld)%s: %s\n", (long long)sum, (long long)expected,
+        (overlap) ? ", overlapped" : "", (ok) ? "OK" : "NG");
+    return ok;
+}
+
+static bool test_slots() {
+    const int slots = 2;
+    auto slot = std::make_shared<RGYThreadPoolSlots>(slots);
+    if (!slot->valid()) {
+        fprintf(stdout, "slots: not available on this system, skipped.\n");
+        return true;
+    }
+    //同時に実行中の他のプロセスが枠を使っている場合があるので、枠の数は実際に取得できた数で確認する
+    std::vector<int> held;
+    for (int s; (s = slot->acquire(0)) >= 0; ) {
+        held.push_back(s);
+    }
+    const int available = (int)held.size();
+    for (auto s : held) {
+        slot->release(s);
+    }
+    std::atomic<int> running(0);
+    std::atomic<int> maxRunning(0);
+    auto task = [&](int) {
+        const int r = running.fetch_add(1) + 1;
+        int m = maxRunning.load();
+        while (r > m && !maxRunning.compare_exchange_weak(m, r)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        running--;
+    };
+    {
+        //2つのプールで同じ枠を使い、呼び出し側のスレッドではタスクを実行しないよう投入だけ行う
+        RGYThreadPool pool0(4, RGYParamThread(), slot);
+        RGYThreadPool pool1(4, RGYParamThread(), slot);
+        RGYThreadPoolGroup group;
+        const int n = 64;
+        group.add(2 * n);
+        struct Ctx { decltype(task) *func; } ctx = { &task };
+        for (int i = 0; i < n; i++) {
+            for (auto pool : { &pool0, &pool1 }) {
+                RGYThreadPoolTask t;
+                t.func = [](void *c, int index) { (*((Ctx *)c)->func)(index); };
+                t.ctx = &ctx;
+                t.index = i;
+                t.group = &group;
+                pool->submit(t);
+            }
+        }
+        while (!group.finished()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    const bool ok = available > 0 && maxRunning.load() <= available;
+    fprintf(stdout, "slots: %d slots, max running workers %d: %s\n", available, maxRunning.load(), (ok) ? "OK" : "NG");
+    return ok;
+}
+
+static bool test_slots_release() {
+    const int slots = 2;
+    std::vector<int> held0;
+    {
+        RGYThreadPoolSlots slot0(slots);
+        if (!slot0.valid()) {
+            fprintf(stdout, "slots release: not available on this system, skipped.\n");
+            return true;
+        }
+        for (int s; (s = slot0.acquire(0)) >= 0; ) {
+            held0.push_back(s);
+        }
+        //別のインスタンス (別のfd) からは、保持されている枠を取得できない
+        RGYThreadPoolSlots slot1(slots);
+        if (slot1.acquire(10) >= 0) {
+            fprintf(stderr, "slots release: acquired a slot held by another instance.\n");
+            return false;
+        }
+    }
+    //破棄 (fdを閉じる) でロックが解除される
+    RGYThreadPoolSlots slot2(slots);
+    std::vector<int> held2;
+    for (int s; (s = slot2.acquire(0)) >= 0; ) {
+        held2.push_back(s);
+    }
+    for (auto s : held2) {
+        slot2.release(s);
+    }
+    const bool ok = !held0.empty() && held2.size() == held0.size();
+    fprintf(stdout, "slots release: %d slots held, %d reacquired after close: %s\n", (int)held0.size(), (int)held2.size(), (ok) ? "OK" : "NG");
+    return ok;
+}
+
+static bool test_shared() {
+    RGYParamThread param;
+    auto pool0 = RGYThreadPool::shared(1, param);
+    const int threads0 = pool0->threads();
+    auto pool1 = RGYThreadPool::shared(0, param); //論理コア数まで追加される
+    auto pool2 = RGYThreadPool::shared(1, param); //減らさない
+    const int capacity = pool0->capacity();
+    const bool same = pool0 == pool1 && pool1 == pool2;
+    const bool grown = threads0 == 1 && pool0->threads() == capacity;
+    //他のパラメータのプールは別になる
+    RGYParamThread paramOther;
+    paramOther.priority = RGYThreadPriority::Lowest;
+    auto poolOther = RGYThreadPool::shared(1, paramOther);
+    const bool other = poolOther != pool0;
+    //追加したワーカーでもタスクが実行される
+    std::atomic<int> count(0);
+    pool0->parallel_for(1000, [&count](int) { count++; });
+    const bool ok = same && grown && other && count == 1000;
+    fprintf(stdout, "shared: same pool %s, threads %d -> %d (capacity %d), other param %s: %s\n",
+        (same) ? "yes" : "no", threads0, pool0->threads(), capacity, (other) ? "separate" : "same", (ok) ? "OK" : "NG");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    bool ok = true;
+    auto pool = std::make_shared<RGYThreadPool>(4);
+    ok &= test_parallel_for(*pool);
+    ok &= test_wait_sleeps(*pool);
+    ok &= test_serial(pool);
+    ok &= test_slots();
+    ok &= test_slots_release();
+    ok &= test_shared();
+    fprintf(stdout, "%s\n", (ok) ? "OK" : "NG");
+    return (ok) ? 0 : 1;
+}